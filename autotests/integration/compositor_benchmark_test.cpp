@@ -0,0 +1,308 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "kwin_wayland_test.h"
+
+#include "abstract_client.h"
+#include "abstract_output.h"
+#include "composite.h"
+#include "effectloader.h"
+#include "effects.h"
+#include "focuschain.h"
+#include "platform.h"
+#include "renderbackend.h"
+#include "rules.h"
+#include "scene.h"
+#include "virtualdesktops.h"
+#include "wayland_server.h"
+#include "workspace.h"
+
+#include <kwinanimationeffect.h>
+#include <kwinglutils.h>
+
+#include <KWayland/Client/surface.h>
+
+#include <cmath>
+
+using namespace KWin;
+
+static const QString s_socketName = QStringLiteral("wayland_test_kwin_compositor_benchmark-0");
+
+/**
+ * The benchmarks in this test measure the hot paths of the compositor with a growing number
+ * of windows. Every row creates the windows it needs, so the reported time per iteration can
+ * be divided by the window count in the row name to get the time per window. The painting
+ * benchmarks render one frame of the first output per iteration.
+ */
+class CompositorBenchmarkTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void benchmarkPaintScreen_data();
+    void benchmarkPaintScreen();
+    void benchmarkAnimationEffect_data();
+    void benchmarkAnimationEffect();
+    void benchmarkRuleBookFind_data();
+    void benchmarkRuleBookFind();
+    void benchmarkFocusChain_data();
+    void benchmarkFocusChain();
+
+private:
+    QList<AbstractClient *> createWindows(int count, bool overlapping, QObject *parent);
+    void paintFrames();
+
+    KSharedConfig::Ptr m_rulesConfig;
+};
+
+class BenchmarkAnimationEffect : public AnimationEffect
+{
+public:
+    using AnimationEffect::animate;
+};
+
+void CompositorBenchmarkTest::initTestCase()
+{
+    qRegisterMetaType<KWin::AbstractClient *>();
+    QSignalSpy applicationStartedSpy(kwinApp(), &Application::started);
+    QVERIFY(applicationStartedSpy.isValid());
+    kwinApp()->platform()->setInitialWindowSize(QSize(1280, 1024));
+    QVERIFY(waylandServer()->init(s_socketName));
+
+    // disable all effects - only the effect loaded by the benchmark should take part in painting
+    auto config = KSharedConfig::openConfig(QString(), KConfig::SimpleConfig);
+    KConfigGroup plugins(config, QStringLiteral("Plugins"));
+    const auto builtinNames = EffectLoader().listOfKnownEffects();
+    for (const QString &name : builtinNames) {
+        plugins.writeEntry(name + QStringLiteral("Enabled"), false);
+    }
+    config->sync();
+    kwinApp()->setConfig(config);
+
+    qputenv("KWIN_COMPOSE", QByteArrayLiteral("O2"));
+    qputenv("KWIN_EFFECTS_FORCE_ANIMATIONS", QByteArrayLiteral("1"));
+
+    kwinApp()->start();
+    QVERIFY(applicationStartedSpy.wait());
+    QVERIFY(Compositor::self());
+    QCOMPARE(Compositor::self()->backend()->compositingType(), KWin::OpenGLCompositing);
+    Test::initWaylandWorkspace();
+
+    m_rulesConfig = KSharedConfig::openConfig(QStringLiteral("kwinrulesrc"), KConfig::SimpleConfig);
+    RuleBook::self()->setConfig(m_rulesConfig);
+}
+
+void CompositorBenchmarkTest::init()
+{
+    QVERIFY(Test::setupWaylandConnection());
+}
+
+void CompositorBenchmarkTest::cleanup()
+{
+    Test::destroyWaylandConnection();
+
+    static_cast<EffectsHandlerImpl *>(effects)->unloadAllEffects();
+
+    for (const QString &group : m_rulesConfig->groupList()) {
+        m_rulesConfig->deleteGroup(group);
+    }
+    workspace()->slotReconfigure();
+}
+
+QList<AbstractClient *> CompositorBenchmarkTest::createWindows(int count, bool overlapping, QObject *parent)
+{
+    const QRect area = kwinApp()->platform()->enabledOutputs().constFirst()->geometry();
+    const int columns = std::ceil(std::sqrt(count));
+    const QSize tileSize(area.width() / columns, area.height() / columns);
+
+    QList<AbstractClient *> clients;
+    for (int i = 0; i < count; ++i) {
+        auto surface = Test::createSurface(parent);
+        auto shellSurface = Test::createXdgToplevelSurface(surface, surface);
+        shellSurface->set_app_id(QStringLiteral("org.kde.benchmark%1").arg(i));
+
+        // opaque buffers, so the scene can skip the parts of the windows that are covered
+        const QSize size = overlapping ? area.size() / 2 : tileSize;
+        AbstractClient *client = Test::renderAndWaitForShown(surface, size, Qt::blue, QImage::Format_RGB32);
+        if (!client) {
+            return {};
+        }
+        if (overlapping) {
+            // a cascade, every window covers most of the windows below it
+            client->move(area.topLeft() + QPoint(i * 10, i * 8));
+        } else {
+            client->move(area.topLeft() + QPoint((i % columns) * tileSize.width(), (i / columns) * tileSize.height()));
+        }
+        clients.append(client);
+    }
+    return clients;
+}
+
+void CompositorBenchmarkTest::paintFrames()
+{
+    EffectScreen *screen = effects->screens().constFirst();
+
+    effects->makeOpenGLContextCurrent();
+    GLTexture texture(GL_RGBA8, screen->geometry().size() * screen->devicePixelRatio());
+    GLRenderTarget renderTarget(texture);
+    GLRenderTarget::pushRenderTarget(&renderTarget);
+
+    GLVertexBuffer::setVirtualScreenGeometry(screen->geometry());
+    GLRenderTarget::setVirtualScreenGeometry(screen->geometry());
+    GLVertexBuffer::setVirtualScreenScale(screen->devicePixelRatio());
+    GLRenderTarget::setVirtualScreenScale(screen->devicePixelRatio());
+
+    QBENCHMARK {
+        effects->renderScreen(screen);
+        // wait for the gpu, otherwise only the time to queue the commands is measured
+        glFinish();
+    }
+
+    GLRenderTarget::popRenderTarget();
+}
+
+void CompositorBenchmarkTest::benchmarkPaintScreen_data()
+{
+    QTest::addColumn<int>("windowCount");
+    QTest::addColumn<bool>("overlapping");
+
+    QTest::newRow("10 windows, tiled") << 10 << false;
+    QTest::newRow("10 windows, cascaded") << 10 << true;
+    QTest::newRow("50 windows, tiled") << 50 << false;
+    QTest::newRow("50 windows, cascaded") << 50 << true;
+}
+
+void CompositorBenchmarkTest::benchmarkPaintScreen()
+{
+    // The cascaded rows stress the occlusion culling and the clipping of window quads
+    // in the simple painting path, the tiled rows the painting of visible windows.
+    QFETCH(int, windowCount);
+    QFETCH(bool, overlapping);
+
+    QScopedPointer<QObject> testParent(new QObject);
+    const QList<AbstractClient *> clients = createWindows(windowCount, overlapping, testParent.data());
+    QCOMPARE(clients.count(), windowCount);
+
+    paintFrames();
+}
+
+void CompositorBenchmarkTest::benchmarkAnimationEffect_data()
+{
+    QTest::addColumn<int>("windowCount");
+
+    QTest::newRow("10 windows") << 10;
+    QTest::newRow("50 windows") << 50;
+}
+
+void CompositorBenchmarkTest::benchmarkAnimationEffect()
+{
+    QFETCH(int, windowCount);
+
+    QScopedPointer<QObject> testParent(new QObject);
+    const QList<AbstractClient *> clients = createWindows(windowCount, false, testParent.data());
+    QCOMPARE(clients.count(), windowCount);
+
+    // inject the effect the same way the scripted effects test does, the effect loader
+    // is private API
+    auto effect = new BenchmarkAnimationEffect;
+    const QString effectName = QStringLiteral("benchmarkAnimationEffect");
+    const auto children = effects->children();
+    for (QObject *child : children) {
+        if (qstrcmp(child->metaObject()->className(), "KWin::EffectLoader") == 0) {
+            QMetaObject::invokeMethod(child, "effectLoaded", Q_ARG(KWin::Effect *, effect), Q_ARG(QString, effectName));
+            break;
+        }
+    }
+    QVERIFY(static_cast<EffectsHandlerImpl *>(effects)->isEffectLoaded(effectName));
+
+    // several concurrent animations per window, long enough to outlive the benchmark
+    const int duration = 600000;
+    for (AbstractClient *client : clients) {
+        EffectWindow *window = client->effectWindow();
+        effect->animate(window, AnimationEffect::Opacity, 0, duration, FPx2(0.5));
+        effect->animate(window, AnimationEffect::Scale, 0, duration, FPx2(0.8));
+        effect->animate(window, AnimationEffect::Translation, 0, duration, FPx2(QPointF(20, 20)));
+    }
+    QVERIFY(effect->isActive());
+
+    paintFrames();
+}
+
+void CompositorBenchmarkTest::benchmarkRuleBookFind_data()
+{
+    QTest::addColumn<int>("ruleCount");
+
+    QTest::newRow("10 rules") << 10;
+    QTest::newRow("100 rules") << 100;
+    QTest::newRow("1000 rules") << 1000;
+}
+
+void CompositorBenchmarkTest::benchmarkRuleBookFind()
+{
+    QFETCH(int, ruleCount);
+
+    // only the last rule matches, so every lookup has to test all of them
+    m_rulesConfig->group("General").writeEntry("count", ruleCount);
+    for (int i = 1; i <= ruleCount; ++i) {
+        KConfigGroup group = m_rulesConfig->group(QString::number(i));
+        group.writeEntry("wmclass", i == ruleCount ? QStringLiteral("org.kde.benchmark0") : QStringLiteral("org.kde.rule%1").arg(i));
+        group.writeEntry("wmclasscomplete", false);
+        group.writeEntry("wmclassmatch", int(Rules::ExactMatch));
+        group.writeEntry("above", true);
+        group.writeEntry("aboverule", int(Rules::Force));
+    }
+    m_rulesConfig->sync();
+    workspace()->slotReconfigure();
+
+    QScopedPointer<QObject> testParent(new QObject);
+    const QList<AbstractClient *> clients = createWindows(1, false, testParent.data());
+    QCOMPARE(clients.count(), 1);
+    AbstractClient *client = clients.constFirst();
+    QVERIFY(client->keepAbove());
+
+    QBENCHMARK {
+        RuleBook::self()->find(client, false);
+    }
+}
+
+void CompositorBenchmarkTest::benchmarkFocusChain_data()
+{
+    QTest::addColumn<int>("windowCount");
+
+    QTest::newRow("10 windows") << 10;
+    QTest::newRow("50 windows") << 50;
+    QTest::newRow("100 windows") << 100;
+}
+
+void CompositorBenchmarkTest::benchmarkFocusChain()
+{
+    QFETCH(int, windowCount);
+
+    QScopedPointer<QObject> testParent(new QObject);
+    const QList<AbstractClient *> clients = createWindows(windowCount, false, testParent.data());
+    QCOMPARE(clients.count(), windowCount);
+
+    // what a full round of alt+tab does: every window is activated once, and the next
+    // window to activate is looked up after each step
+    FocusChain *focusChain = FocusChain::self();
+    VirtualDesktop *desktop = VirtualDesktopManager::self()->currentDesktop();
+    QBENCHMARK {
+        for (AbstractClient *client : clients) {
+            focusChain->update(client, FocusChain::MakeFirst);
+            focusChain->nextMostRecentlyUsed(client);
+            focusChain->getForActivation(desktop);
+        }
+    }
+}
+
+WAYLANDTEST_MAIN(CompositorBenchmarkTest)
+#include "compositor_benchmark_test.moc"
@@ -251,6 +251,7 @@ void ScriptedEffectsTest::testAnimations_data()
 
     QTest::newRow("single") << "animationTest" << 1;
     QTest::newRow("multi")  << "animationTestMulti" << 2;
+    QTest::newRow("template") << "animationTestTemplate" << 2;
 }
 
 void ScriptedEffectsTest::testAnimations()
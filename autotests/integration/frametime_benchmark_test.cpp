@@ -0,0 +1,362 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "kwin_wayland_test.h"
+
+#include "abstract_client.h"
+#include "abstract_output.h"
+#include "composite.h"
+#include "effectloader.h"
+#include "effects.h"
+#include "platform.h"
+#include "renderbackend.h"
+#include "renderloop.h"
+#include "virtualdesktops.h"
+#include "wayland_server.h"
+#include "workspace.h"
+
+#include <KWayland/Client/surface.h>
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTimer>
+
+#include <algorithm>
+#include <numeric>
+
+using namespace KWin;
+
+static const QString s_socketName = QStringLiteral("wayland_test_kwin_frametime_benchmark-0");
+
+/**
+ * The frame time benchmark runs scripted workloads against a number of synthetic clients and
+ * records the timings of every frame that is presented on the first output while the workload
+ * runs. It's meant to be run in CI to compare branches, the following environment variables
+ * control it:
+ *
+ * @li @c KWIN_BENCHMARK_CLIENTS The number of clients, 8 by default
+ * @li @c KWIN_BENCHMARK_DURATION How long every workload runs, in milliseconds, 3000 by default
+ * @li @c KWIN_BENCHMARK_REPORT The file to which a JSON report is written. If it's not set,
+ * only the average frame time is reported as the benchmark result of each workload.
+ */
+class FrameTimeBenchmarkTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Workload {
+        Idle,
+        WindowMoves,
+        TilingRelayouts,
+        DesktopSwitches,
+        OverviewToggles,
+    };
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+    void cleanup();
+
+    void benchmarkWorkload_data();
+    void benchmarkWorkload();
+
+private:
+    struct Client
+    {
+        KWayland::Client::Surface *surface;
+        AbstractClient *client;
+        QTimer *commitTimer;
+    };
+
+    bool createClients(int count, QObject *parent);
+    void collectFrames(RenderLoop *renderLoop);
+    void step(Workload workload, int index);
+
+    QVector<Client> m_clients;
+    QVector<RenderLoop::FrameTimings> m_frames;
+    quint64 m_lastSequence = 0;
+    QJsonArray m_report;
+};
+
+Q_DECLARE_METATYPE(FrameTimeBenchmarkTest::Workload)
+
+static int environmentValue(const char *name, int defaultValue)
+{
+    bool ok = false;
+    const int value = qEnvironmentVariableIntValue(name, &ok);
+    return ok && value > 0 ? value : defaultValue;
+}
+
+static QJsonObject summarize(QVector<std::chrono::nanoseconds> samples)
+{
+    if (samples.isEmpty()) {
+        return QJsonObject();
+    }
+    std::sort(samples.begin(), samples.end());
+
+    auto microseconds = [](std::chrono::nanoseconds duration) {
+        return double(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+    };
+    auto percentile = [&samples](qreal fraction) {
+        return samples[std::min<int>(samples.count() - 1, samples.count() * fraction)];
+    };
+    const std::chrono::nanoseconds total = std::accumulate(samples.cbegin(), samples.cend(), std::chrono::nanoseconds::zero());
+
+    return QJsonObject{
+        {QStringLiteral("samples"), samples.count()},
+        {QStringLiteral("mean"), microseconds(total / samples.count())},
+        {QStringLiteral("p50"), microseconds(percentile(0.5))},
+        {QStringLiteral("p90"), microseconds(percentile(0.9))},
+        {QStringLiteral("p99"), microseconds(percentile(0.99))},
+        {QStringLiteral("max"), microseconds(samples.last())},
+    };
+}
+
+void FrameTimeBenchmarkTest::initTestCase()
+{
+    qRegisterMetaType<KWin::AbstractClient *>();
+    QSignalSpy applicationStartedSpy(kwinApp(), &Application::started);
+    QVERIFY(applicationStartedSpy.isValid());
+    kwinApp()->platform()->setInitialWindowSize(QSize(1280, 1024));
+    QVERIFY(waylandServer()->init(s_socketName));
+
+    // effects are loaded by the workloads that need them
+    auto config = KSharedConfig::openConfig(QString(), KConfig::SimpleConfig);
+    KConfigGroup plugins(config, QStringLiteral("Plugins"));
+    const auto builtinNames = EffectLoader().listOfKnownEffects();
+    for (const QString &name : builtinNames) {
+        plugins.writeEntry(name + QStringLiteral("Enabled"), false);
+    }
+    config->sync();
+    kwinApp()->setConfig(config);
+
+    qputenv("KWIN_COMPOSE", QByteArrayLiteral("O2"));
+    qputenv("KWIN_EFFECTS_FORCE_ANIMATIONS", QByteArrayLiteral("1"));
+
+    kwinApp()->start();
+    QVERIFY(applicationStartedSpy.wait());
+    QVERIFY(Compositor::self());
+    QCOMPARE(Compositor::self()->backend()->compositingType(), KWin::OpenGLCompositing);
+    Test::initWaylandWorkspace();
+
+    VirtualDesktopManager::self()->setCount(2);
+}
+
+void FrameTimeBenchmarkTest::cleanupTestCase()
+{
+    const QString fileName = qEnvironmentVariable("KWIN_BENCHMARK_REPORT");
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    const QJsonObject report{
+        {QStringLiteral("compositingType"), QStringLiteral("OpenGL")},
+        {QStringLiteral("workloads"), m_report},
+    };
+    file.write(QJsonDocument(report).toJson());
+}
+
+void FrameTimeBenchmarkTest::init()
+{
+    QVERIFY(Test::setupWaylandConnection());
+    m_frames.clear();
+}
+
+void FrameTimeBenchmarkTest::cleanup()
+{
+    m_clients.clear();
+    Test::destroyWaylandConnection();
+
+    static_cast<EffectsHandlerImpl *>(effects)->unloadAllEffects();
+    VirtualDesktopManager::self()->setCurrent(1);
+}
+
+bool FrameTimeBenchmarkTest::createClients(int count, QObject *parent)
+{
+    // a mix of clients that commit like a video player, a game and a blinking cursor
+    static const int commitRates[] = {60, 30, 10, 0};
+    static const QColor colors[] = {Qt::red, Qt::green, Qt::blue, Qt::yellow};
+
+    const QRect area = kwinApp()->platform()->enabledOutputs().constFirst()->geometry();
+    for (int i = 0; i < count; ++i) {
+        auto surface = Test::createSurface(parent);
+        auto shellSurface = Test::createXdgToplevelSurface(surface, surface);
+        Q_UNUSED(shellSurface)
+
+        const QSize size(area.width() / 3, area.height() / 3);
+        const QColor color = colors[i % 4];
+        AbstractClient *client = Test::renderAndWaitForShown(surface, size, color);
+        if (!client) {
+            return false;
+        }
+        client->move(area.topLeft() + QPoint(i * 40 % (area.width() - size.width()), i * 30 % (area.height() - size.height())));
+
+        QTimer *commitTimer = nullptr;
+        if (const int rate = commitRates[i % 4]) {
+            commitTimer = new QTimer(surface);
+            commitTimer->setInterval(1000 / rate);
+            connect(commitTimer, &QTimer::timeout, surface, [surface, size, color]() {
+                Test::render(surface, size, color);
+            });
+        }
+        m_clients.append(Client{surface, client, commitTimer});
+    }
+    return true;
+}
+
+void FrameTimeBenchmarkTest::collectFrames(RenderLoop *renderLoop)
+{
+    // The frames are presented in order, the ones that haven't been presented yet will
+    // be picked up the next time. The newest frame is skipped, its gpu render time is
+    // only known once the next frame has been started.
+    const auto timings = renderLoop->frameTimings(16);
+    for (int i = 0; i < timings.count() - 1; ++i) {
+        const RenderLoop::FrameTimings &frame = timings[i];
+        if (frame.sequence <= m_lastSequence) {
+            continue;
+        }
+        if (frame.timestamp(RenderLoop::FrameStage::PageFlipped) == std::chrono::nanoseconds::zero()) {
+            break;
+        }
+        m_frames.append(frame);
+        m_lastSequence = frame.sequence;
+    }
+}
+
+void FrameTimeBenchmarkTest::step(Workload workload, int index)
+{
+    switch (workload) {
+    case Workload::Idle:
+        break;
+    case Workload::WindowMoves:
+        for (const Client &client : qAsConst(m_clients)) {
+            client.client->move(client.client->pos() + QPoint(index % 2 ? 5 : -5, 0));
+        }
+        break;
+    case Workload::TilingRelayouts: {
+        static const QuickTileMode modes[] = {
+            QuickTileFlag::Left,
+            QuickTileFlag::Right,
+            QuickTileFlag::Top | QuickTileFlag::Left,
+            QuickTileFlag::Bottom | QuickTileFlag::Right,
+            QuickTileFlag::None,
+        };
+        for (int i = 0; i < m_clients.count(); ++i) {
+            m_clients[i].client->setQuickTileMode(modes[(index + i) % 5], true);
+        }
+        break;
+    }
+    case Workload::DesktopSwitches:
+        VirtualDesktopManager::self()->setCurrent(index % 2 ? 2 : 1);
+        break;
+    case Workload::OverviewToggles:
+        QMetaObject::invokeMethod(static_cast<EffectsHandlerImpl *>(effects)->findEffect(QStringLiteral("overview")), "toggle");
+        break;
+    }
+}
+
+void FrameTimeBenchmarkTest::benchmarkWorkload_data()
+{
+    QTest::addColumn<Workload>("workload");
+    QTest::addColumn<QString>("effect");
+    QTest::addColumn<int>("interval");
+
+    QTest::newRow("idle") << Workload::Idle << QString() << 0;
+    QTest::newRow("window moves") << Workload::WindowMoves << QString() << 16;
+    QTest::newRow("tiling relayouts") << Workload::TilingRelayouts << QString() << 100;
+    QTest::newRow("desktop switches") << Workload::DesktopSwitches << QStringLiteral("slide") << 500;
+    QTest::newRow("overview toggles") << Workload::OverviewToggles << QStringLiteral("overview") << 700;
+}
+
+void FrameTimeBenchmarkTest::benchmarkWorkload()
+{
+    QFETCH(Workload, workload);
+    QFETCH(QString, effect);
+    QFETCH(int, interval);
+
+    if (!effect.isEmpty() && !static_cast<EffectsHandlerImpl *>(effects)->loadEffect(effect)) {
+        QSKIP("The effect used by the workload is not available");
+    }
+
+    const int clientCount = environmentValue("KWIN_BENCHMARK_CLIENTS", 8);
+    const int duration = environmentValue("KWIN_BENCHMARK_DURATION", 3000);
+
+    QScopedPointer<QObject> testParent(new QObject);
+    QVERIFY(createClients(clientCount, testParent.data()));
+
+    RenderLoop *renderLoop = kwinApp()->platform()->enabledOutputs().constFirst()->renderLoop();
+    QVERIFY(renderLoop);
+    m_lastSequence = renderLoop->frameTimings(1).isEmpty() ? 0 : renderLoop->frameTimings(1).constFirst().sequence;
+    QMetaObject::Connection presentedConnection = connect(renderLoop, &RenderLoop::framePresented, this, [this, renderLoop]() {
+        collectFrames(renderLoop);
+    });
+
+    for (const Client &client : qAsConst(m_clients)) {
+        if (client.commitTimer) {
+            client.commitTimer->start();
+        }
+    }
+
+    QTimer workloadTimer;
+    int stepCount = 0;
+    if (workload != Workload::Idle) {
+        connect(&workloadTimer, &QTimer::timeout, this, [this, workload, &stepCount]() {
+            step(workload, stepCount++);
+        });
+        workloadTimer.start(interval);
+    }
+
+    QTest::qWait(duration);
+
+    workloadTimer.stop();
+    disconnect(presentedConnection);
+    QVERIFY(!m_frames.isEmpty());
+
+    QVector<std::chrono::nanoseconds> cpuTimes;
+    QVector<std::chrono::nanoseconds> gpuTimes;
+    QVector<std::chrono::nanoseconds> presentIntervals;
+    std::chrono::nanoseconds previousPresentation = std::chrono::nanoseconds::zero();
+    for (const RenderLoop::FrameTimings &frame : qAsConst(m_frames)) {
+        const std::chrono::nanoseconds started = frame.timestamp(RenderLoop::FrameStage::Started);
+        const std::chrono::nanoseconds ended = frame.timestamp(RenderLoop::FrameStage::EndFrame);
+        if (started != std::chrono::nanoseconds::zero() && ended >= started) {
+            cpuTimes.append(ended - started);
+        }
+        if (frame.renderTime != std::chrono::nanoseconds::zero()) {
+            gpuTimes.append(frame.renderTime);
+        }
+        const std::chrono::nanoseconds presentation = frame.timestamp(RenderLoop::FrameStage::PageFlipped);
+        if (previousPresentation != std::chrono::nanoseconds::zero()) {
+            presentIntervals.append(presentation - previousPresentation);
+        }
+        previousPresentation = presentation;
+    }
+
+    m_report.append(QJsonObject{
+        {QStringLiteral("name"), QString::fromLatin1(QTest::currentDataTag())},
+        {QStringLiteral("clients"), clientCount},
+        {QStringLiteral("duration"), duration},
+        {QStringLiteral("frames"), m_frames.count()},
+        {QStringLiteral("cpuTime"), summarize(cpuTimes)},
+        {QStringLiteral("gpuTime"), summarize(gpuTimes)},
+        {QStringLiteral("presentInterval"), summarize(presentIntervals)},
+    });
+
+    // also hand the result to QTest, so -csv and -xml report something comparable
+    const std::chrono::nanoseconds totalCpuTime = std::accumulate(cpuTimes.cbegin(), cpuTimes.cend(), std::chrono::nanoseconds::zero());
+    QTest::setBenchmarkResult(std::chrono::duration<qreal, std::milli>(totalCpuTime).count() / std::max(1, cpuTimes.count()),
+                              QTest::WalltimeMilliseconds);
+}
+
+WAYLANDTEST_MAIN(FrameTimeBenchmarkTest)
+#include "frametime_benchmark_test.moc"
@@ -43,6 +43,8 @@ private Q_SLOTS:
     void initTestCase();
 
     void testPlaceSmart();
+    void benchmarkPlaceSmart_data();
+    void benchmarkPlaceSmart();
     void testPlaceZeroCornered();
     void testPlaceMaximized();
     void testPlaceMaximizedLeavesFullscreen();
@@ -154,6 +156,39 @@ void TestPlacement::testPlaceSmart()
     }
 }
 
+void TestPlacement::benchmarkPlaceSmart_data()
+{
+    QTest::addColumn<int>("windowCount");
+
+    QTest::newRow("10 windows") << 10;
+    QTest::newRow("40 windows") << 40;
+    QTest::newRow("100 windows") << 100;
+}
+
+void TestPlacement::benchmarkPlaceSmart()
+{
+    setPlacementPolicy(Placement::Smart);
+
+    QScopedPointer<QObject> testParent(new QObject);
+
+    // fill the output with small windows so that every placement has to scan many positions
+    QFETCH(int, windowCount);
+    for (int i = 0; i < windowCount; i++) {
+        createAndPlaceWindow(QSize(200, 150), testParent.data());
+    }
+
+    auto surface = Test::createSurface(testParent.data());
+    Test::createXdgToplevelSurface(surface, surface);
+    AbstractClient *client = Test::renderAndWaitForShown(surface, QSize(300, 200), Qt::red);
+    QVERIFY(client);
+
+    const QRect area = workspace()->clientArea(PlacementArea, client);
+    QBENCHMARK {
+        Placement::self()->place(client, area);
+    }
+    QVERIFY(area.contains(client->frameGeometry()));
+}
+
 void TestPlacement::testPlaceZeroCornered()
 {
     setPlacementPolicy(Placement::ZeroCornered);
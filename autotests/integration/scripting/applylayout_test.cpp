@@ -0,0 +1,151 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "kwin_wayland_test.h"
+
+#include "abstract_client.h"
+#include "platform.h"
+#include "scripting/scripting.h"
+#include "scripting/workspace_wrapper.h"
+#include "wayland_server.h"
+#include "workspace.h"
+
+#include <KWayland/Client/surface.h>
+
+namespace KWin
+{
+
+static const QString s_socketName = QStringLiteral("wayland_test_kwin_scripting_applylayout-0");
+
+class ApplyLayoutTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void testScript();
+    void testInvalidEntries();
+    void benchmarkApplyLayout();
+
+private:
+    struct Window {
+        QSharedPointer<KWayland::Client::Surface> surface;
+        QSharedPointer<Test::XdgToplevel> shellSurface;
+        AbstractClient *client = nullptr;
+    };
+    QVector<Window> createWindows(int count);
+};
+
+void ApplyLayoutTest::initTestCase()
+{
+    qRegisterMetaType<AbstractClient *>();
+
+    QSignalSpy applicationStartedSpy(kwinApp(), &Application::started);
+    QVERIFY(applicationStartedSpy.isValid());
+    kwinApp()->platform()->setInitialWindowSize(QSize(1280, 1024));
+    QVERIFY(waylandServer()->init(s_socketName));
+
+    kwinApp()->start();
+    QVERIFY(applicationStartedSpy.wait());
+    Test::initWaylandWorkspace();
+}
+
+void ApplyLayoutTest::init()
+{
+    QVERIFY(Test::setupWaylandConnection());
+}
+
+void ApplyLayoutTest::cleanup()
+{
+    Test::destroyWaylandConnection();
+}
+
+QVector<ApplyLayoutTest::Window> ApplyLayoutTest::createWindows(int count)
+{
+    QVector<Window> windows;
+    for (int i = 0; i < count; ++i) {
+        Window window;
+        window.surface.reset(Test::createSurface());
+        window.shellSurface.reset(Test::createXdgToplevelSurface(window.surface.data()));
+        window.client = Test::renderAndWaitForShown(window.surface.data(), QSize(100, 50), Qt::blue);
+        if (!window.client) {
+            return {};
+        }
+        windows.append(window);
+    }
+    return windows;
+}
+
+void ApplyLayoutTest::testScript()
+{
+    // This test verifies that a script can move and resize all windows with a single call.
+    const QVector<Window> windows = createWindows(3);
+    QCOMPARE(windows.count(), 3);
+
+    const QString scriptToLoad = QFINDTESTDATA("./scripts/applylayout.js");
+    QVERIFY(!scriptToLoad.isEmpty());
+    const int id = Scripting::self()->loadScript(scriptToLoad);
+    QVERIFY(id != -1);
+    AbstractScript *script = Scripting::self()->findScript(scriptToLoad);
+    QVERIFY(script);
+    QSignalSpy runningChangedSpy(script, &AbstractScript::runningChanged);
+    QVERIFY(runningChangedSpy.isValid());
+    script->run();
+    QTRY_COMPARE(runningChangedSpy.count(), 1);
+
+    const QList<AbstractClient *> clients = workspace()->allClientList();
+    for (int i = 0; i < clients.count(); ++i) {
+        QCOMPARE(clients[i]->moveResizeGeometry(), QRect(i * 100, 0, 100, 200));
+    }
+
+    QVERIFY(Scripting::self()->unloadScript(scriptToLoad));
+}
+
+void ApplyLayoutTest::testInvalidEntries()
+{
+    // This test verifies that entries without a client are skipped.
+    const QVector<Window> windows = createWindows(1);
+    QCOMPARE(windows.count(), 1);
+
+    const QVariantList layout{
+        QVariantMap{{QStringLiteral("geometry"), QRect(0, 0, 100, 100)}},
+        QVariantMap{{QStringLiteral("client"), QVariant::fromValue<QObject *>(windows[0].client)},
+                    {QStringLiteral("geometry"), QRect(10, 20, 300, 400)}},
+    };
+    QCOMPARE(Scripting::self()->workspaceWrapper()->applyLayout(layout), 1);
+    QCOMPARE(windows[0].client->moveResizeGeometry(), QRect(10, 20, 300, 400));
+}
+
+void ApplyLayoutTest::benchmarkApplyLayout()
+{
+    const QVector<Window> windows = createWindows(30);
+    QCOMPARE(windows.count(), 30);
+
+    QVariantList layouts[2];
+    for (int i = 0; i < windows.count(); ++i) {
+        QObject *client = windows[i].client;
+        layouts[0].append(QVariantMap{{QStringLiteral("client"), QVariant::fromValue(client)},
+                                      {QStringLiteral("geometry"), QRect((i % 6) * 200, (i / 6) * 200, 200, 200)}});
+        layouts[1].append(QVariantMap{{QStringLiteral("client"), QVariant::fromValue(client)},
+                                      {QStringLiteral("geometry"), QRect((i / 5) * 200, (i % 5) * 200, 200, 200)}});
+    }
+
+    int iteration = 0;
+    QBENCHMARK {
+        Scripting::self()->workspaceWrapper()->applyLayout(layouts[iteration++ % 2]);
+    }
+}
+
+}
+
+WAYLANDTEST_MAIN(KWin::ApplyLayoutTest)
+#include "applylayout_test.moc"
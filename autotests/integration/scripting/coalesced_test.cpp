@@ -0,0 +1,114 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "kwin_wayland_test.h"
+
+#include "abstract_client.h"
+#include "platform.h"
+#include "scripting/scripting.h"
+#include "wayland_server.h"
+#include "workspace.h"
+
+#include <KWayland/Client/surface.h>
+
+namespace KWin
+{
+
+static const QString s_socketName = QStringLiteral("wayland_test_kwin_scripting_coalesced-0");
+
+class CoalescedTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void testCoalesce();
+};
+
+void CoalescedTest::initTestCase()
+{
+    qRegisterMetaType<AbstractClient *>();
+
+    QSignalSpy applicationStartedSpy(kwinApp(), &Application::started);
+    QVERIFY(applicationStartedSpy.isValid());
+    kwinApp()->platform()->setInitialWindowSize(QSize(1280, 1024));
+    QVERIFY(waylandServer()->init(s_socketName));
+
+    kwinApp()->start();
+    QVERIFY(applicationStartedSpy.wait());
+    Test::initWaylandWorkspace();
+}
+
+void CoalescedTest::init()
+{
+    QVERIFY(Test::setupWaylandConnection());
+}
+
+void CoalescedTest::cleanup()
+{
+    Test::destroyWaylandConnection();
+}
+
+void CoalescedTest::testCoalesce()
+{
+    // This test verifies that several changes of a property in one event loop turn invoke
+    // the coalesced callback only once, with the latest value of the property.
+    QScopedPointer<KWayland::Client::Surface> surface(Test::createSurface());
+    QScopedPointer<Test::XdgToplevel> shellSurface(Test::createXdgToplevelSurface(surface.data()));
+    AbstractClient *client = Test::renderAndWaitForShown(surface.data(), QSize(100, 50), Qt::blue);
+    QVERIFY(client);
+    QVERIFY(client->isActive());
+    client->move(QPoint(0, 0));
+
+    const QString scriptToLoad = QFINDTESTDATA("./scripts/coalesced.js");
+    QVERIFY(!scriptToLoad.isEmpty());
+    const int id = Scripting::self()->loadScript(scriptToLoad);
+    QVERIFY(id != -1);
+    AbstractScript *script = Scripting::self()->findScript(scriptToLoad);
+    QVERIFY(script);
+    QSignalSpy runningChangedSpy(script, &AbstractScript::runningChanged);
+    QVERIFY(runningChangedSpy.isValid());
+    script->run();
+    QTRY_COMPARE(runningChangedSpy.count(), 1);
+
+    QSignalSpy frameGeometryChangedSpy(client, &AbstractClient::frameGeometryChanged);
+    QVERIFY(frameGeometryChangedSpy.isValid());
+    QSignalSpy opacityChangedSpy(client, &AbstractClient::opacityChanged);
+    QVERIFY(opacityChangedSpy.isValid());
+
+    client->move(QPoint(10, 0));
+    client->move(QPoint(20, 0));
+    client->move(QPoint(30, 0));
+    QCOMPARE(frameGeometryChangedSpy.count(), 3);
+    QCOMPARE(opacityChangedSpy.count(), 0);
+
+    QVERIFY(opacityChangedSpy.wait());
+    QCOMPARE(client->opacity(), 0.3);
+    QVERIFY(!opacityChangedSpy.wait(100));
+    QCOMPARE(opacityChangedSpy.count(), 1);
+
+    // A change after the callback has run is delivered again.
+    client->move(QPoint(40, 0));
+    QVERIFY(opacityChangedSpy.wait());
+    QCOMPARE(client->opacity(), 0.4);
+    QCOMPARE(opacityChangedSpy.count(), 2);
+
+    QVERIFY(Scripting::self()->unloadScript(scriptToLoad));
+
+    shellSurface.reset();
+    QVERIFY(Test::waitForWindowDestroyed(client));
+}
+
+}
+
+WAYLANDTEST_MAIN(KWin::CoalescedTest)
+#include "coalesced_test.moc"
@@ -0,0 +1,13 @@
+// Arranges all normal windows in columns of 100 pixels on the first desktop
+var layout = [];
+var clients = workspace.clientList().filter(function (client) {
+    return client.normalWindow;
+});
+for (var i = 0; i < clients.length; ++i) {
+    layout.push({
+        client: clients[i],
+        geometry: {x: i * 100, y: 0, width: 100, height: 200},
+        desktop: 1
+    });
+}
+workspace.applyLayout(layout);
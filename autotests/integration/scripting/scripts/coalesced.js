@@ -0,0 +1,5 @@
+// Mirrors the x position of the active window in its opacity, one percent per pixel
+var client = workspace.activeClient;
+connectCoalesced(client, "frameGeometry", function (geometry, client) {
+    client.opacity = geometry.x / 100;
+});
@@ -49,6 +49,7 @@ private Q_SLOTS:
     void testKeepAbove();
     void testKeepBelow();
 
+    void testCloseBeforeFirstFrame();
 };
 
 void StackingOrderTest::initTestCase()
@@ -893,5 +894,47 @@ void StackingOrderTest::testKeepBelow()
     QCOMPARE(workspace()->stackingOrder(), (QList<Toplevel *>{clientB, clientA}));
 }
 
+void StackingOrderTest::testCloseBeforeFirstFrame()
+{
+    // This test verifies that a window that is closed before it has been shown doesn't
+    // stay in the stacking order, no Deleted takes its place in that case.
+
+    QScopedPointer<xcb_connection_t, XcbConnectionDeleter> conn(
+        xcb_connect(nullptr, nullptr));
+
+    QSignalSpy windowCreatedSpy(workspace(), &Workspace::clientAdded);
+    QVERIFY(windowCreatedSpy.isValid());
+
+    // Map the window and destroy it right away, before Xwayland attaches a buffer.
+    xcb_window_t wid = createGroupWindow(conn.data(), QRect(0, 0, 128, 128));
+    xcb_map_window(conn.data(), wid);
+    xcb_flush(conn.data());
+
+    QVERIFY(windowCreatedSpy.wait());
+    X11Client *client = windowCreatedSpy.first().first().value<X11Client *>();
+    QVERIFY(client);
+    QVERIFY(workspace()->stackingOrder().contains(client));
+
+    QSignalSpy windowClosedSpy(client, &X11Client::windowClosed);
+    QVERIFY(windowClosedSpy.isValid());
+    const bool wasShown = client->readyForPainting();
+    xcb_destroy_window(conn.data(), wid);
+    xcb_flush(conn.data());
+    QVERIFY(windowClosedSpy.wait());
+
+    Deleted *deleted = windowClosedSpy.first().at(1).value<Deleted *>();
+    QCOMPARE(bool(deleted), wasShown);
+    QScopedPointer<Deleted, WindowUnrefDeleter> deletedClient(deleted);
+
+    // The client has been destroyed, only compare the pointer.
+    const QList<Toplevel *> stackingOrder = workspace()->stackingOrder();
+    QVERIFY(!stackingOrder.contains(client));
+    QCOMPARE(stackingOrder, deleted ? (QList<Toplevel *>{deleted}) : QList<Toplevel *>());
+
+    // Restacking must not touch the destroyed client.
+    workspace()->updateStackingOrder(true);
+    QVERIFY(!workspace()->stackingOrder().contains(client));
+}
+
 WAYLANDTEST_MAIN(StackingOrderTest)
 #include "stacking_order_test.moc"
@@ -0,0 +1,236 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "kwin_wayland_test.h"
+#include "abstract_client.h"
+#include "abstract_output.h"
+#include "cursor.h"
+#include "platform.h"
+#include "tilemanager.h"
+#include "virtualdesktops.h"
+#include "wayland_server.h"
+#include "workspace.h"
+
+#include <KWayland/Client/surface.h>
+
+namespace KWin
+{
+
+static const QString s_socketName = QStringLiteral("wayland_test_kwin_tiles-0");
+
+class TilesTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void testAssign();
+    void testRemove();
+    void testSendToDesktop();
+    void testSendToOutput();
+
+private:
+    AbstractClient *createTiledWindow(Tile *tile, QScopedPointer<KWayland::Client::Surface> &surface,
+                                      QScopedPointer<Test::XdgToplevel> &shellSurface);
+    bool waitForTileGeometry(AbstractClient *client, KWayland::Client::Surface *surface,
+                             Test::XdgToplevel *shellSurface, const QRect &geometry);
+};
+
+void TilesTest::initTestCase()
+{
+    qRegisterMetaType<KWin::AbstractClient *>();
+    QSignalSpy applicationStartedSpy(kwinApp(), &Application::started);
+    QVERIFY(applicationStartedSpy.isValid());
+    kwinApp()->platform()->setInitialWindowSize(QSize(1280, 1024));
+    QVERIFY(waylandServer()->init(s_socketName));
+    QMetaObject::invokeMethod(kwinApp()->platform(), "setVirtualOutputs", Qt::DirectConnection, Q_ARG(int, 2));
+
+    kwinApp()->setConfig(KSharedConfig::openConfig(QString(), KConfig::SimpleConfig));
+
+    kwinApp()->start();
+    QVERIFY(applicationStartedSpy.wait());
+    const auto outputs = kwinApp()->platform()->enabledOutputs();
+    QCOMPARE(outputs.count(), 2);
+    QCOMPARE(outputs[0]->geometry(), QRect(0, 0, 1280, 1024));
+    QCOMPARE(outputs[1]->geometry(), QRect(1280, 0, 1280, 1024));
+    Test::initWaylandWorkspace();
+
+    VirtualDesktopManager::self()->setCount(2);
+    QVERIFY(TileManager::self());
+}
+
+void TilesTest::init()
+{
+    QVERIFY(Test::setupWaylandConnection());
+
+    VirtualDesktopManager::self()->setCurrent(1);
+    workspace()->setActiveOutput(QPoint(640, 512));
+    KWin::Cursors::self()->mouse()->setPos(QPoint(640, 512));
+}
+
+void TilesTest::cleanup()
+{
+    Test::destroyWaylandConnection();
+}
+
+AbstractClient *TilesTest::createTiledWindow(Tile *tile, QScopedPointer<KWayland::Client::Surface> &surface,
+                                             QScopedPointer<Test::XdgToplevel> &shellSurface)
+{
+    surface.reset(Test::createSurface());
+    shellSurface.reset(Test::createXdgToplevelSurface(surface.data()));
+    AbstractClient *client = Test::renderAndWaitForShown(surface.data(), QSize(100, 50), Qt::blue);
+    if (!client) {
+        return nullptr;
+    }
+    tile->addWindow(client);
+    if (!waitForTileGeometry(client, surface.data(), shellSurface.data(), tile->geometry())) {
+        return nullptr;
+    }
+    return client;
+}
+
+bool TilesTest::waitForTileGeometry(AbstractClient *client, KWayland::Client::Surface *surface,
+                                    Test::XdgToplevel *shellSurface, const QRect &geometry)
+{
+    // The tile asks the window to resize, the frame geometry changes once it has done so.
+    QSignalSpy toplevelConfigureRequestedSpy(shellSurface, &Test::XdgToplevel::configureRequested);
+    QSignalSpy surfaceConfigureRequestedSpy(shellSurface->xdgSurface(), &Test::XdgSurface::configureRequested);
+    QSignalSpy frameGeometryChangedSpy(client, &AbstractClient::frameGeometryChanged);
+    while (toplevelConfigureRequestedSpy.isEmpty()
+           || toplevelConfigureRequestedSpy.last().at(0).toSize() != geometry.size()) {
+        if (!surfaceConfigureRequestedSpy.wait()) {
+            return false;
+        }
+    }
+    shellSurface->xdgSurface()->ack_configure(surfaceConfigureRequestedSpy.last().at(0).value<quint32>());
+    Test::render(surface, geometry.size(), Qt::red);
+    while (client->frameGeometry() != geometry) {
+        if (!frameGeometryChangedSpy.wait()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TilesTest::testAssign()
+{
+    // This test verifies that a window added to a tile takes the area of the tile.
+    const auto outputs = kwinApp()->platform()->enabledOutputs();
+    Tile *root = TileManager::self()->rootTile(outputs[0], VirtualDesktopManager::self()->currentDesktop());
+    QVERIFY(root);
+    QCOMPARE(root->geometry(), QRect(0, 0, 1280, 1024));
+
+    Tile *right = root->split(Qt::Horizontal);
+    QVERIFY(right);
+    QCOMPARE(root->childTiles().count(), 2);
+    QCOMPARE(right->geometry(), QRect(640, 0, 640, 1024));
+
+    QScopedPointer<KWayland::Client::Surface> surface;
+    QScopedPointer<Test::XdgToplevel> shellSurface;
+    AbstractClient *client = createTiledWindow(right, surface, shellSurface);
+    QVERIFY(client);
+    QCOMPARE(TileManager::self()->tileForWindow(client), right);
+    QCOMPARE(right->windows(), QList<AbstractClient *>{client});
+    QCOMPARE(client->frameGeometry(), QRect(640, 0, 640, 1024));
+
+    right->removeWindow(client);
+    QVERIFY(!TileManager::self()->tileForWindow(client));
+    QVERIFY(right->windows().isEmpty());
+
+    right->remove();
+    QVERIFY(root->childTiles().isEmpty());
+
+    shellSurface.reset();
+    QVERIFY(Test::waitForWindowDestroyed(client));
+}
+
+void TilesTest::testRemove()
+{
+    // This test verifies that the windows of a removed tile move to its sibling.
+    const auto outputs = kwinApp()->platform()->enabledOutputs();
+    Tile *root = TileManager::self()->rootTile(outputs[0], VirtualDesktopManager::self()->currentDesktop());
+    QVERIFY(root);
+    QVERIFY(root->childTiles().isEmpty());
+
+    Tile *right = root->split(Qt::Horizontal);
+    QVERIFY(right);
+
+    QScopedPointer<KWayland::Client::Surface> surface;
+    QScopedPointer<Test::XdgToplevel> shellSurface;
+    AbstractClient *client = createTiledWindow(right, surface, shellSurface);
+    QVERIFY(client);
+    QCOMPARE(client->frameGeometry(), QRect(640, 0, 640, 1024));
+
+    // The split collapses, so the root tile takes the window and its whole area.
+    right->remove();
+    QVERIFY(root->childTiles().isEmpty());
+    QCOMPARE(TileManager::self()->tileForWindow(client), root);
+    QCOMPARE(root->windows(), QList<AbstractClient *>{client});
+    QVERIFY(waitForTileGeometry(client, surface.data(), shellSurface.data(), QRect(0, 0, 1280, 1024)));
+
+    shellSurface.reset();
+    QVERIFY(Test::waitForWindowDestroyed(client));
+    QVERIFY(root->windows().isEmpty());
+}
+
+void TilesTest::testSendToDesktop()
+{
+    // This test verifies that a window sent to a desktop its tile isn't on leaves the tile.
+    const auto outputs = kwinApp()->platform()->enabledOutputs();
+    const auto desktops = VirtualDesktopManager::self()->desktops();
+    QCOMPARE(desktops.count(), 2);
+    Tile *root = TileManager::self()->rootTile(outputs[0], desktops[0]);
+    QVERIFY(root);
+
+    QScopedPointer<KWayland::Client::Surface> surface;
+    QScopedPointer<Test::XdgToplevel> shellSurface;
+    AbstractClient *client = createTiledWindow(root, surface, shellSurface);
+    QVERIFY(client);
+    QCOMPARE(TileManager::self()->tileForWindow(client), root);
+
+    // Still being on the desktop of the tile keeps the window in it.
+    client->enterDesktop(desktops[1]);
+    QCOMPARE(TileManager::self()->tileForWindow(client), root);
+
+    client->setDesktops({desktops[1]});
+    QVERIFY(!TileManager::self()->tileForWindow(client));
+    QVERIFY(root->windows().isEmpty());
+
+    shellSurface.reset();
+    QVERIFY(Test::waitForWindowDestroyed(client));
+}
+
+void TilesTest::testSendToOutput()
+{
+    // This test verifies that a window sent to another output leaves its tile.
+    const auto outputs = kwinApp()->platform()->enabledOutputs();
+    Tile *root = TileManager::self()->rootTile(outputs[0], VirtualDesktopManager::self()->currentDesktop());
+    QVERIFY(root);
+
+    QScopedPointer<KWayland::Client::Surface> surface;
+    QScopedPointer<Test::XdgToplevel> shellSurface;
+    AbstractClient *client = createTiledWindow(root, surface, shellSurface);
+    QVERIFY(client);
+    QCOMPARE(client->output(), outputs[0]);
+    QCOMPARE(TileManager::self()->tileForWindow(client), root);
+
+    client->sendToOutput(outputs[1]);
+    QCOMPARE(client->output(), outputs[1]);
+    QVERIFY(!TileManager::self()->tileForWindow(client));
+    QVERIFY(root->windows().isEmpty());
+
+    shellSurface.reset();
+    QVERIFY(Test::waitForWindowDestroyed(client));
+}
+
+}
+
+WAYLANDTEST_MAIN(KWin::TilesTest)
+#include "tiles_test.moc"
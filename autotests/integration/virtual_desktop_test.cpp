@@ -14,9 +14,12 @@
 #include "virtualdesktops.h"
 #include "wayland_server.h"
 #include "workspace.h"
+#include "x11client.h"
 
 #include <KWayland/Client/surface.h>
 
+#include <xcb/xcb_icccm.h>
+
 using namespace KWin;
 using namespace KWayland::Client;
 
@@ -34,6 +37,7 @@ private Q_SLOTS:
     void testLastDesktopRemoved();
     void testWindowOnMultipleDesktops();
     void testRemoveDesktopWithWindow();
+    void benchmarkSwitchDesktop();
 };
 
 void VirtualDesktopTest::initTestCase()
@@ -284,5 +288,76 @@ void VirtualDesktopTest::testRemoveDesktopWithWindow()
     QCOMPARE(VirtualDesktopManager::self()->desktops()[1], client->desktops()[0]);
 }
 
+struct XcbConnectionDeleter
+{
+    static inline void cleanup(xcb_connection_t *pointer)
+    {
+        xcb_disconnect(pointer);
+    }
+};
+
+void VirtualDesktopTest::benchmarkSwitchDesktop()
+{
+    // spread a few windows over nine desktops and measure switching between them
+    VirtualDesktopManager::self()->setCount(9);
+    QCOMPARE(VirtualDesktopManager::self()->count(), 9u);
+    const QVector<VirtualDesktop *> desktops = VirtualDesktopManager::self()->desktops();
+
+    std::vector<std::unique_ptr<KWayland::Client::Surface>> surfaces;
+    std::vector<std::unique_ptr<Test::XdgToplevel>> shellSurfaces;
+    for (int i = 0; i < 27; ++i) {
+        surfaces.emplace_back(Test::createSurface());
+        shellSurfaces.emplace_back(Test::createXdgToplevelSurface(surfaces.back().get()));
+        auto client = Test::renderAndWaitForShown(surfaces.back().get(), QSize(100, 50), Qt::blue);
+        QVERIFY(client);
+        client->setDesktops({desktops.at(i % desktops.count())});
+    }
+
+    // the X server is grabbed while switching, so also have X11 windows to show and hide
+    QScopedPointer<xcb_connection_t, XcbConnectionDeleter> c(xcb_connect(nullptr, nullptr));
+    QVERIFY(!xcb_connection_has_error(c.data()));
+    QSignalSpy windowCreatedSpy(workspace(), &Workspace::clientAdded);
+    QVERIFY(windowCreatedSpy.isValid());
+    QVector<X11Client *> x11Clients;
+    for (int i = 0; i < 27; ++i) {
+        const QRect windowGeometry(0, 0, 100, 50);
+        xcb_window_t w = xcb_generate_id(c.data());
+        xcb_create_window(c.data(), XCB_COPY_FROM_PARENT, w, rootWindow(),
+                          windowGeometry.x(),
+                          windowGeometry.y(),
+                          windowGeometry.width(),
+                          windowGeometry.height(),
+                          0, XCB_WINDOW_CLASS_INPUT_OUTPUT, XCB_COPY_FROM_PARENT, 0, nullptr);
+        xcb_size_hints_t hints;
+        memset(&hints, 0, sizeof(hints));
+        xcb_icccm_size_hints_set_position(&hints, 1, windowGeometry.x(), windowGeometry.y());
+        xcb_icccm_size_hints_set_size(&hints, 1, windowGeometry.width(), windowGeometry.height());
+        xcb_icccm_set_wm_normal_hints(c.data(), w, &hints);
+        xcb_map_window(c.data(), w);
+        xcb_flush(c.data());
+
+        QVERIFY(windowCreatedSpy.wait());
+        X11Client *client = windowCreatedSpy.takeFirst().first().value<X11Client *>();
+        QVERIFY(client);
+        QCOMPARE(client->window(), w);
+        client->setDesktops({desktops.at(i % desktops.count())});
+        x11Clients.append(client);
+    }
+
+    int current = 0;
+    QBENCHMARK {
+        current = (current + 1) % desktops.count();
+        VirtualDesktopManager::self()->setCurrent(desktops.at(current));
+    }
+    QCOMPARE(VirtualDesktopManager::self()->currentDesktop(), desktops.at(current));
+
+    for (X11Client *client : qAsConst(x11Clients)) {
+        xcb_unmap_window(c.data(), client->window());
+        xcb_destroy_window(c.data(), client->window());
+    }
+    xcb_flush(c.data());
+    c.reset();
+}
+
 WAYLANDTEST_MAIN(VirtualDesktopTest)
 #include "virtual_desktop_test.moc"
@@ -40,6 +40,7 @@ private Q_SLOTS:
     void testStrictRedirectTargetMode();
     void testRelaxedRedirectTargetMode_data();
     void testRelaxedRedirectTargetMode();
+    void testSetEasingCurve();
 };
 
 void TimeLineTest::testUpdateForward()
@@ -398,6 +399,22 @@ void TimeLineTest::testRelaxedRedirectTargetMode()
     QVERIFY(timeLine.done());
 }
 
+void TimeLineTest::testSetEasingCurve()
+{
+    KWin::TimeLine timeLine(1000ms, KWin::TimeLine::Forward);
+    timeLine.setEasingCurve(QEasingCurve::Linear);
+
+    timeLine.update(500ms);
+    QCOMPARE(timeLine.value(), 0.5);
+
+    // the value must follow the new curve, not stay at the linear one
+    timeLine.setEasingCurve(QEasingCurve::InQuad);
+    QCOMPARE(timeLine.value(), 0.25);
+
+    timeLine.setEasingCurve(QEasingCurve(QEasingCurve::OutQuad));
+    QCOMPARE(timeLine.value(), 0.75);
+}
+
 QTEST_MAIN(TimeLineTest)
 
 #include "timelinetest.moc"
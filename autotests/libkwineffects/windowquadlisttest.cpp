@@ -7,6 +7,7 @@
     SPDX-License-Identifier: GPL-2.0-or-later
 */
 #include <kwineffects.h>
+#include <QMatrix4x4>
 #include <QTest>
 
 Q_DECLARE_METATYPE(KWin::WindowQuadList)
@@ -19,6 +20,13 @@ private Q_SLOTS:
     void testMakeGrid();
     void testMakeRegularGrid_data();
     void testMakeRegularGrid();
+    void testMakeInterleavedArrays_data();
+    void testMakeInterleavedArrays();
+    void benchmarkMakeGrid_data();
+    void benchmarkMakeGrid();
+    void benchmarkMakeRegularGrid_data();
+    void benchmarkMakeRegularGrid();
+    void benchmarkMakeInterleavedArrays();
 
 private:
     KWin::WindowQuad makeQuad(const QRectF &rect);
@@ -197,6 +205,123 @@ void WindowQuadListTest::testMakeRegularGrid()
     }
 }
 
+void WindowQuadListTest::testMakeInterleavedArrays_data()
+{
+    QTest::addColumn<uint>("type");
+    QTest::addColumn<QVector<int>>("order");
+
+    // GL_QUADS and GL_TRIANGLES
+    QTest::newRow("quads") << 0x0007u << QVector<int>{0, 1, 2, 3};
+    QTest::newRow("triangles") << 0x0004u << QVector<int>{1, 0, 3, 3, 2, 1};
+}
+
+void WindowQuadListTest::testMakeInterleavedArrays()
+{
+    QFETCH(uint, type);
+    QFETCH(QVector<int>, order);
+
+    KWin::WindowQuadList quads;
+    quads.append(makeQuad(QRectF(0, 0, 10, 20)));
+    quads.append(makeQuad(QRectF(10.5, 20.25, 30, 40)));
+
+    QMatrix4x4 textureMatrix;
+    textureMatrix.translate(0.5, 0.25);
+    textureMatrix.scale(0.01, 0.02);
+
+    const QVector2D translation(100, 200);
+
+    // Run on both an aligned and an unaligned buffer to cover the vectorized and the scalar path.
+    alignas(16) KWin::GLVertex2D storage[2 * 6 + 1];
+    for (KWin::GLVertex2D *vertices : {storage, reinterpret_cast<KWin::GLVertex2D *>(reinterpret_cast<char *>(storage + 1) - 8)}) {
+        quads.makeInterleavedArrays(type, vertices, textureMatrix, translation);
+
+        for (int i = 0; i < quads.count(); ++i) {
+            for (int j = 0; j < order.count(); ++j) {
+                const KWin::WindowVertex &expected = quads[i][order[j]];
+                const KWin::GLVertex2D &actual = vertices[i * order.count() + j];
+                QCOMPARE(actual.position, QVector2D(expected.x(), expected.y()) + translation);
+                QCOMPARE(actual.texcoord, QVector2D(expected.u() * 0.01 + 0.5, expected.v() * 0.02 + 0.25));
+            }
+        }
+    }
+}
+
+void WindowQuadListTest::benchmarkMakeGrid_data()
+{
+    QTest::addColumn<int>("windowCount");
+    QTest::addColumn<int>("quadSize");
+
+    // One quad list per window, the way the wobbly windows and magic lamp effects
+    // subdivide every window they animate in each frame.
+    QTest::newRow("1 window, 100px") << 1 << 100;
+    QTest::newRow("1 window, 20px") << 1 << 20;
+    QTest::newRow("20 windows, 100px") << 20 << 100;
+    QTest::newRow("20 windows, 20px") << 20 << 20;
+}
+
+void WindowQuadListTest::benchmarkMakeGrid()
+{
+    QFETCH(int, windowCount);
+    QFETCH(int, quadSize);
+
+    QVector<KWin::WindowQuadList> windows(windowCount);
+    for (KWin::WindowQuadList &quads : windows) {
+        // the decoration and the contents of an 800x600 window
+        quads.append(makeQuad(QRectF(0, 0, 800, 30)));
+        quads.append(makeQuad(QRectF(0, 30, 800, 570)));
+    }
+
+    QBENCHMARK {
+        for (const KWin::WindowQuadList &quads : qAsConst(windows)) {
+            quads.makeGrid(quadSize);
+        }
+    }
+}
+
+void WindowQuadListTest::benchmarkMakeRegularGrid_data()
+{
+    QTest::addColumn<int>("windowCount");
+    QTest::addColumn<int>("subdivisions");
+
+    QTest::newRow("1 window, 4x4") << 1 << 4;
+    QTest::newRow("1 window, 32x32") << 1 << 32;
+    QTest::newRow("20 windows, 4x4") << 20 << 4;
+    QTest::newRow("20 windows, 32x32") << 20 << 32;
+}
+
+void WindowQuadListTest::benchmarkMakeRegularGrid()
+{
+    QFETCH(int, windowCount);
+    QFETCH(int, subdivisions);
+
+    QVector<KWin::WindowQuadList> windows(windowCount);
+    for (KWin::WindowQuadList &quads : windows) {
+        quads.append(makeQuad(QRectF(0, 0, 800, 30)));
+        quads.append(makeQuad(QRectF(0, 30, 800, 570)));
+    }
+
+    QBENCHMARK {
+        for (const KWin::WindowQuadList &quads : qAsConst(windows)) {
+            quads.makeRegularGrid(subdivisions, subdivisions);
+        }
+    }
+}
+
+void WindowQuadListTest::benchmarkMakeInterleavedArrays()
+{
+    // A fine grid like the one of the wobbly windows effect.
+    KWin::WindowQuadList quads;
+    quads.append(makeQuad(QRectF(0, 0, 1920, 1080)));
+    quads = quads.makeGrid(8);
+
+    QVector<KWin::GLVertex2D> vertices(quads.count() * 6);
+    const QMatrix4x4 textureMatrix;
+
+    QBENCHMARK {
+        quads.makeInterleavedArrays(0x0004, vertices.data(), textureMatrix);
+    }
+}
+
 QTEST_MAIN(WindowQuadListTest)
 
 #include "windowquadlisttest.moc"
@@ -79,5 +79,45 @@ void TestTabBoxClientModel::testCreateClientListActiveClientNotInFocusChain()
     QCOMPARE(clientModel->rowCount(), 1);
 }
 
+void TestTabBoxClientModel::testCreateClientListIncremental()
+{
+    MockTabBoxHandler tabboxhandler;
+    tabboxhandler.setConfig(TabBox::TabBoxConfig());
+    TabBox::ClientModel *clientModel = new TabBox::ClientModel(&tabboxhandler);
+    tabboxhandler.createMockWindow(QString("test"));
+    tabboxhandler.createMockWindow(QString("test2"));
+    clientModel->createClientList();
+    QCOMPARE(clientModel->rowCount(), 2);
+
+    QSignalSpy resetSpy(clientModel, &QAbstractItemModel::modelReset);
+    QSignalSpy insertedSpy(clientModel, &QAbstractItemModel::rowsInserted);
+    QSignalSpy removedSpy(clientModel, &QAbstractItemModel::rowsRemoved);
+    QSignalSpy movedSpy(clientModel, &QAbstractItemModel::rowsMoved);
+
+    // nothing changed, so the model should not change either
+    clientModel->createClientList();
+    QCOMPARE(clientModel->rowCount(), 2);
+    QCOMPARE(resetSpy.count(), 0);
+    QCOMPARE(insertedSpy.count(), 0);
+    QCOMPARE(removedSpy.count(), 0);
+    QCOMPARE(movedSpy.count(), 0);
+
+    // a new window only inserts a row
+    QWeakPointer<TabBox::TabBoxClient> client = tabboxhandler.createMockWindow(QString("test3"));
+    clientModel->createClientList();
+    QCOMPARE(clientModel->rowCount(), 3);
+    QCOMPARE(resetSpy.count(), 0);
+    QCOMPARE(insertedSpy.count(), 1);
+    QCOMPARE(removedSpy.count(), 0);
+
+    // and closing it only removes a row
+    QSharedPointer<TabBox::TabBoxClient> clientOwner = client.toStrongRef();
+    tabboxhandler.closeWindow(clientOwner.data());
+    clientModel->createClientList();
+    QCOMPARE(clientModel->rowCount(), 2);
+    QCOMPARE(resetSpy.count(), 0);
+    QCOMPARE(removedSpy.count(), 1);
+}
+
 Q_CONSTRUCTOR_FUNCTION(forceXcb)
 QTEST_MAIN(TestTabBoxClientModel)
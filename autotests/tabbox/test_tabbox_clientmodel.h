@@ -37,6 +37,11 @@ private Q_SLOTS:
      * See BUG: 306260
      */
     void testCreateClientListActiveClientNotInFocusChain();
+    /**
+     * Tests that recreating the Client list updates the model
+     * incrementally instead of resetting it.
+     */
+    void testCreateClientListIncremental();
 };
 
 #endif
@@ -0,0 +1,108 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QObject>
+#include <QTest>
+
+#include "renderloop.h"
+#include "renderloop_p.h"
+
+using namespace KWin;
+using namespace std::chrono_literals;
+
+class TestAdaptiveLatency : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void fixedPolicy();
+    void missedFrame();
+    void recovery();
+};
+
+static std::chrono::nanoseconds s_timestamp = 1s;
+
+// Renders a frame that is expected to be presented after one vblank and presents it
+// @a delay later than expected.
+static void presentFrame(RenderLoop *loop, std::chrono::nanoseconds delay)
+{
+    RenderLoopPrivate *d = RenderLoopPrivate::get(loop);
+    const std::chrono::nanoseconds vblankInterval(1'000'000'000'000ull / loop->refreshRate());
+
+    d->nextPresentationTimestamp = s_timestamp + vblankInterval;
+    loop->beginFrame();
+    s_timestamp = d->nextPresentationTimestamp + delay;
+    d->notifyFrameCompleted(s_timestamp);
+}
+
+void TestAdaptiveLatency::fixedPolicy()
+{
+    RenderLoop loop;
+    RenderLoopPrivate *d = RenderLoopPrivate::get(&loop);
+    d->configuredLatencyPolicy = LatencyLow;
+
+    presentFrame(&loop, 20ms);
+    QCOMPARE(d->latencyPolicy(), LatencyLow);
+    QCOMPARE(d->safetyMargin(), 3ms);
+    QCOMPARE(d->missedFrameCount, 0);
+}
+
+void TestAdaptiveLatency::missedFrame()
+{
+    RenderLoop loop;
+    RenderLoopPrivate *d = RenderLoopPrivate::get(&loop);
+    d->configuredLatencyPolicy = LatencyAdaptive;
+    QCOMPARE(d->latencyPolicy(), LatencyMedium);
+    QCOMPARE(d->safetyMargin(), 3ms);
+
+    // A frame that is a bit late but still hits its vblank isn't a miss.
+    presentFrame(&loop, 1ms);
+    QCOMPARE(d->missedFrameCount, 0);
+
+    presentFrame(&loop, 16ms);
+    QCOMPARE(d->missedFrameCount, 1);
+    QCOMPARE(d->latencyPolicy(), LatencyHigh);
+    QCOMPARE(d->safetyMargin(), 3500us);
+
+    presentFrame(&loop, 16ms);
+    presentFrame(&loop, 16ms);
+    presentFrame(&loop, 16ms);
+    QCOMPARE(d->missedFrameCount, 4);
+    QCOMPARE(d->latencyPolicy(), LatencyExtremelyHigh);
+    QCOMPARE(d->safetyMargin(), 4ms);
+}
+
+void TestAdaptiveLatency::recovery()
+{
+    RenderLoop loop;
+    loop.setRefreshRate(60000);
+    RenderLoopPrivate *d = RenderLoopPrivate::get(&loop);
+    d->configuredLatencyPolicy = LatencyAdaptive;
+
+    // Two seconds worth of frames that hit their deadline shrink the safety margin.
+    for (int i = 0; i < 120; ++i) {
+        presentFrame(&loop, 0ns);
+    }
+    QCOMPARE(d->safetyMargin(), 2500us);
+    QCOMPARE(d->latencyPolicy(), LatencyMedium);
+
+    // Once the safety margin is at its minimum, the render time budget is lowered.
+    for (int i = 0; i < 120 * 4; ++i) {
+        presentFrame(&loop, 0ns);
+    }
+    QCOMPARE(d->safetyMargin(), 500us);
+    QCOMPARE(d->latencyPolicy(), LatencyMedium);
+
+    for (int i = 0; i < 120; ++i) {
+        presentFrame(&loop, 0ns);
+    }
+    QCOMPARE(d->latencyPolicy(), LatencyLow);
+}
+
+QTEST_GUILESS_MAIN(TestAdaptiveLatency)
+#include "test_adaptive_latency.moc"
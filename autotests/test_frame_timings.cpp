@@ -0,0 +1,235 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QObject>
+#include <QTest>
+
+#include "renderloop.h"
+#include "renderloop_p.h"
+
+using namespace KWin;
+
+class TestFrameTimings : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void empty();
+    void stages();
+    void skippedFrame();
+    void pageFlipOrder();
+    void wrapAround();
+    void renderTime();
+    void inputLatency();
+    void staleInputEvent();
+};
+
+static void presentFrame(RenderLoop *loop)
+{
+    RenderLoopPrivate::get(loop)->notifyFrameCompleted(std::chrono::steady_clock::now().time_since_epoch());
+}
+
+static std::chrono::microseconds currentTime()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch());
+}
+
+static std::chrono::nanoseconds milliseconds(int count)
+{
+    return std::chrono::milliseconds(count);
+}
+
+static void presentFrameWithInput(RenderLoop *loop, std::chrono::microseconds inputTimestamp, std::chrono::milliseconds latency)
+{
+    loop->recordFrameStage(RenderLoop::FrameStage::Started);
+    loop->addInputEvent(inputTimestamp);
+    loop->beginFrame();
+    RenderLoopPrivate::get(loop)->notifyFrameCompleted(inputTimestamp + latency);
+}
+
+void TestFrameTimings::empty()
+{
+    RenderLoop loop;
+    QVERIFY(loop.frameTimings(10).isEmpty());
+}
+
+void TestFrameTimings::stages()
+{
+    RenderLoop loop;
+    loop.recordFrameStage(RenderLoop::FrameStage::Started);
+    loop.recordFrameStage(RenderLoop::FrameStage::WindowsToRender);
+    loop.beginFrame();
+    loop.recordFrameStage(RenderLoop::FrameStage::PrePaintScreen);
+    loop.recordFrameStage(RenderLoop::FrameStage::Prepass);
+    loop.recordFrameStage(RenderLoop::FrameStage::Submission);
+    loop.endFrame();
+    loop.recordFrameStage(RenderLoop::FrameStage::EndFrame);
+
+    QVector<RenderLoop::FrameTimings> timings = loop.frameTimings(10);
+    QCOMPARE(timings.count(), 1);
+    QCOMPARE(timings[0].sequence, quint64(1));
+    QCOMPARE(timings[0].timestamp(RenderLoop::FrameStage::PageFlipped), std::chrono::nanoseconds::zero());
+
+    presentFrame(&loop);
+
+    timings = loop.frameTimings(10);
+    QCOMPARE(timings.count(), 1);
+    for (int i = 1; i < RenderLoop::FrameStageCount; ++i) {
+        QVERIFY(timings[0].timestamps[i] >= timings[0].timestamps[i - 1]);
+    }
+    QVERIFY(timings[0].timestamp(RenderLoop::FrameStage::PageFlipped) != std::chrono::nanoseconds::zero());
+}
+
+void TestFrameTimings::skippedFrame()
+{
+    RenderLoop loop;
+
+    // A compositing cycle that doesn't call beginFrame() doesn't produce a record.
+    loop.recordFrameStage(RenderLoop::FrameStage::Started);
+    loop.recordFrameStage(RenderLoop::FrameStage::WindowsToRender);
+    QVERIFY(loop.frameTimings(10).isEmpty());
+
+    loop.recordFrameStage(RenderLoop::FrameStage::Started);
+    loop.beginFrame();
+    const QVector<RenderLoop::FrameTimings> timings = loop.frameTimings(10);
+    QCOMPARE(timings.count(), 1);
+    QCOMPARE(timings[0].timestamp(RenderLoop::FrameStage::WindowsToRender), std::chrono::nanoseconds::zero());
+}
+
+void TestFrameTimings::pageFlipOrder()
+{
+    RenderLoop loop;
+
+    // Two frames are in flight, the first page flip belongs to the oldest frame.
+    for (int i = 0; i < 2; ++i) {
+        loop.recordFrameStage(RenderLoop::FrameStage::Started);
+        loop.beginFrame();
+        loop.recordFrameStage(RenderLoop::FrameStage::EndFrame);
+    }
+
+    presentFrame(&loop);
+    QVector<RenderLoop::FrameTimings> timings = loop.frameTimings(2);
+    QVERIFY(timings[0].timestamp(RenderLoop::FrameStage::PageFlipped) != std::chrono::nanoseconds::zero());
+    QCOMPARE(timings[1].timestamp(RenderLoop::FrameStage::PageFlipped), std::chrono::nanoseconds::zero());
+
+    presentFrame(&loop);
+    timings = loop.frameTimings(2);
+    QVERIFY(timings[1].timestamp(RenderLoop::FrameStage::PageFlipped) != std::chrono::nanoseconds::zero());
+}
+
+void TestFrameTimings::wrapAround()
+{
+    RenderLoop loop;
+
+    const int frameCount = RenderLoopPrivate::frameLogSize + 10;
+    for (int i = 0; i < frameCount; ++i) {
+        loop.recordFrameStage(RenderLoop::FrameStage::Started);
+        loop.beginFrame();
+        presentFrame(&loop);
+    }
+
+    const QVector<RenderLoop::FrameTimings> timings = loop.frameTimings(frameCount);
+    QCOMPARE(timings.count(), RenderLoopPrivate::frameLogSize);
+    QCOMPARE(timings.first().sequence, quint64(frameCount - RenderLoopPrivate::frameLogSize + 1));
+    QCOMPARE(timings.last().sequence, quint64(frameCount));
+
+    const QVector<RenderLoop::FrameTimings> latest = loop.frameTimings(3);
+    QCOMPARE(latest.count(), 3);
+    QCOMPARE(latest.last().sequence, quint64(frameCount));
+}
+
+void TestFrameTimings::renderTime()
+{
+    RenderLoop loop;
+
+    // The render time of a frame can arrive a few frames late, e.g. after direct scanout.
+    for (int i = 0; i < 3; ++i) {
+        loop.recordFrameStage(RenderLoop::FrameStage::Started);
+        loop.beginFrame();
+    }
+    QCOMPARE(loop.frameSequence(), quint64(3));
+    loop.addRenderTime(std::chrono::milliseconds(5), 1);
+
+    QVector<RenderLoop::FrameTimings> timings = loop.frameTimings(3);
+    QCOMPARE(timings[0].renderTime, milliseconds(5));
+    QCOMPARE(timings[1].renderTime, std::chrono::nanoseconds::zero());
+    QCOMPARE(timings[2].renderTime, std::chrono::nanoseconds::zero());
+
+    // Frames that have dropped out of the frame log are ignored.
+    for (int i = 0; i < RenderLoopPrivate::frameLogSize; ++i) {
+        loop.recordFrameStage(RenderLoop::FrameStage::Started);
+        loop.beginFrame();
+    }
+    loop.addRenderTime(std::chrono::milliseconds(5), 2);
+    timings = loop.frameTimings(RenderLoopPrivate::frameLogSize);
+    for (const RenderLoop::FrameTimings &frame : qAsConst(timings)) {
+        QCOMPARE(frame.renderTime, std::chrono::nanoseconds::zero());
+    }
+}
+
+void TestFrameTimings::inputLatency()
+{
+    RenderLoop loop;
+
+    const std::chrono::microseconds timestamp = currentTime();
+    presentFrameWithInput(&loop, timestamp, std::chrono::milliseconds(8));
+
+    RenderLoop::InputLatency latency = loop.inputLatency();
+    QCOMPARE(latency.count, quint64(1));
+    QCOMPARE(latency.minimum, milliseconds(8));
+    QCOMPARE(latency.maximum, milliseconds(8));
+    QCOMPARE(latency.last, milliseconds(8));
+    QCOMPARE(latency.smoothed, milliseconds(8));
+    QCOMPARE(latency.histogram[8], quint32(1));
+
+    // Only the oldest event of a frame is measured.
+    loop.recordFrameStage(RenderLoop::FrameStage::Started);
+    loop.addInputEvent(timestamp);
+    loop.addInputEvent(timestamp + std::chrono::milliseconds(2));
+    loop.beginFrame();
+    RenderLoopPrivate::get(&loop)->notifyFrameCompleted(timestamp + std::chrono::milliseconds(4));
+
+    latency = loop.inputLatency();
+    QCOMPARE(latency.count, quint64(2));
+    QCOMPARE(latency.minimum, milliseconds(4));
+    QCOMPARE(latency.maximum, milliseconds(8));
+    QCOMPARE(latency.last, milliseconds(4));
+    QCOMPARE(latency.total, milliseconds(12));
+    QCOMPARE(latency.smoothed, milliseconds(8) - milliseconds(4) / 16);
+    QCOMPARE(latency.histogram[4], quint32(1));
+
+    // A frame without input events doesn't change the statistics.
+    presentFrame(&loop);
+    QCOMPARE(loop.inputLatency().count, quint64(2));
+
+    // Latencies beyond the histogram go into the last bucket.
+    presentFrameWithInput(&loop, currentTime(), std::chrono::milliseconds(RenderLoop::InputLatency::BucketCount + 10));
+    QCOMPARE(loop.inputLatency().histogram[RenderLoop::InputLatency::BucketCount - 1], quint32(1));
+
+    loop.resetInputLatency();
+    latency = loop.inputLatency();
+    QCOMPARE(latency.count, quint64(0));
+    QCOMPARE(latency.total, std::chrono::nanoseconds::zero());
+    QCOMPARE(latency.histogram[4], quint32(0));
+}
+
+void TestFrameTimings::staleInputEvent()
+{
+    RenderLoop loop;
+
+    // An event that hasn't been painted within a quarter of a second didn't cause the frame.
+    presentFrameWithInput(&loop, currentTime() - std::chrono::seconds(1), std::chrono::milliseconds(8));
+    QCOMPARE(loop.inputLatency().count, quint64(0));
+
+    // The stale event isn't carried over into the next frame either.
+    presentFrame(&loop);
+    QCOMPARE(loop.inputLatency().count, quint64(0));
+}
+
+QTEST_GUILESS_MAIN(TestFrameTimings)
+#include "test_frame_timings.moc"
@@ -7,6 +7,8 @@
     SPDX-License-Identifier: LGPL-2.0-or-later
 */
 
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QObject>
 #include <QTemporaryFile>
 #include <QTest>
@@ -22,6 +24,8 @@ private Q_SLOTS:
     void benchmarkTraceOff();
     void benchmarkTraceDurationOff();
     void enable();
+    void formatting();
+    void record();
 
 private:
     QTemporaryFile m_tempFile;
@@ -67,6 +71,68 @@ void TestFTrace::enable()
     QCOMPARE(m_tempFile.readLine(), "TEST_DURATIONboo end_ctx=1\n");
 }
 
+void TestFTrace::formatting()
+{
+    QVERIFY(KWin::FTraceLogger::self()->isEnabled());
+
+    fTrace("TEST ", QStringLiteral("Überschrift"), ' ', -42, ' ', 0.5);
+    QCOMPARE(m_tempFile.readLine(), QByteArray("TEST Überschrift -42 0.5\n"));
+
+    // markers that are too long are truncated, but still end with a new line
+    fTrace(QByteArray(1000, 'x'));
+    const QByteArray truncated = m_tempFile.readLine();
+    QCOMPARE(truncated.size(), KWin::FTraceBuffer::Capacity);
+    QVERIFY(truncated.endsWith('\n'));
+}
+
+void TestFTrace::record()
+{
+    QTemporaryFile traceFile;
+    QVERIFY(traceFile.open());
+
+    KWin::FTraceLogger *logger = KWin::FTraceLogger::self();
+    logger->startRecording(traceFile.fileName());
+    QVERIFY(logger->isRecording());
+
+    {
+        fTraceSlice("slice", QStringLiteral("a \"quoted\" detail"));
+        fTraceCounter("counter", 42);
+    }
+    logger->stopRecording();
+    QVERIFY(!logger->isRecording());
+    fTraceInstant("ignored");
+
+    QCOMPARE(traceFile.readLine(), QByteArray("[\n"));
+
+    auto readEvent = [&traceFile]() {
+        QByteArray line = traceFile.readLine();
+        if (!line.endsWith(",\n")) {
+            return QJsonObject();
+        }
+        line.chop(2);
+        return QJsonDocument::fromJson(line).object();
+    };
+
+    const QJsonObject threadName = readEvent();
+    QCOMPARE(threadName.value(QStringLiteral("ph")).toString(), QStringLiteral("M"));
+    QCOMPARE(threadName.value(QStringLiteral("args")).toObject().value(QStringLiteral("name")).toString(), QStringLiteral("main"));
+
+    const QJsonObject begin = readEvent();
+    QCOMPARE(begin.value(QStringLiteral("ph")).toString(), QStringLiteral("B"));
+    QCOMPARE(begin.value(QStringLiteral("name")).toString(), QStringLiteral("slice"));
+    QCOMPARE(begin.value(QStringLiteral("args")).toObject().value(QStringLiteral("detail")).toString(), QStringLiteral("a \"quoted\" detail"));
+
+    const QJsonObject counter = readEvent();
+    QCOMPARE(counter.value(QStringLiteral("ph")).toString(), QStringLiteral("C"));
+    QCOMPARE(counter.value(QStringLiteral("args")).toObject().value(QStringLiteral("value")).toInt(), 42);
+
+    const QJsonObject end = readEvent();
+    QCOMPARE(end.value(QStringLiteral("ph")).toString(), QStringLiteral("E"));
+    QVERIFY(end.value(QStringLiteral("ts")).toDouble() >= begin.value(QStringLiteral("ts")).toDouble());
+
+    QVERIFY(traceFile.atEnd());
+}
+
 QTEST_MAIN(TestFTrace)
 
 #include "test_ftrace.moc"
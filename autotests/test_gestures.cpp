@@ -50,6 +50,7 @@ private Q_SLOTS:
     void testSwipeGeometryStart();
     void testSwipeDiagonalCancels_data();
     void testSwipeDiagonalCancels();
+    void benchmarkSwipeUpdate();
 };
 
 void GestureTest::testSwipeMinFinger_data()
@@ -600,5 +601,25 @@ void GestureTest::testSwipeDiagonalCancels()
 
 }
 
+void GestureTest::benchmarkSwipeUpdate()
+{
+    GestureRecognizer recognizer;
+    SwipeGesture gestures[8];
+    for (int i = 0; i < 8; ++i) {
+        gestures[i].setDirection(i % 2 ? SwipeGesture::Direction::Left : SwipeGesture::Direction::Right);
+        gestures[i].setMinimumFingerCount(3);
+        gestures[i].setMinimumDelta(QSizeF(200, 0));
+        recognizer.registerGesture(&gestures[i]);
+    }
+
+    QBENCHMARK {
+        recognizer.startSwipeGesture(3);
+        for (int i = 0; i < 1000; ++i) {
+            recognizer.updateSwipeGesture(QSizeF(0.5, 0.1));
+        }
+        recognizer.endSwipeGesture();
+    }
+}
+
 QTEST_MAIN(GestureTest)
 #include "test_gestures.moc"
@@ -0,0 +1,191 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QObject>
+#include <QTest>
+
+#include "utils/occlusionmap.h"
+
+using namespace KWin;
+
+Q_DECLARE_METATYPE(QVector<QRect>)
+
+static const QRect s_screen(0, 0, 3840, 2160);
+
+static QVector<QRect> tiledLayout(int columns, int rows, int gap)
+{
+    QVector<QRect> windows;
+    const int width = s_screen.width() / columns;
+    const int height = s_screen.height() / rows;
+    for (int row = 0; row < rows; ++row) {
+        for (int column = 0; column < columns; ++column) {
+            windows.append(QRect(column * width + gap, row * height + gap, width - 2 * gap, height - 2 * gap));
+        }
+    }
+    return windows;
+}
+
+static QVector<QRect> cascadedLayout(int count)
+{
+    QVector<QRect> windows;
+    for (int i = 0; i < count; ++i) {
+        windows.append(QRect(40 * i, 30 * i, 1600, 1000));
+    }
+    return windows;
+}
+
+// The occlusion pass as it used to be implemented in Scene::paintSimpleScreen(), windows are
+// listed bottom to top.
+static QVector<QRegion> occludeWithRegion(const QVector<QRect> &windows)
+{
+    QVector<QRegion> regions(windows.count());
+    QRegion allclips;
+    for (int i = windows.count() - 1; i >= 0; --i) {
+        regions[i] = QRegion(s_screen) - allclips;
+        allclips |= windows[i];
+    }
+    regions.append(QRegion(s_screen) - allclips);
+    return regions;
+}
+
+static QVector<QRegion> occludeWithMap(OcclusionMap &occlusionMap, const QVector<QRect> &windows)
+{
+    QVector<QRegion> regions(windows.count());
+    occlusionMap.reset(s_screen);
+    for (int i = windows.count() - 1; i >= 0; --i) {
+        regions[i] = occlusionMap.subtract(QRegion(s_screen));
+        occlusionMap.add(windows[i]);
+    }
+    regions.append(occlusionMap.subtract(QRegion(s_screen)));
+    return regions;
+}
+
+class TestOcclusionMap : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void empty();
+    void fullyOccluded();
+    void disjoint();
+    void partiallyOccluded();
+    void edgeTiles();
+    void layouts_data();
+    void layouts();
+    void benchmarkRegion_data();
+    void benchmarkRegion();
+    void benchmarkOcclusionMap_data();
+    void benchmarkOcclusionMap();
+};
+
+void TestOcclusionMap::empty()
+{
+    OcclusionMap occlusionMap;
+    occlusionMap.reset(s_screen);
+    QVERIFY(occlusionMap.isEmpty());
+    QCOMPARE(occlusionMap.subtract(QRegion(10, 10, 100, 100)), QRegion(10, 10, 100, 100));
+}
+
+void TestOcclusionMap::fullyOccluded()
+{
+    OcclusionMap occlusionMap;
+    occlusionMap.reset(s_screen);
+    occlusionMap.add(QRegion(0, 0, 1920, 1080));
+
+    QVERIFY(occlusionMap.isOccluded(QRect(100, 100, 200, 200)));
+    QCOMPARE(occlusionMap.subtract(QRegion(100, 100, 200, 200)), QRegion());
+}
+
+void TestOcclusionMap::disjoint()
+{
+    OcclusionMap occlusionMap;
+    occlusionMap.reset(s_screen);
+    occlusionMap.add(QRegion(0, 0, 1920, 1080));
+
+    QCOMPARE(occlusionMap.subtract(QRegion(2000, 1200, 100, 100)), QRegion(2000, 1200, 100, 100));
+}
+
+void TestOcclusionMap::partiallyOccluded()
+{
+    OcclusionMap occlusionMap;
+    occlusionMap.reset(s_screen);
+    occlusionMap.add(QRegion(0, 0, 1000, 1000));
+    occlusionMap.add(QRegion(10, 10, 50, 50));
+
+    QVERIFY(!occlusionMap.isOccluded(QRect(900, 900, 200, 200)));
+    QCOMPARE(occlusionMap.subtract(QRegion(900, 900, 200, 200)), QRegion(900, 900, 200, 200) - QRegion(0, 0, 1000, 1000));
+    QCOMPARE(occlusionMap.region(), QRegion(0, 0, 1000, 1000));
+}
+
+void TestOcclusionMap::edgeTiles()
+{
+    // The screen size is not a multiple of the tile size, the last row and column are cut.
+    const QRect screen(0, 0, 1000, 700);
+    OcclusionMap occlusionMap;
+    occlusionMap.reset(screen);
+    occlusionMap.add(QRegion(screen));
+
+    QVERIFY(occlusionMap.isOccluded(QRect(990, 690, 10, 10)));
+    QCOMPARE(occlusionMap.subtract(QRegion(screen)), QRegion());
+}
+
+static void addLayoutRows()
+{
+    QTest::addColumn<QVector<QRect>>("windows");
+
+    QTest::addRow("tiled 2x2") << tiledLayout(2, 2, 0);
+    QTest::addRow("tiled 4x4 with gaps") << tiledLayout(4, 4, 5);
+    QTest::addRow("tiled 8x6 terminals") << tiledLayout(8, 6, 2);
+    QTest::addRow("cascaded 30") << cascadedLayout(30);
+}
+
+void TestOcclusionMap::layouts_data()
+{
+    addLayoutRows();
+}
+
+void TestOcclusionMap::layouts()
+{
+    QFETCH(QVector<QRect>, windows);
+
+    OcclusionMap occlusionMap;
+    QCOMPARE(occludeWithMap(occlusionMap, windows), occludeWithRegion(windows));
+}
+
+void TestOcclusionMap::benchmarkRegion_data()
+{
+    addLayoutRows();
+}
+
+void TestOcclusionMap::benchmarkRegion()
+{
+    QFETCH(QVector<QRect>, windows);
+
+    QBENCHMARK {
+        occludeWithRegion(windows);
+    }
+}
+
+void TestOcclusionMap::benchmarkOcclusionMap_data()
+{
+    addLayoutRows();
+}
+
+void TestOcclusionMap::benchmarkOcclusionMap()
+{
+    QFETCH(QVector<QRect>, windows);
+
+    OcclusionMap occlusionMap;
+    QBENCHMARK {
+        occludeWithMap(occlusionMap, windows);
+    }
+}
+
+QTEST_GUILESS_MAIN(TestOcclusionMap)
+
+#include "test_occlusion_map.moc"
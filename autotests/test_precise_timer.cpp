@@ -0,0 +1,151 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QEventLoop>
+#include <QObject>
+#include <QSignalSpy>
+#include <QTest>
+#include <QTimer>
+
+#include "utils/precisetimer.h"
+
+using namespace std::chrono_literals;
+
+static std::chrono::nanoseconds currentTime()
+{
+    return std::chrono::steady_clock::now().time_since_epoch();
+}
+
+struct Drift
+{
+    std::chrono::nanoseconds early = std::chrono::nanoseconds::zero();
+    std::chrono::nanoseconds late = std::chrono::nanoseconds::zero();
+    std::chrono::nanoseconds total = std::chrono::nanoseconds::zero();
+    int earlyCount = 0;
+
+    void add(std::chrono::nanoseconds drift)
+    {
+        if (drift < std::chrono::nanoseconds::zero()) {
+            early = std::max(early, -drift);
+            earlyCount++;
+        } else {
+            late = std::max(late, drift);
+        }
+        total += std::chrono::abs(drift);
+    }
+};
+
+class TestPreciseTimer : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void fires();
+    void stop();
+    void pastDeadline();
+    void benchmarkDrift_data();
+    void benchmarkDrift();
+};
+
+void TestPreciseTimer::fires()
+{
+    KWin::PreciseTimer timer;
+    QSignalSpy timeoutSpy(&timer, &KWin::PreciseTimer::timeout);
+
+    const std::chrono::nanoseconds deadline = currentTime() + 5ms;
+    timer.start(deadline);
+    QVERIFY(timer.isActive());
+    QVERIFY(timeoutSpy.wait());
+    QVERIFY(currentTime() >= deadline);
+    QVERIFY(!timer.isActive());
+    QCOMPARE(timeoutSpy.count(), 1);
+}
+
+void TestPreciseTimer::stop()
+{
+    KWin::PreciseTimer timer;
+    QSignalSpy timeoutSpy(&timer, &KWin::PreciseTimer::timeout);
+
+    timer.start(currentTime() + 1ms);
+    timer.stop();
+    QVERIFY(!timer.isActive());
+    QVERIFY(!timeoutSpy.wait(20));
+}
+
+void TestPreciseTimer::pastDeadline()
+{
+    KWin::PreciseTimer timer;
+    QSignalSpy timeoutSpy(&timer, &KWin::PreciseTimer::timeout);
+
+    timer.start(currentTime() - 1ms);
+    QVERIFY(timeoutSpy.wait());
+}
+
+void TestPreciseTimer::benchmarkDrift_data()
+{
+    QTest::addColumn<bool>("precise");
+
+    QTest::addRow("QTimer (milliseconds)") << false;
+    QTest::addRow("PreciseTimer") << true;
+}
+
+void TestPreciseTimer::benchmarkDrift()
+{
+    // Simulates how the render loop of a 240Hz output schedules compositing cycles, and
+    // reports how far the wake-ups are from the requested timestamps.
+    QFETCH(bool, precise);
+
+    const std::chrono::nanoseconds vblankInterval = 4166666ns;
+    const int iterations = 100;
+
+    KWin::PreciseTimer preciseTimer;
+    QTimer coarseTimer;
+    coarseTimer.setSingleShot(true);
+
+    std::chrono::nanoseconds nextRenderTimestamp;
+    Drift drift;
+    QEventLoop loop;
+    int remaining = iterations;
+
+    auto schedule = [&]() {
+        nextRenderTimestamp = currentTime() + vblankInterval - 1234567ns;
+        if (precise) {
+            preciseTimer.start(nextRenderTimestamp);
+        } else {
+            const std::chrono::nanoseconds waitInterval = nextRenderTimestamp - currentTime();
+            coarseTimer.start(std::chrono::duration_cast<std::chrono::milliseconds>(waitInterval));
+        }
+    };
+    auto handleTimeout = [&]() {
+        drift.add(currentTime() - nextRenderTimestamp);
+        if (--remaining) {
+            schedule();
+        } else {
+            loop.quit();
+        }
+    };
+    connect(&preciseTimer, &KWin::PreciseTimer::timeout, &loop, handleTimeout);
+    connect(&coarseTimer, &QTimer::timeout, &loop, handleTimeout);
+
+    schedule();
+    loop.exec();
+
+    qInfo("average drift: %lldus, max late: %lldus, max early: %lldus, early wake-ups: %d/%d",
+          static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(drift.total / iterations).count()),
+          static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(drift.late).count()),
+          static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(drift.early).count()),
+          drift.earlyCount, iterations);
+
+    if (precise) {
+        QCOMPARE(drift.earlyCount, 0);
+    }
+}
+
+QTEST_GUILESS_MAIN(TestPreciseTimer)
+
+#include "test_precise_timer.moc"
@@ -0,0 +1,164 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QObject>
+#include <QSignalSpy>
+#include <QTest>
+
+#include "renderloop.h"
+#include "renderloop_p.h"
+
+using namespace KWin;
+using namespace std::chrono_literals;
+
+class TestRenderQuality : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void missedFrames();
+    void slowFrames();
+    void recovery();
+    void noRecoveryWithoutHeadroom();
+    void counterReset();
+};
+
+static std::chrono::nanoseconds s_timestamp = 1s;
+
+// At 60Hz, a quarter of a second is 15 frames and two seconds are 120 frames.
+static const int s_dropFrameCount = 15;
+static const int s_riseFrameCount = 120;
+
+// Renders a frame that took @a renderTime and presents it @a delay later than expected.
+static void presentFrame(RenderLoop *loop, std::chrono::nanoseconds delay, std::chrono::nanoseconds renderTime = 0ns)
+{
+    RenderLoopPrivate *d = RenderLoopPrivate::get(loop);
+    const std::chrono::nanoseconds vblankInterval(1'000'000'000'000ull / loop->refreshRate());
+
+    d->nextPresentationTimestamp = s_timestamp + vblankInterval;
+    loop->beginFrame();
+    if (renderTime != 0ns) {
+        d->renderJournal.add(renderTime);
+    }
+    s_timestamp = d->nextPresentationTimestamp + delay;
+    d->notifyFrameCompleted(s_timestamp);
+}
+
+static void presentFrames(RenderLoop *loop, int count, std::chrono::nanoseconds delay, std::chrono::nanoseconds renderTime = 0ns)
+{
+    for (int i = 0; i < count; ++i) {
+        presentFrame(loop, delay, renderTime);
+    }
+}
+
+static void setupRenderLoop(RenderLoop *loop)
+{
+    loop->setRefreshRate(60000);
+    // Keep the safety margin and thereby the budget fixed, about 13ms at 60Hz.
+    RenderLoopPrivate::get(loop)->configuredLatencyPolicy = LatencyMedium;
+}
+
+void TestRenderQuality::missedFrames()
+{
+    RenderLoop loop;
+    setupRenderLoop(&loop);
+    QSignalSpy renderQualityChangedSpy(&loop, &RenderLoop::renderQualityChanged);
+    QCOMPARE(loop.renderQuality(), RenderLoop::RenderQuality::High);
+
+    // The quality drops one step after a quarter of a second worth of missed frames.
+    presentFrames(&loop, s_dropFrameCount - 1, 16ms);
+    QCOMPARE(loop.renderQuality(), RenderLoop::RenderQuality::High);
+    presentFrame(&loop, 16ms);
+    QCOMPARE(loop.renderQuality(), RenderLoop::RenderQuality::Medium);
+    QCOMPARE(renderQualityChangedSpy.count(), 1);
+
+    presentFrames(&loop, s_dropFrameCount, 16ms);
+    QCOMPARE(loop.renderQuality(), RenderLoop::RenderQuality::Low);
+    QCOMPARE(renderQualityChangedSpy.count(), 2);
+
+    // There is nothing below the low quality.
+    presentFrames(&loop, s_dropFrameCount, 16ms);
+    QCOMPARE(loop.renderQuality(), RenderLoop::RenderQuality::Low);
+    QCOMPARE(renderQualityChangedSpy.count(), 2);
+}
+
+void TestRenderQuality::slowFrames()
+{
+    RenderLoop loop;
+    setupRenderLoop(&loop);
+
+    // Frames that make their vblank but take longer than the budget to render count as misses.
+    presentFrames(&loop, s_dropFrameCount - 1, 0ns, 20ms);
+    QCOMPARE(loop.renderQuality(), RenderLoop::RenderQuality::High);
+    presentFrame(&loop, 0ns, 20ms);
+    QCOMPARE(loop.renderQuality(), RenderLoop::RenderQuality::Medium);
+}
+
+void TestRenderQuality::recovery()
+{
+    RenderLoop loop;
+    setupRenderLoop(&loop);
+    QSignalSpy renderQualityChangedSpy(&loop, &RenderLoop::renderQualityChanged);
+
+    presentFrames(&loop, 2 * s_dropFrameCount, 16ms);
+    QCOMPARE(loop.renderQuality(), RenderLoop::RenderQuality::Low);
+
+    // The quality rises one step after two seconds below half the budget.
+    presentFrames(&loop, s_riseFrameCount - 1, 0ns);
+    QCOMPARE(loop.renderQuality(), RenderLoop::RenderQuality::Low);
+    presentFrame(&loop, 0ns);
+    QCOMPARE(loop.renderQuality(), RenderLoop::RenderQuality::Medium);
+    QCOMPARE(renderQualityChangedSpy.count(), 3);
+
+    presentFrames(&loop, s_riseFrameCount, 0ns);
+    QCOMPARE(loop.renderQuality(), RenderLoop::RenderQuality::High);
+    QCOMPARE(renderQualityChangedSpy.count(), 4);
+
+    // There is nothing above the high quality.
+    presentFrames(&loop, s_riseFrameCount, 0ns);
+    QCOMPARE(loop.renderQuality(), RenderLoop::RenderQuality::High);
+    QCOMPARE(renderQualityChangedSpy.count(), 4);
+}
+
+void TestRenderQuality::noRecoveryWithoutHeadroom()
+{
+    RenderLoop loop;
+    setupRenderLoop(&loop);
+
+    presentFrames(&loop, s_dropFrameCount, 16ms);
+    QCOMPARE(loop.renderQuality(), RenderLoop::RenderQuality::Medium);
+
+    // Frames that fit in the budget, but not in half of it, keep the current quality.
+    presentFrames(&loop, 2 * s_riseFrameCount, 0ns, 8ms);
+    QCOMPARE(loop.renderQuality(), RenderLoop::RenderQuality::Medium);
+}
+
+void TestRenderQuality::counterReset()
+{
+    RenderLoop loop;
+    setupRenderLoop(&loop);
+
+    // A frame within the budget resets the count of missed frames.
+    presentFrames(&loop, s_dropFrameCount - 1, 16ms);
+    presentFrame(&loop, 0ns);
+    presentFrames(&loop, s_dropFrameCount - 1, 16ms);
+    QCOMPARE(loop.renderQuality(), RenderLoop::RenderQuality::High);
+    presentFrame(&loop, 16ms);
+    QCOMPARE(loop.renderQuality(), RenderLoop::RenderQuality::Medium);
+
+    // A missed frame resets the count of frames with headroom.
+    presentFrames(&loop, s_riseFrameCount - 1, 0ns);
+    presentFrame(&loop, 16ms);
+    presentFrames(&loop, s_riseFrameCount - 1, 0ns);
+    QCOMPARE(loop.renderQuality(), RenderLoop::RenderQuality::Medium);
+    presentFrame(&loop, 0ns);
+    QCOMPARE(loop.renderQuality(), RenderLoop::RenderQuality::High);
+}
+
+QTEST_GUILESS_MAIN(TestRenderQuality)
+#include "test_render_quality.moc"
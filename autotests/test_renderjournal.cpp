@@ -0,0 +1,96 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QObject>
+#include <QTest>
+
+#include "renderjournal.h"
+
+using namespace std::chrono_literals;
+
+class TestRenderJournal : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void empty();
+    void minMaxAverage();
+    void percentile();
+    void outlierEviction();
+    void overflowBucket();
+    void benchmarkAdd();
+};
+
+void TestRenderJournal::empty()
+{
+    KWin::RenderJournal journal;
+    QCOMPARE(journal.minimum(), 0ns);
+    QCOMPARE(journal.maximum(), 0ns);
+    QCOMPARE(journal.average(), 0ns);
+    QCOMPARE(journal.percentile(0.9), 0ns);
+}
+
+void TestRenderJournal::minMaxAverage()
+{
+    KWin::RenderJournal journal;
+    journal.add(1ms);
+    journal.add(2ms);
+    journal.add(3ms);
+
+    QCOMPARE(journal.minimum(), 1ms);
+    QCOMPARE(journal.maximum(), 3ms);
+    QCOMPARE(journal.average(), 2ms);
+}
+
+void TestRenderJournal::percentile()
+{
+    KWin::RenderJournal journal;
+    for (int i = 1; i <= 10; ++i) {
+        journal.add(std::chrono::milliseconds(i));
+    }
+
+    QCOMPARE(journal.percentile(0.5), 5100us);
+    QCOMPARE(journal.percentile(0.9), 9100us);
+    QCOMPARE(journal.percentile(1.0), 10ms);
+}
+
+void TestRenderJournal::outlierEviction()
+{
+    KWin::RenderJournal journal;
+    journal.add(20ms);
+    for (int i = 0; i < 63; ++i) {
+        journal.add(1ms);
+    }
+    QCOMPARE(journal.maximum(), 20ms);
+    QCOMPARE(journal.percentile(0.9), 1100us);
+
+    // The slow frame falls out of the window once enough new samples have been added.
+    journal.add(1ms);
+    QCOMPARE(journal.maximum(), 1ms);
+    QCOMPARE(journal.average(), 1ms);
+}
+
+void TestRenderJournal::overflowBucket()
+{
+    KWin::RenderJournal journal;
+    journal.add(100ms);
+    QCOMPARE(journal.percentile(0.5), 100ms);
+}
+
+void TestRenderJournal::benchmarkAdd()
+{
+    KWin::RenderJournal journal;
+    QBENCHMARK {
+        journal.add(4ms);
+        journal.percentile(0.9);
+    }
+}
+
+QTEST_GUILESS_MAIN(TestRenderJournal)
+
+#include "test_renderjournal.moc"
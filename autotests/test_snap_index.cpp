@@ -0,0 +1,131 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QObject>
+#include <QTest>
+
+#include "utils/snapindex.h"
+
+using namespace KWin;
+
+static QVector<QRect> scatteredWindows(int count)
+{
+    QVector<QRect> windows;
+    for (int i = 0; i < count; ++i) {
+        // a cheap deterministic spread of sizes and positions
+        const int x = (i * 733) % 3600;
+        const int y = (i * 389) % 2000;
+        const int width = 200 + (i * 97) % 1400;
+        const int height = 150 + (i * 61) % 900;
+        windows.append(QRect(x, y, width, height));
+    }
+    return windows;
+}
+
+static QVector<int> bruteForceQuery(const QVector<QRect> &windows, const QRect &rect)
+{
+    QVector<int> keys;
+    for (int i = 0; i < windows.count(); ++i) {
+        if (windows[i].intersects(rect)) {
+            keys.append(i);
+        }
+    }
+    return keys;
+}
+
+class TestSnapIndex : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void empty();
+    void insertAndRemove();
+    void update();
+    void matchesBruteForce();
+    void benchmarkBruteForce();
+    void benchmarkQuery();
+};
+
+void TestSnapIndex::empty()
+{
+    SnapIndex index;
+    QCOMPARE(index.count(), 0);
+    QCOMPARE(index.query(QRect(0, 0, 100, 100)), QVector<int>());
+}
+
+void TestSnapIndex::insertAndRemove()
+{
+    SnapIndex index;
+    index.insert(2, QRect(100, 0, 100, 100));
+    index.insert(0, QRect(0, 0, 100, 100));
+    index.insert(1, QRect(1000, 0, 100, 100));
+    QCOMPARE(index.count(), 3);
+
+    // the keys are sorted, no matter in which order the rects are stored
+    QCOMPARE(index.query(QRect(50, 50, 100, 10)), QVector<int>({0, 2}));
+    QCOMPARE(index.query(QRect(500, 0, 10, 10)), QVector<int>());
+
+    index.remove(0);
+    QCOMPARE(index.count(), 2);
+    QCOMPARE(index.query(QRect(50, 50, 100, 10)), QVector<int>({2}));
+}
+
+void TestSnapIndex::update()
+{
+    SnapIndex index;
+    index.insert(0, QRect(0, 0, 3000, 100));
+    index.insert(1, QRect(2000, 0, 100, 100));
+    QCOMPARE(index.query(QRect(2500, 50, 10, 10)), QVector<int>({0}));
+
+    // moving and shrinking the widest rect must not hide it or the others
+    index.insert(0, QRect(2400, 0, 200, 100));
+    QCOMPARE(index.count(), 2);
+    QCOMPARE(index.query(QRect(2500, 50, 10, 10)), QVector<int>({0}));
+    QCOMPARE(index.query(QRect(2050, 50, 10, 10)), QVector<int>({1}));
+    QCOMPARE(index.query(QRect(100, 50, 10, 10)), QVector<int>());
+}
+
+void TestSnapIndex::matchesBruteForce()
+{
+    const QVector<QRect> windows = scatteredWindows(300);
+    SnapIndex index;
+    for (int i = 0; i < windows.count(); ++i) {
+        index.insert(i, windows[i]);
+    }
+
+    for (int i = 0; i < 100; ++i) {
+        const QRect rect = QRect((i * 131) % 3800, (i * 71) % 2100, 400, 300).adjusted(-20, -20, 20, 20);
+        QCOMPARE(index.query(rect), bruteForceQuery(windows, rect));
+    }
+}
+
+void TestSnapIndex::benchmarkBruteForce()
+{
+    const QVector<QRect> windows = scatteredWindows(500);
+    const QRect rect(1800, 1000, 60, 60);
+    QBENCHMARK {
+        bruteForceQuery(windows, rect);
+    }
+}
+
+void TestSnapIndex::benchmarkQuery()
+{
+    const QVector<QRect> windows = scatteredWindows(500);
+    SnapIndex index;
+    for (int i = 0; i < windows.count(); ++i) {
+        index.insert(i, windows[i]);
+    }
+    const QRect rect(1800, 1000, 60, 60);
+    QBENCHMARK {
+        index.query(rect);
+    }
+}
+
+QTEST_GUILESS_MAIN(TestSnapIndex)
+
+#include "test_snap_index.moc"
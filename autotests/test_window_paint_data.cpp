@@ -105,6 +105,9 @@ public:
     QRect clientGeometry() const override {
         return QRect();
     }
+    QRect pendingFrameGeometry() const override {
+        return QRect();
+    }
     EffectScreen *screen() const override {
         return nullptr;
     }
@@ -899,6 +899,38 @@ XcursorLibraryLoadImages (const char *file, const char *theme, int size)
     return images;
 }
 
+/** Load a single cursor of a theme
+ *
+ * Unlike XcursorLibraryLoadImages(), this function doesn't fall back to
+ * the default theme if the cursor can't be found in the given theme or
+ * any of its inherited themes.
+ *
+ * \param theme The name of theme that should be searched
+ * \param name The name of the cursor
+ * \param size The desired size of the cursor images
+ * \return The loaded cursor images, or NULL if the cursor can't be found.
+ * The caller is expected to destroy the returned object with
+ * XcursorImagesDestroy().
+ */
+XcursorImages *
+xcursor_load_images(const char *theme, const char *name, int size)
+{
+	FILE *f;
+	XcursorImages *images = NULL;
+
+	if (!theme)
+		theme = "default";
+
+	f = XcursorScanTheme(theme, name);
+	if (f) {
+		images = XcursorFileLoadImages(f, size);
+		if (images)
+			XcursorImagesSetName(images, name);
+		fclose(f);
+	}
+	return images;
+}
+
 static void
 load_all_cursors_from_dir(const char *path, int size,
 			  void (*load_callback)(XcursorImages *, void *),
@@ -64,6 +64,9 @@ XcursorLibraryLoadImages (const char *file, const char *theme, int size);
 void
 XcursorImagesDestroy (XcursorImages *images);
 
+XcursorImages *
+xcursor_load_images(const char *theme, const char *name, int size);
+
 void
 xcursor_load_theme(const char *theme, int size,
 		    void (*load_callback)(XcursorImages *, void *),
@@ -82,6 +82,11 @@ AbstractClient::AbstractClient()
         m_keyboardGeometryRestore = QRect();
     });
 
+    // the maximize areas depend on the desktop of the window
+    connect(this, &AbstractClient::desktopChanged, this, [this] () {
+        m_quickTileZones.clear();
+    });
+
     // replace on-screen-display on size changes
     connect(this, &AbstractClient::frameGeometryChanged, this,
         [this] (Toplevel *c, const QRect &old) {
@@ -446,6 +451,12 @@ void AbstractClient::setDesktops(QVector<VirtualDesktop*> desktops)
     const bool wasOnCurrentDesktop = isOnCurrentDesktop() && was_desk >= 0;
 
     m_desktops = desktops;
+    m_desktopMask = 0;
+    m_desktopMaskValid = true;
+    for (const VirtualDesktop *desktop : qAsConst(m_desktops)) {
+        m_desktopMask |= desktop->membershipBit();
+        m_desktopMaskValid &= desktop->membershipBit() != 0;
+    }
 
     if (windowManagementInterface()) {
         if (m_desktops.isEmpty()) {
@@ -943,6 +954,10 @@ bool AbstractClient::startInteractiveMoveResize()
     setInteractiveMoveResize(true);
     workspace()->setMoveResizeClient(this);
 
+    m_quickTileZonesConnection = connect(workspace(), &Workspace::clientAreasChanged, this, [this]() {
+        m_quickTileZones.clear();
+    });
+
     if (maximizeMode() != MaximizeRestore) {
         switch (interactiveMoveResizeGravity()) {
         case Gravity::Left:
@@ -1122,8 +1137,14 @@ void AbstractClient::handleInteractiveMoveResize(const QPoint &local, const QPoi
 
 void AbstractClient::handleInteractiveMoveResize(int x, int y, int x_root, int y_root)
 {
-    if (isWaitingForInteractiveMoveResizeSync())
-        return; // we're still waiting for the client or the timeout
+    if (isWaitingForInteractiveMoveResizeSync()) {
+        // we're still waiting for the client or the timeout, only remember the latest position
+        m_interactiveMoveResize.hasDeferredPosition = true;
+        m_interactiveMoveResize.deferredLocal = QPoint(x, y);
+        m_interactiveMoveResize.deferredGlobal = QPoint(x_root, y_root);
+        return;
+    }
+    m_interactiveMoveResize.hasDeferredPosition = false;
 
     const Gravity gravity = interactiveMoveResizeGravity();
     if ((gravity == Gravity::None && !isMovableAcrossScreens())
@@ -1442,6 +1463,17 @@ void AbstractClient::handleInteractiveMoveResize(int x, int y, int x_root, int y
     Q_EMIT clientStepUserMovedResized(this, moveResizeGeometry());
 }
 
+void AbstractClient::handleDeferredInteractiveMoveResize()
+{
+    if (!m_interactiveMoveResize.hasDeferredPosition) {
+        return;
+    }
+    if (!isInteractiveMoveResize() || isWaitingForInteractiveMoveResizeSync()) {
+        return;
+    }
+    handleInteractiveMoveResize(m_interactiveMoveResize.deferredLocal, m_interactiveMoveResize.deferredGlobal);
+}
+
 StrutRect AbstractClient::strutRect(StrutArea area) const
 {
     Q_UNUSED(area)
@@ -2103,14 +2135,18 @@ void AbstractClient::updateCursor()
 
 void AbstractClient::leaveInteractiveMoveResize()
 {
+    m_interactiveMoveResize.hasDeferredPosition = false;
     workspace()->setMoveResizeClient(nullptr);
     setInteractiveMoveResize(false);
+    disconnect(m_quickTileZonesConnection);
+    m_quickTileZones.clear();
     if (ScreenEdges::self()->isDesktopSwitchingMovingClients())
         ScreenEdges::self()->reserveDesktopSwitching(false, Qt::Vertical|Qt::Horizontal);
     if (isElectricBorderMaximizing()) {
         outline()->hide();
         elevate(false);
     }
+    outline()->setBoundingGeometry(QRect());
 }
 
 bool AbstractClient::doStartInteractiveMoveResize()
@@ -2131,37 +2167,51 @@ void AbstractClient::doInteractiveResizeSync()
 {
 }
 
-void AbstractClient::checkQuickTilingMaximizationZones(int xroot, int yroot)
+void AbstractClient::updateQuickTileZones()
 {
-    QuickTileMode mode = QuickTileFlag::None;
-    bool innerBorder = false;
+    m_quickTileZones.clear();
 
     const auto outputs = kwinApp()->platform()->enabledOutputs();
+    m_quickTileZones.reserve(outputs.count());
     for (const AbstractOutput *output : outputs) {
-        if (!output->geometry().contains(QPoint(xroot, yroot))) {
-            continue;
+        m_quickTileZones.append(QuickTileZone{
+            output->geometry(),
+            workspace()->clientArea(MaximizeArea, this, output),
+        });
+    }
+}
+
+const AbstractClient::QuickTileZone *AbstractClient::quickTileZone(const QPoint &pos) const
+{
+    for (const QuickTileZone &zone : qAsConst(m_quickTileZones)) {
+        if (zone.outputGeometry.contains(pos)) {
+            return &zone; // no point in checking other screens to contain this... "point"...
         }
+    }
+    return nullptr;
+}
 
-        auto isInScreen = [&output, &outputs](const QPoint &pt) {
-            for (const AbstractOutput *other : outputs) {
-                if (other == output) {
-                    continue;
-                }
-                if (other->geometry().contains(pt)) {
-                    return true;
-                }
-            }
-            return false;
-        };
+void AbstractClient::checkQuickTilingMaximizationZones(int xroot, int yroot)
+{
+    // This runs for every pointer motion during interactive moves, so the zones are only
+    // computed once and then whenever the client areas or the desktop of the window change.
+    if (m_quickTileZones.isEmpty()) {
+        updateQuickTileZones();
+    }
+
+    QuickTileMode mode = QuickTileFlag::None;
+    const QuickTileZone *zone = quickTileZone(QPoint(xroot, yroot));
+    QPoint innerBorderProbe;
 
-        QRect area = workspace()->clientArea(MaximizeArea, this, QPoint(xroot, yroot));
+    if (zone) {
+        const QRect &area = zone->maximizeArea;
         if (options->electricBorderTiling()) {
             if (xroot <= area.x() + 20) {
                 mode |= QuickTileFlag::Left;
-                innerBorder = isInScreen(QPoint(area.x() - 1, yroot));
+                innerBorderProbe = QPoint(area.x() - 1, yroot);
             } else if (xroot >= area.x() + area.width() - 20) {
                 mode |= QuickTileFlag::Right;
-                innerBorder = isInScreen(QPoint(area.right() + 1, yroot));
+                innerBorderProbe = QPoint(area.right() + 1, yroot);
             }
         }
 
@@ -2172,11 +2222,22 @@ void AbstractClient::checkQuickTilingMaximizationZones(int xroot, int yroot)
                 mode |= QuickTileFlag::Bottom;
         } else if (options->electricBorderMaximize() && yroot <= area.y() + 5 && isMaximizable()) {
             mode = QuickTileFlag::Maximize;
-            innerBorder = isInScreen(QPoint(xroot, area.y() - 1));
+            innerBorderProbe = QPoint(xroot, area.y() - 1);
         }
-        break; // no point in checking other screens to contain this... "point"...
     }
+
     if (mode != electricBorderMode()) {
+        // The border is an inner one if another screen lies behind it.
+        bool innerBorder = false;
+        if (mode != QuickTileMode(QuickTileFlag::None)) {
+            for (const QuickTileZone &other : qAsConst(m_quickTileZones)) {
+                if (&other != zone && other.outputGeometry.contains(innerBorderProbe)) {
+                    innerBorder = true;
+                    break;
+                }
+            }
+        }
+
         setElectricBorderMode(mode);
         if (innerBorder) {
             if (!m_electricMaximizingDelay) {
@@ -2576,6 +2637,11 @@ QRect AbstractClient::virtualKeyboardGeometry() const
 
 void AbstractClient::setVirtualKeyboardGeometry(const QRect &geo)
 {
+    // The input method reports the keyboard geometry on every text input update
+    if (m_virtualKeyboardGeometry == geo) {
+        return;
+    }
+
     // No keyboard anymore
     if (geo.isEmpty() && !m_keyboardGeometryRestore.isEmpty()) {
         const QRect availableArea = workspace()->clientArea(MaximizeArea, this);
@@ -2779,6 +2845,29 @@ void AbstractClient::evaluateWindowRules()
     applyWindowRules();
 }
 
+void AbstractClient::evaluateWindowRulesForCaption()
+{
+    if (RuleBook::self()->captionAffectsRules(this)) {
+        evaluateWindowRules();
+    }
+}
+
+bool AbstractClient::isOnDesktop(VirtualDesktop *desktop) const
+{
+    if (m_desktops.isEmpty()) {
+        return true;
+    }
+    if (m_desktopMaskValid && desktop && desktop->membershipBit()) {
+        return m_desktopMask & desktop->membershipBit();
+    }
+    return m_desktops.contains(desktop);
+}
+
+bool AbstractClient::isOnActivity(const QString &activity) const
+{
+    return m_activityList.isEmpty() || m_activityList.contains(activity);
+}
+
 /**
  * Returns the list of activities the client window is on.
  * if it's on all activities, the list will be empty.
@@ -3024,23 +3113,33 @@ void AbstractClient::setElectricBorderMode(QuickTileMode mode)
 void AbstractClient::setElectricBorderMaximizing(bool maximizing)
 {
     m_electricMaximizing = maximizing;
-    if (maximizing)
-        outline()->show(electricBorderMaximizeGeometry(Cursors::self()->mouse()->pos()), moveResizeGeometry());
-    else
+    if (maximizing) {
+        const QPoint pos = Cursors::self()->mouse()->pos();
+        // The outline covers all zones of the output, so moving to another zone of the
+        // same output only animates the outline.
+        const QuickTileZone *zone = quickTileZone(pos);
+        outline()->setBoundingGeometry(zone ? zone->maximizeArea : QRect());
+        outline()->show(electricBorderMaximizeGeometry(pos), moveResizeGeometry());
+    } else {
         outline()->hide();
+    }
     elevate(maximizing);
 }
 
 QRect AbstractClient::electricBorderMaximizeGeometry(const QPoint &pos) const
 {
+    // The maximize areas are cached during interactive moves.
+    const QuickTileZone *zone = quickTileZone(pos);
+    const QRect maximizeArea = zone ? zone->maximizeArea : workspace()->clientArea(MaximizeArea, this, pos);
+
     if (electricBorderMode() == QuickTileMode(QuickTileFlag::Maximize)) {
         if (maximizeMode() == MaximizeFull)
             return geometryRestore();
         else
-            return workspace()->clientArea(MaximizeArea, this, pos);
+            return maximizeArea;
     }
 
-    QRect ret = workspace()->clientArea(MaximizeArea, this, pos);
+    QRect ret = maximizeArea;
     if (electricBorderMode() & QuickTileFlag::Left)
         ret.setRight(ret.left()+ret.width()/2 - 1);
     else if (electricBorderMode() & QuickTileFlag::Right)
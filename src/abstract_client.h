@@ -493,6 +493,9 @@ public:
     QVector<VirtualDesktop *> desktops() const override {
         return m_desktops;
     }
+    using Toplevel::isOnDesktop;
+    bool isOnDesktop(VirtualDesktop *desktop) const override;
+    bool isOnActivity(const QString &activity) const override;
     QVector<uint> x11DesktopIds() const;
     QStringList desktopIds() const;
 
@@ -568,6 +571,7 @@ public:
     void removeRule(Rules* r);
     void setupWindowRules(bool ignore_temporary);
     void evaluateWindowRules();
+    void evaluateWindowRulesForCaption();
     virtual void applyWindowRules();
     virtual bool takeFocus() = 0;
     virtual bool wantsInput() const = 0;
@@ -1162,6 +1166,11 @@ protected:
     virtual void doInteractiveResizeSync();
     void handleInteractiveMoveResize(int x, int y, int x_root, int y_root);
     void handleInteractiveMoveResize(const QPoint &local, const QPoint &global);
+    /**
+     * Applies the latest pointer position that arrived while waiting for a sync request,
+     * so that the window catches up with the pointer as soon as the client is done.
+     */
+    void handleDeferredInteractiveMoveResize();
     void dontInteractiveMoveResize();
 
     virtual QSize resizeIncrements() const;
@@ -1241,6 +1250,9 @@ private:
     QTimer *m_shadeHoverTimer = nullptr;
     ShadeMode m_shadeMode = ShadeNone;
     QVector <VirtualDesktop *> m_desktops;
+    // the membership bits of m_desktops, valid if every desktop in it has one
+    quint32 m_desktopMask = 0;
+    bool m_desktopMaskValid = true;
 
     int m_activityUpdatesBlocked = 0;
     bool m_blockedActivityUpdatesRequireTransients = false;
@@ -1263,6 +1275,16 @@ private:
     // The quick tile mode of this window.
     int m_quickTileMode = int(QuickTileFlag::None);
     QTimer *m_electricMaximizingDelay = nullptr;
+    // The electric border zones of each output, cached during interactive moves.
+    struct QuickTileZone
+    {
+        QRect outputGeometry;
+        QRect maximizeArea;
+    };
+    void updateQuickTileZones();
+    const QuickTileZone *quickTileZone(const QPoint &pos) const;
+    QVector<QuickTileZone> m_quickTileZones;
+    QMetaObject::Connection m_quickTileZonesConnection;
 
     // geometry
     int m_blockGeometryUpdates = 0; // > 0 = New geometry is remembered, but not actually set
@@ -1284,6 +1306,10 @@ private:
         CursorShape cursor = Qt::ArrowCursor;
         AbstractOutput *startOutput = nullptr;
         QTimer *delayedTimer = nullptr;
+        // Latest pointer position received while waiting for a sync request
+        bool hasDeferredPosition = false;
+        QPoint deferredLocal;
+        QPoint deferredGlobal;
     } m_interactiveMoveResize;
 
     struct {
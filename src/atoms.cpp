@@ -73,6 +73,9 @@ Atoms::Atoms()
     , m_motifSupport(QByteArrayLiteral("_MOTIF_WM_INFO"))
     , m_helpersRetrieved(false)
 {
+    // All the intern requests have been queued above, hand them to the server right away so
+    // that the replies are already there when the atoms are first used
+    xcb_flush(connection());
 }
 
 void Atoms::retrieveHelpers()
@@ -157,6 +157,9 @@ void DrmBackend::reactivate()
 
     // While the session had been inactive, an output could have been added or
     // removed, we need to re-scan outputs.
+    for (const auto &gpu : qAsConst(m_gpus)) {
+        gpu->markConnectorChanged(0);
+    }
     updateOutputs();
     Q_EMIT activeChanged();
 }
@@ -222,6 +225,8 @@ bool DrmBackend::initialize()
 
 void DrmBackend::handleUdevEvent()
 {
+    // docks and MST hubs send bursts of events, only update the outputs once for all of them
+    bool outputsChanged = false;
     while (auto device = m_udevMonitor->getDevice()) {
         if (!m_active) {
             continue;
@@ -257,10 +262,16 @@ void DrmBackend::handleUdevEvent()
             }
             if (gpu) {
                 qCDebug(KWIN_DRM) << "Received change event for monitored drm device" << gpu->devNode();
-                updateOutputs();
+                // hotplug events name the connector that changed, if the driver knows it
+                const char *connector = device->property("CONNECTOR");
+                gpu->markConnectorChanged(connector ? QByteArray(connector).toUInt() : 0);
+                outputsChanged = true;
             }
         }
     }
+    if (outputsChanged) {
+        updateOutputs();
+    }
 }
 
 DrmGpu *DrmBackend::addGpu(const QString &fileName)
@@ -555,6 +566,9 @@ QString DrmBackend::supportInformation() const
     s << "Active: " << m_active << Qt::endl;
     for (int g = 0; g < m_gpus.size(); g++) {
         s << "Atomic Mode Setting on GPU " << g << ": " << m_gpus.at(g)->atomicModeSetting() << Qt::endl;
+        if (const auto eglBackend = m_gpus.at(g)->eglBackend()) {
+            s << eglBackend->importStatistics();
+        }
     }
     return supportInfo;
 }
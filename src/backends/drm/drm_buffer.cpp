@@ -13,8 +13,10 @@
 
 // system
 #include <sys/mman.h>
+#include <unistd.h>
 // c++
 #include <cerrno>
+#include <utility>
 // drm
 #include <xf86drm.h>
 #include <xf86drmMode.h>
@@ -30,6 +32,13 @@ DrmBuffer::DrmBuffer(DrmGpu *gpu, uint32_t format, uint64_t modifier)
 {
 }
 
+DrmBuffer::~DrmBuffer()
+{
+    if (m_fence != -1) {
+        close(m_fence);
+    }
+}
+
 quint32 DrmBuffer::bufferId() const
 {
     return m_bufferId;
@@ -55,6 +64,24 @@ uint64_t DrmBuffer::modifier() const
     return m_modifier;
 }
 
+void DrmBuffer::setFence(int fd)
+{
+    if (m_fence != -1) {
+        close(m_fence);
+    }
+    m_fence = fd;
+}
+
+int DrmBuffer::fence() const
+{
+    return m_fence;
+}
+
+int DrmBuffer::takeFence()
+{
+    return std::exchange(m_fence, -1);
+}
+
 // DrmDumbBuffer
 DrmDumbBuffer::DrmDumbBuffer(DrmGpu *gpu, const QSize &size, uint32_t drmFormat)
     : DrmBuffer(gpu, drmFormat, DRM_FORMAT_MOD_LINEAR)
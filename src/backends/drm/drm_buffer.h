@@ -21,7 +21,7 @@ class DrmBuffer
 {
 public:
     DrmBuffer(DrmGpu *gpu, uint32_t format, uint64_t modifier);
-    virtual ~DrmBuffer() = default;
+    virtual ~DrmBuffer();
 
     virtual bool needsModeChange(DrmBuffer *b) const {Q_UNUSED(b) return false;}
 
@@ -31,12 +31,29 @@ public:
     uint32_t format() const;
     uint64_t modifier() const;
 
+    /**
+     * Sets the sync file that signals once rendering to this buffer has finished. The
+     * buffer takes ownership of @p fd.
+     */
+    void setFence(int fd);
+    /**
+     * Returns the sync file that signals once rendering to this buffer has finished, or -1
+     * if there is none.
+     */
+    int fence() const;
+    /**
+     * Returns the sync file like fence() does, but transfers its ownership to the caller.
+     * The buffer has no fence anymore afterwards, so it's not waited for or closed again.
+     */
+    int takeFence();
+
 protected:
     quint32 m_bufferId = 0;
     QSize m_size;
     DrmGpu *m_gpu;
     uint32_t m_format;
     uint64_t m_modifier;
+    int m_fence = -1;
 };
 
 class DrmDumbBuffer : public DrmBuffer
@@ -0,0 +1,142 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "drm_commit_thread.h"
+#include "drm_buffer.h"
+#include "drm_gpu.h"
+#include "drm_pipeline.h"
+#include "logging.h"
+
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+namespace KWin
+{
+
+DrmCommitThread::DrmCommitThread(DrmGpu *gpu)
+    : m_gpu(gpu)
+{
+    m_thread.reset(QThread::create([this]() {
+        run();
+    }));
+    m_thread->setObjectName(QStringLiteral("KWin DRM commit thread"));
+    m_thread->start();
+}
+
+DrmCommitThread::~DrmCommitThread()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_commitQueued.wakeAll();
+    }
+    m_thread->wait();
+}
+
+void DrmCommitThread::commit(drmModeAtomicReq *request, uint32_t flags, const QVector<DrmPipeline *> &pipelines, const QVector<int> &fences)
+{
+    QMutexLocker locker(&m_mutex);
+    m_queue.enqueue(Commit{request, flags, pipelines, fences, CursorUpdate()});
+    m_commitQueued.wakeOne();
+}
+
+void DrmCommitThread::updateCursor(uint32_t crtcId, const QSharedPointer<DrmDumbBuffer> &buffer, const QPoint &hotspot, const QPoint &pos, bool setImage)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_queue.isEmpty() && !m_queue.last().request && m_queue.last().cursor.crtcId == crtcId) {
+        // the previous update hasn't been applied yet, only the latest state matters
+        CursorUpdate &queued = m_queue.last().cursor;
+        if (setImage) {
+            queued.buffer = buffer;
+            queued.hotspot = hotspot;
+            queued.setImage = true;
+        }
+        queued.pos = pos;
+        return;
+    }
+    m_queue.enqueue(Commit{nullptr, 0, {}, {}, CursorUpdate{crtcId, buffer, hotspot, pos, setImage}});
+    m_commitQueued.wakeOne();
+}
+
+void DrmCommitThread::waitIdle()
+{
+    QMutexLocker locker(&m_mutex);
+    while (m_busy || !m_queue.isEmpty()) {
+        m_idle.wait(&m_mutex);
+    }
+}
+
+void DrmCommitThread::run()
+{
+    QMutexLocker locker(&m_mutex);
+    while (true) {
+        while (m_queue.isEmpty() && !m_stopping) {
+            m_commitQueued.wait(&m_mutex);
+        }
+        if (m_queue.isEmpty()) {
+            // only stop once everything that has been queued is committed
+            return;
+        }
+        const Commit commit = m_queue.dequeue();
+        m_busy = true;
+        locker.unlock();
+
+        if (commit.request) {
+            const bool ok = drmModeAtomicCommit(m_gpu->fd(), commit.request, commit.flags, nullptr) == 0;
+            if (!ok) {
+                qCCritical(KWIN_DRM) << "Atomic commit failed! This should never happen!" << strerror(errno);
+                QMetaObject::invokeMethod(this, [this, pipelines = commit.pipelines]() {
+                    handleFailedCommit(pipelines);
+                }, Qt::QueuedConnection);
+            }
+            drmModeAtomicFree(commit.request);
+            for (const int fence : commit.fences) {
+                close(fence);
+            }
+        } else {
+            applyCursorUpdate(commit.cursor);
+        }
+
+        locker.relock();
+        m_busy = false;
+        m_idle.wakeAll();
+    }
+}
+
+void DrmCommitThread::applyCursorUpdate(const CursorUpdate &update)
+{
+    if (update.setImage) {
+        const QSize size = update.buffer ? update.buffer->size() : QSize(64, 64);
+        const uint32_t handle = update.buffer ? update.buffer->handle() : 0;
+        int ret = drmModeSetCursor2(m_gpu->fd(), update.crtcId, handle, size.width(), size.height(), update.hotspot.x(), update.hotspot.y());
+        if (ret == -ENOTSUP) {
+            ret = drmModeSetCursor(m_gpu->fd(), update.crtcId, handle, size.width(), size.height());
+        }
+        if (ret != 0) {
+            qCWarning(KWIN_DRM) << "Setting the cursor failed!" << strerror(-ret);
+        }
+    }
+    if (drmModeMoveCursor(m_gpu->fd(), update.crtcId, update.pos.x(), update.pos.y()) != 0) {
+        qCWarning(KWIN_DRM) << "Moving the cursor failed!" << strerror(errno);
+    }
+}
+
+void DrmCommitThread::handleFailedCommit(const QVector<DrmPipeline *> &pipelines)
+{
+    // the pipelines may have been removed in the meantime
+    const auto current = m_gpu->pipelines();
+    for (DrmPipeline *pipeline : pipelines) {
+        if (current.contains(pipeline)) {
+            pipeline->asyncCommitFailed();
+        }
+    }
+}
+
+}
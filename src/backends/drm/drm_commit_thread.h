@@ -0,0 +1,106 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QMutex>
+#include <QObject>
+#include <QPoint>
+#include <QQueue>
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+#include <xf86drmMode.h>
+
+namespace KWin
+{
+
+class DrmDumbBuffer;
+class DrmGpu;
+class DrmPipeline;
+
+/**
+ * The DrmCommitThread class submits non-blocking atomic commits of a GPU on a separate
+ * thread, so that the main thread doesn't stall if the kernel takes a while to accept a
+ * commit, for example while it waits for the previous page flip to be programmed.
+ *
+ * Commits are queued after they have passed an atomic test on the main thread and are
+ * applied in the order they were queued. Page flip events are still delivered through
+ * the DRM file descriptor and handled on the main thread.
+ *
+ * Cursor updates go through the same queue, so they are ordered with the commits.
+ */
+class DrmCommitThread : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DrmCommitThread(DrmGpu *gpu);
+    ~DrmCommitThread() override;
+
+    /**
+     * Queues @p request to be committed with @p flags. The commit thread takes ownership of
+     * the request and of the in-fence file descriptors in @p fences, which are closed once
+     * the request has been submitted. If the commit fails, DrmPipeline::asyncCommitFailed()
+     * is called for each of the @p pipelines on the main thread.
+     */
+    void commit(drmModeAtomicReq *request, uint32_t flags, const QVector<DrmPipeline *> &pipelines, const QVector<int> &fences);
+
+    /**
+     * Queues an update of the cursor on the crtc @p crtcId. If @p setImage is @c true, @p buffer
+     * and @p hotspot replace the cursor image, otherwise only the position changes.
+     *
+     * Cursor updates use the legacy cursor ioctls, which the kernel applies at the next vblank
+     * without waiting for page flips that are in flight, so the cursor doesn't have to wait
+     * for the next frame to be rendered. Consecutive updates for the same crtc are merged.
+     */
+    void updateCursor(uint32_t crtcId, const QSharedPointer<DrmDumbBuffer> &buffer, const QPoint &hotspot, const QPoint &pos, bool setImage);
+
+    /**
+     * Blocks until all queued commits have been submitted to the kernel.
+     */
+    void waitIdle();
+
+private:
+    struct CursorUpdate
+    {
+        uint32_t crtcId = 0;
+        QSharedPointer<DrmDumbBuffer> buffer;
+        QPoint hotspot;
+        QPoint pos;
+        bool setImage = false;
+    };
+
+    struct Commit
+    {
+        drmModeAtomicReq *request = nullptr;
+        uint32_t flags = 0;
+        QVector<DrmPipeline *> pipelines;
+        QVector<int> fences;
+        // set instead of the request for cursor updates
+        CursorUpdate cursor;
+    };
+
+    void run();
+    void applyCursorUpdate(const CursorUpdate &update);
+    void handleFailedCommit(const QVector<DrmPipeline *> &pipelines);
+
+    DrmGpu *const m_gpu;
+    QScopedPointer<QThread> m_thread;
+    QMutex m_mutex;
+    QWaitCondition m_commitQueued;
+    QWaitCondition m_idle;
+    QQueue<Commit> m_queue;
+    bool m_busy = false;
+    bool m_stopping = false;
+};
+
+}
@@ -19,6 +19,7 @@
 #include "renderloop_p.h"
 #include "main.h"
 #include "drm_pipeline.h"
+#include "drm_commit_thread.h"
 #include "drm_virtual_output.h"
 #include "wayland_server.h"
 #include "drm_lease_output.h"
@@ -85,6 +86,11 @@ DrmGpu::DrmGpu(DrmBackend *backend, const QString &devNode, int fd, dev_t device
 
     initDrmResources();
 
+    static const bool commitThreadDisabled = qEnvironmentVariableIntValue("KWIN_DRM_NO_COMMIT_THREAD") == 1;
+    if (m_atomicModeSetting && !commitThreadDisabled) {
+        m_commitThread.reset(new DrmCommitThread(this));
+    }
+
     m_leaseDevice = new KWaylandServer::DrmLeaseDeviceV1Interface(waylandServer()->display(), [this]{
         char *path = drmGetDeviceNameFromFd2(m_fd);
         int fd = open(path, O_RDWR | O_CLOEXEC);
@@ -119,6 +125,7 @@ DrmGpu::~DrmGpu()
     }
     delete m_leaseDevice;
     waitIdle();
+    m_commitThread.reset();
     const auto outputs = m_outputs;
     for (const auto &output : outputs) {
         if (auto drmOutput = qobject_cast<DrmOutput *>(output)) {
@@ -189,6 +196,7 @@ void DrmGpu::initDrmResources()
         uint32_t crtcId = resources->crtcs[i];
         DrmPlane *primary = nullptr;
         DrmPlane *cursor = nullptr;
+        DrmPlane *overlay = nullptr;
         for (const auto &plane : qAsConst(planes)) {
             if (plane->isCrtcSupported(i)) {
                 if (plane->type() == DrmPlane::TypeIndex::Primary) {
@@ -199,6 +207,10 @@ void DrmGpu::initDrmResources()
                     if (!cursor || cursor->getProp(DrmPlane::PropertyIndex::CrtcId)->pending() == crtcId) {
                         cursor = plane;
                     }
+                } else if (plane->type() == DrmPlane::TypeIndex::Overlay) {
+                    if (!overlay || overlay->getProp(DrmPlane::PropertyIndex::CrtcId)->pending() == crtcId) {
+                        overlay = plane;
+                    }
                 }
             }
         }
@@ -207,7 +219,9 @@ void DrmGpu::initDrmResources()
             continue;
         }
         planes.removeOne(primary);
-        auto c = new DrmCrtc(this, crtcId, i, primary, cursor);
+        // overlay planes can often be used with several crtcs, reserve one per crtc
+        planes.removeOne(overlay);
+        auto c = new DrmCrtc(this, crtcId, i, primary, cursor, overlay);
         if (!c->init()) {
             delete c;
             continue;
@@ -217,8 +231,19 @@ void DrmGpu::initDrmResources()
     }
 }
 
+void DrmGpu::markConnectorChanged(uint32_t connectorId)
+{
+    if (connectorId == 0) {
+        m_allConnectorsChanged = true;
+    } else if (!m_changedConnectors.contains(connectorId)) {
+        m_changedConnectors << connectorId;
+    }
+}
+
 bool DrmGpu::updateOutputs()
 {
+    // connectors, modes and leases may have changed, test results from before don't apply anymore
+    invalidateTestResults();
     waitIdle();
     DrmScopedPointer<drmModeRes> resources(drmModeGetResources(m_fd));
     if (!resources) {
@@ -260,7 +285,11 @@ bool DrmGpu::updateOutputs()
             m_allObjects << conn;
         } else {
             removedConnectors.removeOne(conn);
-            conn->updateProperties();
+            if (m_allConnectorsChanged || m_changedConnectors.contains(conn->id())) {
+                conn->probe();
+            } else {
+                conn->updateProperties();
+            }
         }
         if (conn->isConnected()) {
             if (auto output = findOutput(conn->id())) {
@@ -296,6 +325,8 @@ bool DrmGpu::updateOutputs()
         m_allObjects.removeOne(connector);
         delete connector;
     }
+    m_changedConnectors.clear();
+    m_allConnectorsChanged = false;
 
     // update crtc properties
     for (const auto &crtc : qAsConst(m_crtcs)) {
@@ -418,26 +449,49 @@ bool DrmGpu::testPendingConfiguration(TestMode mode)
 
 bool DrmGpu::testPipelines()
 {
+    // leased resources belong to the lessee, they can't be part of our commits
+    const auto pipelines = unleasedPipelines();
+    if (pipelines.isEmpty()) {
+        return true;
+    }
+    QVector<uint64_t> key;
+    for (const auto &pipeline : pipelines) {
+        key << pipeline->configurationKey();
+    }
+    const auto it = m_testResults.constFind(key);
+    if (it != m_testResults.constEnd()) {
+        return *it;
+    }
     // pipelines that are enabled but not active need to be activated for the test
     QVector<DrmPipeline*> inactivePipelines;
-    for (const auto &pipeline : qAsConst(m_pipelines)) {
+    for (const auto &pipeline : pipelines) {
         if (!pipeline->pending.active) {
             pipeline->pending.active = true;
             inactivePipelines << pipeline;
         }
     }
     const auto unused = unusedObjects();
-    bool test = DrmPipeline::commitPipelines(m_pipelines, DrmPipeline::CommitMode::Test, unused);
+    bool test = DrmPipeline::commitPipelines(pipelines, DrmPipeline::CommitMode::Test, unused);
     // disable inactive pipelines again
     for (const auto &pipeline : qAsConst(inactivePipelines)) {
         pipeline->pending.active = false;
     }
     if (!inactivePipelines.isEmpty() && test) {
-        test = DrmPipeline::commitPipelines(m_pipelines, DrmPipeline::CommitMode::Test, unused);
+        test = DrmPipeline::commitPipelines(pipelines, DrmPipeline::CommitMode::Test, unused);
     }
+    // crtc reallocation can try many combinations, don't let the cache grow without bounds
+    if (m_testResults.size() >= 256) {
+        m_testResults.clear();
+    }
+    m_testResults.insert(key, test);
     return test;
 }
 
+void DrmGpu::invalidateTestResults()
+{
+    m_testResults.clear();
+}
+
 DrmOutput *DrmGpu::findOutput(quint32 connector)
 {
     auto it = std::find_if(m_drmOutputs.constBegin(), m_drmOutputs.constEnd(), [connector] (DrmOutput *o) {
@@ -451,6 +505,9 @@ DrmOutput *DrmGpu::findOutput(quint32 connector)
 
 void DrmGpu::waitIdle()
 {
+    if (m_commitThread) {
+        m_commitThread->waitIdle();
+    }
     m_socketNotifier->setEnabled(false);
     while (true) {
         const bool idle = std::all_of(m_drmOutputs.constBegin(), m_drmOutputs.constEnd(), [](DrmOutput *output){
@@ -637,6 +694,7 @@ void DrmGpu::handleLeaseRequest(KWaylandServer::DrmLeaseV1Interface *leaseReques
             qCDebug(KWIN_DRM) << res;
         }
         leaseRequest->grant(fd, lesseeId);
+        invalidateTestResults();
         for (const auto &output : qAsConst(outputs)) {
             output->leased(leaseRequest);
         }
@@ -645,15 +703,30 @@ void DrmGpu::handleLeaseRequest(KWaylandServer::DrmLeaseV1Interface *leaseReques
 
 void DrmGpu::handleLeaseRevoked(KWaylandServer::DrmLeaseV1Interface *lease)
 {
+    QVector<DrmPipeline *> revoked;
     const auto conns = lease->connectors();
     for (const auto &connector : conns) {
         auto output = qobject_cast<DrmLeaseOutput*>(connector);
         if (m_leaseOutputs.contains(output)) {
             output->leaseEnded();
+            revoked << output->pipeline();
         }
     }
     qCDebug(KWIN_DRM, "Revoking lease with leaseID %d", lease->lesseeId());
     drmModeRevokeLease(m_fd, lease->lesseeId());
+    invalidateTestResults();
+    if (!m_atomicModeSetting) {
+        return;
+    }
+    // The lessee may have left its crtcs lit up. Turn them off right away and on their own,
+    // instead of leaving it to the next modeset of all outputs.
+    for (DrmPipeline *pipeline : qAsConst(revoked)) {
+        pipeline->updateProperties();
+        pipeline->pending.active = false;
+        if (!DrmPipeline::commitPipelines({pipeline}, DrmPipeline::CommitMode::CommitModeset)) {
+            qCWarning(KWIN_DRM) << "Failed to turn off the formerly leased connector" << pipeline->connector()->id();
+        }
+    }
 }
 
 void DrmGpu::removeLeaseOutput(DrmLeaseOutput *output)
@@ -716,14 +789,27 @@ bool DrmGpu::isNVidia() const
 
 bool DrmGpu::needsModeset() const
 {
-    return std::any_of(m_pipelines.constBegin(), m_pipelines.constEnd(), [](const auto &pipeline) {
+    // changes the lessee makes to leased resources don't concern the other outputs
+    const auto pipelines = unleasedPipelines();
+    QVector<DrmObject *> objects = m_allObjects;
+    for (const auto &output : qAsConst(m_leaseOutputs)) {
+        if (output->lease()) {
+            const DrmPipeline *pipeline = output->pipeline();
+            objects.removeOne(pipeline->connector());
+            if (pipeline->pending.crtc) {
+                objects.removeOne(pipeline->pending.crtc);
+                objects.removeOne(pipeline->pending.crtc->primaryPlane());
+            }
+        }
+    }
+    return std::any_of(pipelines.constBegin(), pipelines.constEnd(), [](const auto &pipeline) {
         return pipeline->needsModeset();
-    }) || std::any_of(m_allObjects.constBegin(), m_allObjects.constEnd(), [](const auto &object) {
+    }) || std::any_of(objects.constBegin(), objects.constEnd(), [](const auto &object) {
         return object->needsModeset();
     });
 }
 
-bool DrmGpu::maybeModeset()
+QVector<DrmPipeline *> DrmGpu::unleasedPipelines() const
 {
     auto pipelines = m_pipelines;
     for (const auto &output : qAsConst(m_leaseOutputs)) {
@@ -731,6 +817,12 @@ bool DrmGpu::maybeModeset()
             pipelines.removeOne(output->pipeline());
         }
     }
+    return pipelines;
+}
+
+bool DrmGpu::maybeModeset()
+{
+    const auto pipelines = unleasedPipelines();
     bool presentPendingForAll = std::all_of(pipelines.constBegin(), pipelines.constEnd(), [](const auto &pipeline) {
         return pipeline->modesetPresentPending() || !pipeline->pending.active;
     });
@@ -739,6 +831,10 @@ bool DrmGpu::maybeModeset()
         return true;
     }
     const bool ok = DrmPipeline::commitPipelines(pipelines, DrmPipeline::CommitMode::CommitModeset, unusedObjects());
+    if (!ok) {
+        // the configuration may have passed a cached test that doesn't hold anymore
+        invalidateTestResults();
+    }
     for (DrmPipeline *pipeline : qAsConst(pipelines)) {
         if (pipeline->modesetPresentPending() && pipeline->output()) {
             pipeline->resetModesetPresentPending();
@@ -762,6 +858,7 @@ QVector<DrmObject*> DrmGpu::unusedObjects() const
             ret.removeOne(pipeline->pending.crtc);
             ret.removeOne(pipeline->pending.crtc->primaryPlane());
             ret.removeOne(pipeline->pending.crtc->cursorPlane());
+            ret.removeOne(pipeline->pending.crtc->overlayPlane());
         }
     }
     return ret;
@@ -772,4 +869,9 @@ QSize DrmGpu::cursorSize() const
     return m_cursorSize;
 }
 
+DrmCommitThread *DrmGpu::commitThread() const
+{
+    return m_commitThread.data();
+}
+
 }
@@ -11,9 +11,11 @@
 #define DRM_GPU_H
 
 #include <qobject.h>
+#include <QHash>
 #include <QVector>
 #include <QSocketNotifier>
 #include <QPointer>
+#include <QScopedPointer>
 #include <QSize>
 
 #include <epoxy/egl.h>
@@ -36,6 +38,7 @@ class DrmCrtc;
 class DrmConnector;
 class DrmPlane;
 class DrmBackend;
+class DrmCommitThread;
 class EglGbmBackend;
 class DrmPipeline;
 class DrmAbstractOutput;
@@ -66,6 +69,11 @@ public:
      */
     clockid_t presentationClock() const;
     QSize cursorSize() const;
+    /**
+     * Returns the thread that submits non-blocking atomic commits, or @c nullptr if commits
+     * are submitted on the main thread.
+     */
+    DrmCommitThread *commitThread() const;
 
     QVector<DrmAbstractOutput*> outputs() const;
     const QVector<DrmPipeline*> pipelines() const;
@@ -74,6 +82,12 @@ public:
     void setEglBackend(EglGbmBackend *eglBackend);
 
     bool updateOutputs();
+    /**
+     * Marks the connector with the id @p connectorId as changed, so that the next call to
+     * updateOutputs() makes the kernel probe it again. The other connectors only have their
+     * properties read back. If @p connectorId is @c 0, all connectors get probed.
+     */
+    void markConnectorChanged(uint32_t connectorId);
 
     enum VirtualOutputMode { Placeholder, Full };
     DrmVirtualOutput *createVirtualOutput(const QString &name, const QSize &size, double scale, VirtualOutputMode mode);
@@ -105,6 +119,8 @@ private:
     bool checkCrtcAssignment(QVector<DrmConnector*> connectors, const QVector<DrmCrtc*> &crtcs);
     bool testPipelines();
     QVector<DrmObject*> unusedObjects() const;
+    QVector<DrmPipeline *> unleasedPipelines() const;
+    void invalidateTestResults();
 
     void handleLeaseRequest(KWaylandServer::DrmLeaseV1Interface *leaseRequest);
     void handleLeaseRevoked(KWaylandServer::DrmLeaseV1Interface *lease);
@@ -128,13 +144,18 @@ private:
     QVector<DrmConnector*> m_connectors;
     QVector<DrmObject*> m_allObjects;
     QVector<DrmPipeline*> m_pipelines;
+    // the outcome of atomic tests of configurations that have been tried before
+    QHash<QVector<uint64_t>, bool> m_testResults;
 
     QVector<DrmOutput*> m_drmOutputs;
     QVector<DrmAbstractOutput*> m_outputs;
     QVector<DrmLeaseOutput*> m_leaseOutputs;
+    QVector<uint32_t> m_changedConnectors;
+    bool m_allConnectorsChanged = true;
     KWaylandServer::DrmLeaseDeviceV1Interface *m_leaseDevice = nullptr;
 
     QSocketNotifier *m_socketNotifier = nullptr;
+    QScopedPointer<DrmCommitThread> m_commitThread;
     QSize m_cursorSize;
 };
 
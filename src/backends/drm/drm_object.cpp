@@ -14,6 +14,8 @@
 #include "drm_pointer.h"
 #include "logging.h"
 
+#include <algorithm>
+
 namespace KWin
 {
 
@@ -139,26 +141,45 @@ bool DrmObject::updateProperties()
         qCWarning(KWIN_DRM) << "Failed to get properties for object" << m_id;
         return false;
     }
-    for (int propIndex = 0; propIndex < m_propertyDefinitions.count(); propIndex++) {
-        const PropertyDefinition &def = m_propertyDefinitions[propIndex];
-        bool found = false;
-        for (uint32_t drmPropIndex = 0; drmPropIndex < properties->count_props; drmPropIndex++) {
-            DrmScopedPointer<drmModePropertyRes> prop(drmModeGetProperty(m_gpu->fd(), properties->props[drmPropIndex]));
-            if (!prop) {
-                qCWarning(KWIN_DRM, "Getting property %d of object %d failed!", drmPropIndex, m_id);
+    QVector<bool> found(m_propertyDefinitions.count(), false);
+    for (uint32_t drmPropIndex = 0; drmPropIndex < properties->count_props; drmPropIndex++) {
+        const uint32_t propId = properties->props[drmPropIndex];
+        const uint64_t value = properties->prop_values[drmPropIndex];
+        // property ids and their meta data don't change, so only new properties have to be queried
+        auto it = m_propertyDefinitionIndices.constFind(propId);
+        if (it != m_propertyDefinitionIndices.constEnd()) {
+            const int propIndex = *it;
+            if (propIndex < 0) {
                 continue;
             }
-            if (def.name == prop->name) {
-                if (m_props[propIndex]) {
-                    m_props[propIndex]->setCurrent(properties->prop_values[drmPropIndex]);
-                } else {
-                    m_props[propIndex] = new DrmProperty(this, prop.data(), properties->prop_values[drmPropIndex], def.enumNames);
-                }
-                found = true;
-                break;
+            if (m_props[propIndex]) {
+                m_props[propIndex]->setCurrent(value);
+                found[propIndex] = true;
+                continue;
             }
         }
-        if (!found) {
+        DrmScopedPointer<drmModePropertyRes> prop(drmModeGetProperty(m_gpu->fd(), propId));
+        if (!prop) {
+            qCWarning(KWIN_DRM, "Getting property %d of object %d failed!", drmPropIndex, m_id);
+            continue;
+        }
+        const auto def = std::find_if(m_propertyDefinitions.cbegin(), m_propertyDefinitions.cend(), [&prop](const PropertyDefinition &def) {
+            return def.name == prop->name;
+        });
+        const int propIndex = def == m_propertyDefinitions.cend() ? -1 : std::distance(m_propertyDefinitions.cbegin(), def);
+        m_propertyDefinitionIndices[propId] = propIndex;
+        if (propIndex < 0) {
+            continue;
+        }
+        if (m_props[propIndex]) {
+            m_props[propIndex]->setCurrent(value);
+        } else {
+            m_props[propIndex] = new DrmProperty(this, prop.data(), value, def->enumNames);
+        }
+        found[propIndex] = true;
+    }
+    for (int propIndex = 0; propIndex < m_propertyDefinitions.count(); propIndex++) {
+        if (!found[propIndex]) {
             deleteProp(propIndex);
         }
     }
@@ -10,6 +10,7 @@
 
 #include <QVector>
 #include <QByteArray>
+#include <QHash>
 #include <QMap>
 
 // drm
@@ -114,6 +115,8 @@ private:
     const uint32_t m_id;
     const uint32_t m_objectType;
     const QVector<PropertyDefinition> m_propertyDefinitions;
+    // maps the ids of all properties of the object to their definition, -1 for the ones we don't use
+    QHash<uint32_t, int> m_propertyDefinitionIndices;
 };
 
 }
@@ -18,7 +18,9 @@
 // frameworks
 #include <KConfigGroup>
 
+#include <algorithm>
 #include <cerrno>
+#include <utility>
 
 namespace KWin
 {
@@ -313,8 +315,21 @@ bool DrmConnector::needsModeset() const
     return rgb && rgb->needsCommit();
 }
 
+bool DrmConnector::probe()
+{
+    m_probeRequested = true;
+    return updateProperties();
+}
+
 void DrmConnector::updateModes()
 {
+    // keep the modes and their blobs if nothing changed, a new mode blob would require a modeset
+    const bool changed = m_modes.count() != m_conn->count_modes || !std::equal(m_modes.constBegin(), m_modes.constEnd(), m_conn->modes, [](DrmConnectorMode *mode, const drmModeModeInfo &info) {
+        return checkIfEqual(mode->nativeMode(), &info);
+    });
+    if (!changed) {
+        return;
+    }
     qDeleteAll(m_modes);
     m_modes.clear();
 
@@ -341,7 +356,14 @@ bool DrmConnector::updateProperties()
     if (!DrmObject::updateProperties()) {
         return false;
     }
-    m_conn.reset(drmModeGetConnector(gpu()->fd(), id()));
+    // Unless asked to, don't trigger another probe, the kernel probes the connector on its own
+    const bool probed = std::exchange(m_probeRequested, false);
+    const drmModeConnection previousConnection = m_conn ? m_conn->connection : DRM_MODE_UNKNOWNCONNECTION;
+    m_conn.reset(probed ? drmModeGetConnector(gpu()->fd(), id()) : drmModeGetConnectorCurrent(gpu()->fd(), id()));
+    if (m_conn && !probed && m_conn->connection != previousConnection) {
+        // the cached state of a display that just got plugged in may not have any modes yet
+        m_conn.reset(drmModeGetConnector(gpu()->fd(), id()));
+    }
     if (!m_conn) {
         return false;
     }
@@ -360,19 +382,21 @@ bool DrmConnector::updateProperties()
         deleteProp(PropertyIndex::Underscan_hborder);
     }
 
-    // parse edid
-    auto edidProp = getProp(PropertyIndex::Edid);
-    if (edidProp) {
-        DrmScopedPointer<drmModePropertyBlobRes> blob(drmModeGetPropertyBlob(gpu()->fd(), edidProp->current()));
+    // parse edid, the kernel only replaces the blob if the edid changes
+    const auto edidProp = getProp(PropertyIndex::Edid);
+    const uint32_t edidBlobId = edidProp ? edidProp->current() : 0;
+    if (edidBlobId != m_edidBlobId) {
+        m_edidBlobId = edidBlobId;
+        m_edid = Edid();
+        DrmScopedPointer<drmModePropertyBlobRes> blob(edidBlobId ? drmModeGetPropertyBlob(gpu()->fd(), edidBlobId) : nullptr);
         if (blob && blob->data) {
             m_edid = Edid(blob->data, blob->length);
             if (!m_edid.isValid()) {
                 qCWarning(KWIN_DRM) << "Couldn't parse EDID for connector" << this;
             }
+        } else {
+            qCDebug(KWIN_DRM) << "Could not find edid for connector" << this;
         }
-        deleteProp(PropertyIndex::Edid);
-    } else {
-        qCDebug(KWIN_DRM) << "Could not find edid for connector" << this;
     }
 
     // check the physical size
@@ -85,6 +85,11 @@ public:
     bool needsModeset() const override;
     bool updateProperties() override;
     void disable() override;
+    /**
+     * Makes the kernel probe the connector again and updates the properties afterwards.
+     * Unlike updateProperties(), this is slow and should only be done on hotplug events.
+     */
+    bool probe();
 
     bool isCrtcSupported(DrmCrtc *crtc) const;
     bool isConnected() const;
@@ -117,6 +122,8 @@ private:
     QScopedPointer<DrmPipeline> m_pipeline;
     DrmScopedPointer<drmModeConnector> m_conn;
     Edid m_edid;
+    uint32_t m_edidBlobId = 0;
+    bool m_probeRequested = false;
     QSize m_physicalSize = QSize(-1, -1);
     QVector<DrmConnectorMode *> m_modes;
     int m_modeIndex = 0;
@@ -18,7 +18,7 @@
 namespace KWin
 {
 
-DrmCrtc::DrmCrtc(DrmGpu *gpu, uint32_t crtcId, int pipeIndex, DrmPlane *primaryPlane, DrmPlane *cursorPlane)
+DrmCrtc::DrmCrtc(DrmGpu *gpu, uint32_t crtcId, int pipeIndex, DrmPlane *primaryPlane, DrmPlane *cursorPlane, DrmPlane *overlayPlane)
     : DrmObject(gpu, crtcId, {
         PropertyDefinition(QByteArrayLiteral("MODE_ID"), Requirement::Required),
         PropertyDefinition(QByteArrayLiteral("ACTIVE"), Requirement::Required),
@@ -30,6 +30,7 @@ DrmCrtc::DrmCrtc(DrmGpu *gpu, uint32_t crtcId, int pipeIndex, DrmPlane *primaryP
     , m_pipeIndex(pipeIndex)
     , m_primaryPlane(primaryPlane)
     , m_cursorPlane(cursorPlane)
+    , m_overlayPlane(overlayPlane)
 {
 }
 
@@ -105,6 +106,11 @@ DrmPlane *DrmCrtc::cursorPlane() const
     return m_cursorPlane;
 }
 
+DrmPlane *DrmCrtc::overlayPlane() const
+{
+    return m_overlayPlane;
+}
+
 void DrmCrtc::disable()
 {
     setPending(PropertyIndex::Active, 0);
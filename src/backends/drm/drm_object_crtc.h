@@ -27,7 +27,7 @@ class DrmPlane;
 class DrmCrtc : public DrmObject
 {
 public:
-    DrmCrtc(DrmGpu *gpu, uint32_t crtcId, int pipeIndex, DrmPlane *primaryPlane, DrmPlane *cursorPlane);
+    DrmCrtc(DrmGpu *gpu, uint32_t crtcId, int pipeIndex, DrmPlane *primaryPlane, DrmPlane *cursorPlane, DrmPlane *overlayPlane);
 
     enum class PropertyIndex : uint32_t {
         ModeId = 0,
@@ -46,6 +46,11 @@ public:
     int gammaRampSize() const;
     DrmPlane *primaryPlane() const;
     DrmPlane *cursorPlane() const;
+    /**
+     * Returns the overlay plane reserved for direct scanout of client buffers on this
+     * crtc, or @c nullptr if there is none.
+     */
+    DrmPlane *overlayPlane() const;
     drmModeModeInfo queryCurrentMode();
 
     QSharedPointer<DrmBuffer> current() const;
@@ -61,6 +66,7 @@ private:
     int m_pipeIndex;
     DrmPlane *m_primaryPlane;
     DrmPlane *m_cursorPlane;
+    DrmPlane *m_overlayPlane;
 };
 
 }
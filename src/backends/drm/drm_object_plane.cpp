@@ -42,6 +42,7 @@ DrmPlane::DrmPlane(DrmGpu *gpu, uint32_t planeId)
             QByteArrayLiteral("reflect-x"),
             QByteArrayLiteral("reflect-y")}),
         PropertyDefinition(QByteArrayLiteral("IN_FORMATS"), Requirement::Optional),
+        PropertyDefinition(QByteArrayLiteral("IN_FENCE_FD"), Requirement::Optional),
         }, DRM_MODE_OBJECT_PLANE)
 {
 }
@@ -165,7 +166,8 @@ void DrmPlane::setBuffer(DrmBuffer *buffer)
 
 bool DrmPlane::needsModeset() const
 {
-    if (!gpu()->atomicModeSetting() || type() == TypeIndex::Cursor) {
+    // cursor and overlay planes can be turned on and off without a modeset
+    if (!gpu()->atomicModeSetting() || type() == TypeIndex::Cursor || type() == TypeIndex::Overlay) {
         return false;
     }
     auto rotation = getProp(PropertyIndex::Rotation);
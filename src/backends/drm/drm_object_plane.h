@@ -40,6 +40,7 @@ public:
         CrtcId,
         Rotation,
         In_Formats,
+        InFenceFd,
         Count
     };
     Q_ENUM(PropertyIndex)
@@ -24,8 +24,6 @@
 #include "screens.h"
 #include "session.h"
 #include "waylandoutputconfig.h"
-#include "dumb_swapchain.h"
-#include "cursor.h"
 // Qt
 #include <QMatrix4x4>
 #include <QCryptographicHash>
@@ -48,6 +46,13 @@ DrmOutput::DrmOutput(DrmPipeline *pipeline)
     m_pipeline->setOutput(this);
     auto conn = m_pipeline->connector();
     m_renderLoop->setRefreshRate(conn->currentMode()->refreshRate());
+    // Opt-in: let the next frame be rendered while the previous one still waits for its
+    // page flip. Only atomic commits carry the render fence, so the kernel waits for the
+    // GPU instead of the compositor.
+    static const bool renderAhead = qEnvironmentVariableIntValue("KWIN_DRM_RENDER_AHEAD") == 1;
+    if (renderAhead && m_gpu->atomicModeSetting()) {
+        RenderLoopPrivate::get(m_renderLoop)->maxPendingFrameCount = 2;
+    }
     setSubPixelInternal(conn->subpixel());
     setInternal(conn->isInternal());
     setCapabilityInternal(DrmOutput::Capability::Dpms);
@@ -73,6 +78,9 @@ DrmOutput::DrmOutput(DrmPipeline *pipeline)
 
     connect(Cursors::self(), &Cursors::currentCursorChanged, this, &DrmOutput::updateCursor);
     connect(Cursors::self(), &Cursors::positionChanged, this, &DrmOutput::moveCursor);
+    connect(Cursors::self()->mouse(), &Cursor::themeChanged, this, [this]() {
+        m_cursorSprites.clear();
+    });
 }
 
 DrmOutput::~DrmOutput()
@@ -111,52 +119,71 @@ void DrmOutput::updateCursor()
         m_pipeline->setCursor(nullptr);
         return;
     }
-    if (m_cursor && m_cursor->isEmpty()) {
-        m_pipeline->setCursor(nullptr);
-        return;
-    }
     const auto plane = m_pipeline->pending.crtc->cursorPlane();
-    if (!m_cursor || (plane && !plane->formats().value(m_cursor->drmFormat()).contains(DRM_FORMAT_MOD_LINEAR))) {
+    if (!m_cursorFormat || (plane && !plane->formats().value(m_cursorFormat).contains(DRM_FORMAT_MOD_LINEAR))) {
+        m_cursorSprites.clear();
+        m_cursorFormat = 0;
         if (plane) {
             const auto formatModifiers = plane->formats();
-            const auto formats = formatModifiers.keys();
-            for (uint32_t format : formats) {
-                if (!formatModifiers[format].contains(DRM_FORMAT_MOD_LINEAR)) {
-                    continue;
-                }
-                m_cursor = QSharedPointer<DumbSwapchain>::create(m_gpu, m_gpu->cursorSize(), format, QImage::Format::Format_ARGB32_Premultiplied);
-                if (!m_cursor->isEmpty()) {
+            for (auto it = formatModifiers.constBegin(); it != formatModifiers.constEnd(); it++) {
+                if (it.value().contains(DRM_FORMAT_MOD_LINEAR)) {
+                    m_cursorFormat = it.key();
                     break;
                 }
             }
         } else {
-            m_cursor = QSharedPointer<DumbSwapchain>::create(m_gpu, m_gpu->cursorSize(), DRM_FORMAT_XRGB8888, QImage::Format::Format_ARGB32_Premultiplied);
+            m_cursorFormat = DRM_FORMAT_XRGB8888;
         }
-        if (!m_cursor || m_cursor->isEmpty()) {
+        if (!m_cursorFormat) {
             m_pipeline->setCursor(nullptr);
             m_setCursorSuccessful = false;
             return;
         }
     }
-    m_cursor->releaseBuffer(m_cursor->currentBuffer());
-    m_cursor->acquireBuffer();
-    QImage *c = m_cursor->currentBuffer()->image();
-    c->setDevicePixelRatio(scale());
-    if (!isCursorSpriteCompatible(c, &cursorImage)) {
+    const QSharedPointer<DrmDumbBuffer> sprite = cursorSprite(cursor, cursorImage);
+    if (!sprite) {
         // If the cursor image is too big, fall back to rendering the software cursor.
         m_pipeline->setCursor(nullptr);
         m_setCursorSuccessful = false;
         return;
     }
+    m_setCursorSuccessful = m_pipeline->setCursor(sprite, logicalToNativeMatrix(cursor->rect(), scale(), transform()).map(cursor->hotspot()));
+    moveCursor();
+}
+
+QSharedPointer<DrmDumbBuffer> DrmOutput::cursorSprite(const Cursor *cursor, const QImage &image)
+{
+    if (m_cursorSpriteScale != scale() || m_cursorSpriteTransform != transform()) {
+        m_cursorSprites.clear();
+        m_cursorSpriteScale = scale();
+        m_cursorSpriteTransform = transform();
+    }
+    // the frames of animated cursors keep their images, so they are only painted once
+    if (const auto sprite = m_cursorSprites.value(image.cacheKey())) {
+        return sprite;
+    }
+    const auto sprite = QSharedPointer<DrmDumbBuffer>::create(m_gpu, m_gpu->cursorSize(), m_cursorFormat);
+    if (!sprite->bufferId() || !sprite->map(QImage::Format_ARGB32_Premultiplied)) {
+        return nullptr;
+    }
+    QImage *c = sprite->image();
+    c->setDevicePixelRatio(scale());
+    if (!isCursorSpriteCompatible(c, &image)) {
+        return nullptr;
+    }
     c->fill(Qt::transparent);
     QPainter p;
     p.begin(c);
     p.setWorldTransform(logicalToNativeMatrix(cursor->rect(), 1, transform()).toTransform());
     p.setRenderHint(QPainter::SmoothPixmapTransform);
-    p.drawImage(QPoint(0, 0), cursorImage);
+    p.drawImage(QPoint(0, 0), image);
     p.end();
-    m_setCursorSuccessful = m_pipeline->setCursor(m_cursor->currentBuffer(), logicalToNativeMatrix(cursor->rect(), scale(), transform()).map(cursor->hotspot()));
-    moveCursor();
+
+    if (m_cursorSprites.count() >= s_maxCursorSprites) {
+        m_cursorSprites.clear();
+    }
+    m_cursorSprites.insert(image.cacheKey(), sprite);
+    return sprite;
 }
 
 void DrmOutput::moveCursor()
@@ -363,7 +390,19 @@ int DrmOutput::gammaRampSize() const
 
 bool DrmOutput::setGammaRamp(const GammaRamp &gamma)
 {
+    const auto previous = m_pipeline->pending.gamma;
+    if (previous && previous->matches(gamma)) {
+        // keep the existing blob, nothing changes
+        return true;
+    }
     m_pipeline->pending.gamma = QSharedPointer<DrmGammaRamp>::create(m_gpu, gamma);
+    if (m_gpu->atomicModeSetting() && previous && previous->size() == gamma.size() && m_pipeline->pending.gamma->blobId()) {
+        // The crtc already accepted a LUT of this size, only the blob changes. That's a plain
+        // property change, it goes out with the next page flip without another test commit.
+        m_pipeline->applyPendingChanges();
+        m_renderLoop->scheduleRepaint();
+        return true;
+    }
     if (DrmPipeline::commitPipelines({m_pipeline}, DrmPipeline::CommitMode::Test)) {
         m_pipeline->applyPendingChanges();
         m_renderLoop->scheduleRepaint();
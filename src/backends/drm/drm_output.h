@@ -14,6 +14,7 @@
 #include "drm_object.h"
 #include "drm_object_plane.h"
 
+#include <QHash>
 #include <QObject>
 #include <QPoint>
 #include <QSize>
@@ -34,7 +35,6 @@ class DrmCrtc;
 class Cursor;
 class DrmGpu;
 class DrmPipeline;
-class DumbSwapchain;
 
 class KWIN_EXPORT DrmOutput : public DrmAbstractOutput
 {
@@ -77,11 +77,17 @@ private:
     bool setGammaRamp(const GammaRamp &gamma) override;
     void updateCursor();
     void moveCursor();
+    QSharedPointer<DrmDumbBuffer> cursorSprite(const Cursor *cursor, const QImage &image);
 
     DrmPipeline *m_pipeline;
     DrmConnector *m_connector;
 
-    QSharedPointer<DumbSwapchain> m_cursor;
+    // pre-rendered cursor sprites of the current cursor theme, by QImage::cacheKey()
+    QHash<qint64, QSharedPointer<DrmDumbBuffer>> m_cursorSprites;
+    static constexpr int s_maxCursorSprites = 64;
+    uint32_t m_cursorFormat = 0;
+    qreal m_cursorSpriteScale = 1;
+    Transform m_cursorSpriteTransform = Transform::Normal;
     bool m_setCursorSuccessful = false;
     bool m_moveCursorSuccessful = false;
     QRect m_lastCursorGeometry;
@@ -10,6 +10,7 @@
 #include "drm_pipeline.h"
 
 #include <errno.h>
+#include <unistd.h>
 
 #include "logging.h"
 #include "drm_gpu.h"
@@ -18,15 +19,19 @@
 #include "drm_object_plane.h"
 #include "drm_buffer.h"
 #include "cursor.h"
+#include "ftrace.h"
 #include "session.h"
 #include "drm_output.h"
 #include "drm_backend.h"
 #include "egl_gbm_backend.h"
 #include "drm_buffer_gbm.h"
+#include "drm_commit_thread.h"
 
 #include <gbm.h>
 #include <drm_fourcc.h>
 
+#include <algorithm>
+
 namespace KWin
 {
 
@@ -39,6 +44,7 @@ DrmPipeline::DrmPipeline(DrmConnector *conn)
 DrmPipeline::~DrmPipeline()
 {
     m_output = nullptr;
+    m_queuedBuffer = nullptr;
     if (m_pageflipPending && m_current.crtc) {
         pageFlipped({});
     }
@@ -46,9 +52,9 @@ DrmPipeline::~DrmPipeline()
 
 bool DrmPipeline::present(const QSharedPointer<DrmBuffer> &buffer)
 {
+    fTraceSlice("DrmPipeline::present");
     Q_ASSERT(pending.crtc);
     Q_ASSERT(buffer);
-    m_primaryBuffer = buffer;
     auto buf = dynamic_cast<DrmGbmBuffer*>(buffer.data());
     // with direct scanout disallow modesets, calling presentFailed() and logging warnings
     bool directScanout = buf && buf->clientBuffer();
@@ -56,22 +62,29 @@ bool DrmPipeline::present(const QSharedPointer<DrmBuffer> &buffer)
         if (directScanout) {
             return false;
         }
+        m_primaryBuffer = buffer;
         m_modesetPresentPending = true;
         return gpu()->maybeModeset();
     }
+    if (m_pageflipPending && gpu()->atomicModeSetting()) {
+        // with render-ahead the frame is committed as soon as the previous one has been flipped
+        if (!testScanoutBuffer(buffer)) {
+            if (!directScanout && m_output) {
+                m_output->presentFailed();
+            }
+            return false;
+        }
+        if (m_queuedBuffer && m_output) {
+            m_output->presentFailed();
+        }
+        m_queuedBuffer = buffer;
+        return true;
+    }
+    m_primaryBuffer = buffer;
     if (gpu()->atomicModeSetting()) {
         if (!commitPipelines({this}, CommitMode::Commit)) {
             // update properties and try again
-            m_connector->updateProperties();
-            if (pending.crtc) {
-                pending.crtc->updateProperties();
-                if (pending.crtc->primaryPlane()) {
-                    pending.crtc->primaryPlane()->updateProperties();
-                }
-                if (pending.crtc->cursorPlane()) {
-                    pending.crtc->cursorPlane()->updateProperties();
-                }
-            }
+            updateProperties();
             if (!commitPipelines({this}, CommitMode::Commit)) {
                 if (directScanout) {
                     return false;
@@ -162,9 +175,42 @@ bool DrmPipeline::commitPipelinesAtomic(const QVector<DrmPipeline*> &pipelines,
         qCDebug(KWIN_DRM) << "Atomic test for" << mode << "failed!" << strerror(errno);
         return failed();
     }
-    if (mode != CommitMode::Test && drmModeAtomicCommit(pipelines[0]->gpu()->fd(), req, flags, nullptr) != 0) {
-        qCCritical(KWIN_DRM) << "Atomic commit failed! This should never happen!" << strerror(errno);
-        return failed();
+    // An in-fence only applies to a single commit. The fds are closed once the commit has been
+    // submitted, so they can't be waited for or closed a second time.
+    const auto takeFences = [&pipelines]() {
+        QVector<int> fences;
+        for (const auto &pipeline : pipelines) {
+            if (pipeline->m_primaryBuffer && pipeline->m_primaryBuffer->fence() != -1) {
+                fences.append(pipeline->m_primaryBuffer->takeFence());
+            }
+        }
+        return fences;
+    };
+    DrmCommitThread *commitThread = pipelines[0]->gpu()->commitThread();
+    if (mode == CommitMode::Commit && commitThread) {
+        // the commit has passed the test, submit it without blocking the main thread
+        for (const auto &pipeline : pipelines) {
+            pipeline->atomicCommitSuccessful(mode);
+        }
+        for (const auto &obj : unusedObjects) {
+            obj->commitPending();
+            obj->commit();
+        }
+        commitThread->commit(req, flags, pipelines, takeFences());
+        return true;
+    }
+    if (mode != CommitMode::Test) {
+        if (commitThread) {
+            // blocking commits must not overtake the queued ones
+            commitThread->waitIdle();
+        }
+        if (drmModeAtomicCommit(pipelines[0]->gpu()->fd(), req, flags, nullptr) != 0) {
+            qCCritical(KWIN_DRM) << "Atomic commit failed! This should never happen!" << strerror(errno);
+            return failed();
+        }
+        for (const int fence : takeFences()) {
+            close(fence);
+        }
     }
     for (const auto &pipeline : pipelines) {
         pipeline->atomicCommitSuccessful(mode);
@@ -194,12 +240,22 @@ bool DrmPipeline::populateAtomicValues(drmModeAtomicReq *req, uint32_t &flags)
         auto modeSize = m_connector->modes().at(pending.modeIndex)->size();
         pending.crtc->primaryPlane()->set(QPoint(0, 0), m_primaryBuffer ? m_primaryBuffer->size() : bufferSize(), QPoint(0, 0), modeSize);
         pending.crtc->primaryPlane()->setBuffer(activePending() ? m_primaryBuffer.get() : nullptr);
+        // lets the kernel wait for rendering to finish instead of relying on implicit sync
+        pending.crtc->primaryPlane()->setPending(DrmPlane::PropertyIndex::InFenceFd, (activePending() && m_primaryBuffer) ? m_primaryBuffer->fence() : -1);
 
         if (pending.crtc->cursorPlane()) {
             pending.crtc->cursorPlane()->set(QPoint(0, 0), gpu()->cursorSize(), pending.cursorPos, gpu()->cursorSize());
             pending.crtc->cursorPlane()->setBuffer(activePending() ? pending.cursorBo.get() : nullptr);
             pending.crtc->cursorPlane()->setPending(DrmPlane::PropertyIndex::CrtcId, (activePending() && pending.cursorBo) ? pending.crtc->id() : 0);
         }
+        if (const auto overlayPlane = pending.crtc->overlayPlane()) {
+            const bool overlayVisible = activePending() && pending.overlayBuffer;
+            if (overlayVisible) {
+                overlayPlane->set(QPoint(0, 0), pending.overlayBuffer->size(), pending.overlayGeometry.topLeft(), pending.overlayGeometry.size());
+            }
+            overlayPlane->setBuffer(overlayVisible ? pending.overlayBuffer.get() : nullptr);
+            overlayPlane->setPending(DrmPlane::PropertyIndex::CrtcId, overlayVisible ? pending.crtc->id() : 0);
+        }
     }
     if (!m_connector->atomicPopulate(req)) {
         return false;
@@ -214,6 +270,9 @@ bool DrmPipeline::populateAtomicValues(drmModeAtomicReq *req, uint32_t &flags)
         if (pending.crtc->cursorPlane() && !pending.crtc->cursorPlane()->atomicPopulate(req)) {
             return false;
         }
+        if (pending.crtc->overlayPlane() && !pending.crtc->overlayPlane()->atomicPopulate(req)) {
+            return false;
+        }
     }
     return true;
 }
@@ -242,6 +301,9 @@ void DrmPipeline::prepareAtomicModeset()
     if (pending.crtc->cursorPlane()) {
         pending.crtc->cursorPlane()->setTransformation(DrmPlane::Transformation::Rotate0);
     }
+    if (pending.crtc->overlayPlane()) {
+        pending.crtc->overlayPlane()->setTransformation(DrmPlane::Transformation::Rotate0);
+    }
 }
 
 void DrmPipeline::atomicCommitFailed()
@@ -257,6 +319,9 @@ void DrmPipeline::atomicCommitFailed()
         if (pending.crtc->cursorPlane()) {
             pending.crtc->cursorPlane()->rollbackPending();
         }
+        if (pending.crtc->overlayPlane()) {
+            pending.crtc->overlayPlane()->rollbackPending();
+        }
     }
 }
 
@@ -270,6 +335,9 @@ void DrmPipeline::atomicCommitSuccessful(CommitMode mode)
         if (pending.crtc->cursorPlane()) {
             pending.crtc->cursorPlane()->commitPending();
         }
+        if (pending.crtc->overlayPlane()) {
+            pending.crtc->overlayPlane()->commitPending();
+        }
     }
     if (mode != CommitMode::Test) {
         if (activePending()) {
@@ -280,10 +348,20 @@ void DrmPipeline::atomicCommitSuccessful(CommitMode mode)
             pending.crtc->commit();
             pending.crtc->primaryPlane()->setNext(m_primaryBuffer);
             pending.crtc->primaryPlane()->commit();
+            if (const auto fence = pending.crtc->primaryPlane()->getProp(DrmPlane::PropertyIndex::InFenceFd)) {
+                // an in-fence only applies to a single commit
+                fence->setPending(-1);
+                fence->commitPending();
+                fence->commit();
+            }
             if (pending.crtc->cursorPlane()) {
                 pending.crtc->cursorPlane()->setNext(pending.cursorBo);
                 pending.crtc->cursorPlane()->commit();
             }
+            if (pending.crtc->overlayPlane()) {
+                pending.crtc->overlayPlane()->setNext(pending.overlayBuffer);
+                pending.crtc->overlayPlane()->commit();
+            }
         }
         m_current = pending;
         if (mode == CommitMode::CommitModeset && activePending()) {
@@ -339,6 +417,18 @@ bool DrmPipeline::checkTestBuffer()
     return false;
 }
 
+bool DrmPipeline::testScanoutBuffer(const QSharedPointer<DrmBuffer> &buffer)
+{
+    if (!gpu()->atomicModeSetting() || !pending.crtc || !activePending()) {
+        return true;
+    }
+    const auto oldBuffer = m_primaryBuffer;
+    m_primaryBuffer = buffer;
+    const bool ret = commitPipelines({this}, CommitMode::Test);
+    m_primaryBuffer = oldBuffer;
+    return ret;
+}
+
 bool DrmPipeline::setCursor(const QSharedPointer<DrmDumbBuffer> &buffer, const QPoint &hotspot)
 {
     if (pending.cursorBo == buffer && pending.cursorHotspot == hotspot) {
@@ -351,6 +441,10 @@ bool DrmPipeline::setCursor(const QSharedPointer<DrmDumbBuffer> &buffer, const Q
     // explicitly check for the cursor plane and not for AMS, as we might not always have one
     if (pending.crtc->cursorPlane()) {
         result = commitPipelines({this}, CommitMode::Test);
+        if (result && updateCursorAsync(true)) {
+            m_next = pending;
+            return true;
+        }
     } else {
         result = setCursorLegacy();
     }
@@ -373,8 +467,21 @@ bool DrmPipeline::moveCursor(QPoint pos)
     const bool visibleBefore = isCursorVisible();
     bool result;
     pending.cursorPos = pos;
+    // While the cursor stays outside of this output, moving it in hardware can't be seen. With
+    // several outputs that would otherwise cost each of them an update for every pointer motion.
+    // The position is still committed with the next frame or the next visible move.
+    const bool hiddenMove = !visibleBefore && !isCursorVisible();
     // explicitly check for the cursor plane and not for AMS, as we might not always have one
+    if (hiddenMove && (!pending.crtc->cursorPlane() || canUpdateCursorAsync())) {
+        m_next = pending;
+        return true;
+    }
     if (pending.crtc->cursorPlane()) {
+        // only the position changes, the cursor image has already passed the test in setCursor()
+        if (updateCursorAsync(false)) {
+            m_next = pending;
+            return true;
+        }
         result = commitPipelines({this}, CommitMode::Test);
     } else {
         result = moveCursorLegacy();
@@ -390,6 +497,59 @@ bool DrmPipeline::moveCursor(QPoint pos)
     return result;
 }
 
+bool DrmPipeline::canUpdateCursorAsync() const
+{
+    // the cursor can only be updated on its own while the crtc is lit up with the pending configuration
+    return gpu()->commitThread() && pending.crtc && pending.crtc == m_current.crtc && m_current.active && activePending();
+}
+
+bool DrmPipeline::updateCursorAsync(bool setImage)
+{
+    if (!canUpdateCursorAsync()) {
+        return false;
+    }
+    // the next frame commits the same cursor state atomically, so the tracked properties stay valid
+    gpu()->commitThread()->updateCursor(pending.crtc->id(), pending.cursorBo, pending.cursorHotspot, pending.cursorPos, setImage);
+    return true;
+}
+
+bool DrmPipeline::setOverlay(const QSharedPointer<DrmBuffer> &buffer, const QRect &geometry)
+{
+    if (pending.overlayBuffer == buffer && pending.overlayGeometry == geometry) {
+        return true;
+    }
+    if (!buffer) {
+        // turning a plane off never fails
+        pending.overlayBuffer = nullptr;
+        pending.overlayGeometry = QRect();
+        m_next = pending;
+        return true;
+    }
+    // the overlay geometry is in the coordinate system of the crtc, it's not transformed
+    if (!pending.crtc || !pending.crtc->overlayPlane() || pending.bufferTransformation != DrmPlane::Transformation::Rotate0) {
+        return false;
+    }
+    pending.overlayBuffer = buffer;
+    pending.overlayGeometry = geometry;
+    if (commitPipelines({this}, CommitMode::Test)) {
+        m_next = pending;
+        return true;
+    } else {
+        pending = m_next;
+        return false;
+    }
+}
+
+bool DrmPipeline::isOverlayFormatSupported(uint32_t drmFormat, uint64_t modifier) const
+{
+    if (!pending.crtc || !pending.crtc->overlayPlane()) {
+        return false;
+    }
+    const auto formats = pending.crtc->overlayPlane()->formats();
+    const auto it = formats.constFind(drmFormat);
+    return it != formats.constEnd() && (modifier == DRM_FORMAT_MOD_INVALID || it->contains(modifier));
+}
+
 void DrmPipeline::applyPendingChanges()
 {
     if (!pending.crtc) {
@@ -434,6 +594,7 @@ DrmGpu *DrmPipeline::gpu() const
 
 void DrmPipeline::pageFlipped(std::chrono::nanoseconds timestamp)
 {
+    fTraceInstant("DrmPipeline::pageFlipped", m_output ? m_output->name() : QString());
     m_current.crtc->flipBuffer();
     if (m_current.crtc->primaryPlane()) {
         m_current.crtc->primaryPlane()->flipBuffer();
@@ -441,10 +602,66 @@ void DrmPipeline::pageFlipped(std::chrono::nanoseconds timestamp)
     if (m_current.crtc->cursorPlane()) {
         m_current.crtc->cursorPlane()->flipBuffer();
     }
+    if (m_current.crtc->overlayPlane()) {
+        m_current.crtc->overlayPlane()->flipBuffer();
+    }
     m_pageflipPending = false;
     if (m_output) {
         m_output->pageFlipped(timestamp);
     }
+    if (m_queuedBuffer) {
+        m_primaryBuffer = m_queuedBuffer;
+        m_queuedBuffer = nullptr;
+        if (!commitPipelines({this}, CommitMode::Commit) && m_output) {
+            m_output->presentFailed();
+        }
+    }
+}
+
+void DrmPipeline::updateProperties()
+{
+    m_connector->updateProperties();
+    if (pending.crtc) {
+        pending.crtc->updateProperties();
+        if (pending.crtc->primaryPlane()) {
+            pending.crtc->primaryPlane()->updateProperties();
+        }
+        if (pending.crtc->cursorPlane()) {
+            pending.crtc->cursorPlane()->updateProperties();
+        }
+        if (pending.crtc->overlayPlane()) {
+            pending.crtc->overlayPlane()->updateProperties();
+        }
+    }
+}
+
+void DrmPipeline::asyncCommitFailed()
+{
+    // the kernel state is not what we think it is, read it back
+    m_connector->updateProperties();
+    if (m_current.crtc) {
+        m_current.crtc->updateProperties();
+        m_current.crtc->primaryPlane()->updateProperties();
+        if (m_current.crtc->cursorPlane()) {
+            m_current.crtc->cursorPlane()->updateProperties();
+        }
+        if (m_current.crtc->overlayPlane()) {
+            m_current.crtc->overlayPlane()->updateProperties();
+        }
+    }
+    if (m_pageflipPending) {
+        // there won't be a page flip event for this commit
+        m_pageflipPending = false;
+        if (m_output) {
+            m_output->presentFailed();
+        }
+    }
+    if (m_queuedBuffer) {
+        m_queuedBuffer = nullptr;
+        if (m_output) {
+            m_output->presentFailed();
+        }
+    }
 }
 
 void DrmPipeline::setOutput(DrmOutput *output)
@@ -457,6 +674,23 @@ DrmOutput *DrmPipeline::output() const
     return m_output;
 }
 
+QVector<uint64_t> DrmPipeline::configurationKey() const
+{
+    return {
+        m_connector->id(),
+        pending.crtc ? pending.crtc->id() : 0,
+        uint64_t(pending.enabled) | uint64_t(pending.active) << 1 | uint64_t(bool(pending.cursorBo)) << 2
+            | uint64_t(bool(pending.overlayBuffer)) << 3 | uint64_t(bool(pending.gamma)) << 4,
+        uint64_t(pending.modeIndex),
+        pending.overscan,
+        uint64_t(pending.rgbRange),
+        uint64_t(pending.syncMode),
+        uint64_t(pending.bufferTransformation),
+        m_primaryBuffer ? m_primaryBuffer->format() : 0,
+        m_primaryBuffer ? m_primaryBuffer->modifier() : 0,
+    };
+}
+
 static const QMap<uint32_t, QVector<uint64_t>> legacyFormats = {
     {DRM_FORMAT_XRGB8888, {}},
     {DRM_FORMAT_ARGB8888, {}}
@@ -567,6 +801,12 @@ uint32_t DrmGammaRamp::blobId() const
     return m_blobId;
 }
 
+bool DrmGammaRamp::matches(const GammaRamp &lut) const
+{
+    // the three channels are stored contiguously
+    return m_lut.size() == lut.size() && std::equal(m_lut.red(), m_lut.red() + 3 * m_lut.size(), lut.red());
+}
+
 uint32_t DrmGammaRamp::size() const
 {
     return m_lut.size();
@@ -642,6 +882,13 @@ void DrmPipeline::printDebugInfo() const
         if (pending.crtc->cursorPlane()) {
             printProps(pending.crtc->cursorPlane(), PrintMode::All);
         }
+        if (pending.crtc->overlayPlane()) {
+            printProps(pending.crtc->overlayPlane(), PrintMode::All);
+        }
+    }
+    if (m_primaryBuffer) {
+        qCDebug(KWIN_DRM).nospace() << "Primary buffer: format " << Qt::hex << m_primaryBuffer->format()
+                                    << ", modifier " << m_primaryBuffer->modifier() << Qt::dec;
     }
 }
 
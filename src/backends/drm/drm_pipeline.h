@@ -43,6 +43,11 @@ public:
     uint16_t *blue() const;
     uint32_t blobId() const;
 
+    /**
+     * Returns @c true if this gamma ramp has the same size and values as @a lut.
+     */
+    bool matches(const GammaRamp &lut) const;
+
 private:
     DrmGpu *m_gpu;
     const GammaRamp m_lut;
@@ -58,21 +63,50 @@ public:
     /**
      * tests the pending commit first and commits it if the test passes
      * if the test fails, there is a guarantee for no lasting changes
+     *
+     * If a page flip is still pending, the buffer is committed once it has happened. This only
+     * happens if the render loop of the output allows more than one frame in flight.
      */
     bool present(const QSharedPointer<DrmBuffer> &buffer);
 
     bool needsModeset() const;
+    /**
+     * Reads the properties of the connector, crtc and planes of the pipeline back from the
+     * kernel, for example after someone else has changed them.
+     */
+    void updateProperties();
     void applyPendingChanges();
     void revertPendingChanges();
 
     bool setCursor(const QSharedPointer<DrmDumbBuffer> &buffer, const QPoint &hotspot = QPoint());
     bool moveCursor(QPoint pos);
 
+    /**
+     * Shows @a buffer on the overlay plane of the crtc, scaled to @a geometry in device
+     * pixels, starting with the next present. The new configuration is validated with a
+     * test commit; if the crtc has no overlay plane or the driver rejects it, nothing
+     * changes and @c false is returned. Passing a null buffer hides the overlay plane.
+     */
+    bool setOverlay(const QSharedPointer<DrmBuffer> &buffer, const QRect &geometry);
+    bool isOverlayFormatSupported(uint32_t drmFormat, uint64_t modifier) const;
+
+    /**
+     * Checks with an atomic test commit whether @a buffer can be scanned out on the primary
+     * plane in the pending configuration. Returns @c true if the test can't be done, for
+     * example with legacy modesetting or with an inactive pipeline.
+     */
+    bool testScanoutBuffer(const QSharedPointer<DrmBuffer> &buffer);
+
     DrmConnector *connector() const;
     DrmCrtc *currentCrtc() const;
     DrmGpu *gpu() const;
 
     void pageFlipped(std::chrono::nanoseconds timestamp);
+    /**
+     * Called on the main thread if a commit that has been handed to the commit thread
+     * was rejected by the kernel after it passed the atomic test.
+     */
+    void asyncCommitFailed();
     bool pageflipPending() const;
     bool modesetPresentPending() const;
     void resetModesetPresentPending();
@@ -93,6 +127,13 @@ public:
     void setOutput(DrmOutput *output);
     DrmOutput *output() const;
 
+    /**
+     * Returns a key that identifies the pending configuration of this pipeline, as far as
+     * it matters for the outcome of an atomic test. Cursor and overlay positions are left
+     * out, only whether they're visible is taken into account.
+     */
+    QVector<uint64_t> configurationKey() const;
+
     struct State {
         DrmCrtc *crtc = nullptr;
         bool active = true; // whether or not the pipeline should be currently used
@@ -107,6 +148,10 @@ public:
         QPoint cursorHotspot;
         QSharedPointer<DrmDumbBuffer> cursorBo;
 
+        QSharedPointer<DrmBuffer> overlayBuffer;
+        // where the overlay buffer is shown, in device pixels
+        QRect overlayGeometry;
+
         // the transformation that this pipeline will apply to submitted buffers
         DrmPlane::Transformations bufferTransformation = DrmPlane::Transformation::Rotate0;
         // the transformation that buffers submitted to the pipeline should have
@@ -132,6 +177,12 @@ private:
     bool legacyModeset();
     bool applyPendingChangesLegacy();
     bool setCursorLegacy();
+    /**
+     * Hands the pending cursor state to the commit thread, which applies it right away
+     * instead of with the next frame. Returns @c false if that's not possible.
+     */
+    bool canUpdateCursorAsync() const;
+    bool updateCursorAsync(bool setImage);
     bool moveCursorLegacy();
     static bool commitPipelinesLegacy(const QVector<DrmPipeline*> &pipelines, CommitMode mode);
 
@@ -152,6 +203,8 @@ private:
 
     QSharedPointer<DrmBuffer> m_primaryBuffer;
     QSharedPointer<DrmBuffer> m_oldTestBuffer;
+    // a frame that has been presented while the previous one was still waiting for its page flip
+    QSharedPointer<DrmBuffer> m_queuedBuffer;
     bool m_pageflipPending = false;
     bool m_modesetPresentPending = false;
 
@@ -100,13 +100,14 @@ QVector<uint64_t> DrmVirtualOutput::supportedModifiers(uint32_t drmFormat) const
 
 int DrmVirtualOutput::gammaRampSize() const
 {
-    return 200;
+    // there is no crtc, the gamma ramp is applied in the shadow buffer pass instead
+    return 0;
 }
 
 bool DrmVirtualOutput::setGammaRamp(const GammaRamp &gamma)
 {
     Q_UNUSED(gamma);
-    return true;
+    return false;
 }
 
 bool DrmVirtualOutput::needsSoftwareTransformation() const
@@ -28,11 +28,13 @@
 #include "drm_pipeline.h"
 #include "drm_abstract_output.h"
 #include "egl_dmabuf.h"
+#include "eglnativefence.h"
 // kwin libs
 #include <kwinglplatform.h>
 #include <kwineglimagetexture.h>
 // system
 #include <gbm.h>
+#include <cmath>
 #include <unistd.h>
 #include <errno.h>
 #include <drm_fourcc.h>
@@ -44,6 +46,22 @@
 namespace KWin
 {
 
+/**
+ * Returns the gamma ramp that has to be applied to the contents of the @a output in the
+ * shadow buffer pass because the crtc can't, or @c null if there is none.
+ */
+static const GammaRamp *softwareGammaRamp(DrmAbstractOutput *output)
+{
+    const ColorManager *colorManager = ColorManager::self();
+    const ColorDevice *device = colorManager ? colorManager->findDevice(output) : nullptr;
+    return device ? device->softwareGammaRamp() : nullptr;
+}
+
+static bool needsShadowBuffer(DrmAbstractOutput *output)
+{
+    return output->needsSoftwareTransformation() || softwareGammaRamp(output);
+}
+
 EglGbmBackend::EglGbmBackend(DrmBackend *drmBackend, DrmGpu *gpu)
     : AbstractEglBackend(gpu->deviceId())
     , m_backend(drmBackend)
@@ -71,6 +89,11 @@ void EglGbmBackend::cleanupRenderData(Output::RenderData &render)
 {
     render.gbmSurface = nullptr;
     render.importSwapchain = nullptr;
+    if (!render.blitBuffers.isEmpty()) {
+        // the textures and framebuffers belong to the context of the rendering GPU
+        renderingBackend()->makeCurrent();
+        render.blitBuffers.clear();
+    }
     if (render.shadowBuffer) {
         makeContextCurrent(render);
         render.shadowBuffer = nullptr;
@@ -162,12 +185,13 @@ bool EglGbmBackend::resetOutput(Output &output)
     QSharedPointer<GbmSurface> gbmSurface;
     bool modifiersEnvSet = false;
     static bool modifiersEnv = qEnvironmentVariableIntValue("KWIN_DRM_USE_MODIFIERS", &modifiersEnvSet) != 0;
-    static bool allowModifiers = (gpu()->isNVidia() && !modifiersEnvSet) || (modifiersEnvSet && modifiersEnv);
+    static bool allowModifiers = !modifiersEnvSet || modifiersEnv;
+    output.rejectedModifiers.remove(format);
 #if HAVE_GBM_BO_GET_FD_FOR_PLANE
-    if (!allowModifiers) {
+    if (!allowModifiers || modifiers.isEmpty()) {
 #else
     // modifiers have to be disabled with multi-gpu if gbm_bo_get_fd_for_plane is not available
-    if (!allowModifiers || output.output->gpu() != m_gpu) {
+    if (!allowModifiers || modifiers.isEmpty() || output.output->gpu() != m_gpu) {
 #endif
         int flags = GBM_BO_USE_RENDERING;
         if (output.output->gpu() == m_gpu) {
@@ -176,6 +200,8 @@ bool EglGbmBackend::resetOutput(Output &output)
             flags |= GBM_BO_USE_LINEAR;
         }
         gbmSurface = QSharedPointer<GbmSurface>::create(m_gpu, size, format, flags, m_configs[format]);
+    } else if (output.output->gpu() == m_gpu) {
+        gbmSurface = createScanoutSurface(output, format, modifiers);
     } else {
         gbmSurface = QSharedPointer<GbmSurface>::create(m_gpu, size, format, modifiers, m_configs[format]);
         if (!gbmSurface->isValid()) {
@@ -194,8 +220,9 @@ bool EglGbmBackend::resetOutput(Output &output)
     output.current = {};
     output.current.format = gbmFormat.value();
     output.current.gbmSurface = gbmSurface;
+    output.current.supportedModifiers = output.output->supportedModifiers(format);
 
-    if (!output.output->needsSoftwareTransformation())  {
+    if (!needsShadowBuffer(output.output))  {
         output.current.shadowBuffer = nullptr;
     } else {
         makeContextCurrent(output.current);
@@ -207,6 +234,44 @@ bool EglGbmBackend::resetOutput(Output &output)
     return true;
 }
 
+QSharedPointer<GbmSurface> EglGbmBackend::createScanoutSurface(Output &output, uint32_t format, QVector<uint64_t> modifiers)
+{
+    const QSize size = output.output->bufferSize();
+    const auto drmOutput = qobject_cast<DrmOutput *>(output.output);
+    // The driver picks the best modifier out of the list, which usually is a compressed or
+    // tiled one. If the atomic test rejects the buffer, for example because of bandwidth
+    // limits, that modifier gets dropped and the driver picks the next best one, until
+    // the list is exhausted. Implicit modifiers are the last resort.
+    while (!modifiers.isEmpty()) {
+        const auto gbmSurface = QSharedPointer<GbmSurface>::create(m_gpu, size, format, modifiers, m_configs[format]);
+        if (!gbmSurface->isValid()) {
+            break;
+        }
+        if (!drmOutput) {
+            return gbmSurface;
+        }
+        if (eglMakeCurrent(eglDisplay(), gbmSurface->eglSurface(), gbmSurface->eglSurface(), context()) == EGL_FALSE) {
+            qCCritical(KWIN_DRM) << "eglMakeCurrent failed:" << getEglErrorString();
+            break;
+        }
+        glClear(GL_COLOR_BUFFER_BIT);
+        const auto buffer = gbmSurface->swapBuffersForDrm();
+        if (!buffer) {
+            break;
+        }
+        if (drmOutput->pipeline()->testScanoutBuffer(buffer)) {
+            qCDebug(KWIN_DRM).nospace() << "Using modifier " << Qt::hex << buffer->modifier() << Qt::dec << " for output " << output.output->name();
+            return gbmSurface;
+        }
+        qCDebug(KWIN_DRM).nospace() << "Modifier " << Qt::hex << buffer->modifier() << Qt::dec << " was rejected for output " << output.output->name();
+        output.rejectedModifiers[format] << buffer->modifier();
+        if (!modifiers.removeOne(buffer->modifier())) {
+            break;
+        }
+    }
+    return QSharedPointer<GbmSurface>::create(m_gpu, size, format, GBM_BO_USE_RENDERING | GBM_BO_USE_SCANOUT, m_configs[format]);
+}
+
 bool EglGbmBackend::addOutput(DrmAbstractOutput *drmOutput)
 {
     Output newOutput;
@@ -230,11 +295,22 @@ void EglGbmBackend::removeOutput(DrmAbstractOutput *drmOutput)
     m_outputs.remove(drmOutput);
 }
 
-bool EglGbmBackend::swapBuffers(DrmAbstractOutput *drmOutput, const QRegion &dirty)
+bool EglGbmBackend::swapBuffers(DrmAbstractOutput *drmOutput, const QRegion &dirty, GLRenderTarget *blitTarget)
 {
     Q_ASSERT(m_outputs.contains(drmOutput));
     Output &output = m_outputs[drmOutput];
     renderFramebufferToSurface(output);
+    if (blitTarget) {
+        // the back buffer is only defined until the buffers are swapped. The framebuffer
+        // is upside down compared to the texture of the target, so flip it while copying
+        const QSize size = output.output->bufferSize();
+        GLRenderTarget::pushRenderTarget(blitTarget);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, size.width(), size.height(),
+                          0, size.height(), size.width(), 0,
+                          GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        GLRenderTarget::popRenderTarget();
+    }
     if (output.current.gbmSurface->swapBuffers()) {
         cleanupRenderData(output.old);
         updateBufferAge(output, dirty);
@@ -295,12 +371,87 @@ bool EglGbmBackend::exportFramebufferAsDmabuf(DrmAbstractOutput *drmOutput, int
     return true;
 }
 
+bool EglGbmBackend::createBlitBuffers(Output &output) const
+{
+    if (!GLRenderTarget::blitSupported()) {
+        return false;
+    }
+    EglGbmBackend *backend = renderingBackend();
+    const QSize size = output.output->bufferSize();
+    const uint32_t format = backend->drmFormat(output.output);
+    const bool is10bpc = format == DRM_FORMAT_XRGB2101010 || format == DRM_FORMAT_ARGB2101010;
+    backend->makeCurrent();
+    // one buffer is on the screen, one may wait for the next vblank and one is painted into
+    for (int i = 0; i < 3; i++) {
+        gbm_bo *bo = gbm_bo_create(m_gpu->gbmDevice(), size.width(), size.height(), format, GBM_BO_USE_SCANOUT | GBM_BO_USE_LINEAR);
+        if (!bo) {
+            return false;
+        }
+        const auto buffer = QSharedPointer<DrmGbmBuffer>::create(m_gpu, bo, nullptr);
+        const int fd = gbm_bo_get_fd(bo);
+        if (!buffer->bufferId() || fd < 0) {
+            return false;
+        }
+        const EGLint attribs[] = {
+            EGL_WIDTH, size.width(),
+            EGL_HEIGHT, size.height(),
+            EGL_LINUX_DRM_FOURCC_EXT, EGLint(format),
+            EGL_DMA_BUF_PLANE0_FD_EXT, fd,
+            EGL_DMA_BUF_PLANE0_OFFSET_EXT, 0,
+            EGL_DMA_BUF_PLANE0_PITCH_EXT, EGLint(gbm_bo_get_stride(bo)),
+            EGL_NONE
+        };
+        EGLImageKHR image = eglCreateImageKHR(backend->eglDisplay(), EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT, nullptr, attribs);
+        close(fd);
+        if (image == EGL_NO_IMAGE_KHR) {
+            return false;
+        }
+        const auto texture = QSharedPointer<EGLImageTexture>::create(backend->eglDisplay(), image, is10bpc ? GL_RGB10_A2 : GL_RGBA8, size);
+        const auto renderTarget = QSharedPointer<GLRenderTarget>::create(*texture);
+        if (!renderTarget->valid()) {
+            return false;
+        }
+        output.current.blitBuffers << BlitBuffer{buffer, texture, renderTarget};
+    }
+    return true;
+}
+
 QSharedPointer<DrmBuffer> EglGbmBackend::importFramebuffer(Output &output, const QRegion &dirty) const
 {
-    if (!renderingBackend()->swapBuffers(output.output, dirty)) {
+    if (output.current.importMode == ImportMode::Blit) {
+        if (!output.current.blitBuffers.isEmpty() && output.current.blitBuffers.first().buffer->size() != output.output->bufferSize()) {
+            renderingBackend()->makeCurrent();
+            output.current.blitBuffers.clear();
+        }
+        if (output.current.blitBuffers.isEmpty() && !createBlitBuffers(output)) {
+            qCDebug(KWIN_DRM) << "import with a blit failed! Switching to CPU import on output" << output.output;
+            renderingBackend()->makeCurrent();
+            output.current.blitBuffers.clear();
+            output.current.importMode = ImportMode::DumbBuffer;
+        }
+    }
+    BlitBuffer *blitBuffer = nullptr;
+    if (output.current.importMode == ImportMode::Blit) {
+        blitBuffer = &output.current.blitBuffers[output.current.nextBlitBuffer];
+        output.current.nextBlitBuffer = (output.current.nextBlitBuffer + 1) % output.current.blitBuffers.count();
+    }
+    if (!renderingBackend()->swapBuffers(output.output, dirty, blitBuffer ? blitBuffer->renderTarget.data() : nullptr)) {
         qCWarning(KWIN_DRM) << "swapping buffers failed on output" << output.output;
         return nullptr;
     }
+    if (blitBuffer) {
+        // the buffer must not be scanned out before the copy has finished
+        if (renderingBackend()->supportsNativeFence()) {
+            EGLNativeFence fence(renderingBackend()->eglDisplay());
+            if (fence.isValid()) {
+                blitBuffer->buffer->setFence(dup(fence.fileDescriptor()));
+            }
+        } else {
+            glFinish();
+        }
+        output.importedFrames[int(ImportMode::Blit)]++;
+        return blitBuffer->buffer;
+    }
     const auto size = output.output->modeSize();
     if (output.current.importMode == ImportMode::Dmabuf) {
         struct gbm_import_fd_modifier_data data;
@@ -325,12 +476,14 @@ QSharedPointer<DrmBuffer> EglGbmBackend::importFramebuffer(Output &output, const
             if (importedBuffer) {
                 auto buffer = QSharedPointer<DrmGbmBuffer>::create(m_gpu, importedBuffer, nullptr);
                 if (buffer->bufferId() > 0) {
+                    output.importedFrames[int(ImportMode::Dmabuf)]++;
                     return buffer;
                 }
             }
         }
-        qCDebug(KWIN_DRM) << "import with dmabuf failed! Switching to CPU import on output" << output.output;
-        output.current.importMode = ImportMode::DumbBuffer;
+        // the frame has already been swapped, it's read back with the CPU this one time
+        qCDebug(KWIN_DRM) << "import with dmabuf failed! Switching to import with a blit on output" << output.output;
+        output.current.importMode = ImportMode::Blit;
     }
     // ImportMode::DumbBuffer
     if (!output.current.importSwapchain || output.current.importSwapchain->size() != size) {
@@ -343,6 +496,7 @@ QSharedPointer<DrmBuffer> EglGbmBackend::importFramebuffer(Output &output, const
     if (output.current.importSwapchain) {
         auto buffer = output.current.importSwapchain->acquireBuffer();
         if (renderingBackend()->exportFramebuffer(output.output, buffer->data(), size, buffer->stride())) {
+            output.importedFrames[int(ImportMode::DumbBuffer)]++;
             return buffer;
         }
     }
@@ -380,6 +534,17 @@ bool EglGbmBackend::makeContextCurrent(const Output::RenderData &render) const
     return true;
 }
 
+// Returns how well the ancillary buffers of @a config suit the scene. It clips windows with
+// the stencil buffer, and the opaque pass rejects hidden fragments with the depth buffer.
+static int ancillaryBufferScore(EGLDisplay display, EGLConfig config)
+{
+    EGLint stencilSize = 0;
+    EGLint depthSize = 0;
+    eglGetConfigAttrib(display, config, EGL_STENCIL_SIZE, &stencilSize);
+    eglGetConfigAttrib(display, config, EGL_DEPTH_SIZE, &depthSize);
+    return (stencilSize >= 8 ? 2 : 0) + (depthSize >= 16 ? 1 : 0);
+}
+
 bool EglGbmBackend::initBufferConfigs()
 {
     const EGLint config_attribs[] = {
@@ -418,6 +583,12 @@ bool EglGbmBackend::initBufferConfigs()
         eglGetConfigAttrib(eglDisplay(), configs[i], EGL_ALPHA_SIZE, &format.alphaSize);
 
         if (m_formats.contains(format)) {
+            // The configs with the smallest depth and stencil buffers are sorted first, pick a
+            // later one of the same format if it has the buffers that the scene can use.
+            EGLConfig &config = m_configs[format.drmFormat];
+            if (ancillaryBufferScore(eglDisplay(), configs[i]) > ancillaryBufferScore(eglDisplay(), config)) {
+                config = configs[i];
+            }
             continue;
         }
         m_formats << format;
@@ -528,6 +699,7 @@ QRegion EglGbmBackend::beginFrame(AbstractOutput *drmOutput)
         qCDebug(KWIN_DRM) << "Direct scanout stopped on output" << output.output->name();
     }
     output.scanoutSurface = nullptr;
+    output.scanoutBuffer = nullptr;
     if (output.scanoutCandidate.surface) {
         output.oldScanoutCandidate = output.scanoutCandidate.surface;
         output.scanoutCandidate = {};
@@ -551,14 +723,14 @@ bool EglGbmBackend::doesRenderFit(const Output &output, const Output::RenderData
     }
     if (!output.output->isFormatSupported(render.gbmSurface->format())
         || (!render.gbmSurface->modifiers().isEmpty()
-            && output.output->supportedModifiers(render.gbmSurface->format()) != render.gbmSurface->modifiers())) {
+            && output.output->supportedModifiers(render.gbmSurface->format()) != render.supportedModifiers)) {
         return false;
     }
     QSize surfaceSize = output.output->bufferSize();
     if (surfaceSize != render.gbmSurface->size()) {
         return false;
     }
-    bool needsTexture = output.output->needsSoftwareTransformation();
+    bool needsTexture = needsShadowBuffer(output.output);
     if (needsTexture) {
         return render.shadowBuffer && render.shadowBuffer->textureSize() == output.output->sourceSize();
     } else {
@@ -581,6 +753,7 @@ QRegion EglGbmBackend::prepareRenderingForOutput(Output &output)
     makeContextCurrent(output.current);
     if (output.current.shadowBuffer) {
         output.current.shadowBuffer->bind();
+        output.current.shadowBuffer->setGammaRamp(softwareGammaRamp(output.output));
     }
     setViewport(output);
 
@@ -599,8 +772,17 @@ QSharedPointer<DrmBuffer> EglGbmBackend::endFrameWithBuffer(AbstractOutput *drmO
     Output &output = m_outputs[drmOutput];
     if (isPrimary()) {
         renderFramebufferToSurface(output);
+        // the fence is handed to the kernel with the commit, so that neither we nor the
+        // kernel have to block until rendering has finished
+        QScopedPointer<EGLNativeFence> fence;
+        if (supportsNativeFence()) {
+            fence.reset(new EGLNativeFence(eglDisplay()));
+        }
         auto buffer = output.current.gbmSurface->swapBuffersForDrm();
         if (buffer) {
+            if (fence && fence->isValid()) {
+                buffer->setFence(dup(fence->fileDescriptor()));
+            }
             updateBufferAge(output, dirty);
         }
         return buffer;
@@ -631,11 +813,63 @@ void EglGbmBackend::updateBufferAge(Output &output, const QRegion &dirty)
     }
 }
 
-bool EglGbmBackend::scanout(AbstractOutput *drmOutput, SurfaceItem *surfaceItem)
+static bool isDirectScanoutDisabled()
 {
     static bool valid;
     static const bool directScanoutDisabled = qEnvironmentVariableIntValue("KWIN_DRM_NO_DIRECT_SCANOUT", &valid) == 1 && valid;
-    if (directScanoutDisabled) {
+    return directScanoutDisabled;
+}
+
+QSharedPointer<DrmGbmBuffer> EglGbmBackend::importClientBuffer(KWaylandServer::LinuxDmaBufV1ClientBuffer *buffer) const
+{
+    const auto planes = buffer->planes();
+    gbm_bo *importedBuffer;
+    if (planes.first().modifier != DRM_FORMAT_MOD_INVALID
+        || planes.first().offset > 0
+        || planes.count() > 1) {
+        if (!m_gpu->addFB2ModifiersSupported()) {
+            return nullptr;
+        }
+        gbm_import_fd_modifier_data data = {};
+        data.format = buffer->format();
+        data.width = (uint32_t) buffer->size().width();
+        data.height = (uint32_t) buffer->size().height();
+        data.num_fds = planes.count();
+        data.modifier = planes.first().modifier;
+        for (int i = 0; i < planes.count(); i++) {
+            data.fds[i] = planes[i].fd;
+            data.offsets[i] = planes[i].offset;
+            data.strides[i] = planes[i].stride;
+        }
+        importedBuffer = gbm_bo_import(m_gpu->gbmDevice(), GBM_BO_IMPORT_FD_MODIFIER, &data, GBM_BO_USE_SCANOUT);
+    } else {
+        auto plane = planes.first();
+        gbm_import_fd_data data = {};
+        data.fd = plane.fd;
+        data.width = (uint32_t) buffer->size().width();
+        data.height = (uint32_t) buffer->size().height();
+        data.stride = plane.stride;
+        data.format = buffer->format();
+        importedBuffer = gbm_bo_import(m_gpu->gbmDevice(), GBM_BO_IMPORT_FD, &data, GBM_BO_USE_SCANOUT);
+    }
+    if (!importedBuffer) {
+        if (errno != EINVAL) {
+            qCWarning(KWIN_DRM) << "Importing buffer for direct scanout failed:" << strerror(errno);
+        }
+        return nullptr;
+    }
+    auto bo = QSharedPointer<DrmGbmBuffer>::create(m_gpu, importedBuffer, buffer);
+    if (!bo->bufferId()) {
+        // buffer can't actually be scanned out. Mesa is supposed to prevent this from happening
+        // in gbm_bo_import but apparently that doesn't always work
+        return nullptr;
+    }
+    return bo;
+}
+
+bool EglGbmBackend::scanout(AbstractOutput *drmOutput, SurfaceItem *surfaceItem)
+{
+    if (isDirectScanoutDisabled()) {
         return false;
     }
     Q_ASSERT(m_outputs.contains(drmOutput));
@@ -655,7 +889,8 @@ bool EglGbmBackend::scanout(AbstractOutput *drmOutput, SurfaceItem *surfaceItem)
     }
     Output &output = m_outputs[drmOutput];
     const auto planes = buffer->planes();
-    if (buffer->size() != output.output->modeSize() || planes.isEmpty()) {
+    // the client buffer would bypass the software gamma ramp in the shadow buffer
+    if (buffer->size() != output.output->modeSize() || planes.isEmpty() || softwareGammaRamp(output.output)) {
         return false;
     }
     if (output.oldScanoutCandidate && output.oldScanoutCandidate != surface) {
@@ -683,7 +918,8 @@ bool EglGbmBackend::scanout(AbstractOutput *drmOutput, SurfaceItem *surfaceItem)
                     const auto trancheModifiers = it.value();
                     const auto drmModifiers = drmFormats[format];
                     for (const auto &mod : trancheModifiers) {
-                        if (drmModifiers.contains(mod) && !output.scanoutCandidate.attemptedFormats[format].contains(mod)) {
+                        if (drmModifiers.contains(mod) && !output.scanoutCandidate.attemptedFormats[format].contains(mod)
+                            && !output.rejectedModifiers[format].contains(mod)) {
                             scanoutTranche.formatTable[format] << mod;
                         }
                     }
@@ -702,41 +938,19 @@ bool EglGbmBackend::scanout(AbstractOutput *drmOutput, SurfaceItem *surfaceItem)
         return false;
     }
 
-    gbm_bo *importedBuffer;
-    if (planes.first().modifier != DRM_FORMAT_MOD_INVALID
-        || planes.first().offset > 0
-        || planes.count() > 1) {
-        if (!m_gpu->addFB2ModifiersSupported() || !output.output->supportedModifiers(buffer->format()).contains(planes.first().modifier)) {
-            sendFeedback();
-            return false;
-        }
-        gbm_import_fd_modifier_data data = {};
-        data.format = buffer->format();
-        data.width = (uint32_t) buffer->size().width();
-        data.height = (uint32_t) buffer->size().height();
-        data.num_fds = planes.count();
-        data.modifier = planes.first().modifier;
-        for (int i = 0; i < planes.count(); i++) {
-            data.fds[i] = planes[i].fd;
-            data.offsets[i] = planes[i].offset;
-            data.strides[i] = planes[i].stride;
-        }
-        importedBuffer = gbm_bo_import(m_gpu->gbmDevice(), GBM_BO_IMPORT_FD_MODIFIER, &data, GBM_BO_USE_SCANOUT);
-    } else {
-        auto plane = planes.first();
-        gbm_import_fd_data data = {};
-        data.fd = plane.fd;
-        data.width = (uint32_t) buffer->size().width();
-        data.height = (uint32_t) buffer->size().height();
-        data.stride = plane.stride;
-        data.format = buffer->format();
-        importedBuffer = gbm_bo_import(m_gpu->gbmDevice(), GBM_BO_IMPORT_FD, &data, GBM_BO_USE_SCANOUT);
+    if ((planes.first().modifier != DRM_FORMAT_MOD_INVALID || planes.first().offset > 0 || planes.count() > 1)
+        && !output.output->supportedModifiers(buffer->format()).contains(planes.first().modifier)) {
+        sendFeedback();
+        return false;
     }
-    if (!importedBuffer) {
+    // the atomic test already rejected this modifier for the swapchain
+    if (output.rejectedModifiers[buffer->format()].contains(planes.first().modifier)) {
+        sendFeedback();
+        return false;
+    }
+    const auto bo = importClientBuffer(buffer);
+    if (!bo) {
         sendFeedback();
-        if (errno != EINVAL) {
-            qCWarning(KWIN_DRM) << "Importing buffer for direct scanout failed:" << strerror(errno);
-        }
         return false;
     }
     // damage tracking for screen casting
@@ -752,13 +966,6 @@ bool EglGbmBackend::scanout(AbstractOutput *drmOutput, SurfaceItem *surfaceItem)
     } else {
         damage = output.output->geometry();
     }
-    auto bo = QSharedPointer<DrmGbmBuffer>::create(m_gpu, importedBuffer, buffer);
-    if (!bo->bufferId()) {
-        // buffer can't actually be scanned out. Mesa is supposed to prevent this from happening
-        // in gbm_bo_import but apparently that doesn't always work
-        sendFeedback();
-        return false;
-    }
     // ensure that a context is current like with normal presentation
     makeCurrent();
     if (output.output->present(bo, damage)) {
@@ -767,6 +974,7 @@ bool EglGbmBackend::scanout(AbstractOutput *drmOutput, SurfaceItem *surfaceItem)
             qCDebug(KWIN_DRM).nospace() << "Direct scanout starting on output " << output.output->name() << " for application \"" << path << "\"";
         }
         output.scanoutSurface = surface;
+        output.scanoutBuffer = bo;
         return true;
     } else {
         // TODO clean the modeset and direct scanout code paths up
@@ -777,6 +985,56 @@ bool EglGbmBackend::scanout(AbstractOutput *drmOutput, SurfaceItem *surfaceItem)
     }
 }
 
+bool EglGbmBackend::scanoutOverlay(AbstractOutput *drmOutput, SurfaceItem *surfaceItem)
+{
+    Q_ASSERT(m_outputs.contains(drmOutput));
+    Output &output = m_outputs[drmOutput];
+    const auto drmOut = qobject_cast<DrmOutput *>(output.output);
+    if (!drmOut) {
+        return false;
+    }
+    const auto &hideOverlay = [&output, drmOut]() {
+        if (output.overlaySurface) {
+            qCDebug(KWIN_DRM) << "Overlay scanout stopped on output" << output.output->name();
+        }
+        output.overlaySurface = nullptr;
+        output.overlayBuffer = nullptr;
+        drmOut->pipeline()->setOverlay(nullptr, QRect());
+        return false;
+    };
+    SurfaceItemWayland *item = qobject_cast<SurfaceItemWayland *>(surfaceItem);
+    if (!item || !item->surface() || isDirectScanoutDisabled() || needsShadowBuffer(output.output)) {
+        return hideOverlay();
+    }
+    KWaylandServer::SurfaceInterface *surface = item->surface();
+    auto buffer = qobject_cast<KWaylandServer::LinuxDmaBufV1ClientBuffer *>(surface->buffer());
+    if (!buffer || buffer->planes().isEmpty()
+        || !drmOut->pipeline()->isOverlayFormatSupported(buffer->format(), buffer->planes().first().modifier)) {
+        return hideOverlay();
+    }
+    // re-use the imported buffer as long as the client keeps the same one attached
+    QSharedPointer<DrmGbmBuffer> bo = output.overlayBuffer;
+    if (!bo || bo->clientBuffer() != buffer) {
+        bo = importClientBuffer(buffer);
+        if (!bo) {
+            return hideOverlay();
+        }
+    }
+    const QRect logicalGeometry = surfaceItem->mapToGlobal(surfaceItem->rect()).translated(-output.output->geometry().topLeft());
+    const qreal scale = output.output->scale();
+    const QRect geometry(std::round(logicalGeometry.x() * scale), std::round(logicalGeometry.y() * scale),
+                         std::round(logicalGeometry.width() * scale), std::round(logicalGeometry.height() * scale));
+    if (!drmOut->pipeline()->setOverlay(bo, geometry)) {
+        return hideOverlay();
+    }
+    if (output.overlaySurface != surface) {
+        qCDebug(KWIN_DRM).nospace() << "Overlay scanout starting on output " << output.output->name() << " for application \"" << surface->client()->executablePath() << "\"";
+    }
+    output.overlaySurface = surface;
+    output.overlayBuffer = bo;
+    return true;
+}
+
 QSharedPointer<DrmBuffer> EglGbmBackend::renderTestFrame(DrmAbstractOutput *output)
 {
     beginFrame(output);
@@ -796,6 +1054,16 @@ QSharedPointer<GLTexture> EglGbmBackend::textureForOutput(AbstractOutput *output
 {
     Q_ASSERT(m_outputs.contains(output));
     auto &renderOutput = m_outputs[output];
+    if (renderOutput.scanoutBuffer) {
+        // with direct scanout the composited buffer is stale, sample the client buffer instead
+        // so that recording the output does not require compositing it
+        EGLImageKHR image = eglCreateImageKHR(eglDisplay(), nullptr, EGL_NATIVE_PIXMAP_KHR, renderOutput.scanoutBuffer->getBo(), nullptr);
+        if (image != EGL_NO_IMAGE_KHR) {
+            return QSharedPointer<EGLImageTexture>::create(eglDisplay(), image, GL_RGBA8, renderOutput.scanoutBuffer->size());
+        }
+        qCWarning(KWIN_DRM) << "Failed to record frame: Error importing the scanout buffer - " << glGetError();
+        return {};
+    }
     if (renderOutput.current.shadowBuffer) {
         const auto glTexture = QSharedPointer<KWin::GLTexture>::create(renderOutput.current.shadowBuffer->texture(), GL_RGBA8, renderOutput.output->sourceSize());
         glTexture->setYInverted(true);
@@ -825,6 +1093,23 @@ bool EglGbmBackend::hasOutput(AbstractOutput *output) const
     return m_outputs.contains(output);
 }
 
+QString EglGbmBackend::importStatistics() const
+{
+    QString statistics;
+    QDebug s(&statistics);
+    s.nospace();
+    for (auto it = m_outputs.constBegin(); it != m_outputs.constEnd(); ++it) {
+        if (it->output->gpu() == renderingBackend()->gpu()) {
+            continue;
+        }
+        s << "Imported frames on output " << it->output->name() << ": "
+          << it->importedFrames[int(ImportMode::Dmabuf)] << " dmabuf, "
+          << it->importedFrames[int(ImportMode::Blit)] << " blit, "
+          << it->importedFrames[int(ImportMode::DumbBuffer)] << " CPU" << Qt::endl;
+    }
+    return statistics;
+}
+
 uint32_t EglGbmBackend::drmFormat(DrmAbstractOutput *output) const
 {
     const auto &o = m_outputs[output];
@@ -15,6 +15,7 @@
 
 #include <QPointer>
 #include <QSharedPointer>
+#include <array>
 #include <optional>
 
 struct gbm_surface;
@@ -22,6 +23,7 @@ struct gbm_bo;
 
 namespace KWaylandServer
 {
+class LinuxDmaBufV1ClientBuffer;
 class SurfaceInterface;
 }
 
@@ -65,12 +67,13 @@ public:
     void endFrame(AbstractOutput *output, const QRegion &renderedRegion, const QRegion &damagedRegion) override;
     void init() override;
     bool scanout(AbstractOutput *output, SurfaceItem *surfaceItem) override;
+    bool scanoutOverlay(AbstractOutput *output, SurfaceItem *surfaceItem) override;
     bool prefer10bpc() const override;
 
     QSharedPointer<GLTexture> textureForOutput(AbstractOutput *requestedOutput) const override;
 
     bool hasOutput(AbstractOutput *output) const;
-    bool swapBuffers(DrmAbstractOutput *output, const QRegion &dirty);
+    bool swapBuffers(DrmAbstractOutput *output, const QRegion &dirty, GLRenderTarget *blitTarget = nullptr);
     bool exportFramebuffer(DrmAbstractOutput *output, void *data, const QSize &size, uint32_t stride);
     bool exportFramebufferAsDmabuf(DrmAbstractOutput *output, int *fds, int *strides, int *offsets, uint32_t *num_fds, uint32_t *format, uint64_t *modifier);
 
@@ -80,6 +83,12 @@ public:
     uint32_t drmFormat(DrmAbstractOutput *output) const;
     DrmGpu *gpu() const;
 
+    /**
+     * Returns how the frames of the outputs that are rendered on another GPU have been
+     * imported, for the support information.
+     */
+    QString importStatistics() const;
+
 protected:
     void cleanupSurfaces() override;
     void aboutToStartPainting(AbstractOutput *output, const QRegion &damage) override;
@@ -90,8 +99,18 @@ private:
     bool initRenderingContext();
 
     enum class ImportMode {
+        // the buffer of the rendering GPU is scanned out directly
         Dmabuf,
-        DumbBuffer
+        // the rendering GPU copies the frame into a buffer allocated on this GPU
+        Blit,
+        // the frame is read back with the CPU
+        DumbBuffer,
+        Count
+    };
+    struct BlitBuffer {
+        QSharedPointer<DrmGbmBuffer> buffer;
+        QSharedPointer<GLTexture> texture;
+        QSharedPointer<GLRenderTarget> renderTarget;
     };
     struct Output {
         DrmAbstractOutput *output = nullptr;
@@ -102,22 +121,36 @@ private:
             int bufferAge = 0;
             DamageJournal damageJournal;
             GbmFormat format;
+            // the modifiers of the output the swapchain has been negotiated for
+            QVector<uint64_t> supportedModifiers;
 
             // for secondary GPU import
             ImportMode importMode = ImportMode::Dmabuf;
             QSharedPointer<DumbSwapchain> importSwapchain;
+            QVector<BlitBuffer> blitBuffers;
+            int nextBlitBuffer = 0;
         } old, current;
+        // the number of frames that have been imported with each import mode
+        std::array<quint64, int(ImportMode::Count)> importedFrames = {};
 
         KWaylandServer::SurfaceInterface *scanoutSurface = nullptr;
+        // the client buffer that is currently scanned out, screencasts are recorded from it
+        QSharedPointer<DrmGbmBuffer> scanoutBuffer;
         struct {
             QPointer<KWaylandServer::SurfaceInterface> surface;
             QMap<uint32_t, QVector<uint64_t>> attemptedFormats;
         } scanoutCandidate;
         QPointer<KWaylandServer::SurfaceInterface> oldScanoutCandidate;
+        // modifiers that failed the atomic test during swapchain negotiation, per format
+        QMap<uint32_t, QVector<uint64_t>> rejectedModifiers;
+
+        KWaylandServer::SurfaceInterface *overlaySurface = nullptr;
+        QSharedPointer<DrmGbmBuffer> overlayBuffer;
     };
 
     bool doesRenderFit(const Output &output, const Output::RenderData &render);
     bool resetOutput(Output &output);
+    QSharedPointer<GbmSurface> createScanoutSurface(Output &output, uint32_t format, QVector<uint64_t> modifiers);
     bool addOutput(DrmAbstractOutput *output);
     void removeOutput(DrmAbstractOutput *output);
 
@@ -127,6 +160,8 @@ private:
     void renderFramebufferToSurface(Output &output);
     QRegion prepareRenderingForOutput(Output &output);
     QSharedPointer<DrmBuffer> importFramebuffer(Output &output, const QRegion &dirty) const;
+    bool createBlitBuffers(Output &output) const;
+    QSharedPointer<DrmGbmBuffer> importClientBuffer(KWaylandServer::LinuxDmaBufV1ClientBuffer *buffer) const;
     QSharedPointer<DrmBuffer> endFrameWithBuffer(AbstractOutput *output, const QRegion &dirty);
     void updateBufferAge(Output &output, const QRegion &dirty);
     std::optional<GbmFormat> chooseFormat(Output &output) const;
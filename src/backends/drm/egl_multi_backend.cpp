@@ -67,6 +67,11 @@ bool EglMultiBackend::scanout(AbstractOutput *output, SurfaceItem *surfaceItem)
     return findBackend(output)->scanout(output, surfaceItem);
 }
 
+bool EglMultiBackend::scanoutOverlay(AbstractOutput *output, SurfaceItem *surfaceItem)
+{
+    return findBackend(output)->scanoutOverlay(output, surfaceItem);
+}
+
 bool EglMultiBackend::makeCurrent()
 {
     return m_backends[0]->makeCurrent();
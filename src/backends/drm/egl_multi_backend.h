@@ -31,6 +31,7 @@ public:
     QRegion beginFrame(AbstractOutput *output) override;
     void endFrame(AbstractOutput *output, const QRegion &renderedRegion, const QRegion &damagedRegion) override;
     bool scanout(AbstractOutput *output, SurfaceItem *surfaceItem) override;
+    bool scanoutOverlay(AbstractOutput *output, SurfaceItem *surfaceItem) override;
 
     bool makeCurrent() override;
     void doneCurrent() override;
@@ -47,6 +47,7 @@ void DrmQPainterBackend::initOutput(DrmAbstractOutput *output)
 {
     Output o;
     o.swapchain = QSharedPointer<DumbSwapchain>::create(m_gpu, output->sourceSize(), DRM_FORMAT_XRGB8888);
+    o.damageJournal.setCapacity(o.swapchain->slotCount());
     o.output = output;
     m_outputs.insert(output, o);
     connect(output, &DrmOutput::currentModeChanged, this,
@@ -82,9 +83,12 @@ void DrmQPainterBackend::endFrame(AbstractOutput *output, const QRegion &rendere
     QSharedPointer<DrmDumbBuffer> back = rendererOutput.swapchain->currentBuffer();
     rendererOutput.swapchain->releaseBuffer(back);
 
-    drmOutput->present(back, drmOutput->geometry());
-
-    rendererOutput.damageJournal.add(damage);
+    if (drmOutput->present(back, damage)) {
+        rendererOutput.damageJournal.add(damage);
+    } else {
+        // the age of the buffers is unknown now
+        rendererOutput.damageJournal.clear();
+    }
 }
 
 }
@@ -11,6 +11,10 @@
 #include "logging.h"
 #include "drm_output.h"
 
+#include <kwinglplatform.h>
+
+#include <algorithm>
+
 namespace KWin
 {
 
@@ -34,6 +38,15 @@ static const float texCoords[] = {
     1.0f,  1.0f
 };
 
+static bool supportsPackedDepthStencil()
+{
+    if (GLPlatform::instance()->isGLES()) {
+        return hasGLVersion(3, 0) || hasGLExtension(QByteArrayLiteral("GL_OES_packed_depth_stencil"));
+    }
+    return hasGLVersion(3, 0) || hasGLExtension(GLExtension::ARB_framebuffer_object)
+        || hasGLExtension(QByteArrayLiteral("GL_EXT_packed_depth_stencil"));
+}
+
 ShadowBuffer::ShadowBuffer(const QSize &size, const GbmFormat &format)
     : m_size(size)
 {
@@ -49,6 +62,25 @@ ShadowBuffer::ShadowBuffer(const QSize &size, const GbmFormat &format)
     glBindTexture(GL_TEXTURE_2D, 0);
 
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_texture, 0);
+
+    // The scene clips windows with the stencil buffer if the framebuffer has one. Stencil-only
+    // renderbuffers are poorly supported, so a packed depth and stencil buffer is attached.
+    if (supportsPackedDepthStencil()) {
+        glGenRenderbuffers(1, &m_depthStencilBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_depthStencilBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, size.width(), size.height());
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthStencilBuffer);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthStencilBuffer);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            qCDebug(KWIN_DRM) << "The shadow buffer can't have a depth and stencil buffer";
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, 0);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT, GL_RENDERBUFFER, 0);
+            glDeleteRenderbuffers(1, &m_depthStencilBuffer);
+            m_depthStencilBuffer = 0;
+        }
+    }
+
     if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
         qCCritical(KWIN_DRM) << "Error: framebuffer not complete!";
         return;
@@ -64,6 +96,9 @@ ShadowBuffer::ShadowBuffer(const QSize &size, const GbmFormat &format)
 ShadowBuffer::~ShadowBuffer()
 {
     glDeleteTextures(1, &m_texture);
+    if (m_depthStencilBuffer) {
+        glDeleteRenderbuffers(1, &m_depthStencilBuffer);
+    }
     glDeleteFramebuffers(1, &m_framebuffer);
 }
 
@@ -71,7 +106,18 @@ void ShadowBuffer::render(DrmAbstractOutput *output)
 {
     const auto size = output->modeSize();
     glViewport(0, 0, size.width(), size.height());
-    auto shader = ShaderManager::instance()->pushShader(ShaderTrait::MapTexture);
+
+    GLShader *shader = m_gammaEnabled ? gammaShader() : nullptr;
+    if (shader) {
+        ShaderManager::instance()->pushShader(shader);
+        shader->setUniform("lookupTable", 1);
+        shader->setUniform("lookupTableSize", float(m_gammaTable.size() / 3));
+        glActiveTexture(GL_TEXTURE1);
+        m_gammaTexture->bind();
+        glActiveTexture(GL_TEXTURE0);
+    } else {
+        shader = ShaderManager::instance()->pushShader(ShaderTrait::MapTexture);
+    }
 
     QMatrix4x4 mvpMatrix;
 
@@ -111,6 +157,127 @@ void ShadowBuffer::render(DrmAbstractOutput *output)
     m_vbo->render(GL_TRIANGLES);
     ShaderManager::instance()->popShader();
     glBindTexture(GL_TEXTURE_2D, 0);
+    if (shader == m_gammaShader.data()) {
+        glActiveTexture(GL_TEXTURE1);
+        m_gammaTexture->unbind();
+        glActiveTexture(GL_TEXTURE0);
+    }
+}
+
+void ShadowBuffer::setGammaRamp(const GammaRamp *gammaRamp)
+{
+    m_gammaEnabled = gammaRamp && gammaRamp->size() > 1;
+    if (!m_gammaEnabled) {
+        return;
+    }
+
+    // the three channels are stored contiguously
+    const uint32_t size = gammaRamp->size();
+    const uint16_t *table = gammaRamp->red();
+    if (m_gammaTable.size() == int(3 * size) && std::equal(table, table + 3 * size, m_gammaTable.constData())) {
+        return;
+    }
+    const bool resize = !m_gammaTexture || m_gammaTable.size() != int(3 * size);
+    m_gammaTable = QVector<uint16_t>(table, table + 3 * size);
+
+    // Truncating the ramp to 8 bits per channel causes visible banding, so keep all 16 bits
+    // on desktop GL and use a half float texture on GLES, which has no 16 bit normalized
+    // formats. Only an 8 bit texture is left on GLES 2.
+    if (!GLPlatform::instance()->isGLES()) {
+        QVector<uint16_t> pixels(3 * size);
+        for (uint32_t i = 0; i < size; ++i) {
+            pixels[3 * i] = gammaRamp->red()[i];
+            pixels[3 * i + 1] = gammaRamp->green()[i];
+            pixels[3 * i + 2] = gammaRamp->blue()[i];
+        }
+        if (resize) {
+            m_gammaTexture.reset(new GLTexture(GL_RGB16, size, 1));
+        }
+        m_gammaTexture->bind();
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size, 1, GL_RGB, GL_UNSIGNED_SHORT, pixels.constData());
+    } else if (hasGLVersion(3, 0)) {
+        QVector<float> pixels(3 * size);
+        for (uint32_t i = 0; i < size; ++i) {
+            pixels[3 * i] = gammaRamp->red()[i] / 65535.0f;
+            pixels[3 * i + 1] = gammaRamp->green()[i] / 65535.0f;
+            pixels[3 * i + 2] = gammaRamp->blue()[i] / 65535.0f;
+        }
+        if (resize) {
+            // GLTexture only allocates 8 bit textures on GLES, so allocate the storage here.
+            m_gammaTexture.reset(new GLTexture(GL_TEXTURE_2D));
+            m_gammaTexture->create();
+            m_gammaTexture->bind();
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, size, 1, 0, GL_RGB, GL_FLOAT, nullptr);
+        } else {
+            m_gammaTexture->bind();
+        }
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size, 1, GL_RGB, GL_FLOAT, pixels.constData());
+    } else {
+        QImage image(size, 1, QImage::Format_RGB32);
+        QRgb *pixels = reinterpret_cast<QRgb *>(image.bits());
+        for (uint32_t i = 0; i < size; ++i) {
+            pixels[i] = qRgb(gammaRamp->red()[i] >> 8, gammaRamp->green()[i] >> 8, gammaRamp->blue()[i] >> 8);
+        }
+        if (resize) {
+            m_gammaTexture.reset(new GLTexture(image));
+        } else {
+            m_gammaTexture->update(image);
+        }
+        m_gammaTexture->bind();
+    }
+    m_gammaTexture->setFilter(GL_LINEAR);
+    m_gammaTexture->setWrapMode(GL_CLAMP_TO_EDGE);
+    m_gammaTexture->unbind();
+}
+
+GLShader *ShadowBuffer::gammaShader()
+{
+    if (m_gammaShaderCreated) {
+        return m_gammaShader.data();
+    }
+    m_gammaShaderCreated = true;
+
+    const bool gles = GLPlatform::instance()->isGLES();
+    const bool glsl_140 = !gles && GLPlatform::instance()->glslVersion() >= kVersionNumber(1, 40);
+    const bool core = glsl_140 || (gles && GLPlatform::instance()->glslVersion() >= kVersionNumber(3, 0));
+
+    const QByteArray varying = core ? "in" : "varying";
+    const QByteArray texture2D = core ? "texture" : "texture2D";
+    const QByteArray fragColor = core ? "fragColor" : "gl_FragColor";
+
+    QByteArray source;
+    if (gles) {
+        if (core) {
+            source += "#version 300 es\n\n";
+        }
+        source += "precision highp float;\n";
+    } else if (glsl_140) {
+        source += "#version 140\n\n";
+    }
+    source += "uniform sampler2D sampler;\n"
+              "uniform sampler2D lookupTable;\n"
+              "uniform float lookupTableSize;\n"
+              + varying + " vec2 texcoord0;\n";
+    if (core) {
+        source += "out vec4 fragColor;\n";
+    }
+    // sample at the texel centers, so that 0 and 1 map to the first and the last entry
+    source += "\nvoid main(void)\n"
+              "{\n"
+              "    vec4 color = " + texture2D + "(sampler, texcoord0);\n"
+              "    vec3 coords = (color.rgb * (lookupTableSize - 1.0) + 0.5) / lookupTableSize;\n"
+              "    " + fragColor + " = vec4(" + texture2D + "(lookupTable, vec2(coords.r, 0.5)).r,\n"
+              "                        " + texture2D + "(lookupTable, vec2(coords.g, 0.5)).g,\n"
+              "                        " + texture2D + "(lookupTable, vec2(coords.b, 0.5)).b,\n"
+              "                        color.a);\n"
+              "}\n";
+
+    m_gammaShader.reset(ShaderManager::instance()->generateCustomShader(ShaderTrait::MapTexture, QByteArray(), source));
+    if (!m_gammaShader->isValid()) {
+        qCWarning(KWIN_DRM) << "Failed to create the gamma ramp shader, the software gamma ramp is not applied";
+        m_gammaShader.reset();
+    }
+    return m_gammaShader.data();
 }
 
 void ShadowBuffer::bind()
@@ -17,6 +17,7 @@ namespace KWin
 {
 
 class DrmAbstractOutput;
+class GammaRamp;
 
 class ShadowBuffer
 {
@@ -29,16 +30,32 @@ public:
     void bind();
     void render(DrmAbstractOutput *output);
 
+    /**
+     * Sets the gamma ramp that is applied while the shadow buffer is rendered to the output,
+     * @c null disables it. The lookup table texture is only updated if the ramp has changed,
+     * and keeps the 16 bits per channel of the ramp where the platform supports it.
+     */
+    void setGammaRamp(const GammaRamp *gammaRamp);
+
     int texture() const;
 
     QSize textureSize() const;
 
 private:
     GLint internalFormat(const GbmFormat &format);
+    GLShader *gammaShader();
+
     GLuint m_texture;
     GLuint m_framebuffer;
+    GLuint m_depthStencilBuffer = 0;
     QScopedPointer<GLVertexBuffer> m_vbo;
     QSize m_size;
+
+    QScopedPointer<GLTexture> m_gammaTexture;
+    QScopedPointer<GLShader> m_gammaShader;
+    QVector<uint16_t> m_gammaTable;
+    bool m_gammaShaderCreated = false;
+    bool m_gammaEnabled = false;
 };
 
 }
@@ -51,6 +51,7 @@ void FramebufferQPainterBackend::reactivate()
     for (AbstractOutput *output : outputs) {
         output->renderLoop()->uninhibit();
     }
+    // somebody else may have drawn to the frame buffer in the meantime
     Compositor::self()->scene()->addRepaintFull();
 }
 
@@ -72,13 +73,17 @@ QImage* FramebufferQPainterBackend::bufferForScreen(AbstractOutput *output)
 
 QRegion FramebufferQPainterBackend::beginFrame(AbstractOutput *output)
 {
+    // The render buffer is never handed out, it still contains the previous frame.
+    if (m_renderBufferValid) {
+        return QRegion();
+    }
+    m_renderBufferValid = true;
     return output->geometry();
 }
 
 void FramebufferQPainterBackend::endFrame(AbstractOutput *output, const QRegion &renderedRegion, const QRegion &damagedRegion)
 {
     Q_UNUSED(renderedRegion)
-    Q_UNUSED(damagedRegion)
 
     if (!kwinApp()->platform()->session()->isActive()) {
         return;
@@ -86,8 +91,19 @@ void FramebufferQPainterBackend::endFrame(AbstractOutput *output, const QRegion
 
     static_cast<FramebufferOutput *>(output)->vsyncMonitor()->arm();
 
+    // Only the damaged parts are copied to the mapped memory, the rest of the frame
+    // buffer still shows the previous frame.
+    const QPoint outputPosition = output->geometry().topLeft();
     QPainter p(&m_backBuffer);
-    p.drawImage(QPoint(0, 0), m_backend->isBGR() ? m_renderBuffer.rgbSwapped() : m_renderBuffer);
+    p.setCompositionMode(QPainter::CompositionMode_Source);
+    for (const QRect &rect : damagedRegion) {
+        const QRect source = rect.translated(-outputPosition) & m_renderBuffer.rect();
+        if (m_backend->isBGR()) {
+            p.drawImage(source.topLeft(), m_renderBuffer.copy(source).rgbSwapped());
+        } else {
+            p.drawImage(source.topLeft(), m_renderBuffer, source);
+        }
+    }
 }
 
 }
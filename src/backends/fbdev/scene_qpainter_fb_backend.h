@@ -40,6 +40,10 @@ private:
      * @brief buffer to draw into
      */
     QImage m_backBuffer;
+    /**
+     * @brief whether the render buffer contains a complete frame
+     */
+    bool m_renderBufferValid = false;
 
     FramebufferBackend *m_backend;
 };
@@ -20,6 +20,7 @@
 #include "abstract_client.h"
 #endif
 
+#include "ftrace.h"
 #include "input_event.h"
 #include "session.h"
 #include "udev.h"
@@ -179,6 +180,7 @@ void Connection::deactivate()
 
 void Connection::handleEvent()
 {
+    fTraceSlice("libinput dispatch");
     QMutexLocker locker(&m_mutex);
     const bool wasEmpty = m_eventQueue.isEmpty();
     do {
@@ -281,9 +283,17 @@ KWin::TabletToolId createTabletId(libinput_tablet_tool *tool, void *userData)
 
 void Connection::processEvents()
 {
-    QMutexLocker locker(&m_mutex);
-    while (!m_eventQueue.isEmpty()) {
-        QScopedPointer<Event> event(m_eventQueue.takeFirst());
+    fTraceSlice("Connection::processEvents");
+
+    // Only hold the lock while taking the queued events, the reader thread would otherwise
+    // be blocked for as long as the events go through the input filters.
+    {
+        QMutexLocker locker(&m_mutex);
+        m_pendingEvents += m_eventQueue;
+        m_eventQueue.clear();
+    }
+    while (!m_pendingEvents.isEmpty()) {
+        QScopedPointer<Event> event(m_pendingEvents.takeFirst());
         switch (event->type()) {
             case LIBINPUT_EVENT_DEVICE_ADDED: {
                 auto device = new Device(event->nativeDevice());
@@ -333,18 +343,21 @@ void Connection::processEvents()
                 auto deltaNonAccel = pe->deltaUnaccelerated();
                 quint32 latestTime = pe->time();
                 quint64 latestTimeUsec = pe->timeMicroseconds();
-                auto it = m_eventQueue.begin();
-                while (it != m_eventQueue.end()) {
-                    if ((*it)->type() == LIBINPUT_EVENT_POINTER_MOTION) {
-                        QScopedPointer<PointerEvent> p(static_cast<PointerEvent*>(*it));
-                        delta += p->delta();
-                        deltaNonAccel += p->deltaUnaccelerated();
-                        latestTime = p->time();
-                        latestTimeUsec = p->timeMicroseconds();
-                        it = m_eventQueue.erase(it);
-                    } else {
-                        break;
+                // Merge the queued motion of the same device into a single motion. Motion of other
+                // devices is stepped over, but any other event ends the run, so that buttons, keys
+                // and axis events still see the pointer where it was when they happened.
+                auto it = m_pendingEvents.begin();
+                while (it != m_pendingEvents.end() && (*it)->type() == LIBINPUT_EVENT_POINTER_MOTION) {
+                    if ((*it)->device() != pe->device()) {
+                        ++it;
+                        continue;
                     }
+                    QScopedPointer<PointerEvent> p(static_cast<PointerEvent*>(*it));
+                    delta += p->delta();
+                    deltaNonAccel += p->deltaUnaccelerated();
+                    latestTime = p->time();
+                    latestTimeUsec = p->timeMicroseconds();
+                    it = m_pendingEvents.erase(it);
                 }
                 Q_EMIT pe->device()->pointerMotion(delta, deltaNonAccel, latestTime, latestTimeUsec, pe->device());
                 break;
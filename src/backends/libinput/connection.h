@@ -69,6 +69,8 @@ private:
     QSocketNotifier *m_notifier;
     QMutex m_mutex;
     QVector<Event*> m_eventQueue;
+    // Events taken from m_eventQueue that are still to be processed, only used on the main thread
+    QVector<Event*> m_pendingEvents;
     QVector<Device*> m_devices;
     KSharedConfigPtr m_config;
 
@@ -11,6 +11,7 @@
 #include "basiceglsurfacetexture_internal.h"
 #include "basiceglsurfacetexture_wayland.h"
 #include "composite.h"
+#include "dmabuftexture.h"
 #include "virtual_backend.h"
 #include "options.h"
 #include "screens.h"
@@ -20,16 +21,58 @@
 // kwin libs
 #include <kwinglplatform.h>
 #include <kwinglutils.h>
+#include <kwineglimagetexture.h>
 // Qt
 #include <QOpenGLContext>
+// system
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <gbm.h>
+#include <unistd.h>
 
 #ifndef EGL_PLATFORM_SURFACELESS_MESA
 #define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
 #endif
 
+#ifndef EGL_DRM_RENDER_NODE_FILE_EXT
+#define EGL_DRM_RENDER_NODE_FILE_EXT 0x3377
+#endif
+
 namespace KWin
 {
 
+class VirtualDmaBufTexture : public DmaBufTexture
+{
+public:
+    VirtualDmaBufTexture(GLTexture *texture, gbm_bo *bo, int fd)
+        : DmaBufTexture(texture)
+        , m_bo(bo)
+        , m_fd(fd)
+    {
+    }
+    ~VirtualDmaBufTexture() override
+    {
+        m_framebuffer.reset();
+        m_texture.reset();
+        close(m_fd);
+        gbm_bo_destroy(m_bo);
+    }
+
+    quint32 stride() const override
+    {
+        return gbm_bo_get_stride(m_bo);
+    }
+    int fd() const override
+    {
+        return m_fd;
+    }
+
+private:
+    gbm_bo *m_bo;
+    int m_fd;
+};
+
 EglGbmBackend::EglGbmBackend(VirtualBackend *b)
     : AbstractEglBackend()
     , m_backend(b)
@@ -46,6 +89,12 @@ EglGbmBackend::~EglGbmBackend()
     delete m_fbo;
     delete m_backBuffer;
     cleanup();
+    if (m_gbmDevice) {
+        gbm_device_destroy(m_gbmDevice);
+    }
+    if (m_drmFd != -1) {
+        close(m_drmFd);
+    }
 }
 
 bool EglGbmBackend::initializeEgl()
@@ -84,6 +133,9 @@ void EglGbmBackend::init()
     initKWinGL();
 
     m_backBuffer = new GLTexture(GL_RGB8, screens()->size().width(), screens()->size().height());
+    // Textures handed out by textureForOutput() share their data with the back buffer, so it
+    // has to carry the orientation itself rather than each copy setting it.
+    m_backBuffer->setYInverted(true);
     m_fbo = new GLRenderTarget(*m_backBuffer);
     if (!m_fbo->valid()) {
         setFailed("Could not create framebuffer object");
@@ -101,6 +153,77 @@ void EglGbmBackend::init()
 
     setSupportsBufferAge(false);
     initWayland();
+    initGbmDevice();
+}
+
+void EglGbmBackend::initGbmDevice()
+{
+    // find the render node the surfaceless display renders on, buffers allocated there can be
+    // shared with screencast consumers without copying them through the CPU
+    if (!hasClientExtension(QByteArrayLiteral("EGL_EXT_device_query"))) {
+        return;
+    }
+    static auto queryDisplayAttrib = reinterpret_cast<PFNEGLQUERYDISPLAYATTRIBEXTPROC>(eglGetProcAddress("eglQueryDisplayAttribEXT"));
+    static auto queryDeviceString = reinterpret_cast<PFNEGLQUERYDEVICESTRINGEXTPROC>(eglGetProcAddress("eglQueryDeviceStringEXT"));
+    if (!queryDisplayAttrib || !queryDeviceString) {
+        return;
+    }
+    EGLAttrib device = 0;
+    if (queryDisplayAttrib(eglDisplay(), EGL_DEVICE_EXT, &device) != EGL_TRUE) {
+        return;
+    }
+    const char *path = queryDeviceString(reinterpret_cast<EGLDeviceEXT>(device), EGL_DRM_RENDER_NODE_FILE_EXT);
+    if (!path) {
+        path = queryDeviceString(reinterpret_cast<EGLDeviceEXT>(device), EGL_DRM_DEVICE_FILE_EXT);
+    }
+    if (!path) {
+        qCDebug(KWIN_VIRTUAL) << "The EGL display has no DRM device, dmabufs are not available";
+        return;
+    }
+    m_drmFd = open(path, O_RDWR | O_CLOEXEC);
+    if (m_drmFd == -1) {
+        qCWarning(KWIN_VIRTUAL) << "Failed to open" << path << strerror(errno);
+        return;
+    }
+    m_gbmDevice = gbm_create_device(m_drmFd);
+    if (!m_gbmDevice) {
+        qCWarning(KWIN_VIRTUAL) << "Failed to create a gbm device for" << path;
+        close(m_drmFd);
+        m_drmFd = -1;
+    }
+}
+
+DmaBufTexture *EglGbmBackend::createDmaBufTexture(const QSize &size)
+{
+    if (!m_gbmDevice) {
+        return nullptr;
+    }
+    gbm_bo *bo = gbm_bo_create(m_gbmDevice, size.width(), size.height(), GBM_FORMAT_ARGB8888, GBM_BO_USE_RENDERING | GBM_BO_USE_LINEAR);
+    if (!bo) {
+        return nullptr;
+    }
+    const int fd = gbm_bo_get_fd(bo);
+    if (fd < 0) {
+        gbm_bo_destroy(bo);
+        return nullptr;
+    }
+    const EGLint attribs[] = {
+        EGL_WIDTH, EGLint(gbm_bo_get_width(bo)),
+        EGL_HEIGHT, EGLint(gbm_bo_get_height(bo)),
+        EGL_LINUX_DRM_FOURCC_EXT, GBM_FORMAT_ARGB8888,
+        EGL_DMA_BUF_PLANE0_FD_EXT, fd,
+        EGL_DMA_BUF_PLANE0_OFFSET_EXT, EGLint(gbm_bo_get_offset(bo, 0)),
+        EGL_DMA_BUF_PLANE0_PITCH_EXT, EGLint(gbm_bo_get_stride(bo)),
+        EGL_NONE,
+    };
+    makeCurrent();
+    EGLImageKHR image = eglCreateImageKHR(eglDisplay(), EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT, nullptr, attribs);
+    if (image == EGL_NO_IMAGE_KHR) {
+        close(fd);
+        gbm_bo_destroy(bo);
+        return nullptr;
+    }
+    return new VirtualDmaBufTexture(new EGLImageTexture(eglDisplay(), image, GL_RGBA8, size), bo, fd);
 }
 
 bool EglGbmBackend::initRenderingContext()
@@ -196,7 +319,7 @@ void EglGbmBackend::endFrame(AbstractOutput *output, const QRegion &renderedRegi
     Q_UNUSED(damagedRegion)
     glFlush();
 
-    static_cast<VirtualOutput *>(output)->vsyncMonitor()->arm();
+    static_cast<VirtualOutput *>(output)->frameSubmitted();
 
     if (m_backend->saveFrames()) {
         QImage img = QImage(QSize(m_backBuffer->width(), m_backBuffer->height()), QImage::Format_ARGB32);
@@ -209,4 +332,14 @@ void EglGbmBackend::endFrame(AbstractOutput *output, const QRegion &renderedRegi
     eglSwapBuffers(eglDisplay(), surface());
 }
 
+QSharedPointer<GLTexture> EglGbmBackend::textureForOutput(AbstractOutput *output) const
+{
+    // All outputs share the back buffer. If it only shows this output, hand it out as it is
+    // instead of copying it into a new texture.
+    if (output->geometry() != screens()->geometry() || output->pixelSize() != m_backBuffer->size()) {
+        return AbstractEglBackend::textureForOutput(output);
+    }
+    return QSharedPointer<GLTexture>::create(*m_backBuffer);
+}
+
 } // namespace
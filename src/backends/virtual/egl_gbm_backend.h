@@ -10,8 +10,11 @@
 #define KWIN_EGL_GBM_BACKEND_H
 #include "abstract_egl_backend.h"
 
+struct gbm_device;
+
 namespace KWin
 {
+class DmaBufTexture;
 class VirtualBackend;
 class GLTexture;
 class GLRenderTarget;
@@ -31,15 +34,25 @@ public:
     QRegion beginFrame(AbstractOutput *output) override;
     void endFrame(AbstractOutput *output, const QRegion &renderedRegion, const QRegion &damagedRegion) override;
     void init() override;
+    QSharedPointer<GLTexture> textureForOutput(AbstractOutput *output) const override;
+
+    /**
+     * Creates a linear buffer on the render node of the EGL display that can be shared with
+     * screencast consumers as a dmabuf. Returns @c nullptr if the render node is unknown.
+     */
+    DmaBufTexture *createDmaBufTexture(const QSize &size);
 
 private:
     bool initializeEgl();
     bool initBufferConfigs();
     bool initRenderingContext();
+    void initGbmDevice();
     VirtualBackend *m_backend;
     GLTexture *m_backBuffer = nullptr;
     GLRenderTarget *m_fbo = nullptr;
     int m_frameCounter = 0;
+    int m_drmFd = -1;
+    gbm_device *m_gbmDevice = nullptr;
 };
 
 } // namespace
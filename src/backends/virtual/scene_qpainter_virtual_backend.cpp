@@ -53,7 +53,7 @@ void VirtualQPainterBackend::endFrame(AbstractOutput *output, const QRegion &ren
     Q_UNUSED(renderedRegion)
     Q_UNUSED(damagedRegion)
 
-    static_cast<VirtualOutput *>(output)->vsyncMonitor()->arm();
+    static_cast<VirtualOutput *>(output)->frameSubmitted();
 
     if (m_backend->saveFrames()) {
         m_backBuffers[output].save(QStringLiteral("%1/%s-%3.png").arg(m_backend->screenshotDirPath(), output->name(), QString::number(m_frameCounter++)));
@@ -236,7 +236,13 @@ QPainterBackend *VirtualBackend::createQPainterBackend()
 
 OpenGLBackend *VirtualBackend::createOpenGLBackend()
 {
-    return new EglGbmBackend(this);
+    m_eglBackend = new EglGbmBackend(this);
+    return m_eglBackend;
+}
+
+DmaBufTexture *VirtualBackend::createDmaBufTexture(const QSize &size)
+{
+    return m_eglBackend ? m_eglBackend->createDmaBufTexture(size) : nullptr;
 }
 
 Outputs VirtualBackend::outputs() const
@@ -16,12 +16,14 @@
 #include <kwin_export.h>
 
 #include <QObject>
+#include <QPointer>
 #include <QRect>
 
 class QTemporaryDir;
 
 namespace KWin
 {
+class EglGbmBackend;
 class VirtualBackend;
 class VirtualOutput;
 
@@ -101,6 +103,7 @@ public:
     InputBackend *createInputBackend() override;
     QPainterBackend* createQPainterBackend() override;
     OpenGLBackend *createOpenGLBackend() override;
+    DmaBufTexture *createDmaBufTexture(const QSize &size) override;
 
     Q_INVOKABLE void setVirtualOutputs(int count, QVector<QRect> geometries = QVector<QRect>(), QVector<int> scales = QVector<int>());
 
@@ -126,6 +129,7 @@ private:
     QVector<VirtualOutput*> m_outputsEnabled;
     QScopedPointer<QTemporaryDir> m_screenshotDir;
     Session *m_session;
+    QPointer<EglGbmBackend> m_eglBackend;
 
     QScopedPointer<VirtualInputDevice> m_virtualPointer;
     QScopedPointer<VirtualInputDevice> m_virtualKeyboard;
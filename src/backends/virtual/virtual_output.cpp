@@ -12,6 +12,8 @@
 #include "renderloop_p.h"
 #include "softwarevsyncmonitor.h"
 
+#include <QTimer>
+
 namespace KWin
 {
 
@@ -44,7 +46,18 @@ SoftwareVsyncMonitor *VirtualOutput::vsyncMonitor() const
 
 void VirtualOutput::init(const QPoint &logicalPosition, const QSize &pixelSize)
 {
-    const int refreshRate = 60000; // TODO: Make the refresh rate configurable.
+    // The refresh rate in mHz can be overridden for headless test setups. With a refresh
+    // rate of 0, frames are presented as soon as they have been rendered.
+    bool ok = false;
+    int refreshRate = qEnvironmentVariableIntValue("KWIN_WAYLAND_VIRTUAL_REFRESH_RATE", &ok);
+    if (!ok || refreshRate < 0) {
+        refreshRate = 60000;
+    }
+    m_onDemand = refreshRate == 0;
+    if (m_onDemand) {
+        // the render loop still needs a rate to compute its deadlines
+        refreshRate = 60000;
+    }
     m_renderLoop->setRefreshRate(refreshRate);
     m_vsyncMonitor->setRefreshRate(refreshRate);
 
@@ -61,6 +74,17 @@ void VirtualOutput::init(const QPoint &logicalPosition, const QSize &pixelSize)
     setGeometry(QRect(logicalPosition, pixelSize));
 }
 
+void VirtualOutput::frameSubmitted()
+{
+    if (m_onDemand) {
+        QTimer::singleShot(0, this, [this]() {
+            vblank(std::chrono::steady_clock::now().time_since_epoch());
+        });
+    } else {
+        m_vsyncMonitor->arm();
+    }
+}
+
 void VirtualOutput::setGeometry(const QRect &geo)
 {
     // TODO: set mode to have updated pixelSize
@@ -33,6 +33,12 @@ public:
 
     void init(const QPoint &logicalPosition, const QSize &pixelSize);
 
+    /**
+     * Called by the render backends after a frame has been rendered. The frame is presented
+     * at the next simulated vblank, or right away if the output refreshes on demand.
+     */
+    void frameSubmitted();
+
     void setGeometry(const QRect &geo);
 
     int gammaRampSize() const override {
@@ -57,6 +63,7 @@ private:
     int m_gammaSize = 200;
     bool m_gammaResult = true;
     int m_identifier;
+    bool m_onDemand = false;
 };
 
 }
@@ -81,7 +81,7 @@ void EglOnXBackend::init()
         setFailed(QStringLiteral("Required support for binding pixmaps to EGLImages not found, disabling compositing"));
         return;
     }
-    if (!hasGLExtension(QByteArrayLiteral("GL_OES_EGL_image"))) {
+    if (!hasGLExtension(GLExtension::OES_EGL_image)) {
         setFailed(QStringLiteral("Required extension GL_OES_EGL_image not found, disabling compositing"));
         return;
     }
@@ -29,16 +29,16 @@ bool ScreenEdgesFilter::event(xcb_generic_event_t *event)
         const auto mouseEvent = reinterpret_cast<xcb_motion_notify_event_t*>(event);
         const QPoint rootPos(mouseEvent->root_x, mouseEvent->root_y);
         if (QWidget::mouseGrabber()) {
-            ScreenEdges::self()->check(rootPos, QDateTime::fromMSecsSinceEpoch(xTime(), Qt::UTC), true);
+            ScreenEdges::self()->check(rootPos, std::chrono::milliseconds(xTime()), true);
         } else {
-            ScreenEdges::self()->check(rootPos, QDateTime::fromMSecsSinceEpoch(mouseEvent->time, Qt::UTC));
+            ScreenEdges::self()->check(rootPos, std::chrono::milliseconds(mouseEvent->time));
         }
         // not filtered out
         break;
     }
     case XCB_ENTER_NOTIFY: {
         const auto enter = reinterpret_cast<xcb_enter_notify_event_t*>(event);
-        return ScreenEdges::self()->handleEnterNotifiy(enter->event, QPoint(enter->root_x, enter->root_y), QDateTime::fromMSecsSinceEpoch(enter->time, Qt::UTC));
+        return ScreenEdges::self()->handleEnterNotifiy(enter->event, QPoint(enter->root_x, enter->root_y), std::chrono::milliseconds(enter->time));
     }
     case XCB_CLIENT_MESSAGE: {
         const auto ce = reinterpret_cast<xcb_client_message_event_t*>(event);
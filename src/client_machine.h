@@ -57,6 +57,11 @@ public:
     ~ClientMachine() override;
 
     void resolve(xcb_window_t window, xcb_window_t clientLeader);
+    /**
+     * Same as above, but with the WM_CLIENT_MACHINE of @p window already read, for
+     * example as part of the initial NETWinInfo of a newly managed window.
+     */
+    void resolve(const QByteArray &windowMachine, xcb_window_t window, xcb_window_t clientLeader);
     const QByteArray &hostName() const;
     bool isLocal() const;
     static QByteArray localhost();
@@ -6,11 +6,15 @@
 
 #include "colordevice.h"
 #include "abstract_output.h"
+#include "composite.h"
+#include "scene.h"
 #include "utils/common.h"
 
 #include "3rdparty/colortemperature.h"
 
+#include <QFutureWatcher>
 #include <QTimer>
+#include <QtConcurrent>
 
 #include <lcms2.h>
 
@@ -66,12 +70,32 @@ public:
     };
     Q_DECLARE_FLAGS(DirtyToneCurves, DirtyToneCurveBit)
 
-    void rebuildPipeline();
+    /**
+     * The color settings that a gamma ramp is computed for. A copy is handed over to the
+     * worker thread, so the settings can keep changing while the ramp is being computed.
+     */
+    struct State
+    {
+        DirtyToneCurves dirtyCurves;
+        QString profile;
+        uint brightness;
+        uint temperature;
+        uint32_t gammaRampSize;
+    };
+
+    struct Result
+    {
+        GammaRamp gammaRamp{0};
+        bool identity = true;
+    };
+
+    Result computeGammaRamp(const State &state);
+    void rebuildPipeline(const State &state);
     void unlinkPipeline();
 
-    void updateTemperatureToneCurves();
-    void updateBrightnessToneCurves();
-    void updateCalibrationToneCurves();
+    void updateTemperatureToneCurves(uint temperature);
+    void updateBrightnessToneCurves(uint brightness);
+    void updateCalibrationToneCurves(const QString &profile);
 
     AbstractOutput *output;
     DirtyToneCurves dirtyCurves;
@@ -80,6 +104,13 @@ public:
     uint brightness = 100;
     uint temperature = 6500;
 
+    QFutureWatcher<Result> *updateWatcher;
+    bool updatePending = false;
+    bool softwareGammaRampActive = false;
+    GammaRamp softwareGammaRamp{0};
+
+    // The pipeline stages are only touched by the worker thread that computes the gamma
+    // ramp, there is at most one such thread at a time.
     CmsScopedPointer<cmsStage> temperatureStage;
     CmsScopedPointer<cmsStage> brightnessStage;
     CmsScopedPointer<cmsStage> calibrationStage;
@@ -87,7 +118,35 @@ public:
     CmsScopedPointer<cmsPipeline> pipeline;
 };
 
-void ColorDevicePrivate::rebuildPipeline()
+ColorDevicePrivate::Result ColorDevicePrivate::computeGammaRamp(const State &state)
+{
+    rebuildPipeline(state);
+
+    Result result;
+    result.gammaRamp = GammaRamp(state.gammaRampSize);
+    result.identity = !cmsPipelineStageCount(pipeline.data());
+
+    uint16_t *redChannel = result.gammaRamp.red();
+    uint16_t *greenChannel = result.gammaRamp.green();
+    uint16_t *blueChannel = result.gammaRamp.blue();
+
+    for (uint32_t i = 0; i < result.gammaRamp.size(); ++i) {
+        // ensure 64 bit calculation to prevent overflows
+        const uint16_t index = (static_cast<uint64_t>(i) * 0xffff) / (result.gammaRamp.size() - 1);
+
+        const uint16_t in[3] = { index, index, index };
+        uint16_t out[3] = { 0 };
+        cmsPipelineEval16(in, out, pipeline.data());
+
+        redChannel[i] = out[0];
+        greenChannel[i] = out[1];
+        blueChannel[i] = out[2];
+    }
+
+    return result;
+}
+
+void ColorDevicePrivate::rebuildPipeline(const State &state)
 {
     if (!pipeline) {
         pipeline.reset(cmsPipelineAlloc(nullptr, 3, 3));
@@ -95,18 +154,16 @@ void ColorDevicePrivate::rebuildPipeline()
 
     unlinkPipeline();
 
-    if (dirtyCurves & DirtyCalibrationToneCurve) {
-        updateCalibrationToneCurves();
+    if (state.dirtyCurves & DirtyCalibrationToneCurve) {
+        updateCalibrationToneCurves(state.profile);
     }
-    if (dirtyCurves & DirtyBrightnessToneCurve) {
-        updateBrightnessToneCurves();
+    if (state.dirtyCurves & DirtyBrightnessToneCurve) {
+        updateBrightnessToneCurves(state.brightness);
     }
-    if (dirtyCurves & DirtyTemperatureToneCurve) {
-        updateTemperatureToneCurves();
+    if (state.dirtyCurves & DirtyTemperatureToneCurve) {
+        updateTemperatureToneCurves(state.temperature);
     }
 
-    dirtyCurves = DirtyToneCurves();
-
     if (calibrationStage) {
         if (!cmsPipelineInsertStage(pipeline.data(), cmsAT_END, calibrationStage.data())) {
             qCWarning(KWIN_CORE) << "Failed to insert the color calibration pipeline stage";
@@ -141,7 +198,7 @@ static qreal interpolate(qreal a, qreal b, qreal blendFactor)
     return (1 - blendFactor) * a + blendFactor * b;
 }
 
-void ColorDevicePrivate::updateTemperatureToneCurves()
+void ColorDevicePrivate::updateTemperatureToneCurves(uint temperature)
 {
     temperatureStage.reset();
 
@@ -192,7 +249,7 @@ void ColorDevicePrivate::updateTemperatureToneCurves()
     }
 }
 
-void ColorDevicePrivate::updateBrightnessToneCurves()
+void ColorDevicePrivate::updateBrightnessToneCurves(uint brightness)
 {
     brightnessStage.reset();
 
@@ -229,7 +286,7 @@ void ColorDevicePrivate::updateBrightnessToneCurves()
     }
 }
 
-void ColorDevicePrivate::updateCalibrationToneCurves()
+void ColorDevicePrivate::updateCalibrationToneCurves(const QString &profile)
 {
     calibrationStage.reset();
 
@@ -271,12 +328,19 @@ ColorDevice::ColorDevice(AbstractOutput *output, QObject *parent)
     d->updateTimer->setSingleShot(true);
     connect(d->updateTimer, &QTimer::timeout, this, &ColorDevice::update);
 
+    d->updateWatcher = new QFutureWatcher<ColorDevicePrivate::Result>(this);
+    connect(d->updateWatcher, &QFutureWatcher<ColorDevicePrivate::Result>::finished,
+            this, &ColorDevice::handleGammaRampComputed);
+
     d->output = output;
     scheduleUpdate();
 }
 
 ColorDevice::~ColorDevice()
 {
+    // the worker thread uses the pipeline
+    d->updateWatcher->waitForFinished();
+
     if (d->pipeline) {
         d->unlinkPipeline();
     }
@@ -343,30 +407,58 @@ void ColorDevice::setProfile(const QString &profile)
     Q_EMIT profileChanged();
 }
 
+const GammaRamp *ColorDevice::softwareGammaRamp() const
+{
+    return d->softwareGammaRampActive ? &d->softwareGammaRamp : nullptr;
+}
+
 void ColorDevice::update()
 {
-    d->rebuildPipeline();
+    if (d->updateWatcher->isRunning()) {
+        d->updatePending = true;
+        return;
+    }
 
-    GammaRamp gammaRamp(d->output->gammaRampSize());
-    uint16_t *redChannel = gammaRamp.red();
-    uint16_t *greenChannel = gammaRamp.green();
-    uint16_t *blueChannel = gammaRamp.blue();
+    // Outputs without a hardware gamma ramp get a software one that the compositor applies.
+    const int hardwareRampSize = d->output->gammaRampSize();
+    const ColorDevicePrivate::State state{
+        d->dirtyCurves,
+        d->profile,
+        d->brightness,
+        d->temperature,
+        hardwareRampSize > 0 ? uint32_t(hardwareRampSize) : 256u,
+    };
+    d->dirtyCurves = ColorDevicePrivate::DirtyToneCurves();
 
-    for (uint32_t i = 0; i < gammaRamp.size(); ++i) {
-        // ensure 64 bit calculation to prevent overflows
-        const uint16_t index = (static_cast<uint64_t>(i) * 0xffff) / (gammaRamp.size() - 1);
+    d->updateWatcher->setFuture(QtConcurrent::run(d.data(), &ColorDevicePrivate::computeGammaRamp, state));
+}
 
-        const uint16_t in[3] = { index, index, index };
-        uint16_t out[3] = { 0 };
-        cmsPipelineEval16(in, out, d->pipeline.data());
+void ColorDevice::handleGammaRampComputed()
+{
+    const ColorDevicePrivate::Result result = d->updateWatcher->result();
 
-        redChannel[i] = out[0];
-        greenChannel[i] = out[1];
-        blueChannel[i] = out[2];
+    // An identity ramp needs no extra pass over the output contents. A failure to set the
+    // hardware gamma ramp is not a reason to fall back, it also fails while the session is
+    // inactive.
+    const bool software = d->output->gammaRampSize() <= 0 && !result.identity;
+    if (d->output->gammaRampSize() > 0 && !d->output->setGammaRamp(result.gammaRamp)) {
+        qCWarning(KWIN_CORE) << "Failed to update gamma ramp for output" << d->output;
     }
 
-    if (!d->output->setGammaRamp(gammaRamp)) {
-        qCWarning(KWIN_CORE) << "Failed to update gamma ramp for output" << d->output;
+    if (software || d->softwareGammaRampActive) {
+        d->softwareGammaRampActive = software;
+        d->softwareGammaRamp = software ? result.gammaRamp : GammaRamp(0);
+        Q_EMIT softwareGammaRampChanged();
+
+        // the compositor applies the ramp when it paints the output
+        if (Compositor::compositing()) {
+            Compositor::self()->scene()->addRepaint(d->output->geometry());
+        }
+    }
+
+    if (d->updatePending) {
+        d->updatePending = false;
+        update();
     }
 }
 
@@ -15,6 +15,7 @@ namespace KWin
 
 class AbstractOutput;
 class ColorDevicePrivate;
+class GammaRamp;
 
 /**
  * The ColorDevice class represents a color managed device.
@@ -62,6 +63,13 @@ public:
      */
     void setProfile(const QString &profile);
 
+    /**
+     * Returns the gamma ramp that the compositor has to apply to the contents of the output
+     * because the output has no usable hardware gamma ramp, or @c null if there is nothing
+     * to apply. The ramp is computed in a worker thread, so it lags behind the color settings.
+     */
+    const GammaRamp *softwareGammaRamp() const;
+
 public Q_SLOTS:
     void update();
     void scheduleUpdate();
@@ -79,8 +87,14 @@ Q_SIGNALS:
      * This signal is emitted when the color profile of this device has changed.
      */
     void profileChanged();
+    /**
+     * This signal is emitted when the software gamma ramp of this device has changed.
+     */
+    void softwareGammaRampChanged();
 
 private:
+    void handleGammaRampComputed();
+
     QScopedPointer<ColorDevicePrivate> d;
 };
 
@@ -20,6 +20,7 @@
 #include "platform.h"
 #include "qpainterbackend.h"
 #include "renderloop.h"
+#include "renderloop_p.h"
 #include "scene.h"
 #include "scenes/opengl/scene_opengl.h"
 #include "scenes/qpainter/scene_qpainter.h"
@@ -41,6 +42,7 @@
 
 #include <KGlobalAccel>
 #include <KLocalizedString>
+#include <KScreenLocker/KsldApp>
 #include <KNotification>
 #include <KSelectionOwner>
 
@@ -49,6 +51,7 @@
 #include <QMenu>
 #include <QOpenGLContext>
 #include <QQuickWindow>
+#include <QSet>
 #include <QtConcurrentRun>
 #include <QTextStream>
 #include <QTimerEvent>
@@ -56,6 +59,7 @@
 #include <xcb/composite.h>
 #include <xcb/damage.h>
 
+#include <algorithm>
 #include <cstdio>
 
 Q_DECLARE_METATYPE(KWin::X11Compositor::SuspendReason)
@@ -68,6 +72,9 @@ extern int screen_number;
 
 extern bool is_multihead;
 
+// How often completely covered windows get a frame callback.
+static const std::chrono::milliseconds s_occludedFrameInterval(1000);
+
 Compositor *Compositor::s_compositor = nullptr;
 Compositor *Compositor::self()
 {
@@ -329,8 +336,10 @@ void Compositor::initializeX11()
         m_selectionOwner->setOwning(true);
     }
 
-    xcb_composite_redirect_subwindows(connection, kwinApp()->x11RootWindow(),
-                                      XCB_COMPOSITE_REDIRECT_MANUAL);
+    if (!m_graphicsReset) {
+        xcb_composite_redirect_subwindows(connection, kwinApp()->x11RootWindow(),
+                                          XCB_COMPOSITE_REDIRECT_MANUAL);
+    }
 }
 
 void Compositor::cleanupX11()
@@ -384,6 +393,12 @@ void Compositor::startupWithWorkspace()
         }
     }
 
+    if (waylandServer() && waylandServer()->hasScreenLockerIntegration()) {
+        connect(ScreenLocker::KSldApp::self(), &ScreenLocker::KSldApp::lockStateChanged,
+                this, &Compositor::invalidateRenderList, Qt::UniqueConnection);
+    }
+    m_renderListDirty = true;
+
     // Sets also the 'effects' pointer.
     kwinApp()->platform()->createEffectsHandler(this, m_scene);
 
@@ -402,13 +417,44 @@ void Compositor::registerRenderLoop(RenderLoop *renderLoop, AbstractOutput *outp
     Q_ASSERT(!m_renderLoops.contains(renderLoop));
     m_renderLoops.insert(renderLoop, output);
     connect(renderLoop, &RenderLoop::frameRequested, this, &Compositor::handleFrameRequested);
+    connect(renderLoop, &RenderLoop::framePresented, this, &Compositor::handleFramePresented);
+    connect(renderLoop, &RenderLoop::frameFailed, this, &Compositor::handleFrameFailed);
 }
 
 void Compositor::unregisterRenderLoop(RenderLoop *renderLoop)
 {
     Q_ASSERT(m_renderLoops.contains(renderLoop));
     m_renderLoops.remove(renderLoop);
+    m_occludedFrameTimes.remove(renderLoop);
     disconnect(renderLoop, &RenderLoop::frameRequested, this, &Compositor::handleFrameRequested);
+    disconnect(renderLoop, &RenderLoop::framePresented, this, &Compositor::handleFramePresented);
+    disconnect(renderLoop, &RenderLoop::frameFailed, this, &Compositor::handleFrameFailed);
+
+    // Don't leave the clients waiting for a page flip that will never be reported.
+    sendFrameCallbacks(renderLoop, std::chrono::duration_cast<std::chrono::milliseconds>(renderLoop->lastPresentationTimestamp()));
+}
+
+void Compositor::handleFramePresented(RenderLoop *renderLoop, std::chrono::nanoseconds timestamp)
+{
+    sendFrameCallbacks(renderLoop, std::chrono::duration_cast<std::chrono::milliseconds>(timestamp));
+}
+
+void Compositor::handleFrameFailed(RenderLoop *renderLoop)
+{
+    sendFrameCallbacks(renderLoop, std::chrono::duration_cast<std::chrono::milliseconds>(renderLoop->lastPresentationTimestamp()));
+}
+
+void Compositor::sendFrameCallbacks(RenderLoop *renderLoop, std::chrono::milliseconds timestamp)
+{
+    const FrameCallbacks frameCallbacks = m_frameCallbacks.take(renderLoop);
+    for (const QPointer<KWaylandServer::SurfaceInterface> &surface : frameCallbacks.surfaces) {
+        if (surface) {
+            surface->frameRendered(timestamp.count());
+        }
+    }
+    if (frameCallbacks.cursor) {
+        Cursors::self()->currentCursor()->markAsRendered(timestamp);
+    }
 }
 
 void Compositor::handleOutputEnabled(AbstractOutput *output)
@@ -436,7 +482,9 @@ void Compositor::stop()
     m_state = State::Stopping;
     Q_EMIT aboutToToggleCompositing();
 
-    m_releaseSelectionTimer.start();
+    if (!m_graphicsReset) {
+        m_releaseSelectionTimer.start();
+    }
 
     // Some effects might need access to effect windows when they are about to
     // be destroyed, for example to unreference deleted windows, so we have to
@@ -463,7 +511,9 @@ void Compositor::stop()
         for (InternalClient *client : workspace()->internalClients()) {
             client->finishCompositing();
         }
-        if (auto *con = kwinApp()->x11Connection()) {
+        // The windows stay redirected across a graphics reset, otherwise the X server
+        // has to reallocate the pixmaps of all windows and the clients have to repaint.
+        if (auto *con = kwinApp()->x11Connection(); con && !m_graphicsReset) {
             xcb_composite_unredirect_subwindows(con, kwinApp()->x11RootWindow(),
                                                 XCB_COMPOSITE_REDIRECT_MANUAL);
         }
@@ -576,22 +626,88 @@ void Compositor::reinitialize()
     }
 }
 
+void Compositor::handleGraphicsReset()
+{
+    // Unlike reinitialize(), the configuration is not reparsed, it hasn't changed. Only the
+    // scene and the effects are recreated, they hold resources of the lost graphics context.
+    // The new EffectsHandler loads the effects on its own, the effects needed for the first
+    // frame before the others.
+    m_graphicsReset = true;
+    stop();
+    start();
+    m_graphicsReset = false;
+
+    if (m_state != State::On) {
+        // The restart failed, so nothing composites the windows that stayed redirected.
+        // Hand them back to the X server and give up the selection as stop() usually does.
+        if (auto *con = kwinApp()->x11Connection()) {
+            xcb_composite_unredirect_subwindows(con, kwinApp()->x11RootWindow(),
+                                                XCB_COMPOSITE_REDIRECT_MANUAL);
+        }
+        m_releaseSelectionTimer.start();
+    }
+}
+
 void Compositor::handleFrameRequested(RenderLoop *renderLoop)
 {
+    if (!m_dispatchingDueFrames) {
+        dispatchDueFrames(renderLoop);
+    }
     composite(renderLoop);
 }
 
-QList<Toplevel *> Compositor::windowsToRender() const
+void Compositor::dispatchDueFrames(RenderLoop *renderLoop)
 {
-    // Create a list of all windows in the stacking order
-    QList<Toplevel *> windows = Workspace::self()->xStackingOrder();
+    // All outputs are painted on the main thread, in the order their composite timers are
+    // noticed by the event loop. If the frames of other outputs are due as well, paint the
+    // ones that have to be presented earlier first, so an output with a low refresh rate and
+    // an expensive frame doesn't make an output with a high refresh rate miss its vblank.
+    const std::chrono::nanoseconds currentTime(std::chrono::steady_clock::now().time_since_epoch());
+    const std::chrono::nanoseconds deadline = RenderLoopPrivate::get(renderLoop)->nextPresentationTimestamp;
+
+    QVector<RenderLoopPrivate *> dueLoops;
+    for (auto it = m_renderLoops.constBegin(); it != m_renderLoops.constEnd(); ++it) {
+        RenderLoopPrivate *renderLoopPrivate = RenderLoopPrivate::get(it.key());
+        if (it.key() != renderLoop
+                && renderLoopPrivate->isDispatchDue(currentTime)
+                && renderLoopPrivate->nextPresentationTimestamp < deadline) {
+            dueLoops.append(renderLoopPrivate);
+        }
+    }
+    if (dueLoops.isEmpty()) {
+        return;
+    }
 
-    // Move elevated windows to the top of the stacking order
+    std::sort(dueLoops.begin(), dueLoops.end(), [](const RenderLoopPrivate *a, const RenderLoopPrivate *b) {
+        return a->nextPresentationTimestamp < b->nextPresentationTimestamp;
+    });
+
+    m_dispatchingDueFrames = true;
+    for (RenderLoopPrivate *renderLoopPrivate : qAsConst(dueLoops)) {
+        // painting may have restarted the compositor, e.g. after a graphics reset
+        if (m_state != State::On || !m_renderLoops.contains(renderLoopPrivate->q)) {
+            break;
+        }
+        renderLoopPrivate->dispatchNow();
+    }
+    m_dispatchingDueFrames = false;
+}
+
+QList<Toplevel *> Compositor::windowsToRender() const
+{
+    const QList<Toplevel *> stackingOrder = Workspace::self()->xStackingOrder();
     const QList<EffectWindow *> elevatedList = static_cast<EffectsHandlerImpl *>(effects)->elevatedWindows();
+
+    if (!m_renderListDirty
+            && stackingOrder.isSharedWith(m_renderListStackingOrder)
+            && elevatedList.isSharedWith(m_renderListElevatedWindows)) {
+        return m_renderList;
+    }
+
+    QSet<Toplevel *> elevatedWindows;
+    elevatedWindows.reserve(elevatedList.count());
     for (EffectWindow *c : elevatedList) {
-        Toplevel *t = static_cast<EffectWindowImpl *>(c)->window();
-        windows.removeAll(t);
-        windows.append(t);
+        elevatedWindows.insert(static_cast<EffectWindowImpl *>(c)->window());
     }
 
     // Skip windows that are not yet ready for being painted and if screen is locked skip windows
@@ -600,42 +716,87 @@ QList<Toplevel *> Compositor::windowsToRender() const
     // TODO? This cannot be used so carelessly - needs protections against broken clients, the
     // window should not get focus before it's displayed, handle unredirected windows properly and
     // so on.
-    for (Toplevel *win : windows) {
+    const bool screenLocked = waylandServer() && waylandServer()->isScreenLocked();
+    auto isRenderable = [screenLocked](Toplevel *win) {
         if (!win->readyForPainting()) {
-            windows.removeAll(win);
+            return false;
         }
-        if (waylandServer() && waylandServer()->isScreenLocked()) {
-            if(!win->isLockScreen() && !win->isInputMethod()) {
-                windows.removeAll(win);
-            }
+        if (screenLocked && !win->isLockScreen() && !win->isInputMethod()) {
+            return false;
+        }
+        return true;
+    };
+
+    QList<Toplevel *> windows;
+    windows.reserve(stackingOrder.count());
+    for (Toplevel *win : stackingOrder) {
+        if (!elevatedWindows.contains(win) && isRenderable(win)) {
+            windows.append(win);
         }
     }
+
+    // Move elevated windows to the top of the stacking order
+    for (EffectWindow *c : elevatedList) {
+        Toplevel *t = static_cast<EffectWindowImpl *>(c)->window();
+        if (isRenderable(t)) {
+            windows.append(t);
+        }
+    }
+
+    m_renderList = windows;
+    m_renderListStackingOrder = stackingOrder;
+    m_renderListElevatedWindows = elevatedList;
+    m_renderListDirty = false;
+
     return windows;
 }
 
+void Compositor::invalidateRenderList()
+{
+    m_renderListDirty = true;
+}
+
 void Compositor::composite(RenderLoop *renderLoop)
 {
     if (m_backend->checkGraphicsReset()) {
         qCDebug(KWIN_CORE) << "Graphics reset occurred";
         KNotification::event(QStringLiteral("graphicsreset"), i18n("Desktop effects were restarted due to a graphics reset"));
-        reinitialize();
+        handleGraphicsReset();
         return;
     }
 
     const auto &output = m_renderLoops[renderLoop];
     fTraceDuration("Paint (", output ? output->name() : QStringLiteral("screens"), ")");
 
+    renderLoop->recordFrameStage(RenderLoop::FrameStage::Started);
     const auto windows = windowsToRender();
+    renderLoop->recordFrameStage(RenderLoop::FrameStage::WindowsToRender);
 
-    const QRegion repaints = m_scene->repaints(output);
-    m_scene->resetRepaints(output);
+    // Nothing has changed on this output, e.g. the render loop was woken up only to
+    // deliver frame callbacks. Skip the painting pass, the render loop doesn't expect
+    // a frame unless beginFrame() is called.
+    if (renderLoop->isRepaintForced() || m_scene->hasPendingRepaints(output)) {
+        const QRegion repaints = m_scene->repaints(output);
+        m_scene->resetRepaints(output);
 
-    m_scene->paint(output, repaints, windows, renderLoop);
+        m_scene->paint(output, repaints, windows, renderLoop);
+    } else {
+        fTrace("Skipped paint (", output ? output->name() : QStringLiteral("screens"), ")");
+    }
 
     if (waylandServer()) {
         const std::chrono::milliseconds frameTime =
                 std::chrono::duration_cast<std::chrono::milliseconds>(renderLoop->lastPresentationTimestamp());
 
+        // Windows that are completely covered by other windows only get a frame callback
+        // once in a while, so hidden clients don't keep rendering at the full refresh rate.
+        std::chrono::milliseconds &occludedFrameTime = m_occludedFrameTimes[renderLoop];
+        const bool occludedFrameDue = frameTime - occludedFrameTime >= s_occludedFrameInterval;
+        if (occludedFrameDue) {
+            occludedFrameTime = frameTime;
+        }
+
+        FrameCallbacks &frameCallbacks = m_frameCallbacks[renderLoop];
         for (Toplevel *window : windows) {
             if (!window->readyForPainting()) {
                 continue;
@@ -647,16 +808,27 @@ void Compositor::composite(RenderLoop *renderLoop)
             if (!window->isOnOutput(output)) {
                 continue;
             }
+            if (!occludedFrameDue && m_scene->isOccluded(window, output)) {
+                continue;
+            }
             if (auto surface = window->surface()) {
-                surface->frameRendered(frameTime.count());
+                frameCallbacks.surfaces.append(surface);
             }
         }
         if (!Cursors::self()->isCursorHidden()) {
             Cursor *cursor = Cursors::self()->currentCursor();
             if (cursor->geometry().intersects(output->geometry())) {
-                cursor->markAsRendered(frameTime);
+                frameCallbacks.cursor = true;
             }
         }
+
+        // The frame callbacks are sent when the frame is actually presented, with the
+        // timestamp of the page flip, so clients can start to render the next frame in
+        // time. If no frame is in flight, e.g. because nothing needed to be painted,
+        // there is no page flip to wait for.
+        if (!RenderLoopPrivate::get(renderLoop)->pendingFrameCount) {
+            sendFrameCallbacks(renderLoop, frameTime);
+        }
     }
 }
 
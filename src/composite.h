@@ -11,15 +11,26 @@
 
 #include <kwinglobals.h>
 
+#include <QHash>
 #include <QObject>
+#include <QPointer>
 #include <QTimer>
 #include <QRegion>
+#include <QVector>
+
+#include <chrono>
+
+namespace KWaylandServer
+{
+class SurfaceInterface;
+}
 
 namespace KWin
 {
 
 class AbstractOutput;
 class CompositorSelectionOwner;
+class EffectWindow;
 class RenderBackend;
 class RenderLoop;
 class Scene;
@@ -86,6 +97,13 @@ public:
     void removeSupportProperty(xcb_atom_t atom);
     QList<Toplevel *> windowsToRender() const;
 
+    /**
+     * Marks the list of windows to render as outdated, e.g. because a window has become
+     * ready for painting. Changes in the stacking order and the elevated windows are
+     * detected automatically.
+     */
+    void invalidateRenderList();
+
 Q_SIGNALS:
     void compositingToggled(bool active);
     void aboutToDestroy();
@@ -119,6 +137,8 @@ protected Q_SLOTS:
 
 private Q_SLOTS:
     void handleFrameRequested(RenderLoop *renderLoop);
+    void handleFramePresented(RenderLoop *renderLoop, std::chrono::nanoseconds timestamp);
+    void handleFrameFailed(RenderLoop *renderLoop);
     void handleOutputEnabled(AbstractOutput *output);
     void handleOutputDisabled(AbstractOutput *output);
 
@@ -128,14 +148,20 @@ private:
 
     void releaseCompositorSelection();
     void deleteUnusedSupportProperties();
+    void handleGraphicsReset();
 
     void registerRenderLoop(RenderLoop *renderLoop, AbstractOutput *output);
     void unregisterRenderLoop(RenderLoop *renderLoop);
+    void dispatchDueFrames(RenderLoop *renderLoop);
+    void sendFrameCallbacks(RenderLoop *renderLoop, std::chrono::milliseconds timestamp);
 
     bool attemptOpenGLCompositing();
     bool attemptQPainterCompositing();
 
     State m_state = State::Off;
+    // Set while the scene is restarted because the graphics context got lost
+    bool m_graphicsReset = false;
+    bool m_dispatchingDueFrames = false;
     CompositorSelectionOwner *m_selectionOwner = nullptr;
     QTimer m_releaseSelectionTimer;
     QList<xcb_atom_t> m_unusedSupportProperties;
@@ -143,6 +169,22 @@ private:
     Scene *m_scene = nullptr;
     RenderBackend *m_backend = nullptr;
     QMap<RenderLoop *, AbstractOutput *> m_renderLoops;
+    // When the covered windows on each output got their last frame callback
+    QHash<RenderLoop *, std::chrono::milliseconds> m_occludedFrameTimes;
+    // The surfaces that wait for the frame in flight on each output to be presented
+    struct FrameCallbacks
+    {
+        QVector<QPointer<KWaylandServer::SurfaceInterface>> surfaces;
+        bool cursor = false;
+    };
+    QHash<RenderLoop *, FrameCallbacks> m_frameCallbacks;
+
+    // The inputs used to build the cached render list. QList is implicitly shared, so
+    // comparing the shared data is enough to tell whether the inputs have changed.
+    mutable QList<Toplevel *> m_renderList;
+    mutable QList<Toplevel *> m_renderListStackingOrder;
+    mutable QList<EffectWindow *> m_renderListElevatedWindows;
+    mutable bool m_renderListDirty = true;
 };
 
 class KWIN_EXPORT WaylandCompositor final : public Compositor
@@ -15,6 +15,7 @@
 
 // kwin
 #include "abstract_client.h"
+#include "abstract_output.h"
 #include "atoms.h"
 #include "composite.h"
 #include "debug_console.h"
@@ -23,6 +24,8 @@
 #include "platform.h"
 #include "pluginmanager.h"
 #include "renderbackend.h"
+#include "renderloop.h"
+#include "renderloop_p.h"
 #include "kwinadaptor.h"
 #include "unmanaged.h"
 #include "workspace.h"
@@ -330,6 +333,130 @@ void CompositorDBusInterface::reinitialize()
     m_compositor->reinitialize();
 }
 
+static RenderLoop *findRenderLoop(const QString &outputName)
+{
+    if (kwinApp()->operationMode() == Application::OperationModeX11) {
+        return kwinApp()->platform()->renderLoop();
+    }
+    const auto outputs = kwinApp()->platform()->enabledOutputs();
+    for (AbstractOutput *output : outputs) {
+        if (output->name() == outputName) {
+            return output->renderLoop();
+        }
+    }
+    return nullptr;
+}
+
+static QString latencyPolicyToString(LatencyPolicy policy)
+{
+    switch (policy) {
+    case LatencyExteremelyLow:
+        return QStringLiteral("ExtremelyLow");
+    case LatencyLow:
+        return QStringLiteral("Low");
+    case LatencyMedium:
+        return QStringLiteral("Medium");
+    case LatencyHigh:
+        return QStringLiteral("High");
+    case LatencyExtremelyHigh:
+        return QStringLiteral("ExtremelyHigh");
+    case LatencyAdaptive:
+        return QStringLiteral("Adaptive");
+    default:
+        return QString();
+    }
+}
+
+QVariantMap CompositorDBusInterface::latencyInfo(const QString &outputName) const
+{
+    RenderLoop *renderLoop = findRenderLoop(outputName);
+    if (!renderLoop) {
+        return QVariantMap();
+    }
+
+    const RenderLoopPrivate *renderLoopPrivate = RenderLoopPrivate::get(renderLoop);
+    return QVariantMap{
+        {QStringLiteral("configuredPolicy"), latencyPolicyToString(renderLoopPrivate->configuredLatencyPolicy)},
+        {QStringLiteral("policy"), latencyPolicyToString(renderLoopPrivate->latencyPolicy())},
+        {QStringLiteral("safetyMargin"), qlonglong(std::chrono::duration_cast<std::chrono::microseconds>(renderLoopPrivate->safetyMargin()).count())},
+        {QStringLiteral("missedFrames"), renderLoopPrivate->missedFrameCount},
+    };
+}
+
+QVariantMap CompositorDBusInterface::inputLatency(const QString &outputName) const
+{
+    RenderLoop *renderLoop = findRenderLoop(outputName);
+    if (!renderLoop) {
+        return QVariantMap();
+    }
+
+    auto microseconds = [](std::chrono::nanoseconds duration) {
+        return qlonglong(std::chrono::duration_cast<std::chrono::microseconds>(duration).count());
+    };
+
+    const RenderLoop::InputLatency latency = renderLoop->inputLatency();
+    QVariantList histogram;
+    histogram.reserve(latency.histogram.size());
+    for (const quint32 count : latency.histogram) {
+        histogram.append(count);
+    }
+
+    return QVariantMap{
+        {QStringLiteral("count"), latency.count},
+        {QStringLiteral("minimum"), microseconds(latency.minimum)},
+        {QStringLiteral("maximum"), microseconds(latency.maximum)},
+        {QStringLiteral("average"), latency.count ? microseconds(latency.total / latency.count) : 0},
+        {QStringLiteral("last"), microseconds(latency.last)},
+        {QStringLiteral("smoothed"), microseconds(latency.smoothed)},
+        {QStringLiteral("histogram"), histogram},
+    };
+}
+
+void CompositorDBusInterface::resetInputLatency(const QString &outputName)
+{
+    if (RenderLoop *renderLoop = findRenderLoop(outputName)) {
+        renderLoop->resetInputLatency();
+    }
+}
+
+QVariantList CompositorDBusInterface::frameTimings(const QString &outputName, int count) const
+{
+    RenderLoop *renderLoop = findRenderLoop(outputName);
+    if (!renderLoop) {
+        return QVariantList();
+    }
+
+    static const QVector<QPair<RenderLoop::FrameStage, QString>> stageNames = {
+        { RenderLoop::FrameStage::WindowsToRender, QStringLiteral("windowsToRender") },
+        { RenderLoop::FrameStage::PrePaintScreen, QStringLiteral("prePaintScreen") },
+        { RenderLoop::FrameStage::Prepass, QStringLiteral("prepass") },
+        { RenderLoop::FrameStage::Submission, QStringLiteral("submission") },
+        { RenderLoop::FrameStage::EndFrame, QStringLiteral("endFrame") },
+        { RenderLoop::FrameStage::PageFlipped, QStringLiteral("pageFlipped") },
+    };
+
+    QVariantList frames;
+    const auto timings = renderLoop->frameTimings(count);
+    for (const RenderLoop::FrameTimings &frame : timings) {
+        const std::chrono::nanoseconds started = frame.timestamp(RenderLoop::FrameStage::Started);
+
+        QVariantMap entry;
+        entry.insert(QStringLiteral("sequence"), frame.sequence);
+        entry.insert(QStringLiteral("started"), qlonglong(std::chrono::duration_cast<std::chrono::microseconds>(started).count()));
+        if (frame.renderTime != std::chrono::nanoseconds::zero()) {
+            entry.insert(QStringLiteral("renderTime"), qlonglong(std::chrono::duration_cast<std::chrono::microseconds>(frame.renderTime).count()));
+        }
+        for (const auto &[stage, name] : stageNames) {
+            const std::chrono::nanoseconds timestamp = frame.timestamp(stage);
+            if (timestamp != std::chrono::nanoseconds::zero()) {
+                entry.insert(name, qlonglong(std::chrono::duration_cast<std::chrono::microseconds>(timestamp - started).count()));
+            }
+        }
+        frames.append(entry);
+    }
+    return frames;
+}
+
 QStringList CompositorDBusInterface::supportedOpenGLPlatformInterfaces() const
 {
     QStringList interfaces;
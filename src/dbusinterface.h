@@ -193,6 +193,66 @@ public Q_SLOTS:
      */
     void reinitialize();
 
+    /**
+     * @brief Returns the timings of up to @a count most recently rendered frames on the
+     * output with the given @a outputName, ordered from the oldest to the newest frame.
+     *
+     * On X11, the output name is ignored because all screens share a single render loop.
+     *
+     * Every frame is described by a map with the following entries:
+     * @li @c sequence The sequence number of the frame
+     * @li @c started The monotonic timestamp of the compositing cycle start, in microseconds
+     * @li @c windowsToRender, @c prePaintScreen, @c prepass, @c submission, @c endFrame,
+     * @c pageFlipped The time at which the frame has reached the given stage, in
+     * microseconds since the start. Stages that have not been reached are omitted.
+     * @li @c renderTime The time the GPU took to render the frame, in microseconds. Omitted
+     * if it hasn't been measured.
+     *
+     * @return QVariantList
+     */
+    QVariantList frameTimings(const QString &outputName, int count) const;
+
+    /**
+     * @brief Returns the latency policy that is in effect on the output with the given
+     * @a outputName.
+     *
+     * On X11, the output name is ignored because all screens share a single render loop.
+     *
+     * The returned map has the following entries:
+     * @li @c configuredPolicy The latency policy configured by the user
+     * @li @c policy The latency policy in effect, which differs from the configured one
+     * if the adaptive policy is configured
+     * @li @c safetyMargin The safety margin in microseconds
+     * @li @c missedFrames The number of frames that missed their deadline in adaptive mode
+     *
+     * @return QVariantMap
+     */
+    QVariantMap latencyInfo(const QString &outputName) const;
+
+    /**
+     * @brief Returns the input-to-photon latency measured on the output with the given
+     * @a outputName, i.e. the time between a pointer motion event and the page flip of the
+     * first frame that shows the moved cursor. Only software cursors are measured.
+     *
+     * On X11, the output name is ignored because all screens share a single render loop.
+     *
+     * The returned map has the following entries:
+     * @li @c count The number of measured input events
+     * @li @c minimum, @c maximum, @c average, @c last The latency in microseconds
+     * @li @c smoothed The moving average of the recent latencies in microseconds
+     * @li @c histogram The number of latencies per millisecond, the last bucket counts all
+     * latencies that don't fit in the other buckets
+     *
+     * @return QVariantMap
+     */
+    QVariantMap inputLatency(const QString &outputName) const;
+
+    /**
+     * @brief Forgets the input latencies that have been measured on the output with the
+     * given @a outputName.
+     */
+    void resetInputLatency(const QString &outputName);
+
 Q_SIGNALS:
     void compositingToggled(bool active);
 
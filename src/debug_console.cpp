@@ -7,17 +7,26 @@
     SPDX-License-Identifier: GPL-2.0-or-later
 */
 #include "debug_console.h"
+#include "abstract_output.h"
 #include "composite.h"
+#include "deleted.h"
+#include "effects.h"
 #include "input_event.h"
 #include "inputdevice.h"
 #include "internal_client.h"
 #include "keyboard_input.h"
 #include "main.h"
+#include "openglsurfacetexture.h"
+#include "opengltexturebudget.h"
+#include "platform.h"
+#include "renderloop.h"
 #include "scene.h"
+#include "surfaceitem.h"
 #include "unmanaged.h"
 #include "utils/subsurfacemonitor.h"
 #include "wayland_server.h"
 #include "waylandclient.h"
+#include "windowitem.h"
 #include "workspace.h"
 #include "x11client.h"
 #include <kwinglplatform.h>
@@ -45,7 +54,9 @@
 #include <QMetaProperty>
 #include <QMetaType>
 #include <QMouseEvent>
+#include <QPainter>
 #include <QScopeGuard>
+#include <QTimer>
 #include <QtConcurrentRun>
 
 #include <wayland-server-core.h>
@@ -53,6 +64,7 @@
 // xkb
 #include <xkbcommon/xkbcommon.h>
 
+#include <algorithm>
 #include <fcntl.h>
 #include <functional>
 #include <sys/poll.h>
@@ -601,6 +613,8 @@ DebugConsole::DebugConsole()
     m_ui->primaryContent->setModel(new DataSourceModel(this));
     m_ui->inputDevicesView->setModel(new InputDeviceModel(this));
     m_ui->inputDevicesView->setItemDelegate(new DebugConsoleDelegate(this));
+    m_ui->windowPerformanceView->setModel(new WindowPerformanceModel(this));
+    m_ui->effectPerformanceView->setModel(new EffectPerformanceModel(this));
     m_ui->quitButton->setIcon(QIcon::fromTheme(QStringLiteral("application-exit")));
     m_ui->tabWidget->setTabIcon(0, QIcon::fromTheme(QStringLiteral("view-list-tree")));
     m_ui->tabWidget->setTabIcon(1, QIcon::fromTheme(QStringLiteral("view-list-tree")));
@@ -611,14 +625,23 @@ DebugConsole::DebugConsole()
         m_ui->tabWidget->setTabEnabled(6, false);
     }
 
+    m_performanceTimer = new QTimer(this);
+    m_performanceTimer->setInterval(1000);
+    connect(m_performanceTimer, &QTimer::timeout, this, &DebugConsole::updatePerformanceTab);
+
     connect(m_ui->quitButton, &QAbstractButton::clicked, this, &DebugConsole::deleteLater);
     connect(m_ui->tabWidget, &QTabWidget::currentChanged, this,
         [this] (int index) {
+            // measuring the painting costs something, only do it while the results are shown
+            setPerformanceTabVisible(index == 7);
             // delay creation of input event filter until the tab is selected
             if (index == 2 && m_inputFilter.isNull()) {
                 m_inputFilter.reset(new DebugConsoleFilter(m_ui->inputTextEdit));
                 input()->installInputEventSpy(m_inputFilter.data());
             }
+            if (index == 4) {
+                updateTextureMemory();
+            }
             if (index == 5) {
                 updateKeyboardTab();
                 connect(input(), &InputRedirection::keyStateChanged, this, &DebugConsole::updateKeyboardTab);
@@ -646,7 +669,10 @@ DebugConsole::DebugConsole()
     initGLTab();
 }
 
-DebugConsole::~DebugConsole() = default;
+DebugConsole::~DebugConsole()
+{
+    setPerformanceTabVisible(false);
+}
 
 void DebugConsole::initGLTab()
 {
@@ -678,6 +704,66 @@ void DebugConsole::initGLTab()
 
     m_ui->platformExtensionsLabel->setText(extensionsString(Compositor::self()->scene()->openGLPlatformInterfaceExtensions()));
     m_ui->openGLExtensionsLabel->setText(extensionsString(openGLExtensions()));
+
+    updateTextureMemory();
+}
+
+void DebugConsole::updateTextureMemory()
+{
+    if (!effects || !effects->isOpenGLCompositing()) {
+        return;
+    }
+    const OpenGLTextureBudget *budget = OpenGLTextureBudget::self();
+    const QLocale locale;
+    if (budget->budget()) {
+        m_ui->textureBudgetLabel->setText(locale.formattedDataSize(budget->budget()));
+    } else {
+        m_ui->textureBudgetLabel->setText(i18nc("The texture memory budget is not set", "Unlimited"));
+    }
+    m_ui->residentTexturesLabel->setText(QString::number(budget->residentCount()));
+    m_ui->residentTextureMemoryLabel->setText(locale.formattedDataSize(budget->residentBytes()));
+    m_ui->textureEvictionsLabel->setText(QString::number(budget->evictionCount()));
+    m_ui->textureRecreationsLabel->setText(QString::number(budget->recreationCount()));
+}
+
+void DebugConsole::setPerformanceTabVisible(bool visible)
+{
+    if (visible == m_performanceTimer->isActive()) {
+        return;
+    }
+    PaintStatistics::self()->setEnabled(visible);
+    if (!visible) {
+        m_performanceTimer->stop();
+        return;
+    }
+
+    // outputs may have been added or removed since the tab has been shown the last time
+    const auto graphs = m_ui->frameTimeGraphs->findChildren<FrameTimeGraph *>(QString(), Qt::FindDirectChildrenOnly);
+    qDeleteAll(graphs);
+    if (kwinApp()->operationMode() == Application::OperationModeX11) {
+        m_ui->frameTimeGraphsLayout->addWidget(new FrameTimeGraph(i18n("All screens"), kwinApp()->platform()->renderLoop(), m_ui->frameTimeGraphs));
+    } else {
+        const auto outputs = kwinApp()->platform()->enabledOutputs();
+        for (AbstractOutput *output : outputs) {
+            m_ui->frameTimeGraphsLayout->addWidget(new FrameTimeGraph(output->name(), output->renderLoop(), m_ui->frameTimeGraphs));
+        }
+    }
+
+    m_performanceClock.start();
+    m_performanceTimer->start();
+    updatePerformanceTab();
+}
+
+void DebugConsole::updatePerformanceTab()
+{
+    const std::chrono::milliseconds elapsed(m_performanceClock.restart());
+    static_cast<WindowPerformanceModel *>(m_ui->windowPerformanceView->model())->update(elapsed);
+    static_cast<EffectPerformanceModel *>(m_ui->effectPerformanceView->model())->update();
+
+    const auto graphs = m_ui->frameTimeGraphs->findChildren<FrameTimeGraph *>(QString(), Qt::FindDirectChildrenOnly);
+    for (FrameTimeGraph *graph : graphs) {
+        graph->update();
+    }
 }
 
 template <typename T>
@@ -1720,4 +1806,375 @@ void DataSourceModel::setSource(KWaylandServer::AbstractDataSource *source)
     }
     endResetModel();
 }
+
+static QString windowName(const Toplevel *window)
+{
+    if (auto client = qobject_cast<const AbstractClient *>(window)) {
+        return client->caption();
+    }
+    if (auto deleted = qobject_cast<const Deleted *>(window)) {
+        return deleted->caption();
+    }
+    return QString::fromUtf8(window->resourceClass());
+}
+
+static qint64 textureMemory(const Item *item)
+{
+    qint64 bytes = 0;
+    if (auto surfaceItem = qobject_cast<const SurfaceItem *>(item)) {
+        if (SurfacePixmap *pixmap = surfaceItem->pixmap()) {
+            if (auto texture = dynamic_cast<const OpenGLSurfaceTexture *>(pixmap->texture())) {
+                bytes += texture->residentBytes();
+            }
+        }
+    }
+    const auto childItems = item->childItems();
+    for (const Item *childItem : childItems) {
+        bytes += textureMemory(childItem);
+    }
+    return bytes;
+}
+
+static QString formatFrameTime(std::chrono::nanoseconds time)
+{
+    return i18nc("Time spent per painted frame in microseconds", "%1 µs",
+                 QLocale().toString(std::chrono::duration<qreal, std::micro>(time).count(), 'f', 1));
+}
+
+WindowPerformanceModel::WindowPerformanceModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+WindowPerformanceModel::~WindowPerformanceModel() = default;
+
+int WindowPerformanceModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rows.count();
+}
+
+int WindowPerformanceModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : 5;
+}
+
+QVariant WindowPerformanceModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole || orientation != Qt::Horizontal) {
+        return QVariant();
+    }
+    switch (section) {
+    case 0:
+        return i18nc("@title:column", "Window");
+    case 1:
+        return i18nc("@title:column Number of surface commits per second", "Commits");
+    case 2:
+        return i18nc("@title:column Damaged area per second", "Damage");
+    case 3:
+        return i18nc("@title:column", "Texture Memory");
+    case 4:
+        return i18nc("@title:column Time spent painting the window per frame", "Paint Time");
+    default:
+        return QVariant();
+    }
+}
+
+QVariant WindowPerformanceModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_rows.count()) {
+        return QVariant();
+    }
+    if (role == Qt::TextAlignmentRole && index.column() > 0) {
+        return int(Qt::AlignRight | Qt::AlignVCenter);
+    }
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    const Row &row = m_rows.at(index.row());
+    const QLocale locale;
+    switch (index.column()) {
+    case 0:
+        return row.window ? windowName(row.window) : i18nc("The window has been destroyed", "Destroyed");
+    case 1:
+        return i18nc("Commits per second", "%1/s", locale.toString(row.commitRate, 'f', 1));
+    case 2:
+        return i18nc("Megapixels per second", "%1 MP/s", locale.toString(row.damageRate / 1000000, 'f', 2));
+    case 3:
+        return locale.formattedDataSize(row.textureMemory);
+    case 4:
+        return formatFrameTime(row.paintTime);
+    default:
+        return QVariant();
+    }
+}
+
+void WindowPerformanceModel::watch(Toplevel *window)
+{
+    Counters &counters = m_counters[window];
+
+    counters.damagedConnection = connect(window, &Toplevel::damaged, this, [this, window](Toplevel *, const QRegion &damage) {
+        auto it = m_counters.find(window);
+        if (it == m_counters.end()) {
+            return;
+        }
+        for (const QRect &rect : damage) {
+            it->damagedPixels += qint64(rect.width()) * rect.height();
+        }
+    });
+    if (KWaylandServer::SurfaceInterface *surface = window->surface()) {
+        counters.committedConnection = connect(surface, &KWaylandServer::SurfaceInterface::committed, this, [this, window]() {
+            auto it = m_counters.find(window);
+            if (it != m_counters.end()) {
+                it->commits++;
+            }
+        });
+    }
+    counters.paintTime = PaintStatistics::self()->windowPaintTime(window);
+}
+
+void WindowPerformanceModel::update(std::chrono::milliseconds elapsed)
+{
+    const PaintStatistics *statistics = PaintStatistics::self();
+    const quint64 frameCount = statistics->frameCount();
+    const quint64 frames = frameCount >= m_frameCount ? frameCount - m_frameCount : frameCount;
+    m_frameCount = frameCount;
+    const qreal seconds = elapsed.count() / 1000.0;
+
+    const QList<Toplevel *> stackingOrder = workspace()->stackingOrder();
+
+    // forget the windows that are gone, before their pointers can be reused
+    for (auto it = m_counters.begin(); it != m_counters.end();) {
+        if (stackingOrder.contains(it.key())) {
+            ++it;
+        } else {
+            disconnect(it->damagedConnection);
+            disconnect(it->committedConnection);
+            it = m_counters.erase(it);
+        }
+    }
+
+    QVector<Row> rows;
+    rows.reserve(stackingOrder.count());
+    // the topmost window first
+    for (auto it = stackingOrder.crbegin(); it != stackingOrder.crend(); ++it) {
+        Toplevel *window = *it;
+        if (!m_counters.contains(window)) {
+            watch(window);
+        }
+        Counters &counters = m_counters[window];
+        const std::chrono::nanoseconds paintTime = statistics->windowPaintTime(window);
+
+        Row row;
+        row.window = window;
+        if (seconds > 0) {
+            row.commitRate = counters.commits / seconds;
+            row.damageRate = counters.damagedPixels / seconds;
+        }
+        if (frames && paintTime >= counters.paintTime) {
+            row.paintTime = (paintTime - counters.paintTime) / frames;
+        }
+        if (const WindowItem *windowItem = window->windowItem()) {
+            row.textureMemory = textureMemory(windowItem);
+        }
+        rows.append(row);
+
+        counters.commits = 0;
+        counters.damagedPixels = 0;
+        counters.paintTime = paintTime;
+    }
+
+    const bool sameWindows = std::equal(rows.cbegin(), rows.cend(), m_rows.cbegin(), m_rows.cend(), [](const Row &a, const Row &b) {
+        return a.window == b.window;
+    });
+    if (sameWindows) {
+        m_rows = rows;
+        if (!m_rows.isEmpty()) {
+            Q_EMIT dataChanged(index(0, 1), index(m_rows.count() - 1, columnCount(QModelIndex()) - 1));
+        }
+    } else {
+        beginResetModel();
+        m_rows = rows;
+        endResetModel();
+    }
+}
+
+EffectPerformanceModel::EffectPerformanceModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+EffectPerformanceModel::~EffectPerformanceModel() = default;
+
+int EffectPerformanceModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rows.count();
+}
+
+int EffectPerformanceModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : 2 + PaintStatistics::PassCount;
+}
+
+QVariant EffectPerformanceModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole || orientation != Qt::Horizontal) {
+        return QVariant();
+    }
+    switch (section) {
+    case 0:
+        return i18nc("@title:column", "Effect");
+    case 1:
+        return i18nc("@title:column Whether the effect is active", "Active");
+    case 2:
+        return QStringLiteral("prePaintScreen");
+    case 3:
+        return QStringLiteral("paintWindow");
+    case 4:
+        return QStringLiteral("drawWindow");
+    default:
+        return QVariant();
+    }
+}
+
+QVariant EffectPerformanceModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_rows.count()) {
+        return QVariant();
+    }
+    if (role == Qt::TextAlignmentRole && index.column() > 1) {
+        return int(Qt::AlignRight | Qt::AlignVCenter);
+    }
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    const Row &row = m_rows.at(index.row());
+    if (index.column() == 0) {
+        return row.name;
+    } else if (index.column() == 1) {
+        return row.active ? i18nc("The effect is active", "Yes") : i18nc("The effect is not active", "No");
+    } else if (index.column() - 2 < PaintStatistics::PassCount) {
+        return formatFrameTime(row.times[index.column() - 2]);
+    }
+    return QVariant();
+}
+
+void EffectPerformanceModel::update()
+{
+    auto effectsImpl = static_cast<EffectsHandlerImpl *>(effects);
+    const PaintStatistics *statistics = PaintStatistics::self();
+    const quint64 frameCount = statistics->frameCount();
+    const quint64 frames = frameCount >= m_frameCount ? frameCount - m_frameCount : frameCount;
+    m_frameCount = frameCount;
+
+    QVector<Row> rows;
+    QHash<QString, PaintStatistics::Timings> lastTimes;
+    auto addRow = [&](const QString &key, const QString &name, bool active, const Effect *effect) {
+        const PaintStatistics::Timings times = statistics->effectTimings(effect);
+        const PaintStatistics::Timings previous = m_lastTimes.value(key, PaintStatistics::Timings{});
+        Row row;
+        row.name = name;
+        row.active = active;
+        for (int i = 0; i < PaintStatistics::PassCount; ++i) {
+            if (frames && times[i] >= previous[i]) {
+                row.times[i] = (times[i] - previous[i]) / frames;
+            }
+        }
+        rows.append(row);
+        lastTimes.insert(key, times);
+    };
+
+    if (effectsImpl) {
+        const QStringList names = effectsImpl->loadedEffects();
+        for (const QString &name : names) {
+            if (const Effect *effect = effectsImpl->findEffect(name)) {
+                addRow(name, name, effect->isActive(), effect);
+            }
+        }
+        // whatever is left after the last effect in the chain
+        addRow(QString(), i18nc("The painting done by the compositor itself", "Scene"), true, nullptr);
+    }
+    m_lastTimes = lastTimes;
+
+    const bool sameEffects = std::equal(rows.cbegin(), rows.cend(), m_rows.cbegin(), m_rows.cend(), [](const Row &a, const Row &b) {
+        return a.name == b.name;
+    });
+    if (sameEffects) {
+        m_rows = rows;
+        if (!m_rows.isEmpty()) {
+            Q_EMIT dataChanged(index(0, 1), index(m_rows.count() - 1, columnCount(QModelIndex()) - 1));
+        }
+    } else {
+        beginResetModel();
+        m_rows = rows;
+        endResetModel();
+    }
+}
+
+static const int s_frameTimeGraphFrameCount = 128;
+
+FrameTimeGraph::FrameTimeGraph(const QString &name, RenderLoop *renderLoop, QWidget *parent)
+    : QWidget(parent)
+    , m_name(name)
+    , m_renderLoop(renderLoop)
+{
+}
+
+FrameTimeGraph::~FrameTimeGraph() = default;
+
+QSize FrameTimeGraph::sizeHint() const
+{
+    return QSize(2 * s_frameTimeGraphFrameCount, 80);
+}
+
+void FrameTimeGraph::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event)
+
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().base());
+    if (!m_renderLoop) {
+        return;
+    }
+
+    // The graph spans two refresh cycles, so frames that miss the deadline stand out.
+    const int refreshRate = m_renderLoop->refreshRate();
+    const std::chrono::nanoseconds refreshInterval(refreshRate > 0 ? 1'000'000'000'000 / refreshRate : 16'666'667);
+    const qreal scale = height() / (2.0 * refreshInterval.count());
+    const qreal barWidth = qreal(width()) / s_frameTimeGraphFrameCount;
+
+    std::chrono::nanoseconds total = std::chrono::nanoseconds::zero();
+    int count = 0;
+    const QVector<RenderLoop::FrameTimings> frames = m_renderLoop->frameTimings(s_frameTimeGraphFrameCount);
+    for (int i = 0; i < frames.count(); ++i) {
+        const RenderLoop::FrameTimings &frame = frames[i];
+        const std::chrono::nanoseconds started = frame.timestamp(RenderLoop::FrameStage::Started);
+        const std::chrono::nanoseconds ended = frame.timestamp(RenderLoop::FrameStage::EndFrame);
+        if (started == std::chrono::nanoseconds::zero() || ended < started) {
+            continue;
+        }
+        const std::chrono::nanoseconds cpuTime = ended - started;
+        total += cpuTime;
+        count++;
+
+        // the newest frame on the right
+        const qreal x = width() - (frames.count() - i) * barWidth;
+        const qreal cpuHeight = cpuTime.count() * scale;
+        painter.fillRect(QRectF(x, height() - cpuHeight, barWidth, cpuHeight), palette().highlight());
+        if (frame.renderTime != std::chrono::nanoseconds::zero()) {
+            const qreal gpuHeight = frame.renderTime.count() * scale;
+            painter.fillRect(QRectF(x + barWidth / 4, height() - gpuHeight, barWidth / 2, gpuHeight), palette().link());
+        }
+    }
+
+    painter.setPen(QPen(palette().text(), 1, Qt::DashLine));
+    painter.drawLine(QPointF(0, height() / 2.0), QPointF(width(), height() / 2.0));
+
+    painter.setPen(palette().text().color());
+    const QString average = count ? QLocale().toString(std::chrono::duration<qreal, std::milli>(total / count).count(), 'f', 2) : QStringLiteral("-");
+    painter.drawText(rect().adjusted(4, 4, -4, -4), Qt::AlignTop | Qt::AlignLeft,
+                     i18nc("Name of the output and the average time to render a frame", "%1: %2 ms on average", m_name, average));
+}
+
 }
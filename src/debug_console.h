@@ -13,13 +13,21 @@
 #include <config-kwin.h>
 #include "input.h"
 #include "input_event_spy.h"
+#include "paintstatistics.h"
 
 #include <QAbstractItemModel>
+#include <QAbstractTableModel>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QPointer>
 #include <QStyledItemDelegate>
 #include <QVector>
+#include <QWidget>
+#include <chrono>
 #include <functional>
 
 class QTextEdit;
+class QTimer;
 
 namespace KWaylandServer
 {
@@ -40,6 +48,8 @@ class InternalClient;
 class Unmanaged;
 class DebugConsoleFilter;
 class WaylandClient;
+class RenderLoop;
+class Toplevel;
 
 class KWIN_EXPORT DebugConsoleModel : public QAbstractItemModel
 {
@@ -108,10 +118,15 @@ protected:
 
 private:
     void initGLTab();
+    void updateTextureMemory();
     void updateKeyboardTab();
+    void setPerformanceTabVisible(bool visible);
+    void updatePerformanceTab();
 
     QScopedPointer<Ui::DebugConsole> m_ui;
     QScopedPointer<DebugConsoleFilter> m_inputFilter;
+    QTimer *m_performanceTimer = nullptr;
+    QElapsedTimer m_performanceClock;
 };
 
 class SurfaceTreeModel : public QAbstractItemModel
@@ -205,6 +220,100 @@ private:
     KWaylandServer::AbstractDataSource *m_source = nullptr;
     QVector<QByteArray> m_data;
 };
+
+/**
+ * Shows how often every window commits new contents, how much of it is damaged, how much
+ * texture memory it uses and how long it takes to paint. The rates are computed from the
+ * counters collected between two calls to update().
+ */
+class WindowPerformanceModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    explicit WindowPerformanceModel(QObject *parent = nullptr);
+    ~WindowPerformanceModel() override;
+
+    int rowCount(const QModelIndex &parent) const override;
+    int columnCount(const QModelIndex &parent) const override;
+    QVariant data(const QModelIndex &index, int role) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    void update(std::chrono::milliseconds elapsed);
+
+private:
+    struct Counters
+    {
+        int commits = 0;
+        qint64 damagedPixels = 0;
+        std::chrono::nanoseconds paintTime = std::chrono::nanoseconds::zero();
+        QMetaObject::Connection damagedConnection;
+        QMetaObject::Connection committedConnection;
+    };
+    struct Row
+    {
+        QPointer<Toplevel> window;
+        qreal commitRate = 0;
+        qreal damageRate = 0;
+        qint64 textureMemory = 0;
+        std::chrono::nanoseconds paintTime = std::chrono::nanoseconds::zero();
+    };
+
+    void watch(Toplevel *window);
+
+    QHash<Toplevel *, Counters> m_counters;
+    QVector<Row> m_rows;
+    quint64 m_frameCount = 0;
+};
+
+/**
+ * Shows how long every loaded effect takes in the painting passes, per painted frame.
+ */
+class EffectPerformanceModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    explicit EffectPerformanceModel(QObject *parent = nullptr);
+    ~EffectPerformanceModel() override;
+
+    int rowCount(const QModelIndex &parent) const override;
+    int columnCount(const QModelIndex &parent) const override;
+    QVariant data(const QModelIndex &index, int role) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    void update();
+
+private:
+    struct Row
+    {
+        QString name;
+        bool active = false;
+        PaintStatistics::Timings times = {};
+    };
+
+    QVector<Row> m_rows;
+    QHash<QString, PaintStatistics::Timings> m_lastTimes;
+    quint64 m_frameCount = 0;
+};
+
+/**
+ * Draws the render times of the most recent frames of an output.
+ */
+class FrameTimeGraph : public QWidget
+{
+    Q_OBJECT
+public:
+    FrameTimeGraph(const QString &name, RenderLoop *renderLoop, QWidget *parent = nullptr);
+    ~FrameTimeGraph() override;
+
+    QSize sizeHint() const override;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    QString m_name;
+    QPointer<RenderLoop> m_renderLoop;
+};
 }
 
 #endif
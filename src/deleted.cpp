@@ -53,6 +53,13 @@ Deleted::~Deleted()
 
 Deleted* Deleted::create(Toplevel* c)
 {
+    // The window has never been shown, so there is nothing to animate and the effects
+    // don't know about it. Don't keep a copy of its state and its items around, but the
+    // window still has to leave the stacking order, as no Deleted takes its place.
+    if (!c->readyForPainting()) {
+        workspace()->removeClosedWindow(c);
+        return nullptr;
+    }
     Deleted* d = new Deleted();
     d->copyToDeleted(c);
     workspace()->addDeleted(d, c);
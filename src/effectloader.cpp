@@ -22,6 +22,8 @@
 #include <QtConcurrentRun>
 #include <QDebug>
 #include <QFutureWatcher>
+#include <QJsonObject>
+#include <QPluginLoader>
 #include <QStaticPlugin>
 #include <QStringList>
 
@@ -42,6 +44,16 @@ void AbstractEffectLoader::setConfig(KSharedConfig::Ptr config)
     m_config = config;
 }
 
+void AbstractEffectLoader::loadDeferredEffects()
+{
+}
+
+bool AbstractEffectLoader::isDeferred(const KPluginMetaData &metaData)
+{
+    const QJsonObject effectData = metaData.rawData().value(QStringLiteral("org.kde.kwin.effect")).toObject();
+    return effectData.value(QStringLiteral("deferred")).toBool();
+}
+
 LoadEffectFlags AbstractEffectLoader::readConfig(const QString &effectName, bool defaultValue) const
 {
     Q_ASSERT(m_config);
@@ -155,7 +167,12 @@ void ScriptedEffectLoader::queryAndLoadAll()
             const auto effects = watcher->result();
             for (const auto &effect : effects) {
                 const LoadEffectFlags flags = readConfig(effect.pluginId(), effect.isEnabledByDefault());
-                if (flags.testFlag(LoadEffectFlag::Load)) {
+                if (!flags.testFlag(LoadEffectFlag::Load)) {
+                    continue;
+                }
+                if (isDeferred(effect)) {
+                    m_queue->enqueueDeferred(qMakePair(effect, flags));
+                } else {
                     m_queue->enqueue(qMakePair(effect, flags));
                 }
             }
@@ -166,6 +183,11 @@ void ScriptedEffectLoader::queryAndLoadAll()
     watcher->setFuture(QtConcurrent::run(this, &ScriptedEffectLoader::findAllEffects));
 }
 
+void ScriptedEffectLoader::loadDeferredEffects()
+{
+    m_queue->releaseDeferred();
+}
+
 QList<KPluginMetaData> ScriptedEffectLoader::findAllEffects() const
 {
     return KPackage::PackageLoader::self()->listPackages(s_serviceType, QStringLiteral("kwin/effects"));
@@ -195,6 +217,7 @@ void ScriptedEffectLoader::clear()
 PluginEffectLoader::PluginEffectLoader(QObject *parent)
     : AbstractEffectLoader(parent)
     , m_pluginSubDirectory(QStringLiteral("kwin/effects/plugins"))
+    , m_queue(new EffectLoadQueue<PluginEffectLoader, KPluginMetaData>(this))
 {
 }
 
@@ -329,13 +352,75 @@ bool PluginEffectLoader::loadEffect(const KPluginMetaData &info, LoadEffectFlags
 
 void PluginEffectLoader::queryAndLoadAll()
 {
-    const auto effects = findAllEffects();
+    if (m_queryConnection || m_preloadConnection) {
+        return;
+    }
+    // scanning the plugin directory parses the metadata of every plugin, do it in a thread
+    QFutureWatcher<QVector<KPluginMetaData>> *watcher = new QFutureWatcher<QVector<KPluginMetaData>>(this);
+    m_queryConnection = connect(watcher, &QFutureWatcher<QVector<KPluginMetaData>>::finished, this,
+        [this, watcher]() {
+            const auto plugins = watcher->result();
+            QVector<QPair<KPluginMetaData, LoadEffectFlags>> effects;
+            for (const auto &effect : plugins) {
+                const LoadEffectFlags flags = readConfig(effect.pluginId(), effect.isEnabledByDefault());
+                if (flags.testFlag(LoadEffectFlag::Load)) {
+                    effects << qMakePair(effect, flags);
+                }
+            }
+            watcher->deleteLater();
+            m_queryConnection = QMetaObject::Connection();
+            enqueueEffects(effects);
+        },
+        Qt::QueuedConnection);
+    watcher->setFuture(QtConcurrent::run(this, &PluginEffectLoader::findAllEffects));
+}
+
+static bool preloadLibrary(const QString &fileName)
+{
+    // the library stays loaded after the loader is gone, so that creating the
+    // factory in the compositor thread later on doesn't need to resolve it again
+    return QPluginLoader(fileName).load();
+}
+
+void PluginEffectLoader::enqueueEffects(const QVector<QPair<KPluginMetaData, LoadEffectFlags>> &effects)
+{
+    auto enqueue = [this, effects]() {
+        for (const auto &effect : effects) {
+            if (isDeferred(effect.first)) {
+                m_queue->enqueueDeferred(effect);
+            } else {
+                m_queue->enqueue(effect);
+            }
+        }
+    };
+
+    QStringList libraries;
     for (const auto &effect : effects) {
-        const LoadEffectFlags flags = readConfig(effect.pluginId(), effect.isEnabledByDefault());
-        if (flags.testFlag(LoadEffectFlag::Load)) {
-            loadEffect(effect, flags);
+        if (!effect.first.isStaticPlugin() && !m_loadedEffects.contains(effect.first.pluginId())) {
+            libraries << effect.first.fileName();
         }
     }
+    if (libraries.isEmpty()) {
+        enqueue();
+        return;
+    }
+
+    // load the libraries of the third party effects in parallel, the effects
+    // themselves have to be created in the compositor thread
+    QFutureWatcher<bool> *watcher = new QFutureWatcher<bool>(this);
+    m_preloadConnection = connect(watcher, &QFutureWatcher<bool>::finished, this,
+        [this, watcher, enqueue]() {
+            watcher->deleteLater();
+            m_preloadConnection = QMetaObject::Connection();
+            enqueue();
+        },
+        Qt::QueuedConnection);
+    watcher->setFuture(QtConcurrent::mapped(libraries, preloadLibrary));
+}
+
+void PluginEffectLoader::loadDeferredEffects()
+{
+    m_queue->releaseDeferred();
 }
 
 QVector<KPluginMetaData> PluginEffectLoader::findAllEffects() const
@@ -350,6 +435,11 @@ void PluginEffectLoader::setPluginSubDirectory(const QString &directory)
 
 void PluginEffectLoader::clear()
 {
+    disconnect(m_queryConnection);
+    m_queryConnection = QMetaObject::Connection();
+    disconnect(m_preloadConnection);
+    m_preloadConnection = QMetaObject::Connection();
+    m_queue->clear();
 }
 
 EffectLoader::EffectLoader(QObject *parent)
@@ -423,4 +513,11 @@ void EffectLoader::clear()
     }
 }
 
+void EffectLoader::loadDeferredEffects()
+{
+    for (auto it = m_loaders.constBegin(); it != m_loaders.constEnd(); ++it) {
+        (*it)->loadDeferredEffects();
+    }
+}
+
 } // namespace KWin
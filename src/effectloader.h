@@ -157,6 +157,18 @@ public:
      */
     virtual void clear() = 0;
 
+    /**
+     * @brief Starts loading the Effects which queryAndLoadAll() held back.
+     *
+     * Effects that are not needed to composite the first frame, e.g. the overview or the
+     * screenshot helper, can mark themselves as deferred with the "deferred" key in the
+     * "org.kde.kwin.effect" object of their metadata. queryAndLoadAll() only loads them
+     * after this method has been invoked, from then on they are loaded like all the others.
+     *
+     * The default implementation does nothing.
+     */
+    virtual void loadDeferredEffects();
+
 Q_SIGNALS:
     /**
      * @brief The loader emits this signal when it successfully loaded an effect.
@@ -169,6 +181,12 @@ Q_SIGNALS:
 
 protected:
     explicit AbstractEffectLoader(QObject *parent = nullptr);
+    /**
+     * @brief Whether the Effect described by @p metaData can be loaded after the first frame.
+     *
+     * @see loadDeferredEffects()
+     */
+    static bool isDeferred(const KPluginMetaData &metaData);
     /**
      * @brief Checks the configuration for the Effect identified by @p effectName.
      *
@@ -205,6 +223,9 @@ class EffectLoadQueue;
  *
  * The queue operates like a normal queue providing enqueue and a scheduleDequeue instead of dequeue.
  *
+ * Effects enqueued with enqueueDeferred() are held back until releaseDeferred() is invoked, after
+ * that they are queued behind the Effects which are already in the queue.
+ *
  */
 class AbstractEffectLoadQueue : public QObject
 {
@@ -230,6 +251,7 @@ public:
         : AbstractEffectLoadQueue(parent)
         , m_effectLoader(parent)
         , m_dequeueScheduled(false)
+        , m_deferredReleased(false)
     {
     }
     void enqueue(const QPair<QueueType, LoadEffectFlags> value)
@@ -237,9 +259,25 @@ public:
         m_queue.enqueue(value);
         scheduleDequeue();
     }
+    void enqueueDeferred(const QPair<QueueType, LoadEffectFlags> value)
+    {
+        if (m_deferredReleased) {
+            enqueue(value);
+        } else {
+            m_deferredQueue.enqueue(value);
+        }
+    }
+    void releaseDeferred()
+    {
+        m_deferredReleased = true;
+        while (!m_deferredQueue.isEmpty()) {
+            enqueue(m_deferredQueue.dequeue());
+        }
+    }
     void clear()
     {
         m_queue.clear();
+        m_deferredQueue.clear();
         m_dequeueScheduled = false;
     }
 protected:
@@ -264,7 +302,9 @@ private:
     }
     Loader *m_effectLoader;
     bool m_dequeueScheduled;
+    bool m_deferredReleased;
     QQueue<QPair<QueueType, LoadEffectFlags>> m_queue;
+    QQueue<QPair<QueueType, LoadEffectFlags>> m_deferredQueue;
 };
 
 /**
@@ -283,6 +323,7 @@ public:
 
     void clear() override;
     void queryAndLoadAll() override;
+    void loadDeferredEffects() override;
     bool loadEffect(const QString &name) override;
     bool loadEffect(const KPluginMetaData &effect, LoadEffectFlags flags);
 
@@ -307,6 +348,7 @@ public:
 
     void clear() override;
     void queryAndLoadAll() override;
+    void loadDeferredEffects() override;
     bool loadEffect(const QString &name) override;
     bool loadEffect(const KPluginMetaData &info, LoadEffectFlags flags);
 
@@ -316,8 +358,12 @@ private:
     QVector<KPluginMetaData> findAllEffects() const;
     KPluginMetaData findEffect(const QString &name) const;
     EffectPluginFactory *factory(const KPluginMetaData &info) const;
+    void enqueueEffects(const QVector<QPair<KPluginMetaData, LoadEffectFlags>> &effects);
     QStringList m_loadedEffects;
     QString m_pluginSubDirectory;
+    EffectLoadQueue<PluginEffectLoader, KPluginMetaData> *m_queue;
+    QMetaObject::Connection m_queryConnection;
+    QMetaObject::Connection m_preloadConnection;
 };
 
 class KWIN_EXPORT EffectLoader : public AbstractEffectLoader
@@ -333,6 +379,7 @@ public:
     void queryAndLoadAll() override;
     void setConfig(KSharedConfig::Ptr config) override;
     void clear() override;
+    void loadDeferredEffects() override;
 
 private:
     QList<AbstractEffectLoader*> m_loaders;
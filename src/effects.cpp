@@ -13,6 +13,7 @@
 #include "abstract_output.h"
 #include "effectsadaptor.h"
 #include "effectloader.h"
+#include "ftrace.h"
 #ifdef KWIN_BUILD_ACTIVITIES
 #include "activities.h"
 #endif
@@ -22,8 +23,10 @@
 #include "group.h"
 #include "internal_client.h"
 #include "osd.h"
+#include "paintstatistics.h"
 #include "pointer_input.h"
 #include "renderbackend.h"
+#include "renderloop.h"
 #include "unmanaged.h"
 #include "input_event.h"
 #ifdef KWIN_BUILD_TABBOX
@@ -41,6 +44,7 @@
 
 #include <QDebug>
 #include <QMouseEvent>
+#include <QTimer>
 #include <QWheelEvent>
 
 #include <Plasma/Theme>
@@ -59,6 +63,9 @@ namespace KWin
 //---------------------
 // Static
 
+// how long the deferred effects wait for the first frame before they are loaded anyway
+static const int deferredEffectsTimeout = 1000;
+
 static QByteArray readWindowProperty(xcb_window_t win, xcb_atom_t atom, xcb_atom_t type, int format)
 {
     if (win == XCB_WINDOW_NONE) {
@@ -260,11 +267,21 @@ EffectsHandlerImpl::EffectsHandlerImpl(Compositor *compositor, Scene *scene)
     }
 
     reconfigure();
+
+    // Nothing may get painted for a long time, e.g. if all outputs are off. Don't hold the
+    // deferred effects back until the first frame in that case.
+    QTimer::singleShot(deferredEffectsTimeout, this, &EffectsHandlerImpl::loadDeferredEffects);
 }
 
 EffectsHandlerImpl::~EffectsHandlerImpl()
 {
     unloadAllEffects();
+
+    if (!m_framebufferCopies.isEmpty() || !m_framebufferTexturePool.isEmpty()) {
+        makeOpenGLContextCurrent();
+        m_framebufferCopies.clear();
+        m_framebufferTexturePool.clear();
+    }
 }
 
 void EffectsHandlerImpl::unloadAllEffects()
@@ -372,6 +389,14 @@ void EffectsHandlerImpl::setupUnmanagedConnections(Unmanaged* u)
     });
 }
 
+void EffectsHandlerImpl::loadDeferredEffects()
+{
+    if (!m_deferredEffectsLoaded) {
+        m_deferredEffectsLoaded = true;
+        QMetaObject::invokeMethod(m_effectLoader, &EffectLoader::loadDeferredEffects, Qt::QueuedConnection);
+    }
+}
+
 void EffectsHandlerImpl::reconfigure()
 {
     m_effectLoader->queryAndLoadAll();
@@ -381,7 +406,11 @@ void EffectsHandlerImpl::reconfigure()
 void EffectsHandlerImpl::prePaintScreen(ScreenPrePaintData& data, std::chrono::milliseconds presentTime)
 {
     if (m_currentPaintScreenIterator != m_activeEffects.constEnd()) {
-        (*m_currentPaintScreenIterator++)->prePaintScreen(data, presentTime);
+        Effect *effect = *m_currentPaintScreenIterator++;
+        fTraceSlice("Effect::prePaintScreen", effect->metaObject()->className());
+        PaintStatistics::self()->measure(effect, PaintStatistics::Pass::PrePaintScreen, [&]() {
+            effect->prePaintScreen(data, presentTime);
+        });
         --m_currentPaintScreenIterator;
     }
     // no special final code
@@ -392,8 +421,10 @@ void EffectsHandlerImpl::paintScreen(int mask, const QRegion &region, ScreenPain
     if (m_currentPaintScreenIterator != m_activeEffects.constEnd()) {
         (*m_currentPaintScreenIterator++)->paintScreen(mask, region, data);
         --m_currentPaintScreenIterator;
-    } else
+    } else {
         m_scene->finalPaintScreen(mask, region, data);
+        invalidateFramebufferCopies();
+    }
 }
 
 void EffectsHandlerImpl::paintDesktop(int desktop, int mask, QRegion region, ScreenPaintData &data)
@@ -421,22 +452,44 @@ void EffectsHandlerImpl::postPaintScreen()
     // no special final code
 }
 
+EffectsHandlerImpl::EffectsIterator EffectsHandlerImpl::nextEffectForWindow(EffectsIterator it, const EffectWindow *w) const
+{
+    // skip the effects that don't do anything with this window
+    while (it != m_activeEffects.constEnd() && (*it)->paintsActiveWindowsOnly() && !w->isEffectActive(*it)) {
+        ++it;
+    }
+    return it;
+}
+
 void EffectsHandlerImpl::prePaintWindow(EffectWindow* w, WindowPrePaintData& data, std::chrono::milliseconds presentTime)
 {
-    if (m_currentPaintWindowIterator != m_activeEffects.constEnd()) {
-        (*m_currentPaintWindowIterator++)->prePaintWindow(w, data, presentTime);
-        --m_currentPaintWindowIterator;
+    const EffectsIterator current = m_currentPaintWindowIterator;
+    const EffectsIterator next = nextEffectForWindow(current, w);
+    if (next != m_activeEffects.constEnd()) {
+        m_currentPaintWindowIterator = next + 1;
+        (*next)->prePaintWindow(w, data, presentTime);
+        m_currentPaintWindowIterator = current;
     }
     // no special final code
 }
 
 void EffectsHandlerImpl::paintWindow(EffectWindow* w, int mask, const QRegion &region, WindowPaintData& data)
 {
-    if (m_currentPaintWindowIterator != m_activeEffects.constEnd()) {
-        (*m_currentPaintWindowIterator++)->paintWindow(w, mask, region, data);
-        --m_currentPaintWindowIterator;
-    } else
-        m_scene->finalPaintWindow(static_cast<EffectWindowImpl*>(w), mask, region, data);
+    const EffectsIterator current = m_currentPaintWindowIterator;
+    const EffectsIterator next = nextEffectForWindow(current, w);
+    PaintStatistics *statistics = PaintStatistics::self();
+    if (next != m_activeEffects.constEnd()) {
+        fTraceSlice("Effect::paintWindow", (*next)->metaObject()->className());
+        m_currentPaintWindowIterator = next + 1;
+        statistics->measure(*next, PaintStatistics::Pass::PaintWindow, [&]() {
+            (*next)->paintWindow(w, mask, region, data);
+        });
+        m_currentPaintWindowIterator = current;
+    } else {
+        statistics->measure(nullptr, PaintStatistics::Pass::PaintWindow, [&]() {
+            m_scene->finalPaintWindow(static_cast<EffectWindowImpl*>(w), mask, region, data);
+        });
+    }
 }
 
 void EffectsHandlerImpl::paintEffectFrame(EffectFrame* frame, const QRegion &region, double opacity, double frameOpacity)
@@ -447,14 +500,18 @@ void EffectsHandlerImpl::paintEffectFrame(EffectFrame* frame, const QRegion &reg
     } else {
         const EffectFrameImpl* frameImpl = static_cast<const EffectFrameImpl*>(frame);
         frameImpl->finalRender(region, opacity, frameOpacity);
+        invalidateFramebufferCopies(region);
     }
 }
 
 void EffectsHandlerImpl::postPaintWindow(EffectWindow* w)
 {
-    if (m_currentPaintWindowIterator != m_activeEffects.constEnd()) {
-        (*m_currentPaintWindowIterator++)->postPaintWindow(w);
-        --m_currentPaintWindowIterator;
+    const EffectsIterator current = m_currentPaintWindowIterator;
+    const EffectsIterator next = nextEffectForWindow(current, w);
+    if (next != m_activeEffects.constEnd()) {
+        m_currentPaintWindowIterator = next + 1;
+        (*next)->postPaintWindow(w);
+        m_currentPaintWindowIterator = current;
     }
     // no special final code
 }
@@ -469,11 +526,23 @@ Effect *EffectsHandlerImpl::provides(Effect::Feature ef)
 
 void EffectsHandlerImpl::drawWindow(EffectWindow* w, int mask, const QRegion &region, WindowPaintData& data)
 {
-    if (m_currentDrawWindowIterator != m_activeEffects.constEnd()) {
-        (*m_currentDrawWindowIterator++)->drawWindow(w, mask, region, data);
-        --m_currentDrawWindowIterator;
-    } else
-        m_scene->finalDrawWindow(static_cast<EffectWindowImpl*>(w), mask, region, data);
+    const EffectsIterator current = m_currentDrawWindowIterator;
+    const EffectsIterator next = nextEffectForWindow(current, w);
+    PaintStatistics *statistics = PaintStatistics::self();
+    if (next != m_activeEffects.constEnd()) {
+        m_currentDrawWindowIterator = next + 1;
+        statistics->measure(*next, PaintStatistics::Pass::DrawWindow, [&]() {
+            (*next)->drawWindow(w, mask, region, data);
+        });
+        m_currentDrawWindowIterator = current;
+    } else {
+        statistics->measure(nullptr, PaintStatistics::Pass::DrawWindow, [&]() {
+            m_scene->finalDrawWindow(static_cast<EffectWindowImpl*>(w), mask, region, data);
+        });
+        // a transformed window can end up outside of the painted region
+        const bool transformed = mask & (PAINT_WINDOW_TRANSFORMED | PAINT_SCREEN_TRANSFORMED);
+        invalidateFramebufferCopies(transformed ? infiniteRegion() : region);
+    }
 }
 
 bool EffectsHandlerImpl::hasDecorationShadows() const
@@ -494,6 +563,10 @@ bool EffectsHandlerImpl::decorationSupportsBlurBehind() const
 // start another painting pass
 void EffectsHandlerImpl::startPaint()
 {
+    PaintStatistics::self()->beginFrame();
+    invalidateFramebufferCopies();
+    // the effects which are not needed for the first frame are loaded once it's done
+    loadDeferredEffects();
     m_activeEffects.clear();
     m_activeEffects.reserve(loaded_effects.count());
     for(QVector< KWin::EffectPair >::const_iterator it = loaded_effects.constBegin(); it != loaded_effects.constEnd(); ++it) {
@@ -1453,6 +1526,7 @@ void EffectsHandlerImpl::destroyEffect(Effect *effect)
         removeSupportProperty(property, effect);
     }
 
+    PaintStatistics::self()->removeEffect(effect);
     delete effect;
 }
 
@@ -1550,6 +1624,16 @@ bool EffectsHandlerImpl::blocksDirectScanout() const
     return false;
 }
 
+bool EffectsHandlerImpl::wantsWindowsOnOtherOutputs() const
+{
+    for (const EffectPair &effect : loaded_effects) {
+        if (effect.second->isActive() && effect.second->wantsWindowsOnOtherOutputs()) {
+            return true;
+        }
+    }
+    return false;
+}
+
 KWaylandServer::Display *EffectsHandlerImpl::waylandDisplay() const
 {
     if (waylandServer()) {
@@ -1782,6 +1866,70 @@ bool EffectsHandlerImpl::isCursorHidden() const
     return Cursors::self()->isCursorHidden();
 }
 
+QSharedPointer<GLTexture> EffectsHandlerImpl::framebufferTexture(const QRect &rect, QRect *textureRect)
+{
+    if (!isOpenGLCompositing() || rect.isEmpty()) {
+        return QSharedPointer<GLTexture>();
+    }
+
+    GLRenderTarget *renderTarget = GLRenderTarget::currentRenderTarget();
+    for (const FramebufferCopy &copy : qAsConst(m_framebufferCopies)) {
+        if (copy.renderTarget == renderTarget && copy.rect.contains(rect)) {
+            *textureRect = copy.rect;
+            return copy.texture;
+        }
+    }
+
+    const QRect screenGeometry = GLRenderTarget::virtualScreenGeometry();
+    const qreal scale = GLRenderTarget::virtualScreenScale();
+    const QSize textureSize = rect.size() * scale;
+
+    QSharedPointer<GLTexture> texture;
+    for (int i = 0; i < m_framebufferTexturePool.count(); ++i) {
+        if (m_framebufferTexturePool[i]->size() == textureSize) {
+            texture = m_framebufferTexturePool.takeAt(i);
+            break;
+        }
+    }
+    if (!texture) {
+        texture.reset(new GLTexture(GL_RGBA8, textureSize));
+        texture->setFilter(GL_LINEAR);
+        texture->setWrapMode(GL_CLAMP_TO_EDGE);
+    }
+
+    texture->bind();
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, (rect.x() - screenGeometry.x()) * scale,
+                        (screenGeometry.height() - (rect.y() - screenGeometry.y() + rect.height())) * scale,
+                        textureSize.width(), textureSize.height());
+    texture->unbind();
+
+    m_framebufferCopies.append(FramebufferCopy{renderTarget, rect, texture});
+    *textureRect = rect;
+    return texture;
+}
+
+/**
+ * Drops the framebuffer copies that intersect @p region, something has been painted over them.
+ */
+void EffectsHandlerImpl::invalidateFramebufferCopies(const QRegion &region)
+{
+    if (m_framebufferCopies.isEmpty()) {
+        return;
+    }
+    // Keep a few textures around, effects tend to sample the same rects every frame.
+    for (auto it = m_framebufferCopies.begin(); it != m_framebufferCopies.end();) {
+        if (region.intersects(it->rect)) {
+            m_framebufferTexturePool.prepend(it->texture);
+            it = m_framebufferCopies.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    while (m_framebufferTexturePool.count() > maxFramebufferTexturePoolSize) {
+        m_framebufferTexturePool.removeLast();
+    }
+}
+
 //****************************************
 // EffectScreenImpl
 //****************************************
@@ -1798,6 +1946,9 @@ EffectScreenImpl::EffectScreenImpl(AbstractOutput *output, QObject *parent)
     connect(output, &AbstractOutput::aboutToTurnOff, this, &EffectScreen::aboutToTurnOff);
     connect(output, &AbstractOutput::scaleChanged, this, &EffectScreen::devicePixelRatioChanged);
     connect(output, &AbstractOutput::geometryChanged, this, &EffectScreen::geometryChanged);
+    if (RenderLoop *renderLoop = output->renderLoop()) {
+        connect(renderLoop, &RenderLoop::renderQualityChanged, this, &EffectScreen::renderQualityChanged);
+    }
 }
 
 EffectScreenImpl::~EffectScreenImpl()
@@ -1837,6 +1988,24 @@ EffectScreen::Transform EffectScreenImpl::transform() const
     return EffectScreen::Transform(m_platformOutput->transform());
 }
 
+std::chrono::microseconds EffectScreenImpl::inputLatency() const
+{
+    const RenderLoop *renderLoop = m_platformOutput->renderLoop();
+    if (!renderLoop) {
+        return std::chrono::microseconds::zero();
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(renderLoop->inputLatency().smoothed);
+}
+
+EffectScreen::RenderQuality EffectScreenImpl::renderQuality() const
+{
+    const RenderLoop *renderLoop = m_platformOutput->renderLoop();
+    if (!renderLoop) {
+        return RenderQuality::High;
+    }
+    return RenderQuality(renderLoop->renderQuality());
+}
+
 //****************************************
 // EffectWindowImpl
 //****************************************
@@ -2057,6 +2226,14 @@ CLIENT_HELPER(bool, isUnresponsive, unresponsive, false)
 
 #undef CLIENT_HELPER
 
+QRect EffectWindowImpl::pendingFrameGeometry() const
+{
+    if (auto client = qobject_cast<AbstractClient *>(toplevel)) {
+        return client->moveResizeGeometry();
+    }
+    return toplevel->frameGeometry();
+}
+
 QSize EffectWindowImpl::basicUnit() const
 {
     if (auto client = qobject_cast<X11Client *>(toplevel)){
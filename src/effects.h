@@ -42,6 +42,7 @@ class AbstractClient;
 class Compositor;
 class Deleted;
 class EffectLoader;
+class GLRenderTarget;
 class Group;
 class Toplevel;
 class Unmanaged;
@@ -202,6 +203,7 @@ public:
      * @returns whether or not any effect is currently active where KWin should not use direct scanout
      */
     bool blocksDirectScanout() const;
+    bool wantsWindowsOnOtherOutputs() const;
 
     /**
      * @returns Whether we are currently in a desktop rendering process triggered by paintDesktop hook
@@ -274,6 +276,7 @@ public:
     EffectScreen *findScreen(int screenId) const override;
     void renderScreen(EffectScreen *screen) override;
     bool isCursorHidden() const override;
+    QSharedPointer<GLTexture> framebufferTexture(const QRect &rect, QRect *textureRect) override;
 
 public Q_SLOTS:
     void slotCurrentTabAboutToChange(EffectWindow* from, EffectWindow* to);
@@ -344,6 +347,8 @@ protected:
 private:
     void registerPropertyType(long atom, bool reg);
     void destroyEffect(Effect *effect);
+    void loadDeferredEffects();
+    void invalidateFramebufferCopies(const QRegion &region = infiniteRegion());
 
     typedef QVector< Effect*> EffectsList;
     typedef EffectsList::const_iterator EffectsIterator;
@@ -352,6 +357,7 @@ private:
     EffectsIterator m_currentPaintWindowIterator;
     EffectsIterator m_currentPaintEffectFrameIterator;
     EffectsIterator m_currentPaintScreenIterator;
+    EffectsIterator nextEffectForWindow(EffectsIterator it, const EffectWindow *w) const;
     typedef QHash< QByteArray, QList< Effect*> > PropertyEffectMap;
     PropertyEffectMap m_propertiesForEffects;
     QHash<QByteArray, qulonglong> m_managedProperties;
@@ -361,9 +367,20 @@ private:
     int m_currentRenderedDesktop;
     QList<Effect*> m_grabbedMouseEffects;
     EffectLoader *m_effectLoader;
+    bool m_deferredEffectsLoaded = false;
     int m_trackingCursorChanges;
     std::unique_ptr<WindowPropertyNotifyX11Filter> m_x11WindowPropertyNotify;
     QList<EffectScreen *> m_effectScreens;
+
+    struct FramebufferCopy
+    {
+        GLRenderTarget *renderTarget;
+        QRect rect;
+        QSharedPointer<GLTexture> texture;
+    };
+    static const int maxFramebufferTexturePoolSize = 8;
+    QVector<FramebufferCopy> m_framebufferCopies;
+    QVector<QSharedPointer<GLTexture>> m_framebufferTexturePool;
 };
 
 class EffectScreenImpl : public EffectScreen
@@ -380,6 +397,8 @@ public:
     qreal devicePixelRatio() const override;
     QRect geometry() const override;
     Transform transform() const override;
+    std::chrono::microseconds inputLatency() const override;
+    RenderQuality renderQuality() const override;
 
     static EffectScreenImpl *get(AbstractOutput *output);
 
@@ -427,6 +446,7 @@ public:
     QRect frameGeometry() const override;
     QRect bufferGeometry() const override;
     QRect clientGeometry() const override;
+    QRect pendingFrameGeometry() const override;
 
     QString caption() const override;
 
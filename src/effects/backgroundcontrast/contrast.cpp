@@ -73,6 +73,12 @@ ContrastEffect::ContrastEffect()
 
 ContrastEffect::~ContrastEffect()
 {
+    // Otherwise the blur effect keeps applying the contrast.
+    const EffectWindowList windowList = effects->stackingOrder();
+    for (EffectWindow *window : windowList) {
+        window->setData(WindowBackgroundContrastMatrixRole, QVariant());
+    }
+
     // When compositing is restarted, avoid removing the manager immediately.
     if (s_contrastManager) {
         s_contrastManagerRemoveTimer->start(1000);
@@ -165,6 +171,14 @@ void ContrastEffect::updateContrastRegion(EffectWindow *w)
     } else {
         w->setData(WindowBackgroundContrastRole, region);
     }
+
+    // The blur effect applies the contrast while it draws the blurred background behind the
+    // window, instead of this effect copying and drawing the same area once more.
+    if (valid) {
+        w->setData(WindowBackgroundContrastMatrixRole, m_colorMatrices.value(w));
+    } else {
+        w->setData(WindowBackgroundContrastMatrixRole, QVariant());
+    }
 }
 
 void ContrastEffect::slotWindowAdded(EffectWindow *w)
@@ -428,7 +442,7 @@ bool ContrastEffect::shouldContrast(const EffectWindow *w, int mask, const Windo
 void ContrastEffect::drawWindow(EffectWindow *w, int mask, const QRegion &region, WindowPaintData &data)
 {
     const QRect screen = GLRenderTarget::virtualScreenGeometry();
-    if (shouldContrast(w, mask, data)) {
+    if (!data.isBackgroundContrastApplied() && shouldContrast(w, mask, data)) {
         QRegion shape = region & contrastRegion(w).translated(w->pos()) & screen;
 
         // let's do the evil parts - someone wants to blur behind a transformed window
@@ -472,7 +486,13 @@ void ContrastEffect::doContrast(EffectWindow *w, const QRegion& shape, const QRe
     const QRegion actualShape = shape & screen;
     const QRect r = actualShape.boundingRect();
 
-    qreal scale = GLRenderTarget::virtualScreenScale();
+    // Get the area in the back buffer that we're going to blur, effects that sample the
+    // same part of the screen share the copy
+    QRect textureRect;
+    const QSharedPointer<GLTexture> scratch = effects->framebufferTexture(r, &textureRect);
+    if (!scratch) {
+        return;
+    }
 
     // Upload geometry for the horizontal and vertical passes
     GLVertexBuffer *vbo = GLVertexBuffer::streamingBuffer();
@@ -480,16 +500,7 @@ void ContrastEffect::doContrast(EffectWindow *w, const QRegion& shape, const QRe
     uploadGeometry(vbo, actualShape);
     vbo->bindArrays();
 
-    // Create a scratch texture and copy the area in the back buffer that we're
-    // going to blur into it
-    GLTexture scratch(GL_RGBA8, r.width() * scale, r.height() * scale);
-    scratch.setFilter(GL_LINEAR);
-    scratch.setWrapMode(GL_CLAMP_TO_EDGE);
-    scratch.bind();
-
-    const QRect sg = GLRenderTarget::virtualScreenGeometry();
-    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, (r.x() - sg.x()) * scale, (sg.height() - (r.y() - sg.y() + r.height())) * scale,
-                        scratch.width(), scratch.height());
+    scratch->bind();
 
     // Draw the texture on the offscreen framebuffer object, while blurring it horizontally
 
@@ -501,15 +512,14 @@ void ContrastEffect::doContrast(EffectWindow *w, const QRegion& shape, const QRe
     // Set up the texture matrix to transform from screen coordinates
     // to texture coordinates.
     QMatrix4x4 textureMatrix;
-    textureMatrix.scale(1.0 / r.width(), -1.0 / r.height(), 1);
-    textureMatrix.translate(-r.x(), -r.height() - r.y(), 0);
+    textureMatrix.scale(1.0 / textureRect.width(), -1.0 / textureRect.height(), 1);
+    textureMatrix.translate(-textureRect.x(), -textureRect.height() - textureRect.y(), 0);
     shader->setTextureMatrix(textureMatrix);
     shader->setModelViewProjectionMatrix(screenProjection);
 
     vbo->draw(GL_TRIANGLES, 0, actualShape.rectCount() * 6);
 
-    scratch.unbind();
-    scratch.discard();
+    scratch->unbind();
 
     vbo->unbindArrays();
 
@@ -530,5 +540,10 @@ bool ContrastEffect::blocksDirectScanout() const
     return false;
 }
 
+bool ContrastEffect::wantsWindowsOnOtherOutputs() const
+{
+    return false;
+}
+
 } // namespace KWin
 
@@ -48,6 +48,7 @@ public:
     bool eventFilter(QObject *watched, QEvent *event) override;
 
     bool blocksDirectScanout() const override;
+    bool wantsWindowsOnOtherOutputs() const override;
 
 public Q_SLOTS:
     void slotWindowAdded(KWin::EffectWindow *w);
@@ -33,6 +33,27 @@ static const QByteArray s_blurAtomName = QByteArrayLiteral("_KDE_NET_WM_BLUR_BEH
 KWaylandServer::BlurManagerInterface *BlurEffect::s_blurManager = nullptr;
 QTimer *BlurEffect::s_blurManagerRemoveTimer = nullptr;
 
+// The render targets are shared by all screens, so the busiest screen decides the quality.
+static EffectScreen::RenderQuality lowestRenderQuality()
+{
+    EffectScreen::RenderQuality quality = EffectScreen::RenderQuality::High;
+    const QList<EffectScreen *> screens = effects->screens();
+    for (const EffectScreen *screen : screens) {
+        quality = std::max(quality, screen->renderQuality());
+    }
+    return quality;
+}
+
+static QSize largestScreenSize()
+{
+    QSize size;
+    const QList<EffectScreen *> screens = effects->screens();
+    for (const EffectScreen *screen : screens) {
+        size = size.expandedTo(screen->geometry().size());
+    }
+    return size.isEmpty() ? effects->virtualScreenSize() : size;
+}
+
 BlurEffect::BlurEffect()
 {
     initConfig<BlurConfig>();
@@ -67,6 +88,15 @@ BlurEffect::BlurEffect()
     connect(effects, &EffectsHandler::windowDeleted, this, &BlurEffect::slotWindowDeleted);
     connect(effects, &EffectsHandler::propertyNotify, this, &BlurEffect::slotPropertyNotify);
     connect(effects, &EffectsHandler::virtualScreenGeometryChanged, this, &BlurEffect::slotScreenGeometryChanged);
+    connect(effects, &EffectsHandler::screenAdded, this, [this](EffectScreen *screen) {
+        connect(screen, &EffectScreen::renderQualityChanged, this, &BlurEffect::slotRenderQualityChanged);
+        slotRenderQualityChanged();
+    });
+    connect(effects, &EffectsHandler::screenRemoved, this, &BlurEffect::slotRenderQualityChanged);
+    const QList<EffectScreen *> screens = effects->screens();
+    for (EffectScreen *screen : screens) {
+        connect(screen, &EffectScreen::renderQualityChanged, this, &BlurEffect::slotRenderQualityChanged);
+    }
     connect(effects, &EffectsHandler::xcbConnectionChanged, this,
         [this] {
             if (m_shader && m_shader->isValid() && m_renderTargetsValid) {
@@ -94,7 +124,7 @@ BlurEffect::~BlurEffect()
 void BlurEffect::slotScreenGeometryChanged()
 {
     effects->makeOpenGLContextCurrent();
-    updateTexture();
+    updateTexture(largestScreenSize());
 
     // Fetch the blur regions for all windows
     const auto stackingOrder = effects->stackingOrder();
@@ -104,6 +134,36 @@ void BlurEffect::slotScreenGeometryChanged()
     effects->doneOpenGLContextCurrent();
 }
 
+void BlurEffect::slotRenderQualityChanged()
+{
+    const EffectScreen::RenderQuality quality = lowestRenderQuality();
+    if (m_renderQuality == quality) {
+        return;
+    }
+    m_renderQuality = quality;
+
+    effects->makeOpenGLContextCurrent();
+    applyBlurStrength();
+    updateTexture(largestScreenSize());
+    effects->doneOpenGLContextCurrent();
+
+    effects->addRepaintFull();
+}
+
+bool BlurEffect::ensureRenderTargetsFit(const QRect &screen)
+{
+    // The render targets are sized for the largest output. A pass that paints the whole
+    // virtual screen at once, e.g. on X11, needs bigger ones.
+    if (m_renderTextures.isEmpty()) {
+        return false;
+    }
+    const QSize size = m_renderTextures.first().size();
+    if (screen.width() > size.width() || screen.height() > size.height()) {
+        updateTexture(size.expandedTo(screen.size()));
+    }
+    return m_renderTargetsValid;
+}
+
 bool BlurEffect::renderTargetsValid() const
 {
     return !m_renderTargets.isEmpty() && std::find_if(m_renderTargets.cbegin(), m_renderTargets.cend(),
@@ -118,9 +178,10 @@ void BlurEffect::deleteFBOs()
 
     m_renderTargets.clear();
     m_renderTextures.clear();
+    m_blurCaches.clear();
 }
 
-void BlurEffect::updateTexture()
+void BlurEffect::updateTexture(const QSize &size)
 {
     deleteFBOs();
 
@@ -158,7 +219,7 @@ void BlurEffect::updateTexture()
     }
 
     for (int i = 0; i <= m_downSampleIterations; i++) {
-        m_renderTextures.append(GLTexture(textureFormat, effects->virtualScreenSize() / (1 << i)));
+        m_renderTextures.append(GLTexture(textureFormat, size / (1 << i)));
         m_renderTextures.last().setFilter(GL_LINEAR);
         m_renderTextures.last().setWrapMode(GL_CLAMP_TO_EDGE);
 
@@ -166,7 +227,7 @@ void BlurEffect::updateTexture()
     }
 
     // This last set is used as a temporary helper texture
-    m_renderTextures.append(GLTexture(textureFormat, effects->virtualScreenSize()));
+    m_renderTextures.append(GLTexture(textureFormat, size));
     m_renderTextures.last().setFilter(GL_LINEAR);
     m_renderTextures.last().setWrapMode(GL_CLAMP_TO_EDGE);
 
@@ -174,6 +235,9 @@ void BlurEffect::updateTexture()
 
     m_renderTargetsValid = renderTargetsValid();
 
+    // sRGB textures can't be bound as images, they keep using the fragment shaders
+    m_useCompute = m_shader->supportsCompute() && textureFormat == GL_RGBA8;
+
     // Prepare the stack for the rendering
     m_renderTargetStack.clear();
     m_renderTargetStack.reserve(m_downSampleIterations * 2);
@@ -253,21 +317,48 @@ void BlurEffect::initBlurStrengthValues()
     }
 }
 
-void BlurEffect::reconfigure(ReconfigureFlags flags)
+void BlurEffect::applyBlurStrength()
 {
-    Q_UNUSED(flags)
+    // Every downsample iteration is a full pass over the blurred area, so only the number of
+    // iterations is lowered under load. The strongest offset for the remaining iterations is
+    // used to keep the blur radius close to the configured one.
+    const int configuredIterations = blurStrengthValues[m_blurStrength].iteration;
+    int maximumIterations = configuredIterations;
+    switch (m_renderQuality) {
+    case EffectScreen::RenderQuality::High:
+        break;
+    case EffectScreen::RenderQuality::Medium:
+        maximumIterations = qMax(1, configuredIterations - 1);
+        break;
+    case EffectScreen::RenderQuality::Low:
+        maximumIterations = 1;
+        break;
+    }
 
-    BlurConfig::self()->read();
+    int blurStrength = m_blurStrength;
+    while (blurStrength > 0 && blurStrengthValues[blurStrength].iteration > maximumIterations) {
+        blurStrength--;
+    }
 
-    int blurStrength = BlurConfig::blurStrength() - 1;
     m_downSampleIterations = blurStrengthValues[blurStrength].iteration;
     m_offset = blurStrengthValues[blurStrength].offset;
     m_expandSize = blurOffsets[m_downSampleIterations - 1].expandSize;
+}
+
+void BlurEffect::reconfigure(ReconfigureFlags flags)
+{
+    Q_UNUSED(flags)
+
+    BlurConfig::self()->read();
+
+    m_blurStrength = BlurConfig::blurStrength() - 1;
+    m_renderQuality = lowestRenderQuality();
+    applyBlurStrength();
     m_noiseStrength = BlurConfig::noiseStrength();
 
     m_scalingFactor = qMax(1.0, QGuiApplication::primaryScreen()->logicalDotsPerInch() / 96.0);
 
-    updateTexture();
+    updateTexture(largestScreenSize());
 
     // Update all windows for the blur to take effect
     effects->addRepaintFull();
@@ -339,6 +430,7 @@ void BlurEffect::slotWindowAdded(EffectWindow *w)
 
 void BlurEffect::slotWindowDeleted(EffectWindow *w)
 {
+    m_blurCaches.remove(w);
     auto it = windowBlurChangedConnections.find(w);
     if (it == windowBlurChangedConnections.end()) {
         return;
@@ -392,7 +484,8 @@ bool BlurEffect::supported()
         int maxTexSize;
         glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTexSize);
 
-        const QSize screenSize = effects->virtualScreenSize();
+        // The render targets only have to fit the largest output, see updateTexture().
+        const QSize screenSize = largestScreenSize();
         if (screenSize.width() > maxTexSize || screenSize.height() > maxTexSize)
             supported = false;
     }
@@ -503,6 +596,8 @@ void BlurEffect::prePaintWindow(EffectWindow* w, WindowPrePaintData& data, std::
     effects->prePaintWindow(w, data, presentTime);
 
     if (!w->isPaintingEnabled()) {
+        // changes underneath the window go unnoticed while it's not painted
+        m_blurCaches.remove(w);
         return;
     }
     if (!m_shader || !m_shader->isValid()) {
@@ -530,6 +625,14 @@ void BlurEffect::prePaintWindow(EffectWindow* w, WindowPrePaintData& data, std::
     const QRegion blurArea = blurRegion(w).translated(w->pos()) & screen;
     const QRegion expandedBlur = (w->isDock() ? blurArea : expand(blurArea)) & screen;
 
+    // the cached blur result stays valid only as long as nothing is painted underneath
+    if (m_paintedArea.intersects(expandedBlur)) {
+        auto it = m_blurCaches.find(w);
+        if (it != m_blurCaches.end()) {
+            it->region = QRegion();
+        }
+    }
+
     // if this window or a window underneath the blurred area is painted again we have to
     // blur everything
     if (m_paintedArea.intersects(expandedBlur) || data.paint.intersects(blurArea)) {
@@ -573,10 +676,40 @@ bool BlurEffect::shouldBlur(const EffectWindow *w, int mask, const WindowPaintDa
     return true;
 }
 
+bool BlurEffect::canApplyContrast(const EffectWindow *w, int mask, const WindowPaintData &data) const
+{
+    if (!w->data(WindowBackgroundContrastMatrixRole).isValid()) {
+        return false;
+    }
+
+    // The contrast effect applies the contrast to what is behind the window after the blurred
+    // background has been blended in, so it can only be done in the up sample pass if nothing
+    // is blended. The contrast effect skips transformed windows and the windows behind a full
+    // screen effect unless they request it.
+    if (data.opacity() < 1.0 || !w->hasAlpha()) {
+        return false;
+    }
+    const bool scaled = !qFuzzyCompare(data.xScale(), 1.0) && !qFuzzyCompare(data.yScale(), 1.0);
+    const bool translated = data.xTranslation() || data.yTranslation();
+    if (scaled || translated || (mask & PAINT_WINDOW_TRANSFORMED) || effects->activeFullScreenEffect()) {
+        return false;
+    }
+
+    // Same as ContrastEffect::contrastRegion(), the contrast must cover exactly the blurred area.
+    QRegion contrastRegion;
+    const QRegion appRegion = qvariant_cast<QRegion>(w->data(WindowBackgroundContrastRole));
+    if (!appRegion.isEmpty()) {
+        contrastRegion = appRegion.translated(w->contentsRect().topLeft()) & w->decorationInnerRect();
+    } else {
+        contrastRegion = w->decorationInnerRect();
+    }
+    return contrastRegion == blurRegion(w);
+}
+
 void BlurEffect::drawWindow(EffectWindow *w, int mask, const QRegion &region, WindowPaintData &data)
 {
     const QRect screen = GLRenderTarget::virtualScreenGeometry();
-    if (shouldBlur(w, mask, data)) {
+    if (shouldBlur(w, mask, data) && ensureRenderTargetsFit(screen)) {
         QRegion shape = region & blurRegion(w).translated(w->pos()) & screen;
 
         // let's do the evil parts - someone wants to blur behind a transformed window
@@ -602,9 +735,31 @@ void BlurEffect::drawWindow(EffectWindow *w, int mask, const QRegion &region, Wi
 
         EffectWindow* modal = w->transientFor();
         const bool transientForIsDock = (modal ? modal->isDock() : false);
+        const bool isDock = w->isDock() || transientForIsDock;
+
+        // Panels are always visible and rarely have anything moving underneath them, their
+        // blurred background is kept until something behind them is painted again.
+        BlurCache *cache = nullptr;
+        if (isDock && !translated && !scaled) {
+            cache = &m_blurCaches[w];
+            const QRegion windowBlurRegion = blurRegion(w);
+            if (cache->blurRegion != windowBlurRegion || cache->windowRect != w->frameGeometry()) {
+                cache->region = QRegion();
+                cache->blurRegion = windowBlurRegion;
+                cache->windowRect = w->frameGeometry();
+            }
+        }
 
         if (!shape.isEmpty()) {
-            doBlur(shape, screen, data.opacity(), data.screenProjectionMatrix(), w->isDock() || transientForIsDock, w->frameGeometry());
+            // Plasma panels usually request both blur and background contrast. Apply the
+            // contrast while drawing the blurred background, so the area behind the window
+            // is read and drawn only once.
+            QMatrix4x4 colorMatrix;
+            if (canApplyContrast(w, mask, data)) {
+                colorMatrix = w->data(WindowBackgroundContrastMatrixRole).value<QMatrix4x4>();
+                data.setBackgroundContrastApplied(true);
+            }
+            doBlur(shape, screen, data.opacity(), data.screenProjectionMatrix(), isDock, w->frameGeometry(), cache, colorMatrix);
         }
     }
 
@@ -614,12 +769,13 @@ void BlurEffect::drawWindow(EffectWindow *w, int mask, const QRegion &region, Wi
 
 void BlurEffect::paintEffectFrame(EffectFrame *frame, const QRegion &region, double opacity, double frameOpacity)
 {
-    const QRect screen = effects->virtualScreenGeometry();
+    const QRect screen = GLRenderTarget::virtualScreenGeometry();
     bool valid = m_renderTargetsValid && m_shader && m_shader->isValid();
 
     QRegion shape = frame->geometry().adjusted(-borderSize, -borderSize, borderSize, borderSize) & screen;
 
-    if (valid && !shape.isEmpty() && region.intersects(shape.boundingRect()) && frame->style() != EffectFrameNone) {
+    if (valid && !shape.isEmpty() && region.intersects(shape.boundingRect()) && frame->style() != EffectFrameNone
+            && ensureRenderTargetsFit(screen)) {
         doBlur(shape, screen, opacity * frameOpacity, frame->screenProjectionMatrix(), false, frame->geometry());
     }
     effects->paintEffectFrame(frame, region, opacity, frameOpacity);
@@ -652,17 +808,35 @@ void BlurEffect::generateNoiseTexture()
     m_noiseTexture->setWrapMode(GL_REPEAT);
 }
 
-void BlurEffect::doBlur(const QRegion& shape, const QRect& screen, const float opacity, const QMatrix4x4 &screenProjection, bool isDock, QRect windowRect)
+void BlurEffect::doBlur(const QRegion& shape, const QRect& screen, const float opacity, const QMatrix4x4 &screenProjection, bool isDock, QRect windowRect, BlurCache *cache, const QMatrix4x4 &colorMatrix)
 {
     // Blur would not render correctly on a secondary monitor because of wrong coordinates
     // BUG: 393723
     const int xTranslate = -screen.x();
-    const int yTranslate = effects->virtualScreenSize().height() - screen.height() - screen.y();
+    const int yTranslate = m_renderTextures.first().height() - screen.height() - screen.y();
 
     const QRegion expandedBlurRegion = expand(shape) & expand(screen);
 
     const bool useSRGB = m_renderTextures.first().internalFormat() == GL_SRGB8_ALPHA8;
 
+    // The final blur result ends up in m_renderTextures[1]. A cached window gets its own
+    // texture in its place, so the result survives the blur passes of other windows.
+    const GLTexture sharedTexture = m_renderTextures[1];
+    bool cacheHit = false;
+    if (cache) {
+        if (cache->texture.isNull() || cache->texture.size() != sharedTexture.size()
+                || cache->texture.internalFormat() != sharedTexture.internalFormat()) {
+            cache->texture = GLTexture(sharedTexture.internalFormat(), sharedTexture.size());
+            cache->texture.setFilter(GL_LINEAR);
+            cache->texture.setWrapMode(GL_CLAMP_TO_EDGE);
+            cache->region = QRegion();
+        }
+        cacheHit = cache->screen == screen && (shape - cache->region).isEmpty();
+
+        m_renderTextures[1] = cache->texture;
+        m_renderTargets[1]->attachTexture(cache->texture);
+    }
+
     // Upload geometry for the down and upsample iterations
     GLVertexBuffer *vbo = GLVertexBuffer::streamingBuffer();
     vbo->reset();
@@ -673,40 +847,67 @@ void BlurEffect::doBlur(const QRegion& shape, const QRect& screen, const float o
     const QRect sourceRect = expandedBlurRegion.boundingRect() & screen;
     const QRect destRect = sourceRect.translated(xTranslate, yTranslate);
 
-    GLRenderTarget::pushRenderTargets(m_renderTargetStack);
     int blurRectCount = expandedBlurRegion.rectCount() * 6;
 
-    /*
-     * If the window is a dock or panel we avoid the "extended blur" effect.
-     * Extended blur is when windows that are not under the blurred area affect
-     * the final blur result.
-     * We want to avoid this on panels, because it looks really weird and ugly
-     * when maximized windows or windows near the panel affect the dock blur.
-     */
-    if (isDock) {
-        m_renderTargets.last()->blitFromFramebuffer(sourceRect, destRect);
-
+    if (cacheHit) {
         if (useSRGB) {
             glEnable(GL_FRAMEBUFFER_SRGB);
         }
-
-        const QRect screenRect = effects->virtualScreenGeometry();
-        QMatrix4x4 mvp;
-        mvp.ortho(0, screenRect.width(), screenRect.height(), 0, 0, 65535);
-        copyScreenSampleTexture(vbo, blurRectCount, shape.translated(xTranslate, yTranslate), mvp);
     } else {
-        m_renderTargets.first()->blitFromFramebuffer(sourceRect, destRect);
+        // The compute shaders write straight into the textures and need no render targets.
+        if (!m_useCompute) {
+            GLRenderTarget::pushRenderTargets(m_renderTargetStack);
+        }
 
-        if (useSRGB) {
-            glEnable(GL_FRAMEBUFFER_SRGB);
+        /*
+         * If the window is a dock or panel we avoid the "extended blur" effect.
+         * Extended blur is when windows that are not under the blurred area affect
+         * the final blur result.
+         * We want to avoid this on panels, because it looks really weird and ugly
+         * when maximized windows or windows near the panel affect the dock blur.
+         */
+        if (isDock) {
+            m_renderTargets.last()->blitFromFramebuffer(sourceRect, destRect);
+
+            if (useSRGB) {
+                glEnable(GL_FRAMEBUFFER_SRGB);
+            }
+
+            if (m_useCompute) {
+                GLRenderTarget::pushRenderTarget(m_renderTargets.first());
+            }
+
+            const QSize textureSize = m_renderTextures.first().size();
+            QMatrix4x4 mvp;
+            mvp.ortho(0, textureSize.width(), textureSize.height(), 0, 0, 65535);
+            copyScreenSampleTexture(vbo, blurRectCount, shape.translated(xTranslate, yTranslate), mvp);
+        } else {
+            m_renderTargets.first()->blitFromFramebuffer(sourceRect, destRect);
+
+            if (useSRGB) {
+                glEnable(GL_FRAMEBUFFER_SRGB);
+            }
+
+            // Remove the m_renderTargets[0] from the top of the stack that we will not use
+            if (!m_useCompute) {
+                GLRenderTarget::popRenderTarget();
+            }
         }
 
-        // Remove the m_renderTargets[0] from the top of the stack that we will not use
-        GLRenderTarget::popRenderTarget();
-    }
+        if (m_useCompute) {
+            const QRect rect = expandedBlurRegion.translated(xTranslate, yTranslate).boundingRect();
+            computeDownSample(rect);
+            computeUpSample(rect);
+        } else {
+            downSampleTexture(vbo, blurRectCount);
+            upSampleTexture(vbo, blurRectCount);
+        }
 
-    downSampleTexture(vbo, blurRectCount);
-    upSampleTexture(vbo, blurRectCount);
+        if (cache) {
+            cache->region = shape;
+            cache->screen = screen;
+        }
+    }
 
     // Modulate the blurred texture with the window opacity if the window isn't opaque
     if (opacity < 1.0) {
@@ -722,7 +923,7 @@ void BlurEffect::doBlur(const QRegion& shape, const QRect& screen, const float o
         glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
     }
 
-    upscaleRenderToScreen(vbo, blurRectCount * (m_downSampleIterations + 1), shape.rectCount() * 6, screenProjection, windowRect.topLeft());
+    upscaleRenderToScreen(vbo, blurRectCount * (m_downSampleIterations + 1), shape.rectCount() * 6, screenProjection, colorMatrix);
 
     if (useSRGB) {
         glDisable(GL_FRAMEBUFFER_SRGB);
@@ -754,14 +955,20 @@ void BlurEffect::doBlur(const QRegion& shape, const QRect& screen, const float o
     }
 
     vbo->unbindArrays();
+
+    if (cache) {
+        m_renderTextures[1] = sharedTexture;
+        m_renderTargets[1]->attachTexture(sharedTexture);
+    }
 }
 
-void BlurEffect::upscaleRenderToScreen(GLVertexBuffer *vbo, int vboStart, int blurRectCount, const QMatrix4x4 &screenProjection, QPoint windowPosition)
+void BlurEffect::upscaleRenderToScreen(GLVertexBuffer *vbo, int vboStart, int blurRectCount, const QMatrix4x4 &screenProjection, const QMatrix4x4 &colorMatrix)
 {
     m_renderTextures[1].bind();
 
     m_shader->bind(BlurShader::UpSampleType);
     m_shader->setTargetTextureSize(m_renderTextures[0].size() * GLRenderTarget::virtualScreenScale());
+    m_shader->setColorMatrix(colorMatrix);
 
     m_shader->setOffset(m_offset);
     m_shader->setModelViewProjectionMatrix(screenProjection);
@@ -817,6 +1024,7 @@ void BlurEffect::upSampleTexture(GLVertexBuffer *vbo, int blurRectCount)
 
     m_shader->bind(BlurShader::UpSampleType);
     m_shader->setOffset(m_offset);
+    m_shader->setColorMatrix(QMatrix4x4());
 
     for (int i = m_downSampleIterations - 1; i >= 1; i--) {
         modelViewProjectionMatrix.setToIdentity();
@@ -835,18 +1043,47 @@ void BlurEffect::upSampleTexture(GLVertexBuffer *vbo, int blurRectCount)
     m_shader->unbind();
 }
 
+static QRect computeSampleRect(const QRect &rect, const QSize &textureSize, int level)
+{
+    // Same rounding as in uploadRegion(), but with the origin in the bottom left corner.
+    const int divisionRatio = 1 << level;
+    const int left = rect.x() / divisionRatio;
+    const int top = rect.y() / divisionRatio;
+    const int right = (rect.x() + rect.width()) / divisionRatio;
+    const int bottom = (rect.y() + rect.height()) / divisionRatio;
+
+    return QRect(left, textureSize.height() - bottom, right - left, bottom - top) & QRect(QPoint(0, 0), textureSize);
+}
+
+void BlurEffect::computeDownSample(const QRect &rect)
+{
+    for (int i = 1; i <= m_downSampleIterations; i++) {
+        m_shader->computeSample(BlurShader::DownSampleType, m_renderTextures[i - 1], m_renderTextures[i],
+                                computeSampleRect(rect, m_renderTextures[i].size(), i), m_offset);
+    }
+}
+
+void BlurEffect::computeUpSample(const QRect &rect)
+{
+    for (int i = m_downSampleIterations - 1; i >= 1; i--) {
+        m_shader->computeSample(BlurShader::UpSampleType, m_renderTextures[i + 1], m_renderTextures[i],
+                                computeSampleRect(rect, m_renderTextures[i].size(), i), m_offset);
+    }
+}
+
 void BlurEffect::copyScreenSampleTexture(GLVertexBuffer *vbo, int blurRectCount, QRegion blurShape, const QMatrix4x4 &screenProjection)
 {
     m_shader->bind(BlurShader::CopySampleType);
 
     m_shader->setModelViewProjectionMatrix(screenProjection);
-    m_shader->setTargetTextureSize(effects->virtualScreenSize());
+    const QSize textureSize = m_renderTextures.last().size();
+    m_shader->setTargetTextureSize(textureSize);
 
     /*
      * This '1' sized adjustment is necessary do avoid windows affecting the blur that are
      * right next to this window.
      */
-    m_shader->setBlurRect(blurShape.boundingRect().adjusted(1, 1, -1, -1), effects->virtualScreenSize());
+    m_shader->setBlurRect(blurShape.boundingRect().adjusted(1, 1, -1, -1), textureSize);
     m_renderTextures.last().bind();
 
     vbo->draw(GL_TRIANGLES, 0, blurRectCount);
@@ -865,5 +1102,10 @@ bool BlurEffect::blocksDirectScanout() const
     return false;
 }
 
+bool BlurEffect::wantsWindowsOnOtherOutputs() const
+{
+    return false;
+}
+
 } // namespace KWin
 
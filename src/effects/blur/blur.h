@@ -12,6 +12,7 @@
 #include <kwinglplatform.h>
 #include <kwinglutils.h>
 
+#include <QHash>
 #include <QVector>
 #include <QVector2D>
 #include <QStack>
@@ -25,6 +26,18 @@ static const int borderSize = 5;
 
 class BlurShader;
 
+/**
+ * The blurred background of a window, kept as long as nothing underneath the window changes.
+ */
+struct BlurCache
+{
+    GLTexture texture{GL_TEXTURE_2D};
+    QRegion region; // the area in which the texture contains a valid result
+    QRegion blurRegion;
+    QRect screen;
+    QRect windowRect;
+};
+
 class BlurEffect : public KWin::Effect
 {
     Q_OBJECT
@@ -52,12 +65,14 @@ public:
     bool eventFilter(QObject *watched, QEvent *event) override;
 
     bool blocksDirectScanout() const override;
+    bool wantsWindowsOnOtherOutputs() const override;
 
 public Q_SLOTS:
     void slotWindowAdded(KWin::EffectWindow *w);
     void slotWindowDeleted(KWin::EffectWindow *w);
     void slotPropertyNotify(KWin::EffectWindow *w, long atom);
     void slotScreenGeometryChanged();
+    void slotRenderQualityChanged();
 
 private:
     QRect expand(const QRect &rect) const;
@@ -65,19 +80,24 @@ private:
     bool renderTargetsValid() const;
     void deleteFBOs();
     void initBlurStrengthValues();
-    void updateTexture();
+    void applyBlurStrength();
+    void updateTexture(const QSize &size);
+    bool ensureRenderTargetsFit(const QRect &screen);
     QRegion blurRegion(const EffectWindow *w) const;
     bool shouldBlur(const EffectWindow *w, int mask, const WindowPaintData &data) const;
+    bool canApplyContrast(const EffectWindow *w, int mask, const WindowPaintData &data) const;
     void updateBlurRegion(EffectWindow *w) const;
-    void doBlur(const QRegion &shape, const QRect &screen, const float opacity, const QMatrix4x4 &screenProjection, bool isDock, QRect windowRect);
+    void doBlur(const QRegion &shape, const QRect &screen, const float opacity, const QMatrix4x4 &screenProjection, bool isDock, QRect windowRect, BlurCache *cache = nullptr, const QMatrix4x4 &colorMatrix = QMatrix4x4());
     void uploadRegion(QVector2D *&map, const QRegion &region, const int downSampleIterations);
     void uploadGeometry(GLVertexBuffer *vbo, const QRegion &blurRegion, const QRegion &windowRegion);
     void generateNoiseTexture();
 
-    void upscaleRenderToScreen(GLVertexBuffer *vbo, int vboStart, int blurRectCount, const QMatrix4x4 &screenProjection, QPoint windowPosition);
+    void upscaleRenderToScreen(GLVertexBuffer *vbo, int vboStart, int blurRectCount, const QMatrix4x4 &screenProjection, const QMatrix4x4 &colorMatrix);
     void applyNoise(GLVertexBuffer *vbo, int vboStart, int blurRectCount, const QMatrix4x4 &screenProjection, QPoint windowPosition);
     void downSampleTexture(GLVertexBuffer *vbo, int blurRectCount);
     void upSampleTexture(GLVertexBuffer *vbo, int blurRectCount);
+    void computeDownSample(const QRect &rect);
+    void computeUpSample(const QRect &rect);
     void copyScreenSampleTexture(GLVertexBuffer *vbo, int blurRectCount, QRegion blurShape, const QMatrix4x4 &screenProjection);
 
 private:
@@ -89,10 +109,13 @@ private:
     QScopedPointer<GLTexture> m_noiseTexture;
 
     bool m_renderTargetsValid;
+    bool m_useCompute = false; // whether the down and up samples run as compute shaders
     long net_wm_blur_region = 0;
     QRegion m_paintedArea; // keeps track of all painted areas (from bottom to top)
     QRegion m_currentBlur; // keeps track of the currently blured area of the windows(from bottom to top)
 
+    int m_blurStrength = 0; // index of the configured strength in blurStrengthValues
+    EffectScreen::RenderQuality m_renderQuality = EffectScreen::RenderQuality::High;
     int m_downSampleIterations; // number of times the texture will be downsized to half size
     int m_offset;
     int m_expandSize;
@@ -115,6 +138,7 @@ private:
     QVector <BlurValuesStruct> blurStrengthValues;
 
     QMap <EffectWindow*, QMetaObject::Connection> windowBlurChangedConnections;
+    QHash<const EffectWindow *, BlurCache> m_blurCaches;
 
     static KWaylandServer::BlurManagerInterface *s_blurManager;
     static QTimer *s_blurManagerRemoveTimer;
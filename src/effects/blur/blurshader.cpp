@@ -93,6 +93,7 @@ BlurShader::BlurShader(QObject *parent)
     QTextStream streamFragUp(&fragmentUpSource);
 
     streamFragUp << glHeaderString << glUniformString;
+    streamFragUp << "uniform mat4 colorMatrix;\n";
 
     streamFragUp << "void main(void)\n";
     streamFragUp << "{\n";
@@ -107,7 +108,7 @@ BlurShader::BlurShader(QObject *parent)
     streamFragUp << "    sum += " << texture2D << "(texUnit, uv + vec2(0.0, -halfpixel.y * 2.0) * offset);\n";
     streamFragUp << "    sum += " << texture2D << "(texUnit, uv + vec2(-halfpixel.x, -halfpixel.y) * offset) * 2.0;\n";
     streamFragUp << "    \n";
-    streamFragUp << "    " << fragColor << " = sum / 12.0;\n";
+    streamFragUp << "    " << fragColor << " = (sum / 12.0) * colorMatrix;\n";
     streamFragUp << "}\n";
 
     streamFragUp.flush();
@@ -170,6 +171,7 @@ BlurShader::BlurShader(QObject *parent)
         m_offsetLocationUpsample = m_shaderUpsample->uniformLocation("offset");
         m_renderTextureSizeLocationUpsample = m_shaderUpsample->uniformLocation("renderTextureSize");
         m_halfpixelLocationUpsample = m_shaderUpsample->uniformLocation("halfpixel");
+        m_colorMatrixLocationUpsample = m_shaderUpsample->uniformLocation("colorMatrix");
 
         m_mvpMatrixLocationCopysample = m_shaderCopysample->uniformLocation("modelViewProjectionMatrix");
         m_renderTextureSizeLocationCopysample = m_shaderCopysample->uniformLocation("renderTextureSize");
@@ -199,6 +201,7 @@ BlurShader::BlurShader(QObject *parent)
         m_shaderUpsample->setUniform(m_offsetLocationUpsample, float(1.0));
         m_shaderUpsample->setUniform(m_renderTextureSizeLocationUpsample, QVector2D(1.0, 1.0));
         m_shaderUpsample->setUniform(m_halfpixelLocationUpsample, QVector2D(1.0, 1.0));
+        m_shaderUpsample->setUniform(m_colorMatrixLocationUpsample, QMatrix4x4());
         ShaderManager::instance()->popShader();
 
         ShaderManager::instance()->pushShader(m_shaderCopysample.data());
@@ -216,11 +219,164 @@ BlurShader::BlurShader(QObject *parent)
         m_shaderNoisesample->setUniform(m_halfpixelLocationNoisesample, QVector2D(1.0, 1.0));
 
         ShaderManager::instance()->popShader();
+
+        initCompute();
     }
 }
 
 BlurShader::~BlurShader()
 {
+    if (m_computeDownsample.program) {
+        glDeleteProgram(m_computeDownsample.program);
+    }
+    if (m_computeUpsample.program) {
+        glDeleteProgram(m_computeUpsample.program);
+    }
+}
+
+void BlurShader::initCompute()
+{
+    if (qEnvironmentVariableIsSet("KWIN_BLUR_COMPUTE") && !qEnvironmentVariableIntValue("KWIN_BLUR_COMPUTE")) {
+        return;
+    }
+
+    const GLPlatform *platform = GLPlatform::instance();
+    QByteArray header;
+    if (platform->isGLES()) {
+        if (platform->glVersion() < kVersionNumber(3, 1)) {
+            return;
+        }
+        header = "#version 310 es\n"
+                 "precision highp float;\n"
+                 "precision highp image2D;\n";
+    } else {
+        if (platform->glVersion() < kVersionNumber(4, 3)) {
+            return;
+        }
+        header = "#version 430\n";
+    }
+
+    // Each invocation shades the texel that the fragment shader would shade at the same
+    // position, so both paths produce the same result. There are no derivatives in compute
+    // shaders, hence textureLod().
+    header += "layout(local_size_x = 8, local_size_y = 8) in;\n"
+              "uniform sampler2D texUnit;\n"
+              "layout(rgba8, binding = 0) writeonly uniform image2D targetImage;\n"
+              "uniform float offset;\n"
+              "uniform vec2 renderTextureSize;\n"
+              "uniform vec2 halfpixel;\n"
+              "uniform ivec4 targetRect;\n"
+              "\n"
+              "void main(void)\n"
+              "{\n"
+              "    if (any(greaterThanEqual(ivec2(gl_GlobalInvocationID.xy), targetRect.zw))) {\n"
+              "        return;\n"
+              "    }\n"
+              "    ivec2 texel = targetRect.xy + ivec2(gl_GlobalInvocationID.xy);\n"
+              "    vec2 uv = (vec2(texel) + 0.5) / renderTextureSize;\n"
+              "    \n";
+
+    const QByteArray downSource = header +
+        "    vec4 sum = textureLod(texUnit, uv, 0.0) * 4.0;\n"
+        "    sum += textureLod(texUnit, uv - halfpixel.xy * offset, 0.0);\n"
+        "    sum += textureLod(texUnit, uv + halfpixel.xy * offset, 0.0);\n"
+        "    sum += textureLod(texUnit, uv + vec2(halfpixel.x, -halfpixel.y) * offset, 0.0);\n"
+        "    sum += textureLod(texUnit, uv - vec2(halfpixel.x, -halfpixel.y) * offset, 0.0);\n"
+        "    \n"
+        "    imageStore(targetImage, texel, sum / 8.0);\n"
+        "}\n";
+
+    const QByteArray upSource = header +
+        "    vec4 sum = textureLod(texUnit, uv + vec2(-halfpixel.x * 2.0, 0.0) * offset, 0.0);\n"
+        "    sum += textureLod(texUnit, uv + vec2(-halfpixel.x, halfpixel.y) * offset, 0.0) * 2.0;\n"
+        "    sum += textureLod(texUnit, uv + vec2(0.0, halfpixel.y * 2.0) * offset, 0.0);\n"
+        "    sum += textureLod(texUnit, uv + vec2(halfpixel.x, halfpixel.y) * offset, 0.0) * 2.0;\n"
+        "    sum += textureLod(texUnit, uv + vec2(halfpixel.x * 2.0, 0.0) * offset, 0.0);\n"
+        "    sum += textureLod(texUnit, uv + vec2(halfpixel.x, -halfpixel.y) * offset, 0.0) * 2.0;\n"
+        "    sum += textureLod(texUnit, uv + vec2(0.0, -halfpixel.y * 2.0) * offset, 0.0);\n"
+        "    sum += textureLod(texUnit, uv + vec2(-halfpixel.x, -halfpixel.y) * offset, 0.0) * 2.0;\n"
+        "    \n"
+        "    imageStore(targetImage, texel, sum / 12.0);\n"
+        "}\n";
+
+    m_computeDownsample = createComputeProgram(downSource);
+    m_computeUpsample = createComputeProgram(upSource);
+
+    // Fall back to the fragment shaders if either program failed to build.
+    if (!supportsCompute()) {
+        if (m_computeDownsample.program) {
+            glDeleteProgram(m_computeDownsample.program);
+        }
+        if (m_computeUpsample.program) {
+            glDeleteProgram(m_computeUpsample.program);
+        }
+        m_computeDownsample = ComputeProgram();
+        m_computeUpsample = ComputeProgram();
+    }
+}
+
+BlurShader::ComputeProgram BlurShader::createComputeProgram(const QByteArray &source)
+{
+    ComputeProgram compute;
+
+    const GLuint shader = glCreateShader(GL_COMPUTE_SHADER);
+    const char *sourceData = source.constData();
+    glShaderSource(shader, 1, &sourceData, nullptr);
+    glCompileShader(shader);
+
+    GLint status = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE) {
+        glDeleteShader(shader);
+        return compute;
+    }
+
+    const GLuint program = glCreateProgram();
+    glAttachShader(program, shader);
+    glLinkProgram(program);
+    glDeleteShader(shader);
+
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) {
+        glDeleteProgram(program);
+        return compute;
+    }
+
+    compute.program = program;
+    compute.offsetLocation = glGetUniformLocation(program, "offset");
+    compute.renderTextureSizeLocation = glGetUniformLocation(program, "renderTextureSize");
+    compute.halfpixelLocation = glGetUniformLocation(program, "halfpixel");
+    compute.targetRectLocation = glGetUniformLocation(program, "targetRect");
+    return compute;
+}
+
+void BlurShader::computeSample(SampleType sampleType, GLTexture &source, const GLTexture &target, const QRect &rect, float offset)
+{
+    const ComputeProgram &compute = sampleType == DownSampleType ? m_computeDownsample : m_computeUpsample;
+    if (!compute.program || rect.isEmpty()) {
+        return;
+    }
+
+    glUseProgram(compute.program);
+    glUniform1f(compute.offsetLocation, offset);
+    glUniform2f(compute.renderTextureSizeLocation, target.width(), target.height());
+    glUniform2f(compute.halfpixelLocation, 0.5 / target.width(), 0.5 / target.height());
+    glUniform4i(compute.targetRectLocation, rect.x(), rect.y(), rect.width(), rect.height());
+
+    source.bind();
+    glBindImageTexture(0, target.texture(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+
+    glDispatchCompute((rect.width() + 7) / 8, (rect.height() + 7) / 8, 1);
+
+    // The next pass samples the texture that has just been written.
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+    // Give the program back to the shader manager.
+    if (GLShader *shader = ShaderManager::instance()->getBoundShader()) {
+        shader->bind();
+    } else {
+        glUseProgram(0);
+    }
 }
 
 void BlurShader::setModelViewProjectionMatrix(const QMatrix4x4 &matrix)
@@ -377,6 +533,20 @@ void BlurShader::setBlurRect(const QRect &blurRect, const QSize &screenSize)
     m_shaderCopysample->setUniform(m_blurRectLocationCopysample, rect);
 }
 
+void BlurShader::setColorMatrix(const QMatrix4x4 &matrix)
+{
+    if (!isValid() || m_activeSampleType != UpSampleType) {
+        return;
+    }
+
+    if (matrix == m_colorMatrixUpsample) {
+        return;
+    }
+
+    m_colorMatrixUpsample = matrix;
+    m_shaderUpsample->setUniform(m_colorMatrixLocationUpsample, matrix);
+}
+
 void BlurShader::bind(SampleType sampleType)
 {
     if (!isValid()) {
@@ -45,8 +45,36 @@ public:
     void setNoiseTextureSize(const QSize &noiseTextureSize);
     void setTexturePosition(const QPoint &texPos);
     void setBlurRect(const QRect &blurRect, const QSize &screenSize);
+    /**
+     * Sets the color matrix that the up sample pass applies to its result, e.g. the
+     * background contrast of a window. Only has an effect on the up sample shader.
+     */
+    void setColorMatrix(const QMatrix4x4 &matrix);
+
+    /**
+     * Returns @c true if the down and up samples can run as compute shaders. This needs
+     * OpenGL 4.3 or OpenGL ES 3.1, and can be turned off with KWIN_BLUR_COMPUTE=0.
+     */
+    bool supportsCompute() const;
+    /**
+     * Runs a down or up sample pass as a compute shader. It reads from @p source and writes
+     * the @p rect of @p target, given in texels with the origin in the bottom left corner.
+     * The result is the same as rendering the rect with the fragment shader of the pass.
+     */
+    void computeSample(SampleType sampleType, GLTexture &source, const GLTexture &target, const QRect &rect, float offset);
 
 private:
+    struct ComputeProgram {
+        GLuint program = 0;
+        int offsetLocation = -1;
+        int renderTextureSizeLocation = -1;
+        int halfpixelLocation = -1;
+        int targetRectLocation = -1;
+    };
+    void initCompute();
+    static ComputeProgram createComputeProgram(const QByteArray &source);
+
+
     QScopedPointer<GLShader> m_shaderDownsample;
     QScopedPointer<GLShader> m_shaderUpsample;
     QScopedPointer<GLShader> m_shaderCopysample;
@@ -61,6 +89,7 @@ private:
     int m_offsetLocationUpsample;
     int m_renderTextureSizeLocationUpsample;
     int m_halfpixelLocationUpsample;
+    int m_colorMatrixLocationUpsample;
 
     int m_mvpMatrixLocationCopysample;
     int m_renderTextureSizeLocationCopysample;
@@ -73,6 +102,9 @@ private:
     int m_texStartPosLocationNoisesample;
     int m_halfpixelLocationNoisesample;
 
+    ComputeProgram m_computeDownsample;
+    ComputeProgram m_computeUpsample;
+
     //Caching uniform values to aviod unnecessary setUniform calls
     int m_activeSampleType = -1;
 
@@ -81,6 +113,7 @@ private:
 
     float m_offsetUpsample = 0.0;
     QMatrix4x4 m_matrixUpsample;
+    QMatrix4x4 m_colorMatrixUpsample;
 
     QMatrix4x4 m_matrixCopysample;
 
@@ -98,6 +131,11 @@ inline bool BlurShader::isValid() const
     return m_valid;
 }
 
+inline bool BlurShader::supportsCompute() const
+{
+    return m_computeDownsample.program && m_computeUpsample.program;
+}
+
 } // namespace KWin
 
 #endif
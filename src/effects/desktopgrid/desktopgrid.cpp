@@ -16,6 +16,8 @@
 
 #include "../presentwindows/presentwindows_proxy.h"
 
+#include <kwinglutils.h>
+
 #include <QAction>
 #include <QApplication>
 #include <KGlobalAccel>
@@ -118,6 +120,12 @@ DesktopGridEffect::DesktopGridEffect()
     connect(effects, &EffectsHandler::windowDeleted, this, &DesktopGridEffect::slotWindowDeleted);
     connect(effects, &EffectsHandler::numberDesktopsChanged, this, &DesktopGridEffect::slotNumberDesktopsChanged);
     connect(effects, &EffectsHandler::windowFrameGeometryChanged, this, &DesktopGridEffect::slotWindowFrameGeometryChanged);
+    connect(effects, &EffectsHandler::windowDamaged, this, [this](EffectWindow *w) {
+        invalidateDesktopCaches(w);
+    });
+    connect(effects, &EffectsHandler::desktopPresenceChanged, this, [this]() {
+        invalidateDesktopCaches();
+    });
     connect(effects, &EffectsHandler::screenAdded, this, &DesktopGridEffect::setup);
     connect(effects, &EffectsHandler::screenRemoved, this, &DesktopGridEffect::setup);
 
@@ -143,6 +151,7 @@ DesktopGridEffect::DesktopGridEffect()
 
 DesktopGridEffect::~DesktopGridEffect()
 {
+    destroyDesktopCaches();
 }
 
 void DesktopGridEffect::reconfigure(ReconfigureFlags)
@@ -246,10 +255,21 @@ void DesktopGridEffect::paintScreen(int mask, const QRegion &region, ScreenPaint
         effects->paintScreen(mask, region, data);
         return;
     }
-    for (int desktop = 1; desktop <= effects->numberOfDesktops(); desktop++) {
-        ScreenPaintData d = data;
-        paintingDesktop = desktop;
-        effects->paintScreen(mask, region, d);
+    if (canUseDesktopCaches()) {
+        const QList<EffectScreen *> screens = effects->screens();
+        for (int desktop = 1; desktop <= effects->numberOfDesktops(); desktop++) {
+            for (EffectScreen *screen : screens) {
+                paintDesktopCache(desktop, screen, mask, data);
+            }
+        }
+    } else {
+        // The windows are moved around, so whatever is cached is outdated afterwards.
+        invalidateDesktopCaches();
+        for (int desktop = 1; desktop <= effects->numberOfDesktops(); desktop++) {
+            ScreenPaintData d = data;
+            paintingDesktop = desktop;
+            effects->paintScreen(mask, region, d);
+        }
     }
 
     // paint the add desktop button
@@ -300,6 +320,101 @@ void DesktopGridEffect::paintScreen(int mask, const QRegion &region, ScreenPaint
     }
 }
 
+bool DesktopGridEffect::canUseDesktopCaches() const
+{
+    // Only the zoomed in grid is cached, windows are animated in every other state.
+    return effects->isOpenGLCompositing() && timeline.currentValue() == 1.0
+        && !isUsingPresentWindows() && !windowMove;
+}
+
+void DesktopGridEffect::paintDesktopCache(int desktop, EffectScreen *screen, int mask, ScreenPaintData &data)
+{
+    const QRect screenGeom = effects->clientArea(ScreenArea, screen, 0);
+    const QRectF cellGeom(scalePos(screenGeom.topLeft(), desktop, screen), scaledSize[screen]);
+    const QSize textureSize = (cellGeom.size() * GLRenderTarget::virtualScreenScale()).toSize();
+    if (textureSize.isEmpty()) {
+        return;
+    }
+
+    DesktopCache &cache = m_desktopCaches[qMakePair(screen, desktop)];
+    if (!cache.texture || cache.texture->size() != textureSize) {
+        cache.texture.reset(new GLTexture(GL_RGBA8, textureSize));
+        cache.texture->setFilter(GL_LINEAR);
+        cache.texture->setWrapMode(GL_CLAMP_TO_EDGE);
+        cache.texture->setYInverted(true);
+        cache.renderTarget.reset(new GLRenderTarget(*cache.texture));
+        cache.dirty = true;
+    }
+
+    // The desktop is painted at its normal position and scaled down to the cell by the
+    // projection, so the windows are only painted again when the desktop is damaged.
+    if (cache.dirty) {
+        const QRect virtualScreenGeometry = GLRenderTarget::virtualScreenGeometry();
+        const qreal virtualScreenScale = GLRenderTarget::virtualScreenScale();
+
+        GLRenderTarget::pushRenderTarget(cache.renderTarget.data());
+        GLRenderTarget::setVirtualScreenGeometry(screenGeom);
+        GLRenderTarget::setVirtualScreenScale(textureSize.width() / qreal(screenGeom.width()));
+        glClearColor(0.0, 0.0, 0.0, 0.0);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        m_cachingProjectionMatrix = QMatrix4x4();
+        m_cachingProjectionMatrix.ortho(screenGeom);
+        m_cachingScreen = screen;
+        paintingDesktop = desktop;
+        ScreenPaintData d = data;
+        effects->paintScreen(mask, infiniteRegion(), d);
+        m_cachingScreen = nullptr;
+
+        GLRenderTarget::popRenderTarget();
+        GLRenderTarget::setVirtualScreenGeometry(virtualScreenGeometry);
+        GLRenderTarget::setVirtualScreenScale(virtualScreenScale);
+        cache.dirty = false;
+    }
+
+    const qreal brightness = 1.0 - (0.3 * (1.0 - hoverTimeline[desktop - 1]->currentValue()));
+
+    QMatrix4x4 mvp = data.projectionMatrix();
+    mvp.translate(cellGeom.x(), cellGeom.y());
+
+    ShaderBinder binder(ShaderTrait::MapTexture | ShaderTrait::Modulate);
+    binder.shader()->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
+    binder.shader()->setUniform(GLShader::ModulationConstant, QVector4D(brightness, brightness, brightness, 1.0));
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    cache.texture->bind();
+    cache.texture->render(infiniteRegion(), QRect(QPoint(0, 0), cellGeom.size().toSize()));
+    cache.texture->unbind();
+    glDisable(GL_BLEND);
+}
+
+void DesktopGridEffect::invalidateDesktopCaches()
+{
+    for (DesktopCache &cache : m_desktopCaches) {
+        cache.dirty = true;
+    }
+}
+
+void DesktopGridEffect::invalidateDesktopCaches(const EffectWindow *w)
+{
+    for (auto it = m_desktopCaches.begin(); it != m_desktopCaches.end(); ++it) {
+        if (w->isOnDesktop(it.key().second)) {
+            it->dirty = true;
+        }
+    }
+}
+
+void DesktopGridEffect::destroyDesktopCaches()
+{
+    if (m_desktopCaches.isEmpty()) {
+        return;
+    }
+    effects->makeOpenGLContextCurrent();
+    m_desktopCaches.clear();
+    effects->doneOpenGLContextCurrent();
+}
+
 void DesktopGridEffect::postPaintScreen()
 {
     bool resetLastPresentTime = true;
@@ -363,6 +478,16 @@ void DesktopGridEffect::paintWindow(EffectWindow* w, int mask, QRegion region, W
             return; // will be painted on top of all other windows
         }
 
+        if (m_cachingScreen) {
+            const QRect screenGeom = effects->clientArea(ScreenArea, m_cachingScreen, 0);
+            if (w->frameGeometry().intersects(screenGeom)) {
+                WindowPaintData d = data;
+                d.setProjectionMatrix(m_cachingProjectionMatrix);
+                effects->paintWindow(w, mask, screenGeom, d);
+            }
+            return;
+        }
+
         qreal xScale = data.xScale();
         qreal yScale = data.yScale();
 
@@ -433,6 +558,7 @@ void DesktopGridEffect::slotWindowAdded(EffectWindow* w)
             m_proxy->calculateWindowTransformations(manager.managedWindows(), w->screen(), manager);
         }
     }
+    invalidateDesktopCaches(w);
     effects->addRepaintFull();
 }
 
@@ -452,6 +578,7 @@ void DesktopGridEffect::slotWindowClosed(EffectWindow* w)
             m_proxy->calculateWindowTransformations(manager.managedWindows(), w->screen(), manager);
         }
     }
+    invalidateDesktopCaches(w);
     effects->addRepaintFull();
 }
 
@@ -473,6 +600,7 @@ void DesktopGridEffect::slotWindowFrameGeometryChanged(EffectWindow* w, const QR
     Q_UNUSED(old)
     if (!activated)
         return;
+    invalidateDesktopCaches(w);
     if (w == windowMove && wasWindowMove)
         return;
     if (isUsingPresentWindows()) {
@@ -1207,6 +1335,7 @@ void DesktopGridEffect::setupGrid()
         gridSize.setHeight(customLayoutRows);
         break;
     }
+    destroyDesktopCaches();
     scale.clear();
     unscaledBorder.clear();
     scaledSize.clear();
@@ -1272,6 +1401,7 @@ void DesktopGridEffect::finish()
     lastPresentTime = std::chrono::milliseconds::zero();
     effects->stopMouseInterception(this);
     effects->setActiveFullScreenEffect(nullptr);
+    destroyDesktopCaches();
     if (isUsingPresentWindows()) {
         for (auto it = m_managers.begin(); it != m_managers.end(); ++it) {
             for (WindowMotionManager &manager : *it) {
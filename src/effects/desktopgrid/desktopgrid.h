@@ -12,7 +12,11 @@
 #define KWIN_DESKTOPGRID_H
 
 #include <kwineffects.h>
+#include <QHash>
+#include <QMatrix4x4>
 #include <QObject>
+#include <QPair>
+#include <QSharedPointer>
 #include <QTimeLine>
 
 class QTimer;
@@ -22,6 +26,8 @@ class QTimer;
 namespace KWin
 {
 
+class GLRenderTarget;
+class GLTexture;
 class PresentWindowsEffectProxy;
 
 class DesktopGridEffect
@@ -118,6 +124,11 @@ private:
     void desktopsAdded(int old);
     void desktopsRemoved(int old);
     QVector<int> desktopList(const EffectWindow *w) const;
+    bool canUseDesktopCaches() const;
+    void paintDesktopCache(int desktop, EffectScreen *screen, int mask, ScreenPaintData &data);
+    void invalidateDesktopCaches();
+    void invalidateDesktopCaches(const EffectWindow *w);
+    void destroyDesktopCaches();
 
     QList<ElectricBorder> borderActivate;
     int zoomDuration;
@@ -173,6 +184,18 @@ private:
     QAction *m_gestureAction;
     QAction *m_shortcutAction;
 
+    // A desktop rendered at the size of its cell on a screen, used while the grid doesn't move.
+    struct DesktopCache
+    {
+        QSharedPointer<GLTexture> texture;
+        QSharedPointer<GLRenderTarget> renderTarget;
+        bool dirty = true;
+    };
+    QHash<QPair<EffectScreen *, int>, DesktopCache> m_desktopCaches;
+    // The screen whose cell is being rendered into a desktop cache.
+    EffectScreen *m_cachingScreen = nullptr;
+    QMatrix4x4 m_cachingProjectionMatrix;
+
 };
 
 } // namespace
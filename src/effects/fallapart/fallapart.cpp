@@ -36,6 +36,8 @@ void FallApartEffect::reconfigure(ReconfigureFlags)
 {
     FallApartConfig::self()->read();
     blockSize = FallApartConfig::blockSize();
+    // the animation speed can only change together with the configuration
+    duration = animationTime(1000);
 }
 
 void FallApartEffect::prePaintScreen(ScreenPrePaintData& data, std::chrono::milliseconds presentTime)
@@ -56,7 +58,7 @@ void FallApartEffect::prePaintWindow(EffectWindow* w, WindowPrePaintData& data,
             }
             animationIt->lastPresentTime = presentTime;
 
-            animationIt->progress += time / animationTime(1000.);
+            animationIt->progress += time / duration;
             data.setTransformed();
             w->enablePainting(EffectWindow::PAINT_DISABLED_BY_DELETE);
         } else {
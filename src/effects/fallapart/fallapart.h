@@ -56,6 +56,7 @@ private:
     QHash< EffectWindow*, FallApartAnimation > windows;
     bool isRealWindow(EffectWindow* w);
     int blockSize;
+    qreal duration;
 };
 
 } // namespace
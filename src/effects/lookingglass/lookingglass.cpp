@@ -91,6 +91,7 @@ void LookingGlassEffect::reconfigure(ReconfigureFlags)
     LookingGlassConfig::self()->read();
     initialradius = LookingGlassConfig::radius();
     radius = initialradius;
+    zoomDuration = animationTime(500);
     qCDebug(KWIN_LOOKINGGLASS) << "Radius from config:" << radius;
     m_valid = loadData();
 }
@@ -200,7 +201,7 @@ void LookingGlassEffect::prePaintScreen(ScreenPrePaintData& data, std::chrono::m
 {
     const int time = m_lastPresentTime.count() ? (presentTime - m_lastPresentTime).count() : 0;
     if (zoom != target_zoom) {
-        double diff = time / animationTime(500.0);
+        double diff = time / zoomDuration;
         if (target_zoom > zoom)
             zoom = qMin(zoom * qMax(1.0 + diff, 1.2), target_zoom);
         else
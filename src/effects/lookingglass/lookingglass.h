@@ -62,6 +62,7 @@ private:
     bool polling; // Mouse polling
     int radius;
     int initialradius;
+    double zoomDuration;
     GLTexture *m_texture;
     GLRenderTarget *m_fbo;
     GLVertexBuffer *m_vbo;
@@ -77,6 +77,7 @@ void MagnifierEffect::reconfigure(ReconfigureFlags)
     width = MagnifierConfig::width();
     height = MagnifierConfig::height();
     magnifier_size = QSize(width, height);
+    zoomDuration = animationTime(500);
     // Load the saved zoom value.
     target_zoom = MagnifierConfig::initialZoom();
     if (target_zoom != zoom)
@@ -88,7 +89,7 @@ void MagnifierEffect::prePaintScreen(ScreenPrePaintData& data, std::chrono::mill
     const int time = m_lastPresentTime.count() ? (presentTime - m_lastPresentTime).count() : 0;
 
     if (zoom != target_zoom) {
-        double diff = time / animationTime(500.0);
+        double diff = time / zoomDuration;
         if (target_zoom > zoom)
             zoom = qMin(zoom * qMax(1 + diff, 1.2), target_zoom);
         else {
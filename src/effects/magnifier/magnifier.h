@@ -54,6 +54,7 @@ private:
     QRect magnifierArea(QPoint pos = cursorPos()) const;
     double zoom;
     double target_zoom;
+    double zoomDuration;
     bool polling; // Mouse polling
     std::chrono::milliseconds m_lastPresentTime;
     QSize magnifier_size;
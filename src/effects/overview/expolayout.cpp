@@ -10,7 +10,10 @@
 
 #include "expolayout.h"
 
+#include <QtConcurrent>
+
 #include <cmath>
+#include <utility>
 
 ExpoCell::ExpoCell(QObject *parent)
     : QObject(parent)
@@ -215,9 +218,31 @@ void ExpoCell::setBottomMargin(int margin)
     }
 }
 
+// Natural layouts with at least this many cells are computed in a worker thread.
+static const int asyncNaturalLayoutCellCount = 32;
+
+bool ExpoLayout::CellState::operator==(const CellState &other) const
+{
+    return naturalRect == other.naturalRect && margins == other.margins && persistentKey == other.persistentKey;
+}
+
+bool ExpoLayout::LayoutState::operator==(const LayoutState &other) const
+{
+    return cells == other.cells && cellStates == other.cellStates && size == other.size
+        && mode == other.mode && spacing == other.spacing && fillGaps == other.fillGaps;
+}
+
+bool ExpoLayout::LayoutState::operator!=(const LayoutState &other) const
+{
+    return !(*this == other);
+}
+
 ExpoLayout::ExpoLayout(QQuickItem *parent)
     : QQuickItem(parent)
+    , m_naturalLayoutWatcher(new QFutureWatcher<QVector<QRect>>(this))
 {
+    connect(m_naturalLayoutWatcher, &QFutureWatcher<QVector<QRect>>::finished,
+            this, &ExpoLayout::handleNaturalLayoutFinished);
 }
 
 ExpoLayout::LayoutMode ExpoLayout::mode() const
@@ -275,19 +300,82 @@ void ExpoLayout::setReady()
     }
 }
 
+ExpoLayout::LayoutState ExpoLayout::currentState() const
+{
+    LayoutState state;
+    state.cells = m_cells;
+    state.cellStates.reserve(m_cells.count());
+    for (const ExpoCell *cell : m_cells) {
+        state.cellStates.append(CellState{cell->naturalRect(), cell->margins(), cell->persistentKey()});
+    }
+    state.size = QSize(width(), height());
+    state.mode = m_mode;
+    state.spacing = m_spacing;
+    state.fillGaps = m_fillGaps;
+    return state;
+}
+
 void ExpoLayout::updatePolish()
 {
     if (!m_cells.isEmpty()) {
-        switch (m_mode) {
-        case LayoutClosest:
-            calculateWindowTransformationsClosest();
-            break;
-        case LayoutNatural:
-            calculateWindowTransformationsNatural();
-            break;
+        if (m_mode == LayoutNatural) {
+            // As we are using pseudo-random movement (See "slot") we need to make sure the list
+            // is always sorted the same way no matter which window is currently active.
+            std::sort(m_cells.begin(), m_cells.end(), [](const ExpoCell *a, const ExpoCell *b) {
+                return a->persistentKey() < b->persistentKey();
+            });
         }
+
+        // The layout is polished again once the worker thread is done if anything has changed.
+        if (m_naturalLayoutWatcher->isRunning()) {
+            return;
+        }
+
+        const LayoutState state = currentState();
+        if (state != m_solvedState) {
+            switch (m_mode) {
+            case LayoutClosest:
+                calculateWindowTransformationsClosest();
+                break;
+            case LayoutNatural:
+                if (!calculateWindowTransformationsNatural(state)) {
+                    return;
+                }
+                break;
+            }
+            m_solvedState = state;
+        }
+    }
+
+    setReady();
+}
+
+void ExpoLayout::applyLayout(const QList<ExpoCell *> &cells, const QVector<QRect> &rects)
+{
+    for (int i = 0; i < cells.count(); ++i) {
+        ExpoCell *cell = cells[i];
+        const QRect &rect = rects[i];
+
+        cell->setX(rect.x());
+        cell->setY(rect.y());
+        cell->setWidth(rect.width());
+        cell->setHeight(rect.height());
+    }
+}
+
+void ExpoLayout::handleNaturalLayoutFinished()
+{
+    const LayoutState state = std::exchange(m_solvingState, LayoutState());
+
+    // The cells can be changed or even destroyed while the layout is computed, the result
+    // is dropped in that case and the layout is computed again.
+    if (state != currentState()) {
+        polish();
+        return;
     }
 
+    applyLayout(state.cells, m_naturalLayoutWatcher->result());
+    m_solvedState = state;
     setReady();
 }
 
@@ -319,17 +407,6 @@ static int distance(const QPoint &a, const QPoint &b)
     return int(std::sqrt(qreal(xdiff * xdiff + ydiff * ydiff)));
 }
 
-static QRect centered(ExpoCell *cell, const QRect &bounds)
-{
-    const QSize scaled = QSize(cell->naturalWidth(), cell->naturalHeight())
-            .scaled(bounds.size(), Qt::KeepAspectRatio);
-
-    return QRect(bounds.center().x() - scaled.width() / 2,
-                 bounds.center().y() - scaled.height() / 2,
-                 scaled.width(),
-                 scaled.height());
-}
-
 void ExpoLayout::calculateWindowTransformationsClosest()
 {
     QRect area = QRect(0, 0, width(), height());
@@ -420,77 +497,69 @@ void ExpoLayout::calculateWindowTransformationsClosest()
     }
 }
 
-static inline int heightForWidth(ExpoCell *cell, int width)
+static inline int heightForWidth(const QRect &naturalRect, int width)
 {
-    return int((width / qreal(cell->naturalWidth())) * cell->naturalHeight());
+    return int((width / qreal(naturalRect.width())) * naturalRect.height());
 }
 
-static bool isOverlappingAny(ExpoCell *w, const QHash<ExpoCell *, QRect> &targets, const QRegion &border, int spacing)
+static QRect centered(const QRect &naturalRect, const QRect &bounds)
 {
-    QHash<ExpoCell *, QRect>::const_iterator winTarget = targets.find(w);
-    if (winTarget == targets.constEnd()) {
-        return false;
-    }
-    if (border.intersects(*winTarget)) {
+    const QSize scaled = naturalRect.size().scaled(bounds.size(), Qt::KeepAspectRatio);
+
+    return QRect(bounds.center().x() - scaled.width() / 2,
+                 bounds.center().y() - scaled.height() / 2,
+                 scaled.width(),
+                 scaled.height());
+}
+
+static bool isOverlappingAny(int index, const QVector<QRect> &targets, const QRegion &border, int spacing)
+{
+    const QRect &winTarget = targets[index];
+    if (border.intersects(winTarget)) {
         return true;
     }
     const QMargins halfSpacing(spacing / 2, spacing / 2, spacing / 2, spacing / 2);
+    const QRect expandedTarget = winTarget.marginsAdded(halfSpacing);
 
-    // Is there a better way to do this?
-    QHash<ExpoCell *, QRect>::const_iterator target;
-    for (target = targets.constBegin(); target != targets.constEnd(); ++target) {
-        if (target == winTarget) {
+    for (int i = 0; i < targets.count(); ++i) {
+        if (i == index) {
             continue;
         }
-        if (winTarget->marginsAdded(halfSpacing).intersects(target->marginsAdded(halfSpacing))) {
+        if (expandedTarget.intersects(targets[i].marginsAdded(halfSpacing))) {
             return true;
         }
     }
     return false;
 }
 
-void ExpoLayout::calculateWindowTransformationsNatural()
+QVector<QRect> ExpoLayout::solveNaturalLayout(const QVector<CellState> &cells, const QRect &area, int spacing, int accuracy, bool fillGaps)
 {
-    const QRect area = QRect(0, 0, width(), height());
-
-    // As we are using pseudo-random movement (See "slot") we need to make sure the list
-    // is always sorted the same way no matter which window is currently active.
-    std::sort(m_cells.begin(), m_cells.end(), [](const ExpoCell *a, const ExpoCell *b) {
-        return a->persistentKey() < b->persistentKey();
-    });
-
     QRect bounds;
-    int direction = 0;
-    QHash<ExpoCell *, QRect> targets;
-    QHash<ExpoCell *, int> directions;
-
-    for (ExpoCell *cell : qAsConst(m_cells)) {
-        const QRect cellRect(cell->naturalX(), cell->naturalY(), cell->naturalWidth(), cell->naturalHeight());
-        targets[cell] = cellRect;
-        // Reuse the unused "slot" as a preferred direction attribute. This is used when the window
-        // is on the edge of the screen to try to use as much screen real estate as possible.
-        directions[cell] = direction;
-        bounds = bounds.united(cellRect);
-        direction++;
-        if (direction == 4) {
-            direction = 0;
-        }
+    QVector<QRect> targets;
+    targets.reserve(cells.count());
+
+    for (const CellState &cell : cells) {
+        targets.append(cell.naturalRect);
+        bounds = bounds.united(cell.naturalRect);
     }
 
     // Iterate over all windows, if two overlap push them apart _slightly_ as we try to
     // brute-force the most optimal positions over many iterations.
-    const int halfSpacing = m_spacing / 2;
+    const int halfSpacing = spacing / 2;
     bool overlap;
     do {
         overlap = false;
-        for (ExpoCell *cell : qAsConst(m_cells)) {
-            QRect *target_w = &targets[cell];
-            for (ExpoCell *e : qAsConst(m_cells)) {
-                if (cell == e) {
+        for (int i = 0; i < targets.count(); ++i) {
+            QRect *target_w = &targets[i];
+            // Reuse the unused "slot" as a preferred direction attribute. This is used when the window
+            // is on the edge of the screen to try to use as much screen real estate as possible.
+            const int direction = i % 4;
+            for (int j = 0; j < targets.count(); ++j) {
+                if (i == j) {
                     continue;
                 }
 
-                QRect *target_e = &targets[e];
+                QRect *target_e = &targets[j];
                 if (target_w->adjusted(-halfSpacing, -halfSpacing, halfSpacing, halfSpacing)
                         .intersects(target_e->adjusted(-halfSpacing, -halfSpacing, halfSpacing, halfSpacing))) {
                     overlap = true;
@@ -507,7 +576,7 @@ void ExpoLayout::calculateWindowTransformationsNatural()
                     //else
                     //    diff.setX(diff.x() / 2);
                     // Approximate a vector of between 10px and 20px in magnitude in the same direction
-                    diff *= m_accuracy / qreal(diff.manhattanLength());
+                    diff *= accuracy / qreal(diff.manhattanLength());
                     // Move both windows apart
                     target_w->translate(-diff);
                     target_e->translate(diff);
@@ -527,10 +596,10 @@ void ExpoLayout::calculateWindowTransformationsNatural()
                     diff = QPoint(0, 0);
                     if (xSection != 1 || ySection != 1) { // Remove this if you want the center to pull as well
                         if (xSection == 1) {
-                            xSection = (directions[cell] / 2 ? 2 : 0);
+                            xSection = (direction / 2 ? 2 : 0);
                         }
                         if (ySection == 1) {
-                            ySection = (directions[cell] % 2 ? 2 : 0);
+                            ySection = (direction % 2 ? 2 : 0);
                         }
                     }
                     if (xSection == 0 && ySection == 0) {
@@ -546,7 +615,7 @@ void ExpoLayout::calculateWindowTransformationsNatural()
                         diff = QPoint(bounds.bottomLeft() - target_w->center());
                     }
                     if (diff.x() != 0 || diff.y() != 0) {
-                        diff *= m_accuracy / qreal(diff.manhattanLength());
+                        diff *= accuracy / qreal(diff.manhattanLength());
                         target_w->translate(diff);
                     }
 
@@ -574,17 +643,15 @@ void ExpoLayout::calculateWindowTransformationsNatural()
                    area.height() / scale);
 
     // Move all windows back onto the screen and set their scale
-    QHash<ExpoCell *, QRect>::iterator target = targets.begin();
-    while (target != targets.end()) {
-        target->setRect((target->x() - bounds.x()) * scale + area.x(),
-                        (target->y() - bounds.y()) * scale + area.y(),
-                        target->width() * scale,
-                        target->height() * scale);
-        ++target;
+    for (QRect &target : targets) {
+        target.setRect((target.x() - bounds.x()) * scale + area.x(),
+                       (target.y() - bounds.y()) * scale + area.y(),
+                       target.width() * scale,
+                       target.height() * scale);
     }
 
     // Try to fill the gaps by enlarging windows if they have the space
-    if (m_fillGaps) {
+    if (fillGaps) {
         // Don't expand onto or over the border
         QRegion borderRegion(area.adjusted(-200, -200, 200, 200));
         borderRegion ^= area;
@@ -592,12 +659,13 @@ void ExpoLayout::calculateWindowTransformationsNatural()
         bool moved;
         do {
             moved = false;
-            for (ExpoCell *cell : qAsConst(m_cells)) {
+            for (int i = 0; i < targets.count(); ++i) {
+                const QRect &naturalRect = cells[i].naturalRect;
                 QRect oldRect;
-                QRect *target = &targets[cell];
+                QRect *target = &targets[i];
                 // This may cause some slight distortion if the windows are enlarged a large amount
-                int widthDiff = m_accuracy;
-                int heightDiff = heightForWidth(cell, target->width() + widthDiff) - target->height();
+                int widthDiff = accuracy;
+                int heightDiff = heightForWidth(naturalRect, target->width() + widthDiff) - target->height();
                 int xDiff = widthDiff / 2;  // Also move a bit in the direction of the enlarge, allows the
                 int yDiff = heightDiff / 2; // center windows to be enlarged if there is gaps on the side.
 
@@ -610,11 +678,11 @@ void ExpoLayout::calculateWindowTransformationsNatural()
                                 target->y() - yDiff - heightDiff,
                                 target->width() + widthDiff,
                                 target->height() + heightDiff);
-                if (isOverlappingAny(cell, targets, borderRegion, m_spacing))
+                if (isOverlappingAny(i, targets, borderRegion, spacing))
                     *target = oldRect;
                 else {
                     moved = true;
-                    heightDiff = heightForWidth(cell, target->width() + widthDiff) - target->height();
+                    heightDiff = heightForWidth(naturalRect, target->width() + widthDiff) - target->height();
                     yDiff = heightDiff / 2;
                 }
 
@@ -624,11 +692,11 @@ void ExpoLayout::calculateWindowTransformationsNatural()
                                 target->y() + yDiff,
                                 target->width() + widthDiff,
                                 target->height() + heightDiff);
-                if (isOverlappingAny(cell, targets, borderRegion, m_spacing))
+                if (isOverlappingAny(i, targets, borderRegion, spacing))
                     *target = oldRect;
                 else {
                     moved = true;
-                    heightDiff = heightForWidth(cell, target->width() + widthDiff) - target->height();
+                    heightDiff = heightForWidth(naturalRect, target->width() + widthDiff) - target->height();
                     yDiff = heightDiff / 2;
                 }
 
@@ -638,11 +706,11 @@ void ExpoLayout::calculateWindowTransformationsNatural()
                                 target->y() + yDiff,
                                 target->width() + widthDiff,
                                 target->height() + heightDiff);
-                if (isOverlappingAny(cell, targets, borderRegion, m_spacing))
+                if (isOverlappingAny(i, targets, borderRegion, spacing))
                     *target = oldRect;
                 else {
                     moved = true;
-                    heightDiff = heightForWidth(cell, target->width() + widthDiff) - target->height();
+                    heightDiff = heightForWidth(naturalRect, target->width() + widthDiff) - target->height();
                     yDiff = heightDiff / 2;
                 }
 
@@ -652,7 +720,7 @@ void ExpoLayout::calculateWindowTransformationsNatural()
                                 target->y() - yDiff - heightDiff,
                                 target->width() + widthDiff,
                                 target->height() + heightDiff);
-                if (isOverlappingAny(cell, targets, borderRegion, m_spacing)) {
+                if (isOverlappingAny(i, targets, borderRegion, spacing)) {
                     *target = oldRect;
                 } else {
                     moved = true;
@@ -663,25 +731,40 @@ void ExpoLayout::calculateWindowTransformationsNatural()
         // The expanding code above can actually enlarge windows over 1.0/2.0 scale, we don't like this
         // We can't add this to the loop above as it would cause a never-ending loop so we have to make
         // do with the less-than-optimal space usage with using this method.
-        for (ExpoCell *cell : qAsConst(m_cells)) {
-            QRect *target = &targets[cell];
-            qreal scale = target->width() / qreal(cell->naturalWidth());
-            if (scale > 2.0 || (scale > 1.0 && (cell->naturalWidth() > 300 || cell->naturalHeight() > 300))) {
-                scale = (cell->naturalWidth() > 300 || cell->naturalHeight() > 300) ? 1.0 : 2.0;
-                target->setRect(target->center().x() - int(cell->naturalWidth() * scale) / 2,
-                                target->center().y() - int(cell->naturalHeight() * scale) / 2,
-                                cell->naturalWidth() * scale,
-                                cell->naturalHeight() * scale);
+        for (int i = 0; i < targets.count(); ++i) {
+            const QRect &naturalRect = cells[i].naturalRect;
+            QRect *target = &targets[i];
+            qreal scale = target->width() / qreal(naturalRect.width());
+            if (scale > 2.0 || (scale > 1.0 && (naturalRect.width() > 300 || naturalRect.height() > 300))) {
+                scale = (naturalRect.width() > 300 || naturalRect.height() > 300) ? 1.0 : 2.0;
+                target->setRect(target->center().x() - int(naturalRect.width() * scale) / 2,
+                                target->center().y() - int(naturalRect.height() * scale) / 2,
+                                naturalRect.width() * scale,
+                                naturalRect.height() * scale);
             }
         }
     }
 
-    for (ExpoCell *cell : qAsConst(m_cells)) {
-        const QRect rect = centered(cell, targets.value(cell).marginsRemoved(cell->margins()));
+    for (int i = 0; i < targets.count(); ++i) {
+        targets[i] = centered(cells[i].naturalRect, targets[i].marginsRemoved(cells[i].margins));
+    }
 
-        cell->setX(rect.x());
-        cell->setY(rect.y());
-        cell->setWidth(rect.width());
-        cell->setHeight(rect.height());
+    return targets;
+}
+
+bool ExpoLayout::calculateWindowTransformationsNatural(const LayoutState &state)
+{
+    const QRect area = QRect(0, 0, width(), height());
+
+    // Large layouts can take many iterations to settle, compute them without blocking the
+    // frame and apply the result when it's ready.
+    if (state.cells.count() >= asyncNaturalLayoutCellCount) {
+        m_solvingState = state;
+        m_naturalLayoutWatcher->setFuture(QtConcurrent::run(&ExpoLayout::solveNaturalLayout,
+                                                            state.cellStates, area, m_spacing, m_accuracy, m_fillGaps));
+        return false;
     }
+
+    applyLayout(state.cells, solveNaturalLayout(state.cellStates, area, m_spacing, m_accuracy, m_fillGaps));
+    return true;
 }
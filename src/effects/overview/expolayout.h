@@ -6,9 +6,12 @@
 
 #pragma once
 
+#include <QFutureWatcher>
+#include <QMargins>
 #include <QObject>
 #include <QQuickItem>
 #include <QRect>
+#include <QVector>
 
 #include <optional>
 
@@ -57,8 +60,35 @@ Q_SIGNALS:
     void readyChanged();
 
 private:
+    struct CellState
+    {
+        QRect naturalRect;
+        QMargins margins;
+        QString persistentKey;
+
+        bool operator==(const CellState &other) const;
+    };
+
+    struct LayoutState
+    {
+        QList<ExpoCell *> cells;
+        QVector<CellState> cellStates;
+        QSize size;
+        LayoutMode mode = LayoutNatural;
+        int spacing = 0;
+        bool fillGaps = false;
+
+        bool operator==(const LayoutState &other) const;
+        bool operator!=(const LayoutState &other) const;
+    };
+
+    static QVector<QRect> solveNaturalLayout(const QVector<CellState> &cells, const QRect &area, int spacing, int accuracy, bool fillGaps);
+
+    LayoutState currentState() const;
     void calculateWindowTransformationsClosest();
-    void calculateWindowTransformationsNatural();
+    bool calculateWindowTransformationsNatural(const LayoutState &state);
+    void applyLayout(const QList<ExpoCell *> &cells, const QVector<QRect> &rects);
+    void handleNaturalLayoutFinished();
 
     QList<ExpoCell *> m_cells;
     LayoutMode m_mode = LayoutNatural;
@@ -66,6 +96,11 @@ private:
     int m_spacing = 10;
     bool m_ready = false;
     bool m_fillGaps = false;
+
+    // the inputs of the last applied layout, and of the layout computed in the worker thread
+    LayoutState m_solvedState;
+    LayoutState m_solvingState;
+    QFutureWatcher<QVector<QRect>> *m_naturalLayoutWatcher;
 };
 
 class ExpoCell : public QObject
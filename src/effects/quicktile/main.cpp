@@ -0,0 +1,17 @@
+/*
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "quicktile.h"
+
+namespace KWin
+{
+
+KWIN_EFFECT_FACTORY(QuickTileEffect,
+                    "metadata.json.stripped")
+
+} // namespace KWin
+
+#include "main.moc"
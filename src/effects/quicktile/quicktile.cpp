@@ -0,0 +1,138 @@
+/*
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "quicktile.h"
+
+namespace KWin
+{
+
+QuickTileEffect::QuickTileEffect()
+{
+    // clients that never apply the new geometry must not keep a scaled buffer forever
+    m_pendingTimer.setSingleShot(true);
+    m_pendingTimer.setInterval(1000);
+    connect(&m_pendingTimer, &QTimer::timeout, this, &QuickTileEffect::slotPendingTimeout);
+
+    connect(effects, &EffectsHandler::windowQuickTileModeChanged, this, &QuickTileEffect::slotWindowQuickTileModeChanged);
+    connect(effects, &EffectsHandler::windowFrameGeometryChanged, this, &QuickTileEffect::slotWindowFrameGeometryChanged);
+    connect(effects, &EffectsHandler::windowDeleted, this, &QuickTileEffect::slotWindowDeleted);
+
+    reconfigure(ReconfigureAll);
+}
+
+void QuickTileEffect::reconfigure(ReconfigureFlags flags)
+{
+    Q_UNUSED(flags)
+    m_duration = animationTime(250);
+}
+
+void QuickTileEffect::slotWindowQuickTileModeChanged(EffectWindow *w)
+{
+    if (w->isSpecialWindow() || !w->isVisible()) {
+        return;
+    }
+    if (w->isUserMove() || w->isUserResize()) {
+        return;
+    }
+    // the mode changes while the geometry updates are still blocked, so the frame
+    // geometry is the old one and the pending frame geometry is the new one
+    const QRect from = w->frameGeometry();
+    const QRect to = w->pendingFrameGeometry();
+    if (from != to) {
+        startAnimation(w, from, to);
+    }
+}
+
+void QuickTileEffect::slotWindowFrameGeometryChanged(EffectWindow *w, const QRect &oldGeometry)
+{
+    auto it = m_animations.find(w);
+    if (it == m_animations.end() || !it->waitingForBuffer) {
+        return;
+    }
+    if (w->isUserMove() || w->isUserResize()) {
+        cancelAnimation(w);
+        return;
+    }
+    if (w->frameGeometry().size() != oldGeometry.size()) {
+        startCrossFade(w, *it);
+    }
+}
+
+void QuickTileEffect::slotWindowDeleted(EffectWindow *w)
+{
+    m_animations.remove(w);
+}
+
+void QuickTileEffect::slotPendingTimeout()
+{
+    const QList<EffectWindow *> windows = m_animations.keys();
+    for (EffectWindow *w : windows) {
+        if (m_animations[w].waitingForBuffer) {
+            cancelAnimation(w);
+        }
+    }
+}
+
+void QuickTileEffect::startAnimation(EffectWindow *w, const QRect &from, const QRect &to)
+{
+    cancelAnimation(w);
+
+    const QEasingCurve curve(QEasingCurve::OutCubic);
+    Animation &animation = m_animations[w];
+
+    // the size and the position are absolute, they stay correct when the window gets
+    // its new geometry in the middle of the animation
+    if (from.size() != to.size()) {
+        animation.geometryIds << set(w, Size, 0, m_duration, FPx2(to.size()), curve, 0, FPx2(from.size()));
+        animation.geometryIds << set(w, Position, 0, m_duration, FPx2(to.center()), curve, 0, FPx2(from.center()));
+        animation.waitingForBuffer = true;
+        animation.clock.start();
+        m_pendingTimer.start();
+    } else {
+        // a pure move, the current buffer is already the final one
+        animation.geometryIds << animate(w, Position, 0, m_duration, FPx2(to.center()), curve, 0, FPx2(from.center()));
+    }
+}
+
+void QuickTileEffect::startCrossFade(EffectWindow *w, Animation &animation)
+{
+    animation.waitingForBuffer = false;
+
+    // cross-fade over the rest of the animation, but not too fast if the client was slow
+    const int remaining = m_duration - animation.clock.elapsed();
+    const int duration = qMax(remaining, m_duration / 4);
+
+    // this holds the only reference to the previous window pixmap of the window
+    animation.crossFadeId = animate(w, CrossFadePrevious, 0, duration, FPx2(1.0), QEasingCurve::OutCubic, 0, FPx2(0.0));
+}
+
+void QuickTileEffect::cancelAnimation(EffectWindow *w)
+{
+    const Animation animation = m_animations.take(w);
+    for (quint64 id : animation.geometryIds) {
+        cancel(id);
+    }
+    if (animation.crossFadeId) {
+        cancel(animation.crossFadeId);
+    }
+}
+
+void QuickTileEffect::animationEnded(EffectWindow *w, Attribute a, uint meta)
+{
+    Q_UNUSED(meta)
+    if (a == CrossFadePrevious) {
+        // the new buffer is fully shown, release the persistent geometry animations
+        const Animation animation = m_animations.take(w);
+        for (quint64 id : animation.geometryIds) {
+            cancel(id);
+        }
+    } else if (a == Position) {
+        // only the position animation of a pure move ends on its own
+        m_animations.remove(w);
+    }
+}
+
+} // namespace KWin
@@ -0,0 +1,62 @@
+/*
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <kwinanimationeffect.h>
+
+#include <QElapsedTimer>
+#include <QTimer>
+
+namespace KWin
+{
+
+/**
+ * The QuickTileEffect animates windows from their old to their new geometry when they
+ * get tiled or untiled.
+ *
+ * The client is asked for the final size only once. Until it has committed a buffer with
+ * that size, the last buffer is scaled towards the new geometry, then the effect cross-fades
+ * to the new buffer. So the animation doesn't depend on how fast the client can redraw.
+ */
+class QuickTileEffect : public AnimationEffect
+{
+    Q_OBJECT
+
+public:
+    QuickTileEffect();
+
+    void reconfigure(ReconfigureFlags flags) override;
+
+protected:
+    void animationEnded(EffectWindow *w, Attribute a, uint meta) override;
+
+private Q_SLOTS:
+    void slotWindowQuickTileModeChanged(KWin::EffectWindow *w);
+    void slotWindowFrameGeometryChanged(KWin::EffectWindow *w, const QRect &oldGeometry);
+    void slotWindowDeleted(KWin::EffectWindow *w);
+    void slotPendingTimeout();
+
+private:
+    struct Animation
+    {
+        // the size and position animations stay at the target until they are cancelled
+        QVector<quint64> geometryIds;
+        quint64 crossFadeId = 0;
+        QElapsedTimer clock;
+        bool waitingForBuffer = false;
+    };
+
+    void startAnimation(EffectWindow *w, const QRect &from, const QRect &to);
+    void startCrossFade(EffectWindow *w, Animation &animation);
+    void cancelAnimation(EffectWindow *w);
+
+    QHash<EffectWindow *, Animation> m_animations;
+    QTimer m_pendingTimer;
+    int m_duration = 0;
+};
+
+} // namespace KWin
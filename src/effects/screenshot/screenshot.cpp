@@ -16,6 +16,7 @@
 #include <kwinglutils.h>
 
 #include <QPainter>
+#include <QtConcurrent>
 
 namespace KWin
 {
@@ -27,6 +28,12 @@ struct ScreenShotWindowData
     EffectWindow *window = nullptr;
 };
 
+struct ScreenShotPiece
+{
+    QFuture<QImage> snapshot;
+    QRect rect;
+};
+
 struct ScreenShotAreaData
 {
     QFutureInterface<QImage> promise;
@@ -34,6 +41,7 @@ struct ScreenShotAreaData
     QRect area;
     QImage result;
     QList<EffectScreen *> screens;
+    QVector<ScreenShotPiece> pieces;
 };
 
 struct ScreenShotScreenData
@@ -43,6 +51,21 @@ struct ScreenShotScreenData
     EffectScreen *screen = nullptr;
 };
 
+struct ScreenShotReadback
+{
+    QFutureInterface<QImage> promise;
+    GLuint buffer = 0;
+    GLsync fence = nullptr;
+    QSize size;
+    qreal devicePixelRatio = 1;
+};
+
+struct ScreenShotCursor
+{
+    QImage image;
+    QPoint position;
+};
+
 static void convertFromGLImage(QImage &img, int w, int h)
 {
     // from QtOpenGL/qgl.cpp
@@ -74,6 +97,73 @@ static void convertFromGLImage(QImage &img, int w, int h)
     img = img.mirrored();
 }
 
+static bool supportsAsyncReadback()
+{
+    if (GLPlatform::instance()->isGLES()) {
+        return hasGLVersion(3, 0);
+    }
+    return hasGLVersion(3, 2);
+}
+
+/**
+ * Captures the cursor, so it can be painted into a snapshot that is taken at
+ * @p xOffset, @p yOffset once the pixels have been read back.
+ */
+static ScreenShotCursor grabPointerImage(int xOffset, int yOffset)
+{
+    const PlatformCursorImage cursor = effects->cursorImage();
+    return ScreenShotCursor{cursor.image(), effects->cursorPos() - cursor.hotSpot() - QPoint(xOffset, yOffset)};
+}
+
+static void paintPointerImage(QImage &snapshot, const ScreenShotCursor &cursor)
+{
+    if (cursor.image.isNull()) {
+        return;
+    }
+
+    QPainter painter(&snapshot);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    painter.drawImage(cursor.position, cursor.image);
+}
+
+// The following run on a thread of m_finishThreadPool and block it until the snapshots have
+// been read back
+
+static void finishScreenShot(QFutureInterface<QImage> promise, QFuture<QImage> snapshot, const ScreenShotCursor &cursor)
+{
+    snapshot.waitForFinished();
+    if (snapshot.isCanceled() || !snapshot.resultCount()) {
+        promise.reportCanceled();
+        return;
+    }
+
+    QImage image = snapshot.result();
+    paintPointerImage(image, cursor);
+    promise.reportResult(image);
+    promise.reportFinished();
+}
+
+static void finishAreaScreenShot(QFutureInterface<QImage> promise, const QVector<ScreenShotPiece> &pieces,
+                                 QImage result, const QRect &nativeArea, const ScreenShotCursor &cursor)
+{
+    QPainter painter(&result);
+    painter.setWindow(nativeArea);
+    for (const ScreenShotPiece &piece : pieces) {
+        QFuture<QImage> snapshot = piece.snapshot;
+        snapshot.waitForFinished();
+        if (snapshot.isCanceled() || !snapshot.resultCount()) {
+            promise.reportCanceled();
+            return;
+        }
+        painter.drawImage(piece.rect, snapshot.result());
+    }
+    painter.end();
+
+    paintPointerImage(result, cursor);
+    promise.reportResult(result);
+    promise.reportFinished();
+}
+
 bool ScreenShotEffect::supported()
 {
     return effects->isOpenGLCompositing() && GLRenderTarget::supported();
@@ -86,6 +176,9 @@ ScreenShotEffect::ScreenShotEffect()
     connect(effects, &EffectsHandler::screenAdded, this, &ScreenShotEffect::handleScreenAdded);
     connect(effects, &EffectsHandler::screenRemoved, this, &ScreenShotEffect::handleScreenRemoved);
     connect(effects, &EffectsHandler::windowClosed, this, &ScreenShotEffect::handleWindowClosed);
+
+    m_readbackTimer.setInterval(1);
+    connect(&m_readbackTimer, &QTimer::timeout, this, &ScreenShotEffect::finishReadbacks);
 }
 
 ScreenShotEffect::~ScreenShotEffect()
@@ -93,6 +186,7 @@ ScreenShotEffect::~ScreenShotEffect()
     cancelWindowScreenShots();
     cancelAreaScreenShots();
     cancelScreenScreenShots();
+    cancelReadbacks();
 }
 
 QFuture<QImage> ScreenShotEffect::scheduleScreenShot(EffectScreen *screen, ScreenShotFlags flags)
@@ -233,7 +327,7 @@ void ScreenShotEffect::takeScreenShot(ScreenShotWindowData *screenshot)
 
         // render window into offscreen texture
         int mask = PAINT_WINDOW_TRANSFORMED | PAINT_WINDOW_TRANSLUCENT;
-        QImage img;
+        QFuture<QImage> snapshot;
         if (effects->isOpenGLCompositing()) {
             GLRenderTarget::pushRenderTarget(target.data());
             glClearColor(0.0, 0.0, 0.0, 0.0);
@@ -247,20 +341,16 @@ void ScreenShotEffect::takeScreenShot(ScreenShotWindowData *screenshot)
             effects->drawWindow(window, mask, infiniteRegion(), d);
 
             // copy content from framebuffer into image
-            img = QImage(offscreenTexture->size(), QImage::Format_ARGB32);
-            img.setDevicePixelRatio(devicePixelRatio);
-            glReadnPixels(0, 0, img.width(), img.height(), GL_RGBA, GL_UNSIGNED_BYTE, img.sizeInBytes(),
-                          static_cast<GLvoid *>(img.bits()));
+            snapshot = readPixels(offscreenTexture->size(), devicePixelRatio);
             GLRenderTarget::popRenderTarget();
-            convertFromGLImage(img, img.width(), img.height());
         }
 
+        ScreenShotCursor cursor;
         if (screenshot->flags & ScreenShotIncludeCursor) {
-            grabPointerImage(img, geometry.x(), geometry.y());
+            cursor = grabPointerImage(geometry.x(), geometry.y());
         }
 
-        screenshot->promise.reportResult(img);
-        screenshot->promise.reportFinished();
+        QtConcurrent::run(&m_finishThreadPool, finishScreenShot, screenshot->promise, snapshot, cursor);
     } else {
         screenshot->promise.reportCanceled();
     }
@@ -270,12 +360,13 @@ bool ScreenShotEffect::takeScreenShot(ScreenShotAreaData *screenshot)
 {
     if (!m_paintedScreen) {
         // On X11, all screens are painted simultaneously and there is no native HiDPI support.
-        QImage snapshot = blitScreenshot(screenshot->area);
+        const QFuture<QImage> snapshot = blitScreenshot(screenshot->area);
+        ScreenShotCursor cursor;
         if (screenshot->flags & ScreenShotIncludeCursor) {
-            grabPointerImage(snapshot, screenshot->area.x(), screenshot->area.y());
+            cursor = grabPointerImage(screenshot->area.x(), screenshot->area.y());
         }
-        screenshot->promise.reportResult(snapshot);
-        screenshot->promise.reportFinished();
+        QtConcurrent::run(&m_finishThreadPool, finishScreenShot, screenshot->promise, snapshot, cursor);
+        return true;
     } else {
         if (!screenshot->screens.contains(m_paintedScreen)) {
             return false;
@@ -288,25 +379,22 @@ bool ScreenShotEffect::takeScreenShot(ScreenShotAreaData *screenshot)
             sourceDevicePixelRatio = m_paintedScreen->devicePixelRatio();
         }
 
-        const QImage snapshot = blitScreenshot(sourceRect, sourceDevicePixelRatio);
-        const QRect nativeArea(screenshot->area.topLeft(),
-                               screenshot->area.size() * screenshot->result.devicePixelRatio());
-
-        QPainter painter(&screenshot->result);
-        painter.setWindow(nativeArea);
-        painter.drawImage(sourceRect, snapshot);
-        painter.end();
+        screenshot->pieces.append(ScreenShotPiece{blitScreenshot(sourceRect, sourceDevicePixelRatio), sourceRect});
 
         if (screenshot->screens.isEmpty()) {
+            const QRect nativeArea(screenshot->area.topLeft(),
+                                   screenshot->area.size() * screenshot->result.devicePixelRatio());
+            ScreenShotCursor cursor;
             if (screenshot->flags & ScreenShotIncludeCursor) {
-                grabPointerImage(screenshot->result, screenshot->area.x(), screenshot->area.y());
+                cursor = grabPointerImage(screenshot->area.x(), screenshot->area.y());
             }
-            screenshot->promise.reportResult(screenshot->result);
-            screenshot->promise.reportFinished();
+            QtConcurrent::run(&m_finishThreadPool, finishAreaScreenShot, screenshot->promise, screenshot->pieces,
+                              screenshot->result, nativeArea, cursor);
+            return true;
         }
     }
 
-    return screenshot->promise.isFinished();
+    return false;
 }
 
 bool ScreenShotEffect::takeScreenShot(ScreenShotScreenData *screenshot)
@@ -317,18 +405,19 @@ bool ScreenShotEffect::takeScreenShot(ScreenShotScreenData *screenshot)
             devicePixelRatio = screenshot->screen->devicePixelRatio();
         }
 
-        QImage snapshot = blitScreenshot(screenshot->screen->geometry(), devicePixelRatio);
+        const QFuture<QImage> snapshot = blitScreenshot(screenshot->screen->geometry(), devicePixelRatio);
+        ScreenShotCursor cursor;
         if (screenshot->flags & ScreenShotIncludeCursor) {
             const int xOffset = screenshot->screen->geometry().x();
             const int yOffset = screenshot->screen->geometry().y();
-            grabPointerImage(snapshot, xOffset, yOffset);
+            cursor = grabPointerImage(xOffset, yOffset);
         }
 
-        screenshot->promise.reportResult(snapshot);
-        screenshot->promise.reportFinished();
+        QtConcurrent::run(&m_finishThreadPool, finishScreenShot, screenshot->promise, snapshot, cursor);
+        return true;
     }
 
-    return screenshot->promise.isFinished();
+    return false;
 }
 
 void ScreenShotEffect::postPaintScreen()
@@ -353,45 +442,125 @@ void ScreenShotEffect::postPaintScreen()
     }
 }
 
-QImage ScreenShotEffect::blitScreenshot(const QRect &geometry, qreal devicePixelRatio) const
+QFuture<QImage> ScreenShotEffect::blitScreenshot(const QRect &geometry, qreal devicePixelRatio)
 {
-    QImage image;
+    if (!effects->isOpenGLCompositing()) {
+        QFutureInterface<QImage> promise;
+        promise.reportStarted();
+        promise.reportResult(QImage());
+        promise.reportFinished();
+        return promise.future();
+    }
 
-    if (effects->isOpenGLCompositing()) {
-        const QSize nativeSize = geometry.size() * devicePixelRatio;
+    const QSize nativeSize = geometry.size() * devicePixelRatio;
+
+    if (GLRenderTarget::blitSupported() && (!GLPlatform::instance()->isGLES() || supportsAsyncReadback())) {
+        GLTexture texture(GL_RGBA8, nativeSize.width(), nativeSize.height());
+        GLRenderTarget target(texture);
+        target.blitFromFramebuffer(geometry);
+        // copy content from framebuffer into image
+        GLRenderTarget::pushRenderTarget(&target);
+        const QFuture<QImage> snapshot = readPixels(nativeSize, devicePixelRatio);
+        GLRenderTarget::popRenderTarget();
+        return snapshot;
+    }
 
-        if (GLRenderTarget::blitSupported() && !GLPlatform::instance()->isGLES()) {
-            image = QImage(nativeSize.width(), nativeSize.height(), QImage::Format_ARGB32);
-            GLTexture texture(GL_RGBA8, nativeSize.width(), nativeSize.height());
-            GLRenderTarget target(texture);
-            target.blitFromFramebuffer(geometry);
-            // copy content from framebuffer into image
-            texture.bind();
-            glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE,
-                          static_cast<GLvoid *>(image.bits()));
-            texture.unbind();
+    return readPixels(nativeSize, devicePixelRatio);
+}
+
+/**
+ * Reads @p nativeSize pixels of the bound framebuffer. If supported, the pixels are read into a
+ * pixel buffer object and collected by finishReadbacks() once the GPU is done, so that taking
+ * a screenshot does not stall the compositor. The conversion runs on a worker thread.
+ */
+QFuture<QImage> ScreenShotEffect::readPixels(const QSize &nativeSize, qreal devicePixelRatio)
+{
+    ScreenShotReadback readback;
+    readback.size = nativeSize;
+    readback.devicePixelRatio = devicePixelRatio;
+    readback.promise.reportStarted();
+
+    if (!supportsAsyncReadback()) {
+        QImage image(nativeSize, QImage::Format_ARGB32);
+        glReadnPixels(0, 0, image.width(), image.height(), GL_RGBA, GL_UNSIGNED_BYTE, image.sizeInBytes(),
+                      static_cast<GLvoid *>(image.bits()));
+        convertFromGLImage(image, image.width(), image.height());
+        image.setDevicePixelRatio(devicePixelRatio);
+        readback.promise.reportResult(image);
+        readback.promise.reportFinished();
+        return readback.promise.future();
+    }
+
+    glGenBuffers(1, &readback.buffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+    glBufferData(GL_PIXEL_PACK_BUFFER, nativeSize.width() * nativeSize.height() * 4, nullptr, GL_STREAM_READ);
+    glReadPixels(0, 0, nativeSize.width(), nativeSize.height(), GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+
+    m_readbacks.append(readback);
+    m_readbackTimer.start();
+
+    return readback.promise.future();
+}
+
+void ScreenShotEffect::finishReadbacks()
+{
+    effects->makeOpenGLContextCurrent();
+
+    for (int i = m_readbacks.count() - 1; i >= 0; --i) {
+        const ScreenShotReadback &readback = m_readbacks[i];
+        const GLenum status = glClientWaitSync(readback.fence, 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            continue;
+        }
+
+        QImage image(readback.size, QImage::Format_ARGB32);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+        const void *pixels = status != GL_WAIT_FAILED ? glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, image.sizeInBytes(), GL_MAP_READ_BIT) : nullptr;
+        if (pixels) {
+            memcpy(image.bits(), pixels, image.sizeInBytes());
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        glDeleteBuffers(1, &readback.buffer);
+        glDeleteSync(readback.fence);
+
+        if (pixels) {
+            QtConcurrent::run([](QFutureInterface<QImage> promise, QImage image, qreal devicePixelRatio) {
+                convertFromGLImage(image, image.width(), image.height());
+                image.setDevicePixelRatio(devicePixelRatio);
+                promise.reportResult(image);
+                promise.reportFinished();
+            }, readback.promise, image, readback.devicePixelRatio);
         } else {
-            image = QImage(nativeSize.width(), nativeSize.height(), QImage::Format_ARGB32);
-            glReadPixels(0, 0, nativeSize.width(), nativeSize.height(), GL_RGBA,
-                         GL_UNSIGNED_BYTE, static_cast<GLvoid *>(image.bits()));
+            QFutureInterface<QImage> promise = readback.promise;
+            promise.reportCanceled();
         }
-        convertFromGLImage(image, nativeSize.width(), nativeSize.height());
+
+        m_readbacks.removeAt(i);
     }
 
-    image.setDevicePixelRatio(devicePixelRatio);
-    return image;
+    if (m_readbacks.isEmpty()) {
+        m_readbackTimer.stop();
+    }
 }
 
-void ScreenShotEffect::grabPointerImage(QImage &snapshot, int xOffset, int yOffset) const
+void ScreenShotEffect::cancelReadbacks()
 {
-    const PlatformCursorImage cursor = effects->cursorImage();
-    if (cursor.image().isNull()) {
+    if (m_readbacks.isEmpty()) {
         return;
     }
 
-    QPainter painter(&snapshot);
-    painter.setRenderHint(QPainter::SmoothPixmapTransform);
-    painter.drawImage(effects->cursorPos() - cursor.hotSpot() - QPoint(xOffset, yOffset), cursor.image());
+    effects->makeOpenGLContextCurrent();
+    while (!m_readbacks.isEmpty()) {
+        ScreenShotReadback readback = m_readbacks.takeLast();
+        glDeleteBuffers(1, &readback.buffer);
+        glDeleteSync(readback.fence);
+        readback.promise.reportCanceled();
+    }
 }
 
 bool ScreenShotEffect::isActive() const
@@ -16,6 +16,8 @@
 #include <QFutureInterface>
 #include <QImage>
 #include <QObject>
+#include <QThreadPool>
+#include <QTimer>
 
 namespace KWin
 {
@@ -35,6 +37,7 @@ class ScreenShotDBusInterface2;
 struct ScreenShotWindowData;
 struct ScreenShotAreaData;
 struct ScreenShotScreenData;
+struct ScreenShotReadback;
 
 /**
  * The ScreenShotEffect provides a convenient way to capture the contents of a given window,
@@ -93,13 +96,22 @@ private:
     void cancelAreaScreenShots();
     void cancelScreenScreenShots();
 
-    void grabPointerImage(QImage &snapshot, int xOffset, int yOffset) const;
-    QImage blitScreenshot(const QRect &geometry, qreal devicePixelRatio = 1.0) const;
+    QFuture<QImage> blitScreenshot(const QRect &geometry, qreal devicePixelRatio = 1.0);
+    QFuture<QImage> readPixels(const QSize &nativeSize, qreal devicePixelRatio);
+    void finishReadbacks();
+    void cancelReadbacks();
 
     QVector<ScreenShotWindowData> m_windowScreenShots;
     QVector<ScreenShotAreaData> m_areaScreenShots;
     QVector<ScreenShotScreenData> m_screenScreenShots;
 
+    // pixels that are read back from the GPU without stalling the compositor
+    QVector<ScreenShotReadback> m_readbacks;
+    QTimer m_readbackTimer;
+    // The finishing tasks block until the snapshots have been converted on the global thread
+    // pool, so they run on their own pool and can't take the threads the conversions need.
+    QThreadPool m_finishThreadPool;
+
     QScopedPointer<ScreenShotDBusInterface1> m_dbusInterface1;
     QScopedPointer<ScreenShotDBusInterface2> m_dbusInterface2;
     EffectScreen *m_paintedScreen = nullptr;
@@ -18,6 +18,7 @@
 
 #include <KLocalizedString>
 
+#include <QLocale>
 #include <QPainter>
 #include <QVector2D>
 #include <QPalette>
@@ -34,6 +35,8 @@ ShowFpsEffect::ShowFpsEffect()
     : paints_pos(0)
     , frames_pos(0)
     , m_noBenchmark(effects->effectFrame(EffectFrameUnstyled, false))
+    , m_glStatistics(effects->effectFrame(EffectFrameUnstyled, false))
+    , m_inputLatency(effects->effectFrame(EffectFrameUnstyled, false))
 {
     initConfig<ShowFpsConfig>();
     for (int i = 0;
@@ -48,6 +51,21 @@ ShowFpsEffect::ShowFpsEffect()
         frames[ i ] = 0;
     m_noBenchmark->setAlignment(Qt::AlignTop | Qt::AlignRight);
     m_noBenchmark->setText(i18n("This effect is not a benchmark"));
+    m_glStatistics->setAlignment(Qt::AlignBottom | Qt::AlignLeft);
+    m_inputLatency->setAlignment(Qt::AlignTop | Qt::AlignRight);
+
+    m_fpsGraphLines << 10 << 20 << 50;
+
+    // Log of min/max values shown on the draw size graph
+    const float max_pixels_log = 7.2f;
+    const float min_pixels_log = 2.0f;
+    const int minh = 5;  // Minimum height of the bar when  value > 0
+    const float drawscale = (MAX_TIME - minh) / (max_pixels_log - min_pixels_log);
+    for (int logh = (int)min_pixels_log; logh <= max_pixels_log; logh++)
+        m_drawSizeGraphLines.append((int)((logh - min_pixels_log) * drawscale) + minh);
+
+    m_graphValues.reserve(NUM_PAINTS);
+    m_vertices.reserve(4 * NUM_PAINTS);
     reconfigure(ReconfigureAll);
 }
 
@@ -72,6 +90,8 @@ void ShowFpsEffect::reconfigure(ReconfigureFlags)
         y = screenSize.height() - MAX_TIME - y;
     fps_rect = QRect(x, y, FPS_WIDTH + 2 * NUM_PAINTS, MAX_TIME);
     m_noBenchmark->setPosition(fps_rect.bottomRight() + QPoint(-6, 6));
+    m_glStatistics->setPosition(fps_rect.topLeft() + QPoint(0, -6));
+    m_inputLatency->setPosition(fps_rect.topLeft() + QPoint(-6, 0));
 
     int textPosition = ShowFpsConfig::textPosition();
     textFont = ShowFpsConfig::textFont();
@@ -81,6 +101,7 @@ void ShowFpsEffect::reconfigure(ReconfigureFlags)
     if (!textColor.isValid())
         textColor = QPalette().color(QPalette::Active, QPalette::WindowText);
     textColor.setAlphaF(textAlpha);
+    fpsTextValue = -1;
 
     switch(textPosition) {
     case TOP_LEFT:
@@ -155,12 +176,29 @@ void ShowFpsEffect::paintScreen(int mask, const QRegion &region, ScreenPaintData
     if (effects->isOpenGLCompositing()) {
         paintGL(fps, data.projectionMatrix());
         glFinish(); // make sure all rendering is done
+
+        const GLStateTracker::Statistics statistics = GLStateTracker::instance()->frameStatistics();
+        m_glStatistics->setText(i18n("GL state changes: %1 of %2 calls", statistics.changes, statistics.calls));
+        m_glStatistics->render(infiniteRegion(), 1.0, alpha);
     } else if (effects->compositingType() == QPainterCompositing) {
         paintQPainter(fps);
     }
+    paintInputLatency();
     m_noBenchmark->render(infiniteRegion(), 1.0, alpha);
 }
 
+void ShowFpsEffect::paintInputLatency()
+{
+    // only software cursors are measured, so there is nothing to show otherwise
+    const EffectScreen *screen = effects->screenAt(effects->cursorPos());
+    const std::chrono::microseconds latency = screen ? screen->inputLatency() : std::chrono::microseconds::zero();
+    if (latency <= std::chrono::microseconds::zero()) {
+        return;
+    }
+    m_inputLatency->setText(i18n("Input latency: %1 ms", QLocale().toString(latency.count() / 1000.0, 'f', 1)));
+    m_inputLatency->render(infiniteRegion(), 1.0, alpha);
+}
+
 void ShowFpsEffect::paintGL(int fps, const QMatrix4x4 &projectionMatrix)
 {
     int x = this->x;
@@ -176,8 +214,8 @@ void ShowFpsEffect::paintGL(int fps, const QMatrix4x4 &projectionMatrix)
     QColor color(255, 255, 255);
     color.setAlphaF(alpha);
     vbo->setColor(color);
-    QVector<float> verts;
-    verts.reserve(12);
+    QVector<float> &verts = m_vertices;
+    verts.clear();
     verts << x + 2 * NUM_PAINTS + FPS_WIDTH << y;
     verts << x << y;
     verts << x << y + MAX_TIME;
@@ -203,14 +241,14 @@ void ShowFpsEffect::paintGL(int fps, const QMatrix4x4 &projectionMatrix)
 
     color.setBlue(0);
     vbo->setColor(color);
-    QVector<float> vertices;
+    verts.clear();
     for (int i = 10;
             i < MAX_TIME;
             i += 10) {
-        vertices << x << y - i;
-        vertices << x + FPS_WIDTH << y - i;
+        verts << x << y - i;
+        verts << x + FPS_WIDTH << y - i;
     }
-    vbo->setData(vertices.size() / 2, 2, vertices.constData(), nullptr);
+    vbo->setData(verts.size() / 2, 2, verts.constData(), nullptr);
     vbo->render(GL_LINES);
     x += FPS_WIDTH;
 
@@ -223,7 +261,11 @@ void ShowFpsEffect::paintGL(int fps, const QMatrix4x4 &projectionMatrix)
 
     // Paint FPS numerical value
     if (fpsTextRect.isValid()) {
-        fpsText.reset(new GLTexture(fpsTextImage(fps)));
+        // The text only has to be uploaded again when the value changes.
+        if (!fpsText || fpsTextValue != fps) {
+            fpsText.reset(new GLTexture(fpsTextImage(fps)));
+            fpsTextValue = fps;
+        }
         fpsText->bind();
         ShaderBinder binder(ShaderTrait::MapTexture);
         QMatrix4x4 mvp = projectionMatrix;
@@ -274,35 +316,25 @@ void ShowFpsEffect::paintQPainter(int fps)
 void ShowFpsEffect::paintFPSGraph(int x, int y)
 {
     // Paint FPS graph
-    QList<int> lines;
-    lines << 10 << 20 << 50;
-    QList<int> values;
+    m_graphValues.clear();
     for (int i = 0;
             i < NUM_PAINTS;
             ++i) {
-        values.append(paints[(i + paints_pos) % NUM_PAINTS ]);
+        m_graphValues.append(paints[(i + paints_pos) % NUM_PAINTS ]);
     }
-    paintGraph(x, y, values, lines, true);
+    paintGraph(x, y, m_graphValues, m_fpsGraphLines, true);
 }
 
 void ShowFpsEffect::paintDrawSizeGraph(int x, int y)
 {
-    int max_drawsize = 0;
-    for (int i = 0; i < NUM_PAINTS; i++)
-        max_drawsize = qMax(max_drawsize, paint_size[ i ]);
-
     // Log of min/max values shown on graph
     const float max_pixels_log = 7.2f;
     const float min_pixels_log = 2.0f;
     const int minh = 5;  // Minimum height of the bar when  value > 0
 
     float drawscale = (MAX_TIME - minh) / (max_pixels_log - min_pixels_log);
-    QList<int> drawlines;
-
-    for (int logh = (int)min_pixels_log; logh <= max_pixels_log; logh++)
-        drawlines.append((int)((logh - min_pixels_log) * drawscale) + minh);
 
-    QList<int> drawvalues;
+    m_graphValues.clear();
     for (int i = 0;
             i < NUM_PAINTS;
             ++i) {
@@ -312,54 +344,65 @@ void ShowFpsEffect::paintDrawSizeGraph(int x, int y)
             h = (int)((log10((double)value) - min_pixels_log) * drawscale);
             h = qMin(qMax(0, h) + minh, MAX_TIME);
         }
-        drawvalues.append(h);
+        m_graphValues.append(h);
     }
-    paintGraph(x, y, drawvalues, drawlines, false);
+    paintGraph(x, y, m_graphValues, m_drawSizeGraphLines, false);
 }
 
-void ShowFpsEffect::paintGraph(int x, int y, QList<int> values, QList<int> lines, bool colorize)
+static int graphColorIndex(int value)
 {
+    if (value <= 10) {
+        return 0;
+    } else if (value <= 20) {
+        return 1;
+    } else if (value <= 50) {
+        return 2;
+    }
+    return 3;
+}
+
+void ShowFpsEffect::paintGraph(int x, int y, const QVector<int> &values, const QVector<int> &lines, bool colorize)
+{
+    static const QColor graphColors[] = {
+        QColor(0, 255, 0),
+        QColor(255, 255, 0),
+        QColor(255, 0, 0),
+        QColor(0, 0, 0),
+    };
+
     if (effects->isOpenGLCompositing()) {
         QColor color(0, 0, 0);
         color.setAlphaF(alpha);
         GLVertexBuffer *vbo = GLVertexBuffer::streamingBuffer();
         vbo->reset();
         vbo->setColor(color);
-        QVector<float> verts;
+        QVector<float> &verts = m_vertices;
         // First draw the lines
-        for (int h : qAsConst(lines)) {
+        verts.clear();
+        for (int h : lines) {
             verts << x << y - h;
             verts << x + values.count() << y - h;
         }
         vbo->setData(verts.size() / 2, 2, verts.constData(), nullptr);
         vbo->render(GL_LINES);
-        // Then the graph values
-        int lastValue = 0;
-        verts.clear();
-        for (int i = 0; i < values.count(); i++) {
-            int value = values[ i ];
-            if (colorize && value != lastValue) {
-                if (!verts.isEmpty()) {
-                    vbo->setData(verts.size() / 2, 2, verts.constData(), nullptr);
-                    vbo->render(GL_LINES);
+        // Then the graph values, the bars of each color are drawn at once
+        const int colorCount = colorize ? 4 : 1;
+        for (int colorIndex = 0; colorIndex < colorCount; ++colorIndex) {
+            verts.clear();
+            for (int i = 0; i < values.count(); i++) {
+                const int value = values[ i ];
+                if (colorize && graphColorIndex(value) != colorIndex) {
+                    continue;
                 }
-                verts.clear();
-                if (value <= 10) {
-                    color = QColor(0, 255, 0);
-                } else if (value <= 20) {
-                    color = QColor(255, 255, 0);
-                } else if (value <= 50) {
-                    color = QColor(255, 0, 0);
-                } else {
-                    color = QColor(0, 0, 0);
-                }
-                vbo->setColor(color);
+                verts << x + values.count() - i << y;
+                verts << x + values.count() - i << y - value;
+            }
+            if (verts.isEmpty()) {
+                continue;
+            }
+            if (colorize) {
+                vbo->setColor(graphColors[colorIndex]);
             }
-            verts << x + values.count() - i << y;
-            verts << x + values.count() - i << y - value;
-            lastValue = value;
-        }
-        if (!verts.isEmpty()) {
             vbo->setData(verts.size() / 2, 2, verts.constData(), nullptr);
             vbo->render(GL_LINES);
         }
@@ -367,7 +410,7 @@ void ShowFpsEffect::paintGraph(int x, int y, QList<int> values, QList<int> lines
         QPainter *painter = effects->scenePainter();
         painter->setPen(Qt::black);
         // First draw the lines
-        for (int h : qAsConst(lines)) {
+        for (int h : lines) {
             painter->drawLine(x, y - h, x + values.count(), y - h);
         }
         QColor color(0, 0, 0);
@@ -375,15 +418,7 @@ void ShowFpsEffect::paintGraph(int x, int y, QList<int> values, QList<int> lines
         for (int i = 0; i < values.count(); i++) {
             int value = values[ i ];
             if (colorize) {
-                if (value <= 10) {
-                    color = QColor(0, 255, 0);
-                } else if (value <= 20) {
-                    color = QColor(255, 255, 0);
-                } else if (value <= 50) {
-                    color = QColor(255, 0, 0);
-                } else {
-                    color = QColor(0, 0, 0);
-                }
+                color = graphColors[graphColorIndex(value)];
             }
             painter->setPen(color);
             painter->drawLine(x + values.count() - i, y, x + values.count() - i, y - value);
@@ -398,6 +433,10 @@ void ShowFpsEffect::postPaintScreen()
     if (++paints_pos == NUM_PAINTS)
         paints_pos = 0;
     effects->addRepaint(fps_rect);
+    if (effects->isOpenGLCompositing()) {
+        effects->addRepaint(m_glStatistics->geometry());
+    }
+    effects->addRepaint(m_inputLatency->geometry());
 }
 
 QImage ShowFpsEffect::fpsTextImage(int fps)
@@ -12,6 +12,7 @@
 
 #include <QElapsedTimer>
 #include <QFont>
+#include <QVector>
 
 #include <kwineffects.h>
 
@@ -74,9 +75,10 @@ public:
 private:
     void paintGL(int fps, const QMatrix4x4 &projectionMatrix);
     void paintQPainter(int fps);
+    void paintInputLatency();
     void paintFPSGraph(int x, int y);
     void paintDrawSizeGraph(int x, int y);
-    void paintGraph(int x, int y, QList<int> values, QList<int> lines, bool colorize);
+    void paintGraph(int x, int y, const QVector<int> &values, const QVector<int> &lines, bool colorize);
     QImage fpsTextImage(int fps);
     QElapsedTimer t;
     enum {
@@ -95,12 +97,20 @@ private:
     int y;
     QRect fps_rect;
     QScopedPointer<GLTexture> fpsText;
+    int fpsTextValue = -1; // the value shown in fpsText
     int textPosition;
     QFont textFont;
     QColor textColor;
     QRect fpsTextRect;
     int textAlign;
     QScopedPointer<EffectFrame> m_noBenchmark;
+    QScopedPointer<EffectFrame> m_glStatistics;
+    QScopedPointer<EffectFrame> m_inputLatency;
+    // reused on every frame so painting the graphs doesn't allocate
+    QVector<int> m_fpsGraphLines;
+    QVector<int> m_drawSizeGraphLines;
+    QVector<int> m_graphValues;
+    QVector<float> m_vertices;
 };
 
 } // namespace
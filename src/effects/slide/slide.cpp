@@ -173,6 +173,7 @@ void SlideEffect::paintScreen(int mask, const QRegion &region, ScreenPaintData &
     // Windows, such as docks or keep-above windows, are painted in
     // the last pass so they are above other windows.
     m_paintCtx.firstPass = true;
+    m_paintCtx.screenGeometry = effects->virtualScreenGeometry();
     const int lastDesktop = visibleDesktops.last();
     for (int desktop : qAsConst(visibleDesktops)) {
         m_paintCtx.desktop = desktop;
@@ -251,13 +252,22 @@ bool SlideEffect::isPainted(const EffectWindow *w) const
 
 void SlideEffect::prePaintWindow(EffectWindow *w, WindowPrePaintData &data, std::chrono::milliseconds presentTime)
 {
-    const bool painted = isPainted(w);
+    bool painted = isPainted(w);
+    const bool translated = painted && isTranslated(w);
+
+    // Every painting pass goes through all windows. Windows that end up outside the
+    // screen in this pass, e.g. the ones at the far side of a desktop that is sliding
+    // in, don't have to go through the rest of the effect chain and the scene.
+    if (translated && !w->expandedGeometry().translated(m_paintCtx.translation).intersects(m_paintCtx.screenGeometry)) {
+        painted = false;
+    }
+
     if (painted) {
         w->enablePainting(EffectWindow::PAINT_DISABLED_BY_DESKTOP);
     } else {
         w->disablePainting(EffectWindow::PAINT_DISABLED_BY_DESKTOP);
     }
-    if (painted && isTranslated(w)) {
+    if (painted && translated) {
         data.setTransformed();
     }
     effects->prePaintWindow(w, data, presentTime);
@@ -92,6 +92,7 @@ private:
         bool firstPass;
         bool lastPass;
         QPoint translation;
+        QRect screenGeometry;
 
         EffectWindowList fullscreenWindows;
     } m_paintCtx;
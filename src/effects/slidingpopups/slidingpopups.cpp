@@ -202,6 +202,7 @@ void SlidingPopupsEffect::postPaintWindow(EffectWindow *w)
                 w->setData(WindowForceBlurRole, QVariant());
             }
             m_animations.erase(animationIt);
+            w->setEffectActive(this, false);
         }
         effects->addRepaint(w->expandedGeometry());
     }
@@ -269,6 +270,7 @@ void SlidingPopupsEffect::slotPropertyNotify(EffectWindow *w, long atom)
             w->setData(WindowClosedGrabRole, QVariant());
         }
         m_animations.remove(w);
+        w->setEffectActive(this, false);
         m_animationsData.remove(w);
         return;
     }
@@ -484,6 +486,7 @@ void SlidingPopupsEffect::slideIn(EffectWindow *w)
     }
 
     Animation &animation = m_animations[w];
+    w->setEffectActive(this, true);
     animation.kind = AnimationKind::In;
     animation.timeLine.setDirection(TimeLine::Forward);
     animation.timeLine.setDuration((*dataIt).slideInDuration);
@@ -523,6 +526,7 @@ void SlidingPopupsEffect::slideOut(EffectWindow *w)
     }
 
     Animation &animation = m_animations[w];
+    w->setEffectActive(this, true);
     animation.kind = AnimationKind::Out;
     animation.timeLine.setDirection(TimeLine::Backward);
     animation.timeLine.setDuration((*dataIt).slideOutDuration);
@@ -547,6 +551,7 @@ void SlidingPopupsEffect::stopAnimations()
 {
     for (auto it = m_animations.constBegin(); it != m_animations.constEnd(); ++it) {
         EffectWindow *w = it.key();
+        w->setEffectActive(this, false);
 
         if (w->isDeleted()) {
             w->unrefWindow();
@@ -564,4 +569,9 @@ bool SlidingPopupsEffect::isActive() const
     return !m_animations.isEmpty();
 }
 
+bool SlidingPopupsEffect::paintsActiveWindowsOnly() const
+{
+    return true;
+}
+
 } // namespace
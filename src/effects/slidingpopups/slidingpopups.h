@@ -34,6 +34,7 @@ public:
     void postPaintWindow(EffectWindow *w) override;
     void reconfigure(ReconfigureFlags flags) override;
     bool isActive() const override;
+    bool paintsActiveWindowsOnly() const override;
 
     int requestedEffectChainPosition() const override {
         return 40;
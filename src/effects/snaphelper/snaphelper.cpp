@@ -20,7 +20,7 @@ namespace KWin
 static const int s_lineWidth = 4;
 static const QColor s_lineColor = QColor(128, 128, 128, 128);
 
-static QRegion computeDirtyRegion(const QRect &windowRect)
+static QVector<QRect> computeGuideRects(const QRect &windowRect)
 {
     const QMargins outlineMargins(
         s_lineWidth / 2,
@@ -29,34 +29,45 @@ static QRegion computeDirtyRegion(const QRect &windowRect)
         s_lineWidth / 2
     );
 
-    QRegion dirtyRegion;
-
     const QList<EffectScreen *> screens = effects->screens();
+
+    QVector<QRect> rects;
+    rects.reserve(screens.count() * 6);
+
     for (EffectScreen *screen : screens) {
         const QRect screenRect = effects->clientArea(ScreenArea, screen, effects->currentDesktop());
 
         QRect screenWindowRect = windowRect;
         screenWindowRect.moveCenter(screenRect.center());
 
+        // Center vertical line.
         QRect verticalBarRect(0, 0, s_lineWidth, screenRect.height());
         verticalBarRect.moveCenter(screenRect.center());
-        verticalBarRect.adjust(-1, -1, 1, 1);
-        dirtyRegion += verticalBarRect;
+        rects << verticalBarRect;
 
+        // Center horizontal line.
         QRect horizontalBarRect(0, 0, screenRect.width(), s_lineWidth);
         horizontalBarRect.moveCenter(screenRect.center());
-        horizontalBarRect.adjust(-1, -1, 1, 1);
-        dirtyRegion += horizontalBarRect;
-
-        const QRect outlineOuterRect = screenWindowRect
-            .marginsAdded(outlineMargins)
-            .adjusted(-1, -1, 1, 1);
-        const QRect outlineInnerRect = screenWindowRect
-            .marginsRemoved(outlineMargins)
-            .adjusted(1, 1, -1, -1);
-        dirtyRegion += QRegion(outlineOuterRect) - QRegion(outlineInnerRect);
+        rects << horizontalBarRect;
+
+        // Edges of the window outline, they don't overlap each other.
+        const QRect outerRect = screenWindowRect.marginsAdded(outlineMargins);
+        const QRect innerRect = screenWindowRect.marginsRemoved(outlineMargins);
+        rects << QRect(outerRect.left(), outerRect.top(), outerRect.width(), s_lineWidth);
+        rects << QRect(outerRect.left(), innerRect.bottom() + 1, outerRect.width(), s_lineWidth);
+        rects << QRect(outerRect.left(), innerRect.top(), s_lineWidth, innerRect.height());
+        rects << QRect(innerRect.right() + 1, innerRect.top(), s_lineWidth, innerRect.height());
     }
 
+    return rects;
+}
+
+static QRegion computeDirtyRegion(const QVector<QRect> &rects)
+{
+    QRegion dirtyRegion;
+    for (const QRect &rect : rects) {
+        dirtyRegion += rect.adjusted(-1, -1, 1, 1);
+    }
     return dirtyRegion;
 }
 
@@ -104,10 +115,25 @@ void SnapHelperEffect::paintScreen(int mask, const QRegion &region, ScreenPaintD
     const qreal opacityFactor = m_animation.active
         ? m_animation.timeLine.value()
         : 1.0;
-    const QList<EffectScreen *> screens = effects->screens();
+    QColor color = s_lineColor;
+    color.setAlphaF(color.alphaF() * opacityFactor);
 
     // Display the guide
     if (effects->isOpenGLCompositing()) {
+        // All guides are drawn as quads in a single draw call, wide lines are often
+        // emulated by the driver or not supported at all.
+        if (m_vertices.isEmpty()) {
+            m_vertices.reserve(m_guideRects.count() * 12);
+            for (const QRect &rect : qAsConst(m_guideRects)) {
+                const float x1 = rect.x();
+                const float y1 = rect.y();
+                const float x2 = rect.x() + rect.width();
+                const float y2 = rect.y() + rect.height();
+                m_vertices << x1 << y1 << x2 << y1 << x2 << y2;
+                m_vertices << x2 << y2 << x1 << y2 << x1 << y1;
+            }
+        }
+
         GLVertexBuffer *vbo = GLVertexBuffer::streamingBuffer();
         vbo->reset();
         vbo->setUseColor(true);
@@ -116,78 +142,23 @@ void SnapHelperEffect::paintScreen(int mask, const QRegion &region, ScreenPaintD
         glEnable(GL_BLEND);
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-        QColor color = s_lineColor;
-        color.setAlphaF(color.alphaF() * opacityFactor);
         vbo->setColor(color);
-
-        glLineWidth(s_lineWidth);
-        QVector<float> verts;
-        verts.reserve(screens.count() * 24);
-        for (EffectScreen *screen : screens) {
-            const QRect rect = effects->clientArea(ScreenArea, screen, effects->currentDesktop());
-            const int midX = rect.x() + rect.width() / 2;
-            const int midY = rect.y() + rect.height() / 2 ;
-            const int halfWidth = m_geometry.width() / 2;
-            const int halfHeight = m_geometry.height() / 2;
-
-            // Center vertical line.
-            verts << rect.x() + rect.width() / 2 << rect.y();
-            verts << rect.x() + rect.width() / 2 << rect.y() + rect.height();
-
-            // Center horizontal line.
-            verts << rect.x() << rect.y() + rect.height() / 2;
-            verts << rect.x() + rect.width() << rect.y() + rect.height() / 2;
-
-            // Top edge of the window outline.
-            verts << midX - halfWidth - s_lineWidth / 2 << midY - halfHeight;
-            verts << midX + halfWidth + s_lineWidth / 2 << midY - halfHeight;
-
-            // Right edge of the window outline.
-            verts << midX + halfWidth << midY - halfHeight + s_lineWidth / 2;
-            verts << midX + halfWidth << midY + halfHeight - s_lineWidth / 2;
-
-            // Bottom edge of the window outline.
-            verts << midX + halfWidth + s_lineWidth / 2 << midY + halfHeight;
-            verts << midX - halfWidth - s_lineWidth / 2 << midY + halfHeight;
-
-            // Left edge of the window outline.
-            verts << midX - halfWidth << midY + halfHeight - s_lineWidth / 2;
-            verts << midX - halfWidth << midY - halfHeight + s_lineWidth / 2;
-        }
-        vbo->setData(verts.count() / 2, 2, verts.data(), nullptr);
-        vbo->render(GL_LINES);
+        vbo->setData(m_vertices.count() / 2, 2, m_vertices.constData(), nullptr);
+        vbo->render(GL_TRIANGLES);
 
         glDisable(GL_BLEND);
-        glLineWidth(1.0);
     } else if (effects->compositingType() == QPainterCompositing) {
         QPainter *painter = effects->scenePainter();
-        painter->save();
-        QColor color = s_lineColor;
-        color.setAlphaF(color.alphaF() * opacityFactor);
-        QPen pen(color);
-        pen.setWidth(s_lineWidth);
-        painter->setPen(pen);
-        painter->setBrush(Qt::NoBrush);
-
-        for (EffectScreen *screen : screens) {
-            const QRect rect = effects->clientArea(ScreenArea, screen, effects->currentDesktop());
-            // Center lines.
-            painter->drawLine(rect.center().x(), rect.y(), rect.center().x(), rect.y() + rect.height());
-            painter->drawLine(rect.x(), rect.center().y(), rect.x() + rect.width(), rect.center().y());
-
-            // Window outline.
-            QRect outlineRect(0, 0, m_geometry.width(), m_geometry.height());
-            outlineRect.moveCenter(rect.center());
-            painter->drawRect(outlineRect);
+        for (const QRect &rect : qAsConst(m_guideRects)) {
+            painter->fillRect(rect, color);
         }
-        painter->restore();
     }
 }
 
 void SnapHelperEffect::postPaintScreen()
 {
     if (m_animation.active) {
-        effects->addRepaint(computeDirtyRegion(m_geometry));
+        effects->addRepaint(computeDirtyRegion(m_guideRects));
     }
 
     if (m_animation.timeLine.done()) {
@@ -213,7 +184,7 @@ void SnapHelperEffect::slotWindowClosed(EffectWindow *w)
         m_animation.timeLine.reset();
     }
 
-    effects->addRepaint(computeDirtyRegion(m_geometry));
+    effects->addRepaint(computeDirtyRegion(m_guideRects));
 }
 
 void SnapHelperEffect::slotWindowStartUserMovedResized(EffectWindow *w)
@@ -223,7 +194,7 @@ void SnapHelperEffect::slotWindowStartUserMovedResized(EffectWindow *w)
     }
 
     m_window = w;
-    m_geometry = w->frameGeometry();
+    setGeometry(w->frameGeometry());
 
     m_animation.active = true;
     m_animation.timeLine.setDirection(TimeLine::Forward);
@@ -232,7 +203,7 @@ void SnapHelperEffect::slotWindowStartUserMovedResized(EffectWindow *w)
         m_animation.timeLine.reset();
     }
 
-    effects->addRepaint(computeDirtyRegion(m_geometry));
+    effects->addRepaint(computeDirtyRegion(m_guideRects));
 }
 
 void SnapHelperEffect::slotWindowFinishUserMovedResized(EffectWindow *w)
@@ -242,7 +213,7 @@ void SnapHelperEffect::slotWindowFinishUserMovedResized(EffectWindow *w)
     }
 
     m_window = nullptr;
-    m_geometry = w->frameGeometry();
+    setGeometry(w->frameGeometry());
 
     m_animation.active = true;
     m_animation.timeLine.setDirection(TimeLine::Backward);
@@ -251,7 +222,7 @@ void SnapHelperEffect::slotWindowFinishUserMovedResized(EffectWindow *w)
         m_animation.timeLine.reset();
     }
 
-    effects->addRepaint(computeDirtyRegion(m_geometry));
+    effects->addRepaint(computeDirtyRegion(m_guideRects));
 }
 
 void SnapHelperEffect::slotWindowFrameGeometryChanged(EffectWindow *w, const QRect &old)
@@ -260,9 +231,21 @@ void SnapHelperEffect::slotWindowFrameGeometryChanged(EffectWindow *w, const QRe
         return;
     }
 
-    m_geometry = w->frameGeometry();
+    // The guides are centered on the screens, only the size of the window matters.
+    if (w->frameGeometry().size() == old.size()) {
+        return;
+    }
+
+    const QRegion dirtyRegion = computeDirtyRegion(m_guideRects);
+    setGeometry(w->frameGeometry());
+    effects->addRepaint(dirtyRegion + computeDirtyRegion(m_guideRects));
+}
 
-    effects->addRepaint(computeDirtyRegion(old));
+void SnapHelperEffect::setGeometry(const QRect &geometry)
+{
+    m_geometry = geometry;
+    m_guideRects = computeGuideRects(geometry);
+    m_vertices.clear();
 }
 
 bool SnapHelperEffect::isActive() const
@@ -39,7 +39,11 @@ private Q_SLOTS:
     void slotWindowFrameGeometryChanged(EffectWindow *w, const QRect &old);
 
 private:
+    void setGeometry(const QRect &geometry);
+
     QRect m_geometry;
+    QVector<QRect> m_guideRects;
+    QVector<float> m_vertices;
     EffectWindow *m_window = nullptr;
 
     struct Animation {
@@ -41,6 +41,14 @@ static bool stripMetaData(const QString &fileName, const QString &target)
     QJsonObject strippedRootObject;
     strippedRootObject["KPlugin"] = kpluginObject;
 
+    // the effect loader needs to know whether the effect can be loaded after the first frame
+    const QJsonValue deferred = originalRootObject["org.kde.kwin.effect"]["deferred"];
+    if (deferred.toBool()) {
+        QJsonObject effectObject;
+        effectObject["deferred"] = deferred;
+        strippedRootObject["org.kde.kwin.effect"] = effectObject;
+    }
+
     QFile targetFile(target);
     if (!targetFile.open(QFile::WriteOnly)) {
         qWarning("Failed to open %s: %s", qPrintable(target), qPrintable(targetFile.errorString()));
@@ -71,13 +71,14 @@ bool TouchPointsEffect::touchDown(qint32 id, const QPointF &pos, quint32 time)
 bool TouchPointsEffect::touchMotion(qint32 id, const QPointF &pos, quint32 time)
 {
     Q_UNUSED(time)
-    TouchPoint point;
-    point.pos = pos;
-    point.press = true;
-    point.color = colorForId(id);
-    m_points << point;
+    // Touch screens report motion far more often than frames are painted, a ring for every
+    // single event would pile up hundreds of overlapping rings with several fingers.
+    if (m_pendingMotion.isEmpty()) {
+        const int radius = m_ringMaxSize + m_lineWidth;
+        effects->addRepaint(QRect(pos.x() - radius, pos.y() - radius, 2 * radius, 2 * radius));
+    }
+    m_pendingMotion.insert(id, pos);
     m_latestPositions.insert(id, pos);
-    repaint();
     return false;
 }
 
@@ -112,6 +113,19 @@ void TouchPointsEffect::prePaintScreen(ScreenPrePaintData& data, std::chrono::mi
         }
     }
 
+    if (!m_pendingMotion.isEmpty()) {
+        const int radius = m_ringMaxSize + m_lineWidth;
+        for (auto it = m_pendingMotion.constBegin(); it != m_pendingMotion.constEnd(); ++it) {
+            TouchPoint point;
+            point.pos = it.value();
+            point.press = true;
+            point.color = colorForId(it.key());
+            m_points << point;
+            data.paint |= QRect(point.pos.x() - radius, point.pos.y() - radius, 2 * radius, 2 * radius);
+        }
+        m_pendingMotion.clear();
+    }
+
     if (m_points.isEmpty()) {
         m_lastPresentTime = std::chrono::milliseconds::zero();
     } else {
@@ -175,7 +189,7 @@ void TouchPointsEffect::repaint()
 
 bool TouchPointsEffect::isActive() const
 {
-    return !m_points.isEmpty();
+    return !m_points.isEmpty() || !m_pendingMotion.isEmpty();
 }
 
 void TouchPointsEffect::drawCircle(const QColor& color, float cx, float cy, float r)
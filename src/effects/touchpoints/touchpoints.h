@@ -78,6 +78,8 @@ private:
     };
     QVector<TouchPoint> m_points;
     QHash<quint32, QPointF> m_latestPositions;
+    // touch motion since the last frame, only the latest position of each point gets a ring
+    QHash<quint32, QPointF> m_pendingMotion;
     QHash<quint32, Qt::GlobalColor> m_colors;
     std::chrono::milliseconds m_lastPresentTime = std::chrono::milliseconds::zero();
 
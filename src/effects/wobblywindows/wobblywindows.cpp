@@ -11,6 +11,9 @@
 #include "wobblywindows.h"
 #include "wobblywindowsconfig.h"
 
+#include <kwinglutils.h>
+
+#include <algorithm>
 #include <cmath>
 
 //#define COMPUTE_STATS
@@ -254,14 +257,35 @@ void WobblyWindowsEffect::prePaintWindow(EffectWindow* w, WindowPrePaintData& da
         // opaque wobbly windows.
         data.clip = QRegion();
 
-        while ((presentTime - infoIt->clock).count() > 0) {
-            const auto delta = std::min(presentTime - infoIt->clock, integrationStep);
-            infoIt->clock += delta;
+        if (infoIt->asleep) {
+            if (w->frameGeometry() == infoIt->asleepGeometry) {
+                infoIt->clock = presentTime;
+            } else {
+                infoIt->asleep = false;
+            }
+        }
+
+        // The physics only advance in whole steps so that they behave the same at any
+        // refresh rate, the painted grid is interpolated between the last two steps.
+        bool settled = false;
+        while (!infoIt->asleep && presentTime - infoIt->clock >= integrationStep) {
+            std::copy(infoIt->position, infoIt->position + infoIt->count, infoIt->previousPosition);
+            infoIt->clock += integrationStep;
 
-            if (!updateWindowWobblyDatas(w, delta.count())) {
+            if (!updateWindowWobblyDatas(w, integrationStep.count())) {
+                settled = true;
                 break;
             }
         }
+
+        if (!settled) {
+            WindowWobblyInfos &wwi = *infoIt;
+            const qreal t = wwi.asleep ? 1.0 : qreal((presentTime - wwi.clock).count()) / integrationStep.count();
+            for (unsigned int i = 0; i < wwi.count; ++i) {
+                wwi.paintedPosition[i].x = wwi.previousPosition[i].x + (wwi.position[i].x - wwi.previousPosition[i].x) * t;
+                wwi.paintedPosition[i].y = wwi.previousPosition[i].y + (wwi.position[i].y - wwi.previousPosition[i].y) * t;
+            }
+        }
     }
 
     effects->prePaintWindow(w, data, presentTime);
@@ -270,7 +294,18 @@ void WobblyWindowsEffect::prePaintWindow(EffectWindow* w, WindowPrePaintData& da
 void WobblyWindowsEffect::deform(EffectWindow *w, int mask, WindowPaintData &data, WindowQuadList &quads)
 {
     if (!(mask & PAINT_SCREEN_TRANSFORMED) && windows.contains(w)) {
-        quads = quads.makeRegularGrid(m_xTesselation, m_yTesselation);
+        // Every vertex is moved along the bezier surface on the cpu, use a coarser grid under load.
+        qreal xTesselation = m_xTesselation;
+        qreal yTesselation = m_yTesselation;
+        if (const EffectScreen *screen = w->screen()) {
+            const EffectScreen::RenderQuality quality = screen->renderQuality();
+            if (quality != EffectScreen::RenderQuality::High) {
+                const qreal factor = quality == EffectScreen::RenderQuality::Low ? 4.0 : 2.0;
+                xTesselation = qMin(m_xTesselation, qMax(4.0, m_xTesselation / factor));
+                yTesselation = qMin(m_yTesselation, qMax(4.0, m_yTesselation / factor));
+            }
+        }
+        quads = quads.makeRegularGrid(xTesselation, yTesselation);
 
         WindowWobblyInfos& wwi = windows[w];
         int tx = w->frameGeometry().x();
@@ -300,8 +335,79 @@ void WobblyWindowsEffect::deform(EffectWindow *w, int mask, WindowPaintData &dat
             (bottom - top + 1.0) * data.yScale());
         // Expand the dirty region by 1px to fix potential round/floor issues.
         dirtyRect.adjust(-1.0, -1.0, 1.0, 1.0);
+        if (!wwi.asleep) {
+            m_updateRegion = m_updateRegion.united(dirtyRect.toRect());
+        }
+    }
+}
+
+QByteArray WobblyWindowsEffect::deformSource() const
+{
+    // the same bicubic bezier surface as computeBezierPoint(), evaluated per vertex
+    return QByteArrayLiteral(
+        "uniform vec2 controlPoints[16];\n"
+        "uniform vec2 frameSize;\n"
+        "\n"
+        "vec2 deformVertex(vec2 position)\n"
+        "{\n"
+        "    vec2 t = position / frameSize;\n"
+        "    vec2 s = 1.0 - t;\n"
+        "    vec4 px = vec4(s.x * s.x * s.x, 3.0 * s.x * s.x * t.x, 3.0 * s.x * t.x * t.x, t.x * t.x * t.x);\n"
+        "    vec4 py = vec4(s.y * s.y * s.y, 3.0 * s.y * s.y * t.y, 3.0 * s.y * t.y * t.y, t.y * t.y * t.y);\n"
+        "    vec2 result = vec2(0.0);\n"
+        "    for (int j = 0; j < 4; ++j) {\n"
+        "        for (int i = 0; i < 4; ++i) {\n"
+        "            result += px[i] * py[j] * controlPoints[i + j * 4];\n"
+        "        }\n"
+        "    }\n"
+        "    return result;\n"
+        "}\n");
+}
+
+QSize WobblyWindowsEffect::deformGridSize() const
+{
+    return QSize(qMax(1, qRound(m_xTesselation)), qMax(1, qRound(m_yTesselation)));
+}
+
+bool WobblyWindowsEffect::setupDeformShader(EffectWindow *w, int mask, WindowPaintData &data, GLShader *shader)
+{
+    auto it = windows.constFind(w);
+    if ((mask & PAINT_SCREEN_TRANSFORMED) || it == windows.constEnd()) {
+        return false;
+    }
+
+    const WindowWobblyInfos &wwi = *it;
+    const QRect frameGeometry = w->frameGeometry();
+
+    // the bezier surface lies within the convex hull of its control points
+    QVector2D controlPoints[16];
+    qreal left = 0.0;
+    qreal top = 0.0;
+    qreal right = w->width();
+    qreal bottom = w->height();
+    for (int i = 0; i < 16; ++i) {
+        const Pair &point = wwi.paintedPosition[i];
+        controlPoints[i] = QVector2D(point.x - frameGeometry.x(), point.y - frameGeometry.y());
+        left = qMin<qreal>(left, controlPoints[i].x());
+        top = qMin<qreal>(top, controlPoints[i].y());
+        right = qMax<qreal>(right, controlPoints[i].x());
+        bottom = qMax<qreal>(bottom, controlPoints[i].y());
+    }
+
+    glUniform2fv(shader->uniformLocation("controlPoints"), 16, reinterpret_cast<const GLfloat *>(controlPoints));
+    shader->setUniform("frameSize", QVector2D(frameGeometry.width(), frameGeometry.height()));
+
+    QRectF dirtyRect(
+        left * data.xScale() + w->x() + data.xTranslation(),
+        top * data.yScale() + w->y() + data.yTranslation(),
+        (right - left + 1.0) * data.xScale(),
+        (bottom - top + 1.0) * data.yScale());
+    // Expand the dirty region by 1px to fix potential round/floor issues.
+    dirtyRect.adjust(-1.0, -1.0, 1.0, 1.0);
+    if (!wwi.asleep) {
         m_updateRegion = m_updateRegion.united(dirtyRect.toRect());
     }
+    return true;
 }
 
 void WobblyWindowsEffect::postPaintScreen()
@@ -343,6 +449,7 @@ void WobblyWindowsEffect::slotWindowFinishUserMovedResized(EffectWindow *w)
     if (windows.contains(w)) {
         WindowWobblyInfos& wwi = windows[w];
         wwi.status = Free;
+        wwi.asleep = false;
         const QRect rect = w->frameGeometry();
         if (rect.y() != wwi.resize_original_rect.y()) wwi.can_wobble_top = true;
         if (rect.x() != wwi.resize_original_rect.x()) wwi.can_wobble_left = true;
@@ -384,6 +491,7 @@ void WobblyWindowsEffect::startMovedResized(EffectWindow* w)
 
     WindowWobblyInfos& wwi = windows[w];
     wwi.status = Moving;
+    wwi.asleep = false;
     const QRectF& rect = w->frameGeometry();
 
     qreal x_increment = rect.width() / (wwi.width - 1.0);
@@ -426,6 +534,7 @@ void WobblyWindowsEffect::stepMovedResized(EffectWindow* w)
 
     WindowWobblyInfos& wwi = windows[w];
     wwi.status = Free;
+    wwi.asleep = false;
 
     QRect maximized_area = effects->clientArea(MaximizeArea, w);
     bool throb_direction_out = (new_geometry.top() == maximized_area.top() && new_geometry.bottom() == maximized_area.bottom()) ||
@@ -458,6 +567,8 @@ void WobblyWindowsEffect::initWobblyInfo(WindowWobblyInfos& wwi, QRect geometry)
 
     wwi.origin = new Pair[wwi.count];
     wwi.position = new Pair[wwi.count];
+    wwi.previousPosition = new Pair[wwi.count];
+    wwi.paintedPosition = new Pair[wwi.count];
     wwi.velocity = new Pair[wwi.count];
     wwi.acceleration = new Pair[wwi.count];
     wwi.buffer = new Pair[wwi.count];
@@ -466,6 +577,7 @@ void WobblyWindowsEffect::initWobblyInfo(WindowWobblyInfos& wwi, QRect geometry)
     wwi.bezierSurface = new Pair[wwi.bezierCount];
 
     wwi.status = Moving;
+    wwi.asleep = false;
     wwi.clock = std::chrono::duration_cast<std::chrono::milliseconds>(
             std::chrono::steady_clock::now().time_since_epoch());
 
@@ -483,6 +595,8 @@ void WobblyWindowsEffect::initWobblyInfo(WindowWobblyInfos& wwi, QRect geometry)
             unsigned int idx = j * 4 + i;
             wwi.origin[idx] = initValue;
             wwi.position[idx] = initValue;
+            wwi.previousPosition[idx] = initValue;
+            wwi.paintedPosition[idx] = initValue;
             wwi.velocity[idx] = nullPair;
             wwi.constraint[idx] = false;
             if (i != 4 - 2) { // x grid count - 2, i.e. not the last point
@@ -507,6 +621,8 @@ void WobblyWindowsEffect::freeWobblyInfo(WindowWobblyInfos& wwi) const
 {
     delete[] wwi.origin;
     delete[] wwi.position;
+    delete[] wwi.previousPosition;
+    delete[] wwi.paintedPosition;
     delete[] wwi.velocity;
     delete[] wwi.acceleration;
     delete[] wwi.buffer;
@@ -539,8 +655,8 @@ WobblyWindowsEffect::Pair WobblyWindowsEffect::computeBezierPoint(const WindowWo
     for (unsigned int j = 0; j < 4; ++j) {
         for (unsigned int i = 0; i < 4; ++i) {
             // this assume the grid is 4*4
-            res.x += px[i] * py[j] * wwi.position[i + j * wwi.width].x;
-            res.y += px[i] * py[j] * wwi.position[i + j * wwi.width].y;
+            res.x += px[i] * py[j] * wwi.paintedPosition[i + j * wwi.width].x;
+            res.y += px[i] * py[j] * wwi.paintedPosition[i + j * wwi.width].y;
         }
     }
 
@@ -931,13 +1047,18 @@ bool WobblyWindowsEffect::updateWindowWobblyDatas(EffectWindow* w, qreal time)
     qCDebug(KWIN_WOBBLYWINDOWS) << "sum_acc : " << acc_sum << "  ***  sum_vel :" << vel_sum;
 #endif
 
-    if (wwi.status != Moving && acc_sum < m_stopAcceleration && vel_sum < m_stopVelocity) {
-        freeWobblyInfo(wwi);
-        windows.remove(w);
-        unredirect(w);
-        if (windows.isEmpty())
-            effects->addRepaintFull();
-        return false;
+    if (acc_sum < m_stopAcceleration && vel_sum < m_stopVelocity) {
+        if (wwi.status != Moving) {
+            freeWobblyInfo(wwi);
+            windows.remove(w);
+            unredirect(w);
+            if (windows.isEmpty())
+                effects->addRepaintFull();
+            return false;
+        }
+        // the window is still held, but nothing moves until it's moved again
+        wwi.asleep = true;
+        wwi.asleepGeometry = w->frameGeometry();
     }
 
     return true;
@@ -116,6 +116,9 @@ public:
 
 protected:
     void deform(EffectWindow *w, int mask, WindowPaintData &data, WindowQuadList &quads) override;
+    QByteArray deformSource() const override;
+    QSize deformGridSize() const override;
+    bool setupDeformShader(EffectWindow *w, int mask, WindowPaintData &data, GLShader *shader) override;
 
 public Q_SLOTS:
     void slotWindowStartUserMovedResized(KWin::EffectWindow *w);
@@ -131,6 +134,10 @@ private:
     struct WindowWobblyInfos {
         Pair* origin;
         Pair* position;
+        // the positions before the last integration step and the ones that are painted,
+        // which lie between them and the current positions
+        Pair* previousPosition;
+        Pair* paintedPosition;
         Pair* velocity;
         Pair* acceleration;
         Pair* buffer;
@@ -155,6 +162,11 @@ private:
         QRect resize_original_rect;
 
         std::chrono::milliseconds clock;
+
+        // set when a window that is held by the pointer has come to rest, the physics are
+        // not integrated until the window is moved again
+        bool asleep;
+        QRect asleepGeometry;
     };
 
     QHash< const EffectWindow*,  WindowWobblyInfos > windows;
@@ -132,6 +132,7 @@ ZoomEffect::~ZoomEffect()
 {
     // switch off and free resources
     showCursor();
+    destroyOffscreenTexture();
     // Save the zoom value.
     ZoomConfig::setInitialZoom(target_zoom);
     ZoomConfig::self()->save();
@@ -208,6 +209,8 @@ void ZoomEffect::reconfigure(ReconfigureFlags)
     ZoomConfig::self()->read();
     // On zoom-in and zoom-out change the zoom by the defined zoom-factor.
     zoomFactor = qMax(0.1, ZoomConfig::zoomFactor());
+    // The time a zoom step takes, it depends on how large the step is.
+    zoomDuration = animationTime(150 * zoomFactor);
     // Visibility of the mouse-pointer.
     mousePointer = MousePointerType(ZoomConfig::mousePointer());
     // Track moving of the mouse.
@@ -243,100 +246,244 @@ void ZoomEffect::prePaintScreen(ScreenPrePaintData& data, std::chrono::milliseco
 
         const float zoomDist = qAbs(target_zoom - source_zoom);
         if (target_zoom > zoom)
-            zoom = qMin(zoom + ((zoomDist * time) / animationTime(150*zoomFactor)), target_zoom);
+            zoom = qMin(zoom + ((zoomDist * time) / zoomDuration), target_zoom);
         else
-            zoom = qMax(zoom - ((zoomDist * time) / animationTime(150*zoomFactor)), target_zoom);
+            zoom = qMax(zoom - ((zoomDist * time) / zoomDuration), target_zoom);
     }
 
     if (zoom == 1.0) {
         showCursor();
-    } else {
-        hideCursor();
+        destroyOffscreenTexture();
+        m_useTexture = false;
+        m_mapWindowDamage = false;
+        effects->prePaintScreen(data, presentTime);
+        return;
+    }
+
+    hideCursor();
+    updateTranslation();
+
+    m_useTexture = canUseOffscreenTexture() && ensureOffscreenTexture();
+    m_mapWindowDamage = false;
+    if (!m_useTexture) {
+        m_textureValid = false;
+        data.mask |= PAINT_SCREEN_TRANSFORMED;
+        effects->prePaintScreen(data, presentTime);
+        m_cursorRect = cursorRect();
+        return;
+    }
+
+    // The offscreen texture only has to be painted again in full when the view onto it changed,
+    // otherwise the scene paints its damage unzoomed into the texture.
+    const bool viewChanged = !m_textureValid || m_textureZoom != zoom || m_textureTranslation != m_translation;
+    if (viewChanged) {
         data.mask |= PAINT_SCREEN_TRANSFORMED;
     }
 
     effects->prePaintScreen(data, presentTime);
+
+    const QRect cursor = cursorRect();
+    if (!(data.mask & PAINT_SCREEN_TRANSFORMED) && data.paint != infiniteRegion()) {
+        // The scene reports the painted region as the output damage, so it has to contain
+        // the damaged parts of the texture where they show up once zoomed as well.
+        data.paint |= mapToZoomed(data.paint) | m_cursorRect | cursor;
+        m_screenDamage = data.paint;
+        m_mapWindowDamage = true;
+    }
+    m_cursorRect = cursor;
 }
 
-void ZoomEffect::paintScreen(int mask, const QRegion &region, ScreenPaintData& data)
+void ZoomEffect::prePaintWindow(EffectWindow *w, WindowPrePaintData &data, std::chrono::milliseconds presentTime)
 {
-    if (zoom != 1.0) {
-        data *= QVector2D(zoom, zoom);
-        const QSize screenSize = effects->virtualScreenSize();
-
-        // mouse-tracking allows navigation of the zoom-area using the mouse.
-        switch(mouseTracking) {
-        case MouseTrackingProportional:
-            data.setXTranslation(- int(cursorPoint.x() * (zoom - 1.0)));
-            data.setYTranslation(- int(cursorPoint.y() * (zoom - 1.0)));
-            prevPoint = cursorPoint;
-            break;
-        case MouseTrackingCentred:
-            prevPoint = cursorPoint;
-            // fall through
-        case MouseTrackingDisabled:
-            data.setXTranslation(qMin(0, qMax(int(screenSize.width() - screenSize.width() * zoom), int(screenSize.width() / 2 - prevPoint.x() * zoom))));
-            data.setYTranslation(qMin(0, qMax(int(screenSize.height() - screenSize.height() * zoom), int(screenSize.height() / 2 - prevPoint.y() * zoom))));
+    effects->prePaintWindow(w, data, presentTime);
+
+    // The window damage ends up in the output damage through the painted region of the window.
+    if (m_mapWindowDamage) {
+        const QRegion damage = data.paint - m_screenDamage;
+        if (!damage.isEmpty()) {
+            data.paint |= mapToZoomed(damage);
+        }
+    }
+}
+
+void ZoomEffect::updateTranslation()
+{
+    const QSize screenSize = effects->virtualScreenSize();
+
+    // mouse-tracking allows navigation of the zoom-area using the mouse.
+    switch(mouseTracking) {
+    case MouseTrackingProportional:
+        m_translation.setX(- int(cursorPoint.x() * (zoom - 1.0)));
+        m_translation.setY(- int(cursorPoint.y() * (zoom - 1.0)));
+        prevPoint = cursorPoint;
+        break;
+    case MouseTrackingCentred:
+        prevPoint = cursorPoint;
+        // fall through
+    case MouseTrackingDisabled:
+        m_translation.setX(qMin(0, qMax(int(screenSize.width() - screenSize.width() * zoom), int(screenSize.width() / 2 - prevPoint.x() * zoom))));
+        m_translation.setY(qMin(0, qMax(int(screenSize.height() - screenSize.height() * zoom), int(screenSize.height() / 2 - prevPoint.y() * zoom))));
+        break;
+    case MouseTrackingPush: {
+            // touching an edge of the screen moves the zoom-area in that direction.
+            int x = cursorPoint.x() * zoom - prevPoint.x() * (zoom - 1.0);
+            int y = cursorPoint.y() * zoom - prevPoint.y() * (zoom - 1.0);
+            int threshold = 4;
+            xMove = yMove = 0;
+            if (x < threshold)
+                xMove = (x - threshold) / zoom;
+            else if (x + threshold > screenSize.width())
+                xMove = (x + threshold - screenSize.width()) / zoom;
+            if (y < threshold)
+                yMove = (y - threshold) / zoom;
+            else if (y + threshold > screenSize.height())
+                yMove = (y + threshold - screenSize.height()) / zoom;
+            if (xMove)
+                prevPoint.setX(qMax(0, qMin(screenSize.width(), prevPoint.x() + xMove)));
+            if (yMove)
+                prevPoint.setY(qMax(0, qMin(screenSize.height(), prevPoint.y() + yMove)));
+            m_translation.setX(- int(prevPoint.x() * (zoom - 1.0)));
+            m_translation.setY(- int(prevPoint.y() * (zoom - 1.0)));
             break;
-        case MouseTrackingPush: {
-                // touching an edge of the screen moves the zoom-area in that direction.
-                int x = cursorPoint.x() * zoom - prevPoint.x() * (zoom - 1.0);
-                int y = cursorPoint.y() * zoom - prevPoint.y() * (zoom - 1.0);
-                int threshold = 4;
-                xMove = yMove = 0;
-                if (x < threshold)
-                    xMove = (x - threshold) / zoom;
-                else if (x + threshold > screenSize.width())
-                    xMove = (x + threshold - screenSize.width()) / zoom;
-                if (y < threshold)
-                    yMove = (y - threshold) / zoom;
-                else if (y + threshold > screenSize.height())
-                    yMove = (y + threshold - screenSize.height()) / zoom;
-                if (xMove)
-                    prevPoint.setX(qMax(0, qMin(screenSize.width(), prevPoint.x() + xMove)));
-                if (yMove)
-                    prevPoint.setY(qMax(0, qMin(screenSize.height(), prevPoint.y() + yMove)));
-                data.setXTranslation(- int(prevPoint.x() * (zoom - 1.0)));
-                data.setYTranslation(- int(prevPoint.y() * (zoom - 1.0)));
-                break;
-            }
         }
+    }
 
-        // use the focusPoint if focus tracking is enabled
-        if (isFocusTrackingEnabled() || isTextCaretTrackingEnabled()) {
-            bool acceptFocus = true;
-            if (mouseTracking != MouseTrackingDisabled && focusDelay > 0) {
-                // Wait some time for the mouse before doing the switch. This serves as threshold
-                // to prevent the focus from jumping around to much while working with the mouse.
-                const int msecs = lastMouseEvent.msecsTo(lastFocusEvent);
-                acceptFocus = msecs > focusDelay;
-            }
-            if (acceptFocus) {
-                data.setXTranslation(- int(focusPoint.x() * (zoom - 1.0)));
-                data.setYTranslation(- int(focusPoint.y() * (zoom - 1.0)));
-                prevPoint = focusPoint;
-            }
+    // use the focusPoint if focus tracking is enabled
+    if (isFocusTrackingEnabled() || isTextCaretTrackingEnabled()) {
+        bool acceptFocus = true;
+        if (mouseTracking != MouseTrackingDisabled && focusDelay > 0) {
+            // Wait some time for the mouse before doing the switch. This serves as threshold
+            // to prevent the focus from jumping around to much while working with the mouse.
+            const int msecs = lastMouseEvent.msecsTo(lastFocusEvent);
+            acceptFocus = msecs > focusDelay;
         }
+        if (acceptFocus) {
+            m_translation.setX(- int(focusPoint.x() * (zoom - 1.0)));
+            m_translation.setY(- int(focusPoint.y() * (zoom - 1.0)));
+            prevPoint = focusPoint;
+        }
+    }
+}
+
+QRect ZoomEffect::cursorRect()
+{
+    if (mousePointer == MousePointerHide) {
+        return QRect();
+    }
+
+    // Draw the mouse-texture at the position matching to zoomed-in image of the desktop. Hiding the
+    // previous mouse-cursor and drawing our own fake mouse-cursor is needed to be able to scale the
+    // mouse-cursor up and to re-position those mouse-cursor to match to the chosen zoom-level.
+    const auto cursor = effects->cursorImage();
+    QSize cursorSize = cursor.image().size() / cursor.image().devicePixelRatio();
+    if (mousePointer == MousePointerScale) {
+        cursorSize *= zoom;
     }
 
+    const QPoint p = effects->cursorPos() - cursor.hotSpot();
+    return QRect(p * zoom + m_translation, cursorSize);
+}
+
+QRegion ZoomEffect::mapToZoomed(const QRegion &region) const
+{
+    const QRect screenGeometry = effects->virtualScreenGeometry();
+    QRegion zoomed;
+    for (const QRect &rect : region) {
+        const QRectF mapped(rect.x() * zoom + m_translation.x(), rect.y() * zoom + m_translation.y(),
+                            rect.width() * zoom, rect.height() * zoom);
+        zoomed += mapped.toAlignedRect() & screenGeometry;
+    }
+    return zoomed;
+}
+
+bool ZoomEffect::canUseOffscreenTexture() const
+{
+    // The texture holds what a single output shows, the other outputs would not be
+    // painted at all while nothing is damaged on them.
+    return effects->isOpenGLCompositing() && GLRenderTarget::supported()
+        && effects->screens().count() == 1;
+}
+
+bool ZoomEffect::ensureOffscreenTexture()
+{
+    const QSize textureSize = effects->virtualScreenSize() * GLRenderTarget::virtualScreenScale();
+    if (textureSize.isEmpty()) {
+        return false;
+    }
+    if (m_texture && m_texture->size() == textureSize) {
+        return true;
+    }
+
+    m_renderTarget.reset();
+    m_texture.reset(new GLTexture(GL_RGBA8, textureSize));
+    m_texture->setFilter(GL_LINEAR);
+    m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
+    m_texture->setYInverted(true);
+    m_renderTarget.reset(new GLRenderTarget(*m_texture));
+    m_textureValid = false;
+
+    if (!m_renderTarget->valid()) {
+        m_renderTarget.reset();
+        m_texture.reset();
+        return false;
+    }
+    return true;
+}
+
+void ZoomEffect::destroyOffscreenTexture()
+{
+    if (m_texture) {
+        effects->makeOpenGLContextCurrent();
+        m_renderTarget.reset();
+        m_texture.reset();
+    }
+    m_textureValid = false;
+}
+
+void ZoomEffect::paintOffscreenTexture(int mask, const QRegion &region, ScreenPaintData &data)
+{
+    GLRenderTarget::pushRenderTarget(m_renderTarget.data());
     effects->paintScreen(mask, region, data);
+    GLRenderTarget::popRenderTarget();
 
-    if (zoom != 1.0 && mousePointer != MousePointerHide) {
-        GLTexture *cursorTexture = ensureCursorTexture();
-        if (cursorTexture) {
-            const auto cursor = effects->cursorImage();
+    m_textureValid = true;
+    m_textureZoom = zoom;
+    m_textureTranslation = m_translation;
+
+    const QRect screenGeometry = effects->virtualScreenGeometry();
 
-            // Draw the mouse-texture at the position matching to zoomed-in image of the desktop. Hiding the
-            // previous mouse-cursor and drawing our own fake mouse-cursor is needed to be able to scale the
-            // mouse-cursor up and to re-position those mouse-cursor to match to the chosen zoom-level.
-            QSize cursorSize = cursor.image().size() / cursor.image().devicePixelRatio();
-            if (mousePointer == MousePointerScale) {
-                cursorSize *= zoom;
-            }
+    QMatrix4x4 mvp = data.projectionMatrix();
+    mvp.translate(m_translation.x(), m_translation.y());
+    mvp.scale(zoom, zoom);
+    mvp.translate(screenGeometry.x(), screenGeometry.y());
 
-            const QPoint p = effects->cursorPos() - cursor.hotSpot();
-            QRect rect(p * zoom + QPoint(data.xTranslation(), data.yTranslation()), cursorSize);
+    ShaderBinder binder(ShaderTrait::MapTexture);
+    binder.shader()->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
+    m_texture->bind();
+    m_texture->render(infiniteRegion(), QRect(QPoint(0, 0), screenGeometry.size()));
+    m_texture->unbind();
+}
+
+void ZoomEffect::paintScreen(int mask, const QRegion &region, ScreenPaintData& data)
+{
+    if (zoom == 1.0) {
+        effects->paintScreen(mask, region, data);
+        return;
+    }
 
+    if (m_useTexture) {
+        paintOffscreenTexture(mask, region, data);
+    } else {
+        data *= QVector2D(zoom, zoom);
+        data.setXTranslation(m_translation.x());
+        data.setYTranslation(m_translation.y());
+        effects->paintScreen(mask, region, data);
+    }
+
+    if (mousePointer != MousePointerHide && !m_cursorRect.isEmpty()) {
+        GLTexture *cursorTexture = ensureCursorTexture();
+        if (cursorTexture) {
+            const QRect rect = m_cursorRect;
             cursorTexture->bind();
             glEnable(GL_BLEND);
             glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -344,7 +491,7 @@ void ZoomEffect::paintScreen(int mask, const QRegion &region, ScreenPaintData& d
             QMatrix4x4 mvp = data.projectionMatrix();
             mvp.translate(rect.x(), rect.y());
             s->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
-            cursorTexture->render(region, rect);
+            cursorTexture->render(m_useTexture ? infiniteRegion() : region, rect);
             ShaderManager::instance()->popShader();
             cursorTexture->unbind();
             glDisable(GL_BLEND);
@@ -476,13 +623,20 @@ void ZoomEffect::slotMouseChanged(const QPoint& pos, const QPoint& old, Qt::Mous
     cursorPoint = pos;
     if (pos != old) {
         lastMouseEvent = QTime::currentTime();
-        effects->addRepaintFull();
+        if (canUseOffscreenTexture()) {
+            // Only schedule a frame, prePaintScreen() repaints the whole screen if the view moves
+            // and otherwise just the old and new cursor rects.
+            effects->addRepaint(QRect(pos, QSize(1, 1)));
+        } else {
+            effects->addRepaintFull();
+        }
     }
 }
 
 void ZoomEffect::slotWindowDamaged()
 {
-    if (zoom != 1.0) {
+    // The window damage is mapped to the zoomed view in prePaintWindow() with the offscreen texture.
+    if (zoom != 1.0 && !canUseOffscreenTexture()) {
         effects->addRepaintFull();
     }
 }
@@ -24,6 +24,7 @@ namespace KWin
 class ZoomAccessibilityIntegration;
 #endif
 
+class GLRenderTarget;
 class GLTexture;
 
 class ZoomEffect
@@ -45,6 +46,7 @@ public:
     void prePaintScreen(ScreenPrePaintData& data, std::chrono::milliseconds presentTime) override;
     void paintScreen(int mask, const QRegion &region, ScreenPaintData& data) override;
     void postPaintScreen() override;
+    void prePaintWindow(EffectWindow *w, WindowPrePaintData &data, std::chrono::milliseconds presentTime) override;
     bool isActive() const override;
     // for properties
     qreal configuredZoomFactor() const {
@@ -91,6 +93,13 @@ private:
 private:
     GLTexture *ensureCursorTexture();
     void markCursorTextureDirty();
+    void updateTranslation();
+    QRect cursorRect();
+    QRegion mapToZoomed(const QRegion &region) const;
+    bool canUseOffscreenTexture() const;
+    bool ensureOffscreenTexture();
+    void destroyOffscreenTexture();
+    void paintOffscreenTexture(int mask, const QRegion &region, ScreenPaintData &data);
 
 #if HAVE_ACCESSIBILITY
     ZoomAccessibilityIntegration *m_accessibilityIntegration = nullptr;
@@ -100,6 +109,7 @@ private:
     double source_zoom;
     bool polling; // Mouse polling
     double zoomFactor;
+    double zoomDuration;
     enum MouseTrackingType {
         MouseTrackingProportional = 0,
         MouseTrackingCentred = 1,
@@ -126,6 +136,17 @@ private:
     int xMove, yMove;
     double moveFactor;
     std::chrono::milliseconds lastPresentTime;
+    QPoint m_translation;
+    QRect m_cursorRect;
+    // The unzoomed scene, only repainted where it is damaged while the view stays still.
+    QScopedPointer<GLTexture> m_texture;
+    QScopedPointer<GLRenderTarget> m_renderTarget;
+    bool m_useTexture = false;
+    bool m_textureValid = false;
+    bool m_mapWindowDamage = false;
+    double m_textureZoom = 1.0;
+    QPoint m_textureTranslation;
+    QRegion m_screenDamage;
 };
 
 } // namespace
@@ -156,8 +156,28 @@ bool Workspace::workspaceEvent(xcb_generic_event_t *e)
     // events that should be handled before Clients can get them
     switch (eventType) {
     case XCB_CONFIGURE_NOTIFY:
-        if (reinterpret_cast<xcb_configure_notify_event_t*>(e)->event == rootWindow())
+        if (reinterpret_cast<xcb_configure_notify_event_t*>(e)->event == rootWindow()) {
+            updateRootStacking(e);
             markXStackingOrderAsDirty();
+        }
+        break;
+    case XCB_CREATE_NOTIFY:
+        if (reinterpret_cast<xcb_create_notify_event_t*>(e)->parent == rootWindow())
+            updateRootStacking(e);
+        break;
+    case XCB_DESTROY_NOTIFY:
+        if (reinterpret_cast<xcb_destroy_notify_event_t*>(e)->event == rootWindow())
+            updateRootStacking(e);
+        break;
+    case XCB_REPARENT_NOTIFY:
+        if (reinterpret_cast<xcb_reparent_notify_event_t*>(e)->event == rootWindow())
+            updateRootStacking(e);
+        break;
+    case XCB_CIRCULATE_NOTIFY:
+        if (reinterpret_cast<xcb_circulate_notify_event_t*>(e)->event == rootWindow()) {
+            updateRootStacking(e);
+            markXStackingOrderAsDirty();
+        }
         break;
     };
 
@@ -483,7 +503,7 @@ bool X11Client::windowEvent(xcb_generic_event_t *e)
             updateShape();
         }
         if (eventType == Xcb::Extensions::self()->damageNotifyEvent() && reinterpret_cast<xcb_damage_notify_event_t*>(e)->drawable == frameId())
-            damageNotifyEvent();
+            damageNotifyEvent(reinterpret_cast<xcb_damage_notify_event_t*>(e));
         break;
     }
     return true; // eat all events
@@ -1048,7 +1068,7 @@ bool X11Client::motionNotifyEvent(xcb_window_t w, int state, int x, int y, int x
 
     handleInteractiveMoveResize(QPoint(x, y), QPoint(x_root, y_root));
     if (isInteractiveMove()) {
-        ScreenEdges::self()->check(QPoint(x_root, y_root), QDateTime::fromMSecsSinceEpoch(xTime(), Qt::UTC));
+        ScreenEdges::self()->check(QPoint(x_root, y_root), std::chrono::milliseconds(xTime()));
     }
 
     return true;
@@ -1243,7 +1263,7 @@ bool Unmanaged::windowEvent(xcb_generic_event_t *e)
             Q_EMIT geometryShapeChanged(this, frameGeometry());
         }
         if (eventType == Xcb::Extensions::self()->damageNotifyEvent())
-            damageNotifyEvent();
+            damageNotifyEvent(reinterpret_cast<xcb_damage_notify_event_t*>(e));
         break;
     }
     }
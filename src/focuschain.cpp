@@ -15,6 +15,105 @@ namespace KWin
 
 KWIN_SINGLETON_FACTORY_VARIABLE(FocusChain, s_manager)
 
+FocusChain::Chain::Chain(const Chain &other)
+    : m_clients(other.m_clients)
+{
+    rebuildIndex();
+}
+
+FocusChain::Chain &FocusChain::Chain::operator=(const Chain &other)
+{
+    if (this != &other) {
+        m_clients = other.m_clients;
+        rebuildIndex();
+    }
+    return *this;
+}
+
+void FocusChain::Chain::rebuildIndex()
+{
+    m_index.clear();
+    m_index.reserve(m_clients.size());
+    for (auto it = m_clients.begin(); it != m_clients.end(); ++it) {
+        m_index.insert(*it, it);
+    }
+}
+
+bool FocusChain::Chain::isEmpty() const
+{
+    return m_clients.empty();
+}
+
+bool FocusChain::Chain::contains(AbstractClient *client) const
+{
+    return m_index.contains(client);
+}
+
+AbstractClient *FocusChain::Chain::first() const
+{
+    return m_clients.empty() ? nullptr : m_clients.front();
+}
+
+AbstractClient *FocusChain::Chain::last() const
+{
+    return m_clients.empty() ? nullptr : m_clients.back();
+}
+
+AbstractClient *FocusChain::Chain::previous(AbstractClient *client) const
+{
+    const auto it = m_index.constFind(client);
+    if (it == m_index.constEnd() || *it == m_clients.begin()) {
+        return nullptr;
+    }
+    return *std::prev(*it);
+}
+
+const FocusChain::Chain::List &FocusChain::Chain::clients() const
+{
+    return m_clients;
+}
+
+void FocusChain::Chain::remove(AbstractClient *client)
+{
+    const auto it = m_index.find(client);
+    if (it != m_index.end()) {
+        m_clients.erase(*it);
+        m_index.erase(it);
+    }
+}
+
+void FocusChain::Chain::append(AbstractClient *client)
+{
+    insertBefore(client, m_clients.cend());
+}
+
+void FocusChain::Chain::prepend(AbstractClient *client)
+{
+    insertBefore(client, m_clients.cbegin());
+}
+
+void FocusChain::Chain::insertBefore(AbstractClient *client, List::const_iterator position)
+{
+    const auto it = m_index.constFind(client);
+    if (it != m_index.constEnd()) {
+        m_clients.splice(position, m_clients, *it);
+    } else {
+        m_index.insert(client, m_clients.insert(position, client));
+    }
+}
+
+void FocusChain::Chain::insertBefore(AbstractClient *client, AbstractClient *reference)
+{
+    Q_ASSERT(m_index.contains(reference));
+    insertBefore(client, List::const_iterator(m_index.value(reference)));
+}
+
+void FocusChain::Chain::insertAfter(AbstractClient *client, AbstractClient *reference)
+{
+    Q_ASSERT(m_index.contains(reference));
+    insertBefore(client, List::const_iterator(std::next(m_index.value(reference))));
+}
+
 FocusChain::FocusChain(QObject *parent)
     : QObject(parent)
     , m_separateScreenFocus(false)
@@ -32,9 +131,9 @@ void FocusChain::remove(AbstractClient *client)
     for (auto it = m_desktopFocusChains.begin();
             it != m_desktopFocusChains.end();
             ++it) {
-        it.value().removeAll(client);
+        it.value().remove(client);
     }
-    m_mostRecentlyUsed.removeAll(client);
+    m_mostRecentlyUsed.remove(client);
 }
 
 void FocusChain::addDesktop(VirtualDesktop *desktop)
@@ -61,9 +160,9 @@ AbstractClient *FocusChain::getForActivation(VirtualDesktop *desktop, AbstractOu
     if (it == m_desktopFocusChains.constEnd()) {
         return nullptr;
     }
-    const auto &chain = it.value();
-    for (int i = chain.size() - 1; i >= 0; --i) {
-        auto tmp = chain.at(i);
+    const auto &chain = it.value().clients();
+    for (auto i = chain.crbegin(); i != chain.crend(); ++i) {
+        auto tmp = *i;
         // TODO: move the check into Client
         if (!tmp->isShade() && tmp->isShown() && tmp->isOnCurrentActivity()
             && ( !m_separateScreenFocus || tmp->output() == output)) {
@@ -108,7 +207,7 @@ void FocusChain::update(AbstractClient *client, FocusChain::Change change)
             if (client->isOnDesktop(it.key())) {
                 updateClientInChain(client, change, chain);
             } else {
-                chain.removeAll(client);
+                chain.remove(client);
             }
         }
     }
@@ -134,9 +233,9 @@ void FocusChain::insertClientIntoChain(AbstractClient *client, Chain &chain)
         return;
     }
     if (m_activeClient && m_activeClient != client &&
-            !chain.empty() && chain.last() == m_activeClient) {
+            !chain.isEmpty() && chain.last() == m_activeClient) {
         // Add it after the active client
-        chain.insert(chain.size() - 1, client);
+        chain.insertBefore(client, m_activeClient);
     } else {
         // Otherwise add as the first one
         chain.append(client);
@@ -165,25 +264,25 @@ void FocusChain::moveAfterClientInChain(AbstractClient *client, AbstractClient *
     if (!chain.contains(reference)) {
         return;
     }
+    if (reference == client) {
+        return;
+    }
     if (AbstractClient::belongToSameApplication(reference, client)) {
-        chain.removeAll(client);
-        chain.insert(chain.indexOf(reference), client);
+        chain.insertBefore(client, reference);
     } else {
-        chain.removeAll(client);
-        for (int i = chain.size() - 1; i >= 0; --i) {
-            if (AbstractClient::belongToSameApplication(reference, chain.at(i))) {
-                chain.insert(i, client);
-                break;
+        const auto &clients = chain.clients();
+        for (auto it = clients.crbegin(); it != clients.crend(); ++it) {
+            if (*it != client && AbstractClient::belongToSameApplication(reference, *it)) {
+                chain.insertBefore(client, *it);
+                return;
             }
         }
+        chain.remove(client);
     }
 }
 
 AbstractClient *FocusChain::firstMostRecentlyUsed() const
 {
-    if (m_mostRecentlyUsed.isEmpty()) {
-        return nullptr;
-    }
     return m_mostRecentlyUsed.first();
 }
 
@@ -192,14 +291,13 @@ AbstractClient *FocusChain::nextMostRecentlyUsed(AbstractClient *reference) cons
     if (m_mostRecentlyUsed.isEmpty()) {
         return nullptr;
     }
-    const int index = m_mostRecentlyUsed.indexOf(reference);
-    if (index == -1) {
+    if (!m_mostRecentlyUsed.contains(reference)) {
         return m_mostRecentlyUsed.first();
     }
-    if (index == 0) {
+    if (reference == m_mostRecentlyUsed.first()) {
         return m_mostRecentlyUsed.last();
     }
-    return m_mostRecentlyUsed.at(index - 1);
+    return m_mostRecentlyUsed.previous(reference);
 }
 
 // copied from activation.cpp
@@ -216,9 +314,9 @@ AbstractClient *FocusChain::nextForDesktop(AbstractClient *reference, VirtualDes
     if (it == m_desktopFocusChains.constEnd()) {
         return nullptr;
     }
-    const auto &chain = it.value();
-    for (int i = chain.size() - 1; i >= 0; --i) {
-        auto client = chain.at(i);
+    const auto &chain = it.value().clients();
+    for (auto i = chain.crbegin(); i != chain.crend(); ++i) {
+        auto client = *i;
         if (isUsableFocusCandidate(client, reference)) {
             return client;
         }
@@ -228,12 +326,12 @@ AbstractClient *FocusChain::nextForDesktop(AbstractClient *reference, VirtualDes
 
 void FocusChain::makeFirstInChain(AbstractClient *client, Chain &chain)
 {
-    chain.removeAll(client);
     if (options->moveMinimizedWindowsToEndOfTabBoxFocusChain()) {
         if (client->isMinimized()) { // add it before the first minimized ...
-            for (int i = chain.count()-1; i >= 0; --i) {
-                if (chain.at(i)->isMinimized()) {
-                    chain.insert(i+1, client);
+            const auto &clients = chain.clients();
+            for (auto it = clients.crbegin(); it != clients.crend(); ++it) {
+                if (*it != client && (*it)->isMinimized()) {
+                    chain.insertAfter(client, *it);
                     return;
                 }
             }
@@ -248,7 +346,6 @@ void FocusChain::makeFirstInChain(AbstractClient *client, Chain &chain)
 
 void FocusChain::makeLastInChain(AbstractClient *client, Chain &chain)
 {
-    chain.removeAll(client);
     chain.prepend(client);
 }
 
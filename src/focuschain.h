@@ -13,6 +13,8 @@
 // Qt
 #include <QObject>
 #include <QHash>
+// std
+#include <list>
 
 namespace KWin
 {
@@ -173,7 +175,53 @@ public Q_SLOTS:
     void removeDesktop(VirtualDesktop *desktop);
 
 private:
-    using Chain = QList<AbstractClient*>;
+    /**
+     * @brief A focus chain, the last item is the most recently used one.
+     *
+     * The clients are kept in a linked list with an index from client to list node, so
+     * looking up, removing and moving a client cost O(1). Moving a client that is already
+     * in the chain relinks its node and doesn't allocate.
+     */
+    class Chain
+    {
+    public:
+        using List = std::list<AbstractClient *>;
+        Chain() = default;
+        Chain(const Chain &other);
+        Chain &operator=(const Chain &other);
+
+        bool isEmpty() const;
+        bool contains(AbstractClient *client) const;
+        AbstractClient *first() const;
+        AbstractClient *last() const;
+        /**
+         * Returns the client before @p client, @c null if @p client is the first one or not
+         * in the chain.
+         */
+        AbstractClient *previous(AbstractClient *client) const;
+        const List &clients() const;
+
+        void remove(AbstractClient *client);
+        void append(AbstractClient *client);
+        void prepend(AbstractClient *client);
+        /**
+         * Moves or inserts @p client right before @p position.
+         */
+        void insertBefore(AbstractClient *client, List::const_iterator position);
+        /**
+         * Moves or inserts @p client right before @p reference, which must be in the chain.
+         */
+        void insertBefore(AbstractClient *client, AbstractClient *reference);
+        /**
+         * Moves or inserts @p client right after @p reference, which must be in the chain.
+         */
+        void insertAfter(AbstractClient *client, AbstractClient *reference);
+
+    private:
+        void rebuildIndex();
+        List m_clients;
+        QHash<AbstractClient *, List::iterator> m_index;
+    };
     /**
      * @brief Makes @p client the first Client in the given focus @p chain.
      *
@@ -15,8 +15,18 @@
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QCoreApplication>
 #include <QScopeGuard>
 #include <QTextStream>
+#include <QThread>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 namespace KWin
 {
@@ -25,6 +35,9 @@ KWIN_SINGLETON_FACTORY(KWin::FTraceLogger)
 FTraceLogger::FTraceLogger(QObject *parent)
     : QObject(parent)
 {
+    if (qEnvironmentVariableIsSet("KWIN_PERF_TRACE_FILE")) {
+        startRecording(qEnvironmentVariable("KWIN_PERF_TRACE_FILE"));
+    }
     if (qEnvironmentVariableIsSet("KWIN_PERF_FTRACE")) {
         setEnabled(true);
     } else {
@@ -32,9 +45,17 @@ FTraceLogger::FTraceLogger(QObject *parent)
     }
 }
 
-bool FTraceLogger::isEnabled() const
+FTraceLogger::~FTraceLogger()
 {
-    return m_file.isOpen();
+    const int fd = m_fd.exchange(-1);
+    if (fd != -1) {
+        close(fd);
+    }
+    const int recordingFd = m_recordingFd.exchange(-1);
+    if (recordingFd != -1) {
+        close(recordingFd);
+    }
+    s_self = nullptr;
 }
 
 void FTraceLogger::setEnabled(bool enabled)
@@ -45,10 +66,11 @@ void FTraceLogger::setEnabled(bool enabled)
     }
 
     if (enabled) {
-        open();
-    } else {
-        m_file.close();
+        if (m_fd == -1 && !open()) {
+            return;
+        }
     }
+    m_enabled = enabled;
     Q_EMIT enabledChanged();
 }
 
@@ -59,13 +81,40 @@ bool FTraceLogger::open()
         return false;
     }
 
-    m_file.setFileName(path);
-    if (!m_file.open(QIODevice::WriteOnly)) {
+    const int fd = ::open(QFile::encodeName(path).constData(), O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (fd == -1) {
         qWarning() << "No access to trace marker file at:" << path;
+        return false;
     }
+    m_fd = fd;
     return true;
 }
 
+FTraceBuffer &FTraceLogger::threadBuffer()
+{
+    thread_local FTraceBuffer buffer;
+    return buffer;
+}
+
+void FTraceLogger::write(const FTraceBuffer &buffer)
+{
+    const int fd = m_fd.load(std::memory_order_relaxed);
+    if (fd == -1) {
+        return;
+    }
+    // A truncated marker still has to end with a new line.
+    if (buffer.size() == FTraceBuffer::Capacity) {
+        char data[FTraceBuffer::Capacity];
+        memcpy(data, buffer.data(), FTraceBuffer::Capacity - 1);
+        data[FTraceBuffer::Capacity - 1] = '\n';
+        const ssize_t written = ::write(fd, data, FTraceBuffer::Capacity);
+        Q_UNUSED(written)
+    } else {
+        const ssize_t written = ::write(fd, buffer.data(), buffer.size());
+        Q_UNUSED(written)
+    }
+}
+
 QString FTraceLogger::filePath()
 {
     if (qEnvironmentVariableIsSet("KWIN_PERF_FTRACE_FILE")) {
@@ -113,6 +162,317 @@ QString FTraceLogger::filePath()
     return markerFileInfo.absoluteFilePath();
 }
 
+void FTraceLogger::startRecording(const QString &fileName)
+{
+    QMutexLocker lock(&m_mutex);
+    if (isRecording()) {
+        return;
+    }
+
+    const int fd = ::open(QFile::encodeName(fileName).constData(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        qWarning() << "Failed to open trace file at:" << fileName;
+        return;
+    }
+    // Events are written in the JSON array format, the closing bracket is optional.
+    const ssize_t written = ::write(fd, "[\n", 2);
+    Q_UNUSED(written)
+
+    if (m_recordingFd == -1) {
+        m_recordingFd = fd;
+    } else {
+        dup2(fd, m_recordingFd);
+        close(fd);
+    }
+    m_recordingSerial++;
+    m_recording = true;
+    Q_EMIT recordingChanged();
+}
+
+void FTraceLogger::stopRecording()
+{
+    QMutexLocker lock(&m_mutex);
+    if (!isRecording()) {
+        return;
+    }
+
+    m_recording = false;
+
+    // Threads that have checked isRecording() before it changed may still write an event,
+    // they write it to /dev/null rather than to a closed or reused descriptor.
+    const int null = ::open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if (null != -1) {
+        dup2(null, m_recordingFd);
+        close(null);
+    }
+    Q_EMIT recordingChanged();
+}
+
+static qint64 timestamp()
+{
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+}
+
+static int threadId()
+{
+    thread_local const int tid = syscall(SYS_gettid);
+    return tid;
+}
+
+// Leaves room for closing the event after the string has been written.
+static const int s_eventReserve = 8;
+
+static void appendJsonString(FTraceBuffer &buffer, QStringView string)
+{
+    buffer << '"';
+    for (int i = 0; i < string.size(); ++i) {
+        const QChar c = string[i];
+        int length = 1;
+        if (c.isHighSurrogate() && i + 1 < string.size() && string[i + 1].isLowSurrogate()) {
+            length = 2;
+        }
+        if (buffer.available() < s_eventReserve + 4) {
+            break;
+        }
+        if (c == QLatin1Char('"') || c == QLatin1Char('\\')) {
+            buffer << '\\';
+        } else if (c.unicode() < 0x20) {
+            continue;
+        }
+        buffer << string.mid(i, length);
+        i += length - 1;
+    }
+    buffer << '"';
+}
+
+static void appendJsonString(FTraceBuffer &buffer, const char *string)
+{
+    buffer << '"';
+    for (const char *c = string; *c; ++c) {
+        if (buffer.available() < s_eventReserve + 2) {
+            break;
+        }
+        if (*c == '"' || *c == '\\') {
+            buffer << '\\';
+        } else if (uchar(*c) < 0x20) {
+            continue;
+        }
+        buffer << *c;
+    }
+    buffer << '"';
+}
+
+static void beginEvent(FTraceBuffer &buffer, const char *name, char phase)
+{
+    static const qint64 pid = QCoreApplication::applicationPid();
+    buffer.clear();
+    buffer << "{\"name\":";
+    appendJsonString(buffer, name);
+    buffer << ",\"ph\":\"" << phase << "\",\"ts\":" << timestamp() << ",\"pid\":" << pid << ",\"tid\":" << threadId();
+}
+
+static void appendId(FTraceBuffer &buffer, quintptr id)
+{
+    // Pointers don't fit in a JSON number without losing precision.
+    char hex[2 * sizeof(quintptr) + 1];
+    const std::to_chars_result result = std::to_chars(hex, hex + sizeof(hex) - 1, id, 16);
+    *result.ptr = '\0';
+    buffer << ",\"cat\":\"kwin\",\"id\":\"0x" << hex << '"';
+}
+
+template<typename Detail>
+static void endEvent(FTraceBuffer &buffer, const Detail &detail)
+{
+    if constexpr (std::is_same_v<Detail, QStringView>) {
+        if (!detail.isEmpty()) {
+            buffer << ",\"args\":{\"detail\":";
+            appendJsonString(buffer, detail);
+            buffer << '}';
+        }
+    } else {
+        if (detail && *detail) {
+            buffer << ",\"args\":{\"detail\":";
+            appendJsonString(buffer, detail);
+            buffer << '}';
+        }
+    }
+    buffer << "},\n";
+}
+
+void FTraceLogger::record(FTraceBuffer &event)
+{
+    const int fd = m_recordingFd.load(std::memory_order_relaxed);
+    if (fd == -1) {
+        return;
+    }
+
+    // Name the thread once in every recording, so it can be told apart in the viewer.
+    thread_local int serial = 0;
+    const int recordingSerial = m_recordingSerial.load(std::memory_order_relaxed);
+    if (serial != recordingSerial) {
+        serial = recordingSerial;
+
+        QString threadName;
+        if (qApp && QThread::currentThread() == qApp->thread()) {
+            threadName = QStringLiteral("main");
+        } else {
+            threadName = QThread::currentThread()->objectName();
+        }
+        FTraceBuffer metadata;
+        beginEvent(metadata, "thread_name", 'M');
+        metadata << ",\"args\":{\"name\":";
+        appendJsonString(metadata, threadName);
+        metadata << "}},\n";
+        const ssize_t written = ::write(fd, metadata.data(), metadata.size());
+        Q_UNUSED(written)
+    }
+
+    const ssize_t written = ::write(fd, event.data(), event.size());
+    Q_UNUSED(written)
+}
+
+void FTraceLogger::beginSlice(const char *name, QStringView detail)
+{
+    FTraceBuffer &buffer = threadBuffer();
+    beginEvent(buffer, name, 'B');
+    endEvent(buffer, detail);
+    record(buffer);
+}
+
+void FTraceLogger::beginSlice(const char *name, const char *detail)
+{
+    FTraceBuffer &buffer = threadBuffer();
+    beginEvent(buffer, name, 'B');
+    endEvent(buffer, detail);
+    record(buffer);
+}
+
+void FTraceLogger::endSlice()
+{
+    FTraceBuffer &buffer = threadBuffer();
+    beginEvent(buffer, "", 'E');
+    endEvent(buffer, QStringView());
+    record(buffer);
+}
+
+void FTraceLogger::beginAsyncSlice(const char *name, quintptr id, QStringView detail)
+{
+    FTraceBuffer &buffer = threadBuffer();
+    beginEvent(buffer, name, 'b');
+    appendId(buffer, id);
+    endEvent(buffer, detail);
+    record(buffer);
+}
+
+void FTraceLogger::endAsyncSlice(const char *name, quintptr id)
+{
+    FTraceBuffer &buffer = threadBuffer();
+    beginEvent(buffer, name, 'e');
+    appendId(buffer, id);
+    endEvent(buffer, QStringView());
+    record(buffer);
+}
+
+void FTraceLogger::instant(const char *name, QStringView detail)
+{
+    FTraceBuffer &buffer = threadBuffer();
+    beginEvent(buffer, name, 'i');
+    buffer << ",\"s\":\"t\"";
+    endEvent(buffer, detail);
+    record(buffer);
+}
+
+void FTraceLogger::counter(const char *name, qint64 value)
+{
+    FTraceBuffer &buffer = threadBuffer();
+    beginEvent(buffer, name, 'C');
+    buffer << ",\"args\":{\"value\":" << value << '}';
+    endEvent(buffer, QStringView());
+    record(buffer);
+}
+
+void FTraceBuffer::append(const char *data, int size)
+{
+    const int count = std::min(size, Capacity - m_size);
+    memcpy(m_data + m_size, data, count);
+    m_size += count;
+}
+
+FTraceBuffer &FTraceBuffer::operator<<(char c)
+{
+    append(&c, 1);
+    return *this;
+}
+
+FTraceBuffer &FTraceBuffer::operator<<(const char *string)
+{
+    append(string, strlen(string));
+    return *this;
+}
+
+FTraceBuffer &FTraceBuffer::operator<<(const QByteArray &string)
+{
+    append(string.constData(), string.size());
+    return *this;
+}
+
+FTraceBuffer &FTraceBuffer::operator<<(const FTraceBuffer &buffer)
+{
+    append(buffer.data(), buffer.size());
+    return *this;
+}
+
+FTraceBuffer &FTraceBuffer::operator<<(QStringView string)
+{
+    // Encode as UTF-8 in place, QString::toUtf8() would allocate.
+    for (int i = 0; i < string.size(); ++i) {
+        char32_t code = string[i].unicode();
+        if (QChar::isHighSurrogate(code) && i + 1 < string.size() && string[i + 1].isLowSurrogate()) {
+            code = QChar::surrogateToUcs4(code, string[++i].unicode());
+        }
+
+        char encoded[4];
+        int length;
+        if (code < 0x80) {
+            encoded[0] = code;
+            length = 1;
+        } else if (code < 0x800) {
+            encoded[0] = 0xc0 | (code >> 6);
+            encoded[1] = 0x80 | (code & 0x3f);
+            length = 2;
+        } else if (code < 0x10000) {
+            encoded[0] = 0xe0 | (code >> 12);
+            encoded[1] = 0x80 | ((code >> 6) & 0x3f);
+            encoded[2] = 0x80 | (code & 0x3f);
+            length = 3;
+        } else {
+            encoded[0] = 0xf0 | (code >> 18);
+            encoded[1] = 0x80 | ((code >> 12) & 0x3f);
+            encoded[2] = 0x80 | ((code >> 6) & 0x3f);
+            encoded[3] = 0x80 | (code & 0x3f);
+            length = 4;
+        }
+        if (m_size + length > Capacity) {
+            break;
+        }
+        append(encoded, length);
+    }
+    return *this;
+}
+
+FTraceBuffer &FTraceBuffer::operator<<(double value)
+{
+    char data[32];
+    const int length = snprintf(data, sizeof(data), "%g", value);
+    if (length > 0) {
+        append(data, std::min<int>(length, sizeof(data) - 1));
+    }
+    return *this;
+}
+
+std::atomic<quint32> FTraceDuration::s_context = 0;
+
 FTraceDuration::~FTraceDuration()
 {
     FTraceLogger::self()->trace(m_message, " end_ctx=", m_context);
@@ -11,14 +11,73 @@
 
 #include <kwinglobals.h>
 
-#include <QFile>
+#include <QByteArray>
 #include <QMutex>
-#include <QMutexLocker>
 #include <QObject>
-#include <QTextStream>
+#include <QString>
+
+#include <atomic>
+#include <charconv>
+#include <optional>
+#include <type_traits>
 
 namespace KWin
 {
+
+/**
+ * The FTraceBuffer class formats a trace marker in a fixed size buffer, without allocating
+ * memory. Messages that don't fit in the buffer are truncated.
+ */
+class KWIN_EXPORT FTraceBuffer
+{
+public:
+    static constexpr int Capacity = 256;
+
+    const char *data() const
+    {
+        return m_data;
+    }
+    int size() const
+    {
+        return m_size;
+    }
+    int available() const
+    {
+        return Capacity - m_size;
+    }
+    void clear()
+    {
+        m_size = 0;
+    }
+
+    FTraceBuffer &operator<<(char c);
+    FTraceBuffer &operator<<(const char *string);
+    FTraceBuffer &operator<<(const QByteArray &string);
+    FTraceBuffer &operator<<(QStringView string);
+    FTraceBuffer &operator<<(const QString &string)
+    {
+        return *this << QStringView(string);
+    }
+    FTraceBuffer &operator<<(const FTraceBuffer &buffer);
+    FTraceBuffer &operator<<(double value);
+
+    template<typename T, typename std::enable_if_t<std::is_integral_v<T>, int> = 0>
+    FTraceBuffer &operator<<(T value)
+    {
+        const std::to_chars_result result = std::to_chars(m_data + m_size, m_data + Capacity, value);
+        if (result.ec == std::errc()) {
+            m_size = result.ptr - m_data;
+        }
+        return *this;
+    }
+
+private:
+    void append(const char *data, int size);
+
+    char m_data[Capacity];
+    int m_size = 0;
+};
+
 /**
  * FTraceLogger is a singleton utility for writing log messages using ftrace
  *
@@ -26,44 +85,115 @@ namespace KWin
  *  Set the KWIN_PERF_FTRACE environment variable before starting the application
  *  Calling on DBus /FTrace org.kde.kwin.FTrace.setEnabled true
  * After having created the ftrace mount
+ *
+ * Messages are formatted in a preallocated buffer of the calling thread and written to
+ * the trace marker with a single write() call, so tracing doesn't take any locks.
+ *
+ * Independently of ftrace, slices, instant events and counters can be recorded in a file
+ * in the Chrome JSON trace format, which can be opened with Perfetto or chrome://tracing.
+ * Recording is started either by setting the KWIN_PERF_TRACE_FILE environment variable to
+ * the path of the trace file, or by calling startRecording() on the FTrace DBus interface.
  */
 class KWIN_EXPORT FTraceLogger : public QObject
 {
     Q_OBJECT
     Q_CLASSINFO("D-Bus Interface", "org.kde.kwin.FTrace");
     Q_PROPERTY(bool isEnabled READ isEnabled NOTIFY enabledChanged)
+    Q_PROPERTY(bool isRecording READ isRecording NOTIFY recordingChanged)
 
 public:
+    ~FTraceLogger() override;
+
     /**
      * Enabled through DBus and logging has started
      */
-    bool isEnabled() const;
+    bool isEnabled() const
+    {
+        return m_enabled.load(std::memory_order_relaxed);
+    }
 
     /**
      * Main log function
-     * Takes any number of arguments that can be written into QTextStream
+     * Takes any number of arguments that can be written into an FTraceBuffer
      */
-    template<typename... Args> void trace(Args... args)
+    template<typename... Args> void trace(const Args &...args)
     {
         Q_ASSERT(isEnabled());
-        QMutexLocker lock(&m_mutex);
-        if (!m_file.isOpen()) {
-            return;
-        }
-        QTextStream stream(&m_file);
-        (stream << ... << args) << Qt::endl;
+        FTraceBuffer &buffer = threadBuffer();
+        buffer.clear();
+        (buffer << ... << args) << '\n';
+        write(buffer);
     }
 
+    /**
+     * Writes the marker in the @a buffer, which must be terminated with a new line.
+     */
+    void write(const FTraceBuffer &buffer);
+
+    /**
+     * Returns the buffer that the calling thread formats its trace markers in.
+     */
+    static FTraceBuffer &threadBuffer();
+
+    /**
+     * Returns @c true if trace events are recorded in a Chrome trace file.
+     */
+    bool isRecording() const
+    {
+        return m_recording.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Begins a slice with the given @a name on the calling thread. The @a name must be a
+     * string literal or live as long as the logger.
+     */
+    void beginSlice(const char *name, QStringView detail = QStringView());
+    void beginSlice(const char *name, const char *detail);
+    /**
+     * Ends the slice that has been begun last on the calling thread.
+     */
+    void endSlice();
+    /**
+     * Begins a slice that may end on another thread or after other slices have ended, such
+     * as a frame that is waiting to be presented. Slices with the same @a name are told
+     * apart by their @a id.
+     */
+    void beginAsyncSlice(const char *name, quintptr id, QStringView detail = QStringView());
+    void endAsyncSlice(const char *name, quintptr id);
+    /**
+     * Records an event without duration, e.g. a page flip.
+     */
+    void instant(const char *name, QStringView detail = QStringView());
+    /**
+     * Records the current @a value of the counter with the given @a name.
+     */
+    void counter(const char *name, qint64 value);
+
 Q_SIGNALS:
     void enabledChanged();
+    void recordingChanged();
 
 public Q_SLOTS:
     Q_SCRIPTABLE void setEnabled(bool enabled);
+    /**
+     * Starts recording trace events in the Chrome trace file at @a fileName. The file is
+     * replaced if it exists already.
+     */
+    Q_SCRIPTABLE void startRecording(const QString &fileName);
+    Q_SCRIPTABLE void stopRecording();
 
 private:
     static QString filePath();
     bool open();
-    QFile m_file;
+    void record(FTraceBuffer &event);
+    // The file is kept open once it has been opened, so threads that are still writing
+    // a marker while tracing gets disabled never use a closed file descriptor.
+    std::atomic<int> m_fd = -1;
+    std::atomic<bool> m_enabled = false;
+    // Same as above, the descriptor of a stopped recording refers to /dev/null.
+    std::atomic<int> m_recordingFd = -1;
+    std::atomic<bool> m_recording = false;
+    std::atomic<int> m_recordingSerial = 0;
     QMutex m_mutex;
     KWIN_SINGLETON(FTraceLogger)
 };
@@ -71,23 +201,50 @@ private:
 class KWIN_EXPORT FTraceDuration
 {
 public:
-    template<typename... Args> FTraceDuration(Args... args)
+    template<typename... Args> FTraceDuration(const Args &...args)
+        : m_context(++s_context)
     {
-        static QAtomicInteger<quint32> s_context = 0;
-        QTextStream stream(&m_message);
-        (stream << ... << args);
-        stream.flush();
-        m_context = ++s_context;
+        (m_message << ... << args);
         FTraceLogger::self()->trace(m_message, " begin_ctx=", m_context);
     }
 
     ~FTraceDuration();
 
 private:
-    QByteArray m_message;
+    static std::atomic<quint32> s_context;
+    FTraceBuffer m_message;
     quint32 m_context;
 };
 
+/**
+ * The FTraceSlice class records a slice that lasts as long as the object, if trace events
+ * are being recorded.
+ */
+class KWIN_EXPORT FTraceSlice
+{
+public:
+    template<typename Detail = QStringView>
+    explicit FTraceSlice(const char *name, const Detail &detail = Detail())
+    {
+        FTraceLogger *logger = FTraceLogger::self();
+        if (logger && logger->isRecording()) {
+            logger->beginSlice(name, detail);
+            m_logger = logger;
+        }
+    }
+
+    ~FTraceSlice()
+    {
+        if (m_logger) {
+            m_logger->endSlice();
+        }
+    }
+
+private:
+    Q_DISABLE_COPY(FTraceSlice)
+    FTraceLogger *m_logger = nullptr;
+};
+
 } // namespace KWin
 
 /**
@@ -102,4 +259,24 @@ private:
  * In GPUVis this will appear as a timed block with begin_ctx and end_ctx markers
  */
 #define fTraceDuration(...)                                                                                                                                    \
-    QScopedPointer<KWin::FTraceDuration> _duration(KWin::FTraceLogger::self()->isEnabled() ? new KWin::FTraceDuration(__VA_ARGS__) : nullptr);
+    std::optional<KWin::FTraceDuration> _duration = KWin::FTraceLogger::self()->isEnabled() ? std::optional<KWin::FTraceDuration>(std::in_place, __VA_ARGS__) : std::nullopt;
+
+/**
+ * Records a slice from the point of the call to the end of the enclosing block. The name must
+ * be a string literal, an optional second argument describes the slice further.
+ */
+#define fTraceSlice(...) KWin::FTraceSlice _slice(__VA_ARGS__);
+
+/**
+ * Records an instant event. The arguments are only evaluated if trace events are recorded.
+ */
+#define fTraceInstant(...)                                                                                                                                     \
+    if (KWin::FTraceLogger::self() && KWin::FTraceLogger::self()->isRecording())                                                                               \
+        KWin::FTraceLogger::self()->instant(__VA_ARGS__);
+
+/**
+ * Records the value of a counter. The arguments are only evaluated if trace events are recorded.
+ */
+#define fTraceCounter(...)                                                                                                                                     \
+    if (KWin::FTraceLogger::self() && KWin::FTraceLogger::self()->isRecording())                                                                               \
+        KWin::FTraceLogger::self()->counter(__VA_ARGS__);
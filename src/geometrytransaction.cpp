@@ -0,0 +1,109 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "geometrytransaction.h"
+#include "abstract_client.h"
+#include "xdgshellclient.h"
+
+namespace KWin
+{
+
+// How long the windows can be held back waiting for slow clients, in milliseconds.
+static const int s_transactionTimeout = 100;
+
+GeometryTransaction::GeometryTransaction(Workspace *workspace)
+    : m_stackingBlocker(workspace)
+{
+}
+
+GeometryTransaction::~GeometryTransaction()
+{
+    QVector<XdgSurfaceClient *> pendingClients;
+    for (const QPointer<AbstractClient> &client : qAsConst(m_clients)) {
+        if (!client) {
+            continue;
+        }
+        client->blockGeometryUpdates(false);
+
+        if (auto xdgClient = qobject_cast<XdgSurfaceClient *>(client.data())) {
+            if (xdgClient->isConfigurePending() && xdgClient->isShown()) {
+                pendingClients.append(xdgClient);
+            }
+        }
+    }
+
+    // Only hold back the screen if more than one window is going to change, a single
+    // window is already presented atomically.
+    if (pendingClients.count() > 1) {
+        new PendingGeometryTransaction(pendingClients);
+    }
+}
+
+void GeometryTransaction::add(AbstractClient *client)
+{
+    for (const QPointer<AbstractClient> &other : qAsConst(m_clients)) {
+        if (other == client) {
+            return;
+        }
+    }
+    client->blockGeometryUpdates(true);
+    m_clients.append(client);
+}
+
+PendingGeometryTransaction::PendingGeometryTransaction(const QVector<XdgSurfaceClient *> &clients)
+    : m_clients(clients)
+{
+    for (XdgSurfaceClient *client : clients) {
+        connect(client, &XdgSurfaceClient::configuresApplied,
+                this, &PendingGeometryTransaction::handleConfiguresApplied);
+        connect(client, &Toplevel::windowClosed,
+                this, &PendingGeometryTransaction::handleWindowClosed);
+        client->holdPresentation();
+        m_heldClients.append(client);
+    }
+
+    m_timeout.setSingleShot(true);
+    m_timeout.setInterval(s_transactionTimeout);
+    connect(&m_timeout, &QTimer::timeout, this, &PendingGeometryTransaction::finish);
+    m_timeout.start();
+}
+
+PendingGeometryTransaction::~PendingGeometryTransaction()
+{
+    for (const QPointer<XdgSurfaceClient> &client : qAsConst(m_heldClients)) {
+        if (client) {
+            client->releasePresentation();
+        }
+    }
+}
+
+void PendingGeometryTransaction::handleConfiguresApplied()
+{
+    XdgSurfaceClient *client = static_cast<XdgSurfaceClient *>(sender());
+    m_clients.removeOne(client);
+    if (m_clients.isEmpty()) {
+        finish();
+    }
+}
+
+void PendingGeometryTransaction::handleWindowClosed(Toplevel *toplevel)
+{
+    m_clients.removeOne(static_cast<XdgSurfaceClient *>(toplevel));
+    if (m_clients.isEmpty()) {
+        finish();
+    }
+}
+
+void PendingGeometryTransaction::finish()
+{
+    m_timeout.stop();
+    deleteLater();
+}
+
+} // namespace KWin
@@ -0,0 +1,76 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "workspace.h"
+
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+
+namespace KWin
+{
+
+class AbstractClient;
+class Toplevel;
+class XdgSurfaceClient;
+
+/**
+ * The GeometryTransaction class groups geometry changes of several windows, e.g. when a
+ * tiling layout or the work area changes, so they are presented in a single frame.
+ *
+ * While the transaction is alive, the geometry updates of the added clients and the stacking
+ * updates of the workspace are blocked. When the transaction is destroyed, the new geometries
+ * are sent to the clients all at once. The involved xdg-shell clients keep presenting their old
+ * geometry and contents until every one of them has committed a buffer for its new geometry,
+ * or until a short timeout expires if some client is too slow to respond. Other windows are
+ * not held back.
+ */
+class KWIN_EXPORT GeometryTransaction
+{
+public:
+    explicit GeometryTransaction(Workspace *workspace);
+    ~GeometryTransaction();
+
+    /**
+     * Adds the specified @a client to the transaction. Geometry updates of the client are
+     * blocked until the transaction is destroyed.
+     */
+    void add(AbstractClient *client);
+
+private:
+    StackingUpdatesBlocker m_stackingBlocker;
+    QVector<QPointer<AbstractClient>> m_clients;
+};
+
+/**
+ * The PendingGeometryTransaction class holds back the presentation of the clients of a
+ * committed GeometryTransaction while they haven't caught up yet. It deletes itself when done.
+ */
+class PendingGeometryTransaction : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PendingGeometryTransaction(const QVector<XdgSurfaceClient *> &clients);
+    ~PendingGeometryTransaction() override;
+
+private:
+    void handleConfiguresApplied();
+    void handleWindowClosed(Toplevel *toplevel);
+    void finish();
+
+    QVector<XdgSurfaceClient *> m_clients;
+    QVector<QPointer<XdgSurfaceClient>> m_heldClients;
+    QTimer m_timeout;
+};
+
+} // namespace KWin
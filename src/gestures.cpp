@@ -9,6 +9,7 @@
 #include "gestures.h"
 
 #include <QRect>
+#include <algorithm>
 #include <functional>
 #include <cmath>
 
@@ -85,7 +86,11 @@ void GestureRecognizer::unregisterGesture(KWin::Gesture* gesture)
         m_destroyConnections.erase(it);
     }
     m_gestures.removeAll(gesture);
-    if (m_activeSwipeGestures.removeOne(gesture)) {
+    auto active = std::find_if(m_activeSwipeGestures.begin(), m_activeSwipeGestures.end(), [gesture](const ActiveSwipeGesture &active) {
+        return active.gesture == gesture;
+    });
+    if (active != m_activeSwipeGestures.end()) {
+        m_activeSwipeGestures.erase(active);
         Q_EMIT gesture->cancelled();
     }
 }
@@ -96,7 +101,7 @@ int GestureRecognizer::startSwipeGesture(uint fingerCount, const QPointF &startP
     // TODO: verify that no gesture is running
     for (Gesture *gesture : qAsConst(m_gestures)) {
         SwipeGesture *swipeGesture = qobject_cast<SwipeGesture*>(gesture);
-        if (!gesture) {
+        if (!swipeGesture) {
             continue;
         }
         if (swipeGesture->minimumFingerCountIsRelevant()) {
@@ -132,7 +137,7 @@ int GestureRecognizer::startSwipeGesture(uint fingerCount, const QPointF &startP
             }
         }
         // direction doesn't matter yet
-        m_activeSwipeGestures << swipeGesture;
+        m_activeSwipeGestures.append(ActiveSwipeGesture{swipeGesture, -1.0});
         count++;
         Q_EMIT swipeGesture->started();
     }
@@ -141,7 +146,7 @@ int GestureRecognizer::startSwipeGesture(uint fingerCount, const QPointF &startP
 
 void GestureRecognizer::updateSwipeGesture(const QSizeF &delta)
 {
-    m_swipeUpdates << delta;
+    m_swipeDelta += delta;
     m_currentDelta += delta;
     // with high resolution touch(pad) gestures can be cancelled without intention
     // -> don't cancel movements if their accumulated values are too small but also still update the gesture for animations
@@ -167,12 +172,16 @@ void GestureRecognizer::updateSwipeGesture(const QSizeF &delta)
         // vertical
         direction = m_lastDelta.height() < 0 ? SwipeGesture::Direction::Up : SwipeGesture::Direction::Down;
     }
-    const QSizeF combinedDelta = std::accumulate(m_swipeUpdates.constBegin(), m_swipeUpdates.constEnd(), QSizeF(0, 0));
     for (auto it = m_activeSwipeGestures.begin(); it != m_activeSwipeGestures.end();) {
-        auto g = qobject_cast<SwipeGesture*>(*it);
+        SwipeGesture *g = it->gesture;
         if (g->direction() == direction) {
             if (g->isMinimumDeltaRelevant()) {
-                Q_EMIT g->progress(g->minimumDeltaReachedProgress(combinedDelta));
+                // touchpads report far more often than the progress visibly changes
+                const qreal progress = g->minimumDeltaReachedProgress(m_swipeDelta);
+                if (progress != it->progress) {
+                    it->progress = progress;
+                    Q_EMIT g->progress(progress);
+                }
             }
             it++;
         } else {
@@ -184,8 +193,8 @@ void GestureRecognizer::updateSwipeGesture(const QSizeF &delta)
 
 void GestureRecognizer::cancelActiveSwipeGestures()
 {
-    for (auto g : qAsConst(m_activeSwipeGestures)) {
-        Q_EMIT g->cancelled();
+    for (const ActiveSwipeGesture &active : qAsConst(m_activeSwipeGestures)) {
+        Q_EMIT active.gesture->cancelled();
     }
     m_activeSwipeGestures.clear();
     m_currentDelta = QSizeF(0, 0);
@@ -195,23 +204,22 @@ void GestureRecognizer::cancelActiveSwipeGestures()
 void GestureRecognizer::cancelSwipeGesture()
 {
     cancelActiveSwipeGestures();
-    m_swipeUpdates.clear();
+    m_swipeDelta = QSizeF(0, 0);
     m_currentDelta = QSizeF(0, 0);
     m_lastDelta = QSizeF(0, 0);
 }
 
 void GestureRecognizer::endSwipeGesture()
 {
-    const QSizeF delta = std::accumulate(m_swipeUpdates.constBegin(), m_swipeUpdates.constEnd(), QSizeF(0, 0));
-    for (auto g : qAsConst(m_activeSwipeGestures)) {
-        if (static_cast<SwipeGesture*>(g)->minimumDeltaReached(delta)) {
-            Q_EMIT g->triggered();
+    for (const ActiveSwipeGesture &active : qAsConst(m_activeSwipeGestures)) {
+        if (active.gesture->minimumDeltaReached(m_swipeDelta)) {
+            Q_EMIT active.gesture->triggered();
         } else {
-            Q_EMIT g->cancelled();
+            Q_EMIT active.gesture->cancelled();
         }
     }
     m_activeSwipeGestures.clear();
-    m_swipeUpdates.clear();
+    m_swipeDelta = QSizeF(0, 0);
     m_currentDelta = QSizeF(0, 0);
     m_lastDelta = QSizeF(0, 0);
 }
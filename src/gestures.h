@@ -198,9 +198,14 @@ private:
     };
     int startSwipeGesture(uint fingerCount, const QPointF &startPos, StartPositionBehavior startPosBehavior);
     QVector<Gesture*> m_gestures;
-    QVector<Gesture*> m_activeSwipeGestures;
+    struct ActiveSwipeGesture {
+        SwipeGesture *gesture;
+        qreal progress; // the last emitted progress, or -1 if none was emitted yet
+    };
+    // keeps its capacity over gestures, so updating a gesture does not allocate
+    QVector<ActiveSwipeGesture> m_activeSwipeGestures;
     QMap<Gesture*, QMetaObject::Connection> m_destroyConnections;
-    QVector<QSizeF> m_swipeUpdates;
+    QSizeF m_swipeDelta = QSizeF(0, 0);
     QSizeF m_lastDelta = QSizeF(0, 0);
     QSizeF m_currentDelta = QSizeF(0, 0);
 };
@@ -58,6 +58,7 @@
 #include <QDBusConnection>
 #include <QDBusMessage>
 #include <QDBusPendingCall>
+#include <QDateTime>
 #include <QKeyEvent>
 #include <QThread>
 #include <qpa/qwindowsysteminterface.h>
@@ -100,6 +101,11 @@ bool InputEventFilter::pointerEvent(QMouseEvent *event, quint32 nativeButton)
     return false;
 }
 
+bool InputEventFilter::wantsPointerMotion() const
+{
+    return true;
+}
+
 bool InputEventFilter::wheelEvent(QWheelEvent *event)
 {
     Q_UNUSED(event)
@@ -295,6 +301,9 @@ bool InputEventFilter::passToInputMethod(QKeyEvent *event)
 
 class VirtualTerminalFilter : public InputEventFilter {
 public:
+    bool wantsPointerMotion() const override {
+        return false;
+    }
     bool keyEvent(QKeyEvent *event) override {
         // really on press and not on release? X11 switches on press.
         if (event->type() == QEvent::KeyPress && !event->isAutoRepeat()) {
@@ -310,6 +319,9 @@ public:
 
 class TerminateServerFilter : public InputEventFilter {
 public:
+    bool wantsPointerMotion() const override {
+        return false;
+    }
     bool keyEvent(QKeyEvent *event) override {
         if (event->type() == QEvent::KeyPress && !event->isAutoRepeat()) {
             if (event->nativeVirtualKey() == XKB_KEY_Terminate_Server) {
@@ -873,6 +885,9 @@ public:
         delete m_powerDown;
     }
 
+    bool wantsPointerMotion() const override {
+        return false;
+    }
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override {
         Q_UNUSED(nativeButton);
         if (event->type() == QEvent::MouseButtonPress) {
@@ -1473,6 +1488,9 @@ private:
 class WindowActionInputFilter : public InputEventFilter
 {
 public:
+    bool wantsPointerMotion() const override {
+        return false;
+    }
     bool pointerEvent(QMouseEvent *event, quint32 nativeButton) override {
         Q_UNUSED(nativeButton)
         if (event->type() != QEvent::MouseButtonPress) {
@@ -2282,17 +2300,24 @@ void InputRedirection::installInputEventFilter(InputEventFilter *filter)
 {
     Q_ASSERT(!m_filters.contains(filter));
     m_filters << filter;
+    if (filter->wantsPointerMotion()) {
+        m_pointerMotionFilters << filter;
+    }
 }
 
 void InputRedirection::prependInputEventFilter(InputEventFilter *filter)
 {
     Q_ASSERT(!m_filters.contains(filter));
     m_filters.prepend(filter);
+    if (filter->wantsPointerMotion()) {
+        m_pointerMotionFilters.prepend(filter);
+    }
 }
 
 void InputRedirection::uninstallInputEventFilter(InputEventFilter *filter)
 {
     m_filters.removeOne(filter);
+    m_pointerMotionFilters.removeOne(filter);
 }
 
 void InputRedirection::installInputEventSpy(InputEventSpy *spy)
@@ -2775,6 +2800,20 @@ Qt::MouseButtons InputRedirection::qtButtonStates() const
     return m_pointer->buttons();
 }
 
+// A cheap bounding box of everything hitTest() can accept, checked before the more
+// expensive per window state and input region lookups.
+static bool mayAcceptInputAt(const Toplevel *toplevel, const QPoint &pos)
+{
+    if (toplevel->inputGeometry().contains(pos)) {
+        return true;
+    }
+    const KWaylandServer::SurfaceInterface *surface = toplevel->surface();
+    if (surface && surface->isMapped()) {
+        return surface->boundingRect().contains(toplevel->mapToLocal(pos));
+    }
+    return false;
+}
+
 Toplevel *InputRedirection::findToplevel(const QPoint &pos)
 {
     if (!Workspace::self()) {
@@ -2789,7 +2828,7 @@ Toplevel *InputRedirection::findToplevel(const QPoint &pos)
         }
         const QList<Unmanaged *> &unmanaged = Workspace::self()->unmanagedList();
         for (Unmanaged *u : unmanaged) {
-            if (u->hitTest(pos)) {
+            if (mayAcceptInputAt(u, pos) && u->hitTest(pos)) {
                 return u;
             }
         }
@@ -2815,6 +2854,9 @@ Toplevel *InputRedirection::findManagedToplevel(const QPoint &pos)
             // a deleted window doesn't get mouse events
             continue;
         }
+        if (!mayAcceptInputAt(t, pos)) {
+            continue;
+        }
         if (AbstractClient *c = dynamic_cast<AbstractClient*>(t)) {
             if (!c->isOnCurrentActivity() || !c->isOnCurrentDesktop() || c->isMinimized() || c->isHiddenInternal()) {
                 continue;
@@ -2925,9 +2967,9 @@ InputDeviceHandler::~InputDeviceHandler() = default;
 
 void InputDeviceHandler::init()
 {
-    connect(workspace(), &Workspace::stackingOrderChanged, this, &InputDeviceHandler::update);
-    connect(workspace(), &Workspace::clientMinimizedChanged, this, &InputDeviceHandler::update);
-    connect(VirtualDesktopManager::self(), &VirtualDesktopManager::currentChanged, this, &InputDeviceHandler::update);
+    connect(workspace(), &Workspace::stackingOrderChanged, this, &InputDeviceHandler::scheduleUpdate);
+    connect(workspace(), &Workspace::clientMinimizedChanged, this, &InputDeviceHandler::scheduleUpdate);
+    connect(VirtualDesktopManager::self(), &VirtualDesktopManager::currentChanged, this, &InputDeviceHandler::scheduleUpdate);
 }
 
 bool InputDeviceHandler::setHover(Toplevel *toplevel)
@@ -2997,6 +3039,7 @@ void InputDeviceHandler::updateDecoration()
 
 void InputDeviceHandler::update()
 {
+    m_updateScheduled = false;
     if (!m_inited) {
         return;
     }
@@ -3019,6 +3062,19 @@ void InputDeviceHandler::update()
     workspace()->updateFocusMousePosition(position().toPoint());
 }
 
+void InputDeviceHandler::scheduleUpdate()
+{
+    if (m_updateScheduled) {
+        return;
+    }
+    m_updateScheduled = true;
+    QMetaObject::invokeMethod(this, [this]() {
+        if (m_updateScheduled) {
+            update();
+        }
+    }, Qt::QueuedConnection);
+}
+
 Toplevel *InputDeviceHandler::hover() const
 {
     return m_hover.window.data();
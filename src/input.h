@@ -11,6 +11,7 @@
 #ifndef KWIN_INPUT_H
 #define KWIN_INPUT_H
 #include <kwinglobals.h>
+#include "ftrace.h"
 #include <QAction>
 #include <QObject>
 #include <QPoint>
@@ -183,9 +184,22 @@ public:
      */
     template <class UnaryPredicate>
     void processFilters(UnaryPredicate function) {
+        fTraceSlice("InputRedirection::processFilters");
         std::any_of(m_filters.constBegin(), m_filters.constEnd(), function);
     }
 
+    /**
+     * Sends a pointer motion event through the input event filters that want pointer motion.
+     *
+     * @see processFilters
+     * @see InputEventFilter::wantsPointerMotion
+     */
+    template <class UnaryPredicate>
+    void processPointerMotionFilters(UnaryPredicate function) {
+        fTraceSlice("InputRedirection::processPointerMotionFilters");
+        std::any_of(m_pointerMotionFilters.constBegin(), m_pointerMotionFilters.constEnd(), function);
+    }
+
     /**
      * Sends an event through all input event spies.
      * The @p function is invoked on each InputEventSpy.
@@ -306,6 +320,7 @@ private:
     WindowSelectorFilter *m_windowSelector = nullptr;
 
     QVector<InputEventFilter*> m_filters;
+    QVector<InputEventFilter*> m_pointerMotionFilters;
     QVector<InputEventSpy*> m_spies;
     KConfigWatcher::Ptr m_inputConfigWatcher;
 
@@ -362,6 +377,16 @@ public:
      * @return @c true to stop further event processing, @c false to pass to next filter
      */
     virtual bool pointerEvent(QMouseEvent *event, quint32 nativeButton);
+    /**
+     * Whether pointer motion events have to be passed to pointerEvent(). Filters that only
+     * look at button presses and releases can return @c false to be skipped for motion,
+     * which is by far the most frequent input event. The default implementation returns
+     * @c true.
+     *
+     * The returned value must not change while the filter is installed.
+     * @since 5.25
+     */
+    virtual bool wantsPointerMotion() const;
     /**
      * Event filter for pointer axis events.
      *
@@ -415,6 +440,12 @@ public:
     virtual void init();
 
     void update();
+    /**
+     * Schedules an update() for when control returns to the event loop. Scene changes such as
+     * stacking order changes come in bursts, the focus only has to be resolved once for them.
+     * A direct update() in the meantime, e.g. for pointer motion, resolves the scheduled one.
+     */
+    void scheduleUpdate();
 
     /**
      * @brief First Toplevel currently at the position of the input device
@@ -493,6 +524,7 @@ private:
     } m_focus;
 
     bool m_inited = false;
+    bool m_updateScheduled = false;
 };
 
 inline
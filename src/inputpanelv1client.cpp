@@ -126,7 +126,12 @@ void KWin::InputPanelV1Client::reposition()
                         popupRect.moveTop(flippedPopupRect.top());
                     }
                 }
-                moveResize(popupRect);
+                // The popup follows the cursor while typing, only resize it if its size changed
+                if (popupRect.size() == size()) {
+                    move(popupRect.topLeft());
+                } else {
+                    moveResize(popupRect);
+                }
             }
         }   break;
     }
@@ -140,7 +145,9 @@ void InputPanelV1Client::destroyClient()
     Q_EMIT windowClosed(this, deleted);
     StackingUpdatesBlocker blocker(workspace());
     waylandServer()->removeClient(this);
-    deleted->unrefWindow();
+    if (deleted) {
+        deleted->unrefWindow();
+    }
 
     delete this;
 }
@@ -170,8 +177,11 @@ void InputPanelV1Client::setOutput(OutputInterface *outputIface)
 
 void InputPanelV1Client::moveResizeInternal(const QRect &rect, MoveResizeMode mode)
 {
-    Q_UNUSED(mode)
-    updateGeometry(rect);
+    if (mode == MoveResizeMode::Move) {
+        updateGeometry(QRect(rect.topLeft(), size()));
+    } else {
+        updateGeometry(rect);
+    }
 }
 
 } // namespace KWin
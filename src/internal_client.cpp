@@ -369,7 +369,9 @@ void InternalClient::destroyClient()
 
     workspace()->removeInternalClient(this);
 
-    deleted->unrefWindow();
+    if (deleted) {
+        deleted->unrefWindow();
+    }
     m_internalWindow = nullptr;
 
     delete this;
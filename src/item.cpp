@@ -26,9 +26,9 @@ Item::Item(Item *parent)
 Item::~Item()
 {
     setParentItem(nullptr);
-    for (const auto &dirty : qAsConst(m_repaints)) {
-        if (!dirty.isEmpty()) {
-            Compositor::self()->scene()->addRepaint(dirty);
+    for (const RepaintSlot &slot : qAsConst(m_repaints)) {
+        if (!slot.region.isEmpty()) {
+            Compositor::self()->scene()->addRepaint(slot.region);
         }
     }
 }
@@ -76,6 +76,13 @@ void Item::addChild(Item *item)
 
     m_childItems.append(item);
     markSortedChildItemsDirty();
+    // The repaints of the new child must not be skipped by the repaint walks.
+    for (const RepaintSlot &slot : qAsConst(m_repaints)) {
+        const int childSlot = item->repaintSlot(slot.output);
+        if (childSlot == -1 || item->m_repaints[childSlot].pending) {
+            markRepaintsPending(slot.output);
+        }
+    }
 
     updateBoundingRect();
     scheduleRepaint(item->boundingRect().translated(item->position()));
@@ -261,16 +268,53 @@ void Item::scheduleRepaintInternal(const QRegion &region)
         for (const auto &output : outputs) {
             const QRegion dirtyRegion = globalRegion & output->geometry();
             if (!dirtyRegion.isEmpty()) {
-                m_repaints[output] += dirtyRegion;
+                addRepaints(output, dirtyRegion);
                 output->renderLoop()->scheduleRepaint(this);
             }
         }
     } else {
-        m_repaints[nullptr] += globalRegion;
+        addRepaints(nullptr, globalRegion);
         kwinApp()->platform()->renderLoop()->scheduleRepaint(this);
     }
 }
 
+int Item::repaintSlot(AbstractOutput *output) const
+{
+    for (int i = 0; i < m_repaints.count(); ++i) {
+        if (m_repaints[i].output == output) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void Item::addRepaints(AbstractOutput *output, const QRegion &region)
+{
+    const int slot = repaintSlot(output);
+    if (slot == -1) {
+        m_repaints.append(RepaintSlot{output, region, true});
+    } else {
+        m_repaints[slot].region += region;
+        m_repaints[slot].pending = true;
+    }
+    if (m_parentItem) {
+        m_parentItem->markRepaintsPending(output);
+    }
+}
+
+void Item::markRepaintsPending(AbstractOutput *output)
+{
+    // If an item has pending repaints, so do all of its ancestors. The walk can stop at items
+    // that have not been painted on the output yet, they are never skipped.
+    for (Item *item = this; item; item = item->m_parentItem) {
+        const int slot = item->repaintSlot(output);
+        if (slot == -1 || item->m_repaints[slot].pending) {
+            break;
+        }
+        item->m_repaints[slot].pending = true;
+    }
+}
+
 void Item::scheduleFrame()
 {
     if (!isVisible()) {
@@ -313,17 +357,81 @@ WindowQuadList Item::quads() const
 
 QRegion Item::repaints(AbstractOutput *output) const
 {
-    return m_repaints.value(output, QRect(QPoint(0, 0), screens()->size()));
+    const int slot = repaintSlot(output);
+    if (slot == -1) {
+        return QRect(QPoint(0, 0), screens()->size());
+    }
+    return m_repaints[slot].region;
 }
 
 void Item::resetRepaints(AbstractOutput *output)
 {
-    m_repaints.insert(output, QRegion());
+    const int slot = repaintSlot(output);
+    if (slot == -1) {
+        m_repaints.append(RepaintSlot{output, QRegion(), !m_childItems.isEmpty()});
+    } else {
+        m_repaints[slot].region = QRegion();
+        // The children may still have repaints of their own.
+        m_repaints[slot].pending = !m_childItems.isEmpty();
+    }
 }
 
 void Item::removeRepaints(AbstractOutput *output)
 {
-    m_repaints.remove(output);
+    const int slot = repaintSlot(output);
+    if (slot != -1) {
+        m_repaints.remove(slot);
+    }
+}
+
+void Item::accumulateRepaints(AbstractOutput *output, QRegion *repaints)
+{
+    int slot = repaintSlot(output);
+    if (slot == -1) {
+        // The item has not been painted on the output yet.
+        if (repaints) {
+            *repaints += QRect(QPoint(0, 0), screens()->size());
+        }
+        m_repaints.append(RepaintSlot{output, QRegion(), true});
+        slot = m_repaints.count() - 1;
+    } else if (!m_repaints[slot].pending) {
+        return;
+    } else if (repaints) {
+        *repaints += m_repaints[slot].region;
+    }
+    m_repaints[slot].region = QRegion();
+
+    bool pending = false;
+    for (Item *childItem : qAsConst(m_childItems)) {
+        childItem->accumulateRepaints(output, repaints);
+        pending |= childItem->m_repaints[childItem->repaintSlot(output)].pending;
+    }
+    m_repaints[slot].pending = pending;
+}
+
+void Item::resetRepaintsRecursive(AbstractOutput *output)
+{
+    accumulateRepaints(output, nullptr);
+}
+
+bool Item::hasRepaintsRecursive(AbstractOutput *output) const
+{
+    const int slot = repaintSlot(output);
+    if (slot == -1) {
+        return true;
+    }
+    if (!m_repaints[slot].pending) {
+        return false;
+    }
+    if (!m_repaints[slot].region.isEmpty()) {
+        return true;
+    }
+    for (const Item *childItem : qAsConst(m_childItems)) {
+        if (childItem->hasRepaintsRecursive(output)) {
+            return true;
+        }
+    }
+    return false;
 }
 
 bool Item::isVisible() const
@@ -11,6 +11,7 @@
 
 #include <QMatrix4x4>
 #include <QObject>
+#include <QVarLengthArray>
 
 #include <optional>
 
@@ -90,6 +91,21 @@ public:
     QRegion repaints(AbstractOutput *output) const;
     void resetRepaints(AbstractOutput *output);
 
+    /**
+     * Adds the repaints of this item and all of its descendants on the specified @a output
+     * to @a repaints and resets them. Subtrees without pending repaints are skipped.
+     */
+    void accumulateRepaints(AbstractOutput *output, QRegion *repaints);
+    /**
+     * Resets the repaints of this item and all of its descendants on the specified @a output.
+     */
+    void resetRepaintsRecursive(AbstractOutput *output);
+    /**
+     * Returns @c true if this item or any of its descendants has repaints on the specified
+     * @a output.
+     */
+    bool hasRepaintsRecursive(AbstractOutput *output) const;
+
     WindowQuadList quads() const;
     virtual void preprocess();
 
@@ -123,6 +139,9 @@ private:
     bool computeEffectiveVisibility() const;
     void updateEffectiveVisibility();
     void removeRepaints(AbstractOutput *output);
+    int repaintSlot(AbstractOutput *output) const;
+    void addRepaints(AbstractOutput *output, const QRegion &region);
+    void markRepaintsPending(AbstractOutput *output);
 
     QPointer<Item> m_parentItem;
     QList<Item *> m_childItems;
@@ -133,7 +152,16 @@ private:
     int m_z = 0;
     bool m_visible = true;
     bool m_effectiveVisible = true;
-    QMap<AbstractOutput *, QRegion> m_repaints;
+    // The repaints are kept in a small flat array with one slot per output, the number of
+    // outputs is too small for a map to pay off. An output without a slot has not been
+    // painted yet, so everything needs to be repainted on it.
+    struct RepaintSlot {
+        AbstractOutput *output = nullptr;
+        QRegion region;
+        // Whether this item or any of its descendants may have repaints on the output
+        bool pending = false;
+    };
+    QVarLengthArray<RepaintSlot, 2> m_repaints;
     mutable std::optional<WindowQuadList> m_quads;
     mutable std::optional<QList<Item *>> m_sortedChildItems;
 };
@@ -16,6 +16,9 @@
 
 #include <QTimer>
 
+#include <algorithm>
+#include <chrono>
+
 namespace KWin
 {
 
@@ -24,19 +27,45 @@ KeyboardRepeat::KeyboardRepeat(Xkb *xkb)
     , m_timer(new QTimer(this))
     , m_xkb(xkb)
 {
+    // The repeats are scheduled against fixed deadlines, a coarse timer would make the
+    // cadence jitter by its slack.
+    m_timer->setTimerType(Qt::PreciseTimer);
+    m_timer->setSingleShot(true);
     connect(m_timer, &QTimer::timeout, this, &KeyboardRepeat::handleKeyRepeat);
 }
 
 KeyboardRepeat::~KeyboardRepeat() = default;
 
+static qint64 monotonicMilliseconds()
+{
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
+}
+
+void KeyboardRepeat::scheduleKeyRepeat()
+{
+    const qint64 now = monotonicMilliseconds();
+    m_timer->start(int(std::max<qint64>(0, m_deadline - now)));
+}
+
 void KeyboardRepeat::handleKeyRepeat()
 {
     // TODO: don't depend on WaylandServer
-    if (waylandServer()->seat()->keyboard()->keyRepeatRate() != 0) {
-        m_timer->setInterval(1000 / waylandServer()->seat()->keyboard()->keyRepeatRate());
+    const auto keyboard = waylandServer()->seat()->keyboard();
+    const quint32 time = m_time;
+
+    const qint64 interval = keyboard->keyRepeatRate() != 0 ? 1000 / keyboard->keyRepeatRate() : keyboard->keyRepeatDelay();
+    const qint64 now = monotonicMilliseconds();
+    m_deadline += interval;
+    m_time += interval;
+    if (m_deadline < now - interval) {
+        // don't send a burst of repeats after the main thread has been blocked
+        m_time += now - m_deadline;
+        m_deadline = now;
     }
-    // TODO: better time
-    Q_EMIT keyRepeat(m_key, m_time);
+    // schedule before emitting, handling the repeat may release the key and stop the timer
+    scheduleKeyRepeat();
+    Q_EMIT keyRepeat(m_key, time);
 }
 
 void KeyboardRepeat::keyEvent(KeyEvent *event)
@@ -47,11 +76,17 @@ void KeyboardRepeat::keyEvent(KeyEvent *event)
     const quint32 key = event->nativeScanCode();
     if (event->type() == QEvent::KeyPress) {
         // TODO: don't get these values from WaylandServer
-        if (m_xkb->shouldKeyRepeat(key) && waylandServer()->seat()->keyboard()->keyRepeatDelay() != 0) {
-            m_timer->setInterval(waylandServer()->seat()->keyboard()->keyRepeatDelay());
+        const qint32 delay = waylandServer()->seat()->keyboard()->keyRepeatDelay();
+        if (m_xkb->shouldKeyRepeat(key) && delay != 0) {
             m_key = key;
-            m_time = event->timestamp();
-            m_timer->start();
+            m_time = event->timestamp() + delay;
+            // The libinput timestamps use the monotonic clock, so the delay can be counted from
+            // when the key was actually pressed. Timestamps from other sources may be on another
+            // clock, the delay is counted from now for them.
+            const qint64 now = monotonicMilliseconds();
+            const qint64 sinceEvent = (now - event->timestamp()) & 0xffffffff;
+            m_deadline = now + delay - (sinceEvent <= delay ? sinceEvent : 0);
+            scheduleKeyRepeat();
         }
     } else if (event->type() == QEvent::KeyRelease) {
         if (key == m_key) {
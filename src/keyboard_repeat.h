@@ -33,10 +33,13 @@ Q_SIGNALS:
 
 private:
     void handleKeyRepeat();
+    void scheduleKeyRepeat();
     QTimer *m_timer;
     Xkb *m_xkb;
     quint32 m_time;
     quint32 m_key = 0;
+    // when the next repeat is due, in milliseconds of the monotonic clock
+    qint64 m_deadline = 0;
 };
 
 
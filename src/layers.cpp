@@ -82,7 +82,9 @@
 #include "internal_client.h"
 #include "virtualdesktops.h"
 
+#include <algorithm>
 #include <array>
+#include <list>
 
 #include <QDebug>
 #include <QQueue>
@@ -103,6 +105,10 @@ void Workspace::updateStackingOrder(bool propagate_new_clients)
     }
     QList<Toplevel *> new_stacking_order = constrainedStackingOrder();
     bool changed = (force_restacking || new_stacking_order != stacking_order);
+    if (force_restacking) {
+        // restack all windows, the X server may not be in the state we left it in
+        m_propagatedClientStack.clear();
+    }
     force_restacking = false;
     stacking_order = new_stacking_order;
     if (changed || propagate_new_clients) {
@@ -159,6 +165,7 @@ void Workspace::propagateClients(bool propagate_new_clients)
 
     newWindowStack << manual_overlays;
 
+    const int clientsBegin = newWindowStack.size();
     newWindowStack.reserve(newWindowStack.size() + 2*stacking_order.size()); // *2 for inputWindow
 
     for (int i = stacking_order.size() - 1; i >= 0; --i) {
@@ -183,14 +190,100 @@ void Workspace::propagateClients(bool propagate_new_clients)
             continue;
         newWindowStack << client->frameId();
     }
-    // TODO isn't it too inefficient to restack always all clients?
     // TODO don't restack not visible windows?
     Q_ASSERT(newWindowStack.at(0) == rootInfo()->supportWindow());
-    Xcb::restackWindows(newWindowStack);
+    restackClientWindows(newWindowStack, clientsBegin);
+
+    scheduleRootClientListsUpdate(propagate_new_clients);
+}
+
+/**
+ * Sends the restack requests needed to turn the previously propagated window stack
+ * into @p windowStack. The windows up to @p clientsBegin (the support window, the screen
+ * edges and the manual overlays) are few and may have been raised behind our back, they
+ * get restacked every time. Of the client windows, the longest run that kept its relative
+ * order stays where it is and only the others are moved below their new predecessor.
+ */
+void Workspace::restackClientWindows(const QVector<xcb_window_t> &windowStack, int clientsBegin)
+{
+    const int count = windowStack.size() - clientsBegin;
+    QVector<bool> stable(count, false);
+
+    if (!m_propagatedClientStack.isEmpty()) {
+        QHash<xcb_window_t, int> previousPositions;
+        previousPositions.reserve(m_propagatedClientStack.size());
+        for (int i = 0; i < m_propagatedClientStack.size(); ++i) {
+            previousPositions.insert(m_propagatedClientStack.at(i), i);
+        }
+
+        // longest increasing subsequence of the previous positions, in O(n log n)
+        QVector<int> positions(count, -1);
+        QVector<int> tails; // indices into positions, tails of the increasing runs by length
+        QVector<int> predecessors(count, -1);
+        for (int i = 0; i < count; ++i) {
+            const int position = previousPositions.value(windowStack.at(clientsBegin + i), -1);
+            positions[i] = position;
+            if (position == -1) {
+                continue;
+            }
+            const auto it = std::lower_bound(tails.begin(), tails.end(), position, [&positions](int index, int value) {
+                return positions.at(index) < value;
+            });
+            if (it != tails.begin()) {
+                predecessors[i] = *(it - 1);
+            }
+            if (it == tails.end()) {
+                tails.append(i);
+            } else {
+                *it = i;
+            }
+        }
+        for (int i = tails.isEmpty() ? -1 : tails.last(); i != -1; i = predecessors.at(i)) {
+            stable[i] = true;
+        }
+    }
+
+    for (int i = 1; i < windowStack.size(); ++i) {
+        if (i >= clientsBegin && stable.at(i - clientsBegin)) {
+            continue;
+        }
+        const uint16_t mask = XCB_CONFIG_WINDOW_SIBLING | XCB_CONFIG_WINDOW_STACK_MODE;
+        const uint32_t stackingValues[] = {
+            windowStack.at(i - 1),
+            XCB_STACK_MODE_BELOW
+        };
+        xcb_configure_window(connection(), windowStack.at(i), mask, stackingValues);
+    }
+
+    m_propagatedClientStack = windowStack.mid(clientsBegin);
+}
+
+/**
+ * The NETWM client list properties are rewritten at most once per event loop
+ * iteration, no matter how many stacking changes happen in between.
+ */
+void Workspace::scheduleRootClientListsUpdate(bool clientList)
+{
+    m_rootClientListDirty |= clientList;
+    if (m_rootClientListsUpdateScheduled) {
+        return;
+    }
+    m_rootClientListsUpdateScheduled = true;
+    QMetaObject::invokeMethod(this, &Workspace::updateRootClientLists, Qt::QueuedConnection);
+}
+
+void Workspace::updateRootClientLists()
+{
+    m_rootClientListsUpdateScheduled = false;
+    if (!rootInfo()) {
+        m_rootClientListDirty = false;
+        return;
+    }
 
     int pos = 0;
     xcb_window_t *cl(nullptr);
-    if (propagate_new_clients) {
+    if (m_rootClientListDirty) {
+        m_rootClientListDirty = false;
         cl = new xcb_window_t[ manual_overlays.count() + m_x11Clients.count()];
         for (const auto win : qAsConst(manual_overlays)) {
             cl[pos++] = win;
@@ -507,6 +600,88 @@ static Layer computeLayer(const Toplevel *toplevel)
     }
 }
 
+namespace {
+
+/**
+ * Keeps the windows in a linked list where every node carries an increasing label, so
+ * comparing the positions of two windows and moving a window costs O(1), with an
+ * occasional relabeling when two neighbours run out of room in between.
+ */
+class StackingList
+{
+public:
+    explicit StackingList(int reserve)
+    {
+        m_positions.reserve(reserve);
+    }
+
+    void append(Toplevel *window)
+    {
+        const quint64 label = m_nodes.empty() ? 0 : m_nodes.back().label + s_labelGap;
+        m_positions.insert(window, m_nodes.insert(m_nodes.end(), Node{window, label}));
+    }
+
+    /**
+     * Moves @p above right on top of @p below unless it already is somewhere above it.
+     * Returns @c false if either window is not in the list.
+     */
+    bool ensureAbove(Toplevel *below, Toplevel *above)
+    {
+        const auto belowIt = m_positions.constFind(below);
+        const auto aboveIt = m_positions.constFind(above);
+        if (belowIt == m_positions.constEnd() || aboveIt == m_positions.constEnd()) {
+            return false;
+        }
+        const Iterator belowNode = *belowIt;
+        const Iterator aboveNode = *aboveIt;
+        if (aboveNode->label > belowNode->label) {
+            return true;
+        }
+        m_nodes.splice(std::next(belowNode), m_nodes, aboveNode);
+        const auto next = std::next(aboveNode);
+        const quint64 upper = next == m_nodes.end() ? belowNode->label + 2 * s_labelGap : next->label;
+        if (upper - belowNode->label < 2) {
+            relabel();
+        } else {
+            aboveNode->label = belowNode->label + (upper - belowNode->label) / 2;
+        }
+        return true;
+    }
+
+    QList<Toplevel *> toList() const
+    {
+        QList<Toplevel *> list;
+        list.reserve(m_positions.count());
+        for (const Node &node : m_nodes) {
+            list.append(node.window);
+        }
+        return list;
+    }
+
+private:
+    struct Node
+    {
+        Toplevel *window;
+        quint64 label;
+    };
+    using Iterator = std::list<Node>::iterator;
+
+    void relabel()
+    {
+        quint64 label = 0;
+        for (Node &node : m_nodes) {
+            node.label = label;
+            label += s_labelGap;
+        }
+    }
+
+    static constexpr quint64 s_labelGap = quint64(1) << 32;
+    std::list<Node> m_nodes;
+    QHash<Toplevel *, Iterator> m_positions;
+};
+
+}
+
 /**
  * Returns a stacking order based upon \a list that fulfills certain contained.
  */
@@ -520,10 +695,11 @@ QList<Toplevel *> Workspace::constrainedStackingOrder()
         windows[layer] << window;
     }
 
-    QList<Toplevel *> stacking;
-    stacking.reserve(unconstrained_stacking_order.count());
+    StackingList stacking(unconstrained_stacking_order.count());
     for (uint layer = FirstLayer; layer < NumLayers; ++layer) {
-        stacking += windows[layer];
+        for (Toplevel *window : qAsConst(windows[layer])) {
+            stacking.append(window);
+        }
     }
 
     // Apply the stacking order constraints. First, we enqueue the root constraints, i.e.
@@ -545,13 +721,8 @@ QList<Toplevel *> Workspace::constrainedStackingOrder()
     while (!constraints.isEmpty()) {
         Constraint *constraint = constraints.dequeue();
 
-        const int belowIndex = stacking.indexOf(constraint->below);
-        const int aboveIndex = stacking.indexOf(constraint->above);
-        if (belowIndex == -1 || aboveIndex == -1) {
+        if (!stacking.ensureAbove(constraint->below, constraint->above)) {
             continue;
-        } else if (aboveIndex < belowIndex) {
-            stacking.removeAt(aboveIndex);
-            stacking.insert(belowIndex, constraint->above);
         }
 
         for (Constraint *child : qAsConst(constraint->children)) {
@@ -562,7 +733,7 @@ QList<Toplevel *> Workspace::constrainedStackingOrder()
         }
     }
 
-    return stacking;
+    return stacking.toList();
 }
 
 void Workspace::blockStackingUpdates(bool block)
@@ -629,31 +800,127 @@ void Workspace::updateXStackingOrder()
     // use our own stacking order, not the X one, as they may differ
     x_stacking = stacking_order;
 
-    if (m_xStackingQueryTree && !m_xStackingQueryTree->isNull()) {
-        std::unique_ptr<Xcb::Tree> tree{std::move(m_xStackingQueryTree)};
-        xcb_window_t *windows = tree->children();
-        const auto count = tree->data()->children_len;
-        int foundUnmanagedCount = m_unmanaged.count();
-        for (unsigned int i = 0;
-                i < count;
-                ++i) {
-            for (auto it = m_unmanaged.constBegin(); it != m_unmanaged.constEnd(); ++it) {
-                Unmanaged *u = *it;
-                if (u->window() == windows[i]) {
-                    x_stacking.append(u);
-                    foundUnmanagedCount--;
+    if (!m_rootStackingValid) {
+        fetchRootStacking();
+    }
+
+    if (!m_unmanaged.isEmpty()) {
+        QHash<xcb_window_t, Unmanaged *> unmanaged;
+        unmanaged.reserve(m_unmanaged.count());
+        for (Unmanaged *u : qAsConst(m_unmanaged)) {
+            unmanaged.insert(u->window(), u);
+        }
+        for (xcb_window_t window : qAsConst(m_rootStacking)) {
+            if (Unmanaged *u = unmanaged.take(window)) {
+                x_stacking.append(u);
+                if (unmanaged.isEmpty()) {
                     break;
                 }
             }
-            if (foundUnmanagedCount == 0) {
-                break;
-            }
         }
     }
 
     m_xStackingDirty = false;
 }
 
+/**
+ * Builds the root stacking model from the reply of the pending QueryTree request.
+ */
+void Workspace::fetchRootStacking()
+{
+    if (!m_xStackingQueryTree) {
+        return;
+    }
+    std::unique_ptr<Xcb::Tree> tree{std::move(m_xStackingQueryTree)};
+    if (tree->isNull()) {
+        return;
+    }
+    xcb_window_t *windows = tree->children();
+    const auto count = tree->data()->children_len;
+    m_rootStacking.clear();
+    m_rootStacking.reserve(count);
+    for (unsigned int i = 0; i < count; ++i) {
+        m_rootStacking.append(windows[i]);
+    }
+    m_rootStackingValid = true;
+}
+
+/**
+ * Applies a SubstructureNotify event of the root window to the root stacking model, so
+ * the X stacking order never has to be queried while painting.
+ */
+void Workspace::updateRootStacking(xcb_generic_event_t *event)
+{
+    if (!m_rootStackingValid) {
+        if (!m_xStackingQueryTree) {
+            // the next query reflects the event
+            return;
+        }
+        // An event the X server generated before it processed the query is included in
+        // the reply. Any later event has to be applied on top of the reply, so it must not
+        // be dropped while the reply is still in flight.
+        if (int32_t(event->full_sequence - m_xStackingQueryTree->sequence()) < 0) {
+            return;
+        }
+        fetchRootStacking();
+        if (!m_rootStackingValid) {
+            return;
+        }
+    }
+    switch (event->response_type & ~0x80) {
+    case XCB_CREATE_NOTIFY: {
+        const auto *e = reinterpret_cast<xcb_create_notify_event_t *>(event);
+        if (!m_rootStacking.contains(e->window)) {
+            m_rootStacking.append(e->window);
+        }
+        break;
+    }
+    case XCB_DESTROY_NOTIFY:
+        m_rootStacking.removeOne(reinterpret_cast<xcb_destroy_notify_event_t *>(event)->window);
+        break;
+    case XCB_REPARENT_NOTIFY: {
+        const auto *e = reinterpret_cast<xcb_reparent_notify_event_t *>(event);
+        m_rootStacking.removeOne(e->window);
+        if (e->parent == rootWindow()) {
+            m_rootStacking.append(e->window);
+        }
+        break;
+    }
+    case XCB_CONFIGURE_NOTIFY: {
+        const auto *e = reinterpret_cast<xcb_configure_notify_event_t *>(event);
+        const int index = m_rootStacking.indexOf(e->window);
+        const int siblingIndex = e->above_sibling == XCB_WINDOW_NONE ? -1 : m_rootStacking.indexOf(e->above_sibling);
+        if (index == -1 || (e->above_sibling != XCB_WINDOW_NONE && siblingIndex == -1)) {
+            // a window we don't know about, the model is out of sync, query it again
+            m_rootStackingValid = false;
+            m_rootStacking.clear();
+            break;
+        }
+        if (siblingIndex == index - 1) {
+            break;
+        }
+        m_rootStacking.removeAt(index);
+        if (e->above_sibling == XCB_WINDOW_NONE) {
+            m_rootStacking.prepend(e->window);
+        } else {
+            m_rootStacking.insert(siblingIndex < index ? siblingIndex + 1 : siblingIndex, e->window);
+        }
+        break;
+    }
+    case XCB_CIRCULATE_NOTIFY: {
+        const auto *e = reinterpret_cast<xcb_circulate_notify_event_t *>(event);
+        if (m_rootStacking.removeOne(e->window)) {
+            if (e->place == XCB_PLACE_ON_TOP) {
+                m_rootStacking.append(e->window);
+            } else {
+                m_rootStacking.prepend(e->window);
+            }
+        }
+        break;
+    }
+    }
+}
+
 //*******************************
 // Client
 //*******************************
@@ -94,7 +94,7 @@ AbstractOutput *LayerShellV1Client::desiredOutput() const
 
 void LayerShellV1Client::scheduleRearrange()
 {
-    m_integration->scheduleRearrange();
+    m_integration->scheduleRearrange(m_desiredOutput);
 }
 
 NET::WindowType LayerShellV1Client::windowType(bool, int) const
@@ -182,7 +182,9 @@ void LayerShellV1Client::destroyClient()
     StackingUpdatesBlocker blocker(workspace());
     cleanGrouping();
     waylandServer()->removeClient(this);
-    deleted->unrefWindow();
+    if (deleted) {
+        deleted->unrefWindow();
+    }
     scheduleRearrange();
     delete this;
 }
@@ -201,22 +201,51 @@ static void rearrangeOutput(AbstractOutput *output)
     }
 }
 
+static QVector<QRect> collectStruts()
+{
+    QVector<QRect> struts;
+    const QList<AbstractClient *> clients = waylandServer()->clients();
+    for (AbstractClient *client : clients) {
+        LayerShellV1Client *layerShellClient = qobject_cast<LayerShellV1Client *>(client);
+        if (!layerShellClient || !layerShellClient->hasStrut()) {
+            continue;
+        }
+        struts.append(layerShellClient->strutRect(StrutAreaLeft));
+        struts.append(layerShellClient->strutRect(StrutAreaRight));
+        struts.append(layerShellClient->strutRect(StrutAreaTop));
+        struts.append(layerShellClient->strutRect(StrutAreaBottom));
+    }
+    return struts;
+}
+
 void LayerShellV1Integration::rearrange()
 {
     m_rearrangeTimer->stop();
 
     const QVector<AbstractOutput *> outputs = kwinApp()->platform()->enabledOutputs();
     for (AbstractOutput *output : outputs) {
-        rearrangeOutput(output);
+        if (m_rearrangeOutputs.contains(output)) {
+            rearrangeOutput(output);
+        }
+    }
+    m_rearrangeOutputs.clear();
+
+    // Panels that animate their margins or size commit new state every frame, only
+    // update the work area if the space reserved by the layer surfaces has changed.
+    QVector<QRect> struts = collectStruts();
+    if (struts == m_struts) {
+        return;
     }
+    m_struts = std::move(struts);
 
     if (workspace()) {
         workspace()->updateClientArea();
     }
 }
 
-void LayerShellV1Integration::scheduleRearrange()
+void LayerShellV1Integration::scheduleRearrange(AbstractOutput *output)
 {
+    m_rearrangeOutputs.insert(output);
     m_rearrangeTimer->start();
 }
 
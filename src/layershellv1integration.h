@@ -8,6 +8,10 @@
 
 #include "waylandshellintegration.h"
 
+#include <QRect>
+#include <QSet>
+#include <QVector>
+
 namespace KWaylandServer
 {
 class LayerSurfaceV1Interface;
@@ -16,6 +20,8 @@ class LayerSurfaceV1Interface;
 namespace KWin
 {
 
+class AbstractOutput;
+
 class LayerShellV1Integration : public WaylandShellIntegration
 {
     Q_OBJECT
@@ -24,7 +30,11 @@ public:
     explicit LayerShellV1Integration(QObject *parent = nullptr);
 
     void rearrange();
-    void scheduleRearrange();
+    /**
+     * Schedules the layer surfaces on the given @a output to be arranged again. All
+     * outputs that have been scheduled are arranged together later.
+     */
+    void scheduleRearrange(AbstractOutput *output);
 
     void createClient(KWaylandServer::LayerSurfaceV1Interface *shellSurface);
     void recreateClient(KWaylandServer::LayerSurfaceV1Interface *shellSurface);
@@ -32,6 +42,8 @@ public:
 
 private:
     QTimer *m_rearrangeTimer;
+    QSet<AbstractOutput *> m_rearrangeOutputs;
+    QVector<QRect> m_struts;
 };
 
 } // namespace KWin
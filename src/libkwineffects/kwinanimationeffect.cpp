@@ -31,14 +31,14 @@ class AnimationEffectPrivate {
 public:
     AnimationEffectPrivate()
     {
-        m_animationsTouched = m_isInitialized = false;
+        m_animationsTouched = m_isInitialized = m_repaintQueued = false;
         m_justEndedAnimation = 0;
     }
     AnimationEffect::AniMap m_animations;
     static quint64 m_animCounter;
     quint64 m_justEndedAnimation; // protect against cancel
     QWeakPointer<FullScreenEffectLock> m_fullScreenEffectLock;
-    bool m_needSceneRepaint, m_animationsTouched, m_isInitialized;
+    bool m_needSceneRepaint, m_animationsTouched, m_isInitialized, m_repaintQueued;
 };
 
 quint64 AnimationEffectPrivate::m_animCounter = 0;
@@ -216,8 +216,10 @@ quint64 AnimationEffect::p_animate( EffectWindow *w, Attribute a, uint meta, int
                 this, &AnimationEffect::_windowExpandedGeometryChanged);
     }
     AniMap::iterator it = d->m_animations.find(w);
-    if (it == d->m_animations.end())
-        it = d->m_animations.insert(w, QPair<QList<AniData>, QRect>(QList<AniData>(), QRect()));
+    if (it == d->m_animations.end()) {
+        it = d->m_animations.insert(w, QPair<QVector<AniData>, QRect>(QVector<AniData>(), QRect()));
+        w->setEffectActive(this, true);
+    }
 
     FullScreenEffectLockPtr fullscreen;
     if (fullScreenEffect) {
@@ -271,8 +273,16 @@ quint64 AnimationEffect::p_animate( EffectWindow *w, Attribute a, uint meta, int
         if (waitAtSource)
             w->addLayerRepaint(0, 0, s.width(), s.height());
     }
-    else {
-        triggerRepaint();
+    else if (!d->m_repaintQueued) {
+        // Many windows can start animating at once, e.g. when a session is restored. Every
+        // repaint walks all animated windows, so schedule it only once for all animations
+        // started until control returns to the event loop.
+        d->m_repaintQueued = true;
+        QMetaObject::invokeMethod(this, [this]() {
+            Q_D(AnimationEffect);
+            d->m_repaintQueued = false;
+            triggerRepaint();
+        }, Qt::QueuedConnection);
     }
     return ret_id;
 }
@@ -284,7 +294,7 @@ bool AnimationEffect::retarget(quint64 animationId, FPx2 newTarget, int newRemai
         return false; // this is just ending, do not try to retarget it
     for (AniMap::iterator entry = d->m_animations.begin(),
                          mapEnd = d->m_animations.end(); entry != mapEnd; ++entry) {
-        for (QList<AniData>::iterator anim = entry->first.begin(),
+        for (QVector<AniData>::iterator anim = entry->first.begin(),
                                    animEnd = entry->first.end(); anim != animEnd; ++anim) {
             if (anim->id == animationId) {
                 anim->from.set(interpolated(*anim, 0), interpolated(*anim, 1));
@@ -370,10 +380,11 @@ bool AnimationEffect::cancel(quint64 animationId)
     if (animationId == d->m_justEndedAnimation)
         return true; // this is just ending, do not try to cancel it but fake success
     for (AniMap::iterator entry = d->m_animations.begin(), mapEnd = d->m_animations.end(); entry != mapEnd; ++entry) {
-        for (QList<AniData>::iterator anim = entry->first.begin(), animEnd = entry->first.end(); anim != animEnd; ++anim) {
+        for (QVector<AniData>::iterator anim = entry->first.begin(), animEnd = entry->first.end(); anim != animEnd; ++anim) {
             if (anim->id == animationId) {
                 entry->first.erase(anim); // remove the animation
                 if (entry->first.isEmpty()) { // no other animations on the window, release it.
+                    entry.key()->setEffectActive(this, false);
                     d->m_animations.erase(entry);
                 }
                 if (d->m_animations.isEmpty())
@@ -461,7 +472,7 @@ void AnimationEffect::prePaintWindow( EffectWindow* w, WindowPrePaintData& data,
     if ( entry != d->m_animations.constEnd() ) {
         bool isUsed = false;
         bool paintDeleted = false;
-        for (QList<AniData>::const_iterator anim = entry->first.constBegin(); anim != entry->first.constEnd(); ++anim) {
+        for (QVector<AniData>::const_iterator anim = entry->first.constBegin(); anim != entry->first.constEnd(); ++anim) {
             if (anim->startTime > clock() && !anim->waitAtSource)
                 continue;
 
@@ -469,7 +480,12 @@ void AnimationEffect::prePaintWindow( EffectWindow* w, WindowPrePaintData& data,
             if (anim->attribute == Opacity || anim->attribute == CrossFadePrevious)
                 data.setTranslucent();
             else if (!(anim->attribute == Brightness || anim->attribute == Saturation)) {
-                data.setTransformed();
+                // The layer rect covers every state the window passes through during the
+                // animations, unless the animated attribute is not known to the effect.
+                if (d->m_needSceneRepaint || entry->second.isNull())
+                    data.setTransformed();
+                else
+                    data.setTransformed(entry->second);
             }
 
             paintDeleted |= anim->keepAlive;
@@ -497,12 +513,18 @@ static inline float geometryCompensation(int flags, float v)
     return 0.5 * (1.0 - v); // half compensation
 }
 
+bool AnimationEffect::paintsActiveWindowsOnly() const
+{
+    // only the animated windows are touched by the window paint hooks
+    return true;
+}
+
 void AnimationEffect::paintWindow( EffectWindow* w, int mask, QRegion region, WindowPaintData& data )
 {
     Q_D(AnimationEffect);
     AniMap::const_iterator entry = d->m_animations.constFind( w );
     if ( entry != d->m_animations.constEnd() ) {
-        for ( QList<AniData>::const_iterator anim = entry->first.constBegin(); anim != entry->first.constEnd(); ++anim ) {
+        for ( QVector<AniData>::const_iterator anim = entry->first.constBegin(); anim != entry->first.constEnd(); ++anim ) {
 
             if (anim->startTime > clock() && !anim->waitAtSource)
                 continue;
@@ -645,6 +667,7 @@ void AnimationEffect::postPaintScreen()
         }
         if (entry->first.isEmpty()) {
             effects->addRepaint(entry->second);
+            entry.key()->setEffectActive(this, false);
             entry = d->m_animations.erase(entry);
         } else {
             if (invalidateLayerRect) {
@@ -797,7 +820,7 @@ void AnimationEffect::updateLayerRepaints()
         bool createRegion = false;
         QList<QRect> rects;
         QRect *layerRect = const_cast<QRect*>(&(entry->second));
-        for (QList<AniData>::const_iterator anim = entry->first.constBegin(), animEnd = entry->first.constEnd(); anim != animEnd; ++anim) {
+        for (QVector<AniData>::const_iterator anim = entry->first.constBegin(), animEnd = entry->first.constEnd(); anim != animEnd; ++anim) {
             if (anim->startTime > clock())
                 continue;
             switch (anim->attribute) {
@@ -917,7 +940,7 @@ void AnimationEffect::_windowClosed( EffectWindow* w )
 
     KeepAliveLockPtr keepAliveLock;
 
-    QList<AniData> &animations = (*it).first;
+    QVector<AniData> &animations = (*it).first;
     for (auto animationIt = animations.begin();
             animationIt != animations.end();
             ++animationIt) {
@@ -953,7 +976,7 @@ QString AnimationEffect::debug(const QString &/*parameter*/) const
             if (caption.isEmpty())
                 caption = QStringLiteral("[Untitled]");
             dbg += QLatin1String("Animating window: ") + caption + QLatin1Char('\n');
-            QList<AniData>::const_iterator anim = entry->first.constBegin(), animEnd = entry->first.constEnd();
+            QVector<AniData>::const_iterator anim = entry->first.constBegin(), animEnd = entry->first.constEnd();
             for (; anim != animEnd; ++anim)
                 dbg += anim->debugInfo();
         }
@@ -12,6 +12,7 @@
 #define ANIMATION_EFFECT_H
 
 #include <QEasingCurve>
+#include <QHash>
 #include <QElapsedTimer>
 #include <QtMath>
 #include <kwineffects.h>
@@ -201,6 +202,7 @@ public:
     void prePaintScreen( ScreenPrePaintData& data, std::chrono::milliseconds presentTime ) override;
     void prePaintWindow( EffectWindow* w, WindowPrePaintData& data, std::chrono::milliseconds presentTime ) override;
     void paintWindow( EffectWindow* w, int mask, QRegion region, WindowPaintData& data ) override;
+    bool paintsActiveWindowsOnly() const override;
     void postPaintScreen() override;
 
     /**
@@ -367,7 +369,7 @@ protected:
     /**
      * @internal
      */
-    typedef QMap<EffectWindow *, QPair<QList<AniData>, QRect> > AniMap;
+    typedef QHash<EffectWindow *, QPair<QVector<AniData>, QRect> > AniMap;
 
     /**
      * @internal
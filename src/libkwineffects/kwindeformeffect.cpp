@@ -5,9 +5,12 @@
 */
 
 #include "kwindeformeffect.h"
+#include "kwinglplatform.h"
 #include "kwingltexture.h"
 #include "kwinglutils.h"
 
+#include <QTextStream>
+
 namespace KWin
 {
 
@@ -25,8 +28,18 @@ public:
     QMetaObject::Connection windowDamagedConnection;
     QMetaObject::Connection windowDeletedConnection;
 
+    QScopedPointer<GLShader> deformShader;
+    bool deformShaderCreated = false;
+    QScopedPointer<GLVertexBuffer> grid;
+    QSize gridSize;
+
     void paint(EffectWindow *window, GLTexture *texture, const QRegion &region,
                const WindowPaintData &data, const WindowQuadList &quads);
+    void paintGrid(EffectWindow *window, GLTexture *texture, GLShader *shader, const QRegion &region,
+                   const WindowPaintData &data, const QRectF &visibleRect);
+
+    GLShader *shader(const QByteArray &deformSource);
+    void updateGrid(const QSize &size);
 
     GLTexture *maybeRender(EffectWindow *window, DeformOffscreenData *offscreenData);
 };
@@ -76,6 +89,112 @@ void DeformEffect::deform(EffectWindow *window, int mask, WindowPaintData &data,
     Q_UNUSED(quads)
 }
 
+QByteArray DeformEffect::deformSource() const
+{
+    return QByteArray();
+}
+
+QSize DeformEffect::deformGridSize() const
+{
+    return QSize(64, 64);
+}
+
+bool DeformEffect::setupDeformShader(EffectWindow *window, int mask, WindowPaintData &data, GLShader *shader)
+{
+    Q_UNUSED(window)
+    Q_UNUSED(mask)
+    Q_UNUSED(data)
+    Q_UNUSED(shader)
+    return true;
+}
+
+static QByteArray deformVertexSource(const QByteArray &deformSource)
+{
+    QByteArray source;
+    QTextStream stream(&source);
+
+    GLPlatform *const gl = GLPlatform::instance();
+    QByteArray attribute, varying;
+
+    if (!gl->isGLES()) {
+        const bool glsl_140 = gl->glslVersion() >= kVersionNumber(1, 40);
+
+        attribute = glsl_140 ? QByteArrayLiteral("in") : QByteArrayLiteral("attribute");
+        varying = glsl_140 ? QByteArrayLiteral("out") : QByteArrayLiteral("varying");
+
+        if (glsl_140) {
+            stream << "#version 140\n\n";
+        }
+    } else {
+        const bool glsl_es_300 = gl->glslVersion() >= kVersionNumber(3, 0);
+
+        attribute = glsl_es_300 ? QByteArrayLiteral("in") : QByteArrayLiteral("attribute");
+        varying = glsl_es_300 ? QByteArrayLiteral("out") : QByteArrayLiteral("varying");
+
+        if (glsl_es_300) {
+            stream << "#version 300 es\n\n";
+        }
+    }
+
+    // the grid holds normalized coordinates, which are also the texture coordinates
+    stream << attribute << " vec4 position;\n";
+    stream << varying << " vec2 texcoord0;\n\n";
+    stream << "uniform mat4 modelViewProjectionMatrix;\n";
+    stream << "uniform mat4 textureMatrix;\n";
+    stream << "uniform vec4 visibleRect;\n\n";
+    stream << deformSource << "\n\n";
+    stream << "void main()\n{\n";
+    stream << "    texcoord0 = (textureMatrix * vec4(position.xy, 0.0, 1.0)).st;\n";
+    stream << "    vec2 vertex = deformVertex(visibleRect.xy + position.xy * visibleRect.zw);\n";
+    stream << "    gl_Position = modelViewProjectionMatrix * vec4(vertex, 0.0, 1.0);\n";
+    stream << "}\n";
+
+    stream.flush();
+    return source;
+}
+
+GLShader *DeformEffectPrivate::shader(const QByteArray &deformSource)
+{
+    if (!deformShaderCreated) {
+        deformShaderCreated = true;
+        const ShaderTraits traits = ShaderTrait::MapTexture | ShaderTrait::Modulate | ShaderTrait::AdjustSaturation;
+        deformShader.reset(ShaderManager::instance()->generateCustomShader(traits, deformVertexSource(deformSource)));
+        if (!deformShader->isValid()) {
+            deformShader.reset();
+        }
+    }
+    return deformShader.data();
+}
+
+void DeformEffectPrivate::updateGrid(const QSize &size)
+{
+    if (grid && gridSize == size) {
+        return;
+    }
+    gridSize = size;
+
+    QVector<QVector2D> vertices;
+    vertices.reserve(size.width() * size.height() * 6);
+    for (int row = 0; row < size.height(); ++row) {
+        const float top = float(row) / size.height();
+        const float bottom = float(row + 1) / size.height();
+        for (int column = 0; column < size.width(); ++column) {
+            const float left = float(column) / size.width();
+            const float right = float(column + 1) / size.width();
+            vertices << QVector2D(left, top) << QVector2D(right, top) << QVector2D(right, bottom);
+            vertices << QVector2D(right, bottom) << QVector2D(left, bottom) << QVector2D(left, top);
+        }
+    }
+
+    const GLVertexAttrib attribs[] = {
+        { VA_Position, 2, GL_FLOAT, 0 },
+    };
+
+    grid.reset(new GLVertexBuffer(GLVertexBuffer::Static));
+    grid->setAttribLayout(attribs, 1, sizeof(QVector2D));
+    grid->setData(vertices.constData(), vertices.count() * sizeof(QVector2D));
+}
+
 GLTexture *DeformEffectPrivate::maybeRender(EffectWindow *window, DeformOffscreenData *offscreenData)
 {
     const QRect geometry = window->expandedGeometry();
@@ -163,6 +282,34 @@ void DeformEffectPrivate::paint(EffectWindow *window, GLTexture *texture, const
     vbo->unbindArrays();
 }
 
+void DeformEffectPrivate::paintGrid(EffectWindow *window, GLTexture *texture, GLShader *shader, const QRegion &region,
+                                    const WindowPaintData &data, const QRectF &visibleRect)
+{
+    grid->bindArrays();
+    glEnable(GL_SCISSOR_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    const qreal rgb = data.brightness() * data.opacity();
+    const qreal a = data.opacity();
+
+    QMatrix4x4 mvp = data.screenProjectionMatrix();
+    mvp.translate(window->x(), window->y());
+    shader->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
+    shader->setUniform(GLShader::TextureMatrix, texture->matrix(NormalizedCoordinates));
+    shader->setUniform(GLShader::ModulationConstant, QVector4D(rgb, rgb, rgb, a));
+    shader->setUniform(GLShader::Saturation, data.saturation());
+    shader->setUniform("visibleRect", QVector4D(visibleRect.x(), visibleRect.y(), visibleRect.width(), visibleRect.height()));
+
+    texture->bind();
+    grid->draw(region, GL_TRIANGLES, 0, gridSize.width() * gridSize.height() * 6, true);
+    texture->unbind();
+
+    glDisable(GL_BLEND);
+    glDisable(GL_SCISSOR_TEST);
+    grid->unbindArrays();
+}
+
 void DeformEffect::drawWindow(EffectWindow *window, int mask, const QRegion& region, WindowPaintData &data)
 {
     DeformOffscreenData *offscreenData = d->windows.value(window);
@@ -176,6 +323,21 @@ void DeformEffect::drawWindow(EffectWindow *window, int mask, const QRegion& reg
 
     QRectF visibleRect = expandedGeometry;
     visibleRect.moveTopLeft(expandedGeometry.topLeft() - frameGeometry.topLeft());
+
+    const QByteArray source = deformSource();
+    if (!source.isEmpty()) {
+        if (GLShader *shader = d->shader(source)) {
+            // the window has to be rendered before the deform shader gets bound
+            GLTexture *texture = d->maybeRender(window, offscreenData);
+            ShaderBinder binder(shader);
+            if (setupDeformShader(window, mask, data, shader)) {
+                d->updateGrid(deformGridSize());
+                d->paintGrid(window, texture, shader, region, data, visibleRect);
+                return;
+            }
+        }
+    }
+
     WindowQuad quad;
     quad[0] = WindowVertex(visibleRect.topLeft(), QPointF(0, 0));
     quad[1] = WindowVertex(visibleRect.topRight(), QPointF(1, 0));
@@ -26,6 +26,11 @@ class DeformEffectPrivate;
  * If a window is redirected into offscreen texture, the deform() function will be
  * called with the window quads that can be mutated by the effect. The effect can
  * sub-divide, remove, or transform the window quads.
+ *
+ * Alternatively, the effect can deform windows on the GPU by providing a GLSL function
+ * with deformSource(). Such windows are painted as a static grid of quads that is kept
+ * in a vertex buffer, the effect only needs to update the uniforms of the shader in
+ * setupDeformShader() every frame.
  */
 class KWINEFFECTS_EXPORT DeformEffect : public Effect
 {
@@ -57,6 +62,40 @@ protected:
      */
     virtual void deform(EffectWindow *window, int mask, WindowPaintData &data, WindowQuadList &quads);
 
+    /**
+     * Override this function to deform windows in a vertex shader rather than in deform().
+     * The returned GLSL source must define the function
+     *
+     * @code
+     * vec2 deformVertex(vec2 position)
+     * @endcode
+     *
+     * which maps the position of a vertex, relative to the top-left corner of the frame
+     * geometry, to its deformed position. The source can declare uniforms, which are set
+     * in setupDeformShader(). If an empty source is returned, which is the default, the
+     * window quads are deformed in deform().
+     *
+     * @since 5.25
+     */
+    virtual QByteArray deformSource() const;
+
+    /**
+     * Returns the number of columns and rows of the grid that is used to paint windows
+     * deformed with deformSource(). The default grid has 64x64 cells.
+     *
+     * @since 5.25
+     */
+    virtual QSize deformGridSize() const;
+
+    /**
+     * Override this function to set the uniforms of the deform shader for the specified
+     * @a window. The @a shader is bound when this function is called. Return @c false to
+     * deform the window in deform() instead.
+     *
+     * @since 5.25
+     */
+    virtual bool setupDeformShader(EffectWindow *window, int mask, WindowPaintData &data, GLShader *shader);
+
 private Q_SLOTS:
     void handleWindowDamaged(EffectWindow *window);
     void handleWindowDeleted(EffectWindow *window);
@@ -26,6 +26,8 @@
 
 #if defined(__SSE2__)
 #  include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#  include <arm_neon.h>
 #endif
 
 
@@ -42,6 +44,15 @@ void WindowPrePaintData::setTranslucent()
 void WindowPrePaintData::setTransformed()
 {
     mask |= Effect::PAINT_WINDOW_TRANSFORMED;
+    transformedRegion = infiniteRegion();
+}
+
+void WindowPrePaintData::setTransformed(const QRegion &region)
+{
+    mask |= Effect::PAINT_WINDOW_TRANSFORMED;
+    if (transformedRegion != infiniteRegion()) {
+        transformedRegion |= region;
+    }
 }
 
 class PaintDataPrivate {
@@ -211,6 +222,7 @@ public:
     qreal brightness;
     int screen;
     qreal crossFadeProgress;
+    bool backgroundContrastApplied = false;
     QMatrix4x4 pMatrix;
     QMatrix4x4 mvMatrix;
     QMatrix4x4 screenProjectionMatrix;
@@ -251,6 +263,7 @@ WindowPaintData::WindowPaintData(const WindowPaintData &other)
     setBrightness(other.brightness());
     setScreen(other.screen());
     setCrossFadeProgress(other.crossFadeProgress());
+    setBackgroundContrastApplied(other.isBackgroundContrastApplied());
     setProjectionMatrix(other.projectionMatrix());
     setModelViewMatrix(other.modelViewMatrix());
     d->screenProjectionMatrix = other.d->screenProjectionMatrix;
@@ -311,6 +324,16 @@ void WindowPaintData::setCrossFadeProgress(qreal factor)
     d->crossFadeProgress = qBound(qreal(0.0), factor, qreal(1.0));
 }
 
+bool WindowPaintData::isBackgroundContrastApplied() const
+{
+    return d->backgroundContrastApplied;
+}
+
+void WindowPaintData::setBackgroundContrastApplied(bool applied)
+{
+    d->backgroundContrastApplied = applied;
+}
+
 qreal WindowPaintData::multiplyOpacity(qreal factor)
 {
     d->opacity *= factor;
@@ -729,6 +752,16 @@ bool Effect::blocksDirectScanout() const
     return true;
 }
 
+bool Effect::wantsWindowsOnOtherOutputs() const
+{
+    return true;
+}
+
+bool Effect::paintsActiveWindowsOnly() const
+{
+    return false;
+}
+
 //****************************************
 // EffectFactory
 //****************************************
@@ -797,6 +830,8 @@ public:
     Private(EffectWindow *q);
 
     EffectWindow *q;
+    // there are rarely more than one or two, a vector is faster to search than a set
+    QVector<const Effect *> activeEffects;
 };
 
 EffectWindow::Private::Private(EffectWindow *q)
@@ -814,6 +849,22 @@ EffectWindow::~EffectWindow()
 {
 }
 
+void EffectWindow::setEffectActive(const Effect *effect, bool active)
+{
+    if (active) {
+        if (!d->activeEffects.contains(effect)) {
+            d->activeEffects.append(effect);
+        }
+    } else {
+        d->activeEffects.removeOne(effect);
+    }
+}
+
+bool EffectWindow::isEffectActive(const Effect *effect) const
+{
+    return d->activeEffects.contains(effect);
+}
+
 bool EffectWindow::isOnActivity(const QString &activity) const
 {
     const QStringList _activities = activities();
@@ -1095,6 +1146,11 @@ WindowQuadList WindowQuadList::makeRegularGrid(int xSubdivisions, int ySubdivisi
 #endif
 
 void WindowQuadList::makeInterleavedArrays(unsigned int type, GLVertex2D *vertices, const QMatrix4x4 &textureMatrix) const
+{
+    makeInterleavedArrays(type, vertices, textureMatrix, QVector2D());
+}
+
+void WindowQuadList::makeInterleavedArrays(unsigned int type, GLVertex2D *vertices, const QMatrix4x4 &textureMatrix, const QVector2D &translation) const
 {
     // Since we know that the texture matrix just scales and translates
     // we can use this information to optimize the transformation
@@ -1105,110 +1161,76 @@ void WindowQuadList::makeInterleavedArrays(unsigned int type, GLVertex2D *vertic
 
     Q_ASSERT(type == GL_QUADS || type == GL_TRIANGLES);
 
-    switch (type)
-    {
-    case GL_QUADS:
-#if defined(__SSE2__)
-        if (!(intptr_t(vertex) & 0xf)) {
-            for (const WindowQuad &quad : *this) {
-                alignas(16) GLVertex2D v[4];
-
-                for (int j = 0; j < 4; j++) {
-                    const WindowVertex &wv = quad[j];
-
-                    v[j].position = QVector2D(wv.x(), wv.y());
-                    v[j].texcoord = QVector2D(wv.u(), wv.v()) * coeff + offset;
-                }
+    // The order in which the vertices of a quad are written
+    static const int quadOrder[] = { 0, 1, 2, 3 };
+    static const int triangleOrder[] = { 1, 0, 3, 3, 2, 1 };
 
-                const __m128i *srcP = reinterpret_cast<const __m128i *>(&v);
-                __m128i *dstP = reinterpret_cast<__m128i *>(vertex);
+    const int *order = type == GL_QUADS ? quadOrder : triangleOrder;
+    const int count = type == GL_QUADS ? 4 : 6;
 
-                _mm_stream_si128(&dstP[0], _mm_load_si128(&srcP[0])); // Top-left
-                _mm_stream_si128(&dstP[1], _mm_load_si128(&srcP[1])); // Top-right
-                _mm_stream_si128(&dstP[2], _mm_load_si128(&srcP[2])); // Bottom-right
-                _mm_stream_si128(&dstP[3], _mm_load_si128(&srcP[3])); // Bottom-left
-
-                vertex += 4;
-            }
-        } else
-#endif // __SSE2__
-        {
-            for (const WindowQuad &quad : *this) {
-                for (int j = 0; j < 4; j++) {
-                    const WindowVertex &wv = quad[j];
-
-                    GLVertex2D v;
-                    v.position = QVector2D(wv.x(), wv.y());
-                    v.texcoord = QVector2D(wv.u(), wv.v()) * coeff + offset;
-
-                    *(vertex++) = v;
-                }
-            }
-        }
-        break;
-
-    case GL_TRIANGLES:
 #if defined(__SSE2__)
-        if (!(intptr_t(vertex) & 0xf)) {
-            for (const WindowQuad &quad : *this) {
-                alignas(16) GLVertex2D v[4];
+    if (!(intptr_t(vertex) & 0xf)) {
+        // Every vertex is converted from doubles to floats and transformed as a whole,
+        // the result is x, y, u, v, which is exactly the layout of a GLVertex2D.
+        const __m128 scale = _mm_setr_ps(1, 1, coeff.x(), coeff.y());
+        const __m128 bias = _mm_setr_ps(translation.x(), translation.y(), offset.x(), offset.y());
+
+        for (const WindowQuad &quad : *this) {
+            __m128 v[4];
+            for (int j = 0; j < 4; j++) {
+                const WindowVertex &wv = quad.verts[j];
+                const __m128 position = _mm_cvtpd_ps(_mm_loadu_pd(&wv.px));
+                const __m128 texcoord = _mm_cvtpd_ps(_mm_loadu_pd(&wv.tx));
+                v[j] = _mm_add_ps(_mm_mul_ps(_mm_movelh_ps(position, texcoord), scale), bias);
+            }
 
-                for (int j = 0; j < 4; j++) {
-                    const WindowVertex &wv = quad[j];
+            float *dst = reinterpret_cast<float *>(vertex);
+            for (int j = 0; j < count; j++) {
+                _mm_stream_ps(dst + j * 4, v[order[j]]);
+            }
 
-                    v[j].position = QVector2D(wv.x(), wv.y());
-                    v[j].texcoord = QVector2D(wv.u(), wv.v()) * coeff + offset;
-                }
+            vertex += count;
+        }
+        return;
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    {
+        const float32x4_t scale = { 1, 1, coeff.x(), coeff.y() };
+        const float32x4_t bias = { translation.x(), translation.y(), offset.x(), offset.y() };
+
+        for (const WindowQuad &quad : *this) {
+            float32x4_t v[4];
+            for (int j = 0; j < 4; j++) {
+                const WindowVertex &wv = quad.verts[j];
+                const float32x2_t position = vcvt_f32_f64(vld1q_f64(&wv.px));
+                const float32x2_t texcoord = vcvt_f32_f64(vld1q_f64(&wv.tx));
+                v[j] = vfmaq_f32(bias, vcombine_f32(position, texcoord), scale);
+            }
 
-                const __m128i *srcP = reinterpret_cast<const __m128i *>(&v);
-                __m128i *dstP = reinterpret_cast<__m128i *>(vertex);
+            float *dst = reinterpret_cast<float *>(vertex);
+            for (int j = 0; j < count; j++) {
+                vst1q_f32(dst + j * 4, v[order[j]]);
+            }
 
-                __m128i src[4];
-                src[0] = _mm_load_si128(&srcP[0]); // Top-left
-                src[1] = _mm_load_si128(&srcP[1]); // Top-right
-                src[2] = _mm_load_si128(&srcP[2]); // Bottom-right
-                src[3] = _mm_load_si128(&srcP[3]); // Bottom-left
+            vertex += count;
+        }
+        return;
+    }
+#endif
 
-                // First triangle
-                _mm_stream_si128(&dstP[0], src[1]); // Top-right
-                _mm_stream_si128(&dstP[1], src[0]); // Top-left
-                _mm_stream_si128(&dstP[2], src[3]); // Bottom-left
+    for (const WindowQuad &quad : *this) {
+        GLVertex2D v[4]; // Four unique vertices / quad
 
-                // Second triangle
-                _mm_stream_si128(&dstP[3], src[3]); // Bottom-left
-                _mm_stream_si128(&dstP[4], src[2]); // Bottom-right
-                _mm_stream_si128(&dstP[5], src[1]); // Top-right
+        for (int j = 0; j < 4; j++) {
+            const WindowVertex &wv = quad[j];
 
-                vertex += 6;
-            }
-        } else
-#endif // __SSE2__
-        {
-            for (const WindowQuad &quad : *this) {
-                GLVertex2D v[4]; // Four unique vertices / quad
-
-                for (int j = 0; j < 4; j++) {
-                    const WindowVertex &wv = quad[j];
-
-                    v[j].position = QVector2D(wv.x(), wv.y());
-                    v[j].texcoord = QVector2D(wv.u(), wv.v()) * coeff + offset;
-                }
-
-                // First triangle
-                *(vertex++) = v[1]; // Top-right
-                *(vertex++) = v[0]; // Top-left
-                *(vertex++) = v[3]; // Bottom-left
-
-                // Second triangle
-                *(vertex++) = v[3]; // Bottom-left
-                *(vertex++) = v[2]; // Bottom-right
-                *(vertex++) = v[1]; // Top-right
-            }
+            v[j].position = QVector2D(wv.x(), wv.y()) + translation;
+            v[j].texcoord = QVector2D(wv.u(), wv.v()) * coeff + offset;
         }
-        break;
 
-    default:
-        break;
+        for (int j = 0; j < count; j++) {
+            *(vertex++) = v[order[j]];
+        }
     }
 }
 
@@ -1579,6 +1601,11 @@ public:
     bool done = false;
     RedirectMode sourceRedirectMode = RedirectMode::Relaxed;
     RedirectMode targetRedirectMode = RedirectMode::Strict;
+
+    // Evaluating the easing curve is costly, especially for custom curves, and effects
+    // query the value many times per frame, so it's cached until the timeline changes.
+    mutable qreal value = 0;
+    mutable bool valueDirty = true;
 };
 
 TimeLine::TimeLine(std::chrono::milliseconds duration, Direction direction)
@@ -1603,9 +1630,13 @@ qreal TimeLine::progress() const
 
 qreal TimeLine::value() const
 {
-    const qreal t = progress();
-    return d->easingCurve.valueForProgress(
-        d->direction == Backward ? 1.0 - t : t);
+    if (d->valueDirty) {
+        const qreal t = progress();
+        d->value = d->easingCurve.valueForProgress(
+            d->direction == Backward ? 1.0 - t : t);
+        d->valueDirty = false;
+    }
+    return d->value;
 }
 
 void TimeLine::update(std::chrono::milliseconds delta)
@@ -1619,6 +1650,7 @@ void TimeLine::update(std::chrono::milliseconds delta)
         d->done = true;
         d->elapsed = d->duration;
     }
+    d->valueDirty = true;
 }
 
 std::chrono::milliseconds TimeLine::elapsed() const
@@ -1652,6 +1684,7 @@ void TimeLine::setDuration(std::chrono::milliseconds duration)
     if (d->elapsed == d->duration) {
         d->done = true;
     }
+    d->valueDirty = true;
 }
 
 TimeLine::Direction TimeLine::direction() const
@@ -1679,6 +1712,7 @@ void TimeLine::setDirection(TimeLine::Direction direction)
     if (d->elapsed >= d->duration) {
         d->done = true;
     }
+    d->valueDirty = true;
 }
 
 void TimeLine::toggleDirection()
@@ -1694,11 +1728,13 @@ QEasingCurve TimeLine::easingCurve() const
 void TimeLine::setEasingCurve(const QEasingCurve &easingCurve)
 {
     d->easingCurve = easingCurve;
+    d->valueDirty = true;
 }
 
 void TimeLine::setEasingCurve(QEasingCurve::Type type)
 {
     d->easingCurve.setType(type);
+    d->valueDirty = true;
 }
 
 bool TimeLine::running() const
@@ -1716,6 +1752,7 @@ void TimeLine::reset()
 {
     d->elapsed = std::chrono::milliseconds::zero();
     d->done = false;
+    d->valueDirty = true;
 }
 
 TimeLine::RedirectMode TimeLine::sourceRedirectMode() const
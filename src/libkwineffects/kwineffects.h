@@ -32,6 +32,7 @@
 #include <QHash>
 #include <QStack>
 #include <QScopedPointer>
+#include <QSharedPointer>
 
 #include <KPluginFactory>
 #include <KSharedConfig>
@@ -74,6 +75,7 @@ class EffectScreen;
 class Effect;
 class WindowQuad;
 class GLShader;
+class GLTexture;
 class WindowQuadList;
 class WindowPrePaintData;
 class WindowPaintData;
@@ -175,7 +177,7 @@ X-KDE-Library=kwin4_effect_cooleffect
 
 #define KWIN_EFFECT_API_MAKE_VERSION( major, minor ) (( major ) << 8 | ( minor ))
 #define KWIN_EFFECT_API_VERSION_MAJOR 0
-#define KWIN_EFFECT_API_VERSION_MINOR 233
+#define KWIN_EFFECT_API_VERSION_MINOR 237
 #define KWIN_EFFECT_API_VERSION KWIN_EFFECT_API_MAKE_VERSION( \
         KWIN_EFFECT_API_VERSION_MAJOR, KWIN_EFFECT_API_VERSION_MINOR )
 
@@ -194,7 +196,8 @@ enum DataRole {
     WindowBlurBehindRole, ///< For single windows to blur behind
     WindowForceBackgroundContrastRole, ///< For fullscreen effects to enforce the background contrast,
     WindowBackgroundContrastRole, ///< For single windows to enable Background contrast
-    LanczosCacheRole
+    LanczosCacheRole,
+    WindowBackgroundContrastMatrixRole, ///< The color matrix of the background contrast, @since 5.25
 };
 
 /**
@@ -705,6 +708,29 @@ public:
      */
     virtual bool blocksDirectScanout() const;
 
+    /**
+     * Reimplement this method to return @c false if your effect never transforms windows and
+     * doesn't need prePaintWindow() and postPaintWindow() to be called for windows that are
+     * not visible on the output being painted. Windows outside the painted output are culled
+     * only while every active effect returns @c false, since the scene can't tell in advance
+     * whether an effect will move or scale a window onto the output.
+     *
+     * The default implementation returns @c true.
+     *
+     * @since 5.25
+     */
+    virtual bool wantsWindowsOnOtherOutputs() const;
+
+    /**
+     * Reimplement this method to return @c true if your effect affects only a few windows at a
+     * time. The window paint hooks of such an effect, i.e. prePaintWindow(), paintWindow(),
+     * postPaintWindow() and drawWindow(), are called only for the windows that the effect has
+     * been marked active for with EffectWindow::setEffectActive().
+     *
+     * @since 5.25
+     */
+    virtual bool paintsActiveWindowsOnly() const;
+
 public Q_SLOTS:
     virtual bool borderActivated(ElectricBorder border);
 
@@ -1429,6 +1455,21 @@ public:
      */
     virtual void renderScreen(EffectScreen *screen) = 0;
 
+    /**
+     * Returns a texture with what has been painted so far in @p rect of the current render
+     * target, in logical screen coordinates. Effects that sample the same part of the screen
+     * before anything else gets painted share a single copy. @p textureRect is set to the
+     * logical rect the texture covers, it contains @p rect.
+     *
+     * The texture stays valid until the scene paints a window or an effect frame over @p rect,
+     * or the screen is done painting. It is reused for later copies after that. Effects that
+     * draw into @p rect themselves don't invalidate the copy.
+     *
+     * Returns a null pointer if OpenGL compositing is not used.
+     * @since 5.25
+     */
+    virtual QSharedPointer<GLTexture> framebufferTexture(const QRect &rect, QRect *textureRect) = 0;
+
 Q_SIGNALS:
     /**
      * This signal is emitted whenever a new @a screen is added to the system.
@@ -1927,6 +1968,36 @@ public:
     Q_ENUM(Transform)
     virtual Transform transform() const = 0;
 
+    /**
+     * Returns the moving average of the time between pointer motion events and the
+     * presentation of the frames that show the moved cursor on this screen. Returns zero
+     * if the latency is unknown, e.g. because the cursor is drawn by the hardware.
+     *
+     * @since 5.25
+     */
+    virtual std::chrono::microseconds inputLatency() const = 0;
+
+    /**
+     * This enum type specifies how expensive the effects may be when painting a screen.
+     *
+     * @since 5.25
+     */
+    enum class RenderQuality {
+        High, ///< Effects can render at full quality
+        Medium, ///< Frames often miss their deadline, expensive passes should be toned down
+        Low, ///< Frames keep missing their deadline, effects should take the cheapest path
+    };
+    Q_ENUM(RenderQuality)
+
+    /**
+     * Returns the quality that effects should render at on this screen. The compositor
+     * lowers the quality if painting the screen repeatedly takes longer than the refresh
+     * interval, and raises it again when there is enough headroom.
+     *
+     * @since 5.25
+     */
+    virtual RenderQuality renderQuality() const = 0;
+
 Q_SIGNALS:
     /**
      * Notifies that the display will be dimmed in @p time ms.
@@ -1962,6 +2033,13 @@ Q_SIGNALS:
      * Be it because it gets a transformation or moved around.
      */
     void changed();
+
+    /**
+     * This signal is emitted when the render quality of this screen changes.
+     *
+     * @since 5.25
+     */
+    void renderQualityChanged();
 };
 
 /**
@@ -2354,6 +2432,14 @@ public:
      */
     virtual QRect bufferGeometry() const = 0;
     virtual QRect clientGeometry() const = 0;
+    /**
+     * Returns the frame geometry that the window is going to have once the client has
+     * applied the last requested geometry change. If there is no pending geometry change,
+     * this is the same as frameGeometry().
+     *
+     * @since 5.25
+     */
+    virtual QRect pendingFrameGeometry() const = 0;
     /**
      * Geometry of the window including decoration and potentially shadows.
      * May be different from geometry() if the window has a shadow.
@@ -2625,6 +2711,22 @@ public:
      */
     virtual void unreferencePreviousWindowPixmap() = 0;
 
+    /**
+     * Marks the effect @p effect as active or inactive for this window. This is only
+     * relevant for effects that return @c true from Effect::paintsActiveWindowsOnly().
+     *
+     * @see isEffectActive
+     * @since 5.25
+     */
+    void setEffectActive(const Effect *effect, bool active);
+    /**
+     * Returns @c true if @p effect has been marked as active for this window.
+     *
+     * @see setEffectActive
+     * @since 5.25
+     */
+    bool isEffectActive(const Effect *effect) const;
+
 private:
     class Private;
     QScopedPointer<Private> d;
@@ -2710,6 +2812,11 @@ public:
     WindowQuadList makeGrid(int maxquadsize) const;
     WindowQuadList makeRegularGrid(int xSubdivisions, int ySubdivisions) const;
     void makeInterleavedArrays(unsigned int type, GLVertex2D *vertices, const QMatrix4x4 &matrix) const;
+    /**
+     * Same as above, but additionally offsets the position of every vertex by @a translation.
+     * @since 5.25
+     */
+    void makeInterleavedArrays(unsigned int type, GLVertex2D *vertices, const QMatrix4x4 &matrix, const QVector2D &translation) const;
     void makeArrays(float** vertices, float** texcoords, const QSizeF &size, bool yInverted) const;
 };
 
@@ -2726,6 +2833,14 @@ public:
      * I.e. window will definitely cover it's clip region
      */
     QRegion clip;
+    /**
+     * The area of the screen that the window covers after it has been transformed, in
+     * screen coordinates. It is empty if the window is not transformed and infinite if
+     * an effect has transformed the window without telling where it is painted, in
+     * which case the whole screen will be repainted.
+     * @since 5.25
+     */
+    QRegion transformedRegion;
     /**
      * Simple helper that sets data to say the window will be painted as non-opaque.
      * Takes also care of changing the regions.
@@ -2735,6 +2850,13 @@ public:
      * Helper to mark that this window will be transformed
      */
     void setTransformed();
+    /**
+     * Marks the window as transformed and painted within @a region, in screen coordinates.
+     * Unlike setTransformed(), it lets the scene repaint only the damaged parts of the
+     * screen while the window is transformed.
+     * @since 5.25
+     */
+    void setTransformed(const QRegion &region);
 };
 
 class KWINEFFECTS_EXPORT PaintData
@@ -3039,6 +3161,18 @@ public:
      */
     qreal crossFadeProgress() const;
 
+    /**
+     * Marks that the background contrast behind the window has already been applied, e.g.
+     * by the blur effect while it drew the blurred background, so it's not applied twice.
+     * @since 5.25
+     */
+    void setBackgroundContrastApplied(bool applied);
+    /**
+     * @see setBackgroundContrastApplied
+     * @since 5.25
+     */
+    bool isBackgroundContrastApplied() const;
+
     /**
      * Sets the projection matrix that will be used when painting the window.
      *
@@ -1041,7 +1041,8 @@ void GLPlatform::detect(OpenGLPlatformInterface platformInterface)
             m_recommendedCompositor = OpenGLCompositing;
         }
 
-        if (driver() == Driver_R600G ||
+        // The gallium drivers bind the pixmap's buffer directly, rebinding copies nothing
+        if (driver() == Driver_R600G || driver() == Driver_RadeonSI ||
                 (driver() == Driver_R600C && m_renderer.contains("DRI2"))) {
             m_looseBinding = true;
         }
@@ -23,6 +23,8 @@
 #include <QVector3D>
 #include <QVector4D>
 
+#include <cstring>
+
 namespace KWin
 {
 
@@ -36,6 +38,9 @@ bool GLTexturePrivate::s_supportsUnpack = false;
 bool GLTexturePrivate::s_supportsTextureStorage = false;
 bool GLTexturePrivate::s_supportsTextureSwizzle = false;
 bool GLTexturePrivate::s_supportsTextureFormatRG = false;
+bool GLTexturePrivate::s_supportsPixelUnpackBuffers = false;
+QVector<GLTexturePrivate::PixelUnpackBuffer> GLTexturePrivate::s_pixelUnpackBuffers;
+int GLTexturePrivate::s_nextPixelUnpackBuffer = 0;
 uint GLTexturePrivate::s_fbo = 0;
 
 // Table of GL formats/types associated with different values of QImage::Format.
@@ -92,6 +97,12 @@ GLTexture::GLTexture(const GLTexture& tex)
 {
 }
 
+GLTexture &GLTexture::operator=(const GLTexture &tex)
+{
+    d_ptr = tex.d_ptr;
+    return *this;
+}
+
 GLTexture::GLTexture(const QImage& image, GLenum target)
     : d_ptr(new GLTexturePrivate())
 {
@@ -300,26 +311,31 @@ void GLTexturePrivate::initStatic()
 {
     if (!GLPlatform::instance()->isGLES()) {
         s_supportsFramebufferObjects = hasGLVersion(3, 0) ||
-            hasGLExtension("GL_ARB_framebuffer_object") || hasGLExtension(QByteArrayLiteral("GL_EXT_framebuffer_object"));
-        s_supportsTextureStorage = hasGLVersion(4, 2) || hasGLExtension(QByteArrayLiteral("GL_ARB_texture_storage"));
-        s_supportsTextureSwizzle = hasGLVersion(3, 3) || hasGLExtension(QByteArrayLiteral("GL_ARB_texture_swizzle"));
+            hasGLExtension(GLExtension::ARB_framebuffer_object) || hasGLExtension(GLExtension::EXT_framebuffer_object);
+        s_supportsTextureStorage = hasGLVersion(4, 2) || hasGLExtension(GLExtension::ARB_texture_storage);
+        s_supportsTextureSwizzle = hasGLVersion(3, 3) || hasGLExtension(GLExtension::ARB_texture_swizzle);
         // see https://www.opengl.org/registry/specs/ARB/texture_rg.txt
-        s_supportsTextureFormatRG = hasGLVersion(3, 0) || hasGLExtension(QByteArrayLiteral("GL_ARB_texture_rg"));
+        s_supportsTextureFormatRG = hasGLVersion(3, 0) || hasGLExtension(GLExtension::ARB_texture_rg);
         s_supportsARGB32 = true;
         s_supportsUnpack = true;
+        s_supportsPixelUnpackBuffers = (hasGLVersion(3, 0) || (hasGLExtension(GLExtension::ARB_pixel_buffer_object)
+                                                               && hasGLExtension(GLExtension::ARB_map_buffer_range)))
+            && (hasGLVersion(3, 2) || hasGLExtension(GLExtension::ARB_sync));
     } else {
         s_supportsFramebufferObjects = true;
-        s_supportsTextureStorage = hasGLVersion(3, 0) || hasGLExtension(QByteArrayLiteral("GL_EXT_texture_storage"));
+        s_supportsTextureStorage = hasGLVersion(3, 0) || hasGLExtension(GLExtension::EXT_texture_storage);
         s_supportsTextureSwizzle = hasGLVersion(3, 0);
         // see https://www.khronos.org/registry/gles/extensions/EXT/EXT_texture_rg.txt
-        s_supportsTextureFormatRG = hasGLVersion(3, 0) || hasGLExtension(QByteArrayLiteral("GL_EXT_texture_rg"));
+        s_supportsTextureFormatRG = hasGLVersion(3, 0) || hasGLExtension(GLExtension::EXT_texture_rg);
 
         // QImage::Format_ARGB32_Premultiplied is a packed-pixel format, so it's only
         // equivalent to GL_BGRA/GL_UNSIGNED_BYTE on little-endian systems.
         s_supportsARGB32 = QSysInfo::ByteOrder == QSysInfo::LittleEndian &&
-            hasGLExtension(QByteArrayLiteral("GL_EXT_texture_format_BGRA8888"));
+            hasGLExtension(GLExtension::EXT_texture_format_BGRA8888);
 
-        s_supportsUnpack = hasGLExtension(QByteArrayLiteral("GL_EXT_unpack_subimage"));
+        // GL_UNPACK_ROW_LENGTH and friends are part of OpenGL ES 3.0.
+        s_supportsUnpack = hasGLVersion(3, 0) || hasGLExtension(GLExtension::EXT_unpack_subimage);
+        s_supportsPixelUnpackBuffers = hasGLVersion(3, 0);
     }
 }
 
@@ -327,10 +343,73 @@ void GLTexturePrivate::cleanup()
 {
     s_supportsFramebufferObjects = false;
     s_supportsARGB32 = false;
+    s_supportsPixelUnpackBuffers = false;
     if (s_fbo) {
         glDeleteFramebuffers(1, &s_fbo);
         s_fbo = 0;
     }
+    for (const PixelUnpackBuffer &buffer : qAsConst(s_pixelUnpackBuffers)) {
+        if (buffer.fence) {
+            glDeleteSync(buffer.fence);
+        }
+        glDeleteBuffers(1, &buffer.buffer);
+    }
+    s_pixelUnpackBuffers.clear();
+    s_nextPixelUnpackBuffer = 0;
+}
+
+int GLTexturePrivate::acquirePixelUnpackBuffer(GLsizeiptr size)
+{
+    // Grow the buffers in steps so they don't have to be reallocated for every damage size.
+    static constexpr GLsizeiptr sizeAlignment = 64 * 1024;
+    const GLsizeiptr allocationSize = (size + sizeAlignment - 1) / sizeAlignment * sizeAlignment;
+
+    // A few buffers are enough to keep the uploads of consecutive frames from waiting
+    // for each other.
+    static constexpr int maxBufferCount = 4;
+
+    int index = -1;
+    for (int i = 0; i < s_pixelUnpackBuffers.count(); ++i) {
+        PixelUnpackBuffer &buffer = s_pixelUnpackBuffers[i];
+        if (buffer.fence) {
+            GLint status;
+            glGetSynciv(buffer.fence, GL_SYNC_STATUS, 1, nullptr, &status);
+            if (status != GL_SIGNALED) {
+                continue;
+            }
+            glDeleteSync(buffer.fence);
+            buffer.fence = nullptr;
+        }
+        index = i;
+        break;
+    }
+
+    if (index == -1) {
+        if (s_pixelUnpackBuffers.count() < maxBufferCount) {
+            PixelUnpackBuffer buffer;
+            glGenBuffers(1, &buffer.buffer);
+            s_pixelUnpackBuffers.append(buffer);
+            index = s_pixelUnpackBuffers.count() - 1;
+        } else {
+            // All buffers are still being read by the GPU. Let the driver allocate new
+            // storage for one of them rather than waiting.
+            index = s_nextPixelUnpackBuffer;
+            s_nextPixelUnpackBuffer = (s_nextPixelUnpackBuffer + 1) % maxBufferCount;
+
+            PixelUnpackBuffer &buffer = s_pixelUnpackBuffers[index];
+            glDeleteSync(buffer.fence);
+            buffer.fence = nullptr;
+            buffer.size = 0;
+        }
+    }
+
+    PixelUnpackBuffer &buffer = s_pixelUnpackBuffers[index];
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.buffer);
+    if (buffer.size < size) {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, allocationSize, nullptr, GL_STREAM_DRAW);
+        buffer.size = allocationSize;
+    }
+    return index;
 }
 
 bool GLTexture::isNull() const
@@ -355,6 +434,33 @@ void GLTexture::setSize(const QSize &size)
     d->updateMatrix();
 }
 
+// Returns the format in which the pixels of @a image are uploaded, along with the matching
+// GL format and type.
+static QImage::Format uploadFormatForImage(const QImage &image, GLenum *glFormat, GLenum *type)
+{
+    if (!GLPlatform::instance()->isGLES()) {
+        const QImage::Format index = image.format();
+
+        if (index < sizeof(formatTable) / sizeof(formatTable[0]) && formatTable[index].internalFormat) {
+            *glFormat = formatTable[index].format;
+            *type = formatTable[index].type;
+            return index;
+        }
+        *glFormat = GL_BGRA;
+        *type = GL_UNSIGNED_INT_8_8_8_8_REV;
+        return QImage::Format_ARGB32_Premultiplied;
+    }
+
+    if (GLTexturePrivate::s_supportsARGB32) {
+        *glFormat = GL_BGRA_EXT;
+        *type = GL_UNSIGNED_BYTE;
+        return QImage::Format_ARGB32_Premultiplied;
+    }
+    *glFormat = GL_RGBA;
+    *type = GL_UNSIGNED_BYTE;
+    return QImage::Format_RGBA8888_Premultiplied;
+}
+
 void GLTexture::update(const QImage &image, const QPoint &offset, const QRect &src)
 {
     if (image.isNull() || isNull())
@@ -365,30 +471,7 @@ void GLTexture::update(const QImage &image, const QPoint &offset, const QRect &s
 
     GLenum glFormat;
     GLenum type;
-    QImage::Format uploadFormat;
-    if (!GLPlatform::instance()->isGLES()) {
-        const QImage::Format index = image.format();
-
-        if (index < sizeof(formatTable) / sizeof(formatTable[0]) && formatTable[index].internalFormat) {
-            glFormat = formatTable[index].format;
-            type = formatTable[index].type;
-            uploadFormat = index;
-        } else {
-            glFormat = GL_BGRA;
-            type = GL_UNSIGNED_INT_8_8_8_8_REV;
-            uploadFormat = QImage::Format_ARGB32_Premultiplied;
-        }
-    } else {
-        if (d->s_supportsARGB32) {
-            glFormat = GL_BGRA_EXT;
-            type = GL_UNSIGNED_BYTE;
-            uploadFormat = QImage::Format_ARGB32_Premultiplied;
-        } else {
-            glFormat = GL_RGBA;
-            type = GL_UNSIGNED_BYTE;
-            uploadFormat = QImage::Format_RGBA8888_Premultiplied;
-        }
-    }
+    const QImage::Format uploadFormat = uploadFormatForImage(image, &glFormat, &type);
     bool useUnpack = d->s_supportsUnpack && image.format() == uploadFormat && !src.isNull();
 
     QImage im;
@@ -429,6 +512,95 @@ void GLTexture::update(const QImage &image, const QPoint &offset, const QRect &s
     }
 }
 
+// Returns a few rects that cover @a region. Every upload has a fixed cost, so uploading some
+// pixels that haven't changed is cheaper than uploading many small rects.
+static QVector<QRect> uploadRects(const QRegion &region)
+{
+    static constexpr int maxRectCount = 8;
+
+    const QRect bounds = region.boundingRect();
+    qint64 area = 0;
+    for (const QRect &rect : region) {
+        area += qint64(rect.width()) * rect.height();
+    }
+    if (region.rectCount() > maxRectCount || qint64(bounds.width()) * bounds.height() <= area * 5 / 4) {
+        return {bounds};
+    }
+    return QVector<QRect>(region.begin(), region.end());
+}
+
+void GLTexture::update(const QImage &image, const QRegion &region)
+{
+    if (image.isNull() || isNull()) {
+        return;
+    }
+
+    const QVector<QRect> rects = uploadRects(region & image.rect());
+    if (rects.constFirst().isEmpty()) {
+        return;
+    }
+
+    Q_D(GLTexture);
+    Q_ASSERT(!d->m_foreign);
+
+    GLenum glFormat;
+    GLenum type;
+    const QImage::Format uploadFormat = uploadFormatForImage(image, &glFormat, &type);
+    const int bytesPerPixel = image.depth() / 8;
+    if (!d->s_supportsPixelUnpackBuffers || !d->s_supportsUnpack || image.format() != uploadFormat
+            || image.depth() % 8 || image.bytesPerLine() % bytesPerPixel) {
+        for (const QRect &rect : rects) {
+            update(image, rect.topLeft(), rect);
+        }
+        return;
+    }
+
+    // Every rect is copied as a single contiguous span of the image's rows and uploaded
+    // with the image's row length, so no rows have to be repacked.
+    const int stride = image.bytesPerLine();
+    QVector<GLintptr> offsets;
+    offsets.reserve(rects.count());
+    GLsizeiptr size = 0;
+    for (const QRect &rect : rects) {
+        offsets.append(size);
+        const GLsizeiptr spanSize = GLsizeiptr(rect.height() - 1) * stride + rect.width() * bytesPerPixel;
+        size += (spanSize + 15) & ~GLsizeiptr(15);
+    }
+
+    const int index = GLTexturePrivate::acquirePixelUnpackBuffer(size);
+    GLTexturePrivate::PixelUnpackBuffer &pixelBuffer = GLTexturePrivate::s_pixelUnpackBuffers[index];
+
+    // The buffer is not in use by the GPU anymore, it doesn't need to be synchronized.
+    uchar *map = static_cast<uchar *>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                                       GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+    if (!map) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        for (const QRect &rect : rects) {
+            update(image, rect.topLeft(), rect);
+        }
+        return;
+    }
+    for (int i = 0; i < rects.count(); ++i) {
+        const QRect &rect = rects[i];
+        const uchar *source = image.constBits() + qint64(rect.y()) * stride + rect.x() * bytesPerPixel;
+        memcpy(map + offsets[i], source, GLsizeiptr(rect.height() - 1) * stride + rect.width() * bytesPerPixel);
+    }
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    bind();
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, stride / bytesPerPixel);
+    for (int i = 0; i < rects.count(); ++i) {
+        const QRect &rect = rects[i];
+        glTexSubImage2D(d->m_target, 0, rect.x(), rect.y(), rect.width(), rect.height(), glFormat, type,
+                        reinterpret_cast<const void *>(offsets[i]));
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    unbind();
+
+    pixelBuffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
 void GLTexture::discard()
 {
     d_ptr = new GLTexturePrivate();
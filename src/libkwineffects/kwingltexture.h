@@ -43,6 +43,11 @@ class KWINGLUTILS_EXPORT GLTexture
 public:
     explicit GLTexture(GLenum target);
     GLTexture(const GLTexture& tex);
+    /**
+     * Makes this texture share the GL texture of @a tex.
+     * @since 5.25
+     */
+    GLTexture &operator=(const GLTexture &tex);
     explicit GLTexture(const QImage& image, GLenum target = GL_TEXTURE_2D);
     explicit GLTexture(const QPixmap& pixmap, GLenum target = GL_TEXTURE_2D);
     explicit GLTexture(const QString& fileName);
@@ -100,6 +105,16 @@ public:
     QMatrix4x4 matrix(TextureCoordinateType type) const;
 
     void update(const QImage& image, const QPoint &offset = QPoint(0, 0), const QRect &src = QRect());
+    /**
+     * Uploads the parts of @a image within @a region to the same position in the texture.
+     *
+     * The region is merged into a few rects that cover it. If pixel buffer objects and
+     * fences are supported, the pixels are copied to a pixel buffer and the upload
+     * doesn't wait for the GPU to finish using the previous contents of the texture.
+     *
+     * @since 5.25
+     */
+    void update(const QImage &image, const QRegion &region);
     virtual void discard();
     void bind();
     void unbind();
@@ -20,6 +20,7 @@
 #include <QSharedData>
 #include <QImage>
 #include <QMatrix4x4>
+#include <QVector>
 #include <epoxy/gl.h>
 
 namespace KWin
@@ -62,6 +63,21 @@ public:
 
     static void initStatic();
 
+    /**
+     * Returns the index of a pixel unpack buffer that can hold at least @a size bytes and
+     * is not in use by the GPU anymore. The buffer is bound to GL_PIXEL_UNPACK_BUFFER.
+     */
+    static int acquirePixelUnpackBuffer(GLsizeiptr size);
+
+    struct PixelUnpackBuffer {
+        GLuint buffer = 0;
+        GLsync fence = nullptr;
+        GLsizeiptr size = 0;
+    };
+    static QVector<PixelUnpackBuffer> s_pixelUnpackBuffers;
+    static int s_nextPixelUnpackBuffer;
+    static bool s_supportsPixelUnpackBuffers;
+
     static bool s_supportsFramebufferObjects;
     static bool s_supportsARGB32;
     static bool s_supportsUnpack;
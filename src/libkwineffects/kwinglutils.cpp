@@ -20,14 +20,22 @@
 #include <QPixmap>
 #include <QImage>
 #include <QHash>
+#include <QSet>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
 #include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
 #include <QVector2D>
 #include <QVector3D>
 #include <QVector4D>
 #include <QMatrix4x4>
 #include <QVarLengthArray>
 
+#include <algorithm>
 #include <array>
+#include <bitset>
 #include <cmath>
 #include <deque>
 
@@ -46,6 +54,42 @@ namespace KWin
 // Variables
 // List of all supported GL extensions
 static QList<QByteArray> glExtensions;
+// The GLExtensions the driver supports
+static std::bitset<int(GLExtension::Count)> glExtensionBits;
+
+// Must be kept in the same order as the GLExtension enum
+static const char *const s_glExtensionNames[] = {
+    "GL_ARB_buffer_storage",
+    "GL_ARB_copy_buffer",
+    "GL_ARB_debug_output",
+    "GL_ARB_draw_elements_base_vertex",
+    "GL_ARB_framebuffer_object",
+    "GL_ARB_get_program_binary",
+    "GL_ARB_map_buffer_range",
+    "GL_ARB_pixel_buffer_object",
+    "GL_ARB_robustness",
+    "GL_ARB_sync",
+    "GL_ARB_texture_rg",
+    "GL_ARB_texture_storage",
+    "GL_ARB_texture_swizzle",
+    "GL_ARB_timer_query",
+    "GL_ARB_vertex_array_object",
+    "GL_EXT_buffer_storage",
+    "GL_EXT_framebuffer_blit",
+    "GL_EXT_framebuffer_object",
+    "GL_EXT_gpu_shader4",
+    "GL_EXT_map_buffer_range",
+    "GL_EXT_robustness",
+    "GL_EXT_texture_format_BGRA8888",
+    "GL_EXT_texture_rg",
+    "GL_EXT_texture_storage",
+    "GL_EXT_unpack_subimage",
+    "GL_EXT_x11_sync_object",
+    "GL_KHR_debug",
+    "GL_OES_draw_elements_base_vertex",
+    "GL_OES_EGL_image",
+};
+static_assert(std::size(s_glExtensionNames) == size_t(GLExtension::Count), "s_glExtensionNames is out of sync with GLExtension");
 
 
 // Functions
@@ -57,8 +101,8 @@ static void initDebugOutput()
         return;
     }
 
-    const bool have_KHR_debug = hasGLExtension(QByteArrayLiteral("GL_KHR_debug"));
-    const bool have_ARB_debug = hasGLExtension(QByteArrayLiteral("GL_ARB_debug_output"));
+    const bool have_KHR_debug = hasGLExtension(GLExtension::KHR_debug);
+    const bool have_ARB_debug = hasGLExtension(GLExtension::ARB_debug_output);
     if (!have_KHR_debug && !have_ARB_debug)
         return;
 
@@ -144,6 +188,11 @@ void initGL(const std::function<resolveFuncPtr(const char*)> &resolveFunction)
     } else
         glExtensions = QByteArray((const char*)glGetString(GL_EXTENSIONS)).split(' ');
 
+    const QSet<QByteArray> extensions(glExtensions.constBegin(), glExtensions.constEnd());
+    for (size_t i = 0; i < std::size(s_glExtensionNames); ++i) {
+        glExtensionBits[i] = extensions.contains(QByteArray::fromRawData(s_glExtensionNames[i], qstrlen(s_glExtensionNames[i])));
+    }
+
     // handle OpenGL extensions functions
     glResolveFunctions(resolveFunction);
 
@@ -157,12 +206,14 @@ void initGL(const std::function<resolveFuncPtr(const char*)> &resolveFunction)
 void cleanupGL()
 {
     ShaderManager::cleanup();
+    GLStateTracker::cleanup();
     GLTexturePrivate::cleanup();
     GLRenderTarget::cleanup();
     GLVertexBuffer::cleanup();
     GLPlatform::cleanup();
 
     glExtensions.clear();
+    glExtensionBits.reset();
 }
 
 bool hasGLVersion(int major, int minor, int release)
@@ -175,6 +226,11 @@ bool hasGLExtension(const QByteArray &extension)
     return glExtensions.contains(extension);
 }
 
+bool hasGLExtension(GLExtension extension)
+{
+    return glExtensionBits.test(int(extension));
+}
+
 QList<QByteArray> openGLExtensions()
 {
     return glExtensions;
@@ -265,6 +321,7 @@ bool GLShader::link()
 {
     // Be optimistic
     mValid = true;
+    mCachedUniforms = 0;
 
     glLinkProgram(mProgram);
 
@@ -382,7 +439,7 @@ void GLShader::bindAttributeLocation(const char *name, int index)
 
 void GLShader::bindFragDataLocation(const char *name, int index)
 {
-    if (!GLPlatform::instance()->isGLES() && (hasGLVersion(3, 0) || hasGLExtension(QByteArrayLiteral("GL_EXT_gpu_shader4"))))
+    if (!GLPlatform::instance()->isGLES() && (hasGLVersion(3, 0) || hasGLExtension(GLExtension::EXT_gpu_shader4)))
         glBindFragDataLocation(mProgram, index, name);
 }
 
@@ -414,6 +471,8 @@ void GLShader::resolveLocations()
 
     mFloatLocation[Saturation]    = uniformLocation("saturation");
 
+    mIntLocation[AlphaToOne] = -1;
+
     mColorLocation[Color] = uniformLocation("geometryColor");
 
     mLocationsResolved = true;
@@ -425,46 +484,92 @@ int GLShader::uniformLocation(const char *name)
     return location;
 }
 
+// The bit of each built-in uniform in mCachedUniforms.
+static constexpr int s_matrixCacheIndex = 0;
+static constexpr int s_vec2CacheIndex = s_matrixCacheIndex + GLShader::MatrixCount;
+static constexpr int s_vec4CacheIndex = s_vec2CacheIndex + GLShader::Vec2UniformCount;
+static constexpr int s_floatCacheIndex = s_vec4CacheIndex + GLShader::Vec4UniformCount;
+static constexpr int s_intCacheIndex = s_floatCacheIndex + GLShader::FloatUniformCount;
+static constexpr int s_colorCacheIndex = s_intCacheIndex + GLShader::IntUniformCount;
+static_assert(s_colorCacheIndex + GLShader::ColorUniformCount <= 32, "mCachedUniforms is too small");
+
+template<typename T>
+bool GLShader::setCachedUniform(int location, int cacheIndex, T &cachedValue, const T &value)
+{
+    if (location < 0) {
+        return false;
+    }
+    const quint32 bit = 1u << cacheIndex;
+    if ((mCachedUniforms & bit) && cachedValue == value) {
+        GLStateTracker::instance()->recordCall(false);
+        return true;
+    }
+    GLStateTracker::instance()->recordCall(true);
+    setUniform(location, value);
+    cachedValue = value;
+    mCachedUniforms |= bit;
+    return true;
+}
+
+void GLShader::forgetCachedUniform(int location)
+{
+    if (!mCachedUniforms || location < 0) {
+        return;
+    }
+    auto forget = [this, location](const int *locations, int count, int cacheIndex) {
+        for (int i = 0; i < count; ++i) {
+            if (locations[i] == location) {
+                mCachedUniforms &= ~(1u << (cacheIndex + i));
+            }
+        }
+    };
+    forget(mMatrixLocation, MatrixCount, s_matrixCacheIndex);
+    forget(mVec2Location, Vec2UniformCount, s_vec2CacheIndex);
+    forget(mVec4Location, Vec4UniformCount, s_vec4CacheIndex);
+    forget(mFloatLocation, FloatUniformCount, s_floatCacheIndex);
+    forget(mIntLocation, IntUniformCount, s_intCacheIndex);
+    forget(mColorLocation, ColorUniformCount, s_colorCacheIndex);
+}
+
 bool GLShader::setUniform(GLShader::MatrixUniform uniform, const QMatrix4x4 &matrix)
 {
     resolveLocations();
-    return setUniform(mMatrixLocation[uniform], matrix);
+    return setCachedUniform(mMatrixLocation[uniform], s_matrixCacheIndex + uniform, mMatrixValue[uniform], matrix);
 }
 
 bool GLShader::setUniform(GLShader::Vec2Uniform uniform, const QVector2D &value)
 {
     resolveLocations();
-    return setUniform(mVec2Location[uniform], value);
+    return setCachedUniform(mVec2Location[uniform], s_vec2CacheIndex + uniform, mVec2Value[uniform], value);
 }
 
 bool GLShader::setUniform(GLShader::Vec4Uniform uniform, const QVector4D &value)
 {
     resolveLocations();
-    return setUniform(mVec4Location[uniform], value);
+    return setCachedUniform(mVec4Location[uniform], s_vec4CacheIndex + uniform, mVec4Value[uniform], value);
 }
 
 bool GLShader::setUniform(GLShader::FloatUniform uniform, float value)
 {
     resolveLocations();
-    return setUniform(mFloatLocation[uniform], value);
+    return setCachedUniform(mFloatLocation[uniform], s_floatCacheIndex + uniform, mFloatValue[uniform], value);
 }
 
 bool GLShader::setUniform(GLShader::IntUniform uniform, int value)
 {
     resolveLocations();
-    return setUniform(mIntLocation[uniform], value);
+    return setCachedUniform(mIntLocation[uniform], s_intCacheIndex + uniform, mIntValue[uniform], value);
 }
 
 bool GLShader::setUniform(GLShader::ColorUniform uniform, const QVector4D &value)
 {
     resolveLocations();
-    return setUniform(mColorLocation[uniform], value);
+    return setCachedUniform(mColorLocation[uniform], s_colorCacheIndex + uniform, mColorValue[uniform], value);
 }
 
 bool GLShader::setUniform(GLShader::ColorUniform uniform, const QColor &value)
 {
-    resolveLocations();
-    return setUniform(mColorLocation[uniform], value);
+    return setUniform(uniform, QVector4D(value.redF(), value.greenF(), value.blueF(), value.alphaF()));
 }
 
 bool GLShader::setUniform(const char *name, float value)
@@ -512,6 +617,7 @@ bool GLShader::setUniform(const char *name, const QColor& color)
 bool GLShader::setUniform(int location, float value)
 {
     if (location >= 0) {
+        forgetCachedUniform(location);
         glUniform1f(location, value);
     }
     return (location >= 0);
@@ -520,6 +626,7 @@ bool GLShader::setUniform(int location, float value)
 bool GLShader::setUniform(int location, int value)
 {
     if (location >= 0) {
+        forgetCachedUniform(location);
         glUniform1i(location, value);
     }
     return (location >= 0);
@@ -528,6 +635,7 @@ bool GLShader::setUniform(int location, int value)
 bool GLShader::setUniform(int location, const QVector2D &value)
 {
     if (location >= 0) {
+        forgetCachedUniform(location);
         glUniform2fv(location, 1, (const GLfloat*)&value);
     }
     return (location >= 0);
@@ -536,6 +644,7 @@ bool GLShader::setUniform(int location, const QVector2D &value)
 bool GLShader::setUniform(int location, const QVector3D &value)
 {
     if (location >= 0) {
+        forgetCachedUniform(location);
         glUniform3fv(location, 1, (const GLfloat*)&value);
     }
     return (location >= 0);
@@ -544,6 +653,7 @@ bool GLShader::setUniform(int location, const QVector3D &value)
 bool GLShader::setUniform(int location, const QVector4D &value)
 {
     if (location >= 0) {
+        forgetCachedUniform(location);
         glUniform4fv(location, 1, (const GLfloat*)&value);
     }
     return (location >= 0);
@@ -552,6 +662,7 @@ bool GLShader::setUniform(int location, const QVector4D &value)
 bool GLShader::setUniform(int location, const QMatrix4x4 &value)
 {
     if (location >= 0) {
+        forgetCachedUniform(location);
         glUniformMatrix4fv(location, 1, GL_FALSE, value.constData());
     }
     return (location >= 0);
@@ -560,6 +671,7 @@ bool GLShader::setUniform(int location, const QMatrix4x4 &value)
 bool GLShader::setUniform(int location, const QColor &color)
 {
     if (location >= 0) {
+        forgetCachedUniform(location);
         glUniform4f(location, color.redF(), color.greenF(), color.blueF(), color.alphaF());
     }
     return (location >= 0);
@@ -597,6 +709,105 @@ QMatrix4x4 GLShader::getUniformMatrix4x4(const char* name)
     }
 }
 
+//****************************************
+// GLStateTracker
+//****************************************
+GLStateTracker *GLStateTracker::s_stateTracker = nullptr;
+
+GLStateTracker *GLStateTracker::instance()
+{
+    if (!s_stateTracker) {
+        s_stateTracker = new GLStateTracker();
+    }
+    return s_stateTracker;
+}
+
+void GLStateTracker::cleanup()
+{
+    delete s_stateTracker;
+    s_stateTracker = nullptr;
+}
+
+void GLStateTracker::recordCall(bool changed)
+{
+    m_statistics.calls++;
+    if (changed) {
+        m_statistics.changes++;
+    }
+}
+
+void GLStateTracker::setBlendEnabled(bool enabled)
+{
+    const bool changed = m_blendEnabled != enabled;
+    recordCall(changed);
+    if (!changed) {
+        return;
+    }
+    if (enabled) {
+        glEnable(GL_BLEND);
+    } else {
+        glDisable(GL_BLEND);
+    }
+    m_blendEnabled = enabled;
+}
+
+void GLStateTracker::setBlendFunc(GLenum source, GLenum destination)
+{
+    const std::pair<GLenum, GLenum> blendFunc(source, destination);
+    const bool changed = m_blendFunc != blendFunc;
+    recordCall(changed);
+    if (changed) {
+        glBlendFunc(source, destination);
+        m_blendFunc = blendFunc;
+    }
+}
+
+void GLStateTracker::setScissorTestEnabled(bool enabled)
+{
+    const bool changed = m_scissorTestEnabled != enabled;
+    recordCall(changed);
+    if (!changed) {
+        return;
+    }
+    if (enabled) {
+        glEnable(GL_SCISSOR_TEST);
+    } else {
+        glDisable(GL_SCISSOR_TEST);
+    }
+    m_scissorTestEnabled = enabled;
+}
+
+void GLStateTracker::setScissor(int x, int y, int width, int height)
+{
+    const QRect box(x, y, width, height);
+    const bool changed = m_scissor != box;
+    recordCall(changed);
+    if (changed) {
+        glScissor(x, y, width, height);
+        m_scissor = box;
+    }
+}
+
+void GLStateTracker::invalidate()
+{
+    m_blendFunc.reset();
+    m_scissor.reset();
+}
+
+void GLStateTracker::beginFrame()
+{
+    invalidate();
+    m_blendEnabled.reset();
+    m_scissorTestEnabled.reset();
+    m_frameStatistics = m_statistics;
+    m_statistics = Statistics();
+}
+
+GLStateTracker::Statistics GLStateTracker::frameStatistics() const
+{
+    return m_frameStatistics;
+}
+
 //****************************************
 // ShaderManager
 //****************************************
@@ -616,8 +827,47 @@ void ShaderManager::cleanup()
     s_shaderManager = nullptr;
 }
 
+// Bump whenever the layout of the cache files changes.
+static const quint32 s_programBinaryCacheVersion = 1;
+
+static bool programBinarySupported()
+{
+    if (!GLPlatform::instance()->supports(GLSL)) {
+        return false;
+    }
+    if (GLPlatform::instance()->isGLES()) {
+        if (!hasGLVersion(3, 0)) {
+            return false;
+        }
+    } else if (!hasGLVersion(4, 1) && !hasGLExtension(GLExtension::ARB_get_program_binary)) {
+        return false;
+    }
+
+    // Some drivers advertise the entry points without supporting a single binary format.
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    return formatCount > 0;
+}
+
 ShaderManager::ShaderManager()
 {
+    if (qEnvironmentVariableIsSet("KWIN_GL_SHADER_CACHE") && !qEnvironmentVariableIntValue("KWIN_GL_SHADER_CACHE")) {
+        return;
+    }
+    if (!programBinarySupported()) {
+        return;
+    }
+
+    const QString cacheLocation = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation);
+    if (cacheLocation.isEmpty()) {
+        return;
+    }
+    const QString directory = cacheLocation + QLatin1String("/kwin/shaders");
+    if (!QDir().mkpath(directory)) {
+        qCWarning(LIBKWINGLUTILS) << "Failed to create the shader cache directory" << directory;
+        return;
+    }
+    m_programBinaryCacheDirectory = directory;
 }
 
 ShaderManager::~ShaderManager()
@@ -767,16 +1017,114 @@ GLShader *ShaderManager::generateCustomShader(ShaderTraits traits, const QByteAr
 #endif
 
     GLShader *shader = new GLShader(GLShader::ExplicitLinking);
+
+    QByteArray programBinary;
+    if (!m_programBinaryCacheDirectory.isEmpty()) {
+        programBinary = programBinaryKey(shader, vertex, fragment);
+        if (loadProgramBinary(shader, programBinary)) {
+            return shader;
+        }
+    }
+
     shader->load(vertex, fragment);
 
     shader->bindAttributeLocation("position", VA_Position);
     shader->bindAttributeLocation("texcoord", VA_TexCoord);
     shader->bindFragDataLocation("fragColor", 0);
 
-    shader->link();
+    if (!programBinary.isEmpty()) {
+        glProgramParameteri(shader->mProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    if (shader->link() && !programBinary.isEmpty()) {
+        saveProgramBinary(shader, programBinary);
+    }
     return shader;
 }
 
+QByteArray ShaderManager::programBinaryKey(GLShader *shader, const QByteArray &vertexSource, const QByteArray &fragmentSource) const
+{
+    // A program binary is only valid for the exact driver build that produced it, so the
+    // driver identification is part of the key. The attribute and frag data locations are
+    // baked into the binary as well, but they are the same for every generated shader.
+    const GLPlatform *gl = GLPlatform::instance();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(gl->glVendorString());
+    hash.addData(gl->glRendererString());
+    hash.addData(gl->glVersionString());
+    hash.addData(gl->glShadingLanguageVersionString());
+    if (!vertexSource.isEmpty()) {
+        hash.addData(shader->prepareSource(GL_VERTEX_SHADER, vertexSource));
+    }
+    hash.addData(QByteArrayLiteral("\0"));
+    if (!fragmentSource.isEmpty()) {
+        hash.addData(shader->prepareSource(GL_FRAGMENT_SHADER, fragmentSource));
+    }
+    return hash.result().toHex();
+}
+
+bool ShaderManager::loadProgramBinary(GLShader *shader, const QByteArray &key) const
+{
+    QFile file(m_programBinaryCacheDirectory + QLatin1Char('/') + QString::fromLatin1(key));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream stream(&file);
+    quint32 version;
+    quint32 format;
+    QByteArray binary;
+    stream >> version >> format >> binary;
+    if (stream.status() != QDataStream::Ok || version != s_programBinaryCacheVersion || binary.isEmpty()) {
+        file.remove();
+        return false;
+    }
+
+    glProgramBinary(shader->mProgram, format, binary.constData(), binary.size());
+
+    GLint status = 0;
+    glGetProgramiv(shader->mProgram, GL_LINK_STATUS, &status);
+    if (!status) {
+        // The driver can reject binaries at any time, e.g. after an update that didn't
+        // change the version string. Drop the stale entry, it will be regenerated.
+        qCDebug(LIBKWINGLUTILS) << "Discarding rejected program binary" << file.fileName();
+        file.remove();
+        return false;
+    }
+
+    shader->mValid = true;
+    return true;
+}
+
+void ShaderManager::saveProgramBinary(GLShader *shader, const QByteArray &key) const
+{
+    GLint length = 0;
+    glGetProgramiv(shader->mProgram, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    QByteArray binary(length, Qt::Uninitialized);
+    GLenum format = 0;
+    glGetProgramBinary(shader->mProgram, length, &length, &format, binary.data());
+    if (length <= 0) {
+        return;
+    }
+    binary.truncate(length);
+
+    // Write atomically, another compositor instance may be reading the cache concurrently.
+    QSaveFile file(m_programBinaryCacheDirectory + QLatin1Char('/') + QString::fromLatin1(key));
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    QDataStream stream(&file);
+    stream << s_programBinaryCacheVersion << quint32(format) << binary;
+    if (!file.commit()) {
+        qCWarning(LIBKWINGLUTILS) << "Failed to write program binary" << file.fileName();
+    }
+}
+
 static QString resolveShaderFilePath(const QString &filePath)
 {
     QString suffix;
@@ -839,6 +1187,13 @@ GLShader *ShaderManager::shader(ShaderTraits traits)
     return shader;
 }
 
+void ShaderManager::warmUp(const QVector<ShaderTraits> &traits)
+{
+    for (const ShaderTraits &shaderTraits : traits) {
+        shader(shaderTraits);
+    }
+}
+
 GLShader *ShaderManager::getBoundShader() const
 {
     if (m_boundShaders.isEmpty()) {
@@ -923,12 +1278,12 @@ void GLRenderTarget::initStatic()
         s_blitSupported = hasGLVersion(3, 0);
     } else {
         sSupported = hasGLVersion(3, 0) ||
-            hasGLExtension(QByteArrayLiteral("GL_ARB_framebuffer_object")) ||
-            hasGLExtension(QByteArrayLiteral("GL_EXT_framebuffer_object"));
+            hasGLExtension(GLExtension::ARB_framebuffer_object) ||
+            hasGLExtension(GLExtension::EXT_framebuffer_object);
 
         s_blitSupported = hasGLVersion(3, 0) ||
-            hasGLExtension(QByteArrayLiteral("GL_ARB_framebuffer_object")) ||
-            hasGLExtension(QByteArrayLiteral("GL_EXT_framebuffer_blit"));
+            hasGLExtension(GLExtension::ARB_framebuffer_object) ||
+            hasGLExtension(GLExtension::EXT_framebuffer_blit);
     }
 }
 
@@ -944,6 +1299,11 @@ bool GLRenderTarget::isRenderTargetBound()
     return !s_renderTargets.isEmpty();
 }
 
+GLRenderTarget *GLRenderTarget::currentRenderTarget()
+{
+    return s_renderTargets.isEmpty() ? nullptr : s_renderTargets.top();
+}
+
 bool GLRenderTarget::blitSupported()
 {
     return s_blitSupported;
@@ -1575,6 +1935,10 @@ public:
         return sum / Count;
     }
 
+    size_t maximum() const {
+        return *std::max_element(m_array.cbegin(), m_array.cend());
+    }
+
 private:
     std::array<size_t, Count> m_array;
     int m_index = 0;
@@ -1632,6 +1996,7 @@ public:
     GLvoid *mapNextFreeRange(size_t size);
     void reallocatePersistentBuffer(size_t size);
     bool awaitFence(intptr_t offset);
+    bool isRangeIdle(intptr_t end);
     GLvoid *getIdleRange(size_t size);
 
     GLuint buffer;
@@ -1659,6 +2024,7 @@ public:
     VertexAttrib attrib[VertexAttributeCount];
     Bitfield enabledArrays;
     static IndexBuffer *s_indexBuffer;
+    static constexpr size_t s_maxPersistentBufferSize = 64 * 1024 * 1024;
 };
 
 bool GLVertexBufferPrivate::hasMapBufferRange = false;
@@ -1747,8 +2113,9 @@ void GLVertexBufferPrivate::reallocatePersistentBuffer(size_t size)
     if (buffer == 0)
         glGenBuffers(1, &buffer);
 
-    // Round the size up to 64 kb
-    size_t minSize = qMax<size_t>(frameSizes.average() * 3, 128 * 1024);
+    // Keep room for three frames in flight, so uploads never have to wait for the GPU
+    // unless a frame is much larger than the recent ones. Round the size up to 64 kb
+    size_t minSize = qMax<size_t>(frameSizes.maximum() * 3, 128 * 1024);
     bufferSize = align(qMax(size, minSize), 64 * 1024);
 
     const GLbitfield storage = GL_DYNAMIC_STORAGE_BIT;
@@ -1795,6 +2162,17 @@ bool GLVertexBufferPrivate::awaitFence(intptr_t end)
     return true;
 }
 
+bool GLVertexBufferPrivate::isRangeIdle(intptr_t end)
+{
+    // Retire the fences that have already been signaled without waiting for the others
+    while (bufferEnd < end && !fences.empty() && fences.front().signaled()) {
+        glDeleteSync(fences.front().sync);
+        bufferEnd = fences.front().nextEnd;
+        fences.pop_front();
+    }
+    return bufferEnd >= end;
+}
+
 GLvoid *GLVertexBufferPrivate::getIdleRange(size_t size)
 {
     if (unlikely(size > bufferSize))
@@ -1816,8 +2194,14 @@ GLvoid *GLVertexBufferPrivate::getIdleRange(size_t size)
     }
 
     if (unlikely(nextOffset + intptr_t(size) > bufferEnd)) {
-        if (!awaitFence(nextOffset + size))
+        // If the GPU still reads from the range, switch to a bigger buffer instead of stalling.
+        // The driver keeps the old storage alive until the pending draw calls are done with it
+        if (!isRangeIdle(nextOffset + size) && bufferSize < s_maxPersistentBufferSize) {
+            qCDebug(LIBKWINGLUTILS) << "Growing the streaming VBO to avoid a stall";
+            reallocatePersistentBuffer(bufferSize * 2);
+        } else if (!awaitFence(nextOffset + size)) {
             return nullptr;
+        }
     }
 
     return map + nextOffset;
@@ -2016,6 +2400,8 @@ void GLVertexBuffer::draw(GLenum primitiveMode, int first, int count)
 
 void GLVertexBuffer::draw(const QRegion &region, GLenum primitiveMode, int first, int count, bool hardwareClipping)
 {
+    GLStateTracker *stateTracker = GLStateTracker::instance();
+
     if (primitiveMode == GL_QUADS) {
         IndexBuffer *&indexBuffer = GLVertexBufferPrivate::s_indexBuffer;
 
@@ -2032,10 +2418,10 @@ void GLVertexBuffer::draw(const QRegion &region, GLenum primitiveMode, int first
         } else {
             // Clip using scissoring
             for (const QRect &r : region) {
-                glScissor((r.x() - s_virtualScreenGeometry.x()) * s_virtualScreenScale,
-                (s_virtualScreenGeometry.height() + s_virtualScreenGeometry.y() - r.y() - r.height()) * s_virtualScreenScale,
-                r.width() * s_virtualScreenScale,
-                r.height() * s_virtualScreenScale);
+                stateTracker->setScissor((r.x() - s_virtualScreenGeometry.x()) * s_virtualScreenScale,
+                                         (s_virtualScreenGeometry.height() + s_virtualScreenGeometry.y() - r.y() - r.height()) * s_virtualScreenScale,
+                                         r.width() * s_virtualScreenScale,
+                                         r.height() * s_virtualScreenScale);
                 glDrawElementsBaseVertex(GL_TRIANGLES, count, GL_UNSIGNED_SHORT, nullptr, first);
             }
         }
@@ -2047,10 +2433,10 @@ void GLVertexBuffer::draw(const QRegion &region, GLenum primitiveMode, int first
     } else {
         // Clip using scissoring
         for (const QRect &r : region) {
-            glScissor((r.x() - s_virtualScreenGeometry.x()) * s_virtualScreenScale,
-                      (s_virtualScreenGeometry.height()  + s_virtualScreenGeometry.y() - r.y() - r.height()) * s_virtualScreenScale,
-                      r.width() * s_virtualScreenScale,
-                      r.height() * s_virtualScreenScale);
+            stateTracker->setScissor((r.x() - s_virtualScreenGeometry.x()) * s_virtualScreenScale,
+                                     (s_virtualScreenGeometry.height() + s_virtualScreenGeometry.y() - r.y() - r.height()) * s_virtualScreenScale,
+                                     r.width() * s_virtualScreenScale,
+                                     r.height() * s_virtualScreenScale);
             glDrawArrays(primitiveMode, first, count);
         }
     }
@@ -2095,8 +2481,8 @@ void GLVertexBuffer::endOfFrame()
         d->frameSize = 0;
 
         // Force the buffer to be reallocated at the beginning of the next frame
-        // if the average frame size is greater than half the size of the buffer
-        if (unlikely(d->frameSizes.average() > d->bufferSize / 2)) {
+        // if it can't hold three of the recent frames
+        if (unlikely(d->frameSizes.maximum() * 3 > d->bufferSize)) {
             deleteAll(d->fences);
             glDeleteBuffers(1, &d->buffer);
 
@@ -2132,23 +2518,23 @@ void GLVertexBuffer::beginFrame()
 void GLVertexBuffer::initStatic()
 {
     if (GLPlatform::instance()->isGLES()) {
-        bool haveBaseVertex     = hasGLExtension(QByteArrayLiteral("GL_OES_draw_elements_base_vertex"));
+        bool haveBaseVertex     = hasGLExtension(GLExtension::OES_draw_elements_base_vertex);
         bool haveCopyBuffer     = hasGLVersion(3, 0);
-        bool haveMapBufferRange = hasGLExtension(QByteArrayLiteral("GL_EXT_map_buffer_range"));
+        bool haveMapBufferRange = hasGLExtension(GLExtension::EXT_map_buffer_range);
 
         GLVertexBufferPrivate::hasMapBufferRange = haveMapBufferRange;
         GLVertexBufferPrivate::supportsIndexedQuads = haveBaseVertex && haveCopyBuffer && haveMapBufferRange;
-        GLVertexBufferPrivate::haveBufferStorage = hasGLExtension("GL_EXT_buffer_storage");
+        GLVertexBufferPrivate::haveBufferStorage = hasGLExtension(GLExtension::EXT_buffer_storage);
         GLVertexBufferPrivate::haveSyncFences = hasGLVersion(3, 0);
     } else {
-        bool haveBaseVertex     = hasGLVersion(3, 2) || hasGLExtension(QByteArrayLiteral("GL_ARB_draw_elements_base_vertex"));
-        bool haveCopyBuffer     = hasGLVersion(3, 1) || hasGLExtension(QByteArrayLiteral("GL_ARB_copy_buffer"));
-        bool haveMapBufferRange = hasGLVersion(3, 0) || hasGLExtension(QByteArrayLiteral("GL_ARB_map_buffer_range"));
+        bool haveBaseVertex     = hasGLVersion(3, 2) || hasGLExtension(GLExtension::ARB_draw_elements_base_vertex);
+        bool haveCopyBuffer     = hasGLVersion(3, 1) || hasGLExtension(GLExtension::ARB_copy_buffer);
+        bool haveMapBufferRange = hasGLVersion(3, 0) || hasGLExtension(GLExtension::ARB_map_buffer_range);
 
         GLVertexBufferPrivate::hasMapBufferRange = haveMapBufferRange;
         GLVertexBufferPrivate::supportsIndexedQuads = haveBaseVertex && haveCopyBuffer && haveMapBufferRange;
-        GLVertexBufferPrivate::haveBufferStorage = hasGLVersion(4, 4) || hasGLExtension("GL_ARB_buffer_storage");
-        GLVertexBufferPrivate::haveSyncFences = hasGLVersion(3, 2) || hasGLExtension("GL_ARB_sync");
+        GLVertexBufferPrivate::haveBufferStorage = hasGLVersion(4, 4) || hasGLExtension(GLExtension::ARB_buffer_storage);
+        GLVertexBufferPrivate::haveSyncFences = hasGLVersion(3, 2) || hasGLExtension(GLExtension::ARB_sync);
     }
     GLVertexBufferPrivate::s_indexBuffer = nullptr;
     GLVertexBufferPrivate::streamingBuffer = new GLVertexBuffer(GLVertexBuffer::Stream);
@@ -17,8 +17,13 @@
 #include "kwingltexture.h"
 
 // Qt
+#include <QMatrix4x4>
 #include <QSize>
 #include <QStack>
+#include <QVector2D>
+#include <QVector4D>
+
+#include <optional>
 
 /** @addtogroup kwineffects */
 /** @{ */
@@ -50,6 +55,47 @@ bool KWINGLUTILS_EXPORT hasGLVersion(int major, int minor, int release = 0);
 // use for both OpenGL and GLX extensions
 bool KWINGLUTILS_EXPORT hasGLExtension(const QByteArray &extension);
 
+/**
+ * The OpenGL extensions KWin checks for. Looking one of them up with
+ * hasGLExtension(GLExtension) is a bit test, the availability is determined
+ * once in initGL().
+ *
+ * @since 5.25
+ */
+enum class GLExtension {
+    ARB_buffer_storage,
+    ARB_copy_buffer,
+    ARB_debug_output,
+    ARB_draw_elements_base_vertex,
+    ARB_framebuffer_object,
+    ARB_get_program_binary,
+    ARB_map_buffer_range,
+    ARB_pixel_buffer_object,
+    ARB_robustness,
+    ARB_sync,
+    ARB_texture_rg,
+    ARB_texture_storage,
+    ARB_texture_swizzle,
+    ARB_timer_query,
+    ARB_vertex_array_object,
+    EXT_buffer_storage,
+    EXT_framebuffer_blit,
+    EXT_framebuffer_object,
+    EXT_gpu_shader4,
+    EXT_map_buffer_range,
+    EXT_robustness,
+    EXT_texture_format_BGRA8888,
+    EXT_texture_rg,
+    EXT_texture_storage,
+    EXT_unpack_subimage,
+    EXT_x11_sync_object,
+    KHR_debug,
+    OES_draw_elements_base_vertex,
+    OES_EGL_image,
+    Count ///< The number of extensions, not an extension
+};
+bool KWINGLUTILS_EXPORT hasGLExtension(GLExtension extension);
+
 // detect OpenGL error (add to various places in code to pinpoint the place)
 bool KWINGLUTILS_EXPORT checkGLError(const char* txt);
 
@@ -155,6 +201,10 @@ protected:
     void resolveLocations();
 
 private:
+    template<typename T>
+    bool setCachedUniform(int location, int cacheIndex, T &cachedValue, const T &value);
+    void forgetCachedUniform(int location);
+
     unsigned int mProgram;
     bool mValid:1;
     bool mLocationsResolved:1;
@@ -166,6 +216,16 @@ private:
     int mIntLocation[IntUniformCount];
     int mColorLocation[ColorUniformCount];
 
+    // The last values that were uploaded to the built-in uniforms. Uniforms are part of
+    // the program object, so the cache stays valid when switching between shaders.
+    QMatrix4x4 mMatrixValue[MatrixCount];
+    QVector2D mVec2Value[Vec2UniformCount];
+    QVector4D mVec4Value[Vec4UniformCount];
+    float mFloatValue[FloatUniformCount];
+    int mIntValue[IntUniformCount];
+    QVector4D mColorValue[ColorUniformCount];
+    quint32 mCachedUniforms = 0;
+
     friend class ShaderManager;
 };
 
@@ -287,6 +347,14 @@ public:
      */
     static ShaderManager *instance();
 
+    /**
+     * Generates the shaders with the given @a traits ahead of time, so the first frame that
+     * needs them doesn't stall on compiling and linking. Shaders that exist already are skipped.
+     *
+     * @since 5.25
+     */
+    void warmUp(const QVector<ShaderTraits> &traits);
+
     /**
      * @internal
      */
@@ -296,6 +364,10 @@ private:
     ShaderManager();
     ~ShaderManager();
 
+    QByteArray programBinaryKey(GLShader *shader, const QByteArray &vertexSource, const QByteArray &fragmentSource) const;
+    bool loadProgramBinary(GLShader *shader, const QByteArray &key) const;
+    void saveProgramBinary(GLShader *shader, const QByteArray &key) const;
+
     void bindFragDataLocations(GLShader *shader);
     void bindAttributeLocations(GLShader *shader) const;
 
@@ -305,6 +377,7 @@ private:
 
     QStack<GLShader*> m_boundShaders;
     QHash<ShaderTraits, GLShader *> m_shaderHash;
+    QString m_programBinaryCacheDirectory;
     static ShaderManager *s_shaderManager;
 };
 
@@ -379,6 +452,86 @@ GLShader* ShaderBinder::shader()
     return m_shader;
 }
 
+/**
+ * The GLStateTracker class shadows the OpenGL state that is changed most often while
+ * painting windows, and drops the calls that wouldn't change anything.
+ *
+ * Only the blending and scissor state is tracked. Code that changes the blend function or
+ * the scissor box with plain GL calls must call invalidate() before the tracker is used
+ * again. Blending and the scissor test may be toggled with plain GL calls as long as they
+ * are restored afterwards.
+ *
+ * The tracker also counts the requests it receives, including uniform updates through
+ * GLShader::setUniform(), which is useful to find redundant state changes.
+ *
+ * @since 5.25
+ */
+class KWINGLUTILS_EXPORT GLStateTracker
+{
+public:
+    struct Statistics
+    {
+        /**
+         * The number of state changes that were requested.
+         */
+        quint64 calls = 0;
+        /**
+         * The number of requested state changes that actually reached OpenGL.
+         */
+        quint64 changes = 0;
+    };
+
+    void setBlendEnabled(bool enabled);
+    void setBlendFunc(GLenum source, GLenum destination);
+    void setScissorTestEnabled(bool enabled);
+    /**
+     * Sets the scissor box in framebuffer coordinates.
+     */
+    void setScissor(int x, int y, int width, int height);
+
+    /**
+     * Forgets the blend function and the scissor box.
+     */
+    void invalidate();
+
+    /**
+     * Forgets all tracked state and starts counting the requests of a new frame.
+     */
+    void beginFrame();
+
+    /**
+     * Returns the statistics of the last frame that has been completed.
+     */
+    Statistics frameStatistics() const;
+
+    /**
+     * Records a state change request made with something else than the tracker itself.
+     * @a changed indicates whether the request reached OpenGL.
+     */
+    void recordCall(bool changed);
+
+    /**
+     * @return a pointer to the GLStateTracker instance
+     */
+    static GLStateTracker *instance();
+
+    /**
+     * @internal
+     */
+    static void cleanup();
+
+private:
+    GLStateTracker() = default;
+
+    std::optional<bool> m_blendEnabled;
+    std::optional<bool> m_scissorTestEnabled;
+    std::optional<std::pair<GLenum, GLenum>> m_blendFunc;
+    std::optional<QRect> m_scissor;
+    Statistics m_statistics;
+    Statistics m_frameStatistics;
+    static GLStateTracker *s_stateTracker;
+};
+
 /**
  * @short Render target object
  *
@@ -451,6 +604,12 @@ public:
     static void pushRenderTarget(GLRenderTarget *target);
     static GLRenderTarget *popRenderTarget();
     static bool isRenderTargetBound();
+    /**
+     * Returns the render target on top of the render target stack, or @c nullptr if
+     * KWin's framebuffer is being rendered to.
+     * @since 5.25
+     */
+    static GLRenderTarget *currentRenderTarget();
     /**
      * Whether the GL_EXT_framebuffer_blit extension is supported.
      * This functionality is not available in OpenGL ES 2.0.
@@ -31,8 +31,8 @@ glGetnUniformfv_func          glGetnUniformfv;
 
 void glResolveFunctions(const std::function<resolveFuncPtr(const char*)> &resolveFunction)
 {
-    const bool haveArbRobustness = hasGLExtension(QByteArrayLiteral("GL_ARB_robustness"));
-    const bool haveExtRobustness = hasGLExtension(QByteArrayLiteral("GL_EXT_robustness"));
+    const bool haveArbRobustness = hasGLExtension(GLExtension::ARB_robustness);
+    const bool haveExtRobustness = hasGLExtension(GLExtension::EXT_robustness);
     bool robustContext = false;
     if (GLPlatform::instance()->isGLES()) {
         if (haveExtRobustness) {
@@ -9,6 +9,7 @@
 
 #include "kwinoffscreenquickview.h"
 
+#include "kwinglplatform.h"
 #include "kwinglutils.h"
 #include "logging_p.h"
 
@@ -24,6 +25,7 @@
 #include <QOffscreenSurface>
 #include <QOpenGLContext>
 #include <QOpenGLFramebufferObject>
+#include <QThread>
 #include <QTimer>
 
 #include <KDeclarative/QmlObjectSharedEngine>
@@ -66,12 +68,43 @@ public:
     QTimer *m_repaintTimer;
     QImage m_image;
     QScopedPointer<GLTexture> m_textureExport;
+    // signalled once the QtQuick render into m_fbo has completed, the scene waits on it
+    // before sampling the shared texture
+    GLsync m_renderFence = nullptr;
     // if we should capture a QImage after rendering into our BO.
     // Used for either software QtQuick rendering and nonGL kwin rendering
     bool m_useBlit = false;
+    bool m_imageDirty = false;
+    bool m_haveSyncFences = false;
     bool m_visible = true;
     bool m_automaticRepaint = true;
 
+    /**
+     * With threaded rendering the render control syncs and renders on m_renderThread,
+     * the GUI thread only polishes the items. Two buffers are used, the scene samples
+     * the front buffer while the next frame is rendered into the other one.
+     */
+    struct RenderBuffer {
+        // owned by the render thread
+        QScopedPointer<QOpenGLFramebufferObject> fbo;
+        GLuint texture = 0;
+        GLenum internalFormat = GL_RGBA8;
+        QSize size;
+        // signalled when the render into this buffer has completed
+        GLsync renderFence = nullptr;
+        // signalled when the scene no longer samples this buffer
+        GLsync releaseFence = nullptr;
+        // owned by the GUI thread
+        QScopedPointer<GLTexture> textureExport;
+    };
+    QThread *m_renderThread = nullptr;
+    QObject *m_renderWorker = nullptr;
+    RenderBuffer m_buffers[2];
+    int m_frontBuffer = -1;
+    int m_pendingBuffer = -1;
+    bool m_renderInFlight = false;
+    bool m_updateAgain = false;
+
     QList<QTouchEvent::TouchPoint> touchPoints;
     Qt::TouchPointStates touchState;
     QTouchDevice *touchDevice;
@@ -80,6 +113,11 @@ public:
     Qt::MouseButton lastMousePressButton = Qt::NoButton;
 
     void releaseResources();
+    void initThreadedRendering();
+    void cleanupThreadedRendering();
+    void updateThreaded(OffscreenQuickView *q);
+    void handleFrameRendered(OffscreenQuickView *q, int buffer);
+    GLTexture *swapBuffers();
 
     void updateTouchState(Qt::TouchPointState state, qint32 id, const QPointF& pos);
 };
@@ -142,16 +180,31 @@ OffscreenQuickView::OffscreenQuickView(QObject *parent, QWindow *renderWindow, E
         d->m_offscreenSurface->setFormat(d->m_glcontext->format());
         d->m_offscreenSurface->create();
 
-        d->m_glcontext->makeCurrent(d->m_offscreenSurface.data());
-        d->m_renderControl->initialize(d->m_glcontext.data());
-        d->m_glcontext->doneCurrent();
-
         // On Wayland, contexts are implicitly shared and QOpenGLContext::globalShareContext() is null.
         if (shareContext && !d->m_glcontext->shareContext()) {
             qCDebug(LIBKWINEFFECTS) << "Failed to create a shared context, falling back to raster rendering";
             // still render via GL, but blit for presentation
             d->m_useBlit = true;
         }
+
+        if (!d->m_useBlit) {
+            if (GLPlatform::instance()->isGLES()) {
+                d->m_haveSyncFences = hasGLVersion(3, 0);
+            } else {
+                d->m_haveSyncFences = hasGLVersion(3, 2) || hasGLExtension(GLExtension::ARB_sync);
+            }
+        }
+
+        // Threaded rendering hands frames over to the scene with fences, it's only
+        // possible when the texture is shared with the scene.
+        static const bool threadedRendering = qEnvironmentVariableIntValue("KWIN_EFFECTS_THREADED_QUICK");
+        if (threadedRendering && !d->m_useBlit && d->m_haveSyncFences) {
+            d->initThreadedRendering();
+        } else {
+            d->m_glcontext->makeCurrent(d->m_offscreenSurface.data());
+            d->m_renderControl->initialize(d->m_glcontext.data());
+            d->m_glcontext->doneCurrent();
+        }
     }
 
     auto updateSize = [this]() { contentItem()->setSize(d->m_view->size()); };
@@ -175,9 +228,16 @@ OffscreenQuickView::OffscreenQuickView(QObject *parent, QWindow *renderWindow, E
 
 OffscreenQuickView::~OffscreenQuickView()
 {
+    if (d->m_renderThread) {
+        d->cleanupThreadedRendering();
+    }
     if (d->m_glcontext) {
         // close the view whilst we have an active GL context
         d->m_glcontext->makeCurrent(d->m_offscreenSurface.data());
+        if (d->m_renderFence) {
+            glDeleteSync(d->m_renderFence);
+            d->m_renderFence = nullptr;
+        }
     }
 
     delete d->m_renderControl; // Always delete render control first.
@@ -229,6 +289,11 @@ void OffscreenQuickView::update()
         return;
     }
 
+    if (d->m_renderThread) {
+        d->updateThreaded(this);
+        return;
+    }
+
     bool usingGl = d->m_glcontext;
 
     if (usingGl) {
@@ -260,6 +325,19 @@ void OffscreenQuickView::update()
 
     if (d->m_useBlit) {
         d->m_image = d->m_renderControl->grab();
+        d->m_imageDirty = true;
+    } else if (usingGl) {
+        // The scene samples m_fbo's texture directly from its own context. Instead of
+        // copying the contents, hand over a fence so it can wait for the render to finish
+        // on the GPU. The flush makes sure the fence is visible to the other context.
+        if (d->m_renderFence) {
+            glDeleteSync(d->m_renderFence);
+            d->m_renderFence = nullptr;
+        }
+        if (d->m_haveSyncFences) {
+            d->m_renderFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+        glFlush();
     }
 
     if (usingGl) {
@@ -414,11 +492,20 @@ void OffscreenQuickView::hide()
 
 GLTexture *OffscreenQuickView::bufferAsTexture()
 {
+    if (d->m_renderThread) {
+        return d->swapBuffers();
+    }
     if (d->m_useBlit) {
         if (d->m_image.isNull()) {
             return nullptr;
         }
-        d->m_textureExport.reset(new GLTexture(d->m_image));
+        // only upload when a new frame has been grabbed, and reuse the texture storage
+        if (!d->m_textureExport || d->m_textureExport->size() != d->m_image.size()) {
+            d->m_textureExport.reset(new GLTexture(d->m_image));
+        } else if (d->m_imageDirty) {
+            d->m_textureExport->update(d->m_image);
+        }
+        d->m_imageDirty = false;
     } else {
         if (!d->m_fbo) {
             return nullptr;
@@ -426,6 +513,12 @@ GLTexture *OffscreenQuickView::bufferAsTexture()
         if (!d->m_textureExport) {
             d->m_textureExport.reset(new GLTexture(d->m_fbo->texture(), d->m_fbo->format().internalTextureFormat(), d->m_fbo->size()));
         }
+        if (d->m_renderFence) {
+            // a server side wait, the CPU doesn't block on the QtQuick render
+            glWaitSync(d->m_renderFence, 0, GL_TIMEOUT_IGNORED);
+            glDeleteSync(d->m_renderFence);
+            d->m_renderFence = nullptr;
+        }
     }
     return d->m_textureExport.data();
 }
@@ -449,7 +542,13 @@ void OffscreenQuickView::setGeometry(const QRect &rect)
 
 void OffscreenQuickView::Private::releaseResources()
 {
-    if (m_glcontext) {
+    if (m_renderThread) {
+        QMetaObject::invokeMethod(m_renderWorker, [this]() {
+            m_glcontext->makeCurrent(m_offscreenSurface.data());
+            m_view->releaseResources();
+            m_glcontext->doneCurrent();
+        }, Qt::BlockingQueuedConnection);
+    } else if (m_glcontext) {
         m_glcontext->makeCurrent(m_offscreenSurface.data());
         m_view->releaseResources();
         m_glcontext->doneCurrent();
@@ -458,6 +557,167 @@ void OffscreenQuickView::Private::releaseResources()
     }
 }
 
+void OffscreenQuickView::Private::initThreadedRendering()
+{
+    m_renderThread = new QThread;
+    m_renderThread->setObjectName(QStringLiteral("OffscreenQuickView render thread"));
+    m_renderWorker = new QObject;
+    m_renderWorker->moveToThread(m_renderThread);
+
+    m_renderControl->prepareThread(m_renderThread);
+    m_glcontext->moveToThread(m_renderThread);
+    m_renderThread->start();
+
+    QMetaObject::invokeMethod(m_renderWorker, [this]() {
+        m_glcontext->makeCurrent(m_offscreenSurface.data());
+        m_renderControl->initialize(m_glcontext.data());
+        m_glcontext->doneCurrent();
+    }, Qt::BlockingQueuedConnection);
+}
+
+void OffscreenQuickView::Private::cleanupThreadedRendering()
+{
+    QThread *guiThread = QThread::currentThread();
+    QMetaObject::invokeMethod(m_renderWorker, [this, guiThread]() {
+        m_glcontext->makeCurrent(m_offscreenSurface.data());
+        m_renderControl->invalidate();
+        for (RenderBuffer &buffer : m_buffers) {
+            buffer.fbo.reset();
+            if (buffer.renderFence) {
+                glDeleteSync(buffer.renderFence);
+                buffer.renderFence = nullptr;
+            }
+            if (buffer.releaseFence) {
+                glDeleteSync(buffer.releaseFence);
+                buffer.releaseFence = nullptr;
+            }
+        }
+        m_glcontext->doneCurrent();
+        m_glcontext->moveToThread(guiThread);
+    }, Qt::BlockingQueuedConnection);
+
+    m_renderThread->quit();
+    m_renderThread->wait();
+    delete m_renderWorker;
+    m_renderWorker = nullptr;
+    delete m_renderThread;
+    m_renderThread = nullptr;
+}
+
+void OffscreenQuickView::Private::updateThreaded(OffscreenQuickView *q)
+{
+    // The render thread owns the back buffer until the frame has been handed over.
+    if (m_renderInFlight) {
+        m_updateAgain = true;
+        return;
+    }
+
+    const int target = m_frontBuffer == 0 ? 1 : 0;
+    if (m_pendingBuffer == target) {
+        m_pendingBuffer = -1;
+    }
+    const QSize nativeSize = m_view->size() * m_view->effectiveDevicePixelRatio();
+
+    m_renderControl->polishItems();
+
+    // Like QtQuick's threaded render loop, the GUI thread is blocked while the scene graph syncs.
+    bool synced = false;
+    QMetaObject::invokeMethod(m_renderWorker, [this, target, nativeSize, &synced]() {
+        if (!m_glcontext->makeCurrent(m_offscreenSurface.data())) {
+            // probably a context loss event, kwin is about to reset all the effects anyway
+            return;
+        }
+        RenderBuffer &buffer = m_buffers[target];
+        if (buffer.fbo.isNull() || buffer.fbo->size() != nativeSize) {
+            buffer.fbo.reset(new QOpenGLFramebufferObject(nativeSize, QOpenGLFramebufferObject::CombinedDepthStencil));
+            if (!buffer.fbo->isValid()) {
+                buffer.fbo.reset();
+                m_glcontext->doneCurrent();
+                return;
+            }
+            buffer.texture = buffer.fbo->texture();
+            buffer.internalFormat = buffer.fbo->format().internalTextureFormat();
+            buffer.size = buffer.fbo->size();
+        }
+        m_view->setRenderTarget(buffer.fbo.data());
+        m_renderControl->sync();
+        synced = true;
+    }, Qt::BlockingQueuedConnection);
+
+    if (!synced) {
+        return;
+    }
+
+    m_renderInFlight = true;
+    QMetaObject::invokeMethod(m_renderWorker, [this, q, target]() {
+        RenderBuffer &buffer = m_buffers[target];
+        if (buffer.releaseFence) {
+            glWaitSync(buffer.releaseFence, 0, GL_TIMEOUT_IGNORED);
+            glDeleteSync(buffer.releaseFence);
+            buffer.releaseFence = nullptr;
+        }
+
+        m_renderControl->render();
+        m_view->resetOpenGLState();
+
+        if (buffer.renderFence) {
+            glDeleteSync(buffer.renderFence);
+        }
+        buffer.renderFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+
+        QOpenGLFramebufferObject::bindDefault();
+        m_glcontext->doneCurrent();
+
+        QMetaObject::invokeMethod(q, [this, q, target]() {
+            handleFrameRendered(q, target);
+        }, Qt::QueuedConnection);
+    }, Qt::QueuedConnection);
+}
+
+void OffscreenQuickView::Private::handleFrameRendered(OffscreenQuickView *q, int buffer)
+{
+    m_renderInFlight = false;
+    m_pendingBuffer = buffer;
+    Q_EMIT q->repaintNeeded();
+
+    if (m_updateAgain) {
+        m_updateAgain = false;
+        q->update();
+    }
+}
+
+GLTexture *OffscreenQuickView::Private::swapBuffers()
+{
+    if (m_pendingBuffer != -1) {
+        if (m_frontBuffer != -1) {
+            // everything sampling the old front buffer has been issued by now
+            RenderBuffer &previous = m_buffers[m_frontBuffer];
+            if (previous.releaseFence) {
+                glDeleteSync(previous.releaseFence);
+            }
+            previous.releaseFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glFlush();
+        }
+        m_frontBuffer = m_pendingBuffer;
+        m_pendingBuffer = -1;
+
+        RenderBuffer &front = m_buffers[m_frontBuffer];
+        if (!front.textureExport || front.textureExport->texture() != front.texture || front.textureExport->size() != front.size) {
+            front.textureExport.reset(new GLTexture(front.texture, front.internalFormat, front.size));
+        }
+        if (front.renderFence) {
+            glWaitSync(front.renderFence, 0, GL_TIMEOUT_IGNORED);
+            glDeleteSync(front.renderFence);
+            front.renderFence = nullptr;
+        }
+    }
+    if (m_frontBuffer == -1) {
+        return nullptr;
+    }
+    return m_buffers[m_frontBuffer].textureExport.data();
+}
+
 void OffscreenQuickView::Private::updateTouchState(Qt::TouchPointState state, qint32 id, const QPointF &pos)
 {
     // Remove the points that were previously in a released state, since they
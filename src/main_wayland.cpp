@@ -192,6 +192,9 @@ void ApplicationWayland::continueStartupWithScene()
     connect(m_xwayland, &Xwl::Xwayland::errorOccurred, this, &ApplicationWayland::finalizeStartup);
     connect(m_xwayland, &Xwl::Xwayland::started, this, &ApplicationWayland::finalizeStartup);
     m_xwayland->start();
+    if (m_xwayland->isWaitingForClient()) {
+        finalizeStartup();
+    }
 }
 
 void ApplicationWayland::finalizeStartup()
@@ -51,6 +51,11 @@ enum LatencyPolicy {
     LatencyMedium,
     LatencyHigh,
     LatencyExtremelyHigh,
+    /**
+     * The latency level and the safety margin are adjusted for every output at runtime
+     * depending on whether frames miss their presentation deadline.
+     */
+    LatencyAdaptive,
 };
 
 /**
@@ -60,6 +65,7 @@ enum RenderTimeEstimator {
     RenderTimeEstimatorMinimum,
     RenderTimeEstimatorMaximum,
     RenderTimeEstimatorAverage,
+    RenderTimeEstimatorPercentile,
 };
 
 class Settings;
@@ -84,9 +84,14 @@ void Outline::setGeometry(const QRect& outlineGeometry)
     if (m_outlineGeometry == outlineGeometry) {
         return;
     }
+    const QRect oldUnifiedGeometry = unifiedGeometry();
     m_outlineGeometry = outlineGeometry;
+    // The visual only has to be moved if the unified geometry changes, otherwise the
+    // outline can be animated to its new geometry.
+    if (unifiedGeometry() != oldUnifiedGeometry) {
+        Q_EMIT unifiedGeometryChanged();
+    }
     Q_EMIT geometryChanged();
-    Q_EMIT unifiedGeometryChanged();
 }
 
 void Outline::setVisualParentGeometry(const QRect &visualParentGeometry)
@@ -94,14 +99,29 @@ void Outline::setVisualParentGeometry(const QRect &visualParentGeometry)
     if (m_visualParentGeometry == visualParentGeometry) {
         return;
     }
+    const QRect oldUnifiedGeometry = unifiedGeometry();
     m_visualParentGeometry = visualParentGeometry;
+    if (unifiedGeometry() != oldUnifiedGeometry) {
+        Q_EMIT unifiedGeometryChanged();
+    }
     Q_EMIT visualParentGeometryChanged();
-    Q_EMIT unifiedGeometryChanged();
+}
+
+void Outline::setBoundingGeometry(const QRect &boundingGeometry)
+{
+    if (m_boundingGeometry == boundingGeometry) {
+        return;
+    }
+    const QRect oldUnifiedGeometry = unifiedGeometry();
+    m_boundingGeometry = boundingGeometry;
+    if (unifiedGeometry() != oldUnifiedGeometry) {
+        Q_EMIT unifiedGeometryChanged();
+    }
 }
 
 QRect Outline::unifiedGeometry() const
 {
-    return m_outlineGeometry | m_visualParentGeometry;
+    return m_outlineGeometry | m_visualParentGeometry | m_boundingGeometry;
 }
 
 void Outline::createHelper()
@@ -135,6 +155,15 @@ CompositedOutlineVisual::CompositedOutlineVisual(Outline *outline)
     , m_qmlComponent()
     , m_mainItem()
 {
+    // The window is kept around for a while after it's hidden, the outline is usually
+    // shown again soon, e.g. when the pointer moves from one quick tile zone to another.
+    m_releaseTimer.setSingleShot(true);
+    m_releaseTimer.setInterval(5000);
+    QObject::connect(&m_releaseTimer, &QTimer::timeout, [this]() {
+        if (QQuickWindow *w = qobject_cast<QQuickWindow*>(m_mainItem.data())) {
+            w->destroy();
+        }
+    });
 }
 
 CompositedOutlineVisual::~CompositedOutlineVisual()
@@ -145,12 +174,13 @@ void CompositedOutlineVisual::hide()
 {
     if (QQuickWindow *w = qobject_cast<QQuickWindow*>(m_mainItem.data())) {
         w->hide();
-        w->destroy();
+        m_releaseTimer.start();
     }
 }
 
 void CompositedOutlineVisual::show()
 {
+    m_releaseTimer.stop();
     if (m_qmlContext.isNull()) {
         m_qmlContext.reset(new QQmlContext(Scripting::self()->qmlEngine()));
         m_qmlContext->setContextProperty(QStringLiteral("outline"), outline());
@@ -12,6 +12,7 @@
 #include <kwinglobals.h>
 #include <QRect>
 #include <QObject>
+#include <QTimer>
 
 #include <kwin_export.h>
 
@@ -57,6 +58,16 @@ public:
      */
     void setVisualParentGeometry(const QRect &visualParentGeometry);
 
+    /**
+     * Set the bounding geometry.
+     * This is the area in which the outline is going to move around, for example all
+     * the quick tile zones of an output. The visual covers it, so moving the outline
+     * within it only animates the outline instead of resizing the visual.
+     * @param boundingGeometry The area in which the outline is going to be shown
+     * @since 5.25
+     */
+    void setBoundingGeometry(const QRect &boundingGeometry);
+
     /**
      * Shows the outline of a window using either an effect or the X implementation.
      * To stop the outline process use hideOutline.
@@ -93,6 +104,7 @@ public:
 
     const QRect &geometry() const;
     const QRect &visualParentGeometry() const;
+    const QRect &boundingGeometry() const;
     QRect unifiedGeometry() const;
 
     bool isActive() const;
@@ -111,6 +123,7 @@ private:
     QScopedPointer<OutlineVisual> m_visual;
     QRect m_outlineGeometry;
     QRect m_visualParentGeometry;
+    QRect m_boundingGeometry;
     bool m_active;
     KWIN_SINGLETON(Outline)
 };
@@ -140,6 +153,7 @@ private:
     QScopedPointer<QQmlContext> m_qmlContext;
     QScopedPointer<QQmlComponent> m_qmlComponent;
     QScopedPointer<QObject> m_mainItem;
+    QTimer m_releaseTimer;
 };
 
 inline
@@ -160,6 +174,12 @@ const QRect &Outline::visualParentGeometry() const
     return m_visualParentGeometry;
 }
 
+inline
+const QRect &Outline::boundingGeometry() const
+{
+    return m_boundingGeometry;
+}
+
 inline
 Outline *OutlineVisual::outline()
 {
@@ -0,0 +1,60 @@
+/*
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "paintstatistics.h"
+
+namespace KWin
+{
+
+PaintStatistics *PaintStatistics::self()
+{
+    static PaintStatistics statistics;
+    return &statistics;
+}
+
+void PaintStatistics::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+    m_frameCount = 0;
+    m_nestedTime = std::chrono::nanoseconds::zero();
+    m_effects.clear();
+    m_windows.clear();
+}
+
+quint64 PaintStatistics::frameCount() const
+{
+    return m_frameCount;
+}
+
+PaintStatistics::Timings PaintStatistics::effectTimings(const Effect *effect) const
+{
+    return m_effects.value(effect, Timings{});
+}
+
+std::chrono::nanoseconds PaintStatistics::windowPaintTime(const Toplevel *window) const
+{
+    return m_windows.value(window, std::chrono::nanoseconds::zero());
+}
+
+void PaintStatistics::removeEffect(const Effect *effect)
+{
+    m_effects.remove(effect);
+}
+
+void PaintStatistics::removeWindow(const Toplevel *window)
+{
+    m_windows.remove(window);
+}
+
+void PaintStatistics::beginFrame()
+{
+    if (m_enabled) {
+        m_frameCount++;
+        m_nestedTime = std::chrono::nanoseconds::zero();
+    }
+}
+
+} // namespace KWin
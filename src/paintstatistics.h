@@ -0,0 +1,128 @@
+/*
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <kwin_export.h>
+
+#include <QHash>
+
+#include <array>
+#include <chrono>
+
+namespace KWin
+{
+
+class Effect;
+class Toplevel;
+
+/**
+ * The PaintStatistics class measures how much time effects and windows take to paint.
+ *
+ * Measuring is disabled by default and only enabled while somebody looks at the results,
+ * e.g. the performance tab of the debug console. The times are accumulated since measuring
+ * has been enabled, the caller is responsible for sampling them and computing rates.
+ *
+ * The time of an effect excludes the time spent in the effects that it chains up to and in
+ * the scene, so the times of all effects and the scene add up to the total painting time.
+ */
+class KWIN_EXPORT PaintStatistics
+{
+public:
+    enum class Pass {
+        PrePaintScreen,
+        PaintWindow,
+        DrawWindow,
+    };
+    static constexpr int PassCount = int(Pass::DrawWindow) + 1;
+
+    using Timings = std::array<std::chrono::nanoseconds, PassCount>;
+
+    static PaintStatistics *self();
+
+    bool isEnabled() const
+    {
+        return m_enabled;
+    }
+    /**
+     * Enables or disables measuring. All previous measurements are discarded.
+     */
+    void setEnabled(bool enabled);
+
+    /**
+     * Returns the number of frames that have been painted since measuring has been enabled.
+     */
+    quint64 frameCount() const;
+    /**
+     * Returns the time spent by the @a effect in every painting pass. If @a effect is
+     * @c null, the time spent in the scene after the last effect is returned.
+     */
+    Timings effectTimings(const Effect *effect) const;
+    /**
+     * Returns the time spent painting the @a window, including the effects.
+     */
+    std::chrono::nanoseconds windowPaintTime(const Toplevel *window) const;
+
+    /**
+     * Forgets the times of the @a effect. Must be called before the effect is destroyed,
+     * so an effect that is allocated at the same address doesn't inherit them.
+     */
+    void removeEffect(const Effect *effect);
+    /**
+     * Forgets the paint time of the @a window. Must be called when the window leaves
+     * the scene.
+     */
+    void removeWindow(const Toplevel *window);
+
+    /**
+     * Must be called before painting a new frame.
+     */
+    void beginFrame();
+
+    /**
+     * Calls @a function and accounts the time it takes to the given @a pass of the @a effect.
+     * The time spent in nested measurements is subtracted.
+     */
+    template <typename Function>
+    void measure(const Effect *effect, Pass pass, Function function)
+    {
+        if (!m_enabled) {
+            function();
+            return;
+        }
+        const std::chrono::nanoseconds nestedTime = m_nestedTime;
+        m_nestedTime = std::chrono::nanoseconds::zero();
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        const std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start;
+        m_effects[effect][int(pass)] += elapsed - m_nestedTime;
+        m_nestedTime = nestedTime + elapsed;
+    }
+
+    /**
+     * Calls @a function and accounts the time it takes to the @a window.
+     */
+    template <typename Function>
+    void measureWindow(const Toplevel *window, Function function)
+    {
+        if (!m_enabled) {
+            function();
+            return;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        m_windows[window] += std::chrono::steady_clock::now() - start;
+    }
+
+private:
+    bool m_enabled = false;
+    quint64 m_frameCount = 0;
+    std::chrono::nanoseconds m_nestedTime = std::chrono::nanoseconds::zero();
+    QHash<const Effect *, Timings> m_effects;
+    QHash<const Toplevel *, std::chrono::nanoseconds> m_windows;
+};
+
+} // namespace KWin
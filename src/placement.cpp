@@ -206,6 +206,29 @@ void Placement::placeSmart(AbstractClient* c, const QRect& area, Policy /*next*/
 
     bool first_pass = true; //CT lame flag. Don't like it. What else would do?
 
+    // The other windows don't change while the position is searched, collect them once
+    // instead of filtering the stacking order for every tested position.
+    struct Obstacle {
+        int xl, xr, yt, yb;
+        int weight;
+    };
+    QVector<Obstacle> obstacles;
+    const QList<Toplevel *> stackingOrder = workspace()->stackingOrder();
+    obstacles.reserve(stackingOrder.count());
+    for (Toplevel *toplevel : stackingOrder) {
+        AbstractClient *client = qobject_cast<AbstractClient*>(toplevel);
+        if (isIrrelevant(client, c, desktop)) {
+            continue;
+        }
+        int weight = 1;
+        if (client->keepAbove())
+            weight = 16;
+        else if (client->keepBelow() && !client->isDock()) // ignore KeepBelow windows
+            weight = 0; // for placement (see X11Client::belongsToLayer() for Dock)
+        obstacles.append(Obstacle{client->x(), client->x() + client->width(),
+                                  client->y(), client->y() + client->height(), weight});
+    }
+
     //loop over possible positions
     do {
         //test if enough room in x and y directions
@@ -218,25 +241,16 @@ void Placement::placeSmart(AbstractClient* c, const QRect& area, Policy /*next*/
 
             cxl = x; cxr = x + cw;
             cyt = y; cyb = y + ch;
-            for (auto l = workspace()->stackingOrder().constBegin(); l != workspace()->stackingOrder().constEnd() ; ++l) {
-                AbstractClient *client = qobject_cast<AbstractClient*>(*l);
-                if (isIrrelevant(client, c, desktop)) {
-                    continue;
-                }
-                xl = client->x();          yt = client->y();
-                xr = xl + client->width(); yb = yt + client->height();
+            for (const Obstacle &obstacle : qAsConst(obstacles)) {
+                xl = obstacle.xl; xr = obstacle.xr;
+                yt = obstacle.yt; yb = obstacle.yb;
 
                 //if windows overlap, calc the overall overlapping
                 if ((cxl < xr) && (cxr > xl) &&
                         (cyt < yb) && (cyb > yt)) {
                     xl = qMax(cxl, xl); xr = qMin(cxr, xr);
                     yt = qMax(cyt, yt); yb = qMin(cyb, yb);
-                    if (client->keepAbove())
-                        overlap += 16 * (xr - xl) * (yb - yt);
-                    else if (client->keepBelow() && !client->isDock()) // ignore KeepBelow windows
-                        overlap += 0; // for placement (see X11Client::belongsToLayer() for Dock)
-                    else
-                        overlap += (xr - xl) * (yb - yt);
+                    overlap += obstacle.weight * (xr - xl) * (yb - yt);
                 }
             }
         }
@@ -266,14 +280,9 @@ void Placement::placeSmart(AbstractClient* c, const QRect& area, Policy /*next*/
             if (possible - cw > x) possible -= cw;
 
             // compare to the position of each client on the same desk
-            for (auto l = workspace()->stackingOrder().constBegin(); l != workspace()->stackingOrder().constEnd() ; ++l) {
-                AbstractClient *client = qobject_cast<AbstractClient*>(*l);
-                if (isIrrelevant(client, c, desktop)) {
-                    continue;
-                }
-
-                xl = client->x();          yt = client->y();
-                xr = xl + client->width(); yb = yt + client->height();
+            for (const Obstacle &obstacle : qAsConst(obstacles)) {
+                xl = obstacle.xl; xr = obstacle.xr;
+                yt = obstacle.yt; yb = obstacle.yb;
 
                 // if not enough room above or under the current tested client
                 // determine the first non-overlapped x position
@@ -296,14 +305,8 @@ void Placement::placeSmart(AbstractClient* c, const QRect& area, Policy /*next*/
             if (possible - ch > y) possible -= ch;
 
             //test the position of each window on the desk
-            for (auto l = workspace()->stackingOrder().constBegin(); l != workspace()->stackingOrder().constEnd() ; ++l) {
-                AbstractClient *client = qobject_cast<AbstractClient*>(*l);
-                if (isIrrelevant(client, c, desktop)) {
-                    continue;
-                }
-
-                xl = client->x();          yt = client->y();
-                xr = xl + client->width(); yb = yt + client->height();
+            for (const Obstacle &obstacle : qAsConst(obstacles)) {
+                yt = obstacle.yt; yb = obstacle.yb;
 
                 // if not enough room to the left or right of the current tested client
                 // determine the first non-overlapped y position
@@ -130,7 +130,11 @@ void Platform::requestOutputsChange(KWaylandServer::OutputConfigurationV2Interfa
         return;
     }
 
-    if (applyOutputChanges(cfg)) {
+    // Rearranging the outputs changes them one by one, the workspace is laid out only
+    // once the whole configuration has been applied.
+    m_applyingOutputConfiguration = true;
+    const bool applied = applyOutputChanges(cfg);
+    if (applied) {
         if (config->primaryChanged() || !primaryOutput()->isEnabled()) {
             auto requestedPrimaryOutput = findOutput(config->primary()->uuid());
             if (requestedPrimaryOutput && requestedPrimaryOutput->isEnabled()) {
@@ -141,6 +145,11 @@ void Platform::requestOutputsChange(KWaylandServer::OutputConfigurationV2Interfa
                 setPrimaryOutput(defaultPrimaryOutput);
             }
         }
+    }
+    m_applyingOutputConfiguration = false;
+    Q_EMIT outputConfigurationApplied();
+
+    if (applied) {
         Q_EMIT screens()->changed();
         config->setApplied();
     } else {
@@ -149,6 +158,11 @@ void Platform::requestOutputsChange(KWaylandServer::OutputConfigurationV2Interfa
     }
 }
 
+bool Platform::isApplyingOutputConfiguration() const
+{
+    return m_applyingOutputConfiguration;
+}
+
 bool Platform::applyOutputChanges(const WaylandOutputConfig &config)
 {
     const auto outputs = enabledOutputs();
@@ -370,6 +370,13 @@ public:
      */
     virtual bool applyOutputChanges(const WaylandOutputConfig &config);
 
+    /**
+     * Returns @c true while a new output configuration is being applied. The outputs change
+     * one after another during that time, the outputConfigurationApplied() signal is emitted
+     * once all of them are in their final state.
+     */
+    bool isApplyingOutputConfiguration() const;
+
 public Q_SLOTS:
     void pointerMotion(const QPointF &position, quint32 time);
     void pointerButtonPressed(quint32 button, quint32 time);
@@ -428,6 +435,10 @@ Q_SIGNALS:
     void outputDisabled(AbstractOutput *output);
 
     void primaryOutputChanged(AbstractOutput *primaryOutput);
+    /**
+     * This signal is emitted when an output configuration has been applied or reverted.
+     */
+    void outputConfigurationApplied();
 
 protected:
     explicit Platform(QObject *parent = nullptr);
@@ -469,6 +480,7 @@ private:
     EGLContext m_globalShareContext = EGL_NO_CONTEXT;
     bool m_supportsGammaControl = false;
     bool m_supportsOutputChanges = false;
+    bool m_applyingOutputConfiguration = false;
     bool m_isPerScreenRenderingEnabled = false;
     CompositingType m_selectedCompositor = NoCompositing;
     AbstractOutput *m_primaryOutput = nullptr;
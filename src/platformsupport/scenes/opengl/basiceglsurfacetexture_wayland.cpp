@@ -49,6 +49,7 @@ bool BasicEGLSurfaceTextureWayland::create()
 
 void BasicEGLSurfaceTextureWayland::destroy()
 {
+    discardMipmaps();
     if (m_image != EGL_NO_IMAGE_KHR) {
         eglDestroyImageKHR(backend()->eglDisplay(), m_image);
         m_image = EGL_NO_IMAGE_KHR;
@@ -98,9 +99,7 @@ void BasicEGLSurfaceTextureWayland::updateShmTexture(KWaylandServer::ShmClientBu
     }
 
     const QRegion damage = mapRegion(m_pixmap->item()->surfaceToBufferMatrix(), region);
-    for (const QRect &rect : damage) {
-        m_texture->update(image, rect.topLeft(), rect);
-    }
+    m_texture->update(image, damage);
 }
 
 bool BasicEGLSurfaceTextureWayland::loadEglTexture(KWaylandServer::DrmClientBuffer *buffer)
@@ -157,20 +156,14 @@ void BasicEGLSurfaceTextureWayland::updateEglTexture(KWaylandServer::DrmClientBu
 bool BasicEGLSurfaceTextureWayland::loadDmabufTexture(KWaylandServer::LinuxDmaBufV1ClientBuffer *buffer)
 {
     auto dmabuf = static_cast<EglDmabufBuffer *>(buffer);
-    if (Q_UNLIKELY(dmabuf->images().constFirst() == EGL_NO_IMAGE_KHR)) {
+    GLTexture *texture = dmabuf->texture();
+    if (Q_UNLIKELY(!texture)) {
         qCritical(KWIN_OPENGL) << "Invalid dmabuf-based wl_buffer";
         return false;
     }
 
-    m_texture.reset(new GLTexture(GL_TEXTURE_2D));
-    m_texture->setSize(dmabuf->size());
-    m_texture->create();
-    m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
-    m_texture->setFilter(GL_NEAREST);
-    m_texture->bind();
-    glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, static_cast<GLeglImageOES>(dmabuf->images().constFirst()));
-    m_texture->unbind();
-    m_texture->setYInverted(dmabuf->origin() == KWaylandServer::ClientBuffer::Origin::TopLeft);
+    // The texture shares the storage of the buffer's texture, which outlives the attachment.
+    m_texture.reset(new GLTexture(*texture));
     m_bufferType = BufferType::DmaBuf;
 
     return true;
@@ -184,13 +177,13 @@ void BasicEGLSurfaceTextureWayland::updateDmabufTexture(KWaylandServer::LinuxDma
         return;
     }
 
+    // Clients usually cycle through a few buffers, each of them has been imported and bound
+    // to a texture of its own already. The texture object is kept so the scene sees the
+    // same texture, only its storage is swapped.
     auto dmabuf = static_cast<EglDmabufBuffer *>(buffer);
-    m_texture->bind();
-    glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, static_cast<GLeglImageOES>(dmabuf->images().constFirst()));
-    m_texture->unbind();
-    // The origin in a dmabuf-buffer is at the upper-left corner, so the meaning
-    // of Y-inverted is the inverse of OpenGL.
-    m_texture->setYInverted(dmabuf->origin() == KWaylandServer::ClientBuffer::Origin::TopLeft);
+    if (GLTexture *texture = dmabuf->texture()) {
+        *m_texture = *texture;
+    }
 }
 
 EGLImageKHR BasicEGLSurfaceTextureWayland::attach(KWaylandServer::DrmClientBuffer *buffer)
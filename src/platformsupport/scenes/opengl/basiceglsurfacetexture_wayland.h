@@ -32,6 +32,7 @@ public:
 
     bool create() override;
     void update(const QRegion &region) override;
+    void destroy() override;
 
 private:
     bool loadShmTexture(KWaylandServer::ShmClientBuffer *buffer);
@@ -41,7 +42,6 @@ private:
     bool loadDmabufTexture(KWaylandServer::LinuxDmaBufV1ClientBuffer *buffer);
     void updateDmabufTexture(KWaylandServer::LinuxDmaBufV1ClientBuffer *buffer);
     EGLImageKHR attach(KWaylandServer::DrmClientBuffer *buffer);
-    void destroy();
 
     enum class BufferType {
         None,
@@ -11,6 +11,7 @@
 #include "drm_fourcc.h"
 #include "kwineglext.h"
 #include "kwineglutils_p.h"
+#include "kwingltexture.h"
 
 #include "utils/common.h"
 #include "wayland_server.h"
@@ -164,12 +165,36 @@ void EglDmabufBuffer::addImage(EGLImage image)
 
 void EglDmabufBuffer::removeImages()
 {
+    if (m_texture) {
+        m_interfaceImpl->m_backend->makeCurrent();
+        m_texture.reset();
+    }
     for (auto image : qAsConst(m_images)) {
         eglDestroyImageKHR(m_interfaceImpl->m_backend->eglDisplay(), image);
     }
     m_images.clear();
 }
 
+GLTexture *EglDmabufBuffer::texture()
+{
+    if (m_texture || m_images.isEmpty()) {
+        return m_texture.data();
+    }
+
+    m_texture.reset(new GLTexture(GL_TEXTURE_2D));
+    m_texture->setSize(size());
+    m_texture->create();
+    m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
+    m_texture->setFilter(GL_NEAREST);
+    m_texture->bind();
+    glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, static_cast<GLeglImageOES>(m_images.constFirst()));
+    m_texture->unbind();
+    // The origin in a dmabuf-buffer is at the upper-left corner, so the meaning
+    // of Y-inverted is the inverse of OpenGL.
+    m_texture->setYInverted(origin() == KWaylandServer::ClientBuffer::Origin::TopLeft);
+    return m_texture.data();
+}
+
 EGLImage EglDmabuf::createImage(const QVector<KWaylandServer::LinuxDmaBufV1Plane> &planes,
                                 uint32_t format,
                                 const QSize &size)
@@ -13,11 +13,13 @@
 
 #include "linux_dmabuf.h"
 
+#include <QScopedPointer>
 #include <QVector>
 
 namespace KWin
 {
 class EglDmabuf;
+class GLTexture;
 
 class EglDmabufBuffer : public LinuxDmaBufV1ClientBuffer
 {
@@ -48,8 +50,16 @@ public:
 
     QVector<EGLImage> images() const { return m_images; }
 
+    /**
+     * Returns the texture that samples the first image of the buffer. The texture is created
+     * when it's requested for the first time and lives as long as the images, so attaching
+     * the buffer again doesn't import it again. Returns @c null if the buffer has no images.
+     */
+    GLTexture *texture();
+
 private:
     QVector<EGLImage> m_images;
+    QScopedPointer<GLTexture> m_texture;
     EglDmabuf *m_interfaceImpl;
     ImportType m_importType;
 };
@@ -50,6 +50,13 @@ bool OpenGLBackend::scanout(AbstractOutput *output, SurfaceItem *surfaceItem)
     return false;
 }
 
+bool OpenGLBackend::scanoutOverlay(AbstractOutput *output, SurfaceItem *surfaceItem)
+{
+    Q_UNUSED(output)
+    Q_UNUSED(surfaceItem)
+    return false;
+}
+
 void OpenGLBackend::copyPixels(const QRegion &region)
 {
     const int height = screens()->size().height();
@@ -68,6 +68,13 @@ public:
      * @return if the scanout fails (or is not supported on the specified screen)
      */
     virtual bool scanout(AbstractOutput *output, SurfaceItem *surfaceItem);
+    /**
+     * Tries to show @p surfaceItem on an overlay plane above the rest of the screen,
+     * starting with the next frame. Passing @c nullptr removes the overlay again.
+     * @return @c true if the surface will be shown on an overlay plane and must not be
+     * composited, @c false otherwise
+     */
+    virtual bool scanoutOverlay(AbstractOutput *output, SurfaceItem *surfaceItem);
 
     /**
      * @brief Whether the creation of the Backend failed.
@@ -6,6 +6,10 @@
 
 #include "openglsurfacetexture.h"
 #include "kwingltexture.h"
+#include "kwinglutils.h"
+#include "opengltexturebudget.h"
+
+#include <cmath>
 
 namespace KWin
 {
@@ -13,10 +17,12 @@ namespace KWin
 OpenGLSurfaceTexture::OpenGLSurfaceTexture(OpenGLBackend *backend)
     : m_backend(backend)
 {
+    OpenGLTextureBudget::self()->add(this);
 }
 
 OpenGLSurfaceTexture::~OpenGLSurfaceTexture()
 {
+    OpenGLTextureBudget::self()->remove(this);
 }
 
 bool OpenGLSurfaceTexture::isValid() const
@@ -34,4 +40,114 @@ GLTexture *OpenGLSurfaceTexture::texture() const
     return m_texture.data();
 }
 
+void OpenGLSurfaceTexture::destroy()
+{
+    discardMipmaps();
+    m_texture.reset();
+}
+
+bool OpenGLSurfaceTexture::isEvictable() const
+{
+    return true;
+}
+
+qint64 OpenGLSurfaceTexture::residentBytes() const
+{
+    return m_residentBytes;
+}
+
+void OpenGLSurfaceTexture::markContentsChanged()
+{
+    m_mipmapsDirty = true;
+}
+
+void OpenGLSurfaceTexture::discardMipmaps()
+{
+    m_mipmapRenderTarget.reset();
+    m_mipmappedTexture.reset();
+    m_mipmapsDirty = true;
+}
+
+GLTexture *OpenGLSurfaceTexture::mipmappedTexture()
+{
+    if (!m_texture || !GLRenderTarget::supported()) {
+        return nullptr;
+    }
+
+    const QSize size = m_texture->size();
+    if (!m_mipmappedTexture || m_mipmappedTexture->size() != size) {
+        discardMipmaps();
+
+        const int levels = std::floor(std::log2(std::max(size.width(), size.height()))) + 1;
+        m_mipmappedTexture.reset(new GLTexture(GL_RGBA8, size, levels));
+        m_mipmappedTexture->setFilter(GL_LINEAR_MIPMAP_LINEAR);
+        m_mipmappedTexture->setWrapMode(GL_CLAMP_TO_EDGE);
+        m_mipmapRenderTarget.reset(new GLRenderTarget(*m_mipmappedTexture));
+        if (!m_mipmapRenderTarget->valid()) {
+            discardMipmaps();
+            return nullptr;
+        }
+    }
+
+    if (m_mipmapsDirty) {
+        // Copy the texels as they are, the copy has the same orientation as the texture.
+        const GLboolean blendEnabled = glIsEnabled(GL_BLEND);
+        const GLboolean scissorEnabled = glIsEnabled(GL_SCISSOR_TEST);
+        glDisable(GL_BLEND);
+        glDisable(GL_SCISSOR_TEST);
+
+        GLRenderTarget::pushRenderTarget(m_mipmapRenderTarget.data());
+
+        const float vertices[] = {
+            -1.0f, -1.0f,
+            1.0f, -1.0f,
+            1.0f, 1.0f,
+            -1.0f, -1.0f,
+            1.0f, 1.0f,
+            -1.0f, 1.0f,
+        };
+        const float texCoords[] = {
+            0.0f, 0.0f,
+            1.0f, 0.0f,
+            1.0f, 1.0f,
+            0.0f, 0.0f,
+            1.0f, 1.0f,
+            0.0f, 1.0f,
+        };
+
+        ShaderBinder binder(ShaderTrait::MapTexture);
+        binder.shader()->setUniform(GLShader::ModelViewProjectionMatrix, QMatrix4x4());
+
+        m_texture->setFilter(GL_NEAREST);
+        m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
+        m_texture->bind();
+
+        GLVertexBuffer *vbo = GLVertexBuffer::streamingBuffer();
+        vbo->reset();
+        vbo->setData(6, 2, vertices, texCoords);
+        vbo->render(GL_TRIANGLES);
+
+        m_texture->unbind();
+        GLRenderTarget::popRenderTarget();
+
+        m_mipmappedTexture->bind();
+        m_mipmappedTexture->generateMipmaps();
+        m_mipmappedTexture->unbind();
+
+        if (blendEnabled) {
+            glEnable(GL_BLEND);
+        }
+        if (scissorEnabled) {
+            glEnable(GL_SCISSOR_TEST);
+        }
+
+        m_mipmapsDirty = false;
+    }
+
+    m_mipmappedTexture->setYInverted(m_texture->isYInverted());
+    OpenGLTextureBudget::self()->markMipmapsUsed(this);
+
+    return m_mipmappedTexture.data();
+}
+
 } // namespace KWin
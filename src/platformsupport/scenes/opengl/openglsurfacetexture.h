@@ -11,6 +11,7 @@
 namespace KWin
 {
 
+class GLRenderTarget;
 class GLTexture;
 class OpenGLBackend;
 
@@ -28,9 +29,52 @@ public:
     virtual bool create() = 0;
     virtual void update(const QRegion &region) = 0;
 
+    /**
+     * Destroys the texture. It will be re-created with create() when it's needed again.
+     */
+    virtual void destroy();
+
+    /**
+     * Returns @c true if the texture can be destroyed to free video memory and re-created
+     * later; otherwise returns @c false.
+     */
+    virtual bool isEvictable() const;
+
+    /**
+     * Returns the estimated amount of video memory in bytes used by the texture and its
+     * mipmapped copy when it has been painted for the last time.
+     */
+    qint64 residentBytes() const;
+
+    /**
+     * Returns a mipmapped copy of the texture, which is suitable for painting the surface
+     * at a small scale. The mip levels are regenerated only if the contents of the texture
+     * have changed since the last call. Returns @c nullptr if the copy can't be created.
+     */
+    GLTexture *mipmappedTexture();
+    /**
+     * Notifies the surface texture that the contents of texture() have changed.
+     */
+    void markContentsChanged();
+    /**
+     * Destroys the mipmapped copy of the texture.
+     */
+    void discardMipmaps();
+
 protected:
     OpenGLBackend *m_backend;
     QScopedPointer<GLTexture> m_texture;
+
+private:
+    QScopedPointer<GLTexture> m_mipmappedTexture;
+    QScopedPointer<GLRenderTarget> m_mipmapRenderTarget;
+    bool m_mipmapsDirty = true;
+    qint64 m_residentBytes = 0;
+    qint64 m_lastUsed = 0;
+    qint64 m_mipmapsLastUsed = 0;
+    bool m_evicted = false;
+
+    friend class OpenGLTextureBudget;
 };
 
 } // namespace KWin
@@ -15,4 +15,11 @@ OpenGLSurfaceTextureInternal::OpenGLSurfaceTextureInternal(OpenGLBackend *backen
 {
 }
 
+bool OpenGLSurfaceTextureInternal::isEvictable() const
+{
+    // Internal windows usually render into a framebuffer object owned by Qt, destroying
+    // the texture wouldn't free any memory.
+    return false;
+}
+
 } // namespace KWin
@@ -18,6 +18,8 @@ class KWIN_EXPORT OpenGLSurfaceTextureInternal : public OpenGLSurfaceTexture
 public:
     OpenGLSurfaceTextureInternal(OpenGLBackend *backend, SurfacePixmapInternal *pixmap);
 
+    bool isEvictable() const override;
+
 protected:
     SurfacePixmapInternal *m_pixmap;
 };
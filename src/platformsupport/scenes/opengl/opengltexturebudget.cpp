@@ -0,0 +1,177 @@
+/*
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "opengltexturebudget.h"
+#include "kwingltexture.h"
+#include "openglsurfacetexture.h"
+
+#include <QVector>
+
+#include <algorithm>
+
+namespace KWin
+{
+
+// Textures that have been painted recently are likely to be painted again soon, e.g. when
+// rendering a frame on another output, so they are never evicted.
+static const qint64 s_minimumIdleTime = 3000;
+
+OpenGLTextureBudget *OpenGLTextureBudget::self()
+{
+    static OpenGLTextureBudget budget;
+    return &budget;
+}
+
+OpenGLTextureBudget::OpenGLTextureBudget()
+{
+    bool ok = false;
+    const qint64 megabytes = qEnvironmentVariableIntValue("KWIN_OPENGL_TEXTURE_BUDGET", &ok);
+    if (ok && megabytes > 0) {
+        m_budget = megabytes * 1024 * 1024;
+    }
+    m_clock.start();
+}
+
+qint64 OpenGLTextureBudget::budget() const
+{
+    return m_budget;
+}
+
+qint64 OpenGLTextureBudget::residentBytes() const
+{
+    return m_residentBytes;
+}
+
+int OpenGLTextureBudget::residentCount() const
+{
+    return m_residentCount;
+}
+
+int OpenGLTextureBudget::evictionCount() const
+{
+    return m_evictionCount;
+}
+
+int OpenGLTextureBudget::recreationCount() const
+{
+    return m_recreationCount;
+}
+
+void OpenGLTextureBudget::add(OpenGLSurfaceTexture *texture)
+{
+    m_textures.insert(texture);
+}
+
+void OpenGLTextureBudget::remove(OpenGLSurfaceTexture *texture)
+{
+    if (!m_textures.remove(texture)) {
+        return;
+    }
+    if (texture->m_residentBytes) {
+        m_residentBytes -= texture->m_residentBytes;
+        m_residentCount--;
+    }
+    if (texture->m_mipmapsLastUsed) {
+        m_mipmapCount--;
+    }
+}
+
+static qint64 textureBytes(const GLTexture *texture)
+{
+    return texture ? qint64(texture->width()) * texture->height() * 4 : 0;
+}
+
+static qint64 residentBytesOf(const OpenGLSurfaceTexture *texture, const GLTexture *mipmappedTexture)
+{
+    // The mip levels need one third of the size of the base level.
+    return textureBytes(texture->texture()) + textureBytes(mipmappedTexture) * 4 / 3;
+}
+
+void OpenGLTextureBudget::markUsed(OpenGLSurfaceTexture *texture)
+{
+    const qint64 bytes = residentBytesOf(texture, texture->m_mipmappedTexture.data());
+
+    if (bytes && !texture->m_residentBytes) {
+        m_residentCount++;
+        if (texture->m_evicted) {
+            texture->m_evicted = false;
+            m_recreationCount++;
+        }
+    } else if (!bytes && texture->m_residentBytes) {
+        m_residentCount--;
+    }
+
+    m_residentBytes += bytes - texture->m_residentBytes;
+    texture->m_residentBytes = bytes;
+    texture->m_lastUsed = m_clock.elapsed();
+}
+
+void OpenGLTextureBudget::markMipmapsUsed(OpenGLSurfaceTexture *texture)
+{
+    if (!texture->m_mipmapsLastUsed) {
+        m_mipmapCount++;
+    }
+    // A timestamp of zero means that the texture has no mipmapped copy.
+    texture->m_mipmapsLastUsed = std::max<qint64>(1, m_clock.elapsed());
+    markUsed(texture);
+}
+
+void OpenGLTextureBudget::evict()
+{
+    const qint64 now = m_clock.elapsed();
+
+    if (m_mipmapCount) {
+        for (OpenGLSurfaceTexture *texture : qAsConst(m_textures)) {
+            if (!texture->m_mipmapsLastUsed || now - texture->m_mipmapsLastUsed < s_minimumIdleTime) {
+                continue;
+            }
+            texture->discardMipmaps();
+            texture->m_mipmapsLastUsed = 0;
+            m_mipmapCount--;
+
+            const qint64 bytes = residentBytesOf(texture, nullptr);
+            if (!bytes && texture->m_residentBytes) {
+                m_residentCount--;
+            }
+            m_residentBytes += bytes - texture->m_residentBytes;
+            texture->m_residentBytes = bytes;
+        }
+    }
+
+    if (!m_budget || m_residentBytes <= m_budget) {
+        return;
+    }
+
+    QVector<OpenGLSurfaceTexture *> candidates;
+    for (OpenGLSurfaceTexture *texture : qAsConst(m_textures)) {
+        if (texture->m_residentBytes && texture->isEvictable() && now - texture->m_lastUsed >= s_minimumIdleTime) {
+            candidates.append(texture);
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](const OpenGLSurfaceTexture *a, const OpenGLSurfaceTexture *b) {
+        return a->m_lastUsed < b->m_lastUsed;
+    });
+
+    for (OpenGLSurfaceTexture *texture : qAsConst(candidates)) {
+        if (m_residentBytes <= m_budget) {
+            break;
+        }
+        texture->destroy();
+        if (texture->m_mipmapsLastUsed) {
+            texture->m_mipmapsLastUsed = 0;
+            m_mipmapCount--;
+        }
+
+        m_residentBytes -= texture->m_residentBytes;
+        m_residentCount--;
+        m_evictionCount++;
+        texture->m_residentBytes = 0;
+        texture->m_evicted = true;
+    }
+}
+
+} // namespace KWin
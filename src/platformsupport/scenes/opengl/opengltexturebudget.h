@@ -0,0 +1,91 @@
+/*
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <kwin_export.h>
+
+#include <QElapsedTimer>
+#include <QSet>
+
+namespace KWin
+{
+
+class OpenGLSurfaceTexture;
+
+/**
+ * The OpenGLTextureBudget class keeps track of the video memory used by surface textures.
+ *
+ * Every surface texture reports to the budget when it is painted. If the textures use more
+ * memory than the budget allows, the least recently painted textures that can be re-created
+ * later are destroyed until the textures fit in the budget again. An evicted texture is
+ * re-created the next time its surface is painted.
+ *
+ * Mipmapped copies of the textures are accounted as well. They are destroyed as soon as
+ * they haven't been painted for a while, regardless of the budget.
+ *
+ * The budget is set in MiB with the KWIN_OPENGL_TEXTURE_BUDGET environment variable. If it
+ * is not set, textures are only accounted but never evicted.
+ */
+class KWIN_EXPORT OpenGLTextureBudget
+{
+public:
+    static OpenGLTextureBudget *self();
+
+    /**
+     * Returns the maximum amount of memory in bytes that surface textures may use, or 0
+     * if textures are never evicted.
+     */
+    qint64 budget() const;
+    /**
+     * Returns the estimated amount of memory in bytes used by resident surface textures.
+     */
+    qint64 residentBytes() const;
+    /**
+     * Returns the number of surface textures that are currently resident.
+     */
+    int residentCount() const;
+    /**
+     * Returns how many times textures have been evicted so far.
+     */
+    int evictionCount() const;
+    /**
+     * Returns how many evicted textures have been re-created so far.
+     */
+    int recreationCount() const;
+
+    void add(OpenGLSurfaceTexture *texture);
+    void remove(OpenGLSurfaceTexture *texture);
+
+    /**
+     * Marks the @a texture as painted in the current frame and updates its memory usage.
+     */
+    void markUsed(OpenGLSurfaceTexture *texture);
+    /**
+     * Marks the mipmapped copy of the @a texture as painted in the current frame.
+     */
+    void markMipmapsUsed(OpenGLSurfaceTexture *texture);
+
+    /**
+     * Destroys idle mipmapped copies and evicts least recently used textures until the
+     * resident textures fit in the budget. The OpenGL context must be current.
+     */
+    void evict();
+
+private:
+    OpenGLTextureBudget();
+
+    QSet<OpenGLSurfaceTexture *> m_textures;
+    QElapsedTimer m_clock;
+    qint64 m_budget = 0;
+    qint64 m_residentBytes = 0;
+    int m_residentCount = 0;
+    int m_mipmapCount = 0;
+    int m_evictionCount = 0;
+    int m_recreationCount = 0;
+};
+
+} // namespace KWin
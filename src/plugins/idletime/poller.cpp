@@ -14,6 +14,9 @@
 #include <KWaylandServer/seat_interface.h>
 #include <KWaylandServer/idle_interface.h>
 
+#include <algorithm>
+#include <optional>
+
 
 namespace KWin
 {
@@ -21,6 +24,11 @@ namespace KWin
 KWinIdleTimePoller::KWinIdleTimePoller(QObject *parent)
     : AbstractSystemPoller(parent)
 {
+    // A single timer for all timeouts. It is not restarted on every input event, only the
+    // time of the last activity is recorded. When the timer fires before the nearest timeout
+    // has been reached, it is re-armed for the remaining time.
+    m_timer.setSingleShot(true);
+    m_timer.callOnTimeout(this, &KWinIdleTimePoller::checkTimeouts);
 }
 
 KWinIdleTimePoller::~KWinIdleTimePoller() = default;
@@ -35,6 +43,7 @@ bool KWinIdleTimePoller::setUpPoller()
     connect(waylandServer()->idle(), &KWaylandServer::IdleInterface::inhibitedChanged, this, &KWinIdleTimePoller::onInhibitedChanged);
     connect(waylandServer()->seat(), &KWaylandServer::SeatInterface::timestampChanged, this, &KWinIdleTimePoller::onTimestampChanged);
 
+    m_lastActivity = std::chrono::steady_clock::now();
     return true;
 }
 
@@ -45,7 +54,7 @@ void KWinIdleTimePoller::unloadPoller()
         disconnect(waylandServer()->seat(), &KWaylandServer::SeatInterface::timestampChanged, this, &KWinIdleTimePoller::onTimestampChanged);
     }
 
-    qDeleteAll(m_timeouts);
+    m_timer.stop();
     m_timeouts.clear();
 
     m_idling = false;
@@ -53,34 +62,101 @@ void KWinIdleTimePoller::unloadPoller()
 
 void KWinIdleTimePoller::addTimeout(int newTimeout)
 {
-    if (m_timeouts.contains(newTimeout)) {
+    auto it = std::lower_bound(m_timeouts.begin(), m_timeouts.end(), newTimeout, [](const Timeout &timeout, int interval) {
+        return timeout.interval < interval;
+    });
+    if (it != m_timeouts.end() && it->interval == newTimeout) {
         return;
     }
 
-    auto timer = new QTimer();
-    timer->setInterval(newTimeout);
-    timer->setSingleShot(true);
-    timer->callOnTimeout(this, [newTimeout, this](){
-        m_idling = true;
-        Q_EMIT timeoutReached(newTimeout);
+    // a new timeout fires after the given interval even if the user has been idle for longer
+    m_timeouts.insert(it, Timeout{newTimeout, std::chrono::steady_clock::now()});
+    scheduleTimer();
+}
+
+void KWinIdleTimePoller::removeTimeout(int nextTimeout)
+{
+    auto it = std::find_if(m_timeouts.begin(), m_timeouts.end(), [nextTimeout](const Timeout &timeout) {
+        return timeout.interval == nextTimeout;
     });
+    if (it == m_timeouts.end()) {
+        return;
+    }
+
+    m_timeouts.erase(it);
+    scheduleTimer();
+}
 
-    m_timeouts.insert(newTimeout, timer);
+std::chrono::steady_clock::time_point KWinIdleTimePoller::deadline(const Timeout &timeout) const
+{
+    return std::max(m_lastActivity, timeout.registered) + std::chrono::milliseconds(timeout.interval);
+}
 
-    if (!waylandServer()->idle()->isInhibited()) {
-        timer->start();
+void KWinIdleTimePoller::scheduleTimer()
+{
+    if (waylandServer()->idle()->isInhibited()) {
+        m_timer.stop();
+        return;
+    }
+
+    std::optional<std::chrono::steady_clock::time_point> nearest;
+    for (const Timeout &timeout : qAsConst(m_timeouts)) {
+        if (!timeout.reached && (!nearest || deadline(timeout) < *nearest)) {
+            nearest = deadline(timeout);
+        }
+    }
+    if (!nearest) {
+        m_timer.stop();
+        return;
+    }
+
+    const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(*nearest - std::chrono::steady_clock::now());
+    m_timer.start(std::max(remaining, std::chrono::milliseconds::zero()));
+}
+
+void KWinIdleTimePoller::checkTimeouts()
+{
+    // the handlers of timeoutReached() may add or remove timeouts, so look the next one up again
+    // after every emission
+    while (true) {
+        const auto now = std::chrono::steady_clock::now();
+        auto it = std::find_if(m_timeouts.begin(), m_timeouts.end(), [this, now](const Timeout &timeout) {
+            return !timeout.reached && deadline(timeout) <= now;
+        });
+        if (it == m_timeouts.end()) {
+            break;
+        }
+        it->reached = true;
+        m_idling = true;
+        Q_EMIT timeoutReached(it->interval);
+    }
+    scheduleTimer();
+}
+
+void KWinIdleTimePoller::resetTimeouts()
+{
+    for (Timeout &timeout : m_timeouts) {
+        timeout.reached = false;
     }
 }
 
 void KWinIdleTimePoller::processActivity()
 {
+    m_lastActivity = std::chrono::steady_clock::now();
+
     if (m_idling) {
         Q_EMIT resumingFromIdle();
         m_idling = false;
     }
 
-    for (QTimer *timer : qAsConst(m_timeouts)) {
-        timer->start();
+    // If no timeout has been reached, the timer is still armed for the nearest one and
+    // will re-arm itself when it fires, there is nothing else to do per input event.
+    const bool reached = std::any_of(m_timeouts.cbegin(), m_timeouts.cend(), [](const Timeout &timeout) {
+        return timeout.reached;
+    });
+    if (reached) {
+        resetTimeouts();
+        scheduleTimer();
     }
 }
 
@@ -107,16 +183,14 @@ void KWinIdleTimePoller::onTimestampChanged()
 
 void KWinIdleTimePoller::catchIdleEvent()
 {
-    for (QTimer *timer : qAsConst(m_timeouts)) {
-        timer->start();
-    }
+    m_lastActivity = std::chrono::steady_clock::now();
+    resetTimeouts();
+    scheduleTimer();
 }
 
 void KWinIdleTimePoller::stopCatchingIdleEvents()
 {
-    for (QTimer *timer : qAsConst(m_timeouts)) {
-        timer->stop();
-    }
+    m_timer.stop();
 }
 
 void KWinIdleTimePoller::simulateUserActivity()
@@ -128,14 +202,14 @@ void KWinIdleTimePoller::simulateUserActivity()
     waylandServer()->simulateUserActivity();
 }
 
-void KWinIdleTimePoller::removeTimeout(int nextTimeout)
-{
-    delete m_timeouts.take(nextTimeout);
-}
-
 QList< int > KWinIdleTimePoller::timeouts() const
 {
-    return m_timeouts.keys();
+    QList<int> timeouts;
+    timeouts.reserve(m_timeouts.count());
+    for (const Timeout &timeout : m_timeouts) {
+        timeouts.append(timeout.interval);
+    }
+    return timeouts;
 }
 
 int KWinIdleTimePoller::forcePollRequest()
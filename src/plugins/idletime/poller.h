@@ -10,8 +10,10 @@
 #define POLLER_H
 
 #include <KIdleTime/private/abstractsystempoller.h>
-#include <QHash>
 #include <QTimer>
+#include <QVector>
+
+#include <chrono>
 
 namespace KWin
 {
@@ -45,7 +47,25 @@ private Q_SLOTS:
 
 private:
     void processActivity();
-    QHash<int, QTimer *> m_timeouts;
+    void checkTimeouts();
+    void scheduleTimer();
+    void resetTimeouts();
+
+    struct Timeout
+    {
+        int interval;
+        std::chrono::steady_clock::time_point registered;
+        bool reached = false;
+    };
+    std::chrono::steady_clock::time_point deadline(const Timeout &timeout) const;
+
+    /**
+     * The registered timeouts, sorted by their interval in ascending order. A timeout is
+     * counted from the last user activity, or from when it was added if that is later.
+     */
+    QVector<Timeout> m_timeouts;
+    std::chrono::steady_clock::time_point m_lastActivity;
+    QTimer m_timer;
     bool m_idling = false;
 };
 
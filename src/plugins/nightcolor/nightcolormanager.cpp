@@ -27,12 +27,42 @@
 #include <QDBusConnection>
 #include <QTimer>
 
+#include <cmath>
+
 namespace KWin {
 
 static const int QUICK_ADJUST_DURATION = 2000;
-static const int TEMPERATURE_STEP = 50;
+// Differences of color temperature are perceived about uniformly in mireds (10^6 / K). A step
+// of 5 mireds is close to the smallest noticeable change, smaller steps only cost updates.
+static const qreal MIRED_STEP = 5.0;
 static NightColorManager *s_instance = nullptr;
 
+static qreal toMireds(int temperature)
+{
+    return 1000000.0 / temperature;
+}
+
+/**
+ * Returns the number of steps it takes to get from @a temperature to @a targetTemperature.
+ */
+static int temperatureStepCount(int temperature, int targetTemperature)
+{
+    return std::ceil(qAbs(toMireds(targetTemperature) - toMireds(temperature)) / MIRED_STEP);
+}
+
+/**
+ * Returns the temperature that is one step away from @a temperature in the direction of
+ * @a targetTemperature, without going beyond it.
+ */
+static int nextTemperature(int temperature, int targetTemperature)
+{
+    if (temperature < targetTemperature) {
+        return qMin(qRound(1000000.0 / (toMireds(temperature) - MIRED_STEP)), targetTemperature);
+    } else {
+        return qMax(qRound(1000000.0 / (toMireds(temperature) + MIRED_STEP)), targetTemperature);
+    }
+}
+
 static bool checkLocation(double lat, double lng)
 {
     return -90 <= lat && lat <= 90 && -180 <= lng && lng <= 180;
@@ -351,15 +381,15 @@ void NightColorManager::resetQuickAdjustTimer()
     updateTransitionTimings(false);
     updateTargetTemperature();
 
-    int tempDiff = qAbs(currentTargetTemp() - m_currentTemp);
-    // allow tolerance of one TEMPERATURE_STEP to compensate if a slow update is coincidental
-    if (tempDiff > TEMPERATURE_STEP) {
+    const int stepCount = temperatureStepCount(m_currentTemp, currentTargetTemp());
+    // allow tolerance of one step to compensate if a slow update is coincidental
+    if (stepCount > 1) {
         cancelAllTimers();
         m_quickAdjustTimer = new QTimer(this);
         m_quickAdjustTimer->setSingleShot(false);
         connect(m_quickAdjustTimer, &QTimer::timeout, this, &NightColorManager::quickAdjust);
 
-        int interval = QUICK_ADJUST_DURATION / (tempDiff / TEMPERATURE_STEP);
+        int interval = QUICK_ADJUST_DURATION / stepCount;
         if (interval == 0) {
             interval = 1;
         }
@@ -375,14 +405,8 @@ void NightColorManager::quickAdjust()
         return;
     }
 
-    int nextTemp;
     const int targetTemp = currentTargetTemp();
-
-    if (m_currentTemp < targetTemp) {
-        nextTemp = qMin(m_currentTemp + TEMPERATURE_STEP, targetTemp);
-    } else {
-        nextTemp = qMax(m_currentTemp - TEMPERATURE_STEP, targetTemp);
-    }
+    const int nextTemp = nextTemperature(m_currentTemp, targetTemp);
     commitGammaRamps(nextTemp);
 
     if (nextTemp == targetTemp) {
@@ -447,14 +471,16 @@ void NightColorManager::resetSlowUpdateTimer()
         int availTime = now.msecsTo(m_prev.second);
         m_slowUpdateTimer = new QTimer(this);
         m_slowUpdateTimer->setSingleShot(false);
+        // the steps are usually minutes apart, they don't need to be punctual
+        m_slowUpdateTimer->setTimerType(Qt::CoarseTimer);
         if (isDay) {
             connect(m_slowUpdateTimer, &QTimer::timeout, this, [this]() {slowUpdate(m_dayTargetTemp);});
         } else {
             connect(m_slowUpdateTimer, &QTimer::timeout, this, [this]() {slowUpdate(m_nightTargetTemp);});
         }
 
-        // calculate interval such as temperature is changed by TEMPERATURE_STEP K per timer timeout
-        int interval = availTime * TEMPERATURE_STEP / qAbs(targetTemp - m_currentTemp);
+        // calculate interval such as temperature is changed by one step per timer timeout
+        int interval = availTime / qMax(1, temperatureStepCount(m_currentTemp, targetTemp));
         if (interval == 0) {
             interval = 1;
         }
@@ -467,12 +493,7 @@ void NightColorManager::slowUpdate(int targetTemp)
     if (!m_slowUpdateTimer) {
         return;
     }
-    int nextTemp;
-    if (m_currentTemp < targetTemp) {
-        nextTemp = qMin(m_currentTemp + TEMPERATURE_STEP, targetTemp);
-    } else {
-        nextTemp = qMax(m_currentTemp - TEMPERATURE_STEP, targetTemp);
-    }
+    const int nextTemp = nextTemperature(m_currentTemp, targetTemp);
     commitGammaRamps(nextTemp);
     if (nextTemp == targetTemp) {
         // stop timer, we reached the target temp
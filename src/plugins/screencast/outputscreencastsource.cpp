@@ -41,6 +41,15 @@ void OutputScreenCastSource::render(QImage *image)
     }
 }
 
+bool OutputScreenCastSource::download(bool hasAlpha, qsizetype bufferSize)
+{
+    const QSharedPointer<GLTexture> outputTexture = Compositor::self()->scene()->textureForOutput(m_output);
+    if (!outputTexture) {
+        return false;
+    }
+    return downloadTexture(outputTexture.data(), textureSize(), hasAlpha, bufferSize, nullptr);
+}
+
 void OutputScreenCastSource::render(GLRenderTarget *target)
 {
     const QSharedPointer<GLTexture> outputTexture = Compositor::self()->scene()->textureForOutput(m_output);
@@ -55,11 +64,17 @@ void OutputScreenCastSource::render(GLRenderTarget *target)
     projectionMatrix.ortho(geometry);
     shaderBinder.shader()->setUniform(GLShader::ModelViewProjectionMatrix, projectionMatrix);
 
+    // the target can be smaller than the output if the stream is scaled down
+    const GLenum filter = outputTexture->filter();
+    outputTexture->setFilter(GL_LINEAR);
+
     GLRenderTarget::pushRenderTarget(target);
     outputTexture->bind();
     outputTexture->render(geometry, geometry, true);
     outputTexture->unbind();
     GLRenderTarget::popRenderTarget();
+
+    outputTexture->setFilter(filter);
 }
 
 } // namespace KWin
@@ -27,6 +27,7 @@ public:
 
     void render(GLRenderTarget *target) override;
     void render(QImage *image) override;
+    bool download(bool hasAlpha, qsizetype bufferSize) override;
 
 private:
     QPointer<AbstractOutput> m_output;
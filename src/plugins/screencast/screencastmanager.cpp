@@ -15,6 +15,7 @@
 #include "kwingltexture.h"
 #include "outputscreencastsource.h"
 #include "screencaststream.h"
+#include "screencastutils.h"
 #include "platform.h"
 #include "scene.h"
 #include "wayland_server.h"
@@ -43,7 +44,7 @@ class WindowStream : public ScreenCastStream
 {
 public:
     WindowStream(Toplevel *toplevel, QObject *parent)
-        : ScreenCastStream(new WindowScreenCastSource(toplevel), parent)
+        : ScreenCastStream(new WindowScreenCastSource(toplevel, qEnvironmentVariableIntValue("KWIN_SCREENCAST_WINDOW_EFFECTS") == 1), parent)
         , m_toplevel(toplevel)
     {
         if (AbstractClient *client = qobject_cast<AbstractClient *>(toplevel)) {
@@ -58,7 +59,7 @@ private:
         connect(Compositor::self()->scene(), &Scene::frameRendered, this, &WindowStream::bufferToStream);
 
         connect(m_toplevel, &Toplevel::damaged, this, &WindowStream::includeDamage);
-        m_damagedRegion = m_toplevel->visibleGeometry();
+        m_damagedRegion = frame();
         m_toplevel->addRepaintFull();
     }
 
@@ -68,7 +69,14 @@ private:
 
     void includeDamage(Toplevel *toplevel, const QRegion &damage) {
         Q_ASSERT(m_toplevel == toplevel);
-        m_damagedRegion |= damage;
+        Q_UNUSED(damage)
+        // The damage is reported in the coordinates of the surface that got damaged, which
+        // do not necessarily match the streamed frame
+        m_damagedRegion = frame();
+    }
+
+    QRect frame() const {
+        return QRect(QPoint(), m_toplevel->clientGeometry().size());
     }
 
     void bufferToStream () {
@@ -124,24 +132,43 @@ void ScreencastManager::streamOutput(KWaylandServer::ScreencastStreamV1Interface
         return;
     }
 
+    const auto key = qMakePair(streamOutput, mode);
+    if (ScreenCastStream *stream = m_outputStreams.value(key)) {
+        // The frames are rendered and copied once, PipeWire hands the buffers to every consumer
+        integrateStreams(waylandStream, stream);
+        return;
+    }
+
     auto stream = new ScreenCastStream(new OutputScreenCastSource(streamOutput), this);
+    m_outputStreams.insert(key, stream);
+    connect(stream, &QObject::destroyed, this, [this, key] {
+        m_outputStreams.remove(key);
+    });
     stream->setObjectName(streamOutput->name());
     stream->setCursorMode(mode, streamOutput->scale(), streamOutput->geometry());
+    stream->setRenderLoop(streamOutput->renderLoop());
     auto bufferToStream = [streamOutput, stream] (const QRegion &damagedRegion) {
         if (damagedRegion.isEmpty()) {
             return;
         }
 
         const QRect frame({}, streamOutput->modeSize());
-        const QRegion region = streamOutput->pixelSize() != streamOutput->modeSize() ? frame : damagedRegion.translated(-streamOutput->geometry().topLeft()).intersected(frame);
-        stream->recordFrame(region);
+        if (streamOutput->pixelSize() != streamOutput->modeSize()) {
+            // the output is rotated, the damage would have to be transformed as well
+            stream->recordFrame(frame);
+            return;
+        }
+        // the damage is in logical coordinates while the streamed frame is in device pixels
+        const QRegion localDamage = damagedRegion.translated(-streamOutput->geometry().topLeft());
+        stream->recordFrame(scaleRegion(localDamage, streamOutput->scale()).intersected(frame));
     };
-    connect(stream, &ScreenCastStream::startStreaming, waylandStream, [streamOutput, stream, bufferToStream] {
+    // the stream can outlive the wayland stream it has been created for if it is shared
+    connect(stream, &ScreenCastStream::startStreaming, stream, [streamOutput, stream, bufferToStream] {
         Compositor::self()->scene()->addRepaint(streamOutput->geometry());
         streamOutput->recordingStarted();
         connect(streamOutput, &AbstractWaylandOutput::outputChange, stream, bufferToStream);
     });
-    connect(stream, &ScreenCastStream::stopStreaming, waylandStream, [streamOutput]{
+    connect(stream, &ScreenCastStream::stopStreaming, stream, [streamOutput]{
         streamOutput->recordingStopped();
     });
     integrateStreams(waylandStream, stream);
@@ -149,16 +176,35 @@ void ScreencastManager::streamOutput(KWaylandServer::ScreencastStreamV1Interface
 
 void ScreencastManager::integrateStreams(KWaylandServer::ScreencastStreamV1Interface *waylandStream, ScreenCastStream *stream)
 {
-    connect(waylandStream, &KWaylandServer::ScreencastStreamV1Interface::finished, stream, &ScreenCastStream::stop);
-    connect(stream, &ScreenCastStream::stopStreaming, waylandStream, [stream, waylandStream] {
+    const bool shared = m_streamUsers.contains(stream);
+    m_streamUsers[stream]++;
+
+    connect(waylandStream, &KWaylandServer::ScreencastStreamV1Interface::finished, stream, [this, stream] {
+        auto it = m_streamUsers.find(stream);
+        if (it != m_streamUsers.end() && --(*it) == 0) {
+            m_streamUsers.erase(it);
+            stream->stop();
+        }
+    });
+    connect(stream, &ScreenCastStream::stopStreaming, waylandStream, [this, stream, waylandStream] {
         waylandStream->sendClosed();
+        m_streamUsers.remove(stream);
         stream->deleteLater();
     });
-    connect(stream, &ScreenCastStream::streamReady, stream, [waylandStream] (uint nodeid) {
+    connect(stream, &ScreenCastStream::streamReady, waylandStream, [waylandStream] (uint nodeid) {
         waylandStream->sendCreated(nodeid);
     });
+
+    if (shared) {
+        if (stream->nodeId()) {
+            waylandStream->sendCreated(stream->nodeId());
+        }
+        return;
+    }
+
     if (!stream->init()) {
         waylandStream->sendFailed(stream->error());
+        m_streamUsers.remove(stream);
         delete stream;
     }
 }
@@ -12,6 +12,8 @@
 
 #include <KWaylandServer/screencast_v1_interface.h>
 
+#include <QHash>
+
 namespace KWin
 {
 class AbstractWaylandOutput;
@@ -40,6 +42,10 @@ private:
     void integrateStreams(KWaylandServer::ScreencastStreamV1Interface *waylandStream, ScreenCastStream *stream);
 
     KWaylandServer::ScreencastV1Interface *m_screencast;
+
+    // Consumers of the same output share a stream, they are linked to the same PipeWire node
+    QHash<QPair<AbstractWaylandOutput *, KWaylandServer::ScreencastV1Interface::CursorMode>, ScreenCastStream *> m_outputStreams;
+    QHash<ScreenCastStream *, int> m_streamUsers;
 };
 
 } // namespace KWin
@@ -25,6 +25,13 @@ public:
 
     virtual void render(GLRenderTarget *target) = 0;
     virtual void render(QImage *image) = 0;
+    /**
+     * Like render(QImage *), but reads the pixels into the buffer bound to
+     * GL_PIXEL_PACK_BUFFER without waiting for the GPU to finish.
+     *
+     * Returns @c true if the rows still have to be mirrored vertically.
+     */
+    virtual bool download(bool hasAlpha, qsizetype bufferSize) = 0;
 
 Q_SIGNALS:
     void closed();
@@ -7,6 +7,7 @@
 */
 
 #include "screencaststream.h"
+#include "composite.h"
 #include "cursor.h"
 #include "dmabuftexture.h"
 #include "eglnativefence.h"
@@ -17,7 +18,10 @@
 #include "main.h"
 #include "pipewirecore.h"
 #include "platform.h"
+#include "renderloop.h"
+#include "scene.h"
 #include "screencastsource.h"
+#include "screencastutils.h"
 #include "utils/common.h"
 
 #include <KLocalizedString>
@@ -36,6 +40,21 @@
 namespace KWin
 {
 
+// Copies @p region of the frame at @p pixels, which has the format of @p target, into @p target
+static void copyRegion(const uchar *pixels, int stride, bool mirror, const QRegion &region, QImage *target)
+{
+    const int bytesPerPixel = target->depth() / 8;
+    for (const QRect &rect : region) {
+        const int offset = rect.x() * bytesPerPixel;
+        const int length = rect.width() * bytesPerPixel;
+        for (int y = rect.top(); y <= rect.bottom(); ++y) {
+            // flip while copying rather than in a second pass over the frame
+            const int sourceRow = mirror ? target->height() - y - 1 : y;
+            memcpy(target->scanLine(y) + offset, pixels + sourceRow * stride + offset, length);
+        }
+    }
+}
+
 void ScreenCastStream::onStreamStateChanged(void *data, pw_stream_state old, pw_stream_state state, const char *error_message)
 {
     ScreenCastStream *pw = static_cast<ScreenCastStream*>(data);
@@ -108,9 +127,13 @@ void ScreenCastStream::newStreamParams()
                                                             sizeof(struct spa_meta_region) * videoDamageRegionCount,
                                                             sizeof(struct spa_meta_region) * 1,
                                                             sizeof(struct spa_meta_region) * videoDamageRegionCount)),
+        (spa_pod*) spa_pod_builder_add_object(&pod_builder,
+                                              SPA_TYPE_OBJECT_ParamMeta, SPA_PARAM_Meta,
+                                              SPA_PARAM_META_type, SPA_POD_Id(SPA_META_Header),
+                                              SPA_PARAM_META_size, SPA_POD_Int(sizeof(struct spa_meta_header))),
     };
 
-    pw_stream_update_params(pwStream, params, 3);
+    pw_stream_update_params(pwStream, params, 4);
 }
 
 void ScreenCastStream::onStreamParamChanged(void *data, uint32_t id, const struct spa_pod *format)
@@ -148,6 +171,7 @@ void ScreenCastStream::onStreamAddBuffer(void *data, pw_buffer *buffer)
       spa_data->maxsize = dmabuf->stride() * stream->m_resolution.height();
 
       stream->m_dmabufDataForPwBuffer.insert(buffer, dmabuf);
+      stream->m_bufferContents.insert(buffer, {QRect(QPoint(), stream->m_resolution), QRect()});
 #ifdef F_SEAL_SEAL //Disable memfd on systems that don't have it, like BSD < 12
     } else {
         if (!(spa_data[0].type & (1 << SPA_DATA_MemFd))) {
@@ -185,6 +209,7 @@ void ScreenCastStream::onStreamAddBuffer(void *data, pw_buffer *buffer)
             qCCritical(KWIN_SCREENCAST) << "memfd: Failed to mmap memory";
         else
             qCDebug(KWIN_SCREENCAST) << "memfd: created successfully" << spa_data->data << spa_data->maxsize;
+        stream->m_bufferContents.insert(buffer, {QRect(QPoint(), stream->m_resolution), QRect()});
 #endif
     }
 }
@@ -193,6 +218,7 @@ void ScreenCastStream::onStreamRemoveBuffer(void *data, pw_buffer *buffer)
 {
     ScreenCastStream *stream = static_cast<ScreenCastStream *>(data);
     stream->m_dmabufDataForPwBuffer.remove(buffer);
+    stream->m_bufferContents.remove(buffer);
 
     struct spa_buffer *spa_buffer = buffer->buffer;
     struct spa_data *spa_data = spa_buffer->datas;
@@ -205,8 +231,15 @@ void ScreenCastStream::onStreamRemoveBuffer(void *data, pw_buffer *buffer)
 ScreenCastStream::ScreenCastStream(ScreenCastSource *source, QObject *parent)
     : QObject(parent)
     , m_source(source)
-    , m_resolution(source->textureSize())
 {
+    bool ok = false;
+    const int maxHeight = qEnvironmentVariableIntValue("KWIN_SCREENCAST_MAX_HEIGHT", &ok);
+    if (ok && maxHeight > 0) {
+        m_maxHeight = maxHeight;
+    }
+    m_resolution = streamSize(source->textureSize());
+    updateStreamScale();
+
     connect(source, &ScreenCastSource::closed, this, &ScreenCastStream::stopStreaming);
 
     pwStreamEvents.version = PW_VERSION_STREAM_EVENTS;
@@ -214,11 +247,43 @@ ScreenCastStream::ScreenCastStream(ScreenCastSource *source, QObject *parent)
     pwStreamEvents.remove_buffer = &ScreenCastStream::onStreamRemoveBuffer;
     pwStreamEvents.state_changed = &ScreenCastStream::onStreamStateChanged;
     pwStreamEvents.param_changed = &ScreenCastStream::onStreamParamChanged;
+
+    m_pacingTimer.setSingleShot(true);
+    connect(&m_pacingTimer, &QTimer::timeout, this, [this] {
+        Compositor::self()->scene()->makeOpenGLContextCurrent();
+        recordFrame(QRegion());
+    });
+
+    ok = false;
+    const int maxFramerate = qEnvironmentVariableIntValue("KWIN_SCREENCAST_MAX_FRAMERATE", &ok);
+    if (ok && maxFramerate > 0) {
+        m_maxFramerate = maxFramerate;
+    }
+
+    ok = false;
+    const int minFramerate = qEnvironmentVariableIntValue("KWIN_SCREENCAST_MIN_FRAMERATE", &ok);
+    if (ok) {
+        m_minFramerate = std::max(minFramerate, 0);
+    }
+    if (m_minFramerate) {
+        m_keepaliveTimer.setSingleShot(true);
+        m_keepaliveTimer.setInterval(1000 / m_minFramerate);
+        connect(&m_keepaliveTimer, &QTimer::timeout, this, [this] {
+            Compositor::self()->scene()->makeOpenGLContextCurrent();
+            recordFrame(QRegion());
+        });
+    }
 }
 
 ScreenCastStream::~ScreenCastStream()
 {
     m_stopped = true;
+    if (m_readback.buffer || m_scaledTexture) {
+        Compositor::self()->scene()->makeOpenGLContextCurrent();
+        glDeleteBuffers(1, &m_readback.buffer);
+        m_scaledTarget.reset();
+        m_scaledTexture.reset();
+    }
     if (pwStream) {
         pw_stream_destroy(pwStream);
     }
@@ -264,8 +329,8 @@ bool ScreenCastStream::createStream()
 
     uint8_t buffer[2048];
     spa_pod_builder podBuilder = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
-    spa_fraction minFramerate = SPA_FRACTION(1, 1);
-    spa_fraction maxFramerate = SPA_FRACTION(25, 1);
+    spa_fraction minFramerate = SPA_FRACTION(std::max(m_minFramerate, 1u), 1);
+    spa_fraction maxFramerate = SPA_FRACTION(m_maxFramerate, 1);
     spa_fraction defaultFramerate = SPA_FRACTION(0, 1);
 
     spa_rectangle resolution = SPA_RECTANGLE(uint32_t(m_resolution.width()), uint32_t(m_resolution.height()));
@@ -302,7 +367,7 @@ bool ScreenCastStream::createStream()
 
     if (m_cursor.mode == KWaylandServer::ScreencastV1Interface::Embedded) {
         connect(Cursors::self(), &Cursors::positionChanged, this, [this] {
-            recordFrame(QRegion{m_cursor.lastRect} | cursorGeometry(Cursors::self()->currentCursor()));
+            recordFrame(QRegion{m_cursor.lastRect} | cursorGeometry(Cursors::self()->currentCursor()), false);
         });
     } else if (m_cursor.mode == KWaylandServer::ScreencastV1Interface::Metadata) {
         connect(Cursors::self(), &Cursors::positionChanged, this, &ScreenCastStream::recordCursor);
@@ -323,16 +388,38 @@ void ScreenCastStream::stop()
 }
 
 void ScreenCastStream::recordFrame(const QRegion &damagedRegion)
+{
+    recordFrame(damagedRegion, true);
+}
+
+/**
+ * @p sourceDamaged is @c false if @p damagedRegion is only about the embedded cursor having moved,
+ * in which case memory buffers can be updated from the cached background.
+ */
+void ScreenCastStream::recordFrame(const QRegion &damagedRegion, bool sourceDamaged)
 {
     Q_ASSERT(!m_stopped);
 
+    const QRegion scaledDamage = m_streamScale == 1 ? damagedRegion : scaleRegion(damagedRegion, m_streamScale);
+    if (sourceDamaged) {
+        m_backgroundDamage += scaledDamage;
+    }
+
+    // Buffers that are not filled now need to catch up later, even if this frame is dropped
+    for (BufferContent &content : m_bufferContents) {
+        content.damage += scaledDamage;
+    }
+    m_skippedDamage += scaledDamage;
+
     if (m_pendingBuffer) {
         qCWarning(KWIN_SCREENCAST) << "Dropping a screencast frame because the compositor is slow";
         return;
     }
 
-    if (m_source->textureSize() != m_resolution) {
-        m_resolution = m_source->textureSize();
+    const QSize resolution = streamSize(m_source->textureSize());
+    if (resolution != m_resolution) {
+        m_resolution = resolution;
+        updateStreamScale();
         newStreamParams();
         return;
     }
@@ -346,12 +433,18 @@ void ScreenCastStream::recordFrame(const QRegion &damagedRegion)
         return;
     }
 
+    if (!paceFrame()) {
+        return;
+    }
+
     struct pw_buffer *buffer = pw_stream_dequeue_buffer(pwStream);
 
     if (!buffer) {
         return;
     }
 
+    const QRegion damage = std::exchange(m_skippedDamage, QRegion());
+
     struct spa_buffer *spa_buffer = buffer->buffer;
     struct spa_data *spa_data = spa_buffer->datas;
 
@@ -362,7 +455,11 @@ void ScreenCastStream::recordFrame(const QRegion &damagedRegion)
         return;
     }
 
-    const auto size = m_source->textureSize();
+    const auto size = m_resolution;
+    BufferContent &content = m_bufferContents[buffer];
+    const QRegion contentDamage = (content.damage | content.cursorRect).intersected(QRect(QPoint(), size));
+    content = {};
+
     spa_data->chunk->offset = 0;
     if (data || spa_data[0].type == SPA_DATA_MemFd) {
         const bool hasAlpha = m_source->hasAlphaChannel();
@@ -379,14 +476,46 @@ void ScreenCastStream::recordFrame(const QRegion &damagedRegion)
         spa_data->chunk->size = dest.sizeInBytes();
         spa_data->chunk->stride = dest.bytesPerLine();
 
-        m_source->render(&dest);
-
         auto cursor = Cursors::self()->currentCursor();
-        if (m_cursor.mode == KWaylandServer::ScreencastV1Interface::Embedded && m_cursor.viewport.contains(cursor->pos())) {
-            QPainter painter(&dest);
-            const auto position = (cursor->pos() - m_cursor.viewport.topLeft() - cursor->hotspot()) * m_cursor.scale;
-            painter.drawImage(QRect{position, cursor->image().size()}, cursor->image());
+        const bool paintCursor = m_cursor.mode == KWaylandServer::ScreencastV1Interface::Embedded && m_cursor.viewport.contains(cursor->pos());
+        const QPoint cursorPosition = (cursor->pos() - m_cursor.viewport.topLeft() - cursor->hotspot()) * m_cursor.scale;
+
+        const QRect cursorRect(cursorPosition, cursor->image().size() * m_streamScale);
+        const bool backgroundValid = m_background.size() == dest.size() && m_background.format() == dest.format()
+            && m_backgroundDamage.isEmpty();
+        if (contentDamage.isEmpty()) {
+            // The buffer still holds the current contents
+        } else if (backgroundValid) {
+            // Only the cursor has changed, nothing has to be downloaded
+            copyRegion(m_background.constBits(), m_background.bytesPerLine(), false, contentDamage, &dest);
+            if (paintCursor) {
+                QPainter painter(&dest);
+                painter.drawImage(cursorRect, cursor->image());
+            }
+        } else if (startReadback(dest, contentDamage)) {
+            // The cursor is painted once the pixels have arrived
+            m_readback.cursorImage = paintCursor ? cursor->image() : QImage();
+            m_readback.cursorRect = cursorRect;
+        } else {
+            if (m_streamScale != 1) {
+                grabTexture(renderScaled(), &dest);
+            } else {
+                m_source->render(&dest);
+            }
+            m_background = QImage();
+
+            if (paintCursor) {
+                QPainter painter(&dest);
+                painter.drawImage(cursorRect, cursor->image());
+            }
         }
+        if (paintCursor) {
+            content.cursorRect = cursorRect;
+        }
+    } else if (contentDamage.isEmpty()) {
+        // The buffer still holds the current contents
+        spa_data->chunk->stride = m_dmabufDataForPwBuffer[buffer]->stride();
+        spa_data->chunk->size = spa_data->maxsize;
     } else {
         auto &buf = m_dmabufDataForPwBuffer[buffer];
 
@@ -432,18 +561,25 @@ void ScreenCastStream::recordFrame(const QRegion &damagedRegion)
                         (spa_meta_cursor *) spa_buffer_find_meta_data (spa_buffer, SPA_META_Cursor, sizeof (spa_meta_cursor)));
     }
 
+    if (auto header = (spa_meta_header *) spa_buffer_find_meta_data(spa_buffer, SPA_META_Header, sizeof(spa_meta_header))) {
+        header->flags = 0;
+        header->pts = m_frameTimestamp.count();
+        header->dts_offset = 0;
+        header->seq = m_frameSequence++;
+    }
+
     if (spa_meta *vdMeta = spa_buffer_find_meta(spa_buffer, SPA_META_VideoDamage)) {
         struct spa_meta_region *r = (spa_meta_region *) spa_meta_first(vdMeta);
 
         // If there's too many rectangles, we just send the bounding rect
-        if (damagedRegion.rectCount() > videoDamageRegionCount - 1) {
+        if (damage.rectCount() > videoDamageRegionCount - 1) {
             if (spa_meta_check(r, vdMeta)) {
-                auto rect = damagedRegion.boundingRect();
+                auto rect = damage.boundingRect();
                 r->region = SPA_REGION(rect.x(), rect.y(), quint32(rect.width()), quint32(rect.height()));
                 r++;
             }
         } else {
-            for (const QRect &rect : damagedRegion) {
+            for (const QRect &rect : damage) {
                 if (spa_meta_check(r, vdMeta)) {
                     r->region = SPA_REGION(rect.x(), rect.y(), quint32(rect.width()), quint32(rect.height()));
                     r++;
@@ -457,6 +593,10 @@ void ScreenCastStream::recordFrame(const QRegion &damagedRegion)
     }
 
     tryEnqueue(buffer);
+
+    if (m_minFramerate) {
+        m_keepaliveTimer.start();
+    }
 }
 
 void ScreenCastStream::recordCursor()
@@ -487,8 +627,15 @@ void ScreenCastStream::recordCursor()
     spa_buffer->datas[0].chunk->size = 0;
     sendCursorData(Cursors::self()->currentCursor(),
                    (spa_meta_cursor *) spa_buffer_find_meta_data (spa_buffer, SPA_META_Cursor, sizeof (spa_meta_cursor)));
+    if (spa_meta *vdMeta = spa_buffer_find_meta(spa_buffer, SPA_META_VideoDamage)) {
+        auto r = (spa_meta_region *) spa_meta_first(vdMeta);
+        if (spa_meta_check(r, vdMeta)) {
+            r->region = SPA_REGION(0, 0, 0, 0);
+        }
+    }
 
-    tryEnqueue(buffer);
+    // The GPU has not been involved, so there is nothing to wait for
+    pw_stream_queue_buffer(pwStream, buffer);
 }
 
 void ScreenCastStream::tryEnqueue(pw_buffer *buffer)
@@ -519,10 +666,81 @@ void ScreenCastStream::tryEnqueue(pw_buffer *buffer)
     }
 }
 
+/**
+ * Starts downloading the frame into a pixel buffer object, the @p damage of the frame is copied
+ * into @p dest by finishReadback() once the fence inserted by tryEnqueue() is signaled.
+ *
+ * Returns @c false if the frame has to be read back synchronously.
+ */
+bool ScreenCastStream::startReadback(const QImage &dest, const QRegion &damage)
+{
+    if (!kwinApp()->platform()->supportsNativeFence() || !hasGLVersion(3, 0)) {
+        return false;
+    }
+
+    if (!m_readback.buffer) {
+        glGenBuffers(1, &m_readback.buffer);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_readback.buffer);
+    if (m_readback.bufferSize != dest.sizeInBytes()) {
+        m_readback.bufferSize = dest.sizeInBytes();
+        glBufferData(GL_PIXEL_PACK_BUFFER, m_readback.bufferSize, nullptr, GL_STREAM_READ);
+    }
+    if (m_streamScale != 1) {
+        m_readback.mirror = downloadTexture(renderScaled(), m_resolution, dest.hasAlphaChannel(), m_readback.bufferSize, nullptr);
+    } else {
+        m_readback.mirror = m_source->download(dest.hasAlphaChannel(), m_readback.bufferSize);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    if (m_background.size() != dest.size() || m_background.format() != dest.format()) {
+        m_background = QImage(dest.size(), dest.format());
+        m_backgroundDamage = QRect(QPoint(), dest.size());
+    }
+
+    m_readback.dest = dest;
+    m_readback.damage = damage;
+    m_readback.backgroundDamage = std::exchange(m_backgroundDamage, QRegion());
+    m_readback.pending = true;
+    return true;
+}
+
+void ScreenCastStream::finishReadback()
+{
+    m_readback.pending = false;
+    QImage dest = m_readback.dest;
+    m_readback.dest = QImage();
+    const QRegion damage = std::exchange(m_readback.damage, QRegion());
+    const QRegion backgroundDamage = std::exchange(m_readback.backgroundDamage, QRegion());
+
+    Compositor::self()->scene()->makeOpenGLContextCurrent();
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_readback.buffer);
+    const auto pixels = static_cast<const uchar *>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, m_readback.bufferSize, GL_MAP_READ_BIT));
+    if (pixels) {
+        copyRegion(pixels, dest.bytesPerLine(), m_readback.mirror, backgroundDamage, &m_background);
+        copyRegion(pixels, dest.bytesPerLine(), m_readback.mirror, damage, &dest);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    } else {
+        qCWarning(KWIN_SCREENCAST) << "Failed to map the screencast readback buffer";
+        m_background = QImage();
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    if (!m_readback.cursorImage.isNull()) {
+        QPainter painter(&dest);
+        painter.drawImage(m_readback.cursorRect, m_readback.cursorImage);
+        m_readback.cursorImage = QImage();
+    }
+}
+
 void ScreenCastStream::enqueue()
 {
     Q_ASSERT_X(m_pendingBuffer, "enqueue", "pending buffer must be valid");
 
+    if (m_readback.pending) {
+        finishReadback();
+    }
+
     delete m_pendingFence;
     delete m_pendingNotifier;
 
@@ -591,7 +809,7 @@ QRect ScreenCastStream::cursorGeometry(Cursor *cursor) const
     }
 
     const auto position = (cursor->pos() - m_cursor.viewport.topLeft() - cursor->hotspot()) * m_cursor.scale;
-    return QRect{position, m_cursor.texture->size()};
+    return QRect{position, m_cursor.texture->size() * m_streamScale};
 }
 
 void ScreenCastStream::sendCursorData(Cursor *cursor, spa_meta_cursor *spa_meta_cursor)
@@ -638,10 +856,83 @@ void ScreenCastStream::sendCursorData(Cursor *cursor, spa_meta_cursor *spa_meta_
     spa_meta_bitmap->stride = dest.bytesPerLine();
 }
 
+/**
+ * Returns @c true if enough time has passed since the last frame to honor the maximum
+ * framerate of the stream, otherwise a frame is scheduled for when the interval is over.
+ */
+bool ScreenCastStream::paceFrame()
+{
+    std::chrono::nanoseconds timestamp(std::chrono::steady_clock::now().time_since_epoch());
+    if (m_renderLoop) {
+        // The frame is going to be presented with the next vblank, the vblanks of the output
+        // are what the frame intervals should line up with
+        timestamp = std::max(timestamp, m_renderLoop->nextPresentationTimestamp());
+    }
+    m_frameTimestamp = timestamp;
+
+    if (!videoFormat.max_framerate.num || !videoFormat.max_framerate.denom) {
+        return true;
+    }
+
+    const std::chrono::nanoseconds interval(1'000'000'000LL * videoFormat.max_framerate.denom / videoFormat.max_framerate.num);
+    std::chrono::nanoseconds tolerance = interval / 10;
+    if (m_renderLoop && m_renderLoop->refreshRate() > 0) {
+        tolerance = std::chrono::nanoseconds(1'000'000'000'000LL / m_renderLoop->refreshRate()) / 2;
+    }
+
+    const std::chrono::nanoseconds elapsed = timestamp - m_lastFrameTimestamp;
+    if (elapsed + tolerance < interval) {
+        if (!m_pacingTimer.isActive()) {
+            m_pacingTimer.start(std::chrono::duration_cast<std::chrono::milliseconds>(interval - elapsed));
+        }
+        return false;
+    }
+
+    m_pacingTimer.stop();
+    // Keep the frames on the interval grid unless the stream has been idle
+    m_lastFrameTimestamp = elapsed < 2 * interval ? m_lastFrameTimestamp + interval : timestamp;
+    return true;
+}
+
+QSize ScreenCastStream::streamSize(const QSize &sourceSize) const
+{
+    if (!m_maxHeight || sourceSize.height() <= m_maxHeight) {
+        return sourceSize;
+    }
+    return sourceSize.scaled(sourceSize.width(), m_maxHeight, Qt::KeepAspectRatio);
+}
+
+void ScreenCastStream::updateStreamScale()
+{
+    const QSize sourceSize = m_source->textureSize();
+    m_streamScale = sourceSize.height() > 0 ? qreal(m_resolution.height()) / sourceSize.height() : 1;
+    m_cursor.scale = m_cursor.outputScale * m_streamScale;
+}
+
+/**
+ * Renders the source into a texture of the stream size, the GPU takes care of the scaling.
+ */
+GLTexture *ScreenCastStream::renderScaled()
+{
+    if (!m_scaledTexture || m_scaledTexture->size() != m_resolution) {
+        m_scaledTarget.reset();
+        m_scaledTexture.reset(new GLTexture(m_source->hasAlphaChannel() ? GL_RGBA8 : GL_RGB8, m_resolution));
+        m_scaledTarget.reset(new GLRenderTarget(*m_scaledTexture));
+    }
+    m_source->render(m_scaledTarget.data());
+    return m_scaledTexture.data();
+}
+
+void ScreenCastStream::setRenderLoop(RenderLoop *renderLoop)
+{
+    m_renderLoop = renderLoop;
+}
+
 void ScreenCastStream::setCursorMode(KWaylandServer::ScreencastV1Interface::CursorMode mode, qreal scale, const QRect &viewport)
 {
     m_cursor.mode = mode;
-    m_cursor.scale = scale;
+    m_cursor.outputScale = scale;
+    m_cursor.scale = scale * m_streamScale;
     m_cursor.viewport = viewport;
 }
 
@@ -14,24 +14,32 @@
 #include <KWaylandServer/screencast_v1_interface.h>
 
 #include <QHash>
+#include <QImage>
 #include <QObject>
+#include <QPointer>
+#include <QRegion>
 #include <QSharedPointer>
 #include <QSize>
 #include <QSocketNotifier>
+#include <QTimer>
 
 #include <pipewire/pipewire.h>
 #include <spa/param/format-utils.h>
 #include <spa/param/props.h>
 #include <spa/param/video/format-utils.h>
 
+#include <chrono>
+
 namespace KWin
 {
 
 class Cursor;
 class DmaBufTexture;
 class EGLNativeFence;
+class GLRenderTarget;
 class GLTexture;
 class PipeWireCore;
+class RenderLoop;
 class ScreenCastSource;
 
 class KWIN_EXPORT ScreenCastStream : public QObject
@@ -55,6 +63,13 @@ public:
 
     void setCursorMode(KWaylandServer::ScreencastV1Interface::CursorMode mode, qreal scale, const QRect &viewport);
 
+    /**
+     * Sets the render loop whose presentation timestamps are used to pace the frames,
+     * so that the negotiated maximum framerate is honored without drifting against the
+     * refresh rate of the output.
+     */
+    void setRenderLoop(RenderLoop *renderLoop);
+
 public Q_SLOTS:
      void recordCursor();
 
@@ -74,8 +89,15 @@ private:
     void coreFailed(const QString &errorMessage);
     void sendCursorData(Cursor *cursor, spa_meta_cursor *spa_cursor);
     void newStreamParams();
+    void recordFrame(const QRegion &damagedRegion, bool sourceDamaged);
     void tryEnqueue(pw_buffer *buffer);
     void enqueue();
+    bool startReadback(const QImage &dest, const QRegion &damage);
+    QSize streamSize(const QSize &sourceSize) const;
+    void updateStreamScale();
+    GLTexture *renderScaled();
+    bool paceFrame();
+    void finishReadback();
     spa_pod* buildFormat(struct spa_pod_builder *b, enum spa_video_format format, struct spa_rectangle *resolution,
                          struct spa_fraction *defaultFramerate, struct spa_fraction *minFramerate, struct spa_fraction *maxFramerate,
                          uint64_t *modifiers, int modifier_count);
@@ -91,6 +113,12 @@ private:
     QSize m_resolution;
     bool m_stopped = false;
 
+    // Sources taller than m_maxHeight are scaled down on the GPU before they are streamed
+    int m_maxHeight = 0;
+    qreal m_streamScale = 1;
+    QScopedPointer<GLTexture> m_scaledTexture;
+    QScopedPointer<GLRenderTarget> m_scaledTarget;
+
     spa_video_info_raw videoFormat;
     bool m_hasModifier = false;
     QString m_error;
@@ -98,6 +126,7 @@ private:
     struct {
         KWaylandServer::ScreencastV1Interface::CursorMode mode = KWaylandServer::ScreencastV1Interface::Hidden;
         const QSize bitmapSize = QSize(256, 256);
+        qreal outputScale = 1;
         qreal scale = 1;
         QRect viewport;
         qint64 lastKey = 0;
@@ -108,9 +137,53 @@ private:
 
     QHash<struct pw_buffer *, QSharedPointer<DmaBufTexture>> m_dmabufDataForPwBuffer;
 
+    // PipeWire buffers rotate, so every buffer has to keep track of what changed since it
+    // was filled the last time
+    struct BufferContent {
+        QRegion damage;
+        QRect cursorRect;
+    };
+    QHash<struct pw_buffer *, BufferContent> m_bufferContents;
+
+    // Frames that come in faster than the negotiated framerate are skipped, their damage is
+    // sent along with the next frame
+    QPointer<RenderLoop> m_renderLoop;
+    std::chrono::nanoseconds m_lastFrameTimestamp = std::chrono::nanoseconds::zero();
+    QRegion m_skippedDamage;
+    QTimer m_pacingTimer;
+    uint m_maxFramerate = 25;
+
+    // Frames carry their presentation timestamp and a sequence number, so that consumers
+    // can tell frames that were skipped apart from frames that did not change
+    std::chrono::nanoseconds m_frameTimestamp = std::chrono::nanoseconds::zero();
+    quint64 m_frameSequence = 0;
+
+    // Re-sends the last frame if nothing has been damaged for a while
+    QTimer m_keepaliveTimer;
+    uint m_minFramerate = 1;
+
     pw_buffer *m_pendingBuffer = nullptr;
     QSocketNotifier *m_pendingNotifier = nullptr;
     EGLNativeFence *m_pendingFence = nullptr;
+
+    // Memory buffers are filled from a pixel buffer object once the GPU is done with the
+    // download, so that the compositor does not have to wait for it
+    struct {
+        uint buffer = 0;
+        qsizetype bufferSize = 0;
+        bool pending = false;
+        QImage dest;
+        QRegion damage;
+        QRegion backgroundDamage;
+        bool mirror = false;
+        QImage cursorImage;
+        QRect cursorRect;
+    } m_readback;
+
+    // The last frame without the embedded cursor, memory buffers are restored from it when
+    // only the cursor has moved. m_backgroundDamage is what changed since it was read back.
+    QImage m_background;
+    QRegion m_backgroundDamage;
 };
 
 } // namespace KWin
@@ -25,9 +25,21 @@ static void mirrorVertically(uchar *data, int height, int stride)
     }
 }
 
-static void grabTexture(GLTexture *texture, QImage *image)
+// Scales @p region, rounding outwards so no partially covered pixel is lost
+static QRegion scaleRegion(const QRegion &region, qreal scale)
+{
+    QRegion scaled;
+    for (const QRect &rect : region) {
+        scaled += QRectF(QPointF(rect.topLeft()) * scale, QSizeF(rect.size()) * scale).toAlignedRect();
+    }
+    return scaled;
+}
+
+// Reads @p texture into @p pixels, or into the pixel pack buffer at offset @p pixels if one is
+// bound. Returns whether the rows still have to be mirrored vertically afterwards.
+static bool downloadTexture(GLTexture *texture, const QSize &size, bool hasAlpha, qsizetype bufferSize, GLvoid *pixels)
 {
-    Q_ASSERT(texture->size() == image->size());
+    Q_ASSERT(texture->size() == size);
     const bool invertNeededAndSupported = texture->isYInverted() && GLPlatform::instance()->supports(PackInvert);
     GLboolean prev;
     if (invertNeededAndSupported) {
@@ -37,18 +49,25 @@ static void grabTexture(GLTexture *texture, QImage *image)
 
     texture->bind();
     if (GLPlatform::instance()->isGLES()) {
-        glReadPixels(0, 0, image->width(), image->height(), image->hasAlphaChannel() ? GL_BGRA : GL_BGR, GL_UNSIGNED_BYTE, (GLvoid*)image->bits());
+        glReadPixels(0, 0, size.width(), size.height(), hasAlpha ? GL_BGRA : GL_BGR, GL_UNSIGNED_BYTE, pixels);
     } else if (GLPlatform::instance()->glVersion() >= kVersionNumber(4, 5)) {
-        glGetTextureImage(texture->texture(), 0, image->hasAlphaChannel() ? GL_BGRA : GL_BGR, GL_UNSIGNED_BYTE, image->sizeInBytes(), image->bits());
+        glGetTextureImage(texture->texture(), 0, hasAlpha ? GL_BGRA : GL_BGR, GL_UNSIGNED_BYTE, bufferSize, pixels);
     } else {
-        glGetTexImage(texture->target(), 0, image->hasAlphaChannel() ? GL_BGRA : GL_BGR, GL_UNSIGNED_BYTE, image->bits());
+        glGetTexImage(texture->target(), 0, hasAlpha ? GL_BGRA : GL_BGR, GL_UNSIGNED_BYTE, pixels);
     }
 
     if (invertNeededAndSupported) {
         if (!prev) {
             glPixelStorei(GL_PACK_INVERT_MESA, prev);
         }
-    } else if (texture->isYInverted()) {
+        return false;
+    }
+    return texture->isYInverted();
+}
+
+static void grabTexture(GLTexture *texture, QImage *image)
+{
+    if (downloadTexture(texture, image->size(), image->hasAlphaChannel(), image->sizeInBytes(), image->bits())) {
         mirrorVertically(image->bits(), image->height(), image->bytesPerLine());
     }
 }
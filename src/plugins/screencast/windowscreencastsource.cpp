@@ -18,9 +18,10 @@
 namespace KWin
 {
 
-WindowScreenCastSource::WindowScreenCastSource(Toplevel *window, QObject *parent)
+WindowScreenCastSource::WindowScreenCastSource(Toplevel *window, bool includeEffects, QObject *parent)
     : ScreenCastSource(parent)
     , m_window(window)
+    , m_includeEffects(includeEffects)
 {
     connect(m_window, &Toplevel::windowClosed, this, &ScreenCastSource::closed);
 }
@@ -44,6 +45,16 @@ void WindowScreenCastSource::render(QImage *image)
     grabTexture(&offscreenTexture, image);
 }
 
+bool WindowScreenCastSource::download(bool hasAlpha, qsizetype bufferSize)
+{
+    // The texture is only released by the driver once the download is done
+    GLTexture offscreenTexture(hasAlphaChannel() ? GL_RGBA8 : GL_RGB8, textureSize());
+    GLRenderTarget offscreenTarget(offscreenTexture);
+
+    render(&offscreenTarget);
+    return downloadTexture(&offscreenTexture, textureSize(), hasAlpha, bufferSize, nullptr);
+}
+
 void WindowScreenCastSource::render(GLRenderTarget *target)
 {
     const QRect geometry = m_window->clientGeometry();
@@ -58,7 +69,12 @@ void WindowScreenCastSource::render(GLRenderTarget *target)
     GLRenderTarget::pushRenderTarget(target);
     glClearColor(0.0, 0.0, 0.0, 0.0);
     glClear(GL_COLOR_BUFFER_BIT);
-    effectWindow->sceneWindow()->performPaint(Scene::PAINT_WINDOW_TRANSFORMED, infiniteRegion(), data);
+    if (m_includeEffects) {
+        effects->drawWindow(effectWindow, Scene::PAINT_WINDOW_TRANSFORMED, infiniteRegion(), data);
+    } else {
+        // paint the surface items straight away, without going through the effect chain
+        effectWindow->sceneWindow()->performPaint(Scene::PAINT_WINDOW_TRANSFORMED, infiniteRegion(), data);
+    }
     GLRenderTarget::popRenderTarget();
 }
 
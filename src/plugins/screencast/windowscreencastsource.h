@@ -20,16 +20,22 @@ class WindowScreenCastSource : public ScreenCastSource
     Q_OBJECT
 
 public:
-    explicit WindowScreenCastSource(Toplevel *window, QObject *parent = nullptr);
+    /**
+     * By default only the contents of the @p window are streamed, with @p includeEffects
+     * the window is painted the way the active effects paint it, e.g. while it is animated.
+     */
+    explicit WindowScreenCastSource(Toplevel *window, bool includeEffects = false, QObject *parent = nullptr);
 
     bool hasAlphaChannel() const override;
     QSize textureSize() const override;
 
     void render(GLRenderTarget *target) override;
     void render(QImage *image) override;
+    bool download(bool hasAlpha, qsizetype bufferSize) override;
 
 private:
     QPointer<Toplevel> m_window;
+    bool m_includeEffects;
 };
 
 } // namespace KWin
@@ -16,6 +16,7 @@
 #include "input_event.h"
 #include "input_event_spy.h"
 #include "osd.h"
+#include "renderloop.h"
 #include "screens.h"
 #include "wayland_server.h"
 #include "workspace.h"
@@ -274,8 +275,25 @@ void PointerInputRedirection::processMotionInternal(const QPointF &pos, const QS
     event.setModifiersRelevantForGlobalShortcuts(input()->modifiersRelevantForGlobalShortcuts());
 
     update();
+    addLatencyToken(timeUsec);
     input()->processSpies(std::bind(&InputEventSpy::pointerEvent, std::placeholders::_1, &event));
-    input()->processFilters(std::bind(&InputEventFilter::pointerEvent, std::placeholders::_1, &event, 0));
+    input()->processPointerMotionFilters(std::bind(&InputEventFilter::pointerEvent, std::placeholders::_1, &event, 0));
+}
+
+void PointerInputRedirection::addLatencyToken(quint64 timeUsec)
+{
+    if (!timeUsec) {
+        return;
+    }
+    // The moved software cursor is painted in the next frame of the output. The latency
+    // of hardware cursors isn't measured, they are moved without presenting a frame.
+    const std::chrono::microseconds timestamp(timeUsec);
+    const auto outputs = kwinApp()->platform()->enabledOutputs();
+    for (AbstractOutput *output : outputs) {
+        if (output->usesSoftwareCursor() && output->geometry().contains(m_pos.toPoint())) {
+            output->renderLoop()->addInputEvent(timestamp);
+        }
+    }
 }
 
 void PointerInputRedirection::processButton(uint32_t button, InputRedirection::PointerButtonState state, uint32_t time, InputDevice *device)
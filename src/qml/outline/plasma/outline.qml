@@ -54,6 +54,13 @@ Window {
                 window.animationEnabled = true
             }
         }
+        // the window stays in place, e.g. when moving between quick tile zones of the
+        // same screen, so just animate the frame to its new destination
+        function onGeometryChanged() {
+            if (window.visible) {
+                svg.setGeometry(outline.geometry)
+            }
+        }
     }
 
     PlasmaCore.FrameSvgItem {
@@ -6,11 +6,16 @@
 
 #include "renderjournal.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace KWin
 {
 
 RenderJournal::RenderJournal()
 {
+    m_log.fill(std::chrono::nanoseconds::zero());
+    m_histogram.fill(0);
 }
 
 void RenderJournal::beginFrame()
@@ -20,37 +25,76 @@ void RenderJournal::beginFrame()
 
 void RenderJournal::endFrame()
 {
-    std::chrono::nanoseconds duration(m_timer.nsecsElapsed());
-    if (m_log.count() >= m_size) {
-        m_log.dequeue();
+    add(std::chrono::nanoseconds(m_timer.nsecsElapsed()));
+}
+
+int RenderJournal::bucketForDuration(std::chrono::nanoseconds duration)
+{
+    if (duration < std::chrono::nanoseconds::zero()) {
+        return 0;
+    }
+    // The last bucket collects every sample that doesn't fit in the regular buckets.
+    return std::min<int>(duration / s_bucketWidth, s_bucketCount);
+}
+
+void RenderJournal::add(std::chrono::nanoseconds renderTime)
+{
+    if (m_count == s_windowSize) {
+        const std::chrono::nanoseconds evicted = m_log[m_head];
+        m_histogram[bucketForDuration(evicted)]--;
+        m_sum -= evicted;
+    } else {
+        m_count++;
     }
-    m_log.enqueue(duration);
+
+    m_log[m_head] = renderTime;
+    m_histogram[bucketForDuration(renderTime)]++;
+    m_sum += renderTime;
+    m_head = (m_head + 1) % s_windowSize;
 }
 
 std::chrono::nanoseconds RenderJournal::minimum() const
 {
-    auto it = std::min_element(m_log.constBegin(), m_log.constEnd());
-    return it != m_log.constEnd() ? (*it) : std::chrono::nanoseconds::zero();
+    if (!m_count) {
+        return std::chrono::nanoseconds::zero();
+    }
+    return *std::min_element(m_log.cbegin(), m_log.cbegin() + m_count);
 }
 
 std::chrono::nanoseconds RenderJournal::maximum() const
 {
-    auto it = std::max_element(m_log.constBegin(), m_log.constEnd());
-    return it != m_log.constEnd() ? (*it) : std::chrono::nanoseconds::zero();
+    if (!m_count) {
+        return std::chrono::nanoseconds::zero();
+    }
+    return *std::max_element(m_log.cbegin(), m_log.cbegin() + m_count);
 }
 
 std::chrono::nanoseconds RenderJournal::average() const
 {
-    if (m_log.isEmpty()) {
+    if (!m_count) {
         return std::chrono::nanoseconds::zero();
     }
+    return m_sum / m_count;
+}
+
+std::chrono::nanoseconds RenderJournal::percentile(qreal fraction) const
+{
+    if (!m_count) {
+        return std::chrono::nanoseconds::zero();
+    }
+
+    const int rank = std::clamp(int(std::ceil(std::clamp(fraction, 0.0, 1.0) * m_count)), 1, m_count);
 
-    std::chrono::nanoseconds result = std::chrono::nanoseconds::zero();
-    for (const std::chrono::nanoseconds &entry : m_log) {
-        result += entry;
+    int accumulated = 0;
+    for (int i = 0; i < s_bucketCount; ++i) {
+        accumulated += m_histogram[i];
+        if (accumulated >= rank) {
+            return std::min((i + 1) * s_bucketWidth, maximum());
+        }
     }
 
-    return result / m_log.count();
+    // The requested percentile is in the overflow bucket, there is no upper bound for it.
+    return maximum();
 }
 
 } // namespace KWin
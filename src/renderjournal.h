@@ -9,7 +9,9 @@
 #include "kwinglobals.h"
 
 #include <QElapsedTimer>
-#include <QQueue>
+
+#include <array>
+#include <chrono>
 
 namespace KWin
 {
@@ -17,6 +19,10 @@ namespace KWin
 /**
  * The RenderJournal class measures how long it takes to render frames and estimates how
  * long it will take to render the next frame.
+ *
+ * The journal keeps a fixed-size window of the most recent render times along with a
+ * histogram of the same samples, so percentile queries don't allocate and a single slow
+ * frame doesn't dominate the estimate.
  */
 class KWIN_EXPORT RenderJournal
 {
@@ -33,6 +39,12 @@ public:
      */
     void endFrame();
 
+    /**
+     * Adds a render time sample to the journal. This is useful if the render time has
+     * been measured by other means than beginFrame() and endFrame().
+     */
+    void add(std::chrono::nanoseconds renderTime);
+
     /**
      * Returns the maximum estimated amount of time that it takes to render a single frame.
      */
@@ -48,10 +60,28 @@ public:
      */
     std::chrono::nanoseconds average() const;
 
+    /**
+     * Returns the estimated amount of time that it takes to render a single frame such
+     * that the given @a fraction of the recorded frames took at most that long. For
+     * example, a fraction of 0.9 returns the 90th percentile.
+     *
+     * The returned value is rounded up to the histogram bucket resolution.
+     */
+    std::chrono::nanoseconds percentile(qreal fraction) const;
+
 private:
+    static constexpr int s_windowSize = 64;
+    static constexpr int s_bucketCount = 256;
+    static constexpr std::chrono::nanoseconds s_bucketWidth = std::chrono::microseconds(100);
+
+    static int bucketForDuration(std::chrono::nanoseconds duration);
+
     QElapsedTimer m_timer;
-    QQueue<std::chrono::nanoseconds> m_log;
-    int m_size = 15;
+    std::array<std::chrono::nanoseconds, s_windowSize> m_log;
+    std::array<quint16, s_bucketCount + 1> m_histogram;
+    std::chrono::nanoseconds m_sum = std::chrono::nanoseconds::zero();
+    int m_head = 0;
+    int m_count = 0;
 };
 
 } // namespace KWin
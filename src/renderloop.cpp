@@ -5,11 +5,14 @@
 */
 
 #include "renderloop.h"
+#include "ftrace.h"
 #include "options.h"
 #include "renderloop_p.h"
 #include "surfaceitem.h"
 #include "utils/common.h"
 
+#include <algorithm>
+
 namespace KWin
 {
 
@@ -27,8 +30,7 @@ RenderLoopPrivate *RenderLoopPrivate::get(RenderLoop *loop)
 RenderLoopPrivate::RenderLoopPrivate(RenderLoop *q)
     : q(q)
 {
-    compositeTimer.setSingleShot(true);
-    QObject::connect(&compositeTimer, &QTimer::timeout, q, [this]() { dispatch(); });
+    QObject::connect(&compositeTimer, &PreciseTimer::timeout, q, [this]() { dispatch(); });
 }
 
 void RenderLoopPrivate::scheduleRepaint()
@@ -45,17 +47,18 @@ void RenderLoopPrivate::scheduleRepaint()
     const std::chrono::nanoseconds currentTime(std::chrono::steady_clock::now().time_since_epoch());
 
     // Estimate when the next presentation will occur. Note that this is a prediction.
-    nextPresentationTimestamp = lastPresentationTimestamp + vblankInterval;
+    // Frames that are still in flight are going to be presented first.
+    nextPresentationTimestamp = lastPresentationTimestamp + vblankInterval * (pendingFrameCount + 1);
     if (nextPresentationTimestamp < currentTime && presentMode == SyncMode::Fixed) {
         nextPresentationTimestamp = lastPresentationTimestamp
                 + alignTimestamp(currentTime - lastPresentationTimestamp, vblankInterval);
     }
 
     // Estimate when it's a good time to perform the next compositing cycle.
-    const std::chrono::nanoseconds safetyMargin = std::chrono::milliseconds(3);
+    configuredLatencyPolicy = options->latencyPolicy();
 
     std::chrono::nanoseconds renderTime;
-    switch (options->latencyPolicy()) {
+    switch (latencyPolicy()) {
     case LatencyExteremelyLow:
         renderTime = std::chrono::nanoseconds(long(vblankInterval.count() * 0.1));
         break;
@@ -69,6 +72,7 @@ void RenderLoopPrivate::scheduleRepaint()
         renderTime = std::chrono::nanoseconds(long(vblankInterval.count() * 0.75));
         break;
     case LatencyExtremelyHigh:
+    default:
         renderTime = std::chrono::nanoseconds(long(vblankInterval.count() * 0.9));
         break;
     }
@@ -83,17 +87,114 @@ void RenderLoopPrivate::scheduleRepaint()
     case RenderTimeEstimatorAverage:
         renderTime = std::max(renderTime, renderJournal.average());
         break;
+    case RenderTimeEstimatorPercentile:
+        renderTime = std::max(renderTime, renderJournal.percentile(0.9));
+        break;
     }
 
-    std::chrono::nanoseconds nextRenderTimestamp = nextPresentationTimestamp - renderTime - safetyMargin;
+    std::chrono::nanoseconds nextRenderTimestamp = nextPresentationTimestamp - renderTime - safetyMargin();
 
     // If we can't render the frame before the deadline, start compositing immediately.
     if (nextRenderTimestamp < currentTime) {
         nextRenderTimestamp = currentTime;
     }
 
-    const std::chrono::nanoseconds waitInterval = nextRenderTimestamp - currentTime;
-    compositeTimer.start(std::chrono::duration_cast<std::chrono::milliseconds>(waitInterval));
+    compositeTimer.start(nextRenderTimestamp);
+}
+
+LatencyPolicy RenderLoopPrivate::latencyPolicy() const
+{
+    if (configuredLatencyPolicy == LatencyAdaptive) {
+        return adaptiveLatencyPolicy;
+    }
+    return configuredLatencyPolicy;
+}
+
+std::chrono::nanoseconds RenderLoopPrivate::safetyMargin() const
+{
+    if (configuredLatencyPolicy == LatencyAdaptive) {
+        return adaptiveSafetyMargin;
+    }
+    return std::chrono::milliseconds(3);
+}
+
+void RenderLoopPrivate::updateAdaptiveLatency(std::chrono::nanoseconds timestamp)
+{
+    // Deadlines are meaningless if the output refreshes whenever a frame is ready.
+    if (configuredLatencyPolicy != LatencyAdaptive || presentMode == SyncMode::Adaptive) {
+        return;
+    }
+
+    static const std::chrono::nanoseconds minimumSafetyMargin = std::chrono::microseconds(500);
+    static const std::chrono::nanoseconds maximumSafetyMargin = std::chrono::milliseconds(4);
+    static const std::chrono::nanoseconds safetyMarginStep = std::chrono::microseconds(500);
+
+    const std::chrono::nanoseconds vblankInterval(1'000'000'000'000ull / refreshRate);
+
+    // The frame is considered to be missed if it has been presented at a later vblank
+    // than the one it has been scheduled for.
+    if (timestamp > nextPresentationTimestamp + vblankInterval / 2) {
+        missedFrameCount++;
+        adaptiveHitCount = 0;
+        adaptiveSafetyMargin = std::min(adaptiveSafetyMargin + safetyMarginStep, maximumSafetyMargin);
+        if (adaptiveLatencyPolicy < LatencyExtremelyHigh) {
+            adaptiveLatencyPolicy = LatencyPolicy(adaptiveLatencyPolicy + 1);
+        }
+        return;
+    }
+
+    // Lower the latency step by step after two seconds without missed frames, giving up
+    // the safety margin first and only then the render time budget.
+    if (++adaptiveHitCount < 2 * refreshRate / 1000) {
+        return;
+    }
+    adaptiveHitCount = 0;
+    if (adaptiveSafetyMargin > minimumSafetyMargin) {
+        adaptiveSafetyMargin = std::max(adaptiveSafetyMargin - safetyMarginStep, minimumSafetyMargin);
+    } else if (adaptiveLatencyPolicy > LatencyExteremelyLow) {
+        adaptiveLatencyPolicy = LatencyPolicy(adaptiveLatencyPolicy - 1);
+    }
+}
+
+void RenderLoopPrivate::updateRenderQuality(std::chrono::nanoseconds timestamp)
+{
+    const std::chrono::nanoseconds vblankInterval(1'000'000'000'000ull / refreshRate);
+    const std::chrono::nanoseconds budget = vblankInterval - safetyMargin();
+    const std::chrono::nanoseconds renderTime = renderJournal.percentile(0.9);
+
+    const bool missed = presentMode == SyncMode::Fixed && timestamp > nextPresentationTimestamp + vblankInterval / 2;
+    const int framesPerSecond = std::max(1, refreshRate / 1000);
+
+    // Lower the quality once a quarter of a second worth of frames has exceeded the budget,
+    // the journal needs about as many frames to reflect the new quality.
+    if (missed || renderTime > budget) {
+        qualityHitCount = 0;
+        if (++qualityMissCount < std::max(1, framesPerSecond / 4)) {
+            return;
+        }
+        qualityMissCount = 0;
+        if (renderQuality != RenderLoop::RenderQuality::Low) {
+            renderQuality = RenderLoop::RenderQuality(int(renderQuality) + 1);
+            Q_EMIT q->renderQualityChanged();
+        }
+        return;
+    }
+
+    // Only consecutive frames over budget lower the quality.
+    qualityMissCount = 0;
+
+    // Raise the quality again after two seconds with plenty of headroom, so the quality
+    // doesn't flip back and forth if the higher quality barely fits in the budget.
+    if (renderQuality == RenderLoop::RenderQuality::High || renderTime > budget / 2) {
+        qualityHitCount = 0;
+        return;
+    }
+    if (++qualityHitCount < 2 * framesPerSecond) {
+        return;
+    }
+    qualityHitCount = 0;
+    renderQuality = RenderLoop::RenderQuality(int(renderQuality) - 1);
+    Q_EMIT q->renderQualityChanged();
 }
 
 void RenderLoopPrivate::delayScheduleRepaint()
@@ -101,6 +202,29 @@ void RenderLoopPrivate::delayScheduleRepaint()
     pendingReschedule = true;
 }
 
+void RenderLoopPrivate::queueScheduleRepaint()
+{
+    if (compositeTimer.isActive()) {
+        return;
+    }
+
+    // Damage usually arrives in bursts, e.g. when many windows are rearranged at once, so
+    // the next frame is scheduled only once when control returns to the event loop.
+    pendingReschedule = true;
+    if (rescheduleQueued) {
+        return;
+    }
+    rescheduleQueued = true;
+    QMetaObject::invokeMethod(q, [this]() {
+        rescheduleQueued = false;
+        // If a frame has been started in the meantime, the repaint will be scheduled
+        // when the frame is presented or the render loop is uninhibited.
+        if (pendingFrameCount < maxPendingFrameCount && !inhibitCount) {
+            maybeScheduleRepaint();
+        }
+    }, Qt::QueuedConnection);
+}
+
 void RenderLoopPrivate::maybeScheduleRepaint()
 {
     if (pendingReschedule) {
@@ -109,11 +233,57 @@ void RenderLoopPrivate::maybeScheduleRepaint()
     }
 }
 
+static std::chrono::nanoseconds currentTimestamp()
+{
+    return std::chrono::steady_clock::now().time_since_epoch();
+}
+
+void RenderLoopPrivate::commitFrameTimings()
+{
+    pendingFrameTimings.sequence = ++frameSequence;
+
+    // An input event that hasn't made it into a frame for this long hasn't caused the
+    // repaint, e.g. because the cursor has been moved outside of the output.
+    if (pendingInputTimestamp != std::chrono::nanoseconds::zero()
+            && currentTimestamp() - pendingInputTimestamp < std::chrono::milliseconds(250)) {
+        pendingFrameTimings.inputTimestamp = pendingInputTimestamp;
+    }
+    pendingInputTimestamp = std::chrono::nanoseconds::zero();
+
+    frameLog[frameLogHead] = pendingFrameTimings;
+    frameLogHead = (frameLogHead + 1) % frameLogSize;
+    frameLogCount = std::min(frameLogCount + 1, frameLogSize);
+    frameTimingsCommitted = true;
+}
+
+void RenderLoopPrivate::addInputLatency(std::chrono::nanoseconds latency)
+{
+    const int bucket = std::chrono::duration_cast<std::chrono::milliseconds>(latency).count();
+    inputLatency.histogram[std::min(bucket, RenderLoop::InputLatency::BucketCount - 1)]++;
+
+    if (!inputLatency.count) {
+        inputLatency.minimum = latency;
+        inputLatency.maximum = latency;
+        inputLatency.smoothed = latency;
+    } else {
+        inputLatency.minimum = std::min(inputLatency.minimum, latency);
+        inputLatency.maximum = std::max(inputLatency.maximum, latency);
+        inputLatency.smoothed += (latency - inputLatency.smoothed) / 16;
+    }
+    inputLatency.count++;
+    inputLatency.total += latency;
+    inputLatency.last = latency;
+
+    fTraceCounter("Input latency (us)", std::chrono::duration_cast<std::chrono::microseconds>(latency).count());
+}
+
 void RenderLoopPrivate::notifyFrameFailed()
 {
     Q_ASSERT(pendingFrameCount > 0);
     pendingFrameCount--;
 
+    Q_EMIT q->frameFailed(q);
+
     if (!inhibitCount) {
         maybeScheduleRepaint();
     }
@@ -122,8 +292,28 @@ void RenderLoopPrivate::notifyFrameFailed()
 void RenderLoopPrivate::notifyFrameCompleted(std::chrono::nanoseconds timestamp)
 {
     Q_ASSERT(pendingFrameCount > 0);
+
+    // The presented frame is the oldest one that is still in flight.
+    if (pendingFrameCount <= frameLogCount) {
+        const int index = (frameLogHead - pendingFrameCount + frameLogSize) % frameLogSize;
+        // The presentation timestamp comes from the same monotonic clock as the other stages,
+        // and unlike the time at which the event is handled, it isn't delayed by the event loop.
+        frameLog[index].timestamps[int(RenderLoop::FrameStage::PageFlipped)] = timestamp;
+
+        const std::chrono::nanoseconds inputTimestamp = frameLog[index].inputTimestamp;
+        if (inputTimestamp != std::chrono::nanoseconds::zero() && timestamp > inputTimestamp) {
+            addInputLatency(timestamp - inputTimestamp);
+        }
+    }
+
     pendingFrameCount--;
 
+    fTraceInstant("Frame presented");
+    fTraceCounter("Pending frames", pendingFrameCount);
+
+    updateAdaptiveLatency(timestamp);
+    updateRenderQuality(timestamp);
+
     if (lastPresentationTimestamp <= timestamp) {
         lastPresentationTimestamp = timestamp;
     } else {
@@ -154,6 +344,17 @@ void RenderLoopPrivate::dispatch()
     pendingRepaint = false;
 }
 
+bool RenderLoopPrivate::isDispatchDue(std::chrono::nanoseconds currentTime) const
+{
+    return compositeTimer.isActive() && compositeTimer.deadline() <= currentTime;
+}
+
+void RenderLoopPrivate::dispatchNow()
+{
+    compositeTimer.stop();
+    dispatch();
+}
+
 void RenderLoopPrivate::invalidate()
 {
     pendingReschedule = false;
@@ -193,13 +394,108 @@ void RenderLoop::uninhibit()
 void RenderLoop::beginFrame()
 {
     d->pendingRepaint = false;
+    d->forcedRepaint = false;
     d->pendingFrameCount++;
     d->renderJournal.beginFrame();
+    d->commitFrameTimings();
+
+    // The frame may end after other slices have begun, e.g. when waiting for a render time query.
+    FTraceLogger *logger = FTraceLogger::self();
+    if (logger && logger->isRecording()) {
+        logger->beginAsyncSlice("Frame", quintptr(this));
+        logger->counter("Pending frames", d->pendingFrameCount);
+    }
 }
 
 void RenderLoop::endFrame()
 {
+    FTraceLogger *logger = FTraceLogger::self();
+    if (logger && logger->isRecording()) {
+        logger->endAsyncSlice("Frame", quintptr(this));
+    }
+
     d->renderJournal.endFrame();
+
+    // If the platform allows more than one frame in flight, the next frame can be
+    // started before the previous one has been presented.
+    if (d->pendingFrameCount < d->maxPendingFrameCount && !d->inhibitCount) {
+        d->maybeScheduleRepaint();
+    }
+}
+
+quint64 RenderLoop::frameSequence() const
+{
+    return d->frameSequence;
+}
+
+void RenderLoop::addRenderTime(std::chrono::nanoseconds renderTime, quint64 sequence)
+{
+    d->renderJournal.add(renderTime);
+
+    // The frame log is ordered by sequence number, the newest frame is the last one.
+    if (sequence == 0 || sequence > d->frameSequence) {
+        return;
+    }
+    const quint64 age = d->frameSequence - sequence + 1;
+    if (age > quint64(d->frameLogCount)) {
+        return;
+    }
+    const int index = (d->frameLogHead - int(age) + RenderLoopPrivate::frameLogSize) % RenderLoopPrivate::frameLogSize;
+    Q_ASSERT(d->frameLog[index].sequence == sequence);
+    d->frameLog[index].renderTime = renderTime;
+}
+
+void RenderLoop::addInputEvent(std::chrono::microseconds timestamp)
+{
+    // Keep the oldest event, its result is shown in the same frame as all later events.
+    if (d->pendingInputTimestamp == std::chrono::nanoseconds::zero()) {
+        d->pendingInputTimestamp = timestamp;
+    }
+}
+
+RenderLoop::InputLatency RenderLoop::inputLatency() const
+{
+    return d->inputLatency;
+}
+
+void RenderLoop::resetInputLatency()
+{
+    d->inputLatency = InputLatency();
+}
+
+void RenderLoop::recordFrameStage(FrameStage stage)
+{
+    const std::chrono::nanoseconds timestamp = currentTimestamp();
+
+    if (stage == FrameStage::Started) {
+        d->pendingFrameTimings = FrameTimings();
+        d->frameTimingsCommitted = false;
+    }
+
+    if (d->frameTimingsCommitted) {
+        const int index = (d->frameLogHead - 1 + RenderLoopPrivate::frameLogSize) % RenderLoopPrivate::frameLogSize;
+        d->frameLog[index].timestamps[int(stage)] = timestamp;
+    } else {
+        d->pendingFrameTimings.timestamps[int(stage)] = timestamp;
+    }
+}
+
+QVector<RenderLoop::FrameTimings> RenderLoop::frameTimings(int count) const
+{
+    count = std::clamp(count, 0, d->frameLogCount);
+
+    QVector<FrameTimings> timings;
+    timings.reserve(count);
+    for (int i = count; i > 0; --i) {
+        const int index = (d->frameLogHead - i + RenderLoopPrivate::frameLogSize) % RenderLoopPrivate::frameLogSize;
+        timings.append(d->frameLog[index]);
+    }
+    return timings;
+}
+
+RenderLoop::RenderQuality RenderLoop::renderQuality() const
+{
+    return d->renderQuality;
 }
 
 int RenderLoop::refreshRate() const
@@ -221,13 +517,21 @@ void RenderLoop::scheduleRepaint(Item *item)
     if (d->pendingRepaint || (d->fullscreenItem != nullptr && item != nullptr && item != d->fullscreenItem)) {
         return;
     }
-    if (!d->pendingFrameCount && !d->inhibitCount) {
-        d->scheduleRepaint();
+    if (!item) {
+        d->forcedRepaint = true;
+    }
+    if (d->pendingFrameCount < d->maxPendingFrameCount && !d->inhibitCount) {
+        d->queueScheduleRepaint();
     } else {
         d->delayScheduleRepaint();
     }
 }
 
+bool RenderLoop::isRepaintForced() const
+{
+    return d->forcedRepaint;
+}
+
 std::chrono::nanoseconds RenderLoop::lastPresentationTimestamp() const
 {
     return d->lastPresentationTimestamp;
@@ -9,6 +9,10 @@
 #include "kwinglobals.h"
 
 #include <QObject>
+#include <QVector>
+
+#include <array>
+#include <chrono>
 
 namespace KWin
 {
@@ -32,6 +36,69 @@ public:
     explicit RenderLoop(QObject *parent = nullptr);
     ~RenderLoop() override;
 
+    /**
+     * This enum type specifies the stages of a compositing cycle that are recorded in
+     * the frame timings.
+     */
+    enum class FrameStage {
+        Started, ///< The compositing cycle has started
+        WindowsToRender, ///< The list of windows to render has been collected
+        PrePaintScreen, ///< Effects have finished prePaintScreen()
+        Prepass, ///< The occlusion culling pass in paintSimpleScreen() has finished
+        Submission, ///< All rendering commands have been submitted to the GPU
+        EndFrame, ///< The backend has finished the frame, e.g. swapped buffers
+        PageFlipped, ///< The frame has been presented on the screen
+    };
+    static constexpr int FrameStageCount = int(FrameStage::PageFlipped) + 1;
+
+    /**
+     * The FrameTimings struct holds the monotonic timestamps at which a frame went
+     * through each FrameStage. A stage that has not been reached has a zero timestamp.
+     */
+    struct FrameTimings
+    {
+        quint64 sequence = 0;
+        std::array<std::chrono::nanoseconds, FrameStageCount> timestamps = {};
+        /**
+         * The monotonic timestamp of the oldest input event whose result is shown in the
+         * frame, or zero if the frame doesn't show the result of any input event.
+         */
+        std::chrono::nanoseconds inputTimestamp = std::chrono::nanoseconds::zero();
+        /**
+         * The time the GPU took to execute the rendering commands of the frame, or zero
+         * if it hasn't been measured, e.g. because timer queries are not supported.
+         */
+        std::chrono::nanoseconds renderTime = std::chrono::nanoseconds::zero();
+
+        std::chrono::nanoseconds timestamp(FrameStage stage) const
+        {
+            return timestamps[int(stage)];
+        }
+    };
+
+    /**
+     * The InputLatency struct describes the time between input events and the presentation
+     * of the first frame that shows their result.
+     */
+    struct InputLatency
+    {
+        /**
+         * The number of buckets in the histogram. Every bucket covers one millisecond,
+         * the last bucket counts all latencies that don't fit in the other buckets.
+         */
+        static constexpr int BucketCount = 64;
+        std::array<quint32, BucketCount> histogram = {};
+        quint64 count = 0;
+        std::chrono::nanoseconds minimum = std::chrono::nanoseconds::zero();
+        std::chrono::nanoseconds maximum = std::chrono::nanoseconds::zero();
+        std::chrono::nanoseconds total = std::chrono::nanoseconds::zero();
+        std::chrono::nanoseconds last = std::chrono::nanoseconds::zero();
+        /**
+         * The exponential moving average of the recent latencies.
+         */
+        std::chrono::nanoseconds smoothed = std::chrono::nanoseconds::zero();
+    };
+
     /**
      * Pauses the render loop. While the render loop is inhibited, scheduleRepaint()
      * requests are queued.
@@ -55,9 +122,76 @@ public:
     /**
      * This function must be called after the Compositor has finished rendering the
      * next frame.
+     *
+     * If the render time of the frame is measured by other means, e.g. with a GPU timer
+     * query, call addRenderTime() once the measurement is available instead.
      */
     void endFrame();
 
+    /**
+     * Returns the sequence number of the frame that is currently being rendered, i.e.
+     * the frame that has been started with the last beginFrame() call.
+     */
+    quint64 frameSequence() const;
+
+    /**
+     * Adds the @a renderTime of a previously rendered frame to the render journal. The
+     * render time is the amount of time between the start of the frame and the moment
+     * when the GPU has finished executing the rendering commands.
+     *
+     * The render time is also stored in the frame timings of the frame with the given
+     * @a sequence number, as long as the frame log still contains that frame.
+     */
+    void addRenderTime(std::chrono::nanoseconds renderTime, quint64 sequence);
+
+    /**
+     * Records that the frame that is currently being rendered has reached the given
+     * @a stage. FrameStage::Started begins a new record, the record is kept in the
+     * frame log once beginFrame() is called. FrameStage::PageFlipped is recorded by
+     * the render loop itself.
+     */
+    void recordFrameStage(FrameStage stage);
+
+    /**
+     * Returns the timings of up to @a count most recently rendered frames, ordered from
+     * the oldest to the newest frame.
+     */
+    QVector<FrameTimings> frameTimings(int count) const;
+
+    /**
+     * Notifies the render loop that the result of an input event with the given monotonic
+     * @a timestamp will be shown in the next frame, e.g. because the software cursor has
+     * moved. The latency is measured when that frame is presented.
+     */
+    void addInputEvent(std::chrono::microseconds timestamp);
+
+    /**
+     * Returns the input-to-photon latencies that have been measured so far.
+     */
+    InputLatency inputLatency() const;
+
+    /**
+     * Forgets the input latencies that have been measured so far.
+     */
+    void resetInputLatency();
+
+    /**
+     * This enum type specifies how expensive the effects may be when painting this output.
+     */
+    enum class RenderQuality {
+        High, ///< Frames comfortably fit in the vblank interval
+        Medium, ///< Frames often exceed their budget, expensive effects should be toned down
+        Low, ///< Frames keep being late even at medium quality, effects should take shortcuts
+    };
+    Q_ENUM(RenderQuality)
+
+    /**
+     * Returns the render quality that frames on this output currently can afford. The
+     * quality is lowered step by step if frames keep exceeding the vblank interval, and
+     * raised again after there has been enough headroom for a while.
+     */
+    RenderQuality renderQuality() const;
+
     /**
      * Returns the refresh rate at which the output is being updated, in millihertz.
      */
@@ -73,6 +207,13 @@ public:
      */
     void scheduleRepaint(Item *item = nullptr);
 
+    /**
+     * Returns @c true if a compositing cycle has been scheduled without an associated
+     * item since the last frame, e.g. to apply a new gamma ramp or mode. Such frames
+     * must be rendered even if nothing has been damaged.
+     */
+    bool isRepaintForced() const;
+
     /**
      * Returns the timestamp of the last frame that has been presented on the screen.
      * The returned timestamp is sourced from the monotonic clock.
@@ -119,6 +260,14 @@ Q_SIGNALS:
      * @a timestamp indicates the time when it took place.
      */
     void framePresented(RenderLoop *loop, std::chrono::nanoseconds timestamp);
+    /**
+     * This signal is emitted when a frame could not be presented on the screen.
+     */
+    void frameFailed(RenderLoop *loop);
+    /**
+     * This signal is emitted when the render quality of this RenderLoop has changed.
+     */
+    void renderQualityChanged();
 
     /**
      * This signal is emitted when the render loop wants a new frame to be composited.
@@ -6,10 +6,10 @@
 
 #pragma once
 
+#include "options.h"
 #include "renderloop.h"
 #include "renderjournal.h"
-
-#include <QTimer>
+#include "utils/precisetimer.h"
 
 namespace KWin
 {
@@ -24,22 +24,71 @@ public:
     void invalidate();
 
     void delayScheduleRepaint();
+    void queueScheduleRepaint();
     void scheduleRepaint();
     void maybeScheduleRepaint();
 
+    /**
+     * Returns @c true if the composite timer has expired at @a currentTime, but the frame
+     * hasn't been requested yet, e.g. because the event loop is busy with another output.
+     */
+    bool isDispatchDue(std::chrono::nanoseconds currentTime) const;
+    /**
+     * Requests the frame right away instead of waiting for the composite timer.
+     */
+    void dispatchNow();
+
     void notifyFrameFailed();
     void notifyFrameCompleted(std::chrono::nanoseconds timestamp);
 
+    void commitFrameTimings();
+    void updateAdaptiveLatency(std::chrono::nanoseconds timestamp);
+    void updateRenderQuality(std::chrono::nanoseconds timestamp);
+    void addInputLatency(std::chrono::nanoseconds latency);
+
+    /**
+     * Returns the latency policy that is currently in effect. If the adaptive policy is
+     * configured, this is the level that has been picked for this render loop.
+     */
+    LatencyPolicy latencyPolicy() const;
+
+    /**
+     * Returns the amount of time by which compositing is started earlier than strictly
+     * necessary to account for scheduling jitter.
+     */
+    std::chrono::nanoseconds safetyMargin() const;
+
     RenderLoop *q;
     std::chrono::nanoseconds lastPresentationTimestamp = std::chrono::nanoseconds::zero();
     std::chrono::nanoseconds nextPresentationTimestamp = std::chrono::nanoseconds::zero();
-    QTimer compositeTimer;
+    PreciseTimer compositeTimer;
     RenderJournal renderJournal;
+    static constexpr int frameLogSize = 128;
+    std::array<RenderLoop::FrameTimings, frameLogSize> frameLog;
+    RenderLoop::FrameTimings pendingFrameTimings;
+    std::chrono::nanoseconds pendingInputTimestamp = std::chrono::nanoseconds::zero();
+    RenderLoop::InputLatency inputLatency;
+    quint64 frameSequence = 0;
+    int frameLogHead = 0;
+    int frameLogCount = 0;
+    bool frameTimingsCommitted = false;
+    LatencyPolicy configuredLatencyPolicy = LatencyMedium;
+    LatencyPolicy adaptiveLatencyPolicy = LatencyMedium;
+    std::chrono::nanoseconds adaptiveSafetyMargin = std::chrono::milliseconds(3);
+    int adaptiveHitCount = 0;
+    int missedFrameCount = 0;
+    RenderLoop::RenderQuality renderQuality = RenderLoop::RenderQuality::High;
+    int qualityMissCount = 0;
+    int qualityHitCount = 0;
     int refreshRate = 60000;
     int pendingFrameCount = 0;
+    // how many frames may be in flight at once, set by the platform
+    int maxPendingFrameCount = 1;
     int inhibitCount = 0;
     bool pendingReschedule = false;
+    bool rescheduleQueued = false;
     bool pendingRepaint = false;
+    bool forcedRepaint = false;
     RenderLoop::VrrPolicy vrrPolicy = RenderLoop::VrrPolicy::Never;
     Item *fullscreenItem = nullptr;
 
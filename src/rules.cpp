@@ -18,6 +18,8 @@
 #include <QDebug>
 #include <QDir>
 
+#include <algorithm>
+
 #ifndef KCMRULES
 #include "x11client.h"
 #include "client_machine.h"
@@ -127,6 +129,7 @@ void Rules::readFromSettings(const RuleSettings *settings)
     READ_MATCH_STRING(windowrole, .toLower().toLatin1());
     READ_MATCH_STRING(title,);
     READ_MATCH_STRING(clientmachine, .toLower().toLatin1());
+    compileRegExps();
     types = NET::WindowTypeMask(settings->types());
     READ_FORCE_RULE(placement,);
     READ_SET_RULE(position);
@@ -321,6 +324,14 @@ QString Rules::getDecoColor(const QString &themeName)
                                   QLatin1String("color-schemes/") + themeName + QLatin1String(".colors"));
 }
 
+void Rules::compileRegExps()
+{
+    wmclassregexp = QRegularExpression(wmclassmatch == RegExpMatch ? QString::fromUtf8(wmclass) : QString());
+    windowroleregexp = QRegularExpression(windowrolematch == RegExpMatch ? QString::fromUtf8(windowrole) : QString());
+    titleregexp = QRegularExpression(titlematch == RegExpMatch ? title : QString());
+    clientmachineregexp = QRegularExpression(clientmachinematch == RegExpMatch ? QString::fromUtf8(clientmachine) : QString());
+}
+
 bool Rules::matchType(NET::WindowType match_type) const
 {
     if (types != NET::AllTypesMask) {
@@ -335,10 +346,9 @@ bool Rules::matchType(NET::WindowType match_type) const
 bool Rules::matchWMClass(const QByteArray& match_class, const QByteArray& match_name) const
 {
     if (wmclassmatch != UnimportantMatch) {
-        // TODO optimize?
         QByteArray cwmclass = wmclasscomplete
                               ? match_name + ' ' + match_class : match_class;
-        if (wmclassmatch == RegExpMatch && !QRegularExpression(QString::fromUtf8(wmclass)).match(QString::fromUtf8(cwmclass)).hasMatch())
+        if (wmclassmatch == RegExpMatch && !wmclassregexp.match(QString::fromUtf8(cwmclass)).hasMatch())
             return false;
         if (wmclassmatch == ExactMatch && wmclass != cwmclass)
             return false;
@@ -351,7 +361,7 @@ bool Rules::matchWMClass(const QByteArray& match_class, const QByteArray& match_
 bool Rules::matchRole(const QByteArray& match_role) const
 {
     if (windowrolematch != UnimportantMatch) {
-        if (windowrolematch == RegExpMatch && !QRegularExpression(QString::fromUtf8(windowrole)).match(QString::fromUtf8(match_role)).hasMatch())
+        if (windowrolematch == RegExpMatch && !windowroleregexp.match(QString::fromUtf8(match_role)).hasMatch())
             return false;
         if (windowrolematch == ExactMatch && windowrole != match_role)
             return false;
@@ -364,7 +374,7 @@ bool Rules::matchRole(const QByteArray& match_role) const
 bool Rules::matchTitle(const QString& match_title) const
 {
     if (titlematch != UnimportantMatch) {
-        if (titlematch == RegExpMatch && !QRegularExpression(title).match(match_title).hasMatch())
+        if (titlematch == RegExpMatch && !titleregexp.match(match_title).hasMatch())
             return false;
         if (titlematch == ExactMatch && title != match_title)
             return false;
@@ -382,7 +392,7 @@ bool Rules::matchClientMachine(const QByteArray& match_machine, bool local) cons
                 && matchClientMachine("localhost", true))
             return true;
         if (clientmachinematch == RegExpMatch
-                && !QRegularExpression(QString::fromUtf8(clientmachine)).match(QString::fromUtf8(match_machine)).hasMatch())
+                && !clientmachineregexp.match(QString::fromUtf8(match_machine)).hasMatch())
             return false;
         if (clientmachinematch == ExactMatch
                 && clientmachine != match_machine)
@@ -396,6 +406,20 @@ bool Rules::matchClientMachine(const QByteArray& match_machine, bool local) cons
 
 #ifndef KCMRULES
 bool Rules::match(const AbstractClient* c) const
+{
+    if (!matchIgnoringTitle(c))
+        return false;
+    if (titlematch != UnimportantMatch) // track title changes to rematch rules
+        QObject::connect(c, &AbstractClient::captionChanged, c, &AbstractClient::evaluateWindowRulesForCaption,
+                         // QueuedConnection, because title may change before
+                         // the client is ready (could segfault!)
+                         static_cast<Qt::ConnectionType>(Qt::QueuedConnection|Qt::UniqueConnection));
+    if (!matchTitle(c->captionNormal()))
+        return false;
+    return true;
+}
+
+bool Rules::matchIgnoringTitle(const AbstractClient* c) const
 {
     if (!matchType(c->windowType(true)))
         return false;
@@ -405,16 +429,24 @@ bool Rules::match(const AbstractClient* c) const
         return false;
     if (!matchClientMachine(c->clientMachine()->hostName(), c->clientMachine()->isLocal()))
         return false;
-    if (titlematch != UnimportantMatch) // track title changes to rematch rules
-        QObject::connect(c, &AbstractClient::captionChanged, c, &AbstractClient::evaluateWindowRules,
-                         // QueuedConnection, because title may change before
-                         // the client is ready (could segfault!)
-                         static_cast<Qt::ConnectionType>(Qt::QueuedConnection|Qt::UniqueConnection));
-    if (!matchTitle(c->captionNormal()))
-        return false;
     return true;
 }
 
+bool Rules::hasTitleMatch() const
+{
+    return titlematch != UnimportantMatch;
+}
+
+bool Rules::hasExactWMClass() const
+{
+    return wmclassmatch == ExactMatch;
+}
+
+QByteArray Rules::wmClass() const
+{
+    return wmclass;
+}
+
 #define NOW_REMEMBER(_T_, _V_) ((selection & _T_) && (_V_##rule == (SetRule)Remember))
 
 bool Rules::update(AbstractClient* c, int selection)
@@ -849,7 +881,7 @@ CHECK_RULE(DesktopFile, QString)
 
 void AbstractClient::setupWindowRules(bool ignore_temporary)
 {
-    disconnect(this, &AbstractClient::captionChanged, this, &AbstractClient::evaluateWindowRules);
+    disconnect(this, &AbstractClient::captionChanged, this, &AbstractClient::evaluateWindowRulesForCaption);
     m_rules = RuleBook::self()->find(this, ignore_temporary);
     // check only after getting the rules, because there may be a rule forcing window type
 }
@@ -969,33 +1001,84 @@ void RuleBook::deleteAll()
 {
     qDeleteAll(m_rules);
     m_rules.clear();
+    invalidateIndex();
+}
+
+void RuleBook::invalidateIndex()
+{
+    m_indexDirty = true;
+}
+
+QVector<int> RuleBook::candidateRules(const AbstractClient* c)
+{
+    if (m_indexDirty) {
+        m_exactClassIndex.clear();
+        m_unindexedRules.clear();
+        for (int i = 0; i < m_rules.count(); ++i) {
+            const Rules *rule = m_rules.at(i);
+            if (rule->hasExactWMClass()) {
+                m_exactClassIndex[rule->wmClass()].append(i);
+            } else {
+                m_unindexedRules.append(i);
+            }
+        }
+        m_indexDirty = false;
+    }
+    // Exact class rules are keyed by their class string, which is either the resource class
+    // or "name class" for complete matches, match() has the final word for each candidate.
+    QVector<int> candidates = m_unindexedRules;
+    candidates += m_exactClassIndex.value(c->resourceClass());
+    candidates += m_exactClassIndex.value(c->resourceName() + ' ' + c->resourceClass());
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+    return candidates;
 }
 
 WindowRules RuleBook::find(const AbstractClient* c, bool ignore_temporary)
 {
     QVector< Rules* > ret;
-    for (QList< Rules* >::Iterator it = m_rules.begin();
-            it != m_rules.end();
-       ) {
-        if (ignore_temporary && (*it)->isTemporary()) {
-            ++it;
+    QVector< Rules* > usedTemporary;
+    const QVector<int> candidates = candidateRules(c);
+    for (int index : candidates) {
+        Rules* rule = m_rules.at(index);
+        if (ignore_temporary && rule->isTemporary()) {
             continue;
         }
-        if ((*it)->match(c)) {
-            Rules* rule = *it;
+        if (rule->match(c)) {
             qCDebug(KWIN_CORE) << "Rule found:" << rule << ":" << c;
             if (rule->isTemporary())
-                it = m_rules.erase(it);
-            else
-                ++it;
+                usedTemporary.append(rule);
             ret.append(rule);
-            continue;
         }
-        ++it;
+    }
+    if (!usedTemporary.isEmpty()) {
+        for (Rules *rule : qAsConst(usedTemporary)) {
+            m_rules.removeOne(rule);
+        }
+        invalidateIndex();
     }
     return WindowRules(ret);
 }
 
+bool RuleBook::captionAffectsRules(const AbstractClient* c)
+{
+    // The caption only feeds into title matches, so the other rules can't change
+    const QVector<int> candidates = candidateRules(c);
+    for (int index : candidates) {
+        const Rules* rule = m_rules.at(index);
+        if (rule->isTemporary() || !rule->hasTitleMatch()) {
+            continue;
+        }
+        if (!rule->matchIgnoringTitle(c)) {
+            continue;
+        }
+        if (rule->matchTitle(c->captionNormal()) != c->rules()->contains(rule)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void RuleBook::edit(AbstractClient* c, bool whole_app)
 {
     save();
@@ -1029,6 +1112,7 @@ void RuleBook::load()
     RuleBookSettings book(m_config);
     book.load();
     m_rules = book.rules().toList();
+    invalidateIndex();
 }
 
 void RuleBook::save()
@@ -1059,6 +1143,7 @@ void RuleBook::temporaryRulesMessage(const QString& message)
             was_temporary = true;
     Rules* rule = new Rules(message, true);
     m_rules.prepend(rule);   // highest priority first
+    invalidateIndex();
     if (!was_temporary)
         QTimer::singleShot(60000, this, &RuleBook::cleanupTemporaryRules);
 }
@@ -1071,6 +1156,7 @@ void RuleBook::cleanupTemporaryRules()
        ) {
         if ((*it)->discardTemporary(false)) { // deletes (*it)
             it = m_rules.erase(it);
+            invalidateIndex();
         } else {
             if ((*it)->isTemporary())
                 has_temporary = true;
@@ -1096,6 +1182,7 @@ void RuleBook::discardUsed(AbstractClient* c, bool withdrawn)
                 Rules* r = *it;
                 it = m_rules.erase(it);
                 delete r;
+                invalidateIndex();
                 continue;
             }
         }
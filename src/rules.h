@@ -12,7 +12,9 @@
 
 
 #include <netwm_def.h>
+#include <QHash>
 #include <QRect>
+#include <QRegularExpression>
 #include <QVector>
 
 #include "placement.h"
@@ -134,6 +136,12 @@ public:
 #ifndef KCMRULES
     bool discardUsed(bool withdrawn);
     bool match(const AbstractClient* c) const;
+    bool matchIgnoringTitle(const AbstractClient* c) const;
+    bool hasTitleMatch() const;
+    bool matchTitle(const QString& match_title) const;
+    // the window class a rule applies to, if it only matches windows of exactly that class
+    bool hasExactWMClass() const;
+    QByteArray wmClass() const;
     bool update(AbstractClient*, int selection);
     bool isTemporary() const;
     bool discardTemporary(bool force);   // removes if temporary and forced or too old
@@ -180,12 +188,15 @@ private:
     bool matchType(NET::WindowType match_type) const;
     bool matchWMClass(const QByteArray& match_class, const QByteArray& match_name) const;
     bool matchRole(const QByteArray& match_role) const;
+#ifdef KCMRULES
     bool matchTitle(const QString& match_title) const;
+#endif
     bool matchClientMachine(const QByteArray& match_machine, bool local) const;
 #ifdef KCMRULES
 private:
 #endif
     void readFromSettings(const RuleSettings *settings);
+    void compileRegExps();
     static ForceRule convertForceRule(int v);
     static QString getDecoColor(const QString &themeName);
 #ifndef KCMRULES
@@ -206,6 +217,11 @@ private:
     QByteArray clientmachine;
     StringMatch clientmachinematch;
     NET::WindowTypes types; // types for matching
+    // compiled once, RegExpMatch strings are matched for every window and title change
+    QRegularExpression wmclassregexp;
+    QRegularExpression windowroleregexp;
+    QRegularExpression titleregexp;
+    QRegularExpression clientmachineregexp;
     Placement::Policy placement;
     ForceRule placementrule;
     QPoint position;
@@ -288,6 +304,7 @@ class KWIN_EXPORT RuleBook : public QObject
 public:
     ~RuleBook() override;
     WindowRules find(const AbstractClient*, bool);
+    bool captionAffectsRules(const AbstractClient* c);
     void discardUsed(AbstractClient* c, bool withdraw);
     void setUpdatesDisabled(bool disable);
     bool areUpdatesDisabled() const;
@@ -308,9 +325,15 @@ private:
     void deleteAll();
     void initializeX11();
     void cleanupX11();
+    void invalidateIndex();
+    QVector<int> candidateRules(const AbstractClient* c);
     QTimer *m_updateTimer;
     bool m_updatesDisabled;
     QList<Rules*> m_rules;
+    // positions in m_rules of the rules matching an exact window class, and of all others
+    QHash<QByteArray, QVector<int>> m_exactClassIndex;
+    QVector<int> m_unindexedRules;
+    bool m_indexDirty = true;
     QScopedPointer<KXMessages> m_temporaryRulesMessages;
     KSharedConfig::Ptr m_config;
 
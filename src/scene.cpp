@@ -54,7 +54,9 @@
 
 #include "scene.h"
 #include "abstract_output.h"
+#include "ftrace.h"
 #include "internal_client.h"
+#include "paintstatistics.h"
 #include "platform.h"
 #include "shadowitem.h"
 #include "surfaceitem.h"
@@ -76,6 +78,8 @@
 #include "composite.h"
 #include <QtMath>
 
+#include <algorithm>
+
 namespace KWin
 {
 
@@ -120,12 +124,22 @@ void Scene::addCursorRepaints()
     for (const auto &output : outputs) {
         auto intersection = repaintRegion.intersected(output->geometry());
         if (!intersection.isEmpty() && output->usesSoftwareCursor()) {
-            addRepaint(intersection);
+            addCursorRepaint(output, intersection);
         }
     }
     m_lastCursorGeometry = Cursors::self()->currentCursor()->geometry();
 }
 
+void Scene::addCursorRepaint(AbstractOutput *output, const QRegion &region)
+{
+    if (kwinApp()->platform()->isPerScreenRenderingEnabled()) {
+        m_cursorRepaints[output] += region;
+        output->renderLoop()->scheduleRepaint();
+    } else {
+        addRepaint(region);
+    }
+}
+
 void Scene::addRepaintFull()
 {
     addRepaint(geometry());
@@ -173,17 +187,57 @@ void Scene::setGeometry(const QRect &rect)
 
 QRegion Scene::repaints(AbstractOutput *output) const
 {
-    return m_repaints.value(output, infiniteRegion());
+    return m_repaints.value(output, infiniteRegion()) | m_cursorRepaints.value(output);
 }
 
 void Scene::resetRepaints(AbstractOutput *output)
 {
+    const QRegion cursorRepaints = m_cursorRepaints.take(output);
+    if (!cursorRepaints.isEmpty() && m_repaints.value(output, infiniteRegion()).isEmpty()) {
+        m_cursorOnlyRepaints.insert(output);
+    } else {
+        m_cursorOnlyRepaints.remove(output);
+    }
     m_repaints.insert(output, QRegion());
 }
 
+bool Scene::hasPendingRepaints(AbstractOutput *output) const
+{
+    if (!m_repaints.value(output, infiniteRegion()).isEmpty()) {
+        return true;
+    }
+    if (!m_cursorRepaints.value(output).isEmpty()) {
+        return true;
+    }
+
+    for (const Window *window : m_windows) {
+        if (window->windowItem()->hasRepaintsRecursive(output)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Scene::hasOnlyCursorRepaints(AbstractOutput *output) const
+{
+    if (!m_cursorOnlyRepaints.contains(output)) {
+        return false;
+    }
+
+    for (const Window *window : m_windows) {
+        if (window->windowItem()->hasRepaintsRecursive(output)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void Scene::removeRepaints(AbstractOutput *output)
 {
     m_repaints.remove(output);
+    m_cursorRepaints.remove(output);
+    m_cursorOnlyRepaints.remove(output);
+    m_transformedAreas.remove(output);
 }
 
 
@@ -229,6 +283,8 @@ void Scene::paintScreen(const QRegion &damage, const QRegion &repaint,
                         QRegion *updateRegion, QRegion *validRegion, RenderLoop *renderLoop,
                         const QMatrix4x4 &projection)
 {
+    fTraceSlice("Scene::paintScreen");
+
     const QRegion displayRegion(geometry());
 
     const std::chrono::milliseconds presentTime =
@@ -243,6 +299,8 @@ void Scene::paintScreen(const QRegion &damage, const QRegion &repaint,
         m_expectedPresentTimestamp = presentTime;
     }
 
+    m_renderLoop = renderLoop;
+
     // preparation step
     auto effectsImpl = static_cast<EffectsHandlerImpl *>(effects);
     effectsImpl->startPaint();
@@ -257,19 +315,36 @@ void Scene::paintScreen(const QRegion &damage, const QRegion &repaint,
 
     effects->prePaintScreen(pdata, m_expectedPresentTimestamp);
     region = pdata.paint;
+    renderLoop->recordFrameStage(RenderLoop::FrameStage::PrePaintScreen);
 
     int mask = pdata.mask;
     if (mask & (PAINT_SCREEN_TRANSFORMED | PAINT_SCREEN_WITH_TRANSFORMED_WINDOWS)) {
         // Region painting is not possible with transformations,
         // because screen damage doesn't match transformed positions.
         mask &= ~PAINT_SCREEN_REGION;
+        // Keep the damage around, paintGenericScreen() may still be able to paint
+        // only a part of the screen if it knows where the transformed windows are.
+        m_genericScreenDamage = region & displayRegion;
         region = infiniteRegion();
-    } else if (mask & PAINT_SCREEN_REGION) {
-        // make sure not to go outside visible screen
-        region &= displayRegion;
     } else {
-        // whole screen, not transformed, force region to be full
-        region = displayRegion;
+        if (mask & PAINT_SCREEN_REGION) {
+            // make sure not to go outside visible screen
+            region &= displayRegion;
+        } else {
+            // whole screen, not transformed, force region to be full
+            region = displayRegion;
+        }
+
+        // Windows can't move to another output without transformations, so there's no
+        // point in running the effect chain for windows that are not on this output. Any
+        // active effect may transform windows unless it says otherwise.
+        if (painted_screen && painted_screen->renderLoop() == renderLoop && !effectsImpl->wantsWindowsOnOtherOutputs()) {
+            auto isCulled = [this](const Window *window) {
+                return !window->isVisibleOnOutput(painted_screen);
+            };
+            stacking_order.erase(std::remove_if(stacking_order.begin(), stacking_order.end(), isCulled),
+                                 stacking_order.end());
+        }
     }
 
     painted_region = region;
@@ -288,12 +363,18 @@ void Scene::paintScreen(const QRegion &damage, const QRegion &repaint,
 
     // make sure not to go outside of the screen area
     *updateRegion = damaged_region;
-    *validRegion = (region | painted_region) & displayRegion;
+    if (region == infiniteRegion()) {
+        *validRegion = painted_region & displayRegion;
+    } else {
+        *validRegion = (region | painted_region) & displayRegion;
+    }
 
     repaint_region = QRegion();
     damaged_region = QRegion();
+    m_genericScreenDamage = QRegion();
 
     m_paintScreenCount = 0;
+    m_renderLoop = nullptr;
 }
 
 // the function that'll be eventually called by paintScreen() above
@@ -306,44 +387,93 @@ void Scene::finalPaintScreen(int mask, const QRegion &region, ScreenPaintData& d
         paintSimpleScreen(mask, region);
 }
 
-static void resetRepaintsHelper(Item *item, AbstractOutput *output)
-{
-    item->resetRepaints(output);
-
-    const auto childItems = item->childItems();
-    for (Item *childItem : childItems) {
-        resetRepaintsHelper(childItem, output);
-    }
-}
-
 // The generic painting code that can handle even transformations.
 // It simply paints bottom-to-top.
 void Scene::paintGenericScreen(int orig_mask, const ScreenPaintData &)
 {
+    // Transformed windows can end up anywhere, so no window counts as covered.
+    if (m_paintScreenCount == 1) {
+        m_occludedWindows.remove(painted_screen);
+    }
+
+    const QRegion displayRegion(geometry());
+
+    // Only a part of the screen can be repainted if the screen itself is not transformed and
+    // the effects tell where the transformed windows are painted. Whether this is the case
+    // is known only after all windows have gone through prePaintWindow(), so the damage
+    // is collected as in paintSimpleScreen() and simply thrown away otherwise.
+    bool partialRepaint = !(orig_mask & PAINT_SCREEN_TRANSFORMED) && m_paintScreenCount == 1;
+    QRegion dirtyArea = m_genericScreenDamage;
+    QRegion transformedArea;
+
     QVector<Phase2Data> phase2;
     phase2.reserve(stacking_order.size());
     for (Window * w : qAsConst(stacking_order)) { // bottom to top
-        // Reset the repaint_region.
-        // This has to be done here because many effects schedule a repaint for
-        // the next frame within Effects::prePaintWindow.
-        resetRepaintsHelper(w->windowItem(), painted_screen);
-
         WindowPrePaintData data;
         data.mask = orig_mask | (w->isOpaque() ? PAINT_WINDOW_OPAQUE : PAINT_WINDOW_TRANSLUCENT);
         w->resetPaintingEnabled();
-        data.paint = infiniteRegion(); // no clipping, so doesn't really matter
         data.clip = QRegion();
+        // The repaints have to be taken here because many effects schedule a repaint
+        // for the next frame within Effects::prePaintWindow.
+        if (partialRepaint) {
+            data.paint = m_genericScreenDamage;
+            w->windowItem()->accumulateRepaints(painted_screen, &data.paint);
+        } else {
+            w->windowItem()->resetRepaintsRecursive(painted_screen);
+            data.paint = infiniteRegion(); // no clipping, so doesn't really matter
+        }
         // preparation step
         effects->prePaintWindow(effectWindow(w), data, m_expectedPresentTimestamp);
         if (!w->isPaintingEnabled()) {
             continue;
         }
+        if (data.mask & PAINT_WINDOW_TRANSFORMED) {
+            if (data.transformedRegion.isEmpty() || data.transformedRegion == infiniteRegion()) {
+                partialRepaint = false;
+            } else {
+                transformedArea |= data.transformedRegion;
+            }
+        } else {
+            dirtyArea |= data.paint;
+        }
         phase2.append({w, infiniteRegion(), data.clip, data.mask,});
     }
 
-    damaged_region = geometry();
+    // The transformed windows have to be erased from where they were painted in the
+    // previous frame, even if they don't cover that area anymore.
     if (m_paintScreenCount == 1) {
-        aboutToStartPainting(painted_screen, damaged_region);
+        QRegion &previousTransformedArea = m_transformedAreas[painted_screen];
+        dirtyArea |= previousTransformedArea;
+        previousTransformedArea = transformedArea & displayRegion;
+        dirtyArea |= previousTransformedArea;
+    }
+
+    QRegion region = infiniteRegion();
+    QRegion repaintClip;
+    if (partialRepaint) {
+        repaintClip = repaint_region - dirtyArea;
+        dirtyArea |= repaint_region;
+        dirtyArea &= displayRegion;
+        if (dirtyArea != displayRegion) {
+            extendPaintRegion(dirtyArea, false);
+        }
+        if (dirtyArea != displayRegion) {
+            region = dirtyArea;
+        }
+    }
+
+    if (region == infiniteRegion()) {
+        damaged_region = geometry();
+    } else {
+        painted_region = dirtyArea;
+        damaged_region = dirtyArea - repaintClip;
+        for (Phase2Data &d : phase2) {
+            d.region = dirtyArea;
+        }
+    }
+
+    if (m_paintScreenCount == 1) {
+        aboutToStartPainting(painted_screen, region == infiniteRegion() ? damaged_region : dirtyArea);
 
         if (orig_mask & PAINT_SCREEN_BACKGROUND_FIRST) {
             paintBackground(infiniteRegion());
@@ -351,22 +481,13 @@ void Scene::paintGenericScreen(int orig_mask, const ScreenPaintData &)
     }
 
     if (!(orig_mask & PAINT_SCREEN_BACKGROUND_FIRST)) {
-        paintBackground(infiniteRegion());
+        paintBackground(region);
     }
+    beginPaintWindows(phase2);
     for (const Phase2Data &d : qAsConst(phase2)) {
         paintWindow(d.window, d.mask, d.region);
     }
-}
-
-static void accumulateRepaints(Item *item, AbstractOutput *output, QRegion *repaints)
-{
-    *repaints += item->repaints(output);
-    item->resetRepaints(output);
-
-    const auto childItems = item->childItems();
-    for (Item *childItem : childItems) {
-        accumulateRepaints(childItem, output, repaints);
-    }
+    endPaintWindows();
 }
 
 // The optimized case without any transformations at all.
@@ -390,7 +511,7 @@ void Scene::paintSimpleScreen(int orig_mask, const QRegion &region)
         data.mask = orig_mask | (window->isOpaque() ? PAINT_WINDOW_OPAQUE : PAINT_WINDOW_TRANSLUCENT);
         window->resetPaintingEnabled();
         data.paint = region;
-        accumulateRepaints(window->windowItem(), painted_screen, &data.paint);
+        window->windowItem()->accumulateRepaints(painted_screen, &data.paint);
 
         // Clip out the decoration for opaque windows; the decoration is drawn in the second pass
         opaqueFullscreen = false; // TODO: do we care about unmanged windows here (maybe input windows?)
@@ -433,6 +554,13 @@ void Scene::paintSimpleScreen(int orig_mask, const QRegion &region)
         phase2data.append({ window, data.paint, data.clip, data.mask, });
     }
 
+    // Erase the windows that were transformed in the previous frame.
+    QRegion staleArea;
+    if (m_paintScreenCount == 1) {
+        staleArea = m_transformedAreas.take(painted_screen);
+        dirtyArea |= staleArea;
+    }
+
     // Save the part of the repaint region that's exclusively rendered to
     // bring a reused back buffer up to date. Then union the dirty region
     // with the repaint region.
@@ -446,13 +574,32 @@ void Scene::paintSimpleScreen(int orig_mask, const QRegion &region)
         fullRepaint = (dirtyArea == displayRegion);
     }
 
-    QRegion allclips, upperTranslucentDamage;
-    upperTranslucentDamage = repaint_region;
+    QRegion upperTranslucentDamage;
+    upperTranslucentDamage = repaint_region | staleArea;
+
+    m_occlusionMap.reset(geometry());
+
+    // Remember which windows are completely covered, only in the first pass of the frame.
+    QSet<Toplevel *> *occludedWindows = nullptr;
+    if (m_paintScreenCount == 1) {
+        occludedWindows = &m_occludedWindows[painted_screen];
+        occludedWindows->clear();
+    }
 
     // This is the occlusion culling pass
     for (int i = phase2data.count() - 1; i >= 0; --i) {
         Phase2Data *data = &phase2data[i];
 
+        // The occlusion map holds only the windows above this one at this point.
+        if (occludedWindows && !(data->mask & PAINT_WINDOW_TRANSFORMED)) {
+            if (const SurfaceItem *surfaceItem = data->window->surfaceItem()) {
+                const QRect surfaceRect = surfaceItem->mapToGlobal(surfaceItem->boundingRect());
+                if (m_occlusionMap.subtract(surfaceRect).isEmpty()) {
+                    occludedWindows->insert(data->window->window());
+                }
+            }
+        }
+
         if (fullRepaint) {
             data->region = displayRegion;
         } else {
@@ -461,13 +608,13 @@ void Scene::paintSimpleScreen(int orig_mask, const QRegion &region)
 
         // subtract the parts which will possibly been drawn as part of
         // a higher opaque window
-        data->region -= allclips;
+        data->region = m_occlusionMap.subtract(data->region);
 
         // Here we rely on WindowPrePaintData::setTranslucent() to remove
         // the clip if needed.
         if (!data->clip.isEmpty() && !(data->mask & PAINT_WINDOW_TRANSLUCENT)) {
             // clip away the opaque regions for all windows below this one
-            allclips |= data->clip;
+            m_occlusionMap.add(data->clip);
             // extend the translucent damage for windows below this by remaining (translucent) regions
             if (!fullRepaint) {
                 upperTranslucentDamage |= data->region - data->clip;
@@ -477,6 +624,10 @@ void Scene::paintSimpleScreen(int orig_mask, const QRegion &region)
         }
     }
 
+    if (m_renderLoop && m_paintScreenCount == 1) {
+        m_renderLoop->recordFrameStage(RenderLoop::FrameStage::Prepass);
+    }
+
     QRegion paintedArea;
     // Fill any areas of the root window not covered by opaque windows
     if (m_paintScreenCount == 1) {
@@ -487,20 +638,24 @@ void Scene::paintSimpleScreen(int orig_mask, const QRegion &region)
         }
     }
     if (!(orig_mask & PAINT_SCREEN_BACKGROUND_FIRST)) {
-        paintedArea = dirtyArea - allclips;
+        paintedArea = m_occlusionMap.subtract(dirtyArea);
         paintBackground(paintedArea);
     }
 
-    // Now walk the list bottom to top and draw the windows.
     for (int i = 0; i < phase2data.count(); ++i) {
         Phase2Data *data = &phase2data[i];
 
         // add all regions which have been drawn so far
         paintedArea |= data->region;
         data->region = paintedArea;
+    }
 
-        paintWindow(data->window, data->mask, data->region);
+    // Now walk the list bottom to top and draw the windows.
+    beginPaintWindows(phase2data);
+    for (const Phase2Data &data : qAsConst(phase2data)) {
+        paintWindow(data.window, data.mask, data.region);
     }
+    endPaintWindows();
 
     if (fullRepaint) {
         painted_region = displayRegion;
@@ -534,6 +689,16 @@ void Scene::removeToplevel(Toplevel *toplevel)
     Q_ASSERT(m_windows.contains(toplevel));
     delete m_windows.take(toplevel);
     toplevel->effectWindow()->setSceneWindow(nullptr);
+    PaintStatistics::self()->removeWindow(toplevel);
+
+    for (QSet<Toplevel *> &occludedWindows : m_occludedWindows) {
+        occludedWindows.remove(toplevel);
+    }
+}
+
+bool Scene::isOccluded(Toplevel *toplevel, AbstractOutput *output) const
+{
+    return m_occludedWindows.value(output).contains(toplevel);
 }
 
 void Scene::windowClosed(Toplevel *toplevel, Deleted *deleted)
@@ -547,6 +712,11 @@ void Scene::windowClosed(Toplevel *toplevel, Deleted *deleted)
     Window *window = m_windows.take(toplevel);
     window->updateToplevel(deleted);
     m_windows[deleted] = window;
+    PaintStatistics::self()->removeWindow(toplevel);
+
+    for (QSet<Toplevel *> &occludedWindows : m_occludedWindows) {
+        occludedWindows.remove(toplevel);
+    }
 }
 
 void Scene::createStackingOrder(const QList<Toplevel *> &toplevels)
@@ -571,7 +741,9 @@ void Scene::paintWindow(Window* w, int mask, const QRegion &_region)
         return;
 
     WindowPaintData data(w->window()->effectWindow(), screenProjectionMatrix());
-    effects->paintWindow(effectWindow(w), mask, region, data);
+    PaintStatistics::self()->measureWindow(w->window(), [&]() {
+        effects->paintWindow(effectWindow(w), mask, region, data);
+    });
 }
 
 void Scene::paintDesktop(int desktop, int mask, const QRegion &region, ScreenPaintData &data)
@@ -585,6 +757,15 @@ void Scene::aboutToStartPainting(AbstractOutput *output, const QRegion &damage)
     Q_UNUSED(damage)
 }
 
+void Scene::beginPaintWindows(const QVector<Phase2Data> &windows)
+{
+    Q_UNUSED(windows)
+}
+
+void Scene::endPaintWindows()
+{
+}
+
 // the function that'll be eventually called by paintWindow() above
 void Scene::finalPaintWindow(EffectWindowImpl* w, int mask, const QRegion &region, WindowPaintData& data)
 {
@@ -680,6 +861,12 @@ Scene::Window::Window(Toplevel *client, QObject *parent)
 
     connect(toplevel, &Toplevel::frameGeometryChanged, this, &Window::updateWindowPosition);
     updateWindowPosition();
+
+    auto invalidateVisibleGeometry = [this]() {
+        m_visibleGeometry.reset();
+    };
+    connect(m_windowItem.data(), &WindowItem::positionChanged, this, invalidateVisibleGeometry);
+    connect(m_windowItem.data(), &WindowItem::boundingRectChanged, this, invalidateVisibleGeometry);
 }
 
 Scene::Window::~Window()
@@ -808,6 +995,14 @@ void Scene::Window::updateWindowPosition()
     m_windowItem->setPosition(pos());
 }
 
+bool Scene::Window::isVisibleOnOutput(const AbstractOutput *output) const
+{
+    if (!m_visibleGeometry.has_value()) {
+        m_visibleGeometry = m_windowItem->mapToGlobal(m_windowItem->boundingRect());
+    }
+    return m_visibleGeometry->intersects(output->geometry());
+}
+
 //****************************************
 // Scene::EffectFrame
 //****************************************
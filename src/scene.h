@@ -12,10 +12,14 @@
 
 #include "toplevel.h"
 #include "utils/common.h"
+#include "utils/occlusionmap.h"
 #include "kwineffects.h"
 
 #include <QElapsedTimer>
 #include <QMatrix4x4>
+#include <QSet>
+
+#include <optional>
 
 namespace KWin
 {
@@ -71,6 +75,20 @@ public:
     QRegion repaints(AbstractOutput *output) const;
     void resetRepaints(AbstractOutput *output);
 
+    /**
+     * Returns @c true if anything on the specified @a output has been damaged since the
+     * last frame, either in the scene itself or in any of the window items. Effects that
+     * are animating schedule repaints in postPaintScreen(), so they are covered as well.
+     */
+    bool hasPendingRepaints(AbstractOutput *output) const;
+
+    /**
+     * Returns @c true if the repaints of the specified @a output that were reset the last
+     * time were caused only by the software cursor moving or changing its shape, and no
+     * window item on the output has been damaged.
+     */
+    bool hasOnlyCursorRepaints(AbstractOutput *output) const;
+
     // Returns true if the ctor failed to properly initialize.
     virtual bool initFailed() const = 0;
 
@@ -103,6 +121,12 @@ public:
      */
     void removeToplevel(Toplevel *toplevel);
 
+    /**
+     * Returns @c true if the @a toplevel was completely covered by opaque windows the last
+     * time the @a output was painted.
+     */
+    bool isOccluded(Toplevel *toplevel, AbstractOutput *output) const;
+
     /**
      * @brief Creates the Scene backend of an EffectFrame.
      *
@@ -243,6 +267,11 @@ protected:
         QRegion clip;
         int mask = 0;
     };
+    // called before the windows collected by paintSimpleScreen() or paintGenericScreen() are
+    // painted, lets the scene prepare the resources of all windows at once. The default is NOOP
+    virtual void beginPaintWindows(const QVector<Phase2Data> &windows);
+    // called after the windows collected by paintSimpleScreen() or paintGenericScreen() have been painted
+    virtual void endPaintWindows();
     // The region which actually has been painted by paintScreen() and should be
     // copied from the buffer to the screen. I.e. the region returned from Scene::paintScreen().
     // Since prePaintWindow() can extend areas to paint, these changes would have to propagate
@@ -261,10 +290,24 @@ protected:
 private:
     void removeRepaints(AbstractOutput *output);
     void addCursorRepaints();
+    void addCursorRepaint(AbstractOutput *output, const QRegion &region);
 
     std::chrono::milliseconds m_expectedPresentTimestamp = std::chrono::milliseconds::zero();
     QHash< Toplevel*, Window* > m_windows;
     QMap<AbstractOutput *, QRegion> m_repaints;
+    // Repaints caused by the software cursor, kept apart so the cursor can be
+    // painted without painting the scene
+    QMap<AbstractOutput *, QRegion> m_cursorRepaints;
+    QSet<AbstractOutput *> m_cursorOnlyRepaints;
+    // The areas where transformed windows have been painted in the last frame, per output
+    QMap<AbstractOutput *, QRegion> m_transformedAreas;
+    // The screen damage of a frame that is painted by paintGenericScreen()
+    QRegion m_genericScreenDamage;
+    OcclusionMap m_occlusionMap;
+    // The windows that were completely covered in the last frame, per output
+    QHash<AbstractOutput *, QSet<Toplevel *>> m_occludedWindows;
+    // The render loop of the frame that is being currently painted
+    RenderLoop *m_renderLoop = nullptr;
     QRect m_geometry;
     // how many times finalPaintScreen() has been called
     int m_paintScreenCount = 0;
@@ -321,6 +364,11 @@ public:
     WindowItem *windowItem() const;
     SurfaceItem *surfaceItem() const;
     ShadowItem *shadowItem() const;
+    /**
+     * Returns @c true if the window, including its decoration and shadow, intersects the
+     * specified @a output.
+     */
+    bool isVisibleOnOutput(const AbstractOutput *output) const;
 
 protected:
     Toplevel* toplevel;
@@ -332,6 +380,7 @@ private:
 
     int disable_painting;
     QScopedPointer<WindowItem> m_windowItem;
+    mutable std::optional<QRect> m_visibleGeometry;
     Q_DISABLE_COPY(Window)
 };
 
@@ -42,6 +42,7 @@ LanczosFilter::~LanczosFilter()
 {
     delete m_offscreenTarget;
     delete m_offscreenTex;
+    qDeleteAll(m_texturePool);
 }
 
 void LanczosFilter::init()
@@ -103,6 +104,33 @@ void LanczosFilter::updateOffscreenSurfaces()
     }
 }
 
+GLTexture *LanczosFilter::acquireTexture(int width, int height)
+{
+    for (int i = m_texturePool.count() - 1; i >= 0; --i) {
+        GLTexture *texture = m_texturePool[i];
+        if (texture->width() == width && texture->height() == height) {
+            m_texturePool.removeAt(i);
+            return texture;
+        }
+    }
+
+    GLTexture *texture = new GLTexture(GL_RGBA8, width, height);
+    texture->setFilter(GL_LINEAR);
+    texture->setWrapMode(GL_CLAMP_TO_EDGE);
+    return texture;
+}
+
+void LanczosFilter::releaseTexture(GLTexture *texture)
+{
+    // Windows in present windows or the desktop grid are scaled to the same few sizes,
+    // so the textures of one window are often good for the next one.
+    static const int maxPooledTextures = 8;
+    if (m_texturePool.count() >= maxPooledTextures) {
+        delete m_texturePool.takeFirst();
+    }
+    m_texturePool.append(texture);
+}
+
 static float sinc(float x)
 {
     return std::sin(x * M_PI) / (x * M_PI);
@@ -161,7 +189,10 @@ void LanczosFilter::createOffsets(int count, float width, Qt::Orientation direct
 
 void LanczosFilter::performPaint(EffectWindowImpl* w, int mask, QRegion region, WindowPaintData& data)
 {
-    if (data.xScale() < 0.9 || data.yScale() < 0.9) {
+    // Under load, scaled windows are only sampled bilinearly.
+    const EffectScreen *screen = w->screen();
+    const bool lowQuality = screen && screen->renderQuality() == EffectScreen::RenderQuality::Low;
+    if ((data.xScale() < 0.9 || data.yScale() < 0.9) && !lowQuality) {
         if (!m_inited)
             init();
         const QRect screenRect = Workspace::self()->clientArea(ScreenArea, w->window());
@@ -216,8 +247,8 @@ void LanczosFilter::performPaint(EffectWindowImpl* w, int mask, QRegion region,
                     m_timer.start(5000, this);
                     return;
                 } else {
-                    // offscreen texture not matching - delete
-                    delete cachedTexture;
+                    // offscreen texture not matching - give it to a window that needs this size
+                    releaseTexture(cachedTexture);
                     cachedTexture = nullptr;
                     w->setData(LanczosCacheRole, QVariant());
                 }
@@ -244,11 +275,9 @@ void LanczosFilter::performPaint(EffectWindowImpl* w, int mask, QRegion region,
             glClear(GL_COLOR_BUFFER_BIT);
             w->sceneWindow()->performPaint(mask, infiniteRegion(), thumbData);
 
-            // Create a scratch texture and copy the rendered window into it
-            GLTexture tex(GL_RGBA8, sw, sh);
-            tex.setFilter(GL_LINEAR);
-            tex.setWrapMode(GL_CLAMP_TO_EDGE);
-            tex.bind();
+            // Get a scratch texture and copy the rendered window into it
+            GLTexture *tex = acquireTexture(sw, sh);
+            tex->bind();
 
             glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, m_offscreenTex->height() - sh, sw, sh);
 
@@ -281,14 +310,12 @@ void LanczosFilter::performPaint(EffectWindowImpl* w, int mask, QRegion region,
             vbo->render(GL_TRIANGLES);
 
             // At this point we don't need the scratch texture anymore
-            tex.unbind();
-            tex.discard();
+            tex->unbind();
+            releaseTexture(tex);
 
-            // create scratch texture for second rendering pass
-            GLTexture tex2(GL_RGBA8, tw, sh);
-            tex2.setFilter(GL_LINEAR);
-            tex2.setWrapMode(GL_CLAMP_TO_EDGE);
-            tex2.bind();
+            // get a scratch texture for second rendering pass
+            GLTexture *tex2 = acquireTexture(tw, sh);
+            tex2->bind();
 
             glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, m_offscreenTex->height() - sh, tw, sh);
 
@@ -313,15 +340,12 @@ void LanczosFilter::performPaint(EffectWindowImpl* w, int mask, QRegion region,
             vbo->setData(6, 2, verts.constData(), texCoords.constData());
             vbo->render(GL_TRIANGLES);
 
-            tex2.unbind();
-            tex2.discard();
+            tex2->unbind();
+            releaseTexture(tex2);
             ShaderManager::instance()->popShader();
 
-            // create cache texture
-            GLTexture *cache = new GLTexture(GL_RGBA8, tw, th);
-
-            cache->setFilter(GL_LINEAR);
-            cache->setWrapMode(GL_CLAMP_TO_EDGE);
+            // get cache texture
+            GLTexture *cache = acquireTexture(tw, th);
             cache->bind();
             glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, m_offscreenTex->height() - th, tw, th);
             GLRenderTarget::popRenderTarget();
@@ -382,6 +406,9 @@ void LanczosFilter::timerEvent(QTimerEvent *event)
         m_offscreenTarget = nullptr;
         m_offscreenTex = nullptr;
 
+        qDeleteAll(m_texturePool);
+        m_texturePool.clear();
+
         workspace()->forEachToplevel([this](Toplevel *toplevel) {
             discardCacheTexture(toplevel->effectWindow());
         });
@@ -404,7 +431,8 @@ void LanczosFilter::safeDiscardCacheTexture(EffectWindow *w)
     QVariant cachedTextureVariant = w->data(LanczosCacheRole);
     if (cachedTextureVariant.isValid()) {
         m_scene->makeOpenGLContextCurrent();
-        delete static_cast< GLTexture*>(cachedTextureVariant.value<void*>());
+        // the window is likely to be filtered again at the same size in the next frame
+        releaseTexture(static_cast< GLTexture*>(cachedTextureVariant.value<void*>()));
         w->setData(LanczosCacheRole, QVariant());
     }
 }
@@ -46,11 +46,20 @@ private:
     void setUniforms();
     void discardCacheTexture(EffectWindow *w);
     void safeDiscardCacheTexture(EffectWindow *w);
+    /**
+     * Returns a texture of the given size, from the pool if there is one.
+     */
+    GLTexture *acquireTexture(int width, int height);
+    /**
+     * Puts the @a texture into the pool, so it can be reused by other windows.
+     */
+    void releaseTexture(GLTexture *texture);
 
     void createKernel(float delta, int *kernelSize);
     void createOffsets(int count, float width, Qt::Orientation direction);
     GLTexture *m_offscreenTex;
     GLRenderTarget *m_offscreenTarget;
+    QVector<GLTexture *> m_texturePool;
     QBasicTimer m_timer;
     bool m_inited;
     QScopedPointer<GLShader> m_shader;
@@ -13,6 +13,7 @@
 */
 #include "scene_opengl.h"
 #include "openglsurfacetexture.h"
+#include "opengltexturebudget.h"
 
 #include "platform.h"
 #include "wayland_server.h"
@@ -30,17 +31,25 @@
 #include "renderloop.h"
 #include "cursor.h"
 #include "decorations/decoratedclient.h"
+#include "decorationitem.h"
 #include "shadowitem.h"
 #include "surfaceitem.h"
 #include "windowitem.h"
 #include "abstract_output.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
 
+#include <QGlyphRun>
 #include <QGraphicsScale>
 #include <QPainter>
+#include <QRawFont>
+#include <QSet>
 #include <QStringList>
+#include <QTextLayout>
+#include <QThreadPool>
+#include <QtConcurrentMap>
 #include <QVector2D>
 #include <QVector4D>
 #include <QMatrix4x4>
@@ -65,10 +74,29 @@ SceneOpenGL::SceneOpenGL(OpenGLBackend *backend, QObject *parent)
     }
 
     // It is not legal to not have a vertex array object bound in a core context
-    if (!GLPlatform::instance()->isGLES() && hasGLExtension(QByteArrayLiteral("GL_ARB_vertex_array_object"))) {
+    if (!GLPlatform::instance()->isGLES() && hasGLExtension(GLExtension::ARB_vertex_array_object)) {
         glGenVertexArrays(1, &vao);
         glBindVertexArray(vao);
     }
+
+    m_renderTimeQueriesSupported = GLRenderTimeQuery::supported();
+    m_depthPrepassEnabled = qEnvironmentVariableIntValue("KWIN_OPENGL_DEPTH_PREPASS");
+    m_threadedBatchingEnabled = qgetenv("KWIN_OPENGL_THREADED_BATCHING") != QByteArrayLiteral("0");
+
+    connect(kwinApp()->platform(), &Platform::outputDisabled, this, [this](AbstractOutput *output) {
+        m_overlayAreas.remove(output);
+        m_cursorLayers.remove(output);
+    });
+
+    // Build the shaders that are needed to paint windows now rather than in the middle of
+    // the first frames. With the program binary cache, this is merely a couple of file reads.
+    ShaderManager::instance()->warmUp({
+        ShaderTrait::MapTexture,
+        ShaderTrait::MapTexture | ShaderTrait::Modulate,
+        ShaderTrait::MapTexture | ShaderTrait::AdjustSaturation,
+        ShaderTrait::MapTexture | ShaderTrait::Modulate | ShaderTrait::AdjustSaturation,
+        ShaderTrait::UniformColor,
+    });
 }
 
 SceneOpenGL::~SceneOpenGL()
@@ -76,6 +104,8 @@ SceneOpenGL::~SceneOpenGL()
     if (init_ok) {
         makeOpenGLContextCurrent();
     }
+    m_renderTimeQueries.clear();
+    m_cursorLayers.clear();
     if (m_lanczosFilter) {
         delete m_lanczosFilter;
         m_lanczosFilter = nullptr;
@@ -152,6 +182,11 @@ void SceneOpenGL::paintCursor(AbstractOutput *output, const QRegion &rendered)
         }
     }
 
+    // keep what is underneath, so the cursor can be moved without painting the scene
+    const QRect cursorGeometry = cursorRect.translated(cursorPos) & output->geometry();
+    saveCursorBacking(output, cursorGeometry);
+    m_cursorLayers[output].lastCursorRect = cursorGeometry;
+
     // get cursor position in projection coordinates
     QMatrix4x4 mvp = m_projectionMatrix;
     mvp.translate(cursorPos.x(), cursorPos.y());
@@ -169,6 +204,104 @@ void SceneOpenGL::paintCursor(AbstractOutput *output, const QRegion &rendered)
     glDisable(GL_BLEND);
 }
 
+void SceneOpenGL::saveCursorBacking(AbstractOutput *output, const QRect &rect)
+{
+    if (!GLRenderTarget::blitSupported() || rect.isEmpty()) {
+        return;
+    }
+
+    QVector<CursorBacking> &backings = m_cursorLayers[output].backings;
+
+    // Recycle the copy of the same area or the oldest one, the copies of the last few
+    // cursor positions are needed to repair back buffers that are a few frames old.
+    CursorBacking backing;
+    auto it = std::find_if(backings.begin(), backings.end(), [&rect](const CursorBacking &other) {
+        return other.rect == rect;
+    });
+    if (it != backings.end()) {
+        backing = *it;
+        backings.erase(it);
+    } else if (backings.count() >= 4) {
+        backing = backings.takeFirst();
+    }
+
+    const QSize nativeSize = rect.size() * output->scale();
+    if (!backing.texture || backing.texture->size() != nativeSize) {
+        backing.texture.reset(new GLTexture(GL_RGBA8, nativeSize));
+        backing.renderTarget.reset(new GLRenderTarget(*backing.texture));
+    }
+    if (!backing.renderTarget->valid()) {
+        return;
+    }
+    backing.rect = rect;
+    backing.renderTarget->blitFromFramebuffer(rect);
+    backings.append(backing);
+}
+
+void SceneOpenGL::discardCursorBackings(AbstractOutput *output, const QRegion &region)
+{
+    auto it = m_cursorLayers.find(output);
+    if (it == m_cursorLayers.end()) {
+        return;
+    }
+    QVector<CursorBacking> &backings = it->backings;
+    backings.erase(std::remove_if(backings.begin(), backings.end(), [&region](const CursorBacking &backing) {
+        return region.intersects(backing.rect);
+    }), backings.end());
+}
+
+/**
+ * Paints a frame in which only the software cursor has changed. The back buffer is
+ * repaired with the saved copies of the scene under the previous cursor positions and
+ * the cursor is painted on top, the scene itself is not painted.
+ *
+ * Returns @c false if the stale parts of the back buffer can't be repaired this way.
+ */
+bool SceneOpenGL::paintCursorOnly(AbstractOutput *output, const QRegion &repaint, QRegion *update, QRegion *valid)
+{
+    Cursor *cursor = Cursors::self()->currentCursor();
+    if (Cursors::self()->isCursorHidden() || cursor->image().isNull()) {
+        return false;
+    }
+    auto it = m_cursorLayers.constFind(output);
+    if (it == m_cursorLayers.constEnd()) {
+        return false;
+    }
+
+    // The back buffer is stale in the repaint region, and it still shows the cursor
+    // where it was painted in the last frame.
+    const QRegion stale = (repaint | it->lastCursorRect) & output->geometry();
+    QRegion restorable;
+    for (const CursorBacking &backing : it->backings) {
+        restorable |= backing.rect;
+    }
+    if (!(stale - restorable).isEmpty()) {
+        return false;
+    }
+
+    QRegion restored;
+    ShaderBinder binder(ShaderTrait::MapTexture);
+    for (const CursorBacking &backing : it->backings) {
+        if (!stale.intersects(backing.rect)) {
+            continue;
+        }
+        QMatrix4x4 mvp = m_projectionMatrix;
+        mvp.translate(backing.rect.x(), backing.rect.y());
+        binder.shader()->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
+
+        const QRect rect(QPoint(0, 0), backing.rect.size());
+        backing.texture->bind();
+        backing.texture->render(rect, rect);
+        backing.texture->unbind();
+        restored |= backing.rect;
+    }
+
+    *valid = restored | (cursor->geometry() & output->geometry());
+    *update = *valid;
+    paintCursor(output, *valid);
+    return true;
+}
+
 void SceneOpenGL::aboutToStartPainting(AbstractOutput *output, const QRegion &damage)
 {
     m_backend->aboutToStartPainting(output, damage);
@@ -184,6 +317,34 @@ static SurfaceItem *findTopMostSurface(SurfaceItem *item)
     }
 }
 
+/**
+ * Returns the surface of @a window if the window can be shown on an overlay plane, that is
+ * if it consists of a single untransformed and fully opaque client surface inside the @a output.
+ */
+static SurfaceItem *findOverlaySurface(Scene::Window *window, AbstractOutput *output)
+{
+    const WindowItem *windowItem = window->windowItem();
+    SurfaceItem *surfaceItem = window->surfaceItem();
+    if (!surfaceItem || !surfaceItem->childItems().isEmpty() || window->window()->opacity() != 1.0) {
+        return nullptr;
+    }
+    if ((windowItem->decorationItem() && windowItem->decorationItem()->isVisible())
+        || (windowItem->shadowItem() && windowItem->shadowItem()->isVisible())) {
+        return nullptr;
+    }
+    if (!windowItem->transform().isIdentity() || !surfaceItem->transform().isIdentity()) {
+        return nullptr;
+    }
+    if (!output->geometry().contains(surfaceItem->mapToGlobal(surfaceItem->rect()))) {
+        return nullptr;
+    }
+    // the area underneath is not painted, nothing may show through the overlay
+    if (!window->isOpaque() && !surfaceItem->opaque().contains(surfaceItem->rect())) {
+        return nullptr;
+    }
+    return surfaceItem;
+}
+
 void SceneOpenGL::paint(AbstractOutput *output, const QRegion &damage, const QList<Toplevel *> &toplevels,
                         RenderLoop *renderLoop)
 {
@@ -205,14 +366,29 @@ void SceneOpenGL::paint(AbstractOutput *output, const QRegion &damage, const QLi
     }
 
     renderLoop->beginFrame();
+    GLStateTracker::instance()->beginFrame();
+
+    const bool scanoutAllowed = output && m_backend->directScanoutAllowed(output)
+        && !static_cast<EffectsHandlerImpl*>(effects)->blocksDirectScanout();
 
     SurfaceItem *fullscreenSurface = nullptr;
+    Window *overlayWindow = nullptr;
+    SurfaceItem *overlaySurface = nullptr;
     for (int i = stacking_order.count() - 1; i >=0; i--) {
         Window *window = stacking_order[i];
         Toplevel *toplevel = window->window();
         if (output && toplevel->isOnOutput(output) && window->isVisible() && toplevel->opacity() > 0) {
             AbstractClient *c = dynamic_cast<AbstractClient*>(toplevel);
             if (!c || !c->isFullScreen()) {
+                // the topmost window may go onto an overlay plane, keep looking for a
+                // fullscreen window below it
+                if (!overlayWindow && scanoutAllowed) {
+                    overlaySurface = findOverlaySurface(window, output);
+                    if (overlaySurface) {
+                        overlayWindow = window;
+                        continue;
+                    }
+                }
                 break;
             }
             if (!window->surfaceItem()) {
@@ -238,8 +414,29 @@ void SceneOpenGL::paint(AbstractOutput *output, const QRegion &damage, const QLi
     }
     renderLoop->setFullscreenSurface(fullscreenSurface);
 
+    // The window on the overlay plane is left out of the composited frame. The primary
+    // plane has stale contents where the overlay plane was, they are exposed if it moves
+    // or goes away.
+    QRegion paintDamage = damage;
+    bool overlayChanged = false;
+    if (output) {
+        QRect overlayArea;
+        if (m_backend->scanoutOverlay(output, overlaySurface)) {
+            overlayArea = overlaySurface->mapToGlobal(overlaySurface->rect());
+            overlayWindow->windowItem()->resetRepaintsRecursive(output);
+            stacking_order.removeOne(overlayWindow);
+        }
+        QRect &previousOverlayArea = m_overlayAreas[output];
+        if (previousOverlayArea != overlayArea) {
+            paintDamage |= previousOverlayArea;
+            previousOverlayArea = overlayArea;
+            overlayChanged = true;
+        }
+        paintDamage -= overlayArea;
+    }
+
     bool directScanout = false;
-    if (m_backend->directScanoutAllowed(output) && !static_cast<EffectsHandlerImpl*>(effects)->blocksDirectScanout()) {
+    if (scanoutAllowed) {
         directScanout = m_backend->scanout(output, fullscreenSurface);
     }
     if (directScanout) {
@@ -249,6 +446,11 @@ void SceneOpenGL::paint(AbstractOutput *output, const QRegion &damage, const QLi
         repaint = m_backend->beginFrame(output);
         GLVertexBuffer::streamingBuffer()->beginFrame();
 
+        GLRenderTimeQuery *timeQuery = renderTimeQuery(renderLoop);
+        if (timeQuery) {
+            timeQuery->begin(renderLoop->frameSequence());
+        }
+
         GLVertexBuffer::setVirtualScreenGeometry(geo);
         GLRenderTarget::setVirtualScreenGeometry(geo);
         GLVertexBuffer::setVirtualScreenScale(scaling);
@@ -256,20 +458,67 @@ void SceneOpenGL::paint(AbstractOutput *output, const QRegion &damage, const QLi
 
         updateProjectionMatrix(geo);
 
-        paintScreen(damage.intersected(geo), repaint, &update, &valid,
-                    renderLoop, projectionMatrix());   // call generic implementation
-        paintCursor(output, valid);
+        // Pointer motion alone doesn't need the scene to be painted again, the cursor
+        // is composited over the contents of the last frame instead.
+        const bool cursorOnly = output && output->usesSoftwareCursor() && hasOnlyCursorRepaints(output)
+            && !overlayChanged && !static_cast<EffectsHandlerImpl *>(effects)->blocksDirectScanout();
+        if (!cursorOnly || !paintCursorOnly(output, repaint, &update, &valid)) {
+            paintScreen(paintDamage.intersected(geo), repaint, &update, &valid,
+                        renderLoop, projectionMatrix());   // call generic implementation
+            if (output && !cursorOnly) {
+                discardCursorBackings(output, valid);
+            }
+            paintCursor(output, valid);
+        }
 
-        renderLoop->endFrame();
+        if (timeQuery) {
+            timeQuery->end();
+        } else {
+            renderLoop->endFrame();
+        }
+        renderLoop->recordFrameStage(RenderLoop::FrameStage::Submission);
 
         GLVertexBuffer::streamingBuffer()->endOfFrame();
         m_backend->endFrame(output, valid, update);
+        renderLoop->recordFrameStage(RenderLoop::FrameStage::EndFrame);
+
+        OpenGLTextureBudget::self()->evict();
     }
 
     // do cleanup
     clearStackingOrder();
 }
 
+GLRenderTimeQuery *SceneOpenGL::renderTimeQuery(RenderLoop *renderLoop)
+{
+    if (!m_renderTimeQueriesSupported) {
+        return nullptr;
+    }
+
+    QSharedPointer<GLRenderTimeQuery> &query = m_renderTimeQueries[renderLoop];
+    if (!query) {
+        query.reset(new GLRenderTimeQuery());
+        connect(renderLoop, &QObject::destroyed, this, [this, renderLoop]() {
+            m_renderTimeQueries.remove(renderLoop);
+        });
+    }
+
+    // Feed the render time of the previous frame back into the render journal. If the
+    // GPU hasn't finished rendering that frame yet, fall back to measuring the CPU time
+    // for the current frame rather than stalling on the query.
+    if (query->isPending()) {
+        const std::chrono::nanoseconds renderTime = query->result();
+        if (renderTime < std::chrono::nanoseconds::zero()) {
+            return nullptr;
+        }
+        // The query may belong to an older frame than the previous one, e.g. if the
+        // previous frame was scanned out directly or its result wasn't ready in time.
+        renderLoop->addRenderTime(renderTime, query->sequence());
+    }
+
+    return query.data();
+}
+
 QMatrix4x4 SceneOpenGL::transformation(int mask, const ScreenPaintData &data) const
 {
     QMatrix4x4 matrix;
@@ -294,24 +543,29 @@ QMatrix4x4 SceneOpenGL::transformation(int mask, const ScreenPaintData &data) co
     return matrix;
 }
 
+static QVector<float> regionVertices(const QRegion &region)
+{
+    QVector<float> verts;
+    verts.reserve(region.rectCount() * 6 * 2);
+
+    for (const QRect &r : region) {
+        verts << r.x() + r.width() << r.y();
+        verts << r.x() << r.y();
+        verts << r.x() << r.y() + r.height();
+        verts << r.x() << r.y() + r.height();
+        verts << r.x() + r.width() << r.y() + r.height();
+        verts << r.x() + r.width() << r.y();
+    }
+    return verts;
+}
+
 void SceneOpenGL::paintBackground(const QRegion &region)
 {
     if (region == infiniteRegion()) {
         glClearColor(0, 0, 0, 1);
         glClear(GL_COLOR_BUFFER_BIT);
     } else if (!region.isEmpty()) {
-        QVector<float> verts;
-        verts.reserve(region.rectCount() * 6 * 2);
-
-        for (const QRect &r : region) {
-            verts << r.x() + r.width() << r.y();
-            verts << r.x() << r.y();
-            verts << r.x() << r.y() + r.height();
-            verts << r.x() << r.y() + r.height();
-            verts << r.x() + r.width() << r.y() + r.height();
-            verts << r.x() + r.width() << r.y();
-        }
-        doPaintBackground(verts);
+        doPaintBackground(regionVertices(region));
     }
 }
 
@@ -346,10 +600,11 @@ void SceneOpenGL::extendPaintRegion(QRegion &region, bool opaqueFullscreen)
 void SceneOpenGL::paintDesktop(int desktop, int mask, const QRegion &region, ScreenPaintData &data)
 {
     const QRect r = region.boundingRect();
-    glEnable(GL_SCISSOR_TEST);
-    glScissor(r.x(), geometry().size().height() - r.y() - r.height(), r.width(), r.height());
+    GLStateTracker *stateTracker = GLStateTracker::instance();
+    stateTracker->setScissorTestEnabled(true);
+    stateTracker->setScissor(r.x(), geometry().size().height() - r.y() - r.height(), r.width(), r.height());
     KWin::Scene::paintDesktop(desktop, mask, region, data);
-    glDisable(GL_SCISSOR_TEST);
+    stateTracker->setScissorTestEnabled(false);
 }
 
 void SceneOpenGL::paintOffscreenQuickView(OffscreenQuickView *w)
@@ -470,6 +725,240 @@ void SceneOpenGL::paintSimpleScreen(int mask, const QRegion &region)
     Scene::paintSimpleScreen(mask, region);
 }
 
+static const GLVertexAttrib s_windowVertexAttribs[] = {
+    { VA_Position, 2, GL_FLOAT, offsetof(GLVertex2D, position) },
+    { VA_TexCoord, 2, GL_FLOAT, offsetof(GLVertex2D, texcoord) },
+};
+
+GLVertexBuffer *SceneOpenGL::windowBatchBuffer() const
+{
+    return m_windowBatchBuffer.data();
+}
+
+// Returns the size of the depth buffer (GL_DEPTH) or stencil buffer (GL_STENCIL) of the
+// bound framebuffer.
+static int framebufferBits(GLenum buffer)
+{
+    const bool depth = buffer == GL_DEPTH;
+    if (!hasGLVersion(3, 0)) {
+        GLint bits = 0;
+        glGetIntegerv(depth ? GL_DEPTH_BITS : GL_STENCIL_BITS, &bits);
+        return bits;
+    }
+
+    // GL_DEPTH_BITS and GL_STENCIL_BITS are not available in core profiles.
+    GLint framebuffer = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+    GLenum attachment = buffer;
+    if (framebuffer) {
+        attachment = depth ? GL_DEPTH_ATTACHMENT : GL_STENCIL_ATTACHMENT;
+    }
+
+    GLint type = GL_NONE;
+    glGetFramebufferAttachmentParameteriv(GL_DRAW_FRAMEBUFFER, attachment, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &type);
+    if (type == GL_NONE) {
+        return 0;
+    }
+    GLint bits = 0;
+    glGetFramebufferAttachmentParameteriv(GL_DRAW_FRAMEBUFFER, attachment,
+                                          depth ? GL_FRAMEBUFFER_ATTACHMENT_DEPTH_SIZE : GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE, &bits);
+    return bits;
+}
+
+static void setDepthRange(qreal nearValue, qreal farValue)
+{
+    if (GLPlatform::instance()->isGLES()) {
+        glDepthRangef(nearValue, farValue);
+    } else {
+        glDepthRange(nearValue, farValue);
+    }
+}
+
+bool SceneOpenGL::writeStencilClip(const QRegion &region)
+{
+    if (!framebufferBits(GL_STENCIL)) {
+        return false;
+    }
+
+    GLStateTracker *stateTracker = GLStateTracker::instance();
+    stateTracker->setScissorTestEnabled(false);
+    stateTracker->setBlendEnabled(false);
+
+    glClearStencil(0);
+    glClear(GL_STENCIL_BUFFER_BIT);
+
+    glEnable(GL_STENCIL_TEST);
+    glStencilFunc(GL_ALWAYS, 1, 0xff);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+    doPaintBackground(regionVertices(region));
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glStencilFunc(GL_EQUAL, 1, 0xff);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+
+    // Windows enable the stencil test while they are painted with the stencil clip.
+    glDisable(GL_STENCIL_TEST);
+    return true;
+}
+
+void SceneOpenGL::beginPaintWindows(const QVector<Phase2Data> &windows)
+{
+    if (windows.isEmpty()) {
+        return;
+    }
+
+    // Scene::paintWindow() clips the region to the scene geometry, the windows must be
+    // prepared with the same region to be painted with the prepared state.
+    QVector<QRegion> regions;
+    regions.reserve(windows.count());
+    for (const Phase2Data &data : windows) {
+        regions.append(data.region & geometry());
+    }
+
+    // The painted regions of the windows grow from bottom to top, the top-most window is
+    // painted with the union of all of them. If that region is too complex to be clipped
+    // with a few scissor rects, rasterize it into the stencil buffer once and draw the
+    // windows with whole quads, rather than splitting them against every rect.
+    const QRegion &clip = regions.last();
+    if (clip.rectCount() > OpenGLWindow::maxScissorClipRects && writeStencilClip(clip)) {
+        for (int i = 0; i < windows.count(); ++i) {
+            static_cast<OpenGLWindow *>(windows[i].window)->setStencilClipRegion(regions[i]);
+        }
+    }
+
+    // Collect the render nodes of all windows up front so their vertices can be uploaded
+    // with a single buffer mapping instead of one mapping per window. The item trees are
+    // walked here, but clipping the quads and generating the vertices only touches the
+    // collected render nodes and is spread across the worker threads.
+    int totalQuadCount = 0;
+    for (int i = 0; i < windows.count(); ++i) {
+        OpenGLWindow *window = static_cast<OpenGLWindow *>(windows[i].window);
+        if (window->isBatchingSkipped()) {
+            continue;
+        }
+        // Windows that are painted with their vertex cache need no space in the buffer.
+        const int quadCount = window->prepareBatch(windows[i].mask, regions[i]);
+        m_batchedWindows.append(qMakePair(window, quadCount));
+        totalQuadCount += quadCount;
+    }
+
+    int totalVertexCount = 0;
+    if (totalQuadCount) {
+        forEachBatchedWindow(totalQuadCount, [](QPair<OpenGLWindow *, int> &entry) {
+            if (entry.second) {
+                entry.second = entry.first->clipBatch();
+            }
+        });
+        for (const auto &[window, count] : qAsConst(m_batchedWindows)) {
+            totalVertexCount += count;
+        }
+    }
+
+    if (totalVertexCount) {
+        if (!m_windowBatchBuffer) {
+            m_windowBatchBuffer.reset(new GLVertexBuffer(GLVertexBuffer::Stream));
+            m_windowBatchBuffer->setAttribLayout(s_windowVertexAttribs, 2, sizeof(GLVertex2D));
+        }
+
+        GLVertex2D *map = (GLVertex2D *) m_windowBatchBuffer->map(totalVertexCount * sizeof(GLVertex2D));
+        // Every window writes to a range of the buffer of its own.
+        QVector<int> firstVertices;
+        firstVertices.reserve(m_batchedWindows.count());
+        int firstVertex = 0;
+        for (const auto &[window, count] : qAsConst(m_batchedWindows)) {
+            firstVertices.append(firstVertex);
+            firstVertex += count;
+        }
+        const QPair<OpenGLWindow *, int> *first = m_batchedWindows.constData();
+        forEachBatchedWindow(totalQuadCount, [map, first, &firstVertices](QPair<OpenGLWindow *, int> &entry) {
+            if (entry.second) {
+                const int offset = firstVertices[&entry - first];
+                entry.first->uploadBatch(map + offset, offset);
+            }
+        });
+        m_windowBatchBuffer->unmap();
+    }
+
+    m_depthPrepassActive = beginDepthPrepass(windows);
+}
+
+template <typename Function>
+void SceneOpenGL::forEachBatchedWindow(int quadCount, Function function)
+{
+    // Handing the work over to the thread pool only pays off for many windows or a lot
+    // of quads, e.g. windows with hundreds of subsurfaces.
+    static constexpr int minimumThreadedQuadCount = 512;
+    if (m_threadedBatchingEnabled && m_batchedWindows.count() > 1
+            && quadCount >= minimumThreadedQuadCount && QThreadPool::globalInstance()->maxThreadCount() > 1) {
+        QtConcurrent::blockingMap(m_batchedWindows, function);
+    } else {
+        std::for_each(m_batchedWindows.begin(), m_batchedWindows.end(), function);
+    }
+}
+
+bool SceneOpenGL::beginDepthPrepass(const QVector<Phase2Data> &windows)
+{
+    if (!m_depthPrepassEnabled || !framebufferBits(GL_DEPTH)) {
+        return false;
+    }
+
+    // Every window gets a depth of its own, from far at the bottom to near at the top. The
+    // depth test stays enabled while the windows are painted, so whatever is drawn for a
+    // window, including by effects, is hidden behind the opaque windows above it.
+    for (int i = 0; i < windows.count(); ++i) {
+        static_cast<OpenGLWindow *>(windows[i].window)->setDepth(1.0 - (i + 1.0) / (windows.count() + 1.0));
+    }
+
+    GLStateTracker::instance()->setScissorTestEnabled(false);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LEQUAL);
+
+    // Draw the opaque parts of the prepared windows front to back, so the GPU can reject
+    // the fragments of the windows below them before shading.
+    glDepthMask(GL_TRUE);
+    for (int i = windows.count() - 1; i >= 0; --i) {
+        static_cast<OpenGLWindow *>(windows[i].window)->paintOpaquePass();
+    }
+    glDepthMask(GL_FALSE);
+
+    return true;
+}
+
+void SceneOpenGL::paintWindow(Window *w, int mask, const QRegion &region)
+{
+    if (m_depthPrepassActive) {
+        if (const std::optional<qreal> depth = static_cast<OpenGLWindow *>(w)->depth()) {
+            setDepthRange(*depth, *depth);
+        }
+    }
+    Scene::paintWindow(w, mask, region);
+}
+
+void SceneOpenGL::endPaintWindows()
+{
+    for (const auto &entry : qAsConst(m_batchedWindows)) {
+        entry.first->resetBatch();
+    }
+    m_batchedWindows.clear();
+
+    if (m_depthPrepassActive) {
+        glDisable(GL_DEPTH_TEST);
+        glDepthMask(GL_TRUE);
+        setDepthRange(0, 1);
+        m_depthPrepassActive = false;
+    }
+
+    // The stencil and depth buffers will be overwritten by the next frame.
+    for (Window *window : qAsConst(stacking_order)) {
+        OpenGLWindow *openGLWindow = static_cast<OpenGLWindow *>(window);
+        openGLWindow->setStencilClipRegion(QRegion());
+        openGLWindow->setDepth(std::nullopt);
+    }
+}
+
 void SceneOpenGL::paintGenericScreen(int mask, const ScreenPaintData &data)
 {
     const QMatrix4x4 screenMatrix = transformation(mask, data);
@@ -516,6 +1005,68 @@ void SceneOpenGL::performPaintWindow(EffectWindowImpl* w, int mask, const QRegio
         w->sceneWindow()->performPaint(mask, region, data);
 }
 
+//****************************************
+// GLRenderTimeQuery
+//****************************************
+
+GLRenderTimeQuery::GLRenderTimeQuery()
+{
+    glGenQueries(1, &m_query);
+}
+
+GLRenderTimeQuery::~GLRenderTimeQuery()
+{
+    glDeleteQueries(1, &m_query);
+}
+
+bool GLRenderTimeQuery::supported()
+{
+    if (qEnvironmentVariableIsSet("KWIN_NO_GL_TIMER_QUERY")) {
+        return false;
+    }
+    if (GLPlatform::instance()->isGLES()) {
+        return false;
+    }
+    return hasGLVersion(3, 3) || hasGLExtension(GLExtension::ARB_timer_query);
+}
+
+void GLRenderTimeQuery::begin(quint64 sequence)
+{
+    glGetInteger64v(GL_TIMESTAMP, &m_startTimestamp);
+    m_sequence = sequence;
+}
+
+void GLRenderTimeQuery::end()
+{
+    glQueryCounter(m_query, GL_TIMESTAMP);
+    m_pending = true;
+}
+
+bool GLRenderTimeQuery::isPending() const
+{
+    return m_pending;
+}
+
+quint64 GLRenderTimeQuery::sequence() const
+{
+    return m_sequence;
+}
+
+std::chrono::nanoseconds GLRenderTimeQuery::result()
+{
+    GLint available = GL_FALSE;
+    glGetQueryObjectiv(m_query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        return std::chrono::nanoseconds(-1);
+    }
+
+    GLuint64 endTimestamp = 0;
+    glGetQueryObjectui64v(m_query, GL_QUERY_RESULT, &endTimestamp);
+    m_pending = false;
+
+    return std::chrono::nanoseconds(std::max<GLint64>(0, GLint64(endTimestamp) - m_startTimestamp));
+}
+
 //****************************************
 // OpenGLWindow
 //****************************************
@@ -528,6 +1079,10 @@ OpenGLWindow::OpenGLWindow(Toplevel *toplevel, SceneOpenGL *scene)
 
 OpenGLWindow::~OpenGLWindow()
 {
+    if (m_vertexCache.vertexBuffer) {
+        m_scene->makeOpenGLContextCurrent();
+        m_vertexCache.vertexBuffer.reset();
+    }
 }
 
 QVector4D OpenGLWindow::modulate(float opacity, float brightness) const
@@ -538,22 +1093,24 @@ QVector4D OpenGLWindow::modulate(float opacity, float brightness) const
     return QVector4D(rgb, rgb, rgb, a);
 }
 
-void OpenGLWindow::setBlendEnabled(bool enabled)
-{
-    if (enabled && !m_blendingEnabled)
-        glEnable(GL_BLEND);
-    else if (!enabled && m_blendingEnabled)
-        glDisable(GL_BLEND);
-
-    m_blendingEnabled = enabled;
-}
-
-static GLTexture *bindSurfaceTexture(SurfaceItem *surfaceItem)
+static GLTexture *bindSurfaceTexture(SurfaceItem *surfaceItem, bool mipmaps)
 {
     SurfacePixmap *surfacePixmap = surfaceItem->pixmap();
     auto platformSurfaceTexture =
             static_cast<OpenGLSurfaceTexture *>(surfacePixmap->texture());
     if (surfacePixmap->isDiscarded()) {
+        // The texture may have been evicted, the pixmap still holds on to the contents.
+        if (!platformSurfaceTexture->texture() && platformSurfaceTexture->isEvictable()) {
+            if (!surfacePixmap->isValid() || !platformSurfaceTexture->create()) {
+                return nullptr;
+            }
+        }
+        OpenGLTextureBudget::self()->markUsed(platformSurfaceTexture);
+        if (mipmaps) {
+            if (GLTexture *texture = platformSurfaceTexture->mipmappedTexture()) {
+                return texture;
+            }
+        }
         return platformSurfaceTexture->texture();
     }
 
@@ -561,6 +1118,7 @@ static GLTexture *bindSurfaceTexture(SurfaceItem *surfaceItem)
         const QRegion region = surfaceItem->damage();
         if (!region.isEmpty()) {
             platformSurfaceTexture->update(region);
+            platformSurfaceTexture->markContentsChanged();
             surfaceItem->resetDamage();
         }
     } else {
@@ -571,41 +1129,55 @@ static GLTexture *bindSurfaceTexture(SurfaceItem *surfaceItem)
             qCDebug(KWIN_OPENGL) << "Failed to bind window";
             return nullptr;
         }
+        platformSurfaceTexture->markContentsChanged();
         surfaceItem->resetDamage();
     }
 
+    OpenGLTextureBudget::self()->markUsed(platformSurfaceTexture);
+    if (mipmaps) {
+        // The mip levels are only regenerated if the contents have changed.
+        if (GLTexture *texture = platformSurfaceTexture->mipmappedTexture()) {
+            return texture;
+        }
+    }
     return platformSurfaceTexture->texture();
 }
 
-static WindowQuadList clipQuads(const Item *item, const OpenGLWindow::RenderContext *context)
+static WindowQuadList clipQuads(const WindowQuadList &quads, const QMatrix4x4 &transform, const QRegion &clip)
 {
-    const WindowQuadList quads = item->quads();
-    if (context->clip != infiniteRegion() && !context->hardwareClipping) {
-        const QPoint offset = context->transforms.top().map(QPoint(0, 0));
+    const QPoint offset = transform.map(QPoint(0, 0));
 
-        WindowQuadList ret;
-        ret.reserve(quads.count());
+    WindowQuadList ret;
+    ret.reserve(quads.count());
 
-        // split all quads in bounding rect with the actual rects in the region
-        for (const WindowQuad &quad : qAsConst(quads)) {
-            for (const QRect &r : qAsConst(context->clip)) {
-                const QRectF rf(r.translated(-offset));
-                const QRectF quadRect(QPointF(quad.left(), quad.top()), QPointF(quad.right(), quad.bottom()));
-                const QRectF &intersected = rf.intersected(quadRect);
-                if (intersected.isValid()) {
-                    if (quadRect == intersected) {
-                        // case 1: completely contains, include and do not check other rects
-                        ret << quad;
-                        break;
-                    }
-                    // case 2: intersection
-                    ret << quad.makeSubQuad(intersected.left(), intersected.top(), intersected.right(), intersected.bottom());
+    // split all quads in bounding rect with the actual rects in the region
+    for (const WindowQuad &quad : qAsConst(quads)) {
+        for (const QRect &r : qAsConst(clip)) {
+            const QRectF rf(r.translated(-offset));
+            const QRectF quadRect(QPointF(quad.left(), quad.top()), QPointF(quad.right(), quad.bottom()));
+            const QRectF &intersected = rf.intersected(quadRect);
+            if (intersected.isValid()) {
+                if (quadRect == intersected) {
+                    // case 1: completely contains, include and do not check other rects
+                    ret << quad;
+                    break;
                 }
+                // case 2: intersection
+                ret << quad.makeSubQuad(intersected.left(), intersected.top(), intersected.right(), intersected.bottom());
             }
         }
-        return ret;
     }
-    return quads;
+    return ret;
+}
+
+static void clipRenderNodes(QVector<OpenGLWindow::RenderNode> &renderNodes, const OpenGLWindow::RenderContext *context)
+{
+    if (context->clipMode != OpenGLWindow::ClipMode::Software) {
+        return;
+    }
+    for (OpenGLWindow::RenderNode &renderNode : renderNodes) {
+        renderNode.quads = clipQuads(renderNode.quads, renderNode.transformMatrix, context->clip);
+    }
 }
 
 void OpenGLWindow::createRenderNode(Item *item, RenderContext *context)
@@ -628,109 +1200,446 @@ void OpenGLWindow::createRenderNode(Item *item, RenderContext *context)
 
     item->preprocess();
     if (auto shadowItem = qobject_cast<ShadowItem *>(item)) {
-        WindowQuadList quads = clipQuads(item, context);
+        const WindowQuadList quads = item->quads();
         if (!quads.isEmpty()) {
             SceneOpenGLShadow *shadow = static_cast<SceneOpenGLShadow *>(shadowItem->shadow());
             context->renderNodes.append(RenderNode{
                 .texture = shadow->shadowTexture(),
                 .quads = quads,
                 .transformMatrix = context->transforms.top(),
-                .opacity = context->paintData.opacity(),
+                .opacity = context->opacity,
                 .hasAlpha = true,
                 .coordinateType = UnnormalizedCoordinates,
             });
         }
     } else if (auto decorationItem = qobject_cast<DecorationItem *>(item)) {
-        WindowQuadList quads = clipQuads(item, context);
+        const WindowQuadList quads = item->quads();
         if (!quads.isEmpty()) {
             auto renderer = static_cast<const SceneOpenGLDecorationRenderer *>(decorationItem->renderer());
             context->renderNodes.append(RenderNode{
                 .texture = renderer->texture(),
                 .quads = quads,
                 .transformMatrix = context->transforms.top(),
-                .opacity = context->paintData.opacity(),
+                .opacity = context->opacity,
                 .hasAlpha = true,
                 .coordinateType = UnnormalizedCoordinates,
             });
         }
     } else if (auto surfaceItem = qobject_cast<SurfaceItem *>(item)) {
-        WindowQuadList quads = clipQuads(item, context);
+        const WindowQuadList quads = item->quads();
         if (!quads.isEmpty()) {
             SurfacePixmap *pixmap = surfaceItem->pixmap();
             if (pixmap) {
                 // Don't bother with blending if the entire surface is opaque
                 bool hasAlpha = pixmap->hasAlphaChannel() && !surfaceItem->shape().subtracted(surfaceItem->opaque()).isEmpty();
                 context->renderNodes.append(RenderNode{
-                    .texture = bindSurfaceTexture(surfaceItem),
+                    .texture = bindSurfaceTexture(surfaceItem, context->mipmaps),
                     .quads = quads,
                     .transformMatrix = context->transforms.top(),
-                    .opacity = context->paintData.opacity(),
+                    .opacity = context->opacity,
                     .hasAlpha = hasAlpha,
                     .coordinateType = UnnormalizedCoordinates,
+                    .filter = context->mipmaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR,
                 });
             }
         }
     }
 
-    for (Item *childItem : sortedChildItems) {
-        if (childItem->z() < 0) {
+    for (Item *childItem : sortedChildItems) {
+        if (childItem->z() < 0) {
+            continue;
+        }
+        if (childItem->isVisible()) {
+            createRenderNode(childItem, context);
+        }
+    }
+
+    context->transforms.pop();
+}
+
+QMatrix4x4 OpenGLWindow::modelViewProjectionMatrix(int mask, const WindowPaintData &data) const
+{
+    const QMatrix4x4 pMatrix = data.projectionMatrix();
+    const QMatrix4x4 mvMatrix = data.modelViewMatrix();
+
+    // An effect may want to override the default projection matrix in some cases,
+    // such as when it is rendering a window on a render target that doesn't have
+    // the same dimensions as the default framebuffer.
+    //
+    // Note that the screen transformation is not applied here.
+    if (!pMatrix.isIdentity())
+        return pMatrix * mvMatrix;
+
+    // If an effect has specified a model-view matrix, we multiply that matrix
+    // with the default projection matrix.  If the effect hasn't specified a
+    // model-view matrix, mvMatrix will be the identity matrix.
+    if (mask & Scene::PAINT_SCREEN_TRANSFORMED)
+        return m_scene->screenProjectionMatrix() * mvMatrix;
+
+    return m_scene->projectionMatrix() * mvMatrix;
+}
+
+static QMatrix4x4 transformForPaintData(int mask, const WindowPaintData &data)
+{
+    // TODO: Switch to QTransform.
+    QMatrix4x4 matrix;
+
+    if (!(mask & Scene::PAINT_WINDOW_TRANSFORMED)) {
+        return matrix;
+    }
+
+    matrix.translate(data.translation());
+    const QVector3D scale = data.scale();
+    matrix.scale(scale.x(), scale.y(), scale.z());
+
+    if (data.rotationAngle() == 0.0) {
+        return matrix;
+    }
+
+    // Apply the rotation
+    // cannot use data.rotation.applyTo(&matrix) as QGraphicsRotation uses projectedRotate to map back to 2D
+    matrix.translate(data.rotationOrigin());
+    const QVector3D axis = data.rotationAxis();
+    matrix.rotate(data.rotationAngle(), axis.x(), axis.y(), axis.z());
+    matrix.translate(-data.rotationOrigin());
+
+    return matrix;
+}
+
+static int verticesPerQuad()
+{
+    return GLVertexBuffer::supportsIndexedQuads() ? 4 : 6;
+}
+
+static GLenum primitiveType()
+{
+    return GLVertexBuffer::supportsIndexedQuads() ? GL_QUADS : GL_TRIANGLES;
+}
+
+static int vertexCount(const QVector<OpenGLWindow::RenderNode> &renderNodes)
+{
+    int quadCount = 0;
+    for (const OpenGLWindow::RenderNode &node : renderNodes) {
+        if (node.texture) {
+            quadCount += node.quads.count();
+        }
+    }
+    return quadCount * verticesPerQuad();
+}
+
+// Returns @c true if the matrix only translates 2D vertices in the xy plane.
+static bool isTranslation2D(const QMatrix4x4 &matrix)
+{
+    return matrix(0, 0) == 1 && matrix(0, 1) == 0
+        && matrix(1, 0) == 0 && matrix(1, 1) == 1
+        && matrix(2, 0) == 0 && matrix(2, 1) == 0 && matrix(2, 3) == 0
+        && matrix(3, 0) == 0 && matrix(3, 1) == 0 && matrix(3, 3) == 1;
+}
+
+static void writeVertices(QVector<OpenGLWindow::RenderNode> &renderNodes, GLVertex2D *map, int firstVertex)
+{
+    OpenGLWindow::RenderNode *previousNode = nullptr;
+
+    for (int i = 0, v = firstVertex; i < renderNodes.count(); i++) {
+        OpenGLWindow::RenderNode &renderNode = renderNodes[i];
+        if (renderNode.quads.isEmpty() || !renderNode.texture)
+            continue;
+
+        renderNode.firstVertex = v;
+        renderNode.vertexCount = renderNode.quads.count() * verticesPerQuad();
+
+        const QMatrix4x4 matrix = renderNode.texture->matrix(renderNode.coordinateType);
+
+        // Item offsets are baked into the vertices, so most nodes of a window share the
+        // same model-view-projection matrix.
+        QVector2D translation;
+        if (isTranslation2D(renderNode.transformMatrix)) {
+            translation = QVector2D(renderNode.transformMatrix(0, 3), renderNode.transformMatrix(1, 3));
+            renderNode.transformMatrix.setToIdentity();
+        }
+
+        renderNode.quads.makeInterleavedArrays(primitiveType(), &map[v - firstVertex], matrix, translation);
+        v += renderNode.vertexCount;
+
+        // Consecutive nodes that sample the same texture with the same state are drawn
+        // with a single draw call.
+        if (previousNode && previousNode->texture == renderNode.texture
+                && previousNode->hasAlpha == renderNode.hasAlpha
+                && previousNode->coordinateType == renderNode.coordinateType
+                && previousNode->transformMatrix == renderNode.transformMatrix) {
+            previousNode->vertexCount += renderNode.vertexCount;
+            renderNode.vertexCount = 0;
+        } else {
+            previousNode = &renderNode;
+        }
+    }
+}
+
+int OpenGLWindow::prepareBatch(int mask, const QRegion &region)
+{
+    m_batch.reset();
+    if (region.isEmpty() || (mask & (Scene::PAINT_WINDOW_TRANSFORMED | Scene::PAINT_WINDOW_LANCZOS))) {
+        return 0;
+    }
+
+    RenderContext renderContext {
+        .clip = region,
+        .opacity = 1.0,
+        .clipMode = clipMode(mask, region),
+    };
+
+    renderContext.transforms.push(QMatrix4x4());
+
+    windowItem()->setTransform(QMatrix4x4());
+
+    createRenderNode(windowItem(), &renderContext);
+
+    // The window will be painted with the vertices that it has uploaded in previous frames.
+    if (canUseVertexCache(renderContext.renderNodes, renderContext.clipMode)) {
+        if (vertexCount(renderContext.renderNodes)) {
+            if (!m_vertexCache.uploaded) {
+                uploadVertexCache();
+            }
+            m_batch = Batch{
+                .renderNodes = m_vertexCache.renderNodes,
+                .region = region,
+                .mask = mask,
+                .vertexBuffer = m_vertexCache.vertexBuffer.data(),
+            };
+        }
+        return 0;
+    }
+    updateVertexCache(renderContext.renderNodes);
+
+    const int count = vertexCount(renderContext.renderNodes);
+    if (!count) {
+        return 0;
+    }
+    m_batch = Batch{
+        .renderNodes = renderContext.renderNodes,
+        .region = region,
+        .mask = mask,
+        .clipMode = renderContext.clipMode,
+    };
+    return count / verticesPerQuad();
+}
+
+int OpenGLWindow::clipBatch()
+{
+    if (m_batch->clipMode == ClipMode::Software) {
+        for (RenderNode &renderNode : m_batch->renderNodes) {
+            renderNode.quads = clipQuads(renderNode.quads, renderNode.transformMatrix, m_batch->region);
+        }
+    }
+
+    const int count = vertexCount(m_batch->renderNodes);
+    if (!count) {
+        m_batch.reset();
+    }
+    return count;
+}
+
+void OpenGLWindow::uploadBatch(GLVertex2D *map, int firstVertex)
+{
+    writeVertices(m_batch->renderNodes, map, firstVertex);
+}
+
+void OpenGLWindow::resetBatch()
+{
+    // Don't waste time on preparing the window again while effects keep changing how it's painted.
+    if (m_batch && !m_batch->used) {
+        m_batchingSkipped = true;
+    }
+    m_batch.reset();
+}
+
+bool OpenGLWindow::isBatchingSkipped() const
+{
+    return m_batchingSkipped;
+}
+
+void OpenGLWindow::setStencilClipRegion(const QRegion &region)
+{
+    m_stencilClipRegion = region;
+}
+
+void OpenGLWindow::setDepth(std::optional<qreal> depth)
+{
+    m_depth = depth;
+}
+
+std::optional<qreal> OpenGLWindow::depth() const
+{
+    return m_depth;
+}
+
+static void beginClip(OpenGLWindow::ClipMode mode)
+{
+    if (mode == OpenGLWindow::ClipMode::Scissor || mode == OpenGLWindow::ClipMode::Stencil) {
+        GLStateTracker::instance()->setScissorTestEnabled(true);
+    }
+    if (mode == OpenGLWindow::ClipMode::Stencil) {
+        glEnable(GL_STENCIL_TEST);
+    }
+}
+
+static void endClip(OpenGLWindow::ClipMode mode)
+{
+    if (mode == OpenGLWindow::ClipMode::Scissor || mode == OpenGLWindow::ClipMode::Stencil) {
+        GLStateTracker::instance()->setScissorTestEnabled(false);
+    }
+    if (mode == OpenGLWindow::ClipMode::Stencil) {
+        glDisable(GL_STENCIL_TEST);
+    }
+}
+
+// With the stencil clip, the scissor box only keeps the geometry in the bounding rect of
+// the region, hence the window is drawn once.
+static QRegion scissorRegion(OpenGLWindow::ClipMode mode, const QRegion &region)
+{
+    return mode == OpenGLWindow::ClipMode::Stencil ? QRegion(region.boundingRect()) : region;
+}
+
+void OpenGLWindow::paintOpaquePass()
+{
+    if (!m_batch || !m_depth) {
+        return;
+    }
+    // Effects announce in the pre-paint pass whether they will make the window translucent.
+    if (!(m_batch->mask & Scene::PAINT_WINDOW_OPAQUE) || (m_batch->mask & Scene::PAINT_WINDOW_TRANSLUCENT)) {
+        return;
+    }
+
+    GLStateTracker *stateTracker = GLStateTracker::instance();
+    GLVertexBuffer *vbo = m_batch->vertexBuffer ? m_batch->vertexBuffer : m_scene->windowBatchBuffer();
+    const ClipMode mode = clipMode(m_batch->mask, m_batch->region);
+    const QRegion clip = scissorRegion(mode, m_batch->region);
+    const bool hardwareClipping = mode == ClipMode::Scissor || mode == ClipMode::Stencil;
+    const QMatrix4x4 projection = (m_batch->mask & Scene::PAINT_SCREEN_TRANSFORMED)
+        ? m_scene->screenProjectionMatrix() : m_scene->projectionMatrix();
+
+    setDepthRange(*m_depth, *m_depth);
+
+    GLShader *shader = ShaderManager::instance()->pushShader(ShaderTrait::MapTexture);
+    beginClip(mode);
+    stateTracker->setBlendEnabled(false);
+    vbo->bindArrays();
+
+    std::optional<QMatrix4x4> transformMatrix;
+    for (const RenderNode &renderNode : qAsConst(m_batch->renderNodes)) {
+        if (renderNode.vertexCount == 0 || renderNode.hasAlpha) {
             continue;
         }
-        if (childItem->isVisible()) {
-            createRenderNode(childItem, context);
+        if (transformMatrix != renderNode.transformMatrix) {
+            shader->setUniform(GLShader::ModelViewProjectionMatrix, projection * renderNode.transformMatrix);
+            transformMatrix = renderNode.transformMatrix;
         }
+
+        renderNode.texture->setFilter(renderNode.filter);
+        renderNode.texture->setWrapMode(GL_CLAMP_TO_EDGE);
+        renderNode.texture->bind();
+
+        vbo->draw(clip, primitiveType(), renderNode.firstVertex, renderNode.vertexCount, hardwareClipping);
     }
 
-    context->transforms.pop();
+    vbo->unbindArrays();
+    endClip(mode);
+    ShaderManager::instance()->popShader();
+
+    m_batch->opaquePainted = true;
 }
 
-QMatrix4x4 OpenGLWindow::modelViewProjectionMatrix(int mask, const WindowPaintData &data) const
+// Returns @c true if the window is painted the same way as in the opaque pass.
+static bool isDefaultPaintData(const WindowPaintData &data)
 {
-    const QMatrix4x4 pMatrix = data.projectionMatrix();
-    const QMatrix4x4 mvMatrix = data.modelViewMatrix();
-
-    // An effect may want to override the default projection matrix in some cases,
-    // such as when it is rendering a window on a render target that doesn't have
-    // the same dimensions as the default framebuffer.
-    //
-    // Note that the screen transformation is not applied here.
-    if (!pMatrix.isIdentity())
-        return pMatrix * mvMatrix;
+    return !data.shader
+        && data.opacity() == 1.0
+        && data.brightness() == 1.0
+        && data.saturation() == 1.0
+        && data.crossFadeProgress() == 1.0;
+}
 
-    // If an effect has specified a model-view matrix, we multiply that matrix
-    // with the default projection matrix.  If the effect hasn't specified a
-    // model-view matrix, mvMatrix will be the identity matrix.
-    if (mask & Scene::PAINT_SCREEN_TRANSFORMED)
-        return m_scene->screenProjectionMatrix() * mvMatrix;
+OpenGLWindow::ClipMode OpenGLWindow::clipMode(int mask, const QRegion &region) const
+{
+    if (region == infiniteRegion()) {
+        return ClipMode::None;
+    }
+    if (region.rectCount() <= maxScissorClipRects) {
+        return ClipMode::Scissor;
+    }
+    // Effects can paint the window with a different region than the one the stencil
+    // buffer has been prepared for.
+    if (!m_stencilClipRegion.isEmpty() && region == m_stencilClipRegion) {
+        return ClipMode::Stencil;
+    }
+    // Transformed quads can't be split in window coordinates.
+    if (mask & (Scene::PAINT_WINDOW_TRANSFORMED | Scene::PAINT_SCREEN_TRANSFORMED)) {
+        return ClipMode::Scissor;
+    }
+    return ClipMode::Software;
+}
 
-    return m_scene->projectionMatrix() * mvMatrix;
+static bool isSameRenderNode(const OpenGLWindow::RenderNode &a, const OpenGLWindow::RenderNode &b)
+{
+    // Items keep their quads until the geometry changes, so the quads can be compared by identity.
+    return a.texture == b.texture
+        && a.quads.isSharedWith(b.quads)
+        && a.transformMatrix == b.transformMatrix
+        && a.hasAlpha == b.hasAlpha
+        && a.coordinateType == b.coordinateType;
 }
 
-static QMatrix4x4 transformForPaintData(int mask, const WindowPaintData &data)
+bool OpenGLWindow::canUseVertexCache(const QVector<RenderNode> &renderNodes, ClipMode clipMode) const
 {
-    // TODO: Switch to QTransform.
-    QMatrix4x4 matrix;
+    // Cached vertices are not clipped, so they can't be used if the quads must be split.
+    if (clipMode == ClipMode::Software) {
+        return false;
+    }
+    if (renderNodes.count() != m_vertexCache.sourceNodes.count()) {
+        return false;
+    }
+    for (int i = 0; i < renderNodes.count(); ++i) {
+        const RenderNode &renderNode = renderNodes[i];
+        if (!isSameRenderNode(renderNode, m_vertexCache.sourceNodes[i])) {
+            return false;
+        }
+        if (renderNode.texture && renderNode.texture->matrix(renderNode.coordinateType) != m_vertexCache.textureMatrices[i]) {
+            return false;
+        }
+    }
+    return true;
+}
 
-    if (!(mask & Scene::PAINT_WINDOW_TRANSFORMED)) {
-        return matrix;
+void OpenGLWindow::updateVertexCache(const QVector<RenderNode> &renderNodes)
+{
+    // The vertices are uploaded only if the render nodes stay the same in the next frame, so
+    // windows that change every frame don't pay for the upload.
+    m_vertexCache.sourceNodes = renderNodes;
+    m_vertexCache.textureMatrices.resize(renderNodes.count());
+    for (int i = 0; i < renderNodes.count(); ++i) {
+        const RenderNode &renderNode = renderNodes[i];
+        m_vertexCache.textureMatrices[i] = renderNode.texture ? renderNode.texture->matrix(renderNode.coordinateType) : QMatrix4x4();
     }
+    m_vertexCache.renderNodes.clear();
+    m_vertexCache.uploaded = false;
+}
 
-    matrix.translate(data.translation());
-    const QVector3D scale = data.scale();
-    matrix.scale(scale.x(), scale.y(), scale.z());
+void OpenGLWindow::uploadVertexCache()
+{
+    QVector<RenderNode> renderNodes = m_vertexCache.sourceNodes;
+    const int count = vertexCount(renderNodes);
 
-    if (data.rotationAngle() == 0.0) {
-        return matrix;
+    if (!m_vertexCache.vertexBuffer) {
+        m_vertexCache.vertexBuffer.reset(new GLVertexBuffer(GLVertexBuffer::Static));
+        m_vertexCache.vertexBuffer->setAttribLayout(s_windowVertexAttribs, 2, sizeof(GLVertex2D));
     }
 
-    // Apply the rotation
-    // cannot use data.rotation.applyTo(&matrix) as QGraphicsRotation uses projectedRotate to map back to 2D
-    matrix.translate(data.rotationOrigin());
-    const QVector3D axis = data.rotationAxis();
-    matrix.rotate(data.rotationAngle(), axis.x(), axis.y(), axis.z());
-    matrix.translate(-data.rotationOrigin());
+    GLVertex2D *map = (GLVertex2D *) m_vertexCache.vertexBuffer->map(count * sizeof(GLVertex2D));
+    writeVertices(renderNodes, map, 0);
+    m_vertexCache.vertexBuffer->unmap();
 
-    return matrix;
+    m_vertexCache.renderNodes = renderNodes;
+    m_vertexCache.uploaded = true;
 }
 
 void OpenGLWindow::performPaint(int mask, const QRegion &region, const WindowPaintData &data)
@@ -739,24 +1648,70 @@ void OpenGLWindow::performPaint(int mask, const QRegion &region, const WindowPai
         return;
     }
 
-    RenderContext renderContext {
-        .clip = region,
-        .paintData = data,
-        .hardwareClipping = region != infiniteRegion() && ((mask & Scene::PAINT_WINDOW_TRANSFORMED) || (mask & Scene::PAINT_SCREEN_TRANSFORMED)),
-    };
+    windowItem()->setTransform(transformForPaintData(mask, data));
 
-    renderContext.transforms.push(QMatrix4x4());
+    // Effects may have changed the blend function or the scissor box with plain GL calls.
+    GLStateTracker *stateTracker = GLStateTracker::instance();
+    stateTracker->invalidate();
+
+    GLVertexBuffer *vbo = nullptr;
+    QVector<RenderNode> renderNodes;
+    const ClipMode mode = clipMode(mask, region);
+    bool skipOpaqueNodes = false;
+
+    // The vertices have been uploaded along with other windows in the frame, unless an
+    // effect has changed how the window is painted.
+    if (m_batch && m_batch->mask == mask && m_batch->region == region) {
+        m_batch->used = true;
+        renderNodes = m_batch->renderNodes;
+        vbo = m_batch->vertexBuffer ? m_batch->vertexBuffer : m_scene->windowBatchBuffer();
+        skipOpaqueNodes = m_batch->opaquePainted && isDefaultPaintData(data);
+    } else {
+        if (!(mask & Scene::PAINT_WINDOW_TRANSFORMED)) {
+            m_batchingSkipped = false;
+        }
 
-    windowItem()->setTransform(transformForPaintData(mask, data));
+        // Effects such as present windows paint windows at a fraction of their size, sample
+        // them from mip levels to avoid aliasing.
+        RenderContext renderContext {
+            .clip = region,
+            .opacity = data.opacity(),
+            .clipMode = mode,
+            .mipmaps = (mask & Scene::PAINT_WINDOW_TRANSFORMED) && std::min(data.xScale(), data.yScale()) < 0.5,
+        };
 
-    createRenderNode(windowItem(), &renderContext);
+        renderContext.transforms.push(QMatrix4x4());
 
-    int quadCount = 0;
-    for (const RenderNode &node : qAsConst(renderContext.renderNodes)) {
-        quadCount += node.quads.count();
-    }
-    if (!quadCount) {
-        return;
+        createRenderNode(windowItem(), &renderContext);
+
+        if (canUseVertexCache(renderContext.renderNodes, mode)) {
+            if (!vertexCount(renderContext.renderNodes)) {
+                return;
+            }
+            if (!m_vertexCache.uploaded) {
+                uploadVertexCache();
+            }
+            renderNodes = m_vertexCache.renderNodes;
+            vbo = m_vertexCache.vertexBuffer.data();
+        } else {
+            updateVertexCache(renderContext.renderNodes);
+            clipRenderNodes(renderContext.renderNodes, &renderContext);
+
+            const int count = vertexCount(renderContext.renderNodes);
+            if (!count) {
+                return;
+            }
+
+            vbo = GLVertexBuffer::streamingBuffer();
+            vbo->reset();
+            vbo->setAttribLayout(s_windowVertexAttribs, 2, sizeof(GLVertex2D));
+
+            GLVertex2D *map = (GLVertex2D *) vbo->map(count * sizeof(GLVertex2D));
+            writeVertices(renderContext.renderNodes, map, 0);
+            vbo->unmap();
+
+            renderNodes = renderContext.renderNodes;
+        }
     }
 
     GLShader *shader = data.shader;
@@ -773,99 +1728,245 @@ void OpenGLWindow::performPaint(int mask, const QRegion &region, const WindowPai
     }
     shader->setUniform(GLShader::Saturation, data.saturation());
 
-    const bool indexedQuads = GLVertexBuffer::supportsIndexedQuads();
-    const GLenum primitiveType = indexedQuads ? GL_QUADS : GL_TRIANGLES;
-    const int verticesPerQuad = indexedQuads ? 4 : 6;
-    const size_t size = verticesPerQuad * quadCount * sizeof(GLVertex2D);
-
-    if (renderContext.hardwareClipping) {
-        glEnable(GL_SCISSOR_TEST);
-    }
-
-    const GLVertexAttrib attribs[] = {
-        { VA_Position, 2, GL_FLOAT, offsetof(GLVertex2D, position) },
-        { VA_TexCoord, 2, GL_FLOAT, offsetof(GLVertex2D, texcoord) },
-    };
-
-    GLVertexBuffer *vbo = GLVertexBuffer::streamingBuffer();
-    vbo->reset();
-    vbo->setAttribLayout(attribs, 2, sizeof(GLVertex2D));
-
-    GLVertex2D *map = (GLVertex2D *) vbo->map(size);
-
-    for (int i = 0, v = 0; i < renderContext.renderNodes.count(); i++) {
-        RenderNode &renderNode = renderContext.renderNodes[i];
-        if (renderNode.quads.isEmpty() || !renderNode.texture)
-            continue;
-
-        renderNode.firstVertex = v;
-        renderNode.vertexCount = renderNode.quads.count() * verticesPerQuad;
-
-        const QMatrix4x4 matrix = renderNode.texture->matrix(renderNode.coordinateType);
-
-        renderNode.quads.makeInterleavedArrays(primitiveType, &map[v], matrix);
-        v += renderNode.quads.count() * verticesPerQuad;
-    }
+    const bool hardwareClipping = mode == ClipMode::Scissor || mode == ClipMode::Stencil;
+    const QRegion clip = scissorRegion(mode, region);
+    beginClip(mode);
 
-    vbo->unmap();
     vbo->bindArrays();
 
     // Make sure the blend function is set up correctly in case we will be doing blending
-    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    stateTracker->setBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
 
     float opacity = -1.0;
+    std::optional<QMatrix4x4> transformMatrix;
 
     const QMatrix4x4 modelViewProjection = modelViewProjectionMatrix(mask, data);
-    for (int i = 0; i < renderContext.renderNodes.count(); i++) {
-        const RenderNode &renderNode = renderContext.renderNodes[i];
+    for (int i = 0; i < renderNodes.count(); i++) {
+        const RenderNode &renderNode = renderNodes[i];
         if (renderNode.vertexCount == 0)
             continue;
+        if (skipOpaqueNodes && !renderNode.hasAlpha)
+            continue;
+
+        // The opacity of batched render nodes is not known until effects have run.
+        const qreal nodeOpacity = data.opacity();
 
-        setBlendEnabled(renderNode.hasAlpha || renderNode.opacity < 1.0);
+        stateTracker->setBlendEnabled(renderNode.hasAlpha || nodeOpacity < 1.0);
 
-        shader->setUniform(GLShader::ModelViewProjectionMatrix,
-                           modelViewProjection * renderNode.transformMatrix);
-        if (opacity != renderNode.opacity) {
+        if (transformMatrix != renderNode.transformMatrix) {
+            shader->setUniform(GLShader::ModelViewProjectionMatrix,
+                               modelViewProjection * renderNode.transformMatrix);
+            transformMatrix = renderNode.transformMatrix;
+        }
+        if (opacity != nodeOpacity) {
             shader->setUniform(GLShader::ModulationConstant,
-                               modulate(renderNode.opacity, data.brightness()));
-            opacity = renderNode.opacity;
+                               modulate(nodeOpacity, data.brightness()));
+            opacity = nodeOpacity;
         }
 
-        renderNode.texture->setFilter(GL_LINEAR);
+        renderNode.texture->setFilter(renderNode.filter);
         renderNode.texture->setWrapMode(GL_CLAMP_TO_EDGE);
         renderNode.texture->bind();
 
-        vbo->draw(region, primitiveType, renderNode.firstVertex,
-                  renderNode.vertexCount, renderContext.hardwareClipping);
+        vbo->draw(clip, primitiveType(), renderNode.firstVertex,
+                  renderNode.vertexCount, hardwareClipping);
     }
 
     vbo->unbindArrays();
 
-    setBlendEnabled(false);
+    stateTracker->setBlendEnabled(false);
 
     if (!data.shader)
         ShaderManager::instance()->popShader();
 
-    if (renderContext.hardwareClipping) {
-        glDisable(GL_SCISSOR_TEST);
-    }
+    endClip(mode);
 }
 
 //****************************************
 // SceneOpenGL::EffectFrame
 //****************************************
 
+/**
+ * The GlyphAtlas class keeps the rasterized glyphs of all effect frame texts in one
+ * texture. Changing the text of a frame only rebuilds its vertices, glyphs are
+ * uploaded the first time they are used.
+ */
+class GlyphAtlas
+{
+public:
+    struct Glyph {
+        // relative to the pen position
+        QRect rect;
+        QRectF textureRect;
+    };
+
+    static GlyphAtlas *self();
+    static void destroy();
+
+    /**
+     * Returns the glyph with the given @a index in @a font, rasterizing it if needed.
+     * Returns @c false if the glyph doesn't fit into the atlas.
+     */
+    bool glyph(const QRawFont &font, quint32 index, Glyph *glyph);
+    GLTexture *texture() const;
+    /**
+     * Incremented when the atlas has been cleared, vertices built before that are invalid.
+     */
+    int generation() const;
+
+private:
+    GlyphAtlas();
+    bool allocate(const QSize &size, QPoint *position);
+    void clear();
+
+    static const int s_size = 1024;
+    static GlyphAtlas *s_self;
+    QScopedPointer<GLTexture> m_texture;
+    QHash<QPair<QRawFont, quint32>, Glyph> m_glyphs;
+    QPoint m_shelf;
+    int m_shelfHeight = 0;
+    int m_generation = 0;
+};
+
+GlyphAtlas *GlyphAtlas::s_self = nullptr;
+
+GlyphAtlas *GlyphAtlas::self()
+{
+    if (!s_self) {
+        s_self = new GlyphAtlas;
+    }
+    return s_self;
+}
+
+void GlyphAtlas::destroy()
+{
+    delete s_self;
+    s_self = nullptr;
+}
+
+GlyphAtlas::GlyphAtlas()
+{
+    QImage image(s_size, s_size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    m_texture.reset(new GLTexture(image));
+}
+
+GLTexture *GlyphAtlas::texture() const
+{
+    return m_texture.data();
+}
+
+int GlyphAtlas::generation() const
+{
+    return m_generation;
+}
+
+void GlyphAtlas::clear()
+{
+    // The stale glyphs stay in the texture, they are overwritten as new glyphs come in.
+    m_glyphs.clear();
+    m_shelf = QPoint(0, 0);
+    m_shelfHeight = 0;
+    ++m_generation;
+}
+
+bool GlyphAtlas::allocate(const QSize &size, QPoint *position)
+{
+    if (size.width() > s_size || size.height() > s_size) {
+        return false;
+    }
+    if (m_shelf.x() + size.width() > s_size) {
+        m_shelf = QPoint(0, m_shelf.y() + m_shelfHeight);
+        m_shelfHeight = 0;
+    }
+    if (m_shelf.y() + size.height() > s_size) {
+        return false;
+    }
+    *position = m_shelf;
+    m_shelf.rx() += size.width();
+    m_shelfHeight = std::max(m_shelfHeight, size.height());
+    return true;
+}
+
+bool GlyphAtlas::glyph(const QRawFont &font, quint32 index, Glyph *glyph)
+{
+    const auto key = qMakePair(font, index);
+    auto it = m_glyphs.constFind(key);
+    if (it != m_glyphs.constEnd()) {
+        *glyph = it.value();
+        return true;
+    }
+
+    const QRectF bounds = font.boundingRect(index);
+    if (bounds.isEmpty()) {
+        // white space
+        *glyph = Glyph();
+        m_glyphs.insert(key, *glyph);
+        return true;
+    }
+
+    // Leave a pixel of room around the glyph for the antialiased edges.
+    const QRect rect = bounds.toAlignedRect().adjusted(-1, -1, 1, 1);
+    QPoint position;
+    if (!allocate(rect.size(), &position)) {
+        clear();
+        if (!allocate(rect.size(), &position)) {
+            return false;
+        }
+    }
+
+    QImage image(rect.size(), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+
+    QGlyphRun run;
+    run.setRawFont(font);
+    run.setGlyphIndexes({index});
+    run.setPositions({QPointF(-rect.x(), -rect.y())});
+
+    QPainter painter(&image);
+    painter.setPen(Qt::white);
+    painter.drawGlyphRun(QPointF(0, 0), run);
+    painter.end();
+
+    m_texture->update(image, position);
+
+    glyph->rect = rect;
+    glyph->textureRect = QRectF(qreal(position.x()) / s_size, qreal(position.y()) / s_size,
+                                qreal(rect.width()) / s_size, qreal(rect.height()) / s_size);
+    m_glyphs.insert(key, *glyph);
+    return true;
+}
+
+/**
+ * Icon textures are shared between the frames that show the same icon at the same size.
+ */
+static QSharedPointer<GLTexture> iconTexture(const QIcon &icon, const QSize &size)
+{
+    using IconKey = QPair<qint64, QPair<int, int>>;
+    static QHash<IconKey, QWeakPointer<GLTexture>> cache;
+
+    const IconKey key(icon.cacheKey(), qMakePair(size.width(), size.height()));
+    QSharedPointer<GLTexture> texture = cache.value(key).toStrongRef();
+    if (!texture) {
+        for (auto it = cache.begin(); it != cache.end();) {
+            if (it.value().isNull()) {
+                it = cache.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        texture.reset(new GLTexture(icon.pixmap(size)));
+        cache.insert(key, texture);
+    }
+    return texture;
+}
+
 GLTexture* SceneOpenGL::EffectFrame::m_unstyledTexture = nullptr;
 QPixmap* SceneOpenGL::EffectFrame::m_unstyledPixmap = nullptr;
 
 SceneOpenGL::EffectFrame::EffectFrame(EffectFrameImpl* frame, SceneOpenGL *scene)
     : Scene::EffectFrame(frame)
     , m_texture(nullptr)
-    , m_textTexture(nullptr)
-    , m_oldTextTexture(nullptr)
-    , m_textPixmap(nullptr)
-    , m_iconTexture(nullptr)
-    , m_oldIconTexture(nullptr)
     , m_selectionTexture(nullptr)
     , m_unstyledVBO(nullptr)
     , m_scene(scene)
@@ -875,11 +1976,6 @@ SceneOpenGL::EffectFrame::EffectFrame(EffectFrameImpl* frame, SceneOpenGL *scene
 SceneOpenGL::EffectFrame::~EffectFrame()
 {
     delete m_texture;
-    delete m_textTexture;
-    delete m_textPixmap;
-    delete m_oldTextTexture;
-    delete m_iconTexture;
-    delete m_oldIconTexture;
     delete m_selectionTexture;
     delete m_unstyledVBO;
 }
@@ -889,34 +1985,24 @@ void SceneOpenGL::EffectFrame::free()
     glFlush();
     delete m_texture;
     m_texture = nullptr;
-    delete m_textTexture;
-    m_textTexture = nullptr;
-    delete m_textPixmap;
-    m_textPixmap = nullptr;
-    delete m_iconTexture;
-    m_iconTexture = nullptr;
+    m_textVBO.reset();
+    m_iconTexture.reset();
     delete m_selectionTexture;
     m_selectionTexture = nullptr;
     delete m_unstyledVBO;
     m_unstyledVBO = nullptr;
-    delete m_oldIconTexture;
-    m_oldIconTexture = nullptr;
-    delete m_oldTextTexture;
-    m_oldTextTexture = nullptr;
+    m_oldIconTexture.reset();
+    m_oldTextVBO.reset();
 }
 
 void SceneOpenGL::EffectFrame::freeIconFrame()
 {
-    delete m_iconTexture;
-    m_iconTexture = nullptr;
+    m_iconTexture.reset();
 }
 
 void SceneOpenGL::EffectFrame::freeTextFrame()
 {
-    delete m_textTexture;
-    m_textTexture = nullptr;
-    delete m_textPixmap;
-    m_textPixmap = nullptr;
+    m_textVBO.reset();
 }
 
 void SceneOpenGL::EffectFrame::freeSelection()
@@ -927,16 +2013,15 @@ void SceneOpenGL::EffectFrame::freeSelection()
 
 void SceneOpenGL::EffectFrame::crossFadeIcon()
 {
-    delete m_oldIconTexture;
     m_oldIconTexture = m_iconTexture;
-    m_iconTexture = nullptr;
+    m_iconTexture.reset();
 }
 
 void SceneOpenGL::EffectFrame::crossFadeText()
 {
-    delete m_oldTextTexture;
-    m_oldTextTexture = m_textTexture;
-    m_textTexture = nullptr;
+    m_oldTextVBO.swap(m_textVBO);
+    m_oldTextGeneration = m_textGeneration;
+    m_textVBO.reset();
 }
 
 void SceneOpenGL::EffectFrame::render(const QRegion &_region, double opacity, double frameOpacity)
@@ -1162,7 +2247,7 @@ void SceneOpenGL::EffectFrame::render(const QRegion &_region, double opacity, do
         }
 
         if (!m_iconTexture) { // lazy creation
-            m_iconTexture = new GLTexture(m_effectFrame->icon().pixmap(m_effectFrame->iconSize()));
+            m_iconTexture = iconTexture(m_effectFrame->icon(), m_effectFrame->iconSize());
         }
         m_iconTexture->bind();
         m_iconTexture->render(region, QRect(topLeft, m_effectFrame->iconSize()));
@@ -1174,33 +2259,40 @@ void SceneOpenGL::EffectFrame::render(const QRegion &_region, double opacity, do
         QMatrix4x4 mvp(projection);
         mvp.translate(m_effectFrame->geometry().x(), m_effectFrame->geometry().y());
         shader->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
-        if (m_effectFrame->isCrossFade() && m_oldTextTexture) {
+
+        GlyphAtlas *atlas = GlyphAtlas::self();
+        if (!m_textVBO || m_textGeneration != atlas->generation()) { // Lazy creation
+            updateTextVertices();
+        }
+
+        // The glyphs are white, they are tinted with the text color.
+        QColor color = Qt::white; // TODO: What about no frame? Custom color setting required
+        if (m_effectFrame->style() == EffectFrameStyled) {
+            color = m_effectFrame->styledTextColor();
+        }
+        auto textModulation = [&color](double alpha) {
+            const float a = alpha * color.alphaF();
+            return QVector4D(color.redF() * a, color.greenF() * a, color.blueF() * a, a);
+        };
+
+        atlas->texture()->bind();
+        if (m_effectFrame->isCrossFade() && m_oldTextVBO && m_oldTextGeneration == atlas->generation()) {
             if (shader) {
-                const float a = opacity * (1.0 - m_effectFrame->crossFadeProgress());
-                shader->setUniform(GLShader::ModulationConstant, QVector4D(a, a, a, a));
+                shader->setUniform(GLShader::ModulationConstant, textModulation(opacity * (1.0 - m_effectFrame->crossFadeProgress())));
             }
-
-            m_oldTextTexture->bind();
-            m_oldTextTexture->render(region, m_effectFrame->geometry());
-            m_oldTextTexture->unbind();
+            m_oldTextVBO->render(region, GL_TRIANGLES);
             if (shader) {
-                const float a = opacity * m_effectFrame->crossFadeProgress();
-                shader->setUniform(GLShader::ModulationConstant, QVector4D(a, a, a, a));
+                shader->setUniform(GLShader::ModulationConstant, textModulation(opacity * m_effectFrame->crossFadeProgress()));
             }
         } else {
             if (shader) {
-                const QVector4D constant(opacity, opacity, opacity, opacity);
-                shader->setUniform(GLShader::ModulationConstant, constant);
+                shader->setUniform(GLShader::ModulationConstant, textModulation(opacity));
             }
         }
-        if (!m_textTexture)   // Lazy creation
-            updateTextTexture();
-
-        if (m_textTexture) {
-            m_textTexture->bind();
-            m_textTexture->render(region, m_effectFrame->geometry());
-            m_textTexture->unbind();
+        if (m_textVBO) {
+            m_textVBO->render(region, GL_TRIANGLES);
         }
+        atlas->texture()->unbind();
     }
 
     if (shader) {
@@ -1219,17 +2311,14 @@ void SceneOpenGL::EffectFrame::updateTexture()
     }
 }
 
-void SceneOpenGL::EffectFrame::updateTextTexture()
+void SceneOpenGL::EffectFrame::updateTextVertices()
 {
-    delete m_textTexture;
-    m_textTexture = nullptr;
-    delete m_textPixmap;
-    m_textPixmap = nullptr;
+    m_textVBO.reset();
 
     if (m_effectFrame->text().isEmpty())
         return;
 
-    // Determine position on texture to paint text
+    // Determine position in the frame to paint text
     QRect rect(QPoint(0, 0), m_effectFrame->geometry().size());
     if (!m_effectFrame->icon().isNull() && !m_effectFrame->iconSize().isEmpty())
         rect.setLeft(m_effectFrame->iconSize().width());
@@ -1240,18 +2329,87 @@ void SceneOpenGL::EffectFrame::updateTextTexture()
         QFontMetrics metrics(m_effectFrame->font());
         text = metrics.elidedText(text, Qt::ElideRight, rect.width());
     }
+    // Lay out the lines like QPainter::drawText() does
+    text.replace(QLatin1Char('\n'), QChar::LineSeparator);
+
+    QTextOption option;
+    option.setWrapMode(QTextOption::NoWrap);
+    QTextLayout layout(text, m_effectFrame->font());
+    layout.setTextOption(option);
+    layout.beginLayout();
+    qreal height = 0;
+    for (QTextLine line = layout.createLine(); line.isValid(); line = layout.createLine()) {
+        line.setPosition(QPointF(0, height));
+        height += line.height();
+    }
+    layout.endLayout();
+
+    const Qt::Alignment alignment = m_effectFrame->alignment();
+    qreal top = rect.top();
+    if (alignment & Qt::AlignBottom) {
+        top = rect.bottom() + 1 - height;
+    } else if (alignment & Qt::AlignVCenter) {
+        top = rect.top() + (rect.height() - height) / 2;
+    }
+
+    GlyphAtlas *atlas = GlyphAtlas::self();
+    const int generation = atlas->generation();
+
+    QVector<float> verts, texCoords;
+    for (int i = 0; i < layout.lineCount(); ++i) {
+        const QTextLine line = layout.lineAt(i);
+        qreal left = rect.left();
+        if (alignment & Qt::AlignRight) {
+            left = rect.right() + 1 - line.naturalTextWidth();
+        } else if (alignment & Qt::AlignHCenter) {
+            left = rect.left() + (rect.width() - line.naturalTextWidth()) / 2;
+        }
+
+        const auto glyphRuns = line.glyphRuns();
+        for (const QGlyphRun &run : glyphRuns) {
+            const QRawFont font = run.rawFont();
+            const QVector<quint32> indexes = run.glyphIndexes();
+            const QVector<QPointF> positions = run.positions();
+            for (int j = 0; j < indexes.count(); ++j) {
+                GlyphAtlas::Glyph glyph;
+                if (!atlas->glyph(font, indexes[j], &glyph) || glyph.rect.isEmpty()) {
+                    continue;
+                }
+                const QPoint pen = (QPointF(left, top) + positions[j]).toPoint();
+                const QRect quad = glyph.rect.translated(pen);
+                const QRectF &tex = glyph.textureRect;
+
+                verts << quad.left() << quad.top()
+                      << quad.left() << quad.bottom() + 1
+                      << quad.right() + 1 << quad.top()
+                      << quad.left() << quad.bottom() + 1
+                      << quad.right() + 1 << quad.bottom() + 1
+                      << quad.right() + 1 << quad.top();
+                texCoords << tex.left() << tex.top()
+                          << tex.left() << tex.bottom()
+                          << tex.right() << tex.top()
+                          << tex.left() << tex.bottom()
+                          << tex.right() << tex.bottom()
+                          << tex.right() << tex.top();
+            }
+        }
+    }
 
-    m_textPixmap = new QPixmap(m_effectFrame->geometry().size());
-    m_textPixmap->fill(Qt::transparent);
-    QPainter p(m_textPixmap);
-    p.setFont(m_effectFrame->font());
-    if (m_effectFrame->style() == EffectFrameStyled)
-        p.setPen(m_effectFrame->styledTextColor());
-    else // TODO: What about no frame? Custom color setting required
-        p.setPen(Qt::white);
-    p.drawText(rect, m_effectFrame->alignment(), text);
-    p.end();
-    m_textTexture = new GLTexture(*m_textPixmap);
+    if (atlas->generation() != generation) {
+        // The atlas has been cleared midway, the glyphs rasterized before are gone.
+        // Only the glyphs of this text are in the atlas now, so this converges.
+        if (m_rebuildingText) {
+            return;
+        }
+        m_rebuildingText = true;
+        updateTextVertices();
+        m_rebuildingText = false;
+        return;
+    }
+
+    m_textGeneration = generation;
+    m_textVBO.reset(new GLVertexBuffer(GLVertexBuffer::Static));
+    m_textVBO->setData(verts.count() / 2, 2, verts.constData(), texCoords.constData());
 }
 
 void SceneOpenGL::EffectFrame::updateUnstyledTexture()
@@ -1275,6 +2433,7 @@ void SceneOpenGL::EffectFrame::updateUnstyledTexture()
 
 void SceneOpenGL::EffectFrame::cleanup()
 {
+    GlyphAtlas::destroy();
     delete m_unstyledTexture;
     m_unstyledTexture = nullptr;
     delete m_unstyledPixmap;
@@ -1293,14 +2452,35 @@ public:
 
     void unregister(SceneOpenGLShadow *shadow);
     QSharedPointer<GLTexture> getTexture(SceneOpenGLShadow *shadow);
+    QSharedPointer<GLTexture> getTexture(SceneOpenGLShadow *shadow, const QImage &image);
 
 private:
     DecorationShadowTextureCache() = default;
     struct Data {
         QSharedPointer<GLTexture> texture;
-        QVector<SceneOpenGLShadow*> shadows;
+        QSet<SceneOpenGLShadow*> shadows;
+    };
+    /**
+     * Shadows which are not provided by the decoration are shared by their content.
+     * The image is kept to tell hash collisions apart from identical shadows.
+     */
+    struct ImageKey {
+        QImage image;
+        uint hash;
+        bool operator==(const ImageKey &other) const {
+            return hash == other.hash && image == other.image;
+        }
+        friend uint qHash(const ImageKey &key, uint seed) {
+            return key.hash ^ seed;
+        }
     };
+    static ImageKey imageKey(const QImage &image);
+
     QHash<KDecoration2::DecorationShadow*, Data> m_cache;
+    QHash<ImageKey, Data> m_imageCache;
+    // back-references to have constant time unregister
+    QHash<SceneOpenGLShadow*, KDecoration2::DecorationShadow*> m_decorationShadows;
+    QHash<SceneOpenGLShadow*, ImageKey> m_imageShadows;
 };
 
 DecorationShadowTextureCache &DecorationShadowTextureCache::instance()
@@ -1312,28 +2492,42 @@ DecorationShadowTextureCache &DecorationShadowTextureCache::instance()
 DecorationShadowTextureCache::~DecorationShadowTextureCache()
 {
     Q_ASSERT(m_cache.isEmpty());
+    Q_ASSERT(m_imageCache.isEmpty());
+}
+
+DecorationShadowTextureCache::ImageKey DecorationShadowTextureCache::imageKey(const QImage &image)
+{
+    // hash line by line, the padding at the end of each scan line is not initialized
+    const qsizetype lineSize = (qsizetype(image.width()) * image.depth() + 7) / 8;
+    uint hash = qHash(image.width()) ^ qHash(image.height() << 16) ^ uint(image.format());
+    for (int y = 0; y < image.height(); ++y) {
+        hash = qHashBits(image.constScanLine(y), lineSize, hash);
+    }
+    return ImageKey{image, hash};
 }
 
 void DecorationShadowTextureCache::unregister(SceneOpenGLShadow *shadow)
 {
-    auto it = m_cache.begin();
-    while (it != m_cache.end()) {
-        auto &d = it.value();
-        // check whether the Vector of Shadows contains our shadow and remove all of them
-        auto glIt = d.shadows.begin();
-        while (glIt != d.shadows.end()) {
-            if (*glIt == shadow) {
-                glIt = d.shadows.erase(glIt);
-            } else {
-                glIt++;
-            }
-        }
+    auto decoIt = m_decorationShadows.find(shadow);
+    if (decoIt != m_decorationShadows.end()) {
+        auto it = m_cache.find(decoIt.value());
+        Q_ASSERT(it != m_cache.end());
+        it.value().shadows.remove(shadow);
         // if there are no shadows any more we can erase the cache entry
-        if (d.shadows.isEmpty()) {
-            it = m_cache.erase(it);
-        } else {
-            it++;
+        if (it.value().shadows.isEmpty()) {
+            m_cache.erase(it);
+        }
+        m_decorationShadows.erase(decoIt);
+    }
+    auto imageIt = m_imageShadows.find(shadow);
+    if (imageIt != m_imageShadows.end()) {
+        auto it = m_imageCache.find(imageIt.value());
+        Q_ASSERT(it != m_imageCache.end());
+        it.value().shadows.remove(shadow);
+        if (it.value().shadows.isEmpty()) {
+            m_imageCache.erase(it);
         }
+        m_imageShadows.erase(imageIt);
     }
 }
 
@@ -1343,19 +2537,42 @@ QSharedPointer<GLTexture> DecorationShadowTextureCache::getTexture(SceneOpenGLSh
     unregister(shadow);
     const auto &decoShadow = shadow->decorationShadow().toStrongRef();
     Q_ASSERT(!decoShadow.isNull());
+    m_decorationShadows.insert(shadow, decoShadow.data());
     auto it = m_cache.find(decoShadow.data());
     if (it != m_cache.end()) {
         Q_ASSERT(!it.value().shadows.contains(shadow));
-        it.value().shadows << shadow;
+        it.value().shadows.insert(shadow);
         return it.value().texture;
     }
     Data d;
-    d.shadows << shadow;
+    d.shadows.insert(shadow);
     d.texture = QSharedPointer<GLTexture>::create(shadow->decorationShadowImage());
     m_cache.insert(decoShadow.data(), d);
     return d.texture;
 }
 
+QSharedPointer<GLTexture> DecorationShadowTextureCache::getTexture(SceneOpenGLShadow *shadow, const QImage &image)
+{
+    unregister(shadow);
+    const ImageKey key = imageKey(image);
+    m_imageShadows.insert(shadow, key);
+    auto it = m_imageCache.find(key);
+    if (it != m_imageCache.end()) {
+        it.value().shadows.insert(shadow);
+        return it.value().texture;
+    }
+    Data d;
+    d.shadows.insert(shadow);
+    d.texture = QSharedPointer<GLTexture>::create(image);
+    if (d.texture->internalFormat() == GL_R8) {
+        // Swizzle red to alpha and all other channels to zero
+        d.texture->bind();
+        d.texture->setSwizzle(GL_ZERO, GL_ZERO, GL_ZERO, GL_RED);
+    }
+    m_imageCache.insert(key, d);
+    return d.texture;
+}
+
 SceneOpenGLShadow::SceneOpenGLShadow(Toplevel *toplevel)
     : Shadow(toplevel)
 {
@@ -1447,13 +2664,7 @@ bool SceneOpenGLShadow::prepareBackend()
 
     Scene *scene = Compositor::self()->scene();
     scene->makeOpenGLContextCurrent();
-    m_texture = QSharedPointer<GLTexture>::create(image);
-
-    if (m_texture->internalFormat() == GL_R8) {
-        // Swizzle red to alpha and all other channels to zero
-        m_texture->bind();
-        m_texture->setSwizzle(GL_ZERO, GL_ZERO, GL_ZERO, GL_RED);
-    }
+    m_texture = DecorationShadowTextureCache::instance().getTexture(this, image);
 
     return true;
 }
@@ -1545,12 +2756,31 @@ void SceneOpenGLDecorationRenderer::render(const QRegion &region)
     const QPoint leftPosition(0, bottomPosition.y() + bottomHeight + (2 * TexturePad));
     const QPoint rightPosition(0, leftPosition.y() + leftWidth + (2 * TexturePad));
 
-    const QRect dirtyRect = region.boundingRect();
+    renderPart(region, top, topPosition);
+    renderPart(region, bottom, bottomPosition);
+    renderPart(region, left, leftPosition, true);
+    renderPart(region, right, rightPosition, true);
+}
 
-    renderPart(top.intersected(dirtyRect), top, topPosition);
-    renderPart(bottom.intersected(dirtyRect), bottom, bottomPosition);
-    renderPart(left.intersected(dirtyRect), left, leftPosition, true);
-    renderPart(right.intersected(dirtyRect), right, rightPosition, true);
+void SceneOpenGLDecorationRenderer::renderPart(const QRegion &region, const QRect &partRect,
+                                               const QPoint &textureOffset, bool rotated)
+{
+    // Damage is split up per part, so that e.g. a hovered button in the titlebar doesn't cause
+    // the bottom border to be uploaded as well, and small disjoint changes in one part, like
+    // a button and the caption, are uploaded separately instead of as their bounding rect.
+    const QRegion partDamage = region.intersected(partRect);
+    const QRect boundingRect = partDamage.boundingRect();
+    int damagedArea = 0;
+    for (const QRect &rect : partDamage) {
+        damagedArea += rect.width() * rect.height();
+    }
+    if (partDamage.rectCount() > 1 && damagedArea * 2 < boundingRect.width() * boundingRect.height()) {
+        for (const QRect &rect : partDamage) {
+            renderPart(rect, partRect, textureOffset, rotated);
+        }
+    } else {
+        renderPart(boundingRect, partRect, textureOffset, rotated);
+    }
 }
 
 void SceneOpenGLDecorationRenderer::renderPart(const QRect &rect, const QRect &partRect,
@@ -1647,8 +2877,16 @@ void SceneOpenGLDecorationRenderer::resizeTexture()
     size.rwidth() += 2 * TexturePad;
     size.rwidth() = align(size.width(), 128);
 
-    if (m_texture && m_texture->size() == size)
-        return;
+    // The parts are placed at fixed offsets from the top left corner, so a texture that is
+    // already big enough can be kept. This avoids reallocating it on every step of an
+    // interactive resize; it is only shrunk once it wastes more than half of its area.
+    if (m_texture && !size.isEmpty()) {
+        const QSize current = m_texture->size();
+        if (current.width() >= size.width() && current.height() >= size.height()
+                && current.width() * current.height() <= 2 * size.width() * size.height()) {
+            return;
+        }
+    }
 
     if (!size.isEmpty()) {
         m_texture.reset(new GLTexture(GL_RGBA8, size.width(), size.height()));
@@ -21,8 +21,10 @@
 
 namespace KWin
 {
+class GLRenderTimeQuery;
 class LanczosFilter;
 class OpenGLBackend;
+class OpenGLWindow;
 
 class KWIN_EXPORT SceneOpenGL
     : public Scene
@@ -59,6 +61,12 @@ public:
     static SceneOpenGL *createScene(OpenGLBackend *backend, QObject *parent);
     static bool supported(OpenGLBackend *backend);
 
+    /**
+     * Returns the vertex buffer that holds the vertices of all windows that have been
+     * prepared in beginPaintWindows().
+     */
+    GLVertexBuffer *windowBatchBuffer() const;
+
 protected:
     void paintBackground(const QRegion &region) override;
     void aboutToStartPainting(AbstractOutput *output, const QRegion &damage) override;
@@ -72,22 +80,102 @@ protected:
     Scene::Window *createWindow(Toplevel *t) override;
     void finalDrawWindow(EffectWindowImpl* w, int mask, const QRegion &region, WindowPaintData& data) override;
     void paintCursor(AbstractOutput *output, const QRegion &region) override;
+    void paintWindow(Window *w, int mask, const QRegion &region) override;
+    void beginPaintWindows(const QVector<Phase2Data> &windows) override;
+    void endPaintWindows() override;
 
 private:
     void doPaintBackground(const QVector< float >& vertices);
+    bool writeStencilClip(const QRegion &region);
+    bool beginDepthPrepass(const QVector<Phase2Data> &windows);
+    template <typename Function>
+    void forEachBatchedWindow(int quadCount, Function function);
     void updateProjectionMatrix(const QRect &geometry);
     void performPaintWindow(EffectWindowImpl* w, int mask, const QRegion &region, WindowPaintData& data);
+    GLRenderTimeQuery *renderTimeQuery(RenderLoop *renderLoop);
+    bool paintCursorOnly(AbstractOutput *output, const QRegion &repaint, QRegion *update, QRegion *valid);
+    void saveCursorBacking(AbstractOutput *output, const QRect &rect);
+    void discardCursorBackings(AbstractOutput *output, const QRegion &region);
 
     bool init_ok = true;
     OpenGLBackend *m_backend;
     LanczosFilter *m_lanczosFilter = nullptr;
     QScopedPointer<GLTexture> m_cursorTexture;
     bool m_cursorTextureDirty = false;
+    /**
+     * A copy of the scene contents under the software cursor, taken before the cursor
+     * was painted over them. It stays valid as long as the scene doesn't change there.
+     */
+    struct CursorBacking {
+        QRect rect;
+        QSharedPointer<GLTexture> texture;
+        QSharedPointer<GLRenderTarget> renderTarget;
+    };
+    struct CursorLayer {
+        // the most recent backing is the last one
+        QVector<CursorBacking> backings;
+        // where the cursor has been painted in the last frame
+        QRect lastCursorRect;
+    };
+    QHash<AbstractOutput *, CursorLayer> m_cursorLayers;
     QMatrix4x4 m_projectionMatrix;
     QMatrix4x4 m_screenProjectionMatrix;
+    QHash<RenderLoop *, QSharedPointer<GLRenderTimeQuery>> m_renderTimeQueries;
+    bool m_renderTimeQueriesSupported = false;
+    QScopedPointer<GLVertexBuffer> m_windowBatchBuffer;
+    QVector<QPair<OpenGLWindow *, int>> m_batchedWindows;
+    bool m_threadedBatchingEnabled = true;
+    // the area covered by the overlay plane in the last frame, per output
+    QHash<AbstractOutput *, QRect> m_overlayAreas;
+    bool m_depthPrepassEnabled = false;
+    bool m_depthPrepassActive = false;
     GLuint vao = 0;
 };
 
+/**
+ * The GLRenderTimeQuery class measures how long it takes the GPU to render a frame.
+ *
+ * The GPU clock is sampled when the frame starts, and a timestamp query is inserted in
+ * the command stream after the last rendering command. The result of the query becomes
+ * available asynchronously once the GPU has executed all commands of the frame.
+ */
+class GLRenderTimeQuery
+{
+public:
+    GLRenderTimeQuery();
+    ~GLRenderTimeQuery();
+
+    static bool supported();
+
+    /**
+     * Starts measuring the frame with the given @a sequence number.
+     */
+    void begin(quint64 sequence);
+    void end();
+
+    /**
+     * Returns the sequence number of the frame that is being measured.
+     */
+    quint64 sequence() const;
+
+    /**
+     * Returns @c true if the query has been issued but its result hasn't been fetched yet.
+     */
+    bool isPending() const;
+
+    /**
+     * Returns the render time if the result of the query is available; otherwise returns
+     * a negative duration. The query is not pending anymore after obtaining its result.
+     */
+    std::chrono::nanoseconds result();
+
+private:
+    GLuint m_query = 0;
+    GLint64 m_startTimestamp = 0;
+    quint64 m_sequence = 0;
+    bool m_pending = false;
+};
+
 class OpenGLWindow final : public Scene::Window
 {
     Q_OBJECT
@@ -103,6 +191,17 @@ public:
         qreal opacity = 1;
         bool hasAlpha = false;
         TextureCoordinateType coordinateType = UnnormalizedCoordinates;
+        GLenum filter = GL_LINEAR;
+    };
+
+    /**
+     * Describes how the geometry of a window is clipped to the painted region.
+     */
+    enum class ClipMode {
+        None, ///< The region is infinite
+        Software, ///< The quads are split against every rect of the region
+        Scissor, ///< The window is drawn once for every rect of the region
+        Stencil, ///< The region has been written to the stencil buffer
     };
 
     struct RenderContext
@@ -110,8 +209,12 @@ public:
         QVector<RenderNode> renderNodes;
         QStack<QMatrix4x4> transforms;
         const QRegion clip;
-        const WindowPaintData &paintData;
-        const bool hardwareClipping;
+        const qreal opacity;
+        const ClipMode clipMode;
+        /**
+         * Whether surfaces are painted with mipmapped textures because the window is scaled down.
+         */
+        const bool mipmaps = false;
     };
 
     OpenGLWindow(Toplevel *toplevel, SceneOpenGL *scene);
@@ -119,14 +222,100 @@ public:
 
     void performPaint(int mask, const QRegion &region, const WindowPaintData &data) override;
 
+    /**
+     * Generates the render nodes of the window ahead of painting it with the specified
+     * @a mask and @a region, assuming that effects will not transform the window. Returns
+     * the number of quads that need vertices, or @c 0 if the window can't be batched or is
+     * painted with its vertex cache.
+     *
+     * This walks the item tree and binds textures, so it must be called on the main thread.
+     */
+    int prepareBatch(int mask, const QRegion &region);
+
+    /**
+     * Clips the quads of the prepared render nodes to the painted region and returns the
+     * number of vertices needed to draw the window.
+     *
+     * This touches only the prepared render nodes, so it can be called from a worker
+     * thread while other windows are clipped.
+     */
+    int clipBatch();
+
+    /**
+     * Writes the vertices of the prepared render nodes to @a map, starting at @a firstVertex.
+     *
+     * Like clipBatch(), this can be called from a worker thread.
+     */
+    void uploadBatch(GLVertex2D *map, int firstVertex);
+
+    /**
+     * Discards the prepared render nodes. If they haven't been used, the window is not
+     * batched until it's painted without transformations again.
+     */
+    void resetBatch();
+
+    bool isBatchingSkipped() const;
+
+    /**
+     * Draws the opaque render nodes of the prepared window with depth writes enabled. The
+     * nodes are skipped when the window is painted later, unless an effect changes how
+     * it's painted.
+     */
+    void paintOpaquePass();
+
+    /**
+     * Sets the depth at which the window is painted while the scene discards hidden
+     * fragments with the depth test, or resets it if @a depth is empty.
+     */
+    void setDepth(std::optional<qreal> depth);
+    std::optional<qreal> depth() const;
+
+    /**
+     * Lets the window be clipped with the stencil buffer when it's painted with @a region
+     * in the current frame. The region must be covered by the stencil clip of the scene.
+     */
+    void setStencilClipRegion(const QRegion &region);
+
+    static constexpr int maxScissorClipRects = 4;
+
 private:
+    ClipMode clipMode(int mask, const QRegion &region) const;
     QMatrix4x4 modelViewProjectionMatrix(int mask, const WindowPaintData &data) const;
     QVector4D modulate(float opacity, float brightness) const;
-    void setBlendEnabled(bool enabled);
     void createRenderNode(Item *item, RenderContext *context);
+    bool canUseVertexCache(const QVector<RenderNode> &renderNodes, ClipMode clipMode) const;
+    void updateVertexCache(const QVector<RenderNode> &renderNodes);
+    void uploadVertexCache();
 
     SceneOpenGL *m_scene;
-    bool m_blendingEnabled = false;
+
+    struct Batch
+    {
+        QVector<RenderNode> renderNodes;
+        QRegion region;
+        int mask = 0;
+        ClipMode clipMode = ClipMode::None;
+        bool used = false;
+        // The vertex cache of the window, or null if the nodes are in the scene's batch buffer
+        GLVertexBuffer *vertexBuffer = nullptr;
+        bool opaquePainted = false;
+    };
+    std::optional<Batch> m_batch;
+    bool m_batchingSkipped = false;
+    QRegion m_stencilClipRegion;
+    std::optional<qreal> m_depth;
+
+    // The vertices of the window are kept in a buffer of its own while its geometry, clip
+    // and textures don't change, so static windows don't generate vertices every frame
+    struct VertexCache
+    {
+        QVector<RenderNode> sourceNodes;
+        QVector<QMatrix4x4> textureMatrices;
+        QVector<RenderNode> renderNodes;
+        QScopedPointer<GLVertexBuffer> vertexBuffer;
+        bool uploaded = false;
+    };
+    VertexCache m_vertexCache;
 };
 
 class SceneOpenGL::EffectFrame
@@ -150,14 +339,17 @@ public:
 
 private:
     void updateTexture();
-    void updateTextTexture();
+    void updateTextVertices();
 
     GLTexture *m_texture;
-    GLTexture *m_textTexture;
-    GLTexture *m_oldTextTexture;
-    QPixmap *m_textPixmap; // need to keep the pixmap around to workaround some driver problems
-    GLTexture *m_iconTexture;
-    GLTexture *m_oldIconTexture;
+    // the text is drawn from a glyph atlas shared by all frames
+    QScopedPointer<GLVertexBuffer> m_textVBO;
+    QScopedPointer<GLVertexBuffer> m_oldTextVBO;
+    int m_textGeneration = -1;
+    int m_oldTextGeneration = -1;
+    bool m_rebuildingText = false;
+    QSharedPointer<GLTexture> m_iconTexture;
+    QSharedPointer<GLTexture> m_oldIconTexture;
     GLTexture *m_selectionTexture;
     GLVertexBuffer *m_unstyledVBO;
     SceneOpenGL *m_scene;
@@ -213,6 +405,7 @@ public:
     }
 
 private:
+    void renderPart(const QRegion &region, const QRect &partRect, const QPoint &textureOffset, bool rotated = false);
     void renderPart(const QRect &rect, const QRect &partRect, const QPoint &textureOffset, bool rotated = false);
     static const QMargins texturePadForPart(const QRect &rect, const QRect &partRect);
     void resizeTexture();
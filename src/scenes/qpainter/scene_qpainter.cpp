@@ -91,7 +91,9 @@ void SceneQPainter::paint(AbstractOutput *output, const QRegion &damage, const Q
 
         m_painter->end();
         renderLoop->endFrame();
+        renderLoop->recordFrameStage(RenderLoop::FrameStage::Submission);
         m_backend->endFrame(output, validRegion, updateRegion);
+        renderLoop->recordFrameStage(RenderLoop::FrameStage::EndFrame);
     }
 
     // do cleanup
@@ -189,15 +191,19 @@ void SceneQPainter::Window::performPaint(int mask, const QRegion &_region, const
     }
 
     const bool opaque = qFuzzyCompare(1.0, data.opacity());
-    QImage tempImage;
     QPainter tempPainter;
+    QRect tempRect;
     if (!opaque) {
-        // need a temp render target which we later on blit to the screen
-        tempImage = QImage(boundingRect.size(), QImage::Format_ARGB32_Premultiplied);
-        tempImage.fill(Qt::transparent);
-        tempPainter.begin(&tempImage);
+        // Need a temp render target which we later on blit to the screen. Unless the painter
+        // is transformed, only the part of the window that gets painted is needed.
+        tempRect = (mask & (PAINT_WINDOW_TRANSFORMED | PAINT_SCREEN_TRANSFORMED)) ? boundingRect : region.boundingRect();
+        if (m_tempImage.size() != tempRect.size()) {
+            m_tempImage = QImage(tempRect.size(), QImage::Format_ARGB32_Premultiplied);
+        }
+        m_tempImage.fill(Qt::transparent);
+        tempPainter.begin(&m_tempImage);
         tempPainter.save();
-        tempPainter.translate(-boundingRect.topLeft());
+        tempPainter.translate(-tempRect.topLeft());
         painter = &tempPainter;
     }
 
@@ -208,10 +214,10 @@ void SceneQPainter::Window::performPaint(int mask, const QRegion &_region, const
         tempPainter.setCompositionMode(QPainter::CompositionMode_DestinationIn);
         QColor translucent(Qt::transparent);
         translucent.setAlphaF(data.opacity());
-        tempPainter.fillRect(QRect(QPoint(0, 0), boundingRect.size()), translucent);
+        tempPainter.fillRect(QRect(QPoint(0, 0), tempRect.size()), translucent);
         tempPainter.end();
         painter = scenePainter;
-        painter->drawImage(boundingRect.topLeft(), tempImage);
+        painter->drawImage(tempRect.topLeft(), m_tempImage);
     }
 
     painter->restore();
@@ -269,14 +275,28 @@ void SceneQPainter::Window::renderSurfaceItem(QPainter *painter, SurfaceItem *su
     surfaceItem->resetDamage();
 
     const QRegion shape = surfaceItem->shape();
-    for (const QRectF rect : shape) {
-        const QMatrix4x4 matrix = surfaceItem->surfaceToBufferMatrix();
-        const QPointF bufferTopLeft = matrix.map(rect.topLeft());
-        const QPointF bufferBottomRight = matrix.map(rect.bottomRight());
+    const QRegion opaque = surfaceItem->opaque() & shape;
+    const QMatrix4x4 matrix = surfaceItem->surfaceToBufferMatrix();
+    const QImage image = platformSurfaceTexture->image();
+
+    auto drawRegion = [&](const QRegion &region) {
+        for (const QRectF rect : region) {
+            const QPointF bufferTopLeft = matrix.map(rect.topLeft());
+            const QPointF bufferBottomRight = matrix.map(rect.bottomRight());
+
+            painter->drawImage(rect, image, QRectF(bufferTopLeft, bufferBottomRight));
+        }
+    };
 
-        painter->drawImage(rect, platformSurfaceTexture->image(),
-                           QRectF(bufferTopLeft, bufferBottomRight));
+    // Blending the opaque parts gives the same result as copying them, but copying doesn't
+    // need to read what is underneath, which is a lot cheaper for the raster engine.
+    if (!opaque.isEmpty()) {
+        const QPainter::CompositionMode compositionMode = painter->compositionMode();
+        painter->setCompositionMode(QPainter::CompositionMode_Source);
+        drawRegion(opaque);
+        painter->setCompositionMode(compositionMode);
     }
+    drawRegion(shape - opaque);
 }
 
 void SceneQPainter::Window::renderDecorationItem(QPainter *painter, DecorationItem *decorationItem) const
@@ -72,6 +72,8 @@ private:
     void renderDecorationItem(QPainter *painter, DecorationItem *decorationItem) const;
     void renderItem(QPainter *painter, Item *item) const;
     SceneQPainter *m_scene;
+    // the render target of translucent windows, kept to avoid reallocating it every frame
+    QImage m_tempImage;
 };
 
 class QPainterEffectFrame : public Scene::EffectFrame
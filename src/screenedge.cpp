@@ -234,13 +234,13 @@ bool Edge::triggersFor(const QPoint &cursorPos) const
     return true;
 }
 
-bool Edge::check(const QPoint &cursorPos, const QDateTime &triggerTime, bool forceNoPushBack)
+bool Edge::check(const QPoint &cursorPos, std::chrono::milliseconds triggerTime, bool forceNoPushBack)
 {
     if (!triggersFor(cursorPos)) {
         return false;
     }
-    if (m_lastTrigger.isValid() && // still in cooldown
-        m_lastTrigger.msecsTo(triggerTime) < edges()->reActivationThreshold() - edges()->timeThreshold()) {
+    if (m_lastTrigger && // still in cooldown
+        (triggerTime - *m_lastTrigger).count() < edges()->reActivationThreshold() - edges()->timeThreshold()) {
         return false;
     }
     // no pushback so we have to activate at once
@@ -256,27 +256,27 @@ bool Edge::check(const QPoint &cursorPos, const QDateTime &triggerTime, bool for
     return false;
 }
 
-void Edge::markAsTriggered(const QPoint &cursorPos, const QDateTime &triggerTime)
+void Edge::markAsTriggered(const QPoint &cursorPos, std::chrono::milliseconds triggerTime)
 {
     m_lastTrigger = triggerTime;
-    m_lastReset = QDateTime(); // invalidate
+    m_lastReset.reset(); // invalidate
     m_triggeredPoint = cursorPos;
 }
 
-bool Edge::canActivate(const QPoint &cursorPos, const QDateTime &triggerTime)
+bool Edge::canActivate(const QPoint &cursorPos, std::chrono::milliseconds triggerTime)
 {
     // we check whether either the timer has explicitly been invalidated (successful trigger) or is
     // bigger than the reactivation threshold (activation "aborted", usually due to moving away the cursor
     // from the corner after successful activation)
     // either condition means that "this is the first event in a new attempt"
-    if (!m_lastReset.isValid() || m_lastReset.msecsTo(triggerTime) > edges()->reActivationThreshold()) {
+    if (!m_lastReset || (triggerTime - *m_lastReset).count() > edges()->reActivationThreshold()) {
         m_lastReset = triggerTime;
         return false;
     }
-    if (m_lastTrigger.isValid() && m_lastTrigger.msecsTo(triggerTime) < edges()->reActivationThreshold() - edges()->timeThreshold()) {
+    if (m_lastTrigger && (triggerTime - *m_lastTrigger).count() < edges()->reActivationThreshold() - edges()->timeThreshold()) {
         return false;
     }
-    if (m_lastReset.msecsTo(triggerTime) < edges()->timeThreshold()) {
+    if ((triggerTime - *m_lastReset).count() < edges()->timeThreshold()) {
         return false;
     }
     // does the check on position make any sense at all?
@@ -1015,11 +1015,19 @@ void ScreenEdges::recreateEdges()
 {
     QList<Edge*> oldEdges(m_edges);
     m_edges.clear();
+    m_edgeFreeAreas.clear();
     const QRect fullArea = workspace()->geometry();
     QRegion processedRegion;
 
+    // all edges and their approach areas lie within this distance from the output borders
+    const int edgeDistance = std::max(m_cornerOffset, TOUCH_TARGET);
     const auto outputs = kwinApp()->platform()->enabledOutputs();
     for (const AbstractOutput *output : outputs) {
+        const QRect edgeFreeArea = output->geometry().adjusted(edgeDistance, edgeDistance, -edgeDistance, -edgeDistance);
+        if (edgeFreeArea.isValid()) {
+            m_edgeFreeAreas.append(edgeFreeArea);
+        }
+
         const QRegion screen = QRegion(output->geometry()).subtracted(processedRegion);
         processedRegion += screen;
         for (const QRect &screenPart : screen) {
@@ -1365,8 +1373,21 @@ void ScreenEdges::deleteEdgeForClient(AbstractClient* c)
     }
 }
 
-void ScreenEdges::check(const QPoint &pos, const QDateTime &now, bool forceNoPushBack)
+bool ScreenEdges::isNearEdges(const QPoint &pos) const
+{
+    for (const QRect &area : m_edgeFreeAreas) {
+        if (area.contains(pos)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ScreenEdges::check(const QPoint &pos, std::chrono::milliseconds now, bool forceNoPushBack)
 {
+    if (!isNearEdges(pos)) {
+        return;
+    }
     bool activatedForClient = false;
     for (auto it = m_edges.begin(); it != m_edges.end(); ++it) {
         if (!(*it)->isReserved()) {
@@ -1395,6 +1416,15 @@ bool ScreenEdges::isEntered(QMouseEvent *event)
     if (event->type() != QEvent::MouseMove) {
         return false;
     }
+    // Nothing to do while the pointer stays away from all edges. The first event after the
+    // pointer has left them still has to go through all edges, so that they stop approaching.
+    const bool nearEdges = isNearEdges(event->globalPos());
+    if (!nearEdges && !m_pointerNearEdges) {
+        return false;
+    }
+    m_pointerNearEdges = nearEdges;
+
+    const std::chrono::milliseconds timestamp(event->timestamp());
     bool activated = false;
     bool activatedForClient = false;
     for (auto it = m_edges.begin(); it != m_edges.end(); ++it) {
@@ -1417,7 +1447,7 @@ bool ScreenEdges::isEntered(QMouseEvent *event)
             }
         }
         if (edge->geometry().contains(event->globalPos())) {
-            if (edge->check(event->globalPos(), QDateTime::fromMSecsSinceEpoch(event->timestamp(), Qt::UTC))) {
+            if (edge->check(event->globalPos(), timestamp)) {
                 if (edge->client()) {
                     activatedForClient = true;
                 }
@@ -1427,14 +1457,14 @@ bool ScreenEdges::isEntered(QMouseEvent *event)
     if (activatedForClient) {
         for (auto it = m_edges.constBegin(); it != m_edges.constEnd(); ++it) {
             if ((*it)->client()) {
-                (*it)->markAsTriggered(event->globalPos(), QDateTime::fromMSecsSinceEpoch(event->timestamp(), Qt::UTC));
+                (*it)->markAsTriggered(event->globalPos(), timestamp);
             }
         }
     }
     return activated;
 }
 
-bool ScreenEdges::handleEnterNotifiy(xcb_window_t window, const QPoint &point, const QDateTime &timestamp)
+bool ScreenEdges::handleEnterNotifiy(xcb_window_t window, const QPoint &point, std::chrono::milliseconds timestamp)
 {
     bool activated = false;
     bool activatedForClient = false;
@@ -1483,7 +1513,7 @@ bool ScreenEdges::handleDndNotify(xcb_window_t window, const QPoint &point)
         }
         if (edge->isReserved() && edge->window() == window) {
             updateXTime();
-            edge->check(point, QDateTime::fromMSecsSinceEpoch(xTime(), Qt::UTC), true);
+            edge->check(point, std::chrono::milliseconds(xTime()), true);
             return true;
         }
     }
@@ -25,9 +25,11 @@
 // Qt
 #include <QObject>
 #include <QVector>
-#include <QDateTime>
 #include <QRect>
 
+#include <chrono>
+#include <optional>
+
 class QAction;
 class QMouseEvent;
 
@@ -51,8 +53,8 @@ public:
     bool isCorner() const;
     bool isScreenEdge() const;
     bool triggersFor(const QPoint &cursorPos) const;
-    bool check(const QPoint &cursorPos, const QDateTime &triggerTime, bool forceNoPushBack = false);
-    void markAsTriggered(const QPoint &cursorPos, const QDateTime &triggerTime);
+    bool check(const QPoint &cursorPos, std::chrono::milliseconds triggerTime, bool forceNoPushBack = false);
+    void markAsTriggered(const QPoint &cursorPos, std::chrono::milliseconds triggerTime);
     bool isReserved() const;
     const QRect &approachGeometry() const;
 
@@ -113,7 +115,7 @@ protected:
 private:
     void activate();
     void deactivate();
-    bool canActivate(const QPoint &cursorPos, const QDateTime &triggerTime);
+    bool canActivate(const QPoint &cursorPos, std::chrono::milliseconds triggerTime);
     void handle(const QPoint &cursorPos);
     bool handleAction(ElectricBorderAction action);
     bool handlePointerAction() {
@@ -133,8 +135,8 @@ private:
     int m_reserved;
     QRect m_geometry;
     QRect m_approachGeometry;
-    QDateTime m_lastTrigger;
-    QDateTime m_lastReset;
+    std::optional<std::chrono::milliseconds> m_lastTrigger;
+    std::optional<std::chrono::milliseconds> m_lastReset;
     QPoint m_triggeredPoint;
     QHash<QObject *, QByteArray> m_callBacks;
     bool m_approaching;
@@ -219,10 +221,10 @@ public:
      * Check, if a screen edge is entered and trigger the appropriate action
      * if one is enabled for the current region and the timeout is satisfied
      * @param pos the position of the mouse pointer
-     * @param now the time when the function is called
+     * @param now the timestamp of the event, in milliseconds
      * @param forceNoPushBack needs to be called to workaround some DnD clients, don't use unless you want to chek on a DnD event
      */
-    void check(const QPoint& pos, const QDateTime &now, bool forceNoPushBack = false);
+    void check(const QPoint& pos, std::chrono::milliseconds now, bool forceNoPushBack = false);
     /**
      * The (dpi dependent) length, reserved for the active corners of each edge - 1/3"
      */
@@ -335,7 +337,7 @@ public:
     }
 
     bool handleDndNotify(xcb_window_t window, const QPoint &point);
-    bool handleEnterNotifiy(xcb_window_t window, const QPoint &point, const QDateTime &timestamp);
+    bool handleEnterNotifiy(xcb_window_t window, const QPoint &point, std::chrono::milliseconds timestamp);
 
 public Q_SLOTS:
     void reconfigure();
@@ -378,6 +380,7 @@ private:
     ElectricBorderAction actionForTouchEdge(Edge *edge) const;
     void createEdgeForClient(AbstractClient *client, ElectricBorder border);
     void deleteEdgeForClient(AbstractClient *client);
+    bool isNearEdges(const QPoint &pos) const;
     bool m_desktopSwitching;
     bool m_desktopSwitchingMovingClients;
     QSize m_cursorPushBackDistance;
@@ -396,6 +399,9 @@ private:
     ElectricBorderAction m_actionLeft;
     QMap<ElectricBorder, ElectricBorderAction> m_touchActions;
     int m_cornerOffset;
+    // The parts of the outputs which are too far away from the borders to touch any edge
+    QVector<QRect> m_edgeFreeAreas;
+    bool m_pointerNearEdges = true;
     GestureRecognizer *m_gestureRecognizer;
 
     KWIN_SINGLETON(ScreenEdges)
@@ -12,6 +12,7 @@
 #include <QDBusConnection>
 #include <QDBusMessage>
 #include <QDBusPendingCall>
+#include <QFutureWatcher>
 
 namespace KWin {
 
@@ -36,11 +37,17 @@ void DBusCall::call()
             Q_EMIT failed();
             return;
         }
-        QVariantList reply = watcher->reply().arguments();
-        std::for_each(reply.begin(), reply.end(), [](QVariant &variant) {
-            variant = dbusToVariant(variant);
+        const QFuture<QVariantList> reply = dbusReplyToVariants(watcher->reply());
+        if (reply.isFinished()) {
+            Q_EMIT finished(reply.result());
+            return;
+        }
+        auto replyWatcher = new QFutureWatcher<QVariantList>(this);
+        connect(replyWatcher, &QFutureWatcherBase::finished, this, [this, replyWatcher]() {
+            replyWatcher->deleteLater();
+            Q_EMIT finished(replyWatcher->result());
         });
-        Q_EMIT finished(reply);
+        replyWatcher->setFuture(reply);
     });
 }
 
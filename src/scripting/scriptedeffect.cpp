@@ -253,6 +253,9 @@ bool ScriptedEffect::init(const QString &effectName, const QString &pathToScript
 
         QStringLiteral("animate"),
         QStringLiteral("set"),
+        QStringLiteral("registerAnimationTemplate"),
+        QStringLiteral("animateTemplate"),
+        QStringLiteral("setTemplate"),
         QStringLiteral("retarget"),
         QStringLiteral("redirect"),
         QStringLiteral("complete"),
@@ -291,27 +294,15 @@ bool ScriptedEffect::isActiveFullScreenEffect() const
     return effects->activeFullScreenEffect() == this;
 }
 
-QJSValue ScriptedEffect::animate_helper(const QJSValue &object, AnimationType animationType)
+bool ScriptedEffect::animationSettingsFromScript(const QJSValue &object, QVector<AnimationSettings> &settings)
 {
-    QJSValue windowProperty = object.property(QStringLiteral("window"));
-    if (!windowProperty.isObject()) {
-        m_engine->throwError(QStringLiteral("Window property missing in animation options"));
-        return QJSValue();
-    }
-
-    EffectWindow *window = qobject_cast<EffectWindow *>(windowProperty.toQObject());
-    if (!window) {
-        m_engine->throwError(QStringLiteral("Window property references invalid window"));
-        return QJSValue();
-    }
-
-    QVector<AnimationSettings> settings{animationSettingsFromObject(object)}; // global
+    settings = {animationSettingsFromObject(object)}; // global
 
     QJSValue animations = object.property(QStringLiteral("animations")); // array
     if (!animations.isUndefined()) {
         if (!animations.isArray()) {
             m_engine->throwError(QStringLiteral("Animations provided but not an array"));
-            return QJSValue();
+            return false;
         }
 
         const int length = static_cast<int>(animations.property(QStringLiteral("length")).toInt());
@@ -323,11 +314,11 @@ QJSValue ScriptedEffect::animate_helper(const QJSValue &object, AnimationType an
                 // Catch show stoppers (incompletable animation)
                 if (!(set & AnimationSettings::Type)) {
                     m_engine->throwError(QStringLiteral("Type property missing in animation options"));
-                    return QJSValue();
+                    return false;
                 }
                 if (!(set & AnimationSettings::Duration)) {
                     m_engine->throwError(QStringLiteral("Duration property missing in animation options"));
-                    return QJSValue();
+                    return false;
                 }
                 // Complete local animations from global settings
                 if (!(s.set & AnimationSettings::Duration)) {
@@ -375,11 +366,11 @@ QJSValue ScriptedEffect::animate_helper(const QJSValue &object, AnimationType an
         const uint set = settings.at(0).set;
         if (!(set & AnimationSettings::Type)) {
             m_engine->throwError(QStringLiteral("Type property missing in animation options"));
-            return QJSValue();
+            return false;
         }
         if (!(set & AnimationSettings::Duration)) {
             m_engine->throwError(QStringLiteral("Duration property missing in animation options"));
-            return QJSValue();
+            return false;
         }
     } else if (!(settings.at(0).set & AnimationSettings::Type)) { // invalid global
         settings.removeAt(0); // -> get rid of it, only used to complete the others
@@ -387,6 +378,28 @@ QJSValue ScriptedEffect::animate_helper(const QJSValue &object, AnimationType an
 
     if (settings.isEmpty()) {
         m_engine->throwError(QStringLiteral("No animations provided"));
+        return false;
+    }
+
+    return true;
+}
+
+QJSValue ScriptedEffect::animate_helper(const QJSValue &object, AnimationType animationType)
+{
+    QJSValue windowProperty = object.property(QStringLiteral("window"));
+    if (!windowProperty.isObject()) {
+        m_engine->throwError(QStringLiteral("Window property missing in animation options"));
+        return QJSValue();
+    }
+
+    EffectWindow *window = qobject_cast<EffectWindow *>(windowProperty.toQObject());
+    if (!window) {
+        m_engine->throwError(QStringLiteral("Window property references invalid window"));
+        return QJSValue();
+    }
+
+    QVector<AnimationSettings> settings;
+    if (!animationSettingsFromScript(object, settings)) {
         return QJSValue();
     }
 
@@ -423,15 +436,21 @@ QJSValue ScriptedEffect::animate_helper(const QJSValue &object, AnimationType an
     return array;
 }
 
-quint64 ScriptedEffect::animate(KWin::EffectWindow *window, KWin::AnimationEffect::Attribute attribute,
-                                int ms, const QJSValue &to, const QJSValue &from, uint metaData, int curve,
-                                int delay, bool fullScreen, bool keepAlive)
+static QEasingCurve easingCurveFromScript(int curve)
 {
     QEasingCurve qec;
     if (curve < QEasingCurve::Custom)
         qec.setType(static_cast<QEasingCurve::Type>(curve));
-    else if (curve == GaussianCurve)
-        qec.setCustomType(qecGaussian);
+    else if (curve == ScriptedEffect::GaussianCurve)
+        qec.setCustomType(AnimationEffect::qecGaussian);
+    return qec;
+}
+
+quint64 ScriptedEffect::animate(KWin::EffectWindow *window, KWin::AnimationEffect::Attribute attribute,
+                                int ms, const QJSValue &to, const QJSValue &from, uint metaData, int curve,
+                                int delay, bool fullScreen, bool keepAlive)
+{
+    const QEasingCurve qec = easingCurveFromScript(curve);
     return AnimationEffect::animate(window, attribute, metaData, ms, fpx2FromScriptValue(to), qec,
                                     delay, fpx2FromScriptValue(from), fullScreen, keepAlive);
 }
@@ -445,11 +464,7 @@ quint64 ScriptedEffect::set(KWin::EffectWindow *window, KWin::AnimationEffect::A
                             int ms, const QJSValue &to, const QJSValue &from, uint metaData, int curve,
                             int delay, bool fullScreen, bool keepAlive)
 {
-    QEasingCurve qec;
-    if (curve < QEasingCurve::Custom)
-        qec.setType(static_cast<QEasingCurve::Type>(curve));
-    else if (curve == GaussianCurve)
-        qec.setCustomType(qecGaussian);
+    const QEasingCurve qec = easingCurveFromScript(curve);
     return AnimationEffect::set(window, attribute, metaData, ms, fpx2FromScriptValue(to), qec,
                                 delay, fpx2FromScriptValue(from), fullScreen, keepAlive);
 }
@@ -459,6 +474,75 @@ QJSValue ScriptedEffect::set(const QJSValue &object)
     return animate_helper(object, AnimationType::Set);
 }
 
+int ScriptedEffect::registerAnimationTemplate(const QJSValue &object)
+{
+    QVector<AnimationSettings> settings;
+    if (!animationSettingsFromScript(object, settings)) {
+        return -1;
+    }
+
+    QVector<AnimationTemplate> animations;
+    animations.reserve(settings.count());
+    for (const AnimationSettings &setting : qAsConst(settings)) {
+        animations.append(AnimationTemplate{
+            setting.type,
+            easingCurveFromScript(setting.curve),
+            fpx2FromScriptValue(setting.from),
+            fpx2FromScriptValue(setting.to),
+            setting.delay,
+            setting.duration,
+            setting.metaData,
+            setting.fullScreenEffect,
+            setting.keepAlive,
+        });
+    }
+
+    m_animationTemplates.append(animations);
+    return m_animationTemplates.count() - 1;
+}
+
+QJSValue ScriptedEffect::startTemplate(EffectWindow *window, int handle, AnimationType animationType)
+{
+    if (!window) {
+        m_engine->throwError(QStringLiteral("Window references invalid window"));
+        return QJSValue();
+    }
+    if (handle < 0 || handle >= m_animationTemplates.count()) {
+        m_engine->throwError(QStringLiteral("Invalid animation template handle"));
+        return QJSValue();
+    }
+
+    const QVector<AnimationTemplate> &animations = m_animationTemplates.at(handle);
+    QJSValue array = m_engine->newArray(animations.count());
+    for (int i = 0; i < animations.count(); ++i) {
+        const AnimationTemplate &animation = animations[i];
+        quint64 animationId;
+        if (animationType == AnimationType::Set) {
+            animationId = AnimationEffect::set(window, animation.type, animation.metaData,
+                                               animation.duration, animation.to, animation.curve,
+                                               animation.delay, animation.from,
+                                               animation.fullScreenEffect, animation.keepAlive);
+        } else {
+            animationId = AnimationEffect::animate(window, animation.type, animation.metaData,
+                                                   animation.duration, animation.to, animation.curve,
+                                                   animation.delay, animation.from,
+                                                   animation.fullScreenEffect, animation.keepAlive);
+        }
+        array.setProperty(i, double(animationId));
+    }
+    return array;
+}
+
+QJSValue ScriptedEffect::animateTemplate(KWin::EffectWindow *window, int handle)
+{
+    return startTemplate(window, handle, AnimationType::Animate);
+}
+
+QJSValue ScriptedEffect::setTemplate(KWin::EffectWindow *window, int handle)
+{
+    return startTemplate(window, handle, AnimationType::Set);
+}
+
 bool ScriptedEffect::retarget(quint64 animationId, const QJSValue &newTarget, int newRemainingTime)
 {
     return AnimationEffect::retarget(animationId, fpx2FromScriptValue(newTarget), newRemainingTime);
@@ -21,6 +21,7 @@ class KPluginMetaData;
 
 namespace KWin
 {
+struct AnimationSettings;
 class KWIN_EXPORT ScriptedEffect : public KWin::AnimationEffect
 {
     Q_OBJECT
@@ -51,7 +52,8 @@ public:
         WindowBlurBehindRole, ///< For single windows to blur behind
         WindowForceBackgroundContrastRole, ///< For fullscreen effects to enforce the background contrast,
         WindowBackgroundContrastRole, ///< For single windows to enable Background contrast
-        LanczosCacheRole
+        LanczosCacheRole,
+        WindowBackgroundContrastMatrixRole, ///< The color matrix of the background contrast
     };
     enum EasingCurve {
         GaussianCurve = 128
@@ -130,6 +132,31 @@ public:
                              bool fullScreen = false, bool keepAlive = true);
     Q_SCRIPTABLE QJSValue set(const QJSValue &object);
 
+    /**
+     * Registers an animation template described by @p object, which takes the same options as
+     * animate(), except for the window. The options are parsed once, so the template can be
+     * started for many windows without walking JavaScript objects every time.
+     *
+     * @returns A handle to pass to animateTemplate() or setTemplate(), or -1 on failure
+     * @since 5.25
+     */
+    Q_SCRIPTABLE int registerAnimationTemplate(const QJSValue &object);
+
+    /**
+     * Starts the animations of the template with the given @p handle on @p window.
+     *
+     * @returns The ids of the started animations
+     * @since 5.25
+     */
+    Q_SCRIPTABLE QJSValue animateTemplate(KWin::EffectWindow *window, int handle);
+
+    /**
+     * Like animateTemplate(), but the animated values persist after the animations end, as with set().
+     *
+     * @since 5.25
+     */
+    Q_SCRIPTABLE QJSValue setTemplate(KWin::EffectWindow *window, int handle);
+
     Q_SCRIPTABLE bool retarget(quint64 animationId, const QJSValue &newTarget,
                                int newRemainingTime = -1);
     Q_SCRIPTABLE bool retarget(const QList<quint64> &animationIds, const QJSValue &newTarget,
@@ -176,7 +203,22 @@ private:
         Set
     };
 
+    struct AnimationTemplate
+    {
+        Attribute type;
+        QEasingCurve curve;
+        FPx2 from;
+        FPx2 to;
+        int delay;
+        uint duration;
+        uint metaData;
+        bool fullScreenEffect;
+        bool keepAlive;
+    };
+
     QJSValue animate_helper(const QJSValue &object, AnimationType animationType);
+    bool animationSettingsFromScript(const QJSValue &object, QVector<AnimationSettings> &settings);
+    QJSValue startTemplate(EffectWindow *window, int handle, AnimationType animationType);
 
     QJSEngine *m_engine;
     QString m_effectName;
@@ -186,6 +228,7 @@ private:
     int m_chainPosition;
     QHash<int, QAction*> m_touchScreenEdgeCallbacks;
     Effect *m_activeFullScreenEffect = nullptr;
+    QVector<QVector<AnimationTemplate>> m_animationTemplates;
 };
 
 }
@@ -23,9 +23,12 @@
 #include "v3/clientmodel.h"
 #include "v3/virtualdesktopmodel.h"
 
+#include "abstract_output.h"
 #include "input.h"
 #include "options.h"
+#include "platform.h"
 #include "screenedge.h"
+#include "tilemanager.h"
 #include "virtualdesktops.h"
 #include "workspace.h"
 #include "x11client.h"
@@ -49,6 +52,8 @@
 
 #include "scriptadaptor.h"
 
+#include <chrono>
+
 static QRect scriptValueToRect(const QJSValue &value)
 {
     return QRect(value.property(QStringLiteral("x")).toInt(),
@@ -69,6 +74,45 @@ static QSize scriptValueToSize(const QJSValue &value)
                  value.property(QStringLiteral("height")).toInt());
 }
 
+namespace KWin
+{
+
+/**
+ * Returns the duration of a frame on the fastest enabled output.
+ */
+static std::chrono::nanoseconds frameInterval()
+{
+    int refreshRate = 60000;
+    const auto outputs = kwinApp()->platform()->enabledOutputs();
+    for (const AbstractOutput *output : outputs) {
+        refreshRate = std::max(refreshRate, output->refreshRate());
+    }
+    return std::chrono::nanoseconds(1000000000000ll / refreshRate);
+}
+
+/**
+ * Accounts the time spent in a script callback to the script for the lifetime of the object.
+ */
+class ScriptCallbackScope
+{
+public:
+    explicit ScriptCallbackScope(AbstractScript *script)
+        : m_script(script)
+    {
+        m_timer.start();
+    }
+    ~ScriptCallbackScope()
+    {
+        m_script->accountCallback(m_timer.nsecsElapsed());
+    }
+
+private:
+    AbstractScript *m_script;
+    QElapsedTimer m_timer;
+};
+
+}
+
 KWin::AbstractScript::AbstractScript(int id, QString scriptName, QString pluginName, QObject *parent)
     : QObject(parent)
     , m_scriptId(id)
@@ -98,11 +142,52 @@ void KWin::AbstractScript::stop()
     deleteLater();
 }
 
+void KWin::AbstractScript::accountCallback(qint64 nsecs)
+{
+    m_callbackTime += nsecs;
+    ++m_callbackCount;
+
+    static const qint64 budget = qEnvironmentVariableIntValue("KWIN_SCRIPT_FRAME_BUDGET") * 1000000ll;
+    if (budget <= 0) {
+        return;
+    }
+
+    if (!m_frameTimer.isValid() || m_frameTimer.nsecsElapsed() >= frameInterval().count()) {
+        m_frameTimer.start();
+        m_frameCallbackTime = 0;
+    }
+
+    const bool withinBudget = m_frameCallbackTime <= budget;
+    m_frameCallbackTime += nsecs;
+    if (withinBudget && m_frameCallbackTime > budget) {
+        ++m_budgetOverruns;
+        // Avoid flooding the log with a script that is constantly over budget.
+        if (m_budgetOverruns == 1 || m_budgetOverruns % 100 == 0) {
+            qCWarning(KWIN_SCRIPTING, "%s exceeded its frame budget of %lld ms (%lld times so far)",
+                      qPrintable(m_pluginName), budget / 1000000, m_budgetOverruns);
+        }
+    }
+}
+
 KWin::ScriptTimer::ScriptTimer(QObject *parent)
     : QTimer(parent)
 {
 }
 
+void KWin::ScriptTimer::timerEvent(QTimerEvent *event)
+{
+    // The engine of a script is owned by the script, use that to find who the timer belongs to.
+    const QJSEngine *engine = qjsEngine(this);
+    AbstractScript *script = engine ? qobject_cast<AbstractScript *>(engine->parent()) : nullptr;
+    if (!script) {
+        QTimer::timerEvent(event);
+        return;
+    }
+
+    ScriptCallbackScope scope(script);
+    QTimer::timerEvent(event);
+}
+
 KWin::Script::Script(int id, QString scriptName, QString pluginName, QObject* parent)
     : AbstractScript(id, scriptName, pluginName, parent)
     , m_engine(new QJSEngine(this))
@@ -120,6 +205,7 @@ KWin::Script::Script(int id, QString scriptName, QString pluginName, QObject* pa
     }
 
     qRegisterMetaType<QList<KWin::AbstractClient *>>();
+    qRegisterMetaType<QList<KWin::Tile *>>();
 }
 
 KWin::Script::~Script()
@@ -207,6 +293,8 @@ void KWin::Script::slotScriptLoadedFromFile()
         QStringLiteral("registerTouchScreenEdge"),
         QStringLiteral("unregisterTouchScreenEdge"),
         QStringLiteral("registerUserActionsMenu"),
+
+        QStringLiteral("connectCoalesced"),
     };
 
     for (const QString &propertyName : globalProperties) {
@@ -237,7 +325,10 @@ void KWin::Script::slotScriptLoadedFromFile()
     )"));
     Q_ASSERT(!result.isError());
 
-    result = m_engine->evaluate(QString::fromUtf8(watcher->result()), fileName());
+    {
+        ScriptCallbackScope scope(this);
+        result = m_engine->evaluate(QString::fromUtf8(watcher->result()), fileName());
+    }
     if (result.isError()) {
         qCWarning(KWIN_SCRIPTING, "%s:%d: error: %s", qPrintable(fileName()),
                   result.property(QStringLiteral("lineNumber")).toInt(),
@@ -261,11 +352,11 @@ QVariant KWin::Script::readConfig(const QString &key, const QVariant &defaultVal
     return config().readEntry(key, defaultValue);
 }
 
-void KWin::Script::callDBus(const QString &service, const QString &path, const QString &interface,
-                            const QString &method, const QJSValue &arg1, const QJSValue &arg2,
-                            const QJSValue &arg3, const QJSValue &arg4, const QJSValue &arg5,
-                            const QJSValue &arg6, const QJSValue &arg7, const QJSValue &arg8,
-                            const QJSValue &arg9)
+QJSValue KWin::Script::callDBus(const QString &service, const QString &path, const QString &interface,
+                                const QString &method, const QJSValue &arg1, const QJSValue &arg2,
+                                const QJSValue &arg3, const QJSValue &arg4, const QJSValue &arg5,
+                                const QJSValue &arg6, const QJSValue &arg7, const QJSValue &arg8,
+                                const QJSValue &arg9)
 {
     QJSValueList jsArguments;
     jsArguments.reserve(9);
@@ -313,27 +404,74 @@ void KWin::Script::callDBus(const QString &service, const QString &path, const Q
     message.setArguments(dbusArguments);
 
     const QDBusPendingCall call = QDBusConnection::sessionBus().asyncCall(message);
+
+    // Without a callback, hand out a promise that settles with the reply instead.
+    QJSValue promise;
     if (callback.isUndefined()) {
-        return;
+        if (m_promiseFactory.isUndefined()) {
+            m_promiseFactory = m_engine->evaluate(QStringLiteral(R"(
+                (function() {
+                    var deferred = {};
+                    deferred.promise = new Promise(function(resolve, reject) {
+                        deferred.resolve = resolve;
+                        deferred.reject = reject;
+                    });
+                    return deferred;
+                })
+            )"));
+        }
+        promise = m_promiseFactory.call();
     }
 
+    // The watchers are owned by the script, so replies that arrive after it has been
+    // stopped are dropped.
     QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(call, this);
-    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, callback](QDBusPendingCallWatcher *self) {
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, callback, promise](QDBusPendingCallWatcher *self) {
         self->deleteLater();
 
         if (self->isError()) {
             qCDebug(KWIN_SCRIPTING) << "Received D-Bus message is error";
+            if (promise.isObject()) {
+                ScriptCallbackScope scope(this);
+                promise.property(QStringLiteral("reject")).call({self->error().message()});
+            }
             return;
         }
 
-        QJSValueList arguments;
-        const QVariantList reply = self->reply().arguments();
-        for (const QVariant &variant : reply) {
-            arguments << m_engine->toScriptValue(dbusToVariant(variant));
-        }
+        auto deliver = [this, callback, promise](const QVariantList &reply) {
+            QJSValueList arguments;
+            for (const QVariant &variant : reply) {
+                arguments << m_engine->toScriptValue(variant);
+            }
+
+            ScriptCallbackScope scope(this);
+            if (promise.isObject()) {
+                QJSValue value;
+                if (arguments.count() == 1) {
+                    value = arguments.first();
+                } else if (arguments.count() > 1) {
+                    value = m_engine->toScriptValue(reply);
+                }
+                promise.property(QStringLiteral("resolve")).call({value});
+            } else {
+                QJSValue(callback).call(arguments);
+            }
+        };
 
-        QJSValue(callback).call(arguments);
+        const QFuture<QVariantList> reply = dbusReplyToVariants(self->reply());
+        if (reply.isFinished()) {
+            deliver(reply.result());
+            return;
+        }
+        auto replyWatcher = new QFutureWatcher<QVariantList>(this);
+        connect(replyWatcher, &QFutureWatcherBase::finished, this, [replyWatcher, deliver]() {
+            replyWatcher->deleteLater();
+            deliver(replyWatcher->result());
+        });
+        replyWatcher->setFuture(reply);
     });
+
+    return promise.isObject() ? promise.property(QStringLiteral("promise")) : QJSValue();
 }
 
 bool KWin::Script::registerShortcut(const QString &objectName, const QString &text, const QString &keySequence, const QJSValue &callback)
@@ -352,6 +490,7 @@ bool KWin::Script::registerShortcut(const QString &objectName, const QString &te
     input()->registerShortcut(shortcut, action);
 
     connect(action, &QAction::triggered, this, [this, action, callback]() {
+        ScriptCallbackScope scope(this);
         QJSValue(callback).call({ m_engine->toScriptValue(action) });
     });
 
@@ -402,7 +541,8 @@ bool KWin::Script::registerTouchScreenEdge(int edge, const QJSValue &callback)
     ScreenEdges::self()->reserveTouch(KWin::ElectricBorder(edge), action);
     m_touchScreenEdgeCallbacks.insert(edge, action);
 
-    connect(action, &QAction::triggered, this, [callback]() {
+    connect(action, &QAction::triggered, this, [this, callback]() {
+        ScriptCallbackScope scope(this);
         QJSValue(callback).call();
     });
 
@@ -431,12 +571,69 @@ void KWin::Script::registerUserActionsMenu(const QJSValue &callback)
     m_userActionsMenuCallbacks.append(callback);
 }
 
+bool KWin::Script::connectCoalesced(QObject *object, const QString &property, const QJSValue &callback)
+{
+    if (!object) {
+        m_engine->throwError(QStringLiteral("Coalesced connection requires an object"));
+        return false;
+    }
+    if (!callback.isCallable()) {
+        m_engine->throwError(QStringLiteral("Coalesced property handler must be callable"));
+        return false;
+    }
+
+    // Subclasses may redeclare a property without the notify signal, e.g. frameGeometry in
+    // AbstractClient, so look for any declaration of the property that can be watched.
+    const QMetaObject *metaObject = object->metaObject();
+    const QByteArray propertyName = property.toLatin1();
+    QMetaProperty metaProperty;
+    for (int i = metaObject->propertyCount() - 1; i >= 0; --i) {
+        const QMetaProperty candidate = metaObject->property(i);
+        if (propertyName == candidate.name() && candidate.hasNotifySignal()) {
+            metaProperty = candidate;
+            break;
+        }
+    }
+    if (!metaProperty.isValid()) {
+        m_engine->throwError(QStringLiteral("%1 has no notifiable property %2").arg(metaObject->className(), property));
+        return false;
+    }
+
+    const bool watchingObject = std::any_of(m_coalescedCallbacks.keyBegin(), m_coalescedCallbacks.keyEnd(), [object](const CoalescedKey &key) {
+        return key.first == object;
+    });
+    if (!watchingObject) {
+        connect(object, &QObject::destroyed, this, [this](QObject *object) {
+            for (auto it = m_coalescedCallbacks.begin(); it != m_coalescedCallbacks.end();) {
+                if (it.key().first == object) {
+                    m_pendingCoalescedKeys.remove(it.key());
+                    m_pendingCoalesced.removeOne(it.key());
+                    it = m_coalescedCallbacks.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        });
+    }
+
+    const CoalescedKey key(object, metaProperty.notifySignalIndex());
+    QVector<CoalescedCallback> &callbacks = m_coalescedCallbacks[key];
+    if (callbacks.isEmpty()) {
+        const int slotIndex = staticMetaObject.indexOfSlot("slotCoalescedPropertyChanged()");
+        QMetaObject::connect(object, key.second, this, slotIndex);
+    }
+    callbacks.append(CoalescedCallback{metaProperty, callback});
+
+    return true;
+}
+
 QList<QAction *> KWin::Script::actionsForUserActionMenu(KWin::AbstractClient *client, QMenu *parent)
 {
     QList<QAction *> actions;
     actions.reserve(m_userActionsMenuCallbacks.count());
 
     for (QJSValue callback : qAsConst(m_userActionsMenuCallbacks)) {
+        ScriptCallbackScope scope(this);
         const QJSValue result = callback.call({ m_engine->toScriptValue(client) });
         if (result.isError()) {
             continue;
@@ -458,12 +655,55 @@ bool KWin::Script::slotBorderActivated(ElectricBorder border)
     if (callbacks.isEmpty()) {
         return false;
     }
+    ScriptCallbackScope scope(this);
     std::for_each(callbacks.begin(), callbacks.end(), [](QJSValue callback) {
         callback.call();
     });
     return true;
 }
 
+void KWin::Script::slotCoalescedPropertyChanged()
+{
+    const CoalescedKey key(sender(), senderSignalIndex());
+    if (m_pendingCoalescedKeys.contains(key)) {
+        return;
+    }
+    m_pendingCoalescedKeys.insert(key);
+    m_pendingCoalesced.append(key);
+
+    if (!m_coalesceTimer) {
+        m_coalesceTimer = new QTimer(this);
+        m_coalesceTimer->setSingleShot(true);
+        connect(m_coalesceTimer, &QTimer::timeout, this, &Script::flushCoalescedProperties);
+    }
+    if (!m_coalesceTimer->isActive()) {
+        // Deliver at most once per frame of the fastest output.
+        const auto interval = std::chrono::duration_cast<std::chrono::milliseconds>(frameInterval());
+        m_coalesceTimer->start(std::max(std::chrono::milliseconds(1), interval));
+    }
+}
+
+void KWin::Script::flushCoalescedProperties()
+{
+    const QVector<CoalescedKey> pending = std::exchange(m_pendingCoalesced, {});
+    m_pendingCoalescedKeys.clear();
+
+    for (const CoalescedKey &key : pending) {
+        // A callback may have destroyed the object of a later entry.
+        const auto it = m_coalescedCallbacks.constFind(key);
+        if (it == m_coalescedCallbacks.constEnd()) {
+            continue;
+        }
+        const QVector<CoalescedCallback> callbacks = it.value();
+        ScriptCallbackScope scope(this);
+        const QJSValue object = m_engine->toScriptValue(key.first);
+        for (const CoalescedCallback &coalesced : callbacks) {
+            const QJSValue value = m_engine->toScriptValue(coalesced.property.read(key.first));
+            QJSValue(coalesced.callback).call({value, object});
+        }
+    }
+}
+
 QAction *KWin::Script::scriptValueToAction(const QJSValue &value, QMenu *parent)
 {
     const QString title = value.property(QStringLiteral("text")).toString();
@@ -495,6 +735,7 @@ QAction *KWin::Script::createAction(const QString &title, const QJSValue &item,
     action->setChecked(checked);
 
     connect(action, &QAction::triggered, this, [this, action, callback]() {
+        ScriptCallbackScope scope(this);
         QJSValue(callback).call({ m_engine->toScriptValue(action) });
     });
 
@@ -544,7 +785,9 @@ void KWin::DeclarativeScript::run()
         return;
     }
 
-    m_component->loadUrl(QUrl::fromLocalFile(fileName()));
+    // Compile asynchronously so that several declarative scripts do not block startup. The
+    // shared engine keeps compiled QML in Qt's disk cache, so subsequent starts skip compiling.
+    m_component->loadUrl(QUrl::fromLocalFile(fileName()), QQmlComponent::Asynchronous);
     if (m_component->isLoading()) {
         connect(m_component, &QQmlComponent::statusChanged, this, &DeclarativeScript::createComponent);
     } else {
@@ -606,6 +849,7 @@ bool KWin::JSEngineGlobalMethodsWrapper::registerShortcut(const QString &name, c
     connect(a, &QAction::triggered, this, [=]() mutable {
         QJSValueList arguments;
         arguments << Scripting::self()->qmlEngine()->toScriptValue(a);
+        ScriptCallbackScope scope(m_script);
         function.call(arguments);
     });
     return true;
@@ -14,7 +14,10 @@
 
 #include <kwinglobals.h>
 
+#include <QElapsedTimer>
 #include <QHash>
+#include <QMetaProperty>
+#include <QSet>
 #include <QStringList>
 #include <QJSEngine>
 #include <QJSValue>
@@ -43,6 +46,21 @@ class QtScriptWorkspaceWrapper;
 class KWIN_EXPORT AbstractScript : public QObject
 {
     Q_OBJECT
+    /**
+     * Total time spent in callbacks of the script, in microseconds.
+     * @since 5.25
+     */
+    Q_PROPERTY(qlonglong callbackTime READ callbackTime)
+    /**
+     * Number of callbacks of the script that have been invoked.
+     * @since 5.25
+     */
+    Q_PROPERTY(qlonglong callbackCount READ callbackCount)
+    /**
+     * Number of frames in which the script exceeded the callback budget.
+     * @since 5.25
+     */
+    Q_PROPERTY(qlonglong budgetOverruns READ budgetOverruns)
 public:
     AbstractScript(int id, QString scriptName, QString pluginName, QObject *parent = nullptr);
     ~AbstractScript() override;
@@ -61,6 +79,23 @@ public:
 
     KConfigGroup config() const;
 
+    qlonglong callbackTime() const {
+        return m_callbackTime / 1000;
+    }
+    qlonglong callbackCount() const {
+        return m_callbackCount;
+    }
+    qlonglong budgetOverruns() const {
+        return m_budgetOverruns;
+    }
+
+    /**
+     * Accounts @p nsecs spent in a callback of the script. If the time spent in callbacks during
+     * one frame exceeds the budget set with the KWIN_SCRIPT_FRAME_BUDGET environment variable
+     * (in milliseconds), a warning is logged.
+     */
+    void accountCallback(qint64 nsecs);
+
 public Q_SLOTS:
     void stop();
     virtual void run() = 0;
@@ -82,6 +117,11 @@ private:
     QString m_fileName;
     QString m_pluginName;
     bool m_running;
+    qint64 m_callbackTime = 0;
+    qlonglong m_callbackCount = 0;
+    qlonglong m_budgetOverruns = 0;
+    qint64 m_frameCallbackTime = 0;
+    QElapsedTimer m_frameTimer;
 };
 
 /**
@@ -94,6 +134,9 @@ class ScriptTimer : public QTimer
 
 public:
     Q_INVOKABLE ScriptTimer(QObject *parent = nullptr);
+
+protected:
+    void timerEvent(QTimerEvent *event) override;
 };
 
 class Script : public AbstractScript, QDBusContext
@@ -105,17 +148,23 @@ public:
 
     Q_INVOKABLE QVariant readConfig(const QString &key, const QVariant &defaultValue = QVariant());
 
-    Q_INVOKABLE void callDBus(const QString &service, const QString &path,
-                              const QString &interface, const QString &method,
-                              const QJSValue &arg1 = QJSValue(),
-                              const QJSValue &arg2 = QJSValue(),
-                              const QJSValue &arg3 = QJSValue(),
-                              const QJSValue &arg4 = QJSValue(),
-                              const QJSValue &arg5 = QJSValue(),
-                              const QJSValue &arg6 = QJSValue(),
-                              const QJSValue &arg7 = QJSValue(),
-                              const QJSValue &arg8 = QJSValue(),
-                              const QJSValue &arg9 = QJSValue());
+    /**
+     * Calls the D-Bus @p method asynchronously. If the last argument is a function, it is
+     * invoked with the reply arguments. Otherwise a Promise is returned that resolves with
+     * the reply (a single value, or an array if the reply has several arguments) and rejects
+     * with the error message. Replies that arrive after the script has been stopped are dropped.
+     */
+    Q_INVOKABLE QJSValue callDBus(const QString &service, const QString &path,
+                                  const QString &interface, const QString &method,
+                                  const QJSValue &arg1 = QJSValue(),
+                                  const QJSValue &arg2 = QJSValue(),
+                                  const QJSValue &arg3 = QJSValue(),
+                                  const QJSValue &arg4 = QJSValue(),
+                                  const QJSValue &arg5 = QJSValue(),
+                                  const QJSValue &arg6 = QJSValue(),
+                                  const QJSValue &arg7 = QJSValue(),
+                                  const QJSValue &arg8 = QJSValue(),
+                                  const QJSValue &arg9 = QJSValue());
 
     Q_INVOKABLE bool registerShortcut(const QString &objectName, const QString &text,
                                       const QString &keySequence, const QJSValue &callback);
@@ -137,6 +186,29 @@ public:
      */
     Q_INVOKABLE void registerUserActionsMenu(const QJSValue &callback);
 
+    /**
+     * @brief Registers the given @p callback to be invoked when the @p property of @p object
+     * changes, coalescing repeated changes.
+     *
+     * Unlike connecting to the notify signal directly, the callback is invoked at most once per
+     * frame for every object and property, no matter how often the notify signal is emitted in
+     * between, e.g. during an interactive resize. The callback receives the latest value of the
+     * property and the object as arguments.
+     *
+     * @code
+     * connectCoalesced(client, "frameGeometry", function (geometry, client) {
+     *     // geometry is the current frame geometry of client
+     * });
+     * @endcode
+     *
+     * @param object The object whose property to watch
+     * @param property The name of a property that has a notify signal
+     * @param callback Script method to execute when the property has changed
+     * @return @c true if the callback got registered, otherwise @c false
+     * @since 5.25
+     */
+    Q_INVOKABLE bool connectCoalesced(QObject *object, const QString &property, const QJSValue &callback);
+
     /**
      * @brief Creates actions for the UserActionsMenu by invoking the registered callbacks.
      *
@@ -195,6 +267,16 @@ private Q_SLOTS:
      */
     bool slotBorderActivated(ElectricBorder border);
 
+    /**
+     * Called when a property watched with connectCoalesced has changed.
+     */
+    void slotCoalescedPropertyChanged();
+
+    /**
+     * Invokes the callbacks of all properties that changed since the last flush.
+     */
+    void flushCoalescedProperties();
+
 private:
     /**
      * Read the script from file into a byte array.
@@ -243,6 +325,18 @@ private:
     QHash<int, QJSValueList> m_screenEdgeCallbacks;
     QHash<int, QAction *> m_touchScreenEdgeCallbacks;
     QJSValueList m_userActionsMenuCallbacks;
+    QJSValue m_promiseFactory;
+
+    struct CoalescedCallback
+    {
+        QMetaProperty property;
+        QJSValue callback;
+    };
+    using CoalescedKey = QPair<QObject *, int>;
+    QHash<CoalescedKey, QVector<CoalescedCallback>> m_coalescedCallbacks;
+    QVector<CoalescedKey> m_pendingCoalesced;
+    QSet<CoalescedKey> m_pendingCoalescedKeys;
+    QTimer *m_coalesceTimer = nullptr;
 };
 
 class DeclarativeScript : public AbstractScript
@@ -10,8 +10,10 @@
 #include "scripting_logging.h"
 
 #include <QDBusArgument>
+#include <QDBusMessage>
 #include <QDBusObjectPath>
 #include <QDBusSignature>
+#include <QtConcurrentRun>
 
 namespace KWin
 {
@@ -70,4 +72,30 @@ QVariant dbusToVariant(const QVariant &variant)
     return variant;
 }
 
+static QVariantList convertArguments(QVariantList arguments)
+{
+    for (QVariant &argument : arguments) {
+        argument = dbusToVariant(argument);
+    }
+    return arguments;
+}
+
+QFuture<QVariantList> dbusReplyToVariants(const QDBusMessage &reply)
+{
+    const QVariantList arguments = reply.arguments();
+    const bool needsDemarshaling = std::any_of(arguments.begin(), arguments.end(), [](const QVariant &argument) {
+        return argument.canConvert<QDBusArgument>();
+    });
+    if (needsDemarshaling) {
+        // The arguments keep the message data alive until the worker is done with it.
+        return QtConcurrent::run(convertArguments, arguments);
+    }
+
+    QFutureInterface<QVariantList> interface;
+    interface.reportStarted();
+    interface.reportResult(convertArguments(arguments));
+    interface.reportFinished();
+    return interface.future();
+}
+
 }
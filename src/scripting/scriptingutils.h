@@ -10,13 +10,23 @@
 #ifndef KWIN_SCRIPTINGUTILS_H
 #define KWIN_SCRIPTINGUTILS_H
 
+#include <QFuture>
 #include <QVariant>
 
+class QDBusMessage;
+
 namespace KWin
 {
 
 QVariant dbusToVariant(const QVariant &variant);
 
+/**
+ * Converts all arguments of the D-Bus @p reply with dbusToVariant(). Replies that carry
+ * containers are demarshaled in a worker thread, otherwise the returned future is already
+ * finished.
+ */
+QFuture<QVariantList> dbusReplyToVariants(const QDBusMessage &reply);
+
 } // namespace KWin
 
 #endif // KWIN_SCRIPTINGUTILS_H
@@ -20,6 +20,7 @@
 #include <kwingltexture.h>
 #include <kwinglutils.h>
 
+#include <QElapsedTimer>
 #include <QSGImageNode>
 #include <QRunnable>
 #include <QQuickWindow>
@@ -261,9 +262,188 @@ void ThumbnailItemBase::setClipTo(QQuickItem *clip)
     qCWarning(KWIN_SCRIPTING) << "ThumbnailItem.clipTo is removed and it has no replacements";
 }
 
+// The shortest interval between two updates of a thumbnail of a window that keeps being damaged.
+static const int thumbnailUpdateInterval = 33;
+
+/**
+ * The rendered contents of a window at one texture size. Thumbnail items that show the same
+ * window at the same size, e.g. in the task manager and in the window switcher at the same
+ * time, share one WindowThumbnail, so the window is rendered only once per update.
+ *
+ * The OpenGL context of the scene must be current when a WindowThumbnail is destroyed.
+ */
+class WindowThumbnail
+{
+public:
+    WindowThumbnail(AbstractClient *client, const QSize &size);
+    ~WindowThumbnail();
+
+    static QSharedPointer<WindowThumbnail> get(AbstractClient *client, const QSize &size);
+
+    QSize size() const;
+    QSharedPointer<GLTexture> texture() const;
+    bool isDirty() const;
+    /**
+     * Returns how many milliseconds have to pass before the thumbnail may be rendered again.
+     */
+    qint64 updateDelay() const;
+    void render();
+
+private:
+    AbstractClient *m_key;
+    QPointer<AbstractClient> m_client;
+    QSize m_size;
+    QSharedPointer<GLTexture> m_texture;
+    QScopedPointer<GLRenderTarget> m_target;
+    QElapsedTimer m_lastUpdate;
+    QMetaObject::Connection m_damageConnection;
+    QMetaObject::Connection m_geometryConnection;
+    QMetaObject::Connection m_destroyedConnection;
+    bool m_dirty = true;
+};
+
+static QHash<AbstractClient *, QVector<QWeakPointer<WindowThumbnail>>> s_windowThumbnails;
+
+WindowThumbnail::WindowThumbnail(AbstractClient *client, const QSize &size)
+    : m_key(client)
+    , m_client(client)
+    , m_size(size)
+{
+    const auto markDirty = [this]() {
+        m_dirty = true;
+    };
+    m_damageConnection = QObject::connect(client, &AbstractClient::damaged, markDirty);
+    m_geometryConnection = QObject::connect(client, &AbstractClient::frameGeometryChanged, markDirty);
+
+    // Another client may be allocated at the same address later, it must not find the
+    // thumbnails of this one.
+    m_destroyedConnection = QObject::connect(client, &QObject::destroyed, [client]() {
+        s_windowThumbnails.remove(client);
+    });
+}
+
+WindowThumbnail::~WindowThumbnail()
+{
+    QObject::disconnect(m_damageConnection);
+    QObject::disconnect(m_geometryConnection);
+    QObject::disconnect(m_destroyedConnection);
+
+    auto it = s_windowThumbnails.find(m_key);
+    if (it != s_windowThumbnails.end()) {
+        it->erase(std::remove_if(it->begin(), it->end(), [](const QWeakPointer<WindowThumbnail> &thumbnail) {
+            return thumbnail.isNull();
+        }), it->end());
+        if (it->isEmpty()) {
+            s_windowThumbnails.erase(it);
+        }
+    }
+}
+
+QSharedPointer<WindowThumbnail> WindowThumbnail::get(AbstractClient *client, const QSize &size)
+{
+    QVector<QWeakPointer<WindowThumbnail>> &thumbnails = s_windowThumbnails[client];
+    for (const QWeakPointer<WindowThumbnail> &candidate : qAsConst(thumbnails)) {
+        QSharedPointer<WindowThumbnail> thumbnail = candidate.toStrongRef();
+        if (thumbnail && thumbnail->m_client == client && thumbnail->size() == size) {
+            return thumbnail;
+        }
+    }
+
+    QSharedPointer<WindowThumbnail> thumbnail(new WindowThumbnail(client, size));
+    thumbnails.append(thumbnail);
+    return thumbnail;
+}
+
+QSize WindowThumbnail::size() const
+{
+    return m_size;
+}
+
+QSharedPointer<GLTexture> WindowThumbnail::texture() const
+{
+    return m_texture;
+}
+
+bool WindowThumbnail::isDirty() const
+{
+    return m_dirty;
+}
+
+qint64 WindowThumbnail::updateDelay() const
+{
+    // A window that keeps being damaged, e.g. one that plays a video, doesn't need its
+    // thumbnail to be updated at the full refresh rate.
+    if (!m_texture || !m_lastUpdate.isValid()) {
+        return 0;
+    }
+    return std::max<qint64>(0, thumbnailUpdateInterval - m_lastUpdate.elapsed());
+}
+
+void WindowThumbnail::render()
+{
+    if (!m_client) {
+        return;
+    }
+    m_lastUpdate.start();
+    m_dirty = false;
+
+    if (!m_texture) {
+        m_texture.reset(new GLTexture(GL_RGBA8, m_size));
+        m_texture->setFilter(GL_LINEAR);
+        m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
+        m_target.reset(new GLRenderTarget(*m_texture));
+    }
+
+    const QRect geometry = m_client->visibleGeometry();
+
+    GLRenderTarget::pushRenderTarget(m_target.data());
+    glClearColor(0.0, 0.0, 0.0, 0.0);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    QMatrix4x4 projectionMatrix;
+    projectionMatrix.ortho(geometry.x(), geometry.x() + geometry.width(),
+                           geometry.y(), geometry.y() + geometry.height(), -1, 1);
+
+    EffectWindowImpl *effectWindow = m_client->effectWindow();
+    WindowPaintData data(effectWindow);
+    data.setProjectionMatrix(projectionMatrix);
+
+    // The thumbnail must be rendered using kwin's opengl context as VAOs are not
+    // shared across contexts. Unfortunately, this also introduces a latency of 1
+    // frame, which is not ideal, but it is acceptable for things such as thumbnails.
+    const int mask = Scene::PAINT_WINDOW_TRANSFORMED;
+    effectWindow->sceneWindow()->performPaint(mask, infiniteRegion(), data);
+    GLRenderTarget::popRenderTarget();
+}
+
 WindowThumbnailItem::WindowThumbnailItem(QQuickItem *parent)
     : ThumbnailItemBase(parent)
 {
+    m_updateTimer.setSingleShot(true);
+    connect(&m_updateTimer, &QTimer::timeout, this, &QQuickItem::update);
+    connect(Compositor::self(), &Compositor::aboutToToggleCompositing,
+            this, &WindowThumbnailItem::releaseThumbnail);
+}
+
+WindowThumbnailItem::~WindowThumbnailItem()
+{
+    releaseThumbnail();
+}
+
+void WindowThumbnailItem::releaseThumbnail()
+{
+    if (!m_thumbnail) {
+        return;
+    }
+    // This may be the last reference to the thumbnail, which frees its GL resources.
+    Scene *scene = Compositor::compositing() ? Compositor::self()->scene() : nullptr;
+    if (scene) {
+        scene->makeOpenGLContextCurrent();
+    }
+    m_thumbnail.reset();
+    if (scene) {
+        scene->doneOpenGLContextCurrent();
+    }
 }
 
 QUuid WindowThumbnailItem::wId() const
@@ -304,7 +484,10 @@ void WindowThumbnailItem::setClient(AbstractClient *client)
                    this, &WindowThumbnailItem::invalidateOffscreenTexture);
         disconnect(m_client, &AbstractClient::frameGeometryChanged,
                 this, &WindowThumbnailItem::updateImplicitSize);
+        disconnect(m_client, &QObject::destroyed,
+                   this, &WindowThumbnailItem::releaseThumbnail);
     }
+    releaseThumbnail();
     m_client = client;
     if (m_client) {
         connect(m_client, &AbstractClient::frameGeometryChanged,
@@ -313,6 +496,8 @@ void WindowThumbnailItem::setClient(AbstractClient *client)
                 this, &WindowThumbnailItem::invalidateOffscreenTexture);
         connect(m_client, &AbstractClient::frameGeometryChanged,
                 this, &WindowThumbnailItem::updateImplicitSize);
+        connect(m_client, &QObject::destroyed,
+                this, &WindowThumbnailItem::releaseThumbnail);
         setWId(m_client->internalId());
     } else {
         setWId(QUuid());
@@ -381,14 +566,24 @@ void WindowThumbnailItem::invalidateOffscreenTexture()
     update();
 }
 
-void WindowThumbnailItem::updateOffscreenTexture()
+void WindowThumbnailItem::geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry)
 {
-    if (m_acquireFence || !m_dirty || !m_client) {
-        return;
+    ThumbnailItemBase::geometryChanged(newGeometry, oldGeometry);
+
+    // The thumbnail only has to be rendered again if it doesn't fit the new size anymore.
+    if (m_client && m_offscreenTexture && window() && m_offscreenTexture->size() != textureSize()) {
+        invalidateOffscreenTexture();
     }
-    Q_ASSERT(window());
+}
 
+QSize WindowThumbnailItem::textureSize() const
+{
+    if (!m_client) {
+        return QSize();
+    }
     const QRect geometry = m_client->visibleGeometry();
+    const qreal devicePixelRatio = window() ? window()->devicePixelRatio() : 1;
+
     QSize textureSize = geometry.size();
     if (sourceSize().width() > 0) {
         textureSize.setWidth(sourceSize().width());
@@ -396,38 +591,59 @@ void WindowThumbnailItem::updateOffscreenTexture()
     if (sourceSize().height() > 0) {
         textureSize.setHeight(sourceSize().height());
     }
+    textureSize *= devicePixelRatio;
 
-    m_devicePixelRatio = window()->devicePixelRatio();
-    textureSize *= m_devicePixelRatio;
+    if (sourceSize().width() > 0 || sourceSize().height() > 0 || boundingRect().isEmpty()) {
+        return textureSize;
+    }
 
-    if (!m_offscreenTexture || m_offscreenTexture->size() != textureSize) {
-        m_offscreenTexture.reset(new GLTexture(GL_RGBA8, textureSize));
-        m_offscreenTexture->setFilter(GL_LINEAR);
-        m_offscreenTexture->setWrapMode(GL_CLAMP_TO_EDGE);
-        m_offscreenTarget.reset(new GLRenderTarget(*m_offscreenTexture));
+    // Rendering a big window at its full size only to show it scaled down wastes a lot of
+    // bandwidth. The window is rendered at its size divided by the largest power of two that
+    // still covers the painted size instead, so the texture is not reallocated on every frame
+    // while the thumbnail is animated.
+    const QRect frameGeometry = m_client->frameGeometry();
+    if (frameGeometry.isEmpty()) {
+        return textureSize;
     }
+    const qreal scale = qMin(boundingRect().width() / frameGeometry.width(),
+                             boundingRect().height() / frameGeometry.height());
+    const QSizeF paintedSize = QSizeF(geometry.size()) * scale * devicePixelRatio;
+    while (textureSize.width() / 2 >= paintedSize.width() && textureSize.height() / 2 >= paintedSize.height()
+           && textureSize.width() > 1 && textureSize.height() > 1) {
+        textureSize /= 2;
+    }
+    return textureSize;
+}
 
-    GLRenderTarget::pushRenderTarget(m_offscreenTarget.data());
-    glClearColor(0.0, 0.0, 0.0, 0.0);
-    glClear(GL_COLOR_BUFFER_BIT);
+void WindowThumbnailItem::updateOffscreenTexture()
+{
+    if (m_acquireFence || !m_dirty || !m_client) {
+        return;
+    }
+    Q_ASSERT(window());
 
-    QMatrix4x4 projectionMatrix;
-    projectionMatrix.ortho(geometry.x(), geometry.x() + geometry.width(),
-                           geometry.y(), geometry.y() + geometry.height(), -1, 1);
+    const QSize textureSize = this->textureSize();
+    if (!m_thumbnail || m_thumbnail->size() != textureSize) {
+        m_thumbnail = WindowThumbnail::get(m_client, textureSize);
+    }
 
-    EffectWindowImpl *effectWindow = m_client->effectWindow();
-    WindowPaintData data(effectWindow);
-    data.setProjectionMatrix(projectionMatrix);
+    if (m_thumbnail->isDirty()) {
+        const qint64 delay = m_thumbnail->updateDelay();
+        if (delay > 0) {
+            if (!m_updateTimer.isActive()) {
+                m_updateTimer.start(delay);
+            }
+            return;
+        }
+        m_thumbnail->render();
+    }
 
-    // The thumbnail must be rendered using kwin's opengl context as VAOs are not
-    // shared across contexts. Unfortunately, this also introduces a latency of 1
-    // frame, which is not ideal, but it is acceptable for things such as thumbnails.
-    const int mask = Scene::PAINT_WINDOW_TRANSFORMED;
-    effectWindow->sceneWindow()->performPaint(mask, infiniteRegion(), data);
-    GLRenderTarget::popRenderTarget();
+    m_devicePixelRatio = window()->devicePixelRatio();
+    m_offscreenTexture = m_thumbnail->texture();
 
     // The fence is needed to avoid the case where qtquick renderer starts using
-    // the texture while all rendering commands to it haven't completed yet.
+    // the texture while all rendering commands to it haven't completed yet. It also
+    // covers a thumbnail that has been rendered for another item in this frame.
     m_dirty = false;
     m_acquireFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
 
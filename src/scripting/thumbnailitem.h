@@ -8,6 +8,7 @@
 #pragma once
 
 #include <QQuickItem>
+#include <QTimer>
 #include <QUuid>
 
 #include <epoxy/gl.h>
@@ -18,6 +19,7 @@ class AbstractClient;
 class GLRenderTarget;
 class GLTexture;
 class ThumbnailTextureProvider;
+class WindowThumbnail;
 
 class ThumbnailItemBase : public QQuickItem
 {
@@ -95,6 +97,7 @@ class WindowThumbnailItem : public ThumbnailItemBase
 
 public:
     explicit WindowThumbnailItem(QQuickItem *parent = nullptr);
+    ~WindowThumbnailItem() override;
 
     QUuid wId() const;
     void setWId(const QUuid &wId);
@@ -112,11 +115,19 @@ protected:
     void invalidateOffscreenTexture() override;
     void updateOffscreenTexture() override;
     void updateImplicitSize();
+    void geometryChanged(const QRectF &newGeometry, const QRectF &oldGeometry) override;
 
 private:
+    QSize textureSize() const;
+    void releaseThumbnail();
+
     QUuid m_wId;
     QPointer<AbstractClient> m_client;
     bool m_dirty = false;
+    // shared with all other thumbnail items that show the window at the same size
+    QSharedPointer<WindowThumbnail> m_thumbnail;
+    // retries when the shared thumbnail was updated too recently
+    QTimer m_updateTimer;
 };
 
 class DesktopThumbnailItem : public ThumbnailItemBase
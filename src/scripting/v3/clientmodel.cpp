@@ -28,8 +28,27 @@ ClientModel::ClientModel(QObject *parent)
 
 void ClientModel::markRoleChanged(AbstractClient *client, int role)
 {
-    const QModelIndex row = index(m_clients.indexOf(client), 0);
-    Q_EMIT dataChanged(row, row, {role});
+    // Changes are batched per event loop iteration so views rebind each row only once.
+    if (m_pendingRoleChanges.isEmpty()) {
+        QMetaObject::invokeMethod(this, &ClientModel::emitPendingRoleChanges, Qt::QueuedConnection);
+    }
+    QVector<int> &roles = m_pendingRoleChanges[client];
+    if (!roles.contains(role)) {
+        roles.append(role);
+    }
+}
+
+void ClientModel::emitPendingRoleChanges()
+{
+    const QHash<AbstractClient *, QVector<int>> changes = std::exchange(m_pendingRoleChanges, {});
+    for (auto it = changes.constBegin(); it != changes.constEnd(); ++it) {
+        const int row = m_clients.indexOf(it.key());
+        if (row == -1) {
+            continue;
+        }
+        const QModelIndex modelIndex = index(row, 0);
+        Q_EMIT dataChanged(modelIndex, modelIndex, it.value());
+    }
 }
 
 void ClientModel::setupClientConnections(AbstractClient *client)
@@ -43,6 +62,15 @@ void ClientModel::setupClientConnections(AbstractClient *client)
     connect(client, &AbstractClient::activitiesChanged, this, [this, client]() {
         markRoleChanged(client, ActivityRole);
     });
+
+    const auto invalidateFilterKey = [this, client]() {
+        if (m_filterKeys.remove(client)) {
+            markRoleChanged(client, Qt::DisplayRole);
+        }
+    };
+    connect(client, &AbstractClient::captionChanged, this, invalidateFilterKey);
+    connect(client, &AbstractClient::windowRoleChanged, this, invalidateFilterKey);
+    connect(client, &AbstractClient::windowClassChanged, this, invalidateFilterKey);
 }
 
 void ClientModel::handleClientAdded(AbstractClient *client)
@@ -62,6 +90,10 @@ void ClientModel::handleClientRemoved(AbstractClient *client)
     beginRemoveRows(QModelIndex(), index, index);
     m_clients.removeAt(index);
     endRemoveRows();
+
+    m_pendingRoleChanges.remove(client);
+    m_filterKeys.remove(client);
+    disconnect(client, nullptr, this, nullptr);
 }
 
 QHash<int, QByteArray> ClientModel::roleNames() const
@@ -102,6 +134,21 @@ int ClientModel::rowCount(const QModelIndex &parent) const
     return parent.isValid() ? 0 : m_clients.count();
 }
 
+QString ClientModel::filterKey(AbstractClient *client) const
+{
+    auto it = m_filterKeys.find(client);
+    if (it == m_filterKeys.end()) {
+        // The fields are separated by a character that can't be typed into a filter, so a
+        // match never spans two of them.
+        const QChar separator(QChar::Null);
+        it = m_filterKeys.insert(client, client->caption() + separator
+                                             + QString::fromUtf8(client->windowRole()) + separator
+                                             + QString::fromUtf8(client->resourceName()) + separator
+                                             + QString::fromUtf8(client->resourceClass()));
+    }
+    return it.value();
+}
+
 ClientFilterModel::ClientFilterModel(QObject *parent)
     : QSortFilterProxyModel(parent)
 {
@@ -271,22 +318,7 @@ bool ClientFilterModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourc
     }
 
     if (!m_filter.isEmpty()) {
-        if (client->caption().contains(m_filter, Qt::CaseInsensitive)) {
-            return true;
-        }
-        const QString windowRole(QString::fromUtf8(client->windowRole()));
-        if (windowRole.contains(m_filter, Qt::CaseInsensitive)) {
-            return true;
-        }
-        const QString resourceName(QString::fromUtf8(client->resourceName()));
-        if (resourceName.contains(m_filter, Qt::CaseInsensitive)) {
-            return true;
-        }
-        const QString resourceClass(QString::fromUtf8(client->resourceClass()));
-        if (resourceClass.contains(m_filter, Qt::CaseInsensitive)) {
-            return true;
-        }
-        return false;
+        return m_clientModel->filterKey(client).contains(m_filter, Qt::CaseInsensitive);
     }
     return true;
 }
@@ -39,14 +39,23 @@ public:
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
 
+    /**
+     * Returns the text that filter models match their filter string against for @p client.
+     * The text is cached until the caption, window role or window class of the client changes.
+     */
+    QString filterKey(AbstractClient *client) const;
+
 private:
     void markRoleChanged(AbstractClient *client, int role);
+    void emitPendingRoleChanges();
 
     void handleClientAdded(AbstractClient *client);
     void handleClientRemoved(AbstractClient *client);
     void setupClientConnections(AbstractClient *client);
 
     QList<AbstractClient *> m_clients;
+    QHash<AbstractClient *, QVector<int>> m_pendingRoleChanges;
+    mutable QHash<AbstractClient *, QString> m_filterKeys;
 };
 
 class ClientFilterModel : public QSortFilterProxyModel
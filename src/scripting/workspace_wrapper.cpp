@@ -10,9 +10,11 @@
 
 #include "workspace_wrapper.h"
 #include "x11client.h"
+#include "main.h"
 #include "outline.h"
 #include "platform.h"
 #include "screens.h"
+#include "tilemanager.h"
 #include "virtualdesktops.h"
 #include "workspace.h"
 #ifdef KWIN_BUILD_ACTIVITIES
@@ -21,6 +23,9 @@
 
 #include <QDesktopWidget>
 #include <QApplication>
+#include <QSet>
+
+#include <memory>
 
 namespace KWin {
 
@@ -331,6 +336,22 @@ X11Client *WorkspaceWrapper::getClient(qulonglong windowId)
     return Workspace::self()->findClient(Predicate::WindowMatch, windowId);
 }
 
+Tile *WorkspaceWrapper::rootTile(int screen, int desktop) const
+{
+    VirtualDesktop *virtualDesktop = nullptr;
+    if (desktop == NETWinInfo::OnAllDesktops || desktop == 0) {
+        virtualDesktop = VirtualDesktopManager::self()->currentDesktop();
+    } else {
+        virtualDesktop = VirtualDesktopManager::self()->desktopForX11Id(desktop);
+    }
+    return TileManager::self()->rootTile(kwinApp()->platform()->findOutput(screen), virtualDesktop);
+}
+
+Tile *WorkspaceWrapper::tileForClient(AbstractClient *client) const
+{
+    return TileManager::self()->tileForWindow(client);
+}
+
 QSize WorkspaceWrapper::desktopGridSize() const
 {
     return VirtualDesktopManager::self()->grid().size();
@@ -384,14 +405,122 @@ void WorkspaceWrapper::sendClientToScreen(AbstractClient *client, int screen)
     }
 }
 
+static QRect rectFromVariant(const QVariant &value)
+{
+    if (value.canConvert<QRect>() && value.userType() != QMetaType::QVariantMap) {
+        return value.toRect();
+    }
+    const QVariantMap map = value.toMap();
+    return QRect(map.value(QStringLiteral("x")).toInt(), map.value(QStringLiteral("y")).toInt(),
+                 map.value(QStringLiteral("width")).toInt(), map.value(QStringLiteral("height")).toInt());
+}
+
+int WorkspaceWrapper::applyLayout(const QVariantList &layout)
+{
+    StackingUpdatesBlocker stackingBlocker(workspace());
+    // released before the stacking order is updated, so all clients get reconfigured at once
+    std::vector<std::unique_ptr<GeometryUpdatesBlocker>> geometryBlockers;
+    geometryBlockers.reserve(layout.count());
+
+    int applied = 0;
+    for (const QVariant &entry : layout) {
+        const QVariantMap properties = entry.toMap();
+        auto client = qobject_cast<AbstractClient *>(properties.value(QStringLiteral("client")).value<QObject *>());
+        if (!client || client->isDeleted()) {
+            continue;
+        }
+        geometryBlockers.push_back(std::make_unique<GeometryUpdatesBlocker>(client));
+
+        const auto desktop = properties.find(QStringLiteral("desktop"));
+        if (desktop != properties.end()) {
+            client->setDesktop(desktop->toInt());
+        }
+        const auto screen = properties.find(QStringLiteral("screen"));
+        if (screen != properties.end()) {
+            sendClientToScreen(client, screen->toInt());
+        }
+        const auto minimized = properties.find(QStringLiteral("minimized"));
+        if (minimized != properties.end()) {
+            client->setMinimized(minimized->toBool());
+        }
+        const auto geometry = properties.find(QStringLiteral("geometry"));
+        if (geometry != properties.end()) {
+            const QRect rect = rectFromVariant(*geometry);
+            if (rect.isValid()) {
+                client->moveResize(rect);
+            }
+        }
+        ++applied;
+    }
+
+    return applied;
+}
+
 QtScriptWorkspaceWrapper::QtScriptWorkspaceWrapper(QObject* parent)
-    : WorkspaceWrapper(parent) {}
+    : WorkspaceWrapper(parent)
+{
+    connect(this, &WorkspaceWrapper::clientAdded, this, [this](AbstractClient *client) {
+        recordClientListChange(client, true);
+    });
+    connect(this, &WorkspaceWrapper::clientRemoved, this, [this](AbstractClient *client) {
+        recordClientListChange(client, false);
+    });
+}
 
 QList<KWin::AbstractClient *> QtScriptWorkspaceWrapper::clientList() const
 {
     return workspace()->allClientList();
 }
 
+int QtScriptWorkspaceWrapper::clientListVersion() const
+{
+    return m_clientListVersion;
+}
+
+void QtScriptWorkspaceWrapper::recordClientListChange(AbstractClient *client, bool added)
+{
+    // Only keep a bounded history; scripts that fall further behind get a full reset.
+    static const int maxChanges = 256;
+    if (m_clientListChanges.count() == maxChanges) {
+        m_clientListChanges.removeFirst();
+    }
+    m_clientListChanges.append(ClientListChange{++m_clientListVersion, client, client->internalId(), added});
+}
+
+QVariantMap QtScriptWorkspaceWrapper::clientListChanges(int version) const
+{
+    QVariantList added;
+    QVariantList removed;
+
+    const int oldestVersion = m_clientListChanges.isEmpty() ? m_clientListVersion : m_clientListChanges.first().version - 1;
+    const bool reset = version < oldestVersion || version > m_clientListVersion;
+    if (reset) {
+        const QList<AbstractClient *> clients = workspace()->allClientList();
+        for (AbstractClient *client : clients) {
+            added.append(QVariant::fromValue(client));
+        }
+    } else {
+        // Removed clients are gone by now, so they are only reported by id. A client that was
+        // added and removed within the range is dropped from the added list.
+        QSet<QUuid> removedIds;
+        for (auto it = m_clientListChanges.crbegin(); it != m_clientListChanges.crend() && it->version > version; ++it) {
+            if (!it->added) {
+                removedIds.insert(it->internalId);
+                removed.prepend(it->internalId.toString());
+            } else if (!removedIds.contains(it->internalId)) {
+                added.prepend(QVariant::fromValue(it->client));
+            }
+        }
+    }
+
+    return QVariantMap{
+        {QStringLiteral("version"), m_clientListVersion},
+        {QStringLiteral("added"), added},
+        {QStringLiteral("removed"), removed},
+        {QStringLiteral("reset"), reset},
+    };
+}
+
 QQmlListProperty<KWin::AbstractClient> DeclarativeScriptWorkspaceWrapper::clients()
 {
     return QQmlListProperty<KWin::AbstractClient>(this, nullptr, &DeclarativeScriptWorkspaceWrapper::countClientList, &DeclarativeScriptWorkspaceWrapper::atClientList);
@@ -15,6 +15,9 @@
 #include <QSize>
 #include <QStringList>
 #include <QRect>
+#include <QUuid>
+#include <QVariantMap>
+#include <QVector>
 #include <QQmlListProperty>
 #include <kwinglobals.h>
 
@@ -22,6 +25,7 @@ namespace KWin
 {
 // forward declarations
 class AbstractClient;
+class Tile;
 class VirtualDesktop;
 class X11Client;
 
@@ -283,6 +287,31 @@ void setter( rettype val );
      * @return The found Client or @c null
      */
     Q_SCRIPTABLE KWin::X11Client *getClient(qulonglong windowId);
+    /**
+     * Returns the root of the tile tree for the given @p screen and @p desktop. The tiles can
+     * be split and resized, and windows assigned to a tile fill its area.
+     * @param screen The screen of the tile tree
+     * @param desktop The desktop of the tile tree, the current desktop if @c 0 or @c -1
+     * @returns The root tile or @c null if the screen doesn't exist
+     * @since 5.25
+     */
+    Q_SCRIPTABLE KWin::Tile *rootTile(int screen, int desktop) const;
+    /**
+     * Returns the tile that contains the given @p client, or @c null if the client isn't tiled.
+     * @since 5.25
+     */
+    Q_SCRIPTABLE KWin::Tile *tileForClient(KWin::AbstractClient *client) const;
+    /**
+     * Applies the @p layout in one go. Each entry of the list is an object with the @c client to
+     * change and any of the following optional properties: @c geometry as an object with @c x,
+     * @c y, @c width and @c height, @c desktop, @c screen and @c minimized.
+     *
+     * Unlike setting the properties of the clients one after another, the stacking order is
+     * updated once and the clients are only reconfigured after all entries have been applied.
+     * @returns The number of entries that have been applied
+     * @since 5.25
+     */
+    Q_SCRIPTABLE int applyLayout(const QVariantList &layout);
 
 public Q_SLOTS:
     // all the available key bindings
@@ -419,7 +448,43 @@ public:
      */
     Q_INVOKABLE QList<KWin::AbstractClient *> clientList() const;
 
+    /**
+     * Returns the current version of the client list. The version is increased whenever a client
+     * is added or removed, so a script can compare it with a stored value instead of fetching and
+     * walking the whole clientList() again.
+     *
+     * @since 5.25
+     */
+    Q_INVOKABLE int clientListVersion() const;
+
+    /**
+     * Returns the changes to the client list since the given @p version as an object with the
+     * following keys:
+     *
+     * @li @c version The current version of the client list
+     * @li @c added List of clients that have been added since @p version and are still managed
+     * @li @c removed List of internal ids of clients that have been removed since @p version
+     * @li @c reset @c true if @p version is too old to be diffed, in which case @c added holds
+     * the complete client list and @c removed is empty
+     *
+     * @since 5.25
+     */
+    Q_INVOKABLE QVariantMap clientListChanges(int version) const;
+
     explicit QtScriptWorkspaceWrapper(QObject* parent = nullptr);
+
+private:
+    void recordClientListChange(AbstractClient *client, bool added);
+
+    struct ClientListChange
+    {
+        int version;
+        AbstractClient *client;
+        QUuid internalId;
+        bool added;
+    };
+    QVector<ClientListChange> m_clientListChanges;
+    int m_clientListVersion = 0;
 };
 
 class DeclarativeScriptWorkspaceWrapper : public WorkspaceWrapper
@@ -39,17 +39,43 @@ void ShadowItem::updateGeometry()
 {
     const QRect rect = m_shadow->rect() + m_shadow->offset();
 
+    // The quads are in item-local coordinates, setSize() discards them if they need to be rebuilt.
     setPosition(rect.topLeft());
     setSize(rect.size());
-    discardQuads();
 }
 
 void ShadowItem::handleTextureChanged()
 {
+    updateElementSizes();
     scheduleRepaint(rect());
     discardQuads();
 }
 
+void ShadowItem::updateElementSizes()
+{
+    // The tile sizes only change together with the texture, cache them so resizing the
+    // window only has to lay out the tiles instead of querying the shadow for every frame.
+    m_elementSizes.resize(Shadow::ShadowElementsCount);
+    for (int i = 0; i < Shadow::ShadowElementsCount; ++i) {
+        m_elementSizes[i] = m_shadow->elementSize(Shadow::ShadowElements(i));
+    }
+
+    const QSizeF &top = m_elementSizes[Shadow::ShadowElementTop];
+    const QSizeF &topRight = m_elementSizes[Shadow::ShadowElementTopRight];
+    const QSizeF &right = m_elementSizes[Shadow::ShadowElementRight];
+    const QSizeF &bottomRight = m_elementSizes[Shadow::ShadowElementBottomRight];
+    const QSizeF &bottom = m_elementSizes[Shadow::ShadowElementBottom];
+    const QSizeF &bottomLeft = m_elementSizes[Shadow::ShadowElementBottomLeft];
+    const QSizeF &left = m_elementSizes[Shadow::ShadowElementLeft];
+    const QSizeF &topLeft = m_elementSizes[Shadow::ShadowElementTopLeft];
+
+    m_shadowMargins = QMarginsF(
+            std::max({topLeft.width(), left.width(), bottomLeft.width()}),
+            std::max({topLeft.height(), top.height(), topRight.height()}),
+            std::max({topRight.width(), right.width(), bottomRight.width()}),
+            std::max({bottomRight.height(), bottom.height(), bottomLeft.height()}));
+}
+
 void ShadowItem::handleWindowClosed(Toplevel *original, Deleted *deleted)
 {
     Q_UNUSED(original)
@@ -85,20 +111,15 @@ WindowQuadList ShadowItem::buildQuads() const
         return WindowQuadList();
     }
 
-    const QSizeF top(m_shadow->elementSize(Shadow::ShadowElementTop));
-    const QSizeF topRight(m_shadow->elementSize(Shadow::ShadowElementTopRight));
-    const QSizeF right(m_shadow->elementSize(Shadow::ShadowElementRight));
-    const QSizeF bottomRight(m_shadow->elementSize(Shadow::ShadowElementBottomRight));
-    const QSizeF bottom(m_shadow->elementSize(Shadow::ShadowElementBottom));
-    const QSizeF bottomLeft(m_shadow->elementSize(Shadow::ShadowElementBottomLeft));
-    const QSizeF left(m_shadow->elementSize(Shadow::ShadowElementLeft));
-    const QSizeF topLeft(m_shadow->elementSize(Shadow::ShadowElementTopLeft));
-
-    const QMarginsF shadowMargins(
-            std::max({topLeft.width(), left.width(), bottomLeft.width()}),
-            std::max({topLeft.height(), top.height(), topRight.height()}),
-            std::max({topRight.width(), right.width(), bottomRight.width()}),
-            std::max({bottomRight.height(), bottom.height(), bottomLeft.height()}));
+    const QSizeF &top = m_elementSizes[Shadow::ShadowElementTop];
+    const QSizeF &topRight = m_elementSizes[Shadow::ShadowElementTopRight];
+    const QSizeF &right = m_elementSizes[Shadow::ShadowElementRight];
+    const QSizeF &bottomRight = m_elementSizes[Shadow::ShadowElementBottomRight];
+    const QSizeF &bottom = m_elementSizes[Shadow::ShadowElementBottom];
+    const QSizeF &bottomLeft = m_elementSizes[Shadow::ShadowElementBottomLeft];
+    const QSizeF &left = m_elementSizes[Shadow::ShadowElementLeft];
+    const QSizeF &topLeft = m_elementSizes[Shadow::ShadowElementTopLeft];
+    const QMarginsF &shadowMargins = m_shadowMargins;
 
     const QRectF outerRect = rect();
 
@@ -37,8 +37,12 @@ private Q_SLOTS:
     void handleWindowClosed(Toplevel *original, Deleted *deleted);
 
 private:
+    void updateElementSizes();
+
     Toplevel *m_window;
     Shadow *m_shadow = nullptr;
+    QVector<QSizeF> m_elementSizes;
+    QMarginsF m_shadowMargins;
 };
 
 } // namespace KWin
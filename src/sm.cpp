@@ -267,6 +267,10 @@ static bool sessionInfoWindowTypeMatch(X11Client *c, SessionInfo* info)
  */
 SessionInfo* Workspace::takeSessionInfo(X11Client *c)
 {
+    if (session.isEmpty()) {
+        // Nothing to restore, avoid reading the session properties of the window
+        return nullptr;
+    }
     SessionInfo *realInfo = nullptr;
     QByteArray sessionId = c->sessionId();
     QByteArray windowRole = c->windowRole();
@@ -311,9 +315,51 @@ SessionInfo* Workspace::takeSessionInfo(X11Client *c)
             }
         }
     }
+    if (realInfo) {
+        beginSessionRestoreBatch();
+    }
     return realInfo;
 }
 
+static const int s_sessionRestoreSettleInterval = 250;
+static const int s_sessionRestoreTimeout = 3000;
+
+/**
+ * Starts or extends a batch of windows restored from the session. The windows are managed
+ * as they map, but the stacking order is only updated and propagated once the batch ends,
+ * so the restored windows show up in one go rather than one restack per window.
+ */
+void Workspace::beginSessionRestoreBatch()
+{
+    if (!m_sessionRestoreSettleTimer) {
+        m_sessionRestoreSettleTimer = new QTimer(this);
+        m_sessionRestoreSettleTimer->setSingleShot(true);
+        connect(m_sessionRestoreSettleTimer, &QTimer::timeout, this, &Workspace::endSessionRestoreBatch);
+        m_sessionRestoreTimeoutTimer = new QTimer(this);
+        m_sessionRestoreTimeoutTimer->setSingleShot(true);
+        m_sessionRestoreTimeoutTimer->setInterval(s_sessionRestoreTimeout);
+        connect(m_sessionRestoreTimeoutTimer, &QTimer::timeout, this, &Workspace::endSessionRestoreBatch);
+    }
+    if (!m_sessionRestoreBatch) {
+        m_sessionRestoreBatch = true;
+        blockStackingUpdates(true);
+        m_sessionRestoreTimeoutTimer->start();
+    }
+    // end the batch right after the last window from the session is managed
+    m_sessionRestoreSettleTimer->start(session.isEmpty() ? 0 : s_sessionRestoreSettleInterval);
+}
+
+void Workspace::endSessionRestoreBatch()
+{
+    if (!m_sessionRestoreBatch) {
+        return;
+    }
+    m_sessionRestoreBatch = false;
+    m_sessionRestoreSettleTimer->stop();
+    m_sessionRestoreTimeoutTimer->stop();
+    blockStackingUpdates(false);
+}
+
 SessionManager::SessionManager(QObject *parent)
     : QObject(parent)
 {
@@ -50,6 +50,13 @@ QRegion SurfaceItem::opaque() const
 
 void SurfaceItem::addDamage(const QRegion &region)
 {
+    // A client that commits faster than the screen refreshes damages the same area over
+    // and over again before it gets painted. Only the first of those commits has to schedule
+    // a repaint and announce the damage, whatever buffer is current by then gets painted.
+    if (!m_damage.isEmpty() && (region - m_damage).isEmpty()) {
+        return;
+    }
+
     m_damage += region;
     scheduleRepaint(region);
 
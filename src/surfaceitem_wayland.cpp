@@ -6,12 +6,18 @@
 
 #include "surfaceitem_wayland.h"
 #include "composite.h"
+#include "ftrace.h"
 #include "scene.h"
 
 #include <KWaylandServer/clientbuffer.h>
+#include <KWaylandServer/linuxdmabufv1clientbuffer.h>
 #include <KWaylandServer/subcompositor_interface.h>
 #include <KWaylandServer/surface_interface.h>
 
+#include <QSocketNotifier>
+
+#include <poll.h>
+
 namespace KWin
 {
 
@@ -26,14 +32,14 @@ SurfaceItemWayland::SurfaceItemWayland(KWaylandServer::SurfaceInterface *surface
     connect(surface, &KWaylandServer::SurfaceInterface::sizeChanged,
             this, &SurfaceItemWayland::handleSurfaceSizeChanged);
     connect(surface, &KWaylandServer::SurfaceInterface::bufferSizeChanged,
-            this, &SurfaceItemWayland::discardPixmap);
+            this, &SurfaceItemWayland::handleBufferSizeChanged);
 
     connect(surface, &KWaylandServer::SurfaceInterface::childSubSurfacesChanged,
             this, &SurfaceItemWayland::handleChildSubSurfacesChanged);
     connect(surface, &KWaylandServer::SurfaceInterface::committed,
             this, &SurfaceItemWayland::handleSurfaceCommitted);
     connect(surface, &KWaylandServer::SurfaceInterface::damaged,
-            this, &SurfaceItemWayland::addDamage);
+            this, &SurfaceItemWayland::handleSurfaceDamaged);
     connect(surface, &KWaylandServer::SurfaceInterface::childSubSurfaceRemoved,
             this, &SurfaceItemWayland::handleChildSubSurfaceRemoved);
 
@@ -52,6 +58,7 @@ SurfaceItemWayland::SurfaceItemWayland(KWaylandServer::SurfaceInterface *surface
     handleChildSubSurfacesChanged();
     setSize(surface->size());
     setSurfaceToBufferMatrix(surface->surfaceToBufferMatrix());
+    m_opaque = surface->opaque();
 }
 
 QRegion SurfaceItemWayland::shape() const
@@ -61,10 +68,18 @@ QRegion SurfaceItemWayland::shape() const
 
 QRegion SurfaceItemWayland::opaque() const
 {
-    if (m_surface) {
-        return m_surface->opaque();
+    return m_opaque;
+}
+
+void SurfaceItemWayland::updateOpaque()
+{
+    const QRegion opaque = m_surface->opaque();
+    if (m_opaque == opaque) {
+        return;
     }
-    return QRegion();
+    // The windows below have not been painted where the surface used to be opaque.
+    scheduleRepaint(m_opaque.xored(opaque));
+    m_opaque = opaque;
 }
 
 KWaylandServer::SurfaceInterface *SurfaceItemWayland::surface() const
@@ -72,8 +87,50 @@ KWaylandServer::SurfaceInterface *SurfaceItemWayland::surface() const
     return m_surface;
 }
 
+void SurfaceItemWayland::freeze()
+{
+    m_frozen = true;
+    for (SurfaceItemWayland *subsurfaceItem : qAsConst(m_subsurfaces)) {
+        subsurfaceItem->freeze();
+    }
+}
+
+void SurfaceItemWayland::thaw()
+{
+    if (!m_frozen) {
+        return;
+    }
+    m_frozen = false;
+    for (SurfaceItemWayland *subsurfaceItem : qAsConst(m_subsurfaces)) {
+        subsurfaceItem->thaw();
+    }
+    if (!m_surface) {
+        return;
+    }
+
+    // catch up with everything the client has committed while the item was frozen
+    handleChildSubSurfacesChanged();
+    if (KWaylandServer::SubSurfaceInterface *subsurface = m_surface->subSurface()) {
+        setVisible(m_surface->isMapped());
+        setPosition(subsurface->position());
+    }
+    setSize(m_surface->size());
+    setSurfaceToBufferMatrix(m_surface->surfaceToBufferMatrix());
+    updateOpaque();
+    discardQuads();
+    discardPixmap();
+}
+
+bool SurfaceItemWayland::isFrozen() const
+{
+    return m_frozen;
+}
+
 void SurfaceItemWayland::handleSurfaceToBufferMatrixChanged()
 {
+    if (m_frozen) {
+        return;
+    }
     setSurfaceToBufferMatrix(m_surface->surfaceToBufferMatrix());
     discardQuads();
     discardPixmap();
@@ -81,11 +138,34 @@ void SurfaceItemWayland::handleSurfaceToBufferMatrixChanged()
 
 void SurfaceItemWayland::handleSurfaceSizeChanged()
 {
+    if (m_frozen) {
+        return;
+    }
     setSize(m_surface->size());
 }
 
+void SurfaceItemWayland::handleBufferSizeChanged()
+{
+    if (m_frozen) {
+        return;
+    }
+    discardPixmap();
+}
+
+void SurfaceItemWayland::handleSurfaceDamaged(const QRegion &region)
+{
+    if (m_frozen) {
+        return;
+    }
+    addDamage(region);
+}
+
 void SurfaceItemWayland::handleSurfaceCommitted()
 {
+    fTraceInstant("Surface commit", window()->caption());
+    if (!m_frozen) {
+        updateOpaque();
+    }
     if (m_surface->hasFrameCallbacks()) {
         scheduleFrame();
     }
@@ -109,6 +189,9 @@ void SurfaceItemWayland::handleChildSubSurfaceRemoved(KWaylandServer::SubSurface
 
 void SurfaceItemWayland::handleChildSubSurfacesChanged()
 {
+    if (m_frozen) {
+        return;
+    }
     const QList<KWaylandServer::SubSurfaceInterface *> below = m_surface->below();
     const QList<KWaylandServer::SubSurfaceInterface *> above = m_surface->above();
 
@@ -125,11 +208,17 @@ void SurfaceItemWayland::handleChildSubSurfacesChanged()
 
 void SurfaceItemWayland::handleSubSurfacePositionChanged()
 {
+    if (m_frozen) {
+        return;
+    }
     setPosition(m_surface->subSurface()->position());
 }
 
 void SurfaceItemWayland::handleSubSurfaceMappedChanged()
 {
+    if (m_frozen) {
+        return;
+    }
     setVisible(m_surface->isMapped());
 }
 
@@ -171,9 +260,90 @@ void SurfacePixmapWayland::create()
 
 void SurfacePixmapWayland::update()
 {
+    if (m_item->isFrozen() && isValid()) {
+        return;
+    }
     KWaylandServer::SurfaceInterface *surface = m_item->surface();
     if (surface) {
-        setBuffer(surface->buffer());
+        KWaylandServer::ClientBuffer *buffer = surface->buffer();
+        // Sampling a buffer that the client is still rendering to would stall the frame
+        // until the client's GPU work is done. Keep showing the current contents instead,
+        // unless they no longer match the surface, e.g. after a resize.
+        if (buffer && canKeepContents(buffer) && !isBufferReady(buffer)) {
+            return;
+        }
+        resetPendingBuffer();
+        setBuffer(buffer);
+    }
+}
+
+/**
+ * Returns @c true if the current contents can be shown in place of the @a buffer
+ * for a few more frames without the surface visibly changing its geometry.
+ */
+bool SurfacePixmapWayland::canKeepContents(KWaylandServer::ClientBuffer *buffer) const
+{
+    if (!m_buffer) {
+        return false;
+    }
+    return m_buffer->size() == buffer->size()
+        && m_buffer->hasAlphaChannel() == buffer->hasAlphaChannel();
+}
+
+/**
+ * Returns @c true if the GPU has finished writing to the @a buffer. Otherwise the pixmap
+ * starts to wait for the buffer to become ready, and damages the surface once it is.
+ */
+bool SurfacePixmapWayland::isBufferReady(KWaylandServer::ClientBuffer *buffer)
+{
+    auto dmabuf = qobject_cast<KWaylandServer::LinuxDmaBufV1ClientBuffer *>(buffer);
+    if (!dmabuf) {
+        return true;
+    }
+
+    // A dmabuf turns readable when the implicit fences of the writers have signaled.
+    const auto planes = dmabuf->planes();
+    for (const auto &plane : planes) {
+        pollfd pfd = {plane.fd, POLLIN, 0};
+        if (poll(&pfd, 1, 0) == 1 && (pfd.revents & POLLIN)) {
+            continue;
+        }
+        if (m_pendingBuffer != buffer || !m_pendingNotifier || m_pendingNotifier->socket() != plane.fd) {
+            resetPendingBuffer();
+            m_pendingBuffer = buffer;
+            m_pendingNotifier.reset(new QSocketNotifier(plane.fd, QSocketNotifier::Read));
+            connect(m_pendingNotifier.data(), &QSocketNotifier::activated,
+                    this, &SurfacePixmapWayland::handleBufferReady);
+            // the plane fds are closed along with the buffer, they must not be watched anymore
+            connect(buffer, &QObject::destroyed, m_pendingNotifier.data(), [this]() {
+                resetPendingBuffer();
+            });
+        }
+        return false;
+    }
+
+    resetPendingBuffer();
+    return true;
+}
+
+void SurfacePixmapWayland::resetPendingBuffer()
+{
+    m_pendingBuffer.clear();
+    if (m_pendingNotifier) {
+        // this may be called while the notifier is emitting activated()
+        m_pendingNotifier->setEnabled(false);
+        m_pendingNotifier.take()->deleteLater();
+    }
+}
+
+void SurfacePixmapWayland::handleBufferReady()
+{
+    KWaylandServer::ClientBuffer *buffer = m_pendingBuffer;
+    resetPendingBuffer();
+    // the damage of the commit has been consumed by the frames that kept the old contents
+    KWaylandServer::SurfaceInterface *surface = m_item->surface();
+    if (surface && buffer && buffer == surface->buffer()) {
+        m_item->addDamage(m_item->rect());
     }
 }
 
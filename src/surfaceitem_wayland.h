@@ -8,6 +8,10 @@
 
 #include "surfaceitem.h"
 
+#include <QPointer>
+
+class QSocketNotifier;
+
 namespace KWaylandServer
 {
 class ClientBuffer;
@@ -34,10 +38,20 @@ public:
 
     KWaylandServer::SurfaceInterface *surface() const;
 
+    /**
+     * Keeps showing the current contents and geometry of the surface and its sub-surfaces.
+     * The state committed by the client in the meantime is applied when the item is thawed.
+     */
+    void freeze();
+    void thaw();
+    bool isFrozen() const;
+
 private Q_SLOTS:
     void handleSurfaceToBufferMatrixChanged();
     void handleSurfaceCommitted();
     void handleSurfaceSizeChanged();
+    void handleBufferSizeChanged();
+    void handleSurfaceDamaged(const QRegion &region);
 
     void handleChildSubSurfaceRemoved(KWaylandServer::SubSurfaceInterface *child);
     void handleChildSubSurfacesChanged();
@@ -49,9 +63,13 @@ protected:
 
 private:
     SurfaceItemWayland *getOrCreateSubSurfaceItem(KWaylandServer::SubSurfaceInterface *s);
+    void updateOpaque();
 
     QPointer<KWaylandServer::SurfaceInterface> m_surface;
     QHash<KWaylandServer::SubSurfaceInterface *, SurfaceItemWayland *> m_subsurfaces;
+    // the opaque region of the last commit that the item shows
+    QRegion m_opaque;
+    bool m_frozen = false;
 };
 
 class KWIN_EXPORT SurfacePixmapWayland final : public SurfacePixmap
@@ -72,9 +90,16 @@ public:
 
 private:
     void setBuffer(KWaylandServer::ClientBuffer *buffer);
+    bool canKeepContents(KWaylandServer::ClientBuffer *buffer) const;
+    bool isBufferReady(KWaylandServer::ClientBuffer *buffer);
+    void resetPendingBuffer();
+    void handleBufferReady();
 
     SurfaceItemWayland *m_item;
     KWaylandServer::ClientBuffer *m_buffer = nullptr;
+    // the buffer that is waited for until the client has finished rendering it
+    QPointer<KWaylandServer::ClientBuffer> m_pendingBuffer;
+    QScopedPointer<QSocketNotifier> m_pendingNotifier;
 };
 
 /**
@@ -12,6 +12,11 @@
 namespace KWin
 {
 
+// Number of frames in a row a window has to be damaged in before its damage is only tracked
+// as a bounding box, and the number of undamaged frames before it goes back to regions
+static const int s_boundingBoxDamageThreshold = 30;
+static const int s_regionDamageThreshold = 60;
+
 SurfaceItemX11::SurfaceItemX11(Toplevel *window, Item *parent)
     : SurfaceItem(window, parent)
 {
@@ -20,9 +25,7 @@ SurfaceItemX11::SurfaceItemX11(Toplevel *window, Item *parent)
     connect(window, &Toplevel::geometryShapeChanged,
             this, &SurfaceItemX11::discardQuads);
 
-    m_damageHandle = xcb_generate_id(kwinApp()->x11Connection());
-    xcb_damage_create(kwinApp()->x11Connection(), m_damageHandle, window->frameId(),
-                      XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY);
+    createDamage(XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY);
 
     setSize(window->bufferGeometry().size());
 }
@@ -43,8 +46,34 @@ void SurfaceItemX11::preprocess()
     SurfaceItem::preprocess();
 }
 
-void SurfaceItemX11::processDamage()
+void SurfaceItemX11::createDamage(xcb_damage_report_level_t level)
+{
+    m_damageHandle = xcb_generate_id(kwinApp()->x11Connection());
+    xcb_damage_create(kwinApp()->x11Connection(), m_damageHandle, window()->frameId(), level);
+}
+
+void SurfaceItemX11::setBoundingBoxDamage(bool enabled)
+{
+    if (m_boundingBoxDamage == enabled || m_damageHandle == XCB_NONE || window()->isDeleted()) {
+        return;
+    }
+    m_boundingBoxDamage = enabled;
+    m_boundingBoxDamageArea = QRect();
+    m_damagedFrameCount = 0;
+    m_idleFrameCount = 0;
+
+    xcb_damage_destroy(kwinApp()->x11Connection(), m_damageHandle);
+    createDamage(enabled ? XCB_DAMAGE_REPORT_LEVEL_BOUNDING_BOX : XCB_DAMAGE_REPORT_LEVEL_NON_EMPTY);
+
+    // Whatever was damaged while switching is not reported by the new damage object
+    addDamage(QRect(QPoint(0, 0), size()));
+}
+
+void SurfaceItemX11::processDamage(const xcb_damage_notify_event_t *event)
 {
+    if (m_boundingBoxDamage && event->damage == m_damageHandle) {
+        m_boundingBoxDamageArea |= QRect(event->area.x, event->area.y, event->area.width, event->area.height);
+    }
     m_isDamaged = true;
     scheduleFrame();
 }
@@ -52,14 +81,30 @@ void SurfaceItemX11::processDamage()
 bool SurfaceItemX11::fetchDamage()
 {
     if (!m_isDamaged) {
+        m_damagedFrameCount = 0;
+        if (m_boundingBoxDamage && ++m_idleFrameCount >= s_regionDamageThreshold) {
+            setBoundingBoxDamage(false);
+        }
         return false;
     }
     m_isDamaged = false;
+    m_idleFrameCount = 0;
 
     if (m_damageHandle == XCB_NONE) {
         return true;
     }
 
+    if (m_boundingBoxDamage) {
+        // The areas have been collected from the notify events already, only rearm them
+        xcb_damage_subtract(kwinApp()->x11Connection(), m_damageHandle, XCB_NONE, XCB_NONE);
+        return true;
+    }
+
+    if (++m_damagedFrameCount >= s_boundingBoxDamageThreshold) {
+        setBoundingBoxDamage(true);
+        return true;
+    }
+
     xcb_xfixes_region_t region = xcb_generate_id(kwinApp()->x11Connection());
     xcb_xfixes_create_region(kwinApp()->x11Connection(), region, 0, nullptr);
     xcb_damage_subtract(kwinApp()->x11Connection(), m_damageHandle, 0, region);
@@ -74,6 +119,10 @@ bool SurfaceItemX11::fetchDamage()
 
 void SurfaceItemX11::waitForDamage()
 {
+    if (!m_boundingBoxDamageArea.isEmpty()) {
+        addDamage(m_boundingBoxDamageArea);
+        m_boundingBoxDamageArea = QRect();
+    }
     if (!m_havePendingDamageRegion) {
         return;
     }
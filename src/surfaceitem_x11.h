@@ -27,7 +27,7 @@ public:
 
     void preprocess() override;
 
-    void processDamage();
+    void processDamage(const xcb_damage_notify_event_t *event);
     bool fetchDamage();
     void waitForDamage();
     void destroyDamage();
@@ -42,10 +42,19 @@ protected:
     SurfacePixmap *createPixmap() override;
 
 private:
+    void createDamage(xcb_damage_report_level_t level);
+    void setBoundingBoxDamage(bool enabled);
+
     xcb_damage_damage_t m_damageHandle = XCB_NONE;
     xcb_xfixes_fetch_region_cookie_t m_damageCookie;
     bool m_isDamaged = false;
     bool m_havePendingDamageRegion = false;
+    // Chatty windows are switched to bounding box reports, which carry the damage in the
+    // notify events and need no region fetch per frame
+    bool m_boundingBoxDamage = false;
+    QRect m_boundingBoxDamageArea;
+    int m_damagedFrameCount = 0;
+    int m_idleFrameCount = 0;
 };
 
 class KWIN_EXPORT SurfacePixmapX11 final : public SurfacePixmap
@@ -161,8 +161,9 @@ void ClientModel::createClientList(int desktop, bool partialReset)
         }
     }
 
-    beginResetModel();
-    m_clientList.clear();
+    // Build the new list on the side and apply it as a diff, so that a switcher that is shown
+    // again does not have to recreate all of its delegates.
+    TabBoxClientList clientList;
     QList< QWeakPointer< TabBoxClient > > stickyClients;
 
     switch(tabBox->config().clientSwitchingMode()) {
@@ -178,7 +179,7 @@ void ClientModel::createClientList(int desktop, bool partialReset)
         do {
             QSharedPointer<TabBoxClient> add = tabBox->clientToAddToList(c.data(), desktop);
             if (!add.isNull()) {
-                m_clientList += add;
+                clientList += add;
                 if (add.data()->isFirstInTabBox()) {
                     stickyClients << add;
                 }
@@ -197,10 +198,10 @@ void ClientModel::createClientList(int desktop, bool partialReset)
             QSharedPointer<TabBoxClient> add = tabBox->clientToAddToList(c.data(), desktop);
             if (!add.isNull()) {
                 if (start == add.data()) {
-                    m_clientList.removeAll(add);
-                    m_clientList.prepend(add);
+                    clientList.removeAll(add);
+                    clientList.prepend(add);
                 } else
-                    m_clientList += add;
+                    clientList += add;
                 if (add.data()->isFirstInTabBox()) {
                     stickyClients << add;
                 }
@@ -218,16 +219,51 @@ void ClientModel::createClientList(int desktop, bool partialReset)
     }
     }
     for (const QWeakPointer< TabBoxClient > &c : qAsConst(stickyClients)) {
-        m_clientList.removeAll(c);
-        m_clientList.prepend(c);
+        clientList.removeAll(c);
+        clientList.prepend(c);
     }
     if (tabBox->config().clientApplicationsMode() != TabBoxConfig::AllWindowsCurrentApplication
-            && (tabBox->config().showDesktopMode() == TabBoxConfig::ShowDesktopClient || m_clientList.isEmpty())) {
+            && (tabBox->config().showDesktopMode() == TabBoxConfig::ShowDesktopClient || clientList.isEmpty())) {
         QWeakPointer<TabBoxClient> desktopClient = tabBox->desktopClient();
         if (!desktopClient.isNull())
-            m_clientList.append(desktopClient);
+            clientList.append(desktopClient);
+    }
+    applyClientList(clientList);
+}
+
+void ClientModel::applyClientList(const TabBoxClientList &clientList)
+{
+    // Drop clients that are gone first, their address may have been reused by a new client.
+    for (int i = m_clientList.count() - 1; i >= 0; --i) {
+        if (m_clientList.at(i).isNull()) {
+            beginRemoveRows(QModelIndex(), i, i);
+            m_clientList.removeAt(i);
+            endRemoveRows();
+        }
+    }
+
+    for (int i = 0; i < clientList.count(); ++i) {
+        const QWeakPointer<TabBoxClient> &client = clientList.at(i);
+        if (i < m_clientList.count() && m_clientList.at(i) == client) {
+            continue;
+        }
+        const int oldIndex = m_clientList.indexOf(client, i);
+        if (oldIndex != -1) {
+            beginMoveRows(QModelIndex(), oldIndex, oldIndex, QModelIndex(), i);
+            m_clientList.move(oldIndex, i);
+            endMoveRows();
+        } else {
+            beginInsertRows(QModelIndex(), i, i);
+            m_clientList.insert(i, client);
+            endInsertRows();
+        }
+    }
+    // Whatever has not been moved to the front is no longer in the list.
+    if (m_clientList.count() > clientList.count()) {
+        beginRemoveRows(QModelIndex(), clientList.count(), m_clientList.count() - 1);
+        m_clientList.erase(m_clientList.begin() + clientList.count(), m_clientList.end());
+        endRemoveRows();
     }
-    endResetModel();
 }
 
 void ClientModel::close(int i)
@@ -94,6 +94,12 @@ public Q_SLOTS:
     void activate(int index);
 
 private:
+    /**
+     * Updates the model to @p clientList with row moves, inserts and removals instead of
+     * resetting it.
+     */
+    void applyClientList(const TabBoxClientList &clientList);
+
     TabBoxClientList m_clientList;
 };
 
@@ -739,6 +739,8 @@ void TabBox::reconfigure()
     m_alternativeCurrentApplicationConfig.setClientApplicationsMode(TabBoxConfig::AllWindowsCurrentApplication);
 
     m_tabBox->setConfig(m_defaultConfig);
+    // Load the switcher layout ahead of time, so that the first alt+tab is not delayed by it.
+    m_tabBox->prepare();
 
     m_delayShow = config.readEntry<bool>("ShowDelay", true);
     m_delayShowTime = config.readEntry<int>("DelayTime", 90);
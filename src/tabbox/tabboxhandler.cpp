@@ -56,6 +56,10 @@ public:
     void endHighlightWindows(bool abort = false);
 
     void show();
+    /**
+     * Creates the switcher for the current config, if needed, without showing it.
+     */
+    void prepare();
     QQuickWindow *window() const;
     SwitcherItem *switcherItem() const;
 
@@ -82,6 +86,11 @@ public:
 
 private:
     QObject *createSwitcherItem(bool desktopMode);
+    /**
+     * Returns the switcher for the current config, creating it and setting its model if needed.
+     */
+    QObject *switcherItemForConfig();
+    static SwitcherItem *findSwitcherItem(QObject *item);
 };
 
 TabBoxHandlerPrivate::TabBoxHandlerPrivate(TabBoxHandler *q)
@@ -122,15 +131,20 @@ QQuickWindow *TabBoxHandlerPrivate::window() const
 #ifndef KWIN_UNIT_TEST
 SwitcherItem *TabBoxHandlerPrivate::switcherItem() const
 {
-    if (!m_mainItem) {
+    return findSwitcherItem(m_mainItem);
+}
+
+SwitcherItem *TabBoxHandlerPrivate::findSwitcherItem(QObject *item)
+{
+    if (!item) {
         return nullptr;
     }
-    if (SwitcherItem *i = qobject_cast<SwitcherItem*>(m_mainItem)) {
+    if (SwitcherItem *i = qobject_cast<SwitcherItem*>(item)) {
         return i;
-    } else if (QQuickWindow *w = qobject_cast<QQuickWindow*>(m_mainItem)) {
+    } else if (QQuickWindow *w = qobject_cast<QQuickWindow*>(item)) {
         return w->contentItem()->findChild<SwitcherItem*>();
     }
-    return m_mainItem->findChild<SwitcherItem*>();
+    return item->findChild<SwitcherItem*>();
 }
 #endif
 
@@ -286,9 +300,9 @@ QObject *TabBoxHandlerPrivate::createSwitcherItem(bool desktopMode)
 }
 #endif
 
-void TabBoxHandlerPrivate::show()
-{
 #ifndef KWIN_UNIT_TEST
+QObject *TabBoxHandlerPrivate::switcherItemForConfig()
+{
     if (m_qmlContext.isNull()) {
         qmlRegisterType<SwitcherItem>("org.kde.kwin", 2, 0, "Switcher");
         qmlRegisterType<SwitcherItem>("org.kde.kwin", 3, 0, "TabBoxSwitcher");
@@ -298,34 +312,44 @@ void TabBoxHandlerPrivate::show()
         m_qmlComponent.reset(new QQmlComponent(Scripting::self()->qmlEngine()));
     }
     const bool desktopMode = (config.tabBoxMode() == TabBoxConfig::DesktopTabBox);
-    auto findMainItem = [this](const QMap<QString, QObject *> &tabBoxes) -> QObject* {
-        auto it = tabBoxes.constFind(config.layoutName());
-        if (it != tabBoxes.constEnd()) {
-            return it.value();
-        }
-        return nullptr;
-    };
-    m_mainItem = nullptr;
-    m_mainItem = desktopMode ? findMainItem(m_desktopTabBoxes) : findMainItem(m_clientTabBoxes);
-    if (!m_mainItem) {
-        m_mainItem = createSwitcherItem(desktopMode);
-        if (!m_mainItem) {
-            return;
-        }
+    const QMap<QString, QObject *> &tabBoxes = desktopMode ? m_desktopTabBoxes : m_clientTabBoxes;
+    QObject *item = tabBoxes.value(config.layoutName());
+    if (!item) {
+        item = createSwitcherItem(desktopMode);
     }
-    if (SwitcherItem *item = switcherItem()) {
-        // In case the model isn't yet set (see below), index will be reset and therefore we
-        // need to save the current index row (https://bugs.kde.org/show_bug.cgi?id=333511).
-        int indexRow = index.row();
-        if (!item->model()) {
-            QAbstractItemModel *model = nullptr;
+    if (SwitcherItem *switcher = findSwitcherItem(item)) {
+        if (!switcher->model()) {
             if (desktopMode) {
-                model = desktopModel();
+                switcher->setModel(desktopModel());
             } else {
-                model = clientModel();
+                switcher->setModel(clientModel());
             }
-            item->setModel(model);
         }
+    }
+    return item;
+}
+#endif
+
+void TabBoxHandlerPrivate::prepare()
+{
+#ifndef KWIN_UNIT_TEST
+    if (Scripting::self()) {
+        switcherItemForConfig();
+    }
+#endif
+}
+
+void TabBoxHandlerPrivate::show()
+{
+#ifndef KWIN_UNIT_TEST
+    // In case the model isn't yet set, index will be reset and therefore we
+    // need to save the current index row (https://bugs.kde.org/show_bug.cgi?id=333511).
+    const int indexRow = index.row();
+    m_mainItem = switcherItemForConfig();
+    if (!m_mainItem) {
+        return;
+    }
+    if (SwitcherItem *item = switcherItem()) {
         item->setAllDesktops(config.clientDesktopMode() == TabBoxConfig::AllDesktopsClients);
         item->setCurrentIndex(indexRow);
         item->setNoModifierGrab(q->noModifierGrab());
@@ -368,6 +392,13 @@ void TabBoxHandler::setConfig(const TabBoxConfig& config)
     Q_EMIT configChanged();
 }
 
+void TabBoxHandler::prepare()
+{
+    if (d->config.isShowTabBox()) {
+        d->prepare();
+    }
+}
+
 void TabBoxHandler::show()
 {
     d->isShown = true;
@@ -226,6 +226,12 @@ public:
      * @see TabBoxConfig::isHighlightWindows
      */
     void show();
+    /**
+     * Instantiates the TabBoxView of the current configuration without showing
+     * it, so that the first call to show() does not have to load it.
+     * @since 5.25
+     */
+    void prepare();
     /**
      * Hides the TabBoxView if shown.
      * Deactivates highlight windows effect if active.
@@ -90,7 +90,7 @@ void X11Filter::motion(xcb_generic_event_t *event)
     auto *mouseEvent = reinterpret_cast<xcb_motion_notify_event_t*>(event);
     const QPoint rootPos(mouseEvent->root_x, mouseEvent->root_y);
     // TODO: this should be in ScreenEdges directly
-    ScreenEdges::self()->check(rootPos, QDateTime::fromMSecsSinceEpoch(xTime(), Qt::UTC), true);
+    ScreenEdges::self()->check(rootPos, std::chrono::milliseconds(xTime()), true);
     xcb_allow_events(connection(), XCB_ALLOW_ASYNC_POINTER, XCB_CURRENT_TIME);
 }
 
@@ -0,0 +1,431 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "tilemanager.h"
+#include "abstract_client.h"
+#include "abstract_output.h"
+#include "geometrytransaction.h"
+#include "main.h"
+#include "platform.h"
+#include "virtualdesktops.h"
+#include "workspace.h"
+
+namespace KWin
+{
+
+Tile::Tile(TileManager *manager, Tile *parentTile)
+    : QObject(parentTile ? static_cast<QObject *>(parentTile) : manager)
+    , m_manager(manager)
+    , m_parentTile(parentTile)
+{
+}
+
+Tile::~Tile()
+{
+    for (AbstractClient *client : qAsConst(m_windows)) {
+        m_manager->setWindowTile(client, nullptr);
+    }
+}
+
+QRect Tile::geometry() const
+{
+    return m_geometry;
+}
+
+qreal Tile::ratio() const
+{
+    return m_ratio;
+}
+
+void Tile::setRatio(qreal ratio)
+{
+    // The root tile and a single child always cover the whole area.
+    if (!m_parentTile || m_parentTile->m_childTiles.count() < 2) {
+        return;
+    }
+    ratio = qBound(0.05, ratio, 0.95);
+    if (qFuzzyCompare(m_ratio, ratio)) {
+        return;
+    }
+
+    // The siblings share the rest of the area in their current proportions.
+    const qreal scale = (1.0 - ratio) / (1.0 - m_ratio);
+    for (Tile *sibling : qAsConst(m_parentTile->m_childTiles)) {
+        if (sibling != this) {
+            sibling->m_ratio *= scale;
+            Q_EMIT sibling->ratioChanged();
+        }
+    }
+    m_ratio = ratio;
+    Q_EMIT ratioChanged();
+
+    m_parentTile->relayout();
+}
+
+Qt::Orientation Tile::orientation() const
+{
+    return m_orientation;
+}
+
+Tile *Tile::parentTile() const
+{
+    return m_parentTile;
+}
+
+QList<Tile *> Tile::childTiles() const
+{
+    return m_childTiles;
+}
+
+QList<AbstractClient *> Tile::windows() const
+{
+    return m_windows;
+}
+
+Tile *Tile::split(Qt::Orientation orientation)
+{
+    if (!m_childTiles.isEmpty() && m_orientation != orientation) {
+        return nullptr;
+    }
+
+    if (m_childTiles.isEmpty()) {
+        if (m_orientation != orientation) {
+            m_orientation = orientation;
+            Q_EMIT orientationChanged();
+        }
+        Tile *first = new Tile(m_manager, this);
+        first->takeWindows(this);
+        m_childTiles.append(first);
+    }
+
+    const qreal count = m_childTiles.count();
+    for (Tile *child : qAsConst(m_childTiles)) {
+        child->m_ratio *= count / (count + 1);
+        Q_EMIT child->ratioChanged();
+    }
+
+    Tile *tile = new Tile(m_manager, this);
+    tile->m_ratio = 1.0 / (count + 1);
+    m_childTiles.append(tile);
+    Q_EMIT childTilesChanged();
+
+    relayout();
+    return tile;
+}
+
+void Tile::remove()
+{
+    Tile *parentTile = m_parentTile;
+    if (!parentTile) {
+        return;
+    }
+
+    const int index = parentTile->m_childTiles.indexOf(this);
+    parentTile->m_childTiles.removeAt(index);
+
+    // The parent had at least two children, so there is always a sibling.
+    Tile *sibling = parentTile->m_childTiles.at(qMax(0, index - 1));
+    sibling->firstLeaf()->takeWindows(this);
+    parentTile->rescaleRatios();
+
+    // A split with a single child is pointless, the parent takes over the child.
+    if (parentTile->m_childTiles.count() == 1) {
+        Tile *child = parentTile->m_childTiles.takeFirst();
+        if (child->m_childTiles.isEmpty()) {
+            parentTile->takeWindows(child);
+        } else {
+            parentTile->m_orientation = child->m_orientation;
+            parentTile->m_childTiles = child->m_childTiles;
+            child->m_childTiles.clear();
+            for (Tile *grandChild : qAsConst(parentTile->m_childTiles)) {
+                grandChild->setParentTile(parentTile);
+            }
+            Q_EMIT parentTile->orientationChanged();
+        }
+        child->deleteLater();
+    }
+    Q_EMIT parentTile->childTilesChanged();
+
+    parentTile->relayout();
+    deleteLater();
+}
+
+void Tile::addWindow(AbstractClient *client)
+{
+    if (!client) {
+        return;
+    }
+    Tile *leaf = firstLeaf();
+    Tile *previous = m_manager->tileForWindow(client);
+    if (previous == leaf) {
+        return;
+    }
+    if (previous) {
+        previous->removeWindow(client);
+    }
+
+    leaf->m_windows.append(client);
+    m_manager->setWindowTile(client, leaf);
+    Q_EMIT leaf->windowsChanged();
+
+    GeometryTransaction transaction(workspace());
+    leaf->layoutWindow(client, transaction);
+}
+
+void Tile::removeWindow(AbstractClient *client)
+{
+    if (m_windows.removeOne(client)) {
+        m_manager->setWindowTile(client, nullptr);
+        Q_EMIT windowsChanged();
+    }
+}
+
+Tile *Tile::firstLeaf()
+{
+    Tile *tile = this;
+    while (!tile->m_childTiles.isEmpty()) {
+        tile = tile->m_childTiles.constFirst();
+    }
+    return tile;
+}
+
+void Tile::setParentTile(Tile *parentTile)
+{
+    m_parentTile = parentTile;
+    setParent(parentTile);
+    Q_EMIT parentTileChanged();
+}
+
+void Tile::setGeometry(const QRect &geometry, GeometryTransaction &transaction)
+{
+    // Nothing below this tile changes if its area stays the same.
+    if (m_geometry == geometry && !m_layoutDirty) {
+        return;
+    }
+    m_layoutDirty = false;
+
+    if (m_geometry != geometry) {
+        m_geometry = geometry;
+        Q_EMIT geometryChanged();
+    }
+
+    if (m_childTiles.isEmpty()) {
+        for (AbstractClient *client : qAsConst(m_windows)) {
+            layoutWindow(client, transaction);
+        }
+    } else {
+        layoutChildren(transaction);
+    }
+}
+
+void Tile::relayout()
+{
+    GeometryTransaction transaction(workspace());
+    m_layoutDirty = true;
+    setGeometry(m_geometry, transaction);
+}
+
+void Tile::layoutChildren(GeometryTransaction &transaction)
+{
+    const bool horizontal = m_orientation == Qt::Horizontal;
+    const int start = horizontal ? m_geometry.x() : m_geometry.y();
+    const int length = horizontal ? m_geometry.width() : m_geometry.height();
+
+    // The edges are rounded from the accumulated ratios, so the tiles never leave gaps.
+    qreal accumulated = 0;
+    int edge = start;
+    for (int i = 0; i < m_childTiles.count(); ++i) {
+        Tile *child = m_childTiles[i];
+        accumulated += child->m_ratio;
+        const int nextEdge = i == m_childTiles.count() - 1 ? start + length : start + qRound(length * accumulated);
+
+        QRect geometry = m_geometry;
+        if (horizontal) {
+            geometry.setLeft(edge);
+            geometry.setRight(nextEdge - 1);
+        } else {
+            geometry.setTop(edge);
+            geometry.setBottom(nextEdge - 1);
+        }
+        child->setGeometry(geometry, transaction);
+        edge = nextEdge;
+    }
+}
+
+void Tile::layoutWindow(AbstractClient *client, GeometryTransaction &transaction)
+{
+    if (client->isFullScreen() || m_geometry.isEmpty()) {
+        return;
+    }
+    transaction.add(client);
+    if (client->maximizeMode() != MaximizeRestore) {
+        client->maximize(MaximizeRestore);
+    }
+    client->moveResize(m_geometry);
+}
+
+void Tile::rescaleRatios()
+{
+    qreal total = 0;
+    for (const Tile *child : qAsConst(m_childTiles)) {
+        total += child->m_ratio;
+    }
+    if (qFuzzyIsNull(total)) {
+        return;
+    }
+    for (Tile *child : qAsConst(m_childTiles)) {
+        child->m_ratio /= total;
+        Q_EMIT child->ratioChanged();
+    }
+}
+
+void Tile::takeWindows(Tile *tile)
+{
+    for (Tile *child : qAsConst(tile->m_childTiles)) {
+        takeWindows(child);
+    }
+    if (tile->m_windows.isEmpty()) {
+        return;
+    }
+    for (AbstractClient *client : qAsConst(tile->m_windows)) {
+        m_windows.append(client);
+        m_manager->setWindowTile(client, this);
+    }
+    tile->m_windows.clear();
+    Q_EMIT tile->windowsChanged();
+    Q_EMIT windowsChanged();
+}
+
+KWIN_SINGLETON_FACTORY(TileManager)
+
+TileManager::TileManager(QObject *parent)
+    : QObject(parent)
+{
+    connect(workspace(), &Workspace::clientAreasChanged, this, &TileManager::updateRootGeometries);
+    connect(workspace(), &Workspace::clientRemoved, this, &TileManager::handleWindowRemoved);
+    connect(kwinApp()->platform(), &Platform::outputDisabled, this, &TileManager::handleOutputDisabled);
+    connect(VirtualDesktopManager::self(), &VirtualDesktopManager::desktopRemoved, this, &TileManager::handleDesktopRemoved);
+}
+
+TileManager::~TileManager()
+{
+    // The tiles need the manager while they are destroyed.
+    qDeleteAll(m_rootTiles);
+    m_rootTiles.clear();
+    s_self = nullptr;
+}
+
+Tile *TileManager::rootTile(AbstractOutput *output, VirtualDesktop *desktop)
+{
+    if (!output || !desktop) {
+        return nullptr;
+    }
+    const auto key = qMakePair(output, desktop);
+    Tile *&tile = m_rootTiles[key];
+    if (!tile) {
+        tile = new Tile(this, nullptr);
+        tile->m_geometry = workspace()->clientArea(MaximizeArea, output, desktop);
+    }
+    return tile;
+}
+
+Tile *TileManager::tileForWindow(AbstractClient *client) const
+{
+    return m_windowTiles.value(client);
+}
+
+void TileManager::updateRootGeometries()
+{
+    GeometryTransaction transaction(workspace());
+    for (auto it = m_rootTiles.constBegin(); it != m_rootTiles.constEnd(); ++it) {
+        it.value()->setGeometry(workspace()->clientArea(MaximizeArea, it.key().first, it.key().second), transaction);
+    }
+}
+
+void TileManager::setWindowTile(AbstractClient *client, Tile *tile)
+{
+    if (!tile) {
+        m_windowTiles.remove(client);
+        // The connections are safe to disconnect even if the window is already destroyed.
+        const QVector<QMetaObject::Connection> connections = m_windowConnections.take(client);
+        for (const QMetaObject::Connection &connection : connections) {
+            disconnect(connection);
+        }
+        return;
+    }
+
+    if (!m_windowTiles.contains(client)) {
+        QVector<QMetaObject::Connection> &connections = m_windowConnections[client];
+        // Moving a window out of its tile by hand untiles it.
+        connections.append(connect(client, &AbstractClient::clientStartUserMovedResized, this, [this, client]() {
+            if (client->isInteractiveMove()) {
+                if (Tile *tile = tileForWindow(client)) {
+                    tile->removeWindow(client);
+                }
+            }
+        }));
+        // So does sending it to a desktop or an output that its tile isn't on.
+        connections.append(connect(client, &AbstractClient::desktopChanged, this, [this, client]() {
+            checkWindowTile(client);
+        }));
+        connections.append(connect(client, &AbstractClient::screenChanged, this, [this, client]() {
+            checkWindowTile(client);
+        }));
+    }
+    m_windowTiles[client] = tile;
+}
+
+void TileManager::checkWindowTile(AbstractClient *client)
+{
+    Tile *tile = tileForWindow(client);
+    if (!tile) {
+        return;
+    }
+    Tile *root = tile;
+    while (root->parentTile()) {
+        root = root->parentTile();
+    }
+    const auto key = m_rootTiles.key(root);
+    if (client->output() != key.first || !client->isOnDesktop(key.second)) {
+        tile->removeWindow(client);
+    }
+}
+
+void TileManager::handleWindowRemoved(AbstractClient *client)
+{
+    if (Tile *tile = tileForWindow(client)) {
+        tile->removeWindow(client);
+    }
+}
+
+void TileManager::handleOutputDisabled(AbstractOutput *output)
+{
+    for (auto it = m_rootTiles.begin(); it != m_rootTiles.end();) {
+        if (it.key().first == output) {
+            delete it.value();
+            it = m_rootTiles.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void TileManager::handleDesktopRemoved(VirtualDesktop *desktop)
+{
+    for (auto it = m_rootTiles.begin(); it != m_rootTiles.end();) {
+        if (it.key().second == desktop) {
+            delete it.value();
+            it = m_rootTiles.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+} // namespace KWin
@@ -0,0 +1,160 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <kwinglobals.h>
+
+#include <QHash>
+#include <QObject>
+#include <QPair>
+#include <QRect>
+#include <QVector>
+
+namespace KWin
+{
+
+class AbstractClient;
+class AbstractOutput;
+class GeometryTransaction;
+class TileManager;
+class VirtualDesktop;
+
+/**
+ * The Tile class represents a node in the tile tree of an output and a virtual desktop.
+ *
+ * A tile either splits its area between its child tiles, or it is a leaf and the windows
+ * in it fill its area. Each child tile takes the ratio() of its parent's area along the
+ * orientation() of the parent.
+ *
+ * Changing the tree only lays out the subtree affected by the change, and only the tiles
+ * whose geometry actually changes move their windows.
+ */
+class KWIN_EXPORT Tile : public QObject
+{
+    Q_OBJECT
+    /**
+     * The area covered by this tile.
+     */
+    Q_PROPERTY(QRect geometry READ geometry NOTIFY geometryChanged)
+    /**
+     * The share of the parent tile's area that this tile takes, between 0 and 1.
+     */
+    Q_PROPERTY(qreal ratio READ ratio WRITE setRatio NOTIFY ratioChanged)
+    /**
+     * Whether the child tiles are laid out side by side or stacked on top of each other.
+     */
+    Q_PROPERTY(Qt::Orientation orientation READ orientation NOTIFY orientationChanged)
+    Q_PROPERTY(KWin::Tile *parentTile READ parentTile NOTIFY parentTileChanged)
+    Q_PROPERTY(QList<KWin::Tile *> tiles READ childTiles NOTIFY childTilesChanged)
+    Q_PROPERTY(QList<KWin::AbstractClient *> windows READ windows NOTIFY windowsChanged)
+
+public:
+    ~Tile() override;
+
+    QRect geometry() const;
+    qreal ratio() const;
+    void setRatio(qreal ratio);
+    Qt::Orientation orientation() const;
+    Tile *parentTile() const;
+    QList<Tile *> childTiles() const;
+    QList<AbstractClient *> windows() const;
+
+    /**
+     * Splits the tile in the given @p orientation and returns the new tile. The windows
+     * of a leaf tile stay in the first half. If the tile is already split in the same
+     * orientation, a new child tile is appended instead. Returns @c null if the tile is
+     * split in the other orientation.
+     */
+    Q_INVOKABLE KWin::Tile *split(Qt::Orientation orientation);
+    /**
+     * Removes the tile from its parent. The windows in it are moved to a sibling tile.
+     * The root tile can't be removed.
+     */
+    Q_INVOKABLE void remove();
+    /**
+     * Moves the @p client into this tile. If this tile is split, the window goes into
+     * its first leaf tile.
+     */
+    Q_INVOKABLE void addWindow(KWin::AbstractClient *client);
+    Q_INVOKABLE void removeWindow(KWin::AbstractClient *client);
+
+Q_SIGNALS:
+    void geometryChanged();
+    void ratioChanged();
+    void orientationChanged();
+    void parentTileChanged();
+    void childTilesChanged();
+    void windowsChanged();
+
+private:
+    Tile(TileManager *manager, Tile *parentTile);
+
+    Tile *firstLeaf();
+    void setParentTile(Tile *parentTile);
+    void setGeometry(const QRect &geometry, GeometryTransaction &transaction);
+    void relayout();
+    void layoutChildren(GeometryTransaction &transaction);
+    void layoutWindow(AbstractClient *client, GeometryTransaction &transaction);
+    void rescaleRatios();
+    void takeWindows(Tile *tile);
+
+    TileManager *m_manager;
+    Tile *m_parentTile;
+    QList<Tile *> m_childTiles;
+    QList<AbstractClient *> m_windows;
+    QRect m_geometry;
+    qreal m_ratio = 1.0;
+    Qt::Orientation m_orientation = Qt::Horizontal;
+    // set when the children have to be laid out even if the geometry stays the same
+    bool m_layoutDirty = false;
+
+    friend class TileManager;
+};
+
+/**
+ * The TileManager class owns the tile trees, one for each output and virtual desktop.
+ *
+ * The root tile of a tree covers the maximize area of its output. When the client areas
+ * change, only the trees whose area has changed are laid out again.
+ */
+class KWIN_EXPORT TileManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    ~TileManager() override;
+
+    /**
+     * Returns the root tile for the given @p output and @p desktop. The tile is created
+     * when it's requested for the first time.
+     */
+    Tile *rootTile(AbstractOutput *output, VirtualDesktop *desktop);
+    /**
+     * Returns the tile that contains the @p client, or @c null if the window isn't tiled.
+     */
+    Tile *tileForWindow(AbstractClient *client) const;
+
+private:
+    void updateRootGeometries();
+    void setWindowTile(AbstractClient *client, Tile *tile);
+    void checkWindowTile(AbstractClient *client);
+    void handleWindowRemoved(AbstractClient *client);
+    void handleOutputDisabled(AbstractOutput *output);
+    void handleDesktopRemoved(VirtualDesktop *desktop);
+
+    QHash<QPair<AbstractOutput *, VirtualDesktop *>, Tile *> m_rootTiles;
+    QHash<AbstractClient *, Tile *> m_windowTiles;
+    QHash<AbstractClient *, QVector<QMetaObject::Connection>> m_windowConnections;
+
+    friend class Tile;
+    KWIN_SINGLETON(TileManager)
+};
+
+} // namespace KWin
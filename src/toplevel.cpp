@@ -198,7 +198,11 @@ QByteArray Toplevel::wmCommand()
 
 void Toplevel::getWmClientMachine()
 {
-    m_clientMachine->resolve(window(), wmClientLeader());
+    if (info && (info->passedProperties2() & NET::WM2ClientMachine)) {
+        m_clientMachine->resolve(info->clientMachine(), window(), wmClientLeader());
+    } else {
+        m_clientMachine->resolve(window(), wmClientLeader());
+    }
 }
 
 /**
@@ -361,6 +365,7 @@ void Toplevel::setReadyForPainting()
     if (!ready_for_painting) {
         ready_for_painting = true;
         if (Compositor::compositing()) {
+            Compositor::self()->invalidateRenderList();
             addRepaintFull();
             Q_EMIT windowShown(this);
         }
@@ -709,6 +714,12 @@ bool Toplevel::isOnDesktop(VirtualDesktop *desktop) const
     return isOnAllDesktops() || desktops().contains(desktop);
 }
 
+bool Toplevel::isOnActivity(const QString &activity) const
+{
+    const QStringList activities = this->activities();
+    return activities.isEmpty() || activities.contains(activity);
+}
+
 bool Toplevel::isOnDesktop(int d) const
 {
     return isOnDesktop(VirtualDesktopManager::self()->desktopForX11Id(d));
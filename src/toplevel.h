@@ -401,9 +401,9 @@ public:
     virtual int desktop() const = 0;
     virtual QVector<VirtualDesktop *> desktops() const = 0;
     virtual QStringList activities() const = 0;
-    bool isOnDesktop(VirtualDesktop *desktop) const;
+    virtual bool isOnDesktop(VirtualDesktop *desktop) const;
     bool isOnDesktop(int d) const;
-    bool isOnActivity(const QString &activity) const;
+    virtual bool isOnActivity(const QString &activity) const;
     bool isOnCurrentDesktop() const;
     bool isOnCurrentActivity() const;
     bool isOnAllDesktops() const;
@@ -927,11 +927,6 @@ inline bool Toplevel::isOnAllActivities() const
     return activities().isEmpty();
 }
 
-inline bool Toplevel::isOnActivity(const QString &activity) const
-{
-    return activities().isEmpty() || activities().contains(activity);
-}
-
 inline QByteArray Toplevel::resourceName() const
 {
     return resource_name; // it is always lowercase
@@ -109,7 +109,8 @@ bool Unmanaged::track(xcb_window_t w)
                           NET::WM2Opacity |
                           NET::WM2WindowRole |
                           NET::WM2WindowClass |
-                          NET::WM2OpaqueRegion);
+                          NET::WM2OpaqueRegion |
+                          NET::WM2ClientMachine);
     setOpacity(info->opacityF());
     getResourceClass();
     getWmClientLeader();
@@ -142,7 +143,7 @@ void Unmanaged::release(ReleaseReason releaseReason)
         Xcb::selectInput(window(), XCB_EVENT_MASK_NO_EVENT);
     }
     workspace()->removeUnmanaged(this);
-    if (releaseReason != ReleaseReason::KWinShutsDown) {
+    if (del) {
         disownDataPassedToDeleted();
         del->unrefWindow();
     }
@@ -206,12 +207,12 @@ QWindow *Unmanaged::findInternalWindow() const
     return nullptr;
 }
 
-void Unmanaged::damageNotifyEvent()
+void Unmanaged::damageNotifyEvent(xcb_damage_notify_event_t *event)
 {
     Q_ASSERT(kwinApp()->operationMode() == Application::OperationModeX11);
     SurfaceItemX11 *item = static_cast<SurfaceItemX11 *>(surfaceItem());
     if (item) {
-        item->processDamage();
+        item->processDamage(event);
     }
 }
 
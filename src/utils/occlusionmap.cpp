@@ -0,0 +1,145 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "occlusionmap.h"
+
+#include <algorithm>
+
+namespace KWin
+{
+
+void OcclusionMap::reset(const QRect &bounds)
+{
+    m_bounds = bounds;
+    m_boundingRect = QRect();
+    m_region = QRegion();
+
+    m_columns = (bounds.width() + tileSize - 1) / tileSize;
+    m_rows = (bounds.height() + tileSize - 1) / tileSize;
+
+    // QVector keeps its capacity, so this only allocates if the bounds have grown.
+    m_tiles.resize(m_columns * m_rows);
+    m_tiles.fill(false);
+}
+
+void OcclusionMap::markTiles(const QRect &rect)
+{
+    const QRect clipped = rect & m_bounds;
+    if (clipped.isEmpty()) {
+        return;
+    }
+
+    const int left = clipped.x() - m_bounds.x();
+    const int top = clipped.y() - m_bounds.y();
+    const int right = left + clipped.width();
+    const int bottom = top + clipped.height();
+
+    // Only the tiles that are entirely inside the rect are marked as covered. The tiles
+    // at the right and bottom edges of the bounds may be cut, they count as covered
+    // if the rect extends to the edge.
+    const int firstColumn = (left + tileSize - 1) / tileSize;
+    const int firstRow = (top + tileSize - 1) / tileSize;
+    const int lastColumn = (right == m_bounds.width() ? m_columns : right / tileSize) - 1;
+    const int lastRow = (bottom == m_bounds.height() ? m_rows : bottom / tileSize) - 1;
+
+    for (int row = firstRow; row <= lastRow; ++row) {
+        bool *tiles = m_tiles.data() + row * m_columns;
+        std::fill(tiles + firstColumn, tiles + lastColumn + 1, true);
+    }
+}
+
+void OcclusionMap::add(const QRegion &region)
+{
+    if (region.isEmpty()) {
+        return;
+    }
+
+    bool occluded = true;
+    for (const QRect &rect : region) {
+        if (!isOccluded(rect)) {
+            occluded = false;
+            markTiles(rect);
+        }
+    }
+
+    // Skip the union if the region adds nothing to the occluded area.
+    if (!occluded) {
+        m_region |= region;
+        m_boundingRect |= region.boundingRect();
+    }
+}
+
+bool OcclusionMap::isOccluded(const QRect &rect) const
+{
+    if (rect.isEmpty()) {
+        return true;
+    }
+    if (!m_bounds.contains(rect)) {
+        return false;
+    }
+
+    const int firstColumn = (rect.x() - m_bounds.x()) / tileSize;
+    const int firstRow = (rect.y() - m_bounds.y()) / tileSize;
+    const int lastColumn = (rect.x() + rect.width() - 1 - m_bounds.x()) / tileSize;
+    const int lastRow = (rect.y() + rect.height() - 1 - m_bounds.y()) / tileSize;
+
+    for (int row = firstRow; row <= lastRow; ++row) {
+        const bool *tiles = m_tiles.constData() + row * m_columns;
+        for (int column = firstColumn; column <= lastColumn; ++column) {
+            if (!tiles[column]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+QRegion OcclusionMap::subtract(const QRegion &region) const
+{
+    if (m_region.isEmpty() || region.isEmpty()) {
+        return region;
+    }
+    if (!region.boundingRect().intersects(m_boundingRect)) {
+        return region;
+    }
+
+    bool occluded = true;
+    bool disjoint = true;
+    for (const QRect &rect : region) {
+        if (!rect.intersects(m_boundingRect)) {
+            occluded = false;
+        } else if (isOccluded(rect)) {
+            disjoint = false;
+        } else {
+            occluded = false;
+            disjoint = false;
+            break;
+        }
+    }
+
+    if (occluded) {
+        return QRegion();
+    }
+    if (disjoint) {
+        return region;
+    }
+    return region - m_region;
+}
+
+QRegion OcclusionMap::region() const
+{
+    return m_region;
+}
+
+bool OcclusionMap::isEmpty() const
+{
+    return m_region.isEmpty();
+}
+
+} // namespace KWin
@@ -0,0 +1,75 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "kwinglobals.h"
+
+#include <QRegion>
+#include <QVector>
+
+namespace KWin
+{
+
+/**
+ * The OcclusionMap class accumulates the opaque areas of windows during the occlusion
+ * culling pass and subtracts them from the regions of the windows below.
+ *
+ * Besides the exact occluded region, the map keeps a coarse bitmap of tiles that are
+ * entirely covered by a single opaque rectangle. Regions that fall completely into
+ * covered tiles, or don't touch the occluded area at all, are resolved without any
+ * QRegion arithmetic, which is the common case for tiled, non-overlapping windows.
+ *
+ * The tile storage is reused between frames, so resetting the map doesn't allocate
+ * unless the bounds grow.
+ */
+class KWIN_EXPORT OcclusionMap
+{
+public:
+    /**
+     * Clears the map and sets the area covered by the tile bitmap to @a bounds.
+     */
+    void reset(const QRect &bounds);
+
+    /**
+     * Marks the specified opaque @a region as occluded.
+     */
+    void add(const QRegion &region);
+
+    /**
+     * Returns the part of @a region that is not occluded.
+     */
+    QRegion subtract(const QRegion &region) const;
+
+    /**
+     * Returns @c true if @a rect is fully inside covered tiles.
+     */
+    bool isOccluded(const QRect &rect) const;
+
+    /**
+     * Returns the exact occluded region.
+     */
+    QRegion region() const;
+
+    bool isEmpty() const;
+
+    static constexpr int tileSize = 64;
+
+private:
+    void markTiles(const QRect &rect);
+
+    QRect m_bounds;
+    QRect m_boundingRect;
+    QRegion m_region;
+    QVector<bool> m_tiles;
+    int m_columns = 0;
+    int m_rows = 0;
+};
+
+} // namespace KWin
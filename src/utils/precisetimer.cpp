@@ -0,0 +1,118 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "precisetimer.h"
+#include "common.h"
+
+#include <QSocketNotifier>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace KWin
+{
+
+PreciseTimer::PreciseTimer(QObject *parent)
+    : QObject(parent)
+{
+    m_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (m_fd != -1) {
+        m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+        connect(m_notifier, &QSocketNotifier::activated, this, &PreciseTimer::handleTimeout);
+    } else {
+        qCWarning(KWIN_CORE, "Failed to create a timerfd, falling back to QTimer: %s", strerror(errno));
+        m_fallbackTimer.setSingleShot(true);
+        m_fallbackTimer.setTimerType(Qt::PreciseTimer);
+        connect(&m_fallbackTimer, &QTimer::timeout, this, &PreciseTimer::handleTimeout);
+    }
+}
+
+PreciseTimer::~PreciseTimer()
+{
+    if (m_fd != -1) {
+        close(m_fd);
+    }
+}
+
+void PreciseTimer::start(std::chrono::nanoseconds deadline)
+{
+    m_active = true;
+    m_deadline = deadline;
+
+    if (m_fd == -1) {
+        const std::chrono::nanoseconds currentTime(std::chrono::steady_clock::now().time_since_epoch());
+        const std::chrono::nanoseconds interval = std::max(deadline - currentTime, std::chrono::nanoseconds::zero());
+        // Round up so the fallback timer doesn't fire before the deadline.
+        m_fallbackTimer.start(std::chrono::ceil<std::chrono::milliseconds>(interval));
+        return;
+    }
+
+    // A zero itimerspec disarms the timer, make sure that the deadline is non-zero.
+    const std::chrono::nanoseconds expiration = std::max(deadline, std::chrono::nanoseconds(1));
+
+    itimerspec spec = {};
+    spec.it_value.tv_sec = std::chrono::duration_cast<std::chrono::seconds>(expiration).count();
+    spec.it_value.tv_nsec = (expiration % std::chrono::seconds(1)).count();
+
+    if (timerfd_settime(m_fd, TFD_TIMER_ABSTIME, &spec, nullptr) == -1) {
+        qCWarning(KWIN_CORE, "Failed to arm the timerfd: %s", strerror(errno));
+        m_active = false;
+    }
+}
+
+void PreciseTimer::stop()
+{
+    if (!m_active) {
+        return;
+    }
+    m_active = false;
+
+    if (m_fd == -1) {
+        m_fallbackTimer.stop();
+        return;
+    }
+
+    const itimerspec spec = {};
+    timerfd_settime(m_fd, TFD_TIMER_ABSTIME, &spec, nullptr);
+
+    // Drain the expiration counter in case the timer has expired, but the socket
+    // notifier hasn't been activated yet.
+    uint64_t expirationCount;
+    read(m_fd, &expirationCount, sizeof(expirationCount));
+}
+
+bool PreciseTimer::isActive() const
+{
+    return m_active;
+}
+
+std::chrono::nanoseconds PreciseTimer::deadline() const
+{
+    return m_deadline;
+}
+
+void PreciseTimer::handleTimeout()
+{
+    if (m_fd != -1) {
+        uint64_t expirationCount;
+        if (read(m_fd, &expirationCount, sizeof(expirationCount)) != sizeof(expirationCount)) {
+            return;
+        }
+    }
+
+    if (m_active) {
+        m_active = false;
+        Q_EMIT timeout();
+    }
+}
+
+} // namespace KWin
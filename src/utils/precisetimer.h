@@ -0,0 +1,74 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "kwinglobals.h"
+
+#include <QObject>
+#include <QTimer>
+
+#include <chrono>
+
+class QSocketNotifier;
+
+namespace KWin
+{
+
+/**
+ * The PreciseTimer class provides a single-shot timer with a sub-millisecond precision.
+ *
+ * Unlike QTimer, the timeout is specified as an absolute timestamp from the monotonic
+ * clock, so there is no rounding involved and the timer never fires before the deadline.
+ * If timerfd is unavailable, PreciseTimer falls back to a QTimer of Qt::PreciseTimer type.
+ */
+class KWIN_EXPORT PreciseTimer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PreciseTimer(QObject *parent = nullptr);
+    ~PreciseTimer() override;
+
+    /**
+     * Starts or restarts the timer so it fires at the specified @a deadline. The deadline
+     * is a timestamp sourced from the monotonic clock, e.g. std::chrono::steady_clock.
+     */
+    void start(std::chrono::nanoseconds deadline);
+
+    /**
+     * Stops the timer.
+     */
+    void stop();
+
+    /**
+     * Returns @c true if the timer is running; otherwise returns @c false.
+     */
+    bool isActive() const;
+
+    /**
+     * Returns the deadline at which the timer fires. The value is only meaningful while
+     * the timer is active.
+     */
+    std::chrono::nanoseconds deadline() const;
+
+Q_SIGNALS:
+    void timeout();
+
+private:
+    void handleTimeout();
+
+    QSocketNotifier *m_notifier = nullptr;
+    QTimer m_fallbackTimer;
+    std::chrono::nanoseconds m_deadline = std::chrono::nanoseconds::zero();
+    int m_fd = -1;
+    bool m_active = false;
+};
+
+} // namespace KWin
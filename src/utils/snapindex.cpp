@@ -0,0 +1,84 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "snapindex.h"
+
+#include <algorithm>
+
+namespace KWin
+{
+
+void SnapIndex::clear()
+{
+    m_entries.clear();
+    m_maximumWidth = 0;
+}
+
+void SnapIndex::insert(int key, const QRect &rect)
+{
+    remove(key);
+
+    const auto it = std::upper_bound(m_entries.begin(), m_entries.end(), rect.left(), [](int left, const Entry &entry) {
+        return left < entry.rect.left();
+    });
+    m_entries.insert(it, Entry{rect, key});
+    m_maximumWidth = std::max(m_maximumWidth, rect.width());
+}
+
+void SnapIndex::remove(int key)
+{
+    const auto it = std::find_if(m_entries.begin(), m_entries.end(), [key](const Entry &entry) {
+        return entry.key == key;
+    });
+    if (it == m_entries.end()) {
+        return;
+    }
+    const bool widest = it->rect.width() == m_maximumWidth;
+    m_entries.erase(it);
+    if (widest) {
+        updateMaximumWidth();
+    }
+}
+
+QVector<int> SnapIndex::query(const QRect &rect) const
+{
+    QVector<int> keys;
+    if (rect.isEmpty()) {
+        return keys;
+    }
+
+    // A rect can only intersect if its left edge is at most one maximum width away.
+    const int first = rect.left() - m_maximumWidth;
+    auto it = std::lower_bound(m_entries.cbegin(), m_entries.cend(), first, [](const Entry &entry, int left) {
+        return entry.rect.left() < left;
+    });
+    for (; it != m_entries.cend() && it->rect.left() <= rect.right(); ++it) {
+        if (it->rect.intersects(rect)) {
+            keys.append(it->key);
+        }
+    }
+
+    std::sort(keys.begin(), keys.end());
+    return keys;
+}
+
+int SnapIndex::count() const
+{
+    return m_entries.count();
+}
+
+void SnapIndex::updateMaximumWidth()
+{
+    m_maximumWidth = 0;
+    for (const Entry &entry : qAsConst(m_entries)) {
+        m_maximumWidth = std::max(m_maximumWidth, entry.rect.width());
+    }
+}
+
+} // namespace KWin
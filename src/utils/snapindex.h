@@ -0,0 +1,63 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2022 KWin Contributors
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "kwinglobals.h"
+
+#include <QRect>
+#include <QVector>
+
+namespace KWin
+{
+
+/**
+ * The SnapIndex class finds the window rects near a window that is being moved or resized.
+ *
+ * The rects are kept sorted by their left edge, together with the widest rect, so a query
+ * only has to look at the rects whose left edge falls into a narrow range. Every rect is
+ * identified by a key, the matches are returned in ascending key order so the callers can
+ * keep visiting the windows in stacking order.
+ */
+class KWIN_EXPORT SnapIndex
+{
+public:
+    void clear();
+
+    /**
+     * Adds the @a rect with the given @a key, or updates the rect if the key is already known.
+     */
+    void insert(int key, const QRect &rect);
+
+    /**
+     * Removes the rect with the given @a key.
+     */
+    void remove(int key);
+
+    /**
+     * Returns the keys of the rects that intersect @a rect, in ascending order.
+     */
+    QVector<int> query(const QRect &rect) const;
+
+    int count() const;
+
+private:
+    struct Entry
+    {
+        QRect rect;
+        int key;
+    };
+
+    void updateMaximumWidth();
+
+    QVector<Entry> m_entries;
+    int m_maximumWidth = 0;
+};
+
+} // namespace KWin
@@ -278,6 +278,12 @@ public:
     inline bool isRetrieved() const {
         return m_retrieved;
     }
+    /**
+     * Returns the sequence number of the request, or @c 0 if no request has been sent.
+     */
+    inline unsigned int sequence() const {
+        return m_cookie.sequence;
+    }
     /**
      * Returns the value of the reply pointer referenced by this object. The reply pointer of
      * this object will be reset to null. Calling any method which requires the reply to be valid
@@ -122,6 +122,11 @@ void VirtualDesktop::setId(const QString &id)
     m_id = id;
 }
 
+void VirtualDesktop::setMembershipBit(quint32 bit)
+{
+    m_membershipBit = bit;
+}
+
 void VirtualDesktop::setX11DesktopNumber(uint number)
 {
     //x11DesktopNumber can be changed now
@@ -448,6 +453,7 @@ VirtualDesktop *VirtualDesktopManager::createVirtualDesktop(uint position, const
     }
 
     auto *vd = new VirtualDesktop(this);
+    assignMembershipBit(vd);
     vd->setX11DesktopNumber(position + 1);
     vd->setId(generateDesktopId());
     vd->setName(desktopName);
@@ -583,6 +589,7 @@ void VirtualDesktopManager::setCount(uint count)
     } else {
         while (uint(m_desktops.count()) < count) {
             auto vd = new VirtualDesktop(this);
+            assignMembershipBit(vd);
             const int x11Number = m_desktops.count() + 1;
             vd->setX11DesktopNumber(x11Number);
             vd->setName(defaultName(x11Number));
@@ -615,6 +622,20 @@ void VirtualDesktopManager::setCount(uint count)
     Q_EMIT countChanged(oldCount, m_desktops.count());
 }
 
+void VirtualDesktopManager::assignMembershipBit(VirtualDesktop *desktop)
+{
+    // there are at most maximum() desktops, so normally there is always a free bit
+    const quint32 freeBits = ~m_usedMembershipBits;
+    if (freeBits == 0) {
+        return;
+    }
+    const quint32 bit = freeBits & -freeBits;
+    m_usedMembershipBits |= bit;
+    desktop->setMembershipBit(bit);
+    connect(desktop, &QObject::destroyed, this, [this, bit] {
+        m_usedMembershipBits &= ~bit;
+    });
+}
 
 uint VirtualDesktopManager::rows() const
 {
@@ -57,6 +57,16 @@ public:
         return m_x11DesktopNumber;
     }
 
+    /**
+     * The bit identifying this desktop in desktop membership masks, assigned by the
+     * VirtualDesktopManager. Unlike the x11DesktopNumber it stays the same for the
+     * lifetime of the desktop. @c 0 if the desktop has no bit assigned.
+     */
+    quint32 membershipBit() const {
+        return m_membershipBit;
+    }
+    void setMembershipBit(quint32 bit);
+
 Q_SIGNALS:
     void nameChanged();
     void x11DesktopNumberChanged();
@@ -69,6 +79,7 @@ private:
     QString m_id;
     QString m_name;
     int m_x11DesktopNumber = 0;
+    quint32 m_membershipBit = 0;
 
 };
 
@@ -466,8 +477,13 @@ private:
      * @param slot The slot to invoke when the action is triggered
      */
     QAction *addAction(const QString &name, const QString &label, void (VirtualDesktopManager::*slot)());
+    /**
+     * Gives @p desktop a free membership bit, released again when the desktop is destroyed.
+     */
+    void assignMembershipBit(VirtualDesktop *desktop);
 
     QVector<VirtualDesktop*> m_desktops;
+    quint32 m_usedMembershipBits = 0;
     QPointer<VirtualDesktop> m_current;
     quint32 m_rows = 2;
     bool m_navigationWrapsAround;
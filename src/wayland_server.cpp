@@ -219,6 +219,7 @@ void WaylandServer::registerShellClient(AbstractClient *client)
         connect(client, &AbstractClient::windowShown, this, &WaylandServer::shellClientShown);
     }
     m_clients << client;
+    m_clientsBySurface.insert(client->surface(), client);
 }
 
 void WaylandServer::registerXdgToplevelClient(XdgToplevelClient *client)
@@ -706,20 +707,10 @@ void WaylandServer::destroyInputMethodConnection()
 void WaylandServer::removeClient(AbstractClient *c)
 {
     m_clients.removeAll(c);
-    Q_EMIT shellClientRemoved(c);
-}
-
-static AbstractClient *findClientInList(const QList<AbstractClient *> &clients, const KWaylandServer::SurfaceInterface *surface)
-{
-    auto it = std::find_if(clients.begin(), clients.end(),
-        [surface] (AbstractClient *c) {
-            return c->surface() == surface;
-        }
-    );
-    if (it == clients.end()) {
-        return nullptr;
+    if (m_clientsBySurface.value(c->surface()) == c) {
+        m_clientsBySurface.remove(c->surface());
     }
-    return *it;
+    Q_EMIT shellClientRemoved(c);
 }
 
 AbstractClient *WaylandServer::findClient(const KWaylandServer::SurfaceInterface *surface) const
@@ -727,10 +718,7 @@ AbstractClient *WaylandServer::findClient(const KWaylandServer::SurfaceInterface
     if (!surface) {
         return nullptr;
     }
-    if (AbstractClient *c = findClientInList(m_clients, surface)) {
-        return c;
-    }
-    return nullptr;
+    return m_clientsBySurface.value(surface);
 }
 
 XdgToplevelClient *WaylandServer::findXdgToplevelClient(SurfaceInterface *surface) const
@@ -11,6 +11,7 @@
 
 #include <kwinglobals.h>
 
+#include <QHash>
 #include <QObject>
 #include <QPointer>
 #include <QSet>
@@ -270,6 +271,7 @@ private:
     KWaylandServer::KeyStateInterface *m_keyState = nullptr;
     KWaylandServer::PrimaryOutputV1Interface *m_primary = nullptr;
     QList<AbstractClient *> m_clients;
+    QHash<const KWaylandServer::SurfaceInterface *, AbstractClient *> m_clientsBySurface;
     InitializationFlags m_initFlags;
     QHash<AbstractWaylandOutput *, WaylandOutput *> m_waylandOutputs;
     QHash<AbstractWaylandOutput *, WaylandOutputDevice *> m_waylandOutputDevices;
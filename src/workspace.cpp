@@ -26,6 +26,7 @@
 #include "deleted.h"
 #include "effects.h"
 #include "focuschain.h"
+#include "geometrytransaction.h"
 #include "group.h"
 #include "input.h"
 #include "internal_client.h"
@@ -44,6 +45,7 @@
 #ifdef KWIN_BUILD_TABBOX
 #include "tabbox.h"
 #endif
+#include "tilemanager.h"
 #include "unmanaged.h"
 #include "useractions.h"
 #include "virtualdesktops.h"
@@ -61,6 +63,9 @@
 // Qt
 #include <QtConcurrentRun>
 
+#include <algorithm>
+#include <optional>
+
 namespace KWin
 {
 
@@ -221,6 +226,11 @@ void Workspace::init()
     Platform *platform = kwinApp()->platform();
     connect(platform, &Platform::outputEnabled, this, &Workspace::slotOutputEnabled);
     connect(platform, &Platform::outputDisabled, this, &Workspace::slotOutputDisabled);
+    connect(platform, &Platform::outputConfigurationApplied, this, [this]() {
+        if (m_desktopResizePending) {
+            desktopResized();
+        }
+    });
 
     const QVector<AbstractOutput *> outputs = platform->enabledOutputs();
     for (AbstractOutput *output : outputs) {
@@ -238,6 +248,7 @@ void Workspace::init()
 
     // Now we know how many desktops we'll have, thus we initialize the positioning object
     Placement::create(this);
+    TileManager::create(this);
 
     // positioning object needs to be created before the virtual desktops are loaded.
     vds->load();
@@ -308,6 +319,10 @@ void Workspace::initializeX11()
 
     // Select windowmanager privileges
     selectWmInputEventMask();
+    // The root window stacking is tracked from the events selected above, this is the
+    // only time it has to be queried
+    m_rootStackingValid = false;
+    m_xStackingQueryTree.reset(new Xcb::Tree(rootWindow()));
 
     // Compatibility
     int32_t data = 1;
@@ -446,6 +461,7 @@ void Workspace::cleanupX11()
     }
 
     manual_overlays.clear();
+    m_propagatedClientStack.clear();
 
     VirtualDesktopManager *desktopManager = VirtualDesktopManager::self();
     desktopManager->setRootInfo(nullptr);
@@ -465,6 +481,8 @@ void Workspace::cleanupX11()
     m_syncAlarmFilter.reset();
     m_wasUserInteractionFilter.reset();
     m_xStackingQueryTree.reset();
+    m_rootStacking.clear();
+    m_rootStackingValid = false;
 }
 
 Workspace::~Workspace()
@@ -693,6 +711,13 @@ void Workspace::addClient(X11Client *c)
     }
     m_x11Clients.append(c);
     m_allClients.append(c);
+    m_x11ClientsByWindow.insert(c->window(), c);
+    m_x11ClientsByFrame.insert(c->frameId(), c);
+    m_x11ClientsByWrapper.insert(c->wrapperId(), c);
+    if (c->inputId() != XCB_WINDOW_NONE) {
+        m_x11ClientsByInput.insert(c->inputId(), c);
+    }
+    m_toplevelsByInternalId.insert(c->internalId(), c);
     addToStack(c);
     markXStackingOrderAsDirty();
     updateClientArea(); // This cannot be in manage(), because the client got added only now
@@ -714,6 +739,8 @@ void Workspace::addClient(X11Client *c)
 void Workspace::addUnmanaged(Unmanaged* c)
 {
     m_unmanaged.append(c);
+    m_unmanagedByWindow.insert(c->window(), c);
+    m_toplevelsByInternalId.insert(c->internalId(), c);
     markXStackingOrderAsDirty();
 }
 
@@ -731,6 +758,12 @@ void Workspace::removeX11Client(X11Client *c)
     Q_ASSERT(m_x11Clients.contains(c));
     // TODO: if marked client is removed, notify the marked list
     m_x11Clients.removeAll(c);
+    m_x11ClientsByWindow.remove(c->window());
+    m_x11ClientsByFrame.remove(c->frameId());
+    m_x11ClientsByWrapper.remove(c->wrapperId());
+    if (c->inputId() != XCB_WINDOW_NONE) {
+        m_x11ClientsByInput.remove(c->inputId());
+    }
     Group* group = findGroup(c->window());
     if (group != nullptr)
         group->lostLeader();
@@ -741,6 +774,8 @@ void Workspace::removeUnmanaged(Unmanaged* c)
 {
     Q_ASSERT(m_unmanaged.contains(c));
     m_unmanaged.removeAll(c);
+    m_unmanagedByWindow.remove(c->window());
+    m_toplevelsByInternalId.remove(c->internalId());
     Q_EMIT unmanagedRemoved(c);
     markXStackingOrderAsDirty();
 }
@@ -753,6 +788,12 @@ void Workspace::addDeleted(Deleted* c, Toplevel *orig)
     markXStackingOrderAsDirty();
 }
 
+void Workspace::removeClosedWindow(Toplevel *window)
+{
+    removeFromStack(window);
+    markXStackingOrderAsDirty();
+}
+
 void Workspace::removeDeleted(Deleted* c)
 {
     Q_ASSERT(deleted.contains(c));
@@ -790,6 +831,7 @@ void Workspace::addShellClient(AbstractClient *client)
         }
     }
     m_allClients.append(client);
+    m_toplevelsByInternalId.insert(client->internalId(), client);
     addToStack(client);
 
     markXStackingOrderAsDirty();
@@ -826,6 +868,7 @@ void Workspace::removeShellClient(AbstractClient *client)
 void Workspace::removeAbstractClient(AbstractClient *client)
 {
     m_allClients.removeAll(client);
+    m_toplevelsByInternalId.remove(client->internalId());
     if (client == delayfocus_client) {
         cancelDelayFocus();
     }
@@ -1013,6 +1056,14 @@ void Workspace::slotCurrentDesktopChanged(uint oldDesktop, uint newDesktop)
 
 void Workspace::updateClientVisibilityOnDesktopChange(VirtualDesktop *newDesktop)
 {
+    // Only X11 clients need to be mapped or unmapped, the others are shown or hidden by
+    // the scene. Grab the server so that other X clients see the switch as one change
+    // instead of a stream of individual unmap and map requests.
+    std::optional<XServerGrabber> grabber;
+    if (kwinApp()->x11Connection() && !m_x11Clients.isEmpty()) {
+        grabber.emplace();
+    }
+
     for (auto it = stacking_order.constBegin();
             it != stacking_order.constEnd();
             ++it) {
@@ -1041,6 +1092,8 @@ void Workspace::updateClientVisibilityOnDesktopChange(VirtualDesktop *newDesktop
         if (c->isOnDesktop(newDesktop) && c->isOnCurrentActivity())
             c->updateVisibility();
     }
+    grabber.reset();
+
     if (showingDesktop())   // Do this only after desktop change to avoid flicker
         setShowingDesktop(false);
 }
@@ -1789,34 +1842,41 @@ Unmanaged *Workspace::findUnmanaged(std::function<bool (const Unmanaged*)> func)
 
 Unmanaged *Workspace::findUnmanaged(xcb_window_t w) const
 {
-    return findUnmanaged([w](const Unmanaged *u) {
-        return u->window() == w;
-    });
+    return m_unmanagedByWindow.value(w);
 }
 
 X11Client *Workspace::findClient(Predicate predicate, xcb_window_t w) const
 {
     switch (predicate) {
     case Predicate::WindowMatch:
-        return findClient([w](const X11Client *c) {
-            return c->window() == w;
-        });
+        return m_x11ClientsByWindow.value(w);
     case Predicate::WrapperIdMatch:
-        return findClient([w](const X11Client *c) {
-            return c->wrapperId() == w;
-        });
+        return m_x11ClientsByWrapper.value(w);
     case Predicate::FrameIdMatch:
-        return findClient([w](const X11Client *c) {
-            return c->frameId() == w;
-        });
+        return m_x11ClientsByFrame.value(w);
     case Predicate::InputIdMatch:
-        return findClient([w](const X11Client *c) {
-            return c->inputId() == w;
-        });
+        if (w == XCB_WINDOW_NONE) {
+            return nullptr;
+        }
+        return m_x11ClientsByInput.value(w);
     }
     return nullptr;
 }
 
+void Workspace::updateInputIdIndex(X11Client *c, xcb_window_t oldInputId)
+{
+    if (m_x11ClientsByWindow.value(c->window()) != c) {
+        // Not managed yet, addClient() will pick up the current input window
+        return;
+    }
+    if (oldInputId != XCB_WINDOW_NONE && m_x11ClientsByInput.value(oldInputId) == c) {
+        m_x11ClientsByInput.remove(oldInputId);
+    }
+    if (c->inputId() != XCB_WINDOW_NONE) {
+        m_x11ClientsByInput.insert(c->inputId(), c);
+    }
+}
+
 Toplevel *Workspace::findToplevel(std::function<bool (const Toplevel*)> func) const
 {
     if (auto *ret = Toplevel::findInList(m_allClients, func)) {
@@ -1833,9 +1893,7 @@ Toplevel *Workspace::findToplevel(std::function<bool (const Toplevel*)> func) co
 
 Toplevel *Workspace::findToplevel(const QUuid &internalId) const
 {
-    return findToplevel([internalId] (const KWin::Toplevel* l) -> bool {
-        return internalId == l->internalId();
-    });
+    return m_toplevelsByInternalId.value(internalId);
 }
 
 void Workspace::forEachToplevel(std::function<void (Toplevel *)> func)
@@ -1878,6 +1936,9 @@ Toplevel *Workspace::findInternal(QWindow *w) const
 void Workspace::markXStackingOrderAsDirty()
 {
     m_xStackingDirty = true;
+    if (m_rootStackingValid || m_xStackingQueryTree) {
+        return;
+    }
     if (kwinApp()->x11Connection() && !kwinApp()->isClosingX11Connection()) {
         m_xStackingQueryTree.reset(new Xcb::Tree(kwinApp()->x11RootWindow()));
     }
@@ -1910,6 +1971,7 @@ void Workspace::updateTabbox()
 void Workspace::addInternalClient(InternalClient *client)
 {
     m_internalClients.append(client);
+    m_toplevelsByInternalId.insert(client->internalId(), client);
     addToStack(client);
 
     setupClientConnections(client);
@@ -1930,6 +1992,7 @@ void Workspace::addInternalClient(InternalClient *client)
 void Workspace::removeInternalClient(InternalClient *client)
 {
     m_internalClients.removeOne(client);
+    m_toplevelsByInternalId.remove(client->internalId());
 
     markXStackingOrderAsDirty();
     updateStackingOrder(true);
@@ -2050,6 +2113,14 @@ void Workspace::checkTransients(xcb_window_t w)
  */
 void Workspace::desktopResized()
 {
+    // An output configuration changes the outputs one by one, lay out the windows only once
+    // for the final arrangement.
+    if (kwinApp()->platform()->isApplyingOutputConfiguration()) {
+        m_desktopResizePending = true;
+        return;
+    }
+    m_desktopResizePending = false;
+
     const auto outputs = kwinApp()->platform()->enabledOutputs();
 
     const QRect oldGeometry = m_geometry;
@@ -2239,6 +2310,8 @@ void Workspace::updateClientArea()
     }
 
     if (m_workAreas != workAreas || m_restrictedAreas != restrictedAreas || m_screenAreas != screenAreas) {
+        const QHash<const VirtualDesktop *, QHash<const AbstractOutput *, QRect>> oldScreenAreas = m_screenAreas;
+        const QHash<const VirtualDesktop *, QRect> oldWorkAreas = m_workAreas;
         m_workAreas = workAreas;
         m_screenAreas = screenAreas;
 
@@ -2258,14 +2331,70 @@ void Workspace::updateClientArea()
             }
         }
 
+        // Only the struts that appeared, disappeared or moved can affect windows on their output
+        QHash<const VirtualDesktop *, StrutRects> changedStruts;
+        for (const VirtualDesktop *desktop : desktops) {
+            const StrutRects oldStruts = m_oldRestrictedAreas.value(desktop);
+            const StrutRects newStruts = m_restrictedAreas.value(desktop);
+            if (oldStruts == newStruts) {
+                continue;
+            }
+            StrutRects &changed = changedStruts[desktop];
+            for (const StrutRect &strut : oldStruts) {
+                if (!newStruts.contains(strut)) {
+                    changed.append(strut);
+                }
+            }
+            for (const StrutRect &strut : newStruts) {
+                if (!oldStruts.contains(strut)) {
+                    changed.append(strut);
+                }
+            }
+        }
+
+        // A window needs to be checked if the area of its output changed on one of its
+        // desktops, or if a changed strut is on its output; windows elsewhere keep their
+        // geometry anyway.
+        auto isAffected = [&](AbstractClient *client) {
+            if (client->hasStrut()) {
+                return true;
+            }
+            const AbstractOutput *output = client->output();
+            const QRect outputGeometry = output->geometry();
+            const auto vds = client->isOnAllDesktops() ? desktops : client->desktops();
+            for (const VirtualDesktop *vd : vds) {
+                if (oldScreenAreas.value(vd).value(output) != m_screenAreas.value(vd).value(output)) {
+                    return true;
+                }
+                if (is_multihead && oldWorkAreas.value(vd) != m_workAreas.value(vd)) {
+                    return true;
+                }
+                const StrutRects struts = changedStruts.value(vd);
+                for (const StrutRect &strut : struts) {
+                    if (strut.intersects(outputGeometry)) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        };
+
+        // Present the new geometries of all windows in one frame.
+        GeometryTransaction transaction(this);
         for (auto it = m_allClients.constBegin();
                 it != m_allClients.constEnd();
                 ++it) {
+            if (!isAffected(*it)) {
+                continue;
+            }
+            transaction.add(*it);
             (*it)->checkWorkspacePosition();
         }
 
         m_oldRestrictedAreas.clear(); // reset, no longer valid or needed
         m_inUpdateClientArea = false;
+
+        Q_EMIT clientAreasChanged();
     }
 }
 
@@ -2513,7 +2642,10 @@ QPoint Workspace::adjustClientPosition(AbstractClient* c, QPoint pos, bool unres
         // windows snap
         int snap = options->windowSnapZone() * snapAdjust;
         if (snap) {
-            for (auto l = m_allClients.constBegin(); l != m_allClients.constEnd(); ++l) {
+            // Windows that are farther away than the snap zones can't affect the result.
+            const int margin = std::max({snap, snapX, snapY}) + 1;
+            const QList<AbstractClient *> candidates = snapCandidates(c, QRect(cx, cy, cw, ch).adjusted(-margin, -margin, margin, margin));
+            for (auto l = candidates.constBegin(); l != candidates.constEnd(); ++l) {
                 if ((*l) == c)
                     continue;
                 if ((*l)->isMinimized() || (*l)->isShade())
@@ -2709,7 +2841,10 @@ QRect Workspace::adjustClientSize(AbstractClient* c, QRect moveResizeGeom, Gravi
         if (snap) {
             deltaX = int(snap);
             deltaY = int(snap);
-            for (auto l = m_allClients.constBegin(); l != m_allClients.constEnd(); ++l) {
+            // Windows that are farther away than the snap zones can't affect the result.
+            const int margin = std::max(snap, options->borderSnapZone()) + 1;
+            const QList<AbstractClient *> candidates = snapCandidates(c, moveResizeGeom.adjusted(-margin, -margin, margin, margin));
+            for (auto l = candidates.constBegin(); l != candidates.constEnd(); ++l) {
                 if ((*l)->isOnCurrentDesktop() &&
                         !(*l)->isMinimized()
                         && (*l) != c) {
@@ -2859,6 +2994,68 @@ void Workspace::setMoveResizeClient(AbstractClient *c)
         ++block_focus;
     else
         --block_focus;
+
+    // The snapping index is built when the window snaps for the first time.
+    clearSnapIndex();
+}
+
+void Workspace::buildSnapIndex()
+{
+    clearSnapIndex();
+
+    // Any window can appear or go away during the move, just index everything again.
+    auto invalidate = [this]() {
+        clearSnapIndex();
+    };
+    m_snapConnections << connect(this, &Workspace::clientAdded, this, invalidate);
+    m_snapConnections << connect(this, &Workspace::clientRemoved, this, invalidate);
+
+    m_snapClients = m_allClients;
+    for (int i = 0; i < m_snapClients.count(); ++i) {
+        AbstractClient *client = m_snapClients[i];
+        if (client == movingClient) {
+            continue;
+        }
+        m_snapIndex.insert(i, client->frameGeometry());
+        m_snapConnections << connect(client, &AbstractClient::frameGeometryChanged, this, [this, i, client]() {
+            m_snapIndex.insert(i, client->frameGeometry());
+        });
+    }
+    m_snapIndexValid = true;
+}
+
+void Workspace::clearSnapIndex()
+{
+    for (const QMetaObject::Connection &connection : qAsConst(m_snapConnections)) {
+        disconnect(connection);
+    }
+    m_snapConnections.clear();
+    m_snapClients.clear();
+    m_snapIndex.clear();
+    m_snapIndexValid = false;
+}
+
+/**
+ * Returns the windows that \a client can snap to while it covers \a area, in the
+ * order of m_allClients. Only the window that is being moved or resized interactively
+ * uses the index, all other windows get the complete list.
+ */
+QList<AbstractClient *> Workspace::snapCandidates(AbstractClient *client, const QRect &area)
+{
+    if (client != movingClient) {
+        return m_allClients;
+    }
+    if (!m_snapIndexValid) {
+        buildSnapIndex();
+    }
+
+    QList<AbstractClient *> candidates;
+    const QVector<int> keys = m_snapIndex.query(area);
+    candidates.reserve(keys.count());
+    for (int key : keys) {
+        candidates.append(m_snapClients[key]);
+    }
+    return candidates;
 }
 
 // When kwin crashes, windows will not be gravitated back to their original position
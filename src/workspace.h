@@ -17,8 +17,11 @@
 #include "options.h"
 #include "sm.h"
 #include "utils/common.h"
+#include "utils/snapindex.h"
 // Qt
+#include <QHash>
 #include <QTimer>
+#include <QUuid>
 #include <QVector>
 // std
 #include <functional>
@@ -113,6 +116,11 @@ public:
      * @see findClient(std::function<bool (const X11Client *)>)
      */
     X11Client *findClient(Predicate predicate, xcb_window_t w) const;
+    /**
+     * Tells the workspace that the input window of @p c changed from @p oldInputId,
+     * so that findClient(Predicate::InputIdMatch) keeps finding it.
+     */
+    void updateInputIdIndex(X11Client *c, xcb_window_t oldInputId);
     void forEachClient(std::function<void (X11Client *)> func);
     void forEachAbstractClient(std::function<void (AbstractClient*)> func);
     Unmanaged *findUnmanaged(std::function<bool (const Unmanaged*)> func) const;
@@ -340,6 +348,11 @@ public:
     void removeUnmanaged(Unmanaged*);   // Only called from Unmanaged::release()
     void removeDeleted(Deleted*);
     void addDeleted(Deleted*, Toplevel*);
+    /**
+     * Removes the closed @a window from the stacking order if no Deleted replaces it,
+     * i.e. if the window has been closed before it was ever shown.
+     */
+    void removeClosedWindow(Toplevel *window);
 
     bool checkStartupNotification(xcb_window_t w, KStartupInfoId& id, KStartupInfoData& data);
 
@@ -503,6 +516,11 @@ Q_SIGNALS:
      */
     void workspaceInitialized();
     void geometryChanged();
+    /**
+     * This signal is emitted when the work areas, the restricted move areas or the
+     * screen areas have changed.
+     */
+    void clientAreasChanged();
 
     //Signals required for the scripting interface
     void desktopPresenceChanged(KWin::AbstractClient*, int);
@@ -549,6 +567,9 @@ private:
     bool switchWindow(AbstractClient *c, Direction direction, QPoint curPos, VirtualDesktop *desktop);
 
     void propagateClients(bool propagate_new_clients);   // Called only from updateStackingOrder
+    void restackClientWindows(const QVector<xcb_window_t> &windowStack, int clientsBegin);
+    void scheduleRootClientListsUpdate(bool clientList);
+    void updateRootClientLists();
     QList<Toplevel *> constrainedStackingOrder();
     void raiseClientWithinApplication(AbstractClient* c);
     void lowerClientWithinApplication(AbstractClient* c);
@@ -598,10 +619,19 @@ private:
     int m_initialDesktop;
     void loadSessionInfo(const QString &sessionName);
     void addSessionInfo(KConfigGroup &cg);
+    void beginSessionRestoreBatch();
+    void endSessionRestoreBatch();
 
     QList<SessionInfo*> session;
+    // While windows from the session are being restored, stacking updates are held back
+    // and done once after the windows stop coming in, or after a timeout
+    QTimer *m_sessionRestoreSettleTimer = nullptr;
+    QTimer *m_sessionRestoreTimeoutTimer = nullptr;
+    bool m_sessionRestoreBatch = false;
 
     void updateXStackingOrder();
+    void fetchRootStacking();
+    void updateRootStacking(xcb_generic_event_t *event);
     void updateTabbox();
 
     AbstractOutput *m_activeOutput = nullptr;
@@ -609,6 +639,15 @@ private:
     AbstractClient* last_active_client;
     AbstractClient* movingClient;
 
+    // The windows that the moved or resized window can snap to, indexed on first use
+    QList<AbstractClient *> snapCandidates(AbstractClient *client, const QRect &area);
+    void buildSnapIndex();
+    void clearSnapIndex();
+    SnapIndex m_snapIndex;
+    QList<AbstractClient *> m_snapClients;
+    QVector<QMetaObject::Connection> m_snapConnections;
+    bool m_snapIndexValid = false;
+
     // Delay(ed) window focus timer and client
     QTimer* delayFocusTimer;
     AbstractClient* delayfocus_client;
@@ -619,13 +658,28 @@ private:
     QList<Unmanaged *> m_unmanaged;
     QList<Deleted *> deleted;
     QList<InternalClient *> m_internalClients;
+    // Lookup tables for the lists above, kept in sync by the add/remove functions
+    QHash<xcb_window_t, X11Client *> m_x11ClientsByWindow;
+    QHash<xcb_window_t, X11Client *> m_x11ClientsByFrame;
+    QHash<xcb_window_t, X11Client *> m_x11ClientsByWrapper;
+    QHash<xcb_window_t, X11Client *> m_x11ClientsByInput;
+    QHash<xcb_window_t, Unmanaged *> m_unmanagedByWindow;
+    QHash<QUuid, Toplevel *> m_toplevelsByInternalId;
 
     QList<Toplevel *> unconstrained_stacking_order; // Topmost last
     QList<Toplevel *> stacking_order; // Topmost last
     QVector<xcb_window_t> manual_overlays; //Topmost last
     bool force_restacking;
+    // The client part of the window stack last sent to the X server, topmost first
+    QVector<xcb_window_t> m_propagatedClientStack;
+    bool m_rootClientListsUpdateScheduled = false;
+    bool m_rootClientListDirty = false;
     QList<Toplevel *> x_stacking; // From XQueryTree()
     std::unique_ptr<Xcb::Tree> m_xStackingQueryTree;
+    // Children of the root window, bottommost first, queried once and then kept
+    // up to date from the SubstructureNotify events on the root window
+    QVector<xcb_window_t> m_rootStacking;
+    bool m_rootStackingValid = false;
     bool m_xStackingDirty = false;
     QList<AbstractClient*> should_get_focus; // Last is most recent
     QList<AbstractClient*> attention_chain;
@@ -675,6 +729,7 @@ private:
     QSize olddisplaysize; // previous sizes od displayWidth()/displayHeight()
     QHash<const VirtualDesktop *, StrutRects> m_oldRestrictedAreas;
     bool m_inUpdateClientArea = false;
+    bool m_desktopResizePending = false;
 
     int set_active_client_recursion;
     int block_stacking_updates; // When > 0, stacking updates are temporarily disabled
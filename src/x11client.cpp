@@ -46,6 +46,7 @@
 #include <QFileInfo>
 #include <QMouseEvent>
 #include <QProcess>
+#include <QScopeGuard>
 // xcb
 #include <xcb/xcb_icccm.h>
 // system
@@ -311,7 +312,7 @@ void X11Client::releaseWindow(bool on_shutdown)
     m_wrapper.reset();
     m_frame.reset();
     unblockGeometryUpdates(); // Don't use GeometryUpdatesBlocker, it would now set the geometry
-    if (!on_shutdown) {
+    if (del) {
         disownDataPassedToDeleted();
         del->unrefWindow();
     }
@@ -348,8 +349,10 @@ void X11Client::destroyClient()
     m_wrapper.reset();
     m_frame.reset();
     unblockGeometryUpdates(); // Don't use GeometryUpdatesBlocker, it would now set the geometry
-    disownDataPassedToDeleted();
-    del->unrefWindow();
+    if (del) {
+        disownDataPassedToDeleted();
+        del->unrefWindow();
+    }
     deleteClient(this);
 }
 
@@ -406,7 +409,8 @@ bool X11Client::manage(xcb_window_t w, bool isMapped)
         NET::WM2OpaqueRegion |
         NET::WM2DesktopFileName |
         NET::WM2GTKFrameExtents |
-        NET::WM2GTKApplicationId;
+        NET::WM2GTKApplicationId |
+        NET::WM2ClientMachine;
 
     auto wmClientLeaderCookie = fetchWmClientLeader();
     auto skipCloseAnimationCookie = fetchSkipCloseAnimation();
@@ -417,6 +421,7 @@ bool X11Client::manage(xcb_window_t w, bool isMapped)
     auto activitiesCookie = fetchActivities();
     auto applicationMenuServiceNameCookie = fetchApplicationMenuServiceName();
     auto applicationMenuObjectPathCookie = fetchApplicationMenuObjectPath();
+    auto syncCounterCookie = fetchSyncCounter();
 
     m_geometryHints.init(window());
     m_motif.init(window());
@@ -435,7 +440,7 @@ bool X11Client::manage(xcb_window_t w, bool isMapped)
     getResourceClass();
     readWmClientLeader(wmClientLeaderCookie);
     getWmClientMachine();
-    getSyncCounter();
+    readSyncCounter(syncCounterCookie);
     // First only read the caption text, so that setupWindowRules() can use it for matching,
     // and only then really set the caption using setCaption(), which checks for duplicates etc.
     // and also relies on rules already existing
@@ -1047,6 +1052,13 @@ void X11Client::updateInputWindow()
         return;
     }
 
+    const xcb_window_t oldInputId = inputId();
+    auto updateIndex = qScopeGuard([this, oldInputId]() {
+        if (inputId() != oldInputId) {
+            workspace()->updateInputIdIndex(this, oldInputId);
+        }
+    });
+
     QRegion region;
 
     if (decoration()) {
@@ -1154,7 +1166,11 @@ void X11Client::destroyDecoration()
             Q_EMIT geometryShapeChanged(this, oldgeom);
         }
     }
+    const xcb_window_t oldInputId = inputId();
     m_decoInputExtent.reset();
+    if (oldInputId != XCB_WINDOW_NONE) {
+        workspace()->updateInputIdIndex(this, oldInputId);
+    }
 }
 
 void X11Client::maybeCreateX11DecorationRenderer()
@@ -1952,6 +1968,11 @@ QStringList X11Client::activities() const
     return AbstractClient::activities();
 }
 
+bool X11Client::isOnActivity(const QString &activity) const
+{
+    return sessionActivityOverride || AbstractClient::isOnActivity(activity);
+}
+
 /**
  * Performs the actual focusing of the window using XSetInputFocus and WM_TAKE_FOCUS
  */
@@ -2238,14 +2259,24 @@ bool X11Client::wantsSyncCounter() const
     return true;
 }
 
+Xcb::Property X11Client::fetchSyncCounter() const
+{
+    return Xcb::Property(false, window(), atoms->net_wm_sync_request_counter, XCB_ATOM_CARDINAL, 0, 1);
+}
+
 void X11Client::getSyncCounter()
+{
+    Xcb::Property syncProp = fetchSyncCounter();
+    readSyncCounter(syncProp);
+}
+
+void X11Client::readSyncCounter(Xcb::Property &syncProp)
 {
     if (!Xcb::Extensions::self()->isSyncAvailable())
         return;
     if (!wantsSyncCounter())
         return;
 
-    Xcb::Property syncProp(false, window(), atoms->net_wm_sync_request_counter, XCB_ATOM_CARDINAL, 0, 1);
     const xcb_sync_counter_t counter = syncProp.value<xcb_sync_counter_t>(XCB_NONE);
     if (counter != XCB_NONE) {
         m_syncRequest.counter = counter;
@@ -2788,6 +2819,7 @@ void X11Client::handleSync()
         }
         performInteractiveResize();
         updateWindowPixmap();
+        handleDeferredInteractiveMoveResize();
     }
 }
 
@@ -4611,6 +4643,7 @@ void X11Client::handleSyncTimeout()
         m_syncRequest.interactiveResize = false; // (leads to sync request races in some clients)
     }
     performInteractiveResize();
+    handleDeferredInteractiveMoveResize();
 }
 
 NETExtendedStrut X11Client::strut() const
@@ -4705,7 +4738,7 @@ bool X11Client::supportsWindowRules() const
     return true;
 }
 
-void X11Client::damageNotifyEvent()
+void X11Client::damageNotifyEvent(xcb_damage_notify_event_t *event)
 {
     Q_ASSERT(kwinApp()->operationMode() == Application::OperationModeX11);
 
@@ -4718,7 +4751,7 @@ void X11Client::damageNotifyEvent()
 
     SurfaceItemX11 *item = static_cast<SurfaceItemX11 *>(surfaceItem());
     if (item) {
-        item->processDamage();
+        item->processDamage(event);
     }
 }
 
@@ -21,6 +21,7 @@
 #include <QPixmap>
 #include <QWindow>
 // X
+#include <xcb/damage.h>
 #include <xcb/sync.h>
 
 // TODO: Cleanup the order of things in this .h file
@@ -142,6 +143,7 @@ public:
     void destroyClient() override;
 
     QStringList activities() const override;
+    bool isOnActivity(const QString &activity) const override;
     void doSetOnActivities(const QStringList &newActivitiesList) override;
     void updateActivities(bool includeTransients) override;
 
@@ -318,7 +320,7 @@ private:
     void leaveNotifyEvent(xcb_leave_notify_event_t *e);
     void focusInEvent(xcb_focus_in_event_t *e);
     void focusOutEvent(xcb_focus_out_event_t *e);
-    void damageNotifyEvent();
+    void damageNotifyEvent(xcb_damage_notify_event_t *event);
 
     bool buttonPressEvent(xcb_window_t w, int button, int state, int x, int y, int x_root, int y_root, xcb_timestamp_t time = XCB_CURRENT_TIME);
     bool buttonReleaseEvent(xcb_window_t w, int button, int state, int x, int y, int x_root, int y_root);
@@ -394,6 +396,8 @@ private:
     void configureRequest(int value_mask, int rx, int ry, int rw, int rh, int gravity, bool from_tool);
     NETExtendedStrut strut() const;
     int checkShadeGeometry(int w, int h);
+    Xcb::Property fetchSyncCounter() const;
+    void readSyncCounter(Xcb::Property &syncProp);
     void getSyncCounter();
     void sendSyncRequest();
     void leaveInteractiveMoveResize() override;
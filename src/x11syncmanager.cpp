@@ -16,6 +16,10 @@
 
 #include "kwinglplatform.h"
 
+#include <QElapsedTimer>
+
+#include <xcb/xcbext.h>
+
 namespace KWin
 {
 
@@ -137,6 +141,24 @@ void X11SyncObject::finishResetting()
     m_state = Ready;
 }
 
+/**
+ * Finishes resetting the fence if the server has already replied, without blocking.
+ * Returns @c true if the fence is ready to be triggered again.
+ */
+bool X11SyncObject::tryFinishResetting()
+{
+    Q_ASSERT(m_state == Resetting);
+    void *reply = nullptr;
+    xcb_generic_error_t *error = nullptr;
+    if (!xcb_poll_for_reply(kwinApp()->x11Connection(), m_reset_cookie.sequence, &reply, &error)) {
+        return false;
+    }
+    free(reply);
+    free(error);
+    m_state = Ready;
+    return true;
+}
+
 X11SyncManager *X11SyncManager::create()
 {
     if (kwinApp()->operationMode() != Application::OperationModeX11) {
@@ -150,9 +172,9 @@ X11SyncManager *X11SyncManager::create()
     GLPlatform *glPlatform = GLPlatform::instance();
     const bool haveSyncObjects = glPlatform->isGLES()
         ? hasGLVersion(3, 0)
-        : hasGLVersion(3, 2) || hasGLExtension("GL_ARB_sync");
+        : hasGLVersion(3, 2) || hasGLExtension(GLExtension::ARB_sync);
 
-    if (hasGLExtension("GL_EXT_x11_sync_object") && haveSyncObjects) {
+    if (hasGLExtension(GLExtension::EXT_x11_sync_object) && haveSyncObjects) {
         const QString useExplicitSync = qEnvironmentVariable("KWIN_EXPLICIT_SYNC");
 
         if (useExplicitSync != QLatin1String("0")) {
@@ -174,6 +196,7 @@ X11SyncManager::X11SyncManager()
 
 X11SyncManager::~X11SyncManager()
 {
+    reportWaitTimes();
     Compositor::self()->scene()->makeOpenGLContextCurrent();
     qDeleteAll(m_fences);
 }
@@ -193,12 +216,18 @@ bool X11SyncManager::endFrame()
             break;
 
         case X11SyncObject::TriggerSent:
-        case X11SyncObject::Waiting:
-            if (!fence->finish()) {
+        case X11SyncObject::Waiting: {
+            QElapsedTimer timer;
+            timer.start();
+            const bool finished = fence->finish();
+            m_finishWaitTime += timer.nsecsElapsed();
+            ++m_finishWaitCount;
+            if (!finished) {
                 return false;
             }
             fence->reset();
             break;
+        }
 
         // Should not happen in practice since we always reset the fence after finishing it
         case X11SyncObject::Done:
@@ -206,12 +235,18 @@ bool X11SyncManager::endFrame()
             break;
 
         case X11SyncObject::Resetting:
-            fence->finishResetting();
+            // The reply is usually there by now, if not it is collected in the next frame
+            // or, at the latest, when the fence is triggered again
+            fence->tryFinishResetting();
             break;
         }
     }
 
     m_currentFence = nullptr;
+
+    if (++m_frameCount % 1000 == 0) {
+        reportWaitTimes();
+    }
     return true;
 }
 
@@ -219,9 +254,22 @@ void X11SyncManager::triggerFence()
 {
     m_currentFence = m_fences[m_next];
     m_next = (m_next + 1) % m_fences.count();
+    if (m_currentFence->state() == X11SyncObject::Resetting) {
+        QElapsedTimer timer;
+        timer.start();
+        m_currentFence->finishResetting();
+        m_resetWaitTime += timer.nsecsElapsed();
+        ++m_resetWaitCount;
+    }
     m_currentFence->trigger();
 }
 
+void X11SyncManager::reportWaitTimes()
+{
+    qCDebug(KWIN_CORE, "X fences over %d frames: %d blocking resets (%lld us), %d finishes (%lld us)",
+            m_frameCount, m_resetWaitCount, m_resetWaitTime / 1000, m_finishWaitCount, m_finishWaitTime / 1000);
+}
+
 void X11SyncManager::insertWait()
 {
     if (m_currentFence && m_currentFence->state() != X11SyncObject::Waiting) {
@@ -33,6 +33,7 @@ public:
     bool finish();
     void reset();
     void finishResetting();
+    bool tryFinishResetting();
 
 private:
     State m_state;
@@ -48,7 +49,7 @@ private:
 class X11SyncManager
 {
 public:
-    enum { MaxFences = 4 };
+    enum { MaxFences = 6 };
 
     static X11SyncManager *create();
     ~X11SyncManager();
@@ -60,10 +61,18 @@ public:
 
 private:
     X11SyncManager();
+    void reportWaitTimes();
 
     X11SyncObject *m_currentFence = nullptr;
     QVector<X11SyncObject *> m_fences;
     int m_next = 0;
+
+    // Time spent blocked on the fences, for debugging
+    qint64 m_resetWaitTime = 0;
+    qint64 m_finishWaitTime = 0;
+    int m_resetWaitCount = 0;
+    int m_finishWaitCount = 0;
+    int m_frameCount = 0;
 };
 
 } // namespace KWin
@@ -7,7 +7,7 @@
 #include "xcursortheme.h"
 #include "3rdparty/xcursor.h"
 
-#include <QMap>
+#include <QHash>
 #include <QSharedData>
 
 namespace KWin
@@ -24,7 +24,13 @@ public:
 class KXcursorThemePrivate : public QSharedData
 {
 public:
-    QMap<QByteArray, QVector<KXcursorSprite>> registry;
+    QVector<KXcursorSprite> loadShape(const QByteArray &name) const;
+
+    QByteArray themeName;
+    int size = 0;
+    qreal devicePixelRatio = 1;
+    // Shapes are loaded on demand, missing shapes are cached as empty sprite lists.
+    mutable QHash<QByteArray, QVector<KXcursorSprite>> registry;
 };
 
 KXcursorSprite::KXcursorSprite()
@@ -71,20 +77,27 @@ std::chrono::milliseconds KXcursorSprite::delay() const
     return d->delay;
 }
 
-struct XcursorThemeClosure
+QVector<KXcursorSprite> KXcursorThemePrivate::loadShape(const QByteArray &name) const
 {
-    QMap<QByteArray, QVector<KXcursorSprite>> registry;
-    int desiredSize;
-};
+    // The shape name is used as file name, don't let it escape from the theme directory.
+    if (name.isEmpty() || name.contains('/')) {
+        return QVector<KXcursorSprite>();
+    }
+
+    // Xcursors don't support HiDPI natively so we fake it by scaling the desired cursor
+    // size. The device pixel ratio acts only as a hint. The real scale factor of every
+    // cursor sprite is computed below.
+    XcursorImages *images = xcursor_load_images(themeName.constData(), name.constData(), size * devicePixelRatio);
+    if (!images) {
+        return QVector<KXcursorSprite>();
+    }
 
-static void load_callback(XcursorImages *images, void *data)
-{
-    XcursorThemeClosure *closure = static_cast<XcursorThemeClosure *>(data);
     QVector<KXcursorSprite> sprites;
+    sprites.reserve(images->nimage);
 
     for (int i = 0; i < images->nimage; ++i) {
         const XcursorImage *nativeCursorImage = images->images[i];
-        const qreal scale = std::max(qreal(1), qreal(nativeCursorImage->size) / closure->desiredSize);
+        const qreal scale = std::max(qreal(1), qreal(nativeCursorImage->size) / size);
         const QPoint hotspot(nativeCursorImage->xhot, nativeCursorImage->yhot);
         const std::chrono::milliseconds delay(nativeCursorImage->delay);
 
@@ -95,10 +108,8 @@ static void load_callback(XcursorImages *images, void *data)
         sprites.append(KXcursorSprite(data, hotspot / scale, delay));
     }
 
-    if (!sprites.isEmpty()) {
-        closure->registry.insert(images->name, sprites);
-    }
     XcursorImagesDestroy(images);
+    return sprites;
 }
 
 KXcursorTheme::KXcursorTheme()
@@ -106,10 +117,12 @@ KXcursorTheme::KXcursorTheme()
 {
 }
 
-KXcursorTheme::KXcursorTheme(const QMap<QByteArray, QVector<KXcursorSprite>> &registry)
+KXcursorTheme::KXcursorTheme(const QString &themeName, int size, qreal dpr)
     : KXcursorTheme()
 {
-    d->registry = registry;
+    d->themeName = themeName.toUtf8();
+    d->size = size;
+    d->devicePixelRatio = dpr;
 }
 
 KXcursorTheme::KXcursorTheme(const KXcursorTheme &other)
@@ -129,28 +142,37 @@ KXcursorTheme &KXcursorTheme::operator=(const KXcursorTheme &other)
 
 bool KXcursorTheme::isEmpty() const
 {
-    return d->registry.isEmpty();
+    return d->themeName.isEmpty();
 }
 
 QVector<KXcursorSprite> KXcursorTheme::shape(const QByteArray &name) const
 {
-    return d->registry.value(name);
+    if (isEmpty()) {
+        return QVector<KXcursorSprite>();
+    }
+    auto it = d->registry.constFind(name);
+    if (it == d->registry.constEnd()) {
+        it = d->registry.insert(name, d->loadShape(name));
+    }
+    return it.value();
 }
 
 KXcursorTheme KXcursorTheme::fromTheme(const QString &themeName, int size, qreal dpr)
 {
-    // Xcursors don't support HiDPI natively so we fake it by scaling the desired cursor
-    // size. The device pixel ratio argument acts only as a hint. The real scale factor
-    // of every cursor sprite will be computed in the loading closure.
-    XcursorThemeClosure closure;
-    closure.desiredSize = size;
-    xcursor_load_theme(themeName.toUtf8().constData(), size * dpr, load_callback, &closure);
+    if (themeName.isEmpty()) {
+        return KXcursorTheme();
+    }
 
-    if (closure.registry.isEmpty()) {
+    // The cursors are loaded lazily, but whether the theme exists has to be known
+    // upfront so the caller can fall back to another theme. A theme without the
+    // default arrow cursor is not usable anyway.
+    KXcursorTheme theme(themeName, size, dpr);
+    if (theme.shape(QByteArrayLiteral("left_ptr")).isEmpty()
+            && theme.shape(QByteArrayLiteral("default")).isEmpty()) {
         return KXcursorTheme();
     }
 
-    return KXcursorTheme(closure.registry);
+    return theme;
 }
 
 } // namespace KWin
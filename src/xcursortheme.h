@@ -113,11 +113,13 @@ public:
      * Loads the Xcursor theme with the given @ themeName and the desired @a size.
      * The @a dpr specifies the desired scale factor. If no theme with the provided
      * name exists, an empty KXcursorTheme is returned.
+     *
+     * Cursor shapes are loaded from disk the first time they are requested with shape().
      */
     static KXcursorTheme fromTheme(const QString &themeName, int size, qreal dpr);
 
 private:
-    KXcursorTheme(const QMap<QByteArray, QVector<KXcursorSprite>> &registry);
+    KXcursorTheme(const QString &themeName, int size, qreal dpr);
     QSharedDataPointer<KXcursorThemePrivate> d;
 };
 
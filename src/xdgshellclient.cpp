@@ -17,6 +17,7 @@
 #include "deleted.h"
 #include "platform.h"
 #include "screenedge.h"
+#include "surfaceitem_wayland.h"
 #include "touch_input.h"
 #include "utils/subsurfacemonitor.h"
 #include "virtualdesktops.h"
@@ -127,6 +128,38 @@ void XdgSurfaceClient::scheduleConfigure()
     }
 }
 
+bool XdgSurfaceClient::isConfigurePending() const
+{
+    return m_configureTimer->isActive() || !m_configureEvents.isEmpty();
+}
+
+void XdgSurfaceClient::holdPresentation()
+{
+    if (m_presentationHeld) {
+        return;
+    }
+    m_presentationHeld = true;
+    if (auto item = qobject_cast<SurfaceItemWayland *>(surfaceItem())) {
+        item->freeze();
+    }
+}
+
+void XdgSurfaceClient::releasePresentation()
+{
+    if (!m_presentationHeld) {
+        return;
+    }
+    m_presentationHeld = false;
+    if (m_heldFrameGeometry.isValid()) {
+        const QRect frameGeometry = m_heldFrameGeometry;
+        m_heldFrameGeometry = QRect();
+        updateGeometry(frameGeometry);
+    }
+    if (auto item = qobject_cast<SurfaceItemWayland *>(surfaceItem())) {
+        item->thaw();
+    }
+}
+
 void XdgSurfaceClient::sendConfigure()
 {
     XdgSurfaceConfigure *configureEvent = sendRoleConfigure();
@@ -155,6 +188,7 @@ void XdgSurfaceClient::handleCommit()
         return;
     }
 
+    const bool wasConfigurePending = !m_configureEvents.isEmpty();
     if (m_lastAcknowledgedConfigureSerial.has_value()) {
         const quint32 serial = m_lastAcknowledgedConfigureSerial.value();
         while (!m_configureEvents.isEmpty()) {
@@ -177,6 +211,10 @@ void XdgSurfaceClient::handleCommit()
 
     setReadyForPainting();
     updateDepth();
+
+    if (wasConfigurePending && !isConfigurePending()) {
+        Q_EMIT configuresApplied();
+    }
 }
 
 void XdgSurfaceClient::handleRolePrecommit()
@@ -271,7 +309,12 @@ void XdgSurfaceClient::handleNextWindowGeometry()
         maybeUpdateMoveResizeGeometry(frameGeometry);
     }
 
-    updateGeometry(frameGeometry);
+    if (m_presentationHeld) {
+        // the window still shows its old contents, so it has to keep the old geometry, too
+        m_heldFrameGeometry = frameGeometry;
+    } else {
+        updateGeometry(frameGeometry);
+    }
 }
 
 bool XdgSurfaceClient::haveNextWindowGeometry() const
@@ -310,6 +353,9 @@ void XdgSurfaceClient::moveResizeInternal(const QRect &rect, MoveResizeMode mode
             configureEvent->flags.setFlag(XdgSurfaceConfigure::ConfigurePosition, false);
         }
         m_configureFlags.setFlag(XdgSurfaceConfigure::ConfigurePosition, false);
+        if (m_heldFrameGeometry.isValid()) {
+            m_heldFrameGeometry.moveTopLeft(rect.topLeft());
+        }
         updateGeometry(QRect(rect.topLeft(), size()));
     }
 }
@@ -337,7 +383,9 @@ void XdgSurfaceClient::destroyClient()
     setDecoration(nullptr);
     cleanGrouping();
     waylandServer()->removeClient(this);
-    deleted->unrefWindow();
+    if (deleted) {
+        deleted->unrefWindow();
+    }
     delete this;
 }
 
@@ -65,6 +65,27 @@ public:
 
     void installPlasmaShellSurface(KWaylandServer::PlasmaShellSurfaceInterface *shellSurface);
 
+    /**
+     * Returns @c true if a configure event has been scheduled or sent to the client, but
+     * the client hasn't committed a buffer that acknowledges it yet.
+     */
+    bool isConfigurePending() const;
+
+    /**
+     * Keeps presenting the current geometry and contents of the window, the geometry and
+     * the buffers the client commits in the meantime are held back until releasePresentation()
+     * is called. This allows presenting the changes of several windows in the same frame.
+     */
+    void holdPresentation();
+    void releasePresentation();
+
+Q_SIGNALS:
+    /**
+     * This signal is emitted when the client has committed a buffer that acknowledges
+     * the last sent configure event and no other configure event is scheduled.
+     */
+    void configuresApplied();
+
 protected:
     void moveResizeInternal(const QRect &rect, MoveResizeMode mode) override;
 
@@ -101,6 +122,8 @@ private:
     std::optional<quint32> m_lastAcknowledgedConfigureSerial;
     QRect m_windowGeometry;
     bool m_haveNextWindowGeometry = false;
+    bool m_presentationHeld = false;
+    QRect m_heldFrameGeometry;
 };
 
 class XdgToplevelConfigure final : public XdgSurfaceConfigure
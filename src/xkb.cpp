@@ -111,6 +111,9 @@ Xkb::~Xkb()
     xkb_compose_table_unref(m_compose.table);
     xkb_state_unref(m_state);
     xkb_keymap_unref(m_keymap);
+    for (const CachedKeymap &cached : qAsConst(m_keymapCache)) {
+        xkb_keymap_unref(cached.keymap);
+    }
     xkb_context_unref(m_context);
 }
 
@@ -136,7 +139,10 @@ void Xkb::reconfigure()
         qCDebug(KWIN_XKB) << "Could not create xkb keymap from configuration";
         keymap = loadDefaultKeymap();
     }
-    if (keymap) {
+    if (keymap == m_keymap) {
+        // the configuration still results in the installed keymap, there is nothing to update
+        xkb_keymap_unref(keymap);
+    } else if (keymap) {
         updateKeymap(keymap);
     } else {
         qCDebug(KWIN_XKB) << "Could not create default xkb keymap";
@@ -200,7 +206,7 @@ xkb_keymap *Xkb::loadKeymapFromConfig()
 
     m_layoutList = QString::fromLatin1(ruleNames.layout).split(QLatin1Char(','));
 
-    return xkb_keymap_new_from_names(m_context, &ruleNames, XKB_KEYMAP_COMPILE_NO_FLAGS);
+    return compileKeymap(ruleNames);
 }
 
 xkb_keymap *Xkb::loadDefaultKeymap()
@@ -208,7 +214,41 @@ xkb_keymap *Xkb::loadDefaultKeymap()
     xkb_rule_names ruleNames = {};
     applyEnvironmentRules(ruleNames);
     m_layoutList = QString::fromLatin1(ruleNames.layout).split(QLatin1Char(','));
-    return xkb_keymap_new_from_names(m_context, &ruleNames, XKB_KEYMAP_COMPILE_NO_FLAGS);
+    return compileKeymap(ruleNames);
+}
+
+xkb_keymap *Xkb::compileKeymap(const xkb_rule_names &ruleNames)
+{
+    static const int maxCachedKeymaps = 4;
+
+    const QByteArray key = QByteArray(ruleNames.rules) + '\n' + QByteArray(ruleNames.model) + '\n'
+        + QByteArray(ruleNames.layout) + '\n' + QByteArray(ruleNames.variant) + '\n'
+        + (ruleNames.options ? QByteArray(ruleNames.options) : QByteArrayLiteral("\x01"));
+    for (int i = 0; i < m_keymapCache.count(); ++i) {
+        if (m_keymapCache[i].ruleNames == key) {
+            m_keymapCache.move(i, 0);
+            return xkb_keymap_ref(m_keymapCache.first().keymap);
+        }
+    }
+
+    xkb_keymap *keymap = xkb_keymap_new_from_names(m_context, &ruleNames, XKB_KEYMAP_COMPILE_NO_FLAGS);
+    if (!keymap) {
+        return nullptr;
+    }
+    m_keymapCache.prepend(CachedKeymap{key, xkb_keymap_ref(keymap), serializeKeymap(keymap)});
+    while (m_keymapCache.count() > maxCachedKeymaps) {
+        xkb_keymap_unref(m_keymapCache.takeLast().keymap);
+    }
+    return keymap;
+}
+
+QByteArray Xkb::serializeKeymap(xkb_keymap *keymap) const
+{
+    ScopedCPointer<char> keymapString(xkb_keymap_get_as_string(keymap, XKB_KEYMAP_FORMAT_TEXT_V1));
+    if (keymapString.isNull()) {
+        return {};
+    }
+    return keymapString.data();
 }
 
 void Xkb::installKeymap(int fd, uint32_t size)
@@ -255,6 +295,17 @@ void Xkb::updateKeymap(xkb_keymap *keymap)
     m_keymap = keymap;
     m_state = state;
 
+    m_keymapContents.clear();
+    for (const CachedKeymap &cached : qAsConst(m_keymapCache)) {
+        if (cached.keymap == m_keymap) {
+            m_keymapContents = cached.contents;
+            break;
+        }
+    }
+    if (m_keymapContents.isEmpty()) {
+        m_keymapContents = serializeKeymap(m_keymap);
+    }
+
     m_shiftModifier   = xkb_keymap_mod_get_index(m_keymap, XKB_MOD_NAME_SHIFT);
     m_capsModifier    = xkb_keymap_mod_get_index(m_keymap, XKB_MOD_NAME_CAPS);
     m_controlModifier = xkb_keymap_mod_get_index(m_keymap, XKB_MOD_NAME_CTRL);
@@ -320,15 +371,7 @@ QByteArray Xkb::keymapContents() const
         return {};
     }
     // TODO: uninstall keymap on server?
-    if (!m_keymap) {
-        return {};
-    }
-
-    ScopedCPointer<char> keymapString(xkb_keymap_get_as_string(m_keymap, XKB_KEYMAP_FORMAT_TEXT_V1));
-    if (keymapString.isNull()) {
-        return {};
-    }
-    return keymapString.data();
+    return m_keymapContents;
 }
 
 void Xkb::updateModifiers(uint32_t modsDepressed, uint32_t modsLatched, uint32_t modsLocked, uint32_t group)
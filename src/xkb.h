@@ -107,6 +107,8 @@ private:
     void applyEnvironmentRules(xkb_rule_names &);
     xkb_keymap *loadKeymapFromConfig();
     xkb_keymap *loadDefaultKeymap();
+    xkb_keymap *compileKeymap(const xkb_rule_names &ruleNames);
+    QByteArray serializeKeymap(xkb_keymap *keymap) const;
     void updateKeymap(xkb_keymap *keymap);
     void createKeymapFile();
     void updateModifiers();
@@ -150,6 +152,18 @@ private:
     Ownership m_ownership = Ownership::Server;
 
     QPointer<KWaylandServer::SeatInterface> m_seat;
+
+    /**
+     * Keymaps compiled from rule names, so that reconfiguring with unchanged or previously
+     * used names neither compiles nor serializes the keymap again.
+     */
+    struct CachedKeymap {
+        QByteArray ruleNames;
+        xkb_keymap *keymap;
+        QByteArray contents;
+    };
+    QVector<CachedKeymap> m_keymapCache;
+    QByteArray m_keymapContents;
 };
 
 inline
@@ -136,6 +136,13 @@ void Primary::doHandleXfixesNotify(xcb_xfixes_selection_notify_event_t *event)
         return;
     }
 
+    if (X11Source *source = x11Source()) {
+        if (event && source->owner() == event->owner && source->timestamp() == event->timestamp) {
+            // same ownership as before, the known targets are still valid
+            return;
+        }
+    }
+
     createX11Source(event);
 
     if (X11Source *source = x11Source()) {
@@ -125,6 +125,10 @@ public:
         setWindow(window);
     }
 
+    xcb_window_t owner() const {
+        return m_owner;
+    }
+
     void startTransfer(const QString &mimeName, qint32 fd);
 Q_SIGNALS:
     void offersChanged(const QStringList &added, const QStringList &removed);
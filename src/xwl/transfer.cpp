@@ -24,6 +24,8 @@
 #include <xcb/xfixes.h>
 
 #include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
 #include <unistd.h>
 
 #include <xwayland_logging.h>
@@ -42,6 +44,12 @@ Transfer::Transfer(xcb_atom_t selection, qint32 fd, xcb_timestamp_t timestamp, Q
     , m_fd(fd)
     , m_timestamp(timestamp)
 {
+    // Never block the compositor on a slow or stuck peer, the socket notifiers tell us
+    // when the pipe can be read from or written to again
+    const int flags = fcntl(m_fd, F_GETFL);
+    if (flags != -1) {
+        fcntl(m_fd, F_SETFL, flags | O_NONBLOCK);
+    }
 }
 
 void Transfer::createSocketNotifier(QSocketNotifier::Type type)
@@ -171,6 +179,10 @@ void TransferWltoX::readWlSource()
     Q_ASSERT(avail > 0);
 
     ssize_t readLen = read(fd(), m_chunks.last().first.data() + oldLen, avail);
+    if (readLen == -1 && (errno == EAGAIN || errno == EINTR)) {
+        // spurious wake up, wait for the next notification
+        return;
+    }
     if (readLen == -1) {
         qCWarning(KWIN_XWL) << "Error reading in Wl data.";
 
@@ -541,6 +553,10 @@ void TransferXtoWl::dataSourceWrite()
     QByteArray property = m_receiver->data();
 
     ssize_t len = write(fd(), property.constData(), property.size());
+    if (len == -1 && (errno == EAGAIN || errno == EINTR)) {
+        // the pipe is full, continue once the receiver has read from it
+        len = 0;
+    }
     if (len == -1) {
         qCWarning(KWIN_XWL) << "X11 to Wayland write error on fd:" << fd();
         endTransfer();
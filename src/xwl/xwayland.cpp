@@ -35,6 +35,7 @@
 #include <QHostInfo>
 #include <QRandomGenerator>
 #include <QScopeGuard>
+#include <QSet>
 #include <QTimer>
 #include <QtConcurrentRun>
 
@@ -91,9 +92,55 @@ void Xwayland::start()
         m_listenFds = m_socket->fileDescriptors();
     }
 
+    if (qEnvironmentVariableIntValue("KWIN_XWAYLAND_ON_DEMAND")) {
+        // Clients can find the display right away, the server is started
+        // once the first of them connects
+        exportDisplay();
+        installListenNotifiers();
+        return;
+    }
+
     startInternal();
 }
 
+bool Xwayland::isWaitingForClient() const
+{
+    return !m_listenNotifiers.isEmpty();
+}
+
+void Xwayland::installListenNotifiers()
+{
+    for (int fd : qAsConst(m_listenFds)) {
+        auto notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+        connect(notifier, &QSocketNotifier::activated, this, &Xwayland::handleListenSocketActivated);
+        m_listenNotifiers.append(notifier);
+    }
+}
+
+void Xwayland::uninstallListenNotifiers()
+{
+    qDeleteAll(m_listenNotifiers);
+    m_listenNotifiers.clear();
+}
+
+void Xwayland::handleListenSocketActivated()
+{
+    // The pending connection is accepted by Xwayland itself
+    uninstallListenNotifiers();
+    qCInfo(KWIN_XWL) << "Starting Xwayland for the first X11 client on display" << m_displayName;
+    startInternal();
+}
+
+void Xwayland::exportDisplay()
+{
+    auto env = m_app->processStartupEnvironment();
+    env.insert(QStringLiteral("DISPLAY"), m_displayName);
+    env.insert(QStringLiteral("XAUTHORITY"), m_xAuthority);
+    qputenv("DISPLAY", m_displayName.toUtf8());
+    qputenv("XAUTHORITY", m_xAuthority.toUtf8());
+    m_app->setProcessStartupEnvironment(env);
+}
+
 void Xwayland::setListenFDs(const QVector<int> &listenFds)
 {
     m_listenFds = listenFds;
@@ -208,6 +255,7 @@ bool Xwayland::startInternal()
 
 void Xwayland::stop()
 {
+    uninstallListenNotifiers();
     if (!m_xwaylandProcess) {
         return;
     }
@@ -270,16 +318,99 @@ void Xwayland::dispatchEvents()
         return;
     }
 
-    while (xcb_generic_event_t *event = xcb_poll_for_event(connection)) {
-        long result = 0;
+    QVector<xcb_generic_event_t *> events;
+    while (true) {
+        while (xcb_generic_event_t *event = xcb_poll_for_event(connection)) {
+            events.append(event);
+        }
+        if (events.isEmpty()) {
+            break;
+        }
+
+        const int coalesced = coalesceEvents(events);
+        m_dispatchedEventCount += events.count() - coalesced;
+        m_coalescedEventCount += coalesced;
+        if (coalesced) {
+            qCDebug(KWIN_XWL) << "Coalesced" << coalesced << "of" << events.count() << "X11 events,"
+                              << m_coalescedEventCount << "of" << (m_dispatchedEventCount + m_coalescedEventCount) << "in total";
+        }
+
         QAbstractEventDispatcher *dispatcher = QCoreApplication::eventDispatcher();
-        dispatcher->filterNativeEvent(QByteArrayLiteral("xcb_generic_event_t"), event, &result);
-        free(event);
+        for (xcb_generic_event_t *event : qAsConst(events)) {
+            if (!event) {
+                continue;
+            }
+            long result = 0;
+            dispatcher->filterNativeEvent(QByteArrayLiteral("xcb_generic_event_t"), event, &result);
+            free(event);
+        }
+        events.clear();
     }
 
     xcb_flush(connection);
 }
 
+/**
+ * Drops events from @p events that a later event in the same batch makes redundant, and
+ * returns how many were dropped. The dropped entries are freed and set to @c null.
+ *
+ * Only events whose handlers re-read the current state of the window are collapsed, and
+ * never across unrelated events, so the order in which the remaining events are seen
+ * does not change:
+ * @li of a run of PropertyNotify events, only the last one per window and atom is kept
+ * @li of back to back ConfigureNotify events for one window, only the last one per
+ *     receiving window is kept
+ */
+int Xwayland::coalesceEvents(QVector<xcb_generic_event_t *> &events)
+{
+    int coalesced = 0;
+    QSet<quint64> seenProperties;
+    // The same ConfigureNotify is reported to the window and to its parent
+    xcb_window_t configuredWindow = XCB_WINDOW_NONE;
+    QSet<xcb_window_t> configureReceivers;
+
+    for (int i = events.count() - 1; i >= 0; --i) {
+        xcb_generic_event_t *event = events[i];
+        const uint8_t eventType = event->response_type & ~0x80;
+
+        if (eventType == XCB_PROPERTY_NOTIFY) {
+            const auto *propertyEvent = reinterpret_cast<xcb_property_notify_event_t *>(event);
+            const quint64 key = (quint64(propertyEvent->window) << 32) | propertyEvent->atom;
+            configuredWindow = XCB_WINDOW_NONE;
+            configureReceivers.clear();
+            if (seenProperties.contains(key)) {
+                free(event);
+                events[i] = nullptr;
+                ++coalesced;
+            } else {
+                seenProperties.insert(key);
+            }
+            continue;
+        }
+        seenProperties.clear();
+
+        if (eventType == XCB_CONFIGURE_NOTIFY) {
+            const auto *configureEvent = reinterpret_cast<xcb_configure_notify_event_t *>(event);
+            if (configureEvent->window != configuredWindow) {
+                configuredWindow = configureEvent->window;
+                configureReceivers.clear();
+            }
+            if (configureReceivers.contains(configureEvent->event)) {
+                free(event);
+                events[i] = nullptr;
+                ++coalesced;
+            } else {
+                configureReceivers.insert(configureEvent->event);
+            }
+            continue;
+        }
+        configuredWindow = XCB_WINDOW_NONE;
+        configureReceivers.clear();
+    }
+
+    return coalesced;
+}
+
 void Xwayland::installSocketNotifier()
 {
     const int fileDescriptor = xcb_get_file_descriptor(kwinApp()->x11Connection());
@@ -396,12 +527,7 @@ void Xwayland::handleXwaylandReady()
 
     DataBridge::create(this);
 
-    auto env = m_app->processStartupEnvironment();
-    env.insert(QStringLiteral("DISPLAY"), m_displayName);
-    env.insert(QStringLiteral("XAUTHORITY"), m_xAuthority);
-    qputenv("DISPLAY", m_displayName.toUtf8());
-    qputenv("XAUTHORITY", m_xAuthority.toUtf8());
-    m_app->setProcessStartupEnvironment(env);
+    exportDisplay();
 
     connect(kwinApp()->platform(), &Platform::primaryOutputChanged, this, &Xwayland::updatePrimary);
     updatePrimary(kwinApp()->platform()->primaryOutput());
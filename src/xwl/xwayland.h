@@ -61,6 +61,13 @@ public:
      */
     void setXauthority(const QString &xauthority);
 
+    /**
+     * Returns @c true if the Xwayland server is started on demand and no X11 client has
+     * connected yet. Set the @c KWIN_XWAYLAND_ON_DEMAND environment variable to start
+     * Xwayland only when the first X11 client connects to its socket.
+     */
+    bool isWaitingForClient() const;
+
 public Q_SLOTS:
     /**
      * Starts the Xwayland server.
@@ -107,6 +114,7 @@ private Q_SLOTS:
     void handleXwaylandCrashed();
     void handleXwaylandError(QProcess::ProcessError error);
     void handleXwaylandReady();
+    void handleListenSocketActivated();
 
     void handleSelectionLostOwnership();
     void handleSelectionFailedToClaimOwnership();
@@ -114,6 +122,10 @@ private Q_SLOTS:
 
 private:
     void installSocketNotifier();
+    void installListenNotifiers();
+    void uninstallListenNotifiers();
+    void exportDisplay();
+    int coalesceEvents(QVector<xcb_generic_event_t *> &events);
     void uninstallSocketNotifier();
     void maybeDestroyReadyNotifier();
     void updatePrimary(AbstractOutput *primaryOutput);
@@ -139,10 +151,13 @@ private:
     QScopedPointer<XwaylandSocket> m_socket;
 
     QVector<int> m_listenFds;
+    QVector<QSocketNotifier *> m_listenNotifiers;
     QString m_displayName;
     QString m_xAuthority;
 
     int m_crashCount = 0;
+    quint64 m_dispatchedEventCount = 0;
+    quint64 m_coalescedEventCount = 0;
 
     Q_DISABLE_COPY(Xwayland)
 };